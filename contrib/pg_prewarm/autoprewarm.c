@@ -16,6 +16,13 @@
  *		relevant database in turn.  The former keeps running after the
  *		initial prewarm is complete to update the dump file periodically.
  *
+ *		POLAR: with pg_prewarm.polar_shared_dump, the primary dumps ranges
+ *		of consecutive blocks weighted by usage count into shared storage,
+ *		and replicas prewarm from the latest dump of primary periodically,
+ *		so that a replica is warm when it is promoted.  Progress of the
+ *		prewarm is kept in shared memory, a restarted leader continues from
+ *		where the previous one stopped.
+ *
  *	Copyright (c) 2016-2022, PostgreSQL Global Development Group
  *
  *	IDENTIFICATION
@@ -30,8 +37,10 @@
 
 #include "access/relation.h"
 #include "access/xact.h"
+#include "access/xlog.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_type.h"
+#include "lib/stringinfo.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/bgworker.h"
@@ -55,7 +64,13 @@
 #include "utils/relfilenodemap.h"
 #include "utils/resowner.h"
 
+/* POLAR */
+#include "storage/polar_bufmgr.h"
+#include "storage/polar_fd.h"
+
 #define AUTOPREWARM_FILE "autoprewarm.blocks"
+/* POLAR: dump file in shared storage, see polar_apw_write_shared_dump */
+#define POLAR_AUTOPREWARM_SHARED_FILE "autoprewarm.ranges"
 
 /* Metadata for each block we dump. */
 typedef struct BlockInfoRecord
@@ -65,8 +80,21 @@ typedef struct BlockInfoRecord
 	Oid			filenode;
 	ForkNumber	forknum;
 	BlockNumber blocknum;
+	uint32		usage_count;	/* POLAR: only used to dump */
 } BlockInfoRecord;
 
+/* POLAR: a range of consecutive blocks in the shared dump file */
+typedef struct PolarBlockRangeRecord
+{
+	Oid			database;
+	Oid			tablespace;
+	Oid			filenode;
+	ForkNumber	forknum;
+	BlockNumber startblock;
+	BlockNumber nblocks;
+	uint64		weight;			/* sum of usage count of the blocks */
+} PolarBlockRangeRecord;
+
 /* Shared state information for autoprewarm bgworker. */
 typedef struct AutoPrewarmSharedState
 {
@@ -80,6 +108,11 @@ typedef struct AutoPrewarmSharedState
 	int			prewarm_start_idx;
 	int			prewarm_stop_idx;
 	int			prewarmed_blocks;
+
+	/* POLAR: progress of prewarm from the shared dump file */
+	int64		polar_generation;	/* generation of the dump being loaded */
+	int			polar_resume_idx;	/* blocks before it are prewarmed */
+	bool		polar_load_finished;
 } AutoPrewarmSharedState;
 
 void		_PG_init(void);
@@ -96,6 +129,14 @@ static void apw_start_database_worker(void);
 static bool apw_init_shmem(void);
 static void apw_detach_shmem(int code, Datum arg);
 static int	apw_compare_blockinfo(const void *p, const void *q);
+static dsm_segment *apw_read_dump_file(int *num_elements);
+
+/* POLAR */
+static int	polar_apw_write_shared_dump(BlockInfoRecord *block_info_array, int num_blocks);
+static dsm_segment *polar_apw_read_shared_dump(int *num_elements, int64 *generation);
+static int	polar_apw_compare_range_density(const void *p, const void *q);
+static int	polar_apw_compare_range_block(const void *p, const void *q);
+/* POLAR end */
 static void autoprewarm_shmem_request(void);
 static shmem_request_hook_type prev_shmem_request_hook = NULL;
 
@@ -105,6 +146,7 @@ static AutoPrewarmSharedState *apw_state = NULL;
 /* GUC variables. */
 static bool autoprewarm = true; /* start worker? */
 static int	autoprewarm_interval;	/* dump interval */
+static bool polar_shared_dump = false;	/* POLAR: dump into shared storage? */
 
 /*
  * Module load callback.
@@ -139,6 +181,18 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	/* POLAR */
+	DefineCustomBoolVariable("pg_prewarm.polar_shared_dump",
+							 "Dumps block ranges into shared storage on primary and prewarms from them on replica.",
+							 NULL,
+							 &polar_shared_dump,
+							 false,
+							 PGC_POSTMASTER,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	MarkGUCPrefixReserved("pg_prewarm");
 
 	prev_shmem_request_hook = shmem_request_hook;
@@ -214,8 +268,11 @@ autoprewarm_main(Datum main_arg)
 	 * If apw_load_buffers() is terminated early by a shutdown request,
 	 * prevent dumping out our state below the loop, because we'd effectively
 	 * just truncate the saved state to however much we'd managed to preload.
+	 *
+	 * POLAR: with the shared dump, the progress in shared memory tells
+	 * whether a restarted leader has anything left to prewarm.
 	 */
-	if (first_time)
+	if (first_time || polar_shared_dump)
 	{
 		apw_load_buffers();
 		final_dump_allowed = !ShutdownRequestPending;
@@ -257,7 +314,15 @@ autoprewarm_main(Datum main_arg)
 			if (delay_in_ms <= 0)
 			{
 				last_dump_time = GetCurrentTimestamp();
-				apw_dump_now(true, false);
+
+				/*
+				 * POLAR: replica follows the latest dump of primary instead,
+				 * the blocks already in shared buffers are skipped quickly.
+				 */
+				if (polar_shared_dump && RecoveryInProgress())
+					apw_load_buffers();
+				else
+					apw_dump_now(true, false);
 				continue;
 			}
 
@@ -287,11 +352,10 @@ autoprewarm_main(Datum main_arg)
 static void
 apw_load_buffers(void)
 {
-	FILE	   *file = NULL;
-	int			num_elements,
-				i;
+	int			num_elements;
 	BlockInfoRecord *blkinfo;
 	dsm_segment *seg;
+	int64		generation = 0;
 
 	/*
 	 * Skip the prewarm if the dump file is in use; otherwise, prevent any
@@ -311,51 +375,22 @@ apw_load_buffers(void)
 	LWLockRelease(&apw_state->lock);
 
 	/*
-	 * Open the block dump file.  Exit quietly if it doesn't exist, but report
-	 * any other error.
+	 * POLAR: read the dump of primary in shared storage, unless it is the
+	 * one we have finished.
 	 */
-	file = AllocateFile(AUTOPREWARM_FILE, "r");
-	if (!file)
-	{
-		if (errno == ENOENT)
-		{
-			LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
-			apw_state->pid_using_dumpfile = InvalidPid;
-			LWLockRelease(&apw_state->lock);
-			return;				/* No file to load. */
-		}
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not read file \"%s\": %m",
-						AUTOPREWARM_FILE)));
-	}
-
-	/* First line of the file is a record count. */
-	if (fscanf(file, "<<%d>>\n", &num_elements) != 1)
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not read from file \"%s\": %m",
-						AUTOPREWARM_FILE)));
-
-	/* Allocate a dynamic shared memory segment to store the record data. */
-	seg = dsm_create(sizeof(BlockInfoRecord) * num_elements, 0);
-	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
+	if (polar_shared_dump)
+		seg = polar_apw_read_shared_dump(&num_elements, &generation);
+	else
+		seg = apw_read_dump_file(&num_elements);
 
-	/* Read records, one per line. */
-	for (i = 0; i < num_elements; i++)
+	if (seg == NULL)
 	{
-		unsigned	forknum;
-
-		if (fscanf(file, "%u,%u,%u,%u,%u\n", &blkinfo[i].database,
-				   &blkinfo[i].tablespace, &blkinfo[i].filenode,
-				   &forknum, &blkinfo[i].blocknum) != 5)
-			ereport(ERROR,
-					(errmsg("autoprewarm block dump file is corrupted at line %d",
-							i + 1)));
-		blkinfo[i].forknum = forknum;
+		LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+		apw_state->pid_using_dumpfile = InvalidPid;
+		LWLockRelease(&apw_state->lock);
+		return;					/* No file or nothing new to load. */
 	}
-
-	FreeFile(file);
+	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
 
 	/* Sort the blocks to be loaded. */
 	pg_qsort(blkinfo, num_elements, sizeof(BlockInfoRecord),
@@ -366,6 +401,28 @@ apw_load_buffers(void)
 	apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx = 0;
 	apw_state->prewarmed_blocks = 0;
 
+	/*
+	 * POLAR: continue the prewarm of the same dump from where it stopped,
+	 * the blocks are in the same order since the dump is not changed.
+	 */
+	if (polar_shared_dump)
+	{
+		if (apw_state->polar_generation == generation)
+			apw_state->prewarm_start_idx =
+				Min(apw_state->polar_resume_idx, num_elements);
+		else
+		{
+			apw_state->polar_generation = generation;
+			apw_state->polar_load_finished = false;
+		}
+		apw_state->polar_resume_idx = apw_state->prewarm_start_idx;
+
+		if (apw_state->prewarm_start_idx > 0)
+			ereport(LOG,
+					(errmsg("autoprewarm resumes from block %d of %d",
+							apw_state->prewarm_start_idx, num_elements)));
+	}
+
 	/* Get the info position of the first block of the next database. */
 	while (apw_state->prewarm_start_idx < num_elements)
 	{
@@ -425,8 +482,13 @@ apw_load_buffers(void)
 
 		/* Prepare for next database. */
 		apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx;
+		apw_state->polar_resume_idx = apw_state->prewarm_start_idx;
 	}
 
+	/* POLAR: nothing left in this dump unless we are shutting down */
+	if (polar_shared_dump && !ShutdownRequestPending)
+		apw_state->polar_load_finished = true;
+
 	/* Clean up. */
 	dsm_detach(seg);
 	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
@@ -441,6 +503,64 @@ apw_load_buffers(void)
 						apw_state->prewarmed_blocks, num_elements)));
 }
 
+/*
+ * Read the block dump file into a dynamic shared memory segment.  Returns
+ * NULL if the file doesn't exist.
+ */
+static dsm_segment *
+apw_read_dump_file(int *num_elements)
+{
+	FILE	   *file = NULL;
+	int			i;
+	BlockInfoRecord *blkinfo;
+	dsm_segment *seg;
+
+	/*
+	 * Open the block dump file.  Exit quietly if it doesn't exist, but report
+	 * any other error.
+	 */
+	file = AllocateFile(AUTOPREWARM_FILE, "r");
+	if (!file)
+	{
+		if (errno == ENOENT)
+			return NULL;		/* No file to load. */
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m",
+						AUTOPREWARM_FILE)));
+	}
+
+	/* First line of the file is a record count. */
+	if (fscanf(file, "<<%d>>\n", num_elements) != 1)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from file \"%s\": %m",
+						AUTOPREWARM_FILE)));
+
+	/* Allocate a dynamic shared memory segment to store the record data. */
+	seg = dsm_create(sizeof(BlockInfoRecord) * *num_elements, 0);
+	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
+
+	/* Read records, one per line. */
+	for (i = 0; i < *num_elements; i++)
+	{
+		unsigned	forknum;
+
+		if (fscanf(file, "%u,%u,%u,%u,%u\n", &blkinfo[i].database,
+				   &blkinfo[i].tablespace, &blkinfo[i].filenode,
+				   &forknum, &blkinfo[i].blocknum) != 5)
+			ereport(ERROR,
+					(errmsg("autoprewarm block dump file is corrupted at line %d",
+							i + 1)));
+		blkinfo[i].forknum = forknum;
+		blkinfo[i].usage_count = 0;
+	}
+
+	FreeFile(file);
+
+	return seg;
+}
+
 /*
  * Prewarm all blocks for one database (and possibly also global objects, if
  * those got grouped with this database).
@@ -476,9 +596,13 @@ autoprewarm_database_main(Datum main_arg)
 	 */
 	while (pos < apw_state->prewarm_stop_idx && have_free_buffer())
 	{
-		BlockInfoRecord *blk = &block_info[pos++];
+		BlockInfoRecord *blk;
 		Buffer		buf;
 
+		/* POLAR: blocks before pos are done, for a restarted leader */
+		apw_state->polar_resume_idx = pos;
+		blk = &block_info[pos++];
+
 		CHECK_FOR_INTERRUPTS();
 
 		/*
@@ -550,9 +674,30 @@ autoprewarm_database_main(Datum main_arg)
 			continue;
 		}
 
-		/* Prewarm buffer. */
-		buf = ReadBufferExtended(rel, blk->forknum, blk->blocknum, RBM_NORMAL,
-								 NULL);
+		/*
+		 * Prewarm buffer.  POLAR: read the following consecutive blocks of
+		 * the fork in one io, the next records then hit shared buffers.
+		 */
+		if (polar_bulk_read_size > 1)
+		{
+			BlockNumber run = 1;
+
+			while (pos - 1 + run < apw_state->prewarm_stop_idx &&
+				   run < polar_bulk_read_size &&
+				   block_info[pos - 1 + run].database == blk->database &&
+				   block_info[pos - 1 + run].tablespace == blk->tablespace &&
+				   block_info[pos - 1 + run].filenode == blk->filenode &&
+				   block_info[pos - 1 + run].forknum == blk->forknum &&
+				   block_info[pos - 1 + run].blocknum == blk->blocknum + run)
+				run++;
+
+			buf = polar_bulk_read_buffer_extended(rel, blk->forknum, blk->blocknum,
+												  RBM_NORMAL, NULL,
+												  Min(run, nblocks - blk->blocknum));
+		}
+		else
+			buf = ReadBufferExtended(rel, blk->forknum, blk->blocknum, RBM_NORMAL,
+									 NULL);
 		if (BufferIsValid(buf))
 		{
 			apw_state->prewarmed_blocks++;
@@ -590,6 +735,16 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 	char		transient_dump_file_path[MAXPGPATH];
 	pid_t		pid;
 
+	/* POLAR: the shared dump file is written by primary only */
+	if (polar_shared_dump && RecoveryInProgress())
+	{
+		if (!is_bgworker)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("could not perform block dump into shared storage during recovery")));
+		return 0;
+	}
+
 	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
 	pid = apw_state->pid_using_dumpfile;
 	if (apw_state->pid_using_dumpfile == InvalidPid)
@@ -636,12 +791,28 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 			block_info_array[num_blocks].filenode = bufHdr->tag.rnode.relNode;
 			block_info_array[num_blocks].forknum = bufHdr->tag.forkNum;
 			block_info_array[num_blocks].blocknum = bufHdr->tag.blockNum;
+			block_info_array[num_blocks].usage_count = BUF_STATE_GET_USAGECOUNT(buf_state);
 			++num_blocks;
 		}
 
 		UnlockBufHdr(bufHdr, buf_state);
 	}
 
+	/* POLAR: dump block ranges into shared storage */
+	if (polar_shared_dump)
+	{
+		int			num_ranges;
+
+		num_ranges = polar_apw_write_shared_dump(block_info_array, num_blocks);
+		pfree(block_info_array);
+		apw_state->pid_using_dumpfile = InvalidPid;
+
+		ereport(DEBUG1,
+				(errmsg_internal("wrote %d ranges for %d blocks into shared storage",
+								 num_ranges, num_blocks)));
+		return num_blocks;
+	}
+
 	snprintf(transient_dump_file_path, MAXPGPATH, "%s.tmp", AUTOPREWARM_FILE);
 	file = AllocateFile(transient_dump_file_path, "w");
 	if (!file)
@@ -786,6 +957,10 @@ apw_init_shmem(void)
 		LWLockInitialize(&apw_state->lock, LWLockNewTrancheId());
 		apw_state->bgworker_pid = InvalidPid;
 		apw_state->pid_using_dumpfile = InvalidPid;
+		/* POLAR */
+		apw_state->polar_generation = 0;
+		apw_state->polar_resume_idx = 0;
+		apw_state->polar_load_finished = false;
 	}
 	LWLockRelease(AddinShmemInitLock);
 
@@ -917,3 +1092,282 @@ apw_compare_blockinfo(const void *p, const void *q)
 
 	return 0;
 }
+
+/*
+ * POLAR: write the blocks into the shared dump file as ranges of
+ * consecutive blocks, which is much smaller than a record per block when
+ * relations are scanned.  The first line is the generation of the dump,
+ * the number of ranges and the number of blocks, followed by a line per
+ * range: database, tablespace, filenode, fork, start block, number of
+ * blocks and the sum of usage count of the blocks.
+ * Returns the number of ranges dumped.
+ */
+static int
+polar_apw_write_shared_dump(BlockInfoRecord *block_info_array, int num_blocks)
+{
+	StringInfoData ranges;
+	StringInfoData buf;
+	char		path[MAXPGPATH];
+	char		tmppath[MAXPGPATH];
+	int			num_ranges = 0;
+	int			fd;
+	int			i,
+				j;
+
+	pg_qsort(block_info_array, num_blocks, sizeof(BlockInfoRecord),
+			 apw_compare_blockinfo);
+
+	initStringInfo(&ranges);
+	for (i = 0; i < num_blocks; i = j)
+	{
+		BlockInfoRecord *first = &block_info_array[i];
+		uint64		weight = first->usage_count;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (j = i + 1; j < num_blocks; j++)
+		{
+			BlockInfoRecord *blk = &block_info_array[j];
+
+			if (blk->database != first->database ||
+				blk->tablespace != first->tablespace ||
+				blk->filenode != first->filenode ||
+				blk->forknum != first->forknum ||
+				blk->blocknum != first->blocknum + (j - i))
+				break;
+			weight += blk->usage_count;
+		}
+
+		appendStringInfo(&ranges, "%u,%u,%u,%u,%u,%u," UINT64_FORMAT "\n",
+						 first->database, first->tablespace, first->filenode,
+						 (uint32) first->forknum, first->blocknum,
+						 (uint32) (j - i), weight);
+		num_ranges++;
+	}
+
+	initStringInfo(&buf);
+	appendStringInfo(&buf, "<<" INT64_FORMAT ",%d,%d>>\n",
+					 (int64) GetCurrentTimestamp(), num_ranges, num_blocks);
+	appendBinaryStringInfo(&buf, ranges.data, ranges.len);
+	pfree(ranges.data);
+
+	polar_make_file_path_level2(path, POLAR_AUTOPREWARM_SHARED_FILE);
+	snprintf(tmppath, MAXPGPATH, "%s.tmp", path);
+
+	fd = OpenTransientFile(tmppath, O_RDWR | O_CREAT | O_TRUNC | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", tmppath)));
+
+	errno = 0;
+	if (polar_write(fd, buf.data, buf.len) != buf.len)
+	{
+		int			save_errno = errno;
+
+		CloseTransientFile(fd);
+		polar_unlink(tmppath);
+		/* if write didn't set errno, assume problem is no disk space */
+		errno = save_errno ? save_errno : ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m", tmppath)));
+	}
+	pfree(buf.data);
+
+	if (polar_fsync(fd) != 0)
+		ereport(data_sync_elevel(ERROR),
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", tmppath)));
+
+	if (CloseTransientFile(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", tmppath)));
+
+	(void) durable_rename(tmppath, path, ERROR);
+
+	return num_ranges;
+}
+
+/*
+ * POLAR: read the shared dump file and expand its ranges into a dynamic
+ * shared memory segment.  If the dump has more blocks than shared buffers,
+ * only the ranges with the highest usage count per block are kept.
+ * Returns NULL if the file doesn't exist, or it is the dump we have
+ * finished prewarming.
+ */
+static dsm_segment *
+polar_apw_read_shared_dump(int *num_elements, int64 *generation)
+{
+	char		path[MAXPGPATH];
+	struct stat st;
+	char	   *data;
+	char	   *line;
+	PolarBlockRangeRecord *ranges;
+	BlockInfoRecord *blkinfo;
+	dsm_segment *seg;
+	off_t		offset = 0;
+	uint64		total = 0;
+	int			num_ranges;
+	int			num_blocks;
+	int			fd;
+	int			i,
+				n;
+
+	polar_make_file_path_level2(path, POLAR_AUTOPREWARM_SHARED_FILE);
+
+	fd = OpenTransientFile(path, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+			return NULL;		/* No file to load. */
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+	}
+
+	if (polar_fstat(fd, &st) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+
+	data = palloc(st.st_size + 1);
+	while (offset < st.st_size)
+	{
+		ssize_t		nread = polar_read(fd, data + offset, st.st_size - offset);
+
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", path)));
+		if (nread == 0)
+			break;
+		offset += nread;
+	}
+	data[offset] = '\0';
+
+	if (CloseTransientFile(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", path)));
+
+	/* First line of the file is the generation and record counts. */
+	if (sscanf(data, "<<" INT64_FORMAT ",%d,%d>>", generation,
+			   &num_ranges, &num_blocks) != 3 ||
+		num_ranges < 0 || num_blocks < 0)
+		ereport(ERROR,
+				(errmsg("autoprewarm shared dump file \"%s\" is corrupted at line 1",
+						path)));
+
+	if (*generation == apw_state->polar_generation &&
+		apw_state->polar_load_finished)
+	{
+		pfree(data);
+		return NULL;
+	}
+
+	/* Read ranges, one per line. */
+	ranges = palloc(sizeof(PolarBlockRangeRecord) * Max(num_ranges, 1));
+	line = strchr(data, '\n');
+	for (i = 0; i < num_ranges; i++)
+	{
+		unsigned	forknum;
+
+		if (line == NULL ||
+			sscanf(line + 1, "%u,%u,%u,%u,%u,%u," UINT64_FORMAT,
+				   &ranges[i].database, &ranges[i].tablespace,
+				   &ranges[i].filenode, &forknum, &ranges[i].startblock,
+				   &ranges[i].nblocks, &ranges[i].weight) != 7)
+			ereport(ERROR,
+					(errmsg("autoprewarm shared dump file \"%s\" is corrupted at line %d",
+							path, i + 2)));
+		ranges[i].forknum = forknum;
+		total += ranges[i].nblocks;
+		line = strchr(line + 1, '\n');
+	}
+	pfree(data);
+
+	/*
+	 * A replica may have less shared buffers than primary, keep the hottest
+	 * ranges that fit.  The order is total, so the kept blocks and their
+	 * order are the same every time the dump is read.
+	 */
+	if (total > (uint64) NBuffers)
+	{
+		pg_qsort(ranges, num_ranges, sizeof(PolarBlockRangeRecord),
+				 polar_apw_compare_range_density);
+
+		for (total = 0, n = 0; n < num_ranges && total < (uint64) NBuffers; n++)
+		{
+			ranges[n].nblocks = Min(ranges[n].nblocks, (uint64) NBuffers - total);
+			total += ranges[n].nblocks;
+		}
+		num_ranges = n;
+	}
+
+	if (total == 0)
+	{
+		pfree(ranges);
+		return NULL;
+	}
+
+	/* Allocate a dynamic shared memory segment to store the record data. */
+	seg = dsm_create(sizeof(BlockInfoRecord) * total, 0);
+	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
+
+	for (n = 0, i = 0; i < num_ranges; i++)
+	{
+		BlockNumber blk;
+
+		for (blk = 0; blk < ranges[i].nblocks; blk++, n++)
+		{
+			blkinfo[n].database = ranges[i].database;
+			blkinfo[n].tablespace = ranges[i].tablespace;
+			blkinfo[n].filenode = ranges[i].filenode;
+			blkinfo[n].forknum = ranges[i].forknum;
+			blkinfo[n].blocknum = ranges[i].startblock + blk;
+			blkinfo[n].usage_count = 0;
+		}
+	}
+	pfree(ranges);
+
+	*num_elements = (int) total;
+	return seg;
+}
+
+/*
+ * POLAR: order ranges by usage count per block descending, and by their
+ * blocks for ranges as hot as each other.
+ */
+static int
+polar_apw_compare_range_density(const void *p, const void *q)
+{
+	const PolarBlockRangeRecord *a = (const PolarBlockRangeRecord *) p;
+	const PolarBlockRangeRecord *b = (const PolarBlockRangeRecord *) q;
+	uint64		density_a = a->weight * b->nblocks;
+	uint64		density_b = b->weight * a->nblocks;
+
+	if (density_a > density_b)
+		return -1;
+	else if (density_a < density_b)
+		return 1;
+
+	return polar_apw_compare_range_block(p, q);
+}
+
+/* POLAR: order ranges by their first block */
+static int
+polar_apw_compare_range_block(const void *p, const void *q)
+{
+	const PolarBlockRangeRecord *a = (const PolarBlockRangeRecord *) p;
+	const PolarBlockRangeRecord *b = (const PolarBlockRangeRecord *) q;
+
+	cmp_member_elem(database);
+	cmp_member_elem(tablespace);
+	cmp_member_elem(filenode);
+	cmp_member_elem(forknum);
+	cmp_member_elem(startblock);
+
+	return 0;
+}
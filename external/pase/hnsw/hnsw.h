@@ -36,6 +36,12 @@
 #define MAX_HNSW_LEVEL 100
 #define HNSW_METAPAGE_BLKNO 0
 #define HNSW_MAGICK_NUMBER (0xDBAC0EEE)
+#define HNSW_MAX_DIM 512
+#define HNSW_MAX_RERANK 10000
+
+// vector storage of data pages
+#define HNSW_QUANTIZER_NONE 0
+#define HNSW_QUANTIZER_SQ8  1
 
 typedef struct HNSWGlobalId {
   int32 nblkid;
@@ -56,8 +62,17 @@ typedef struct HNSWOptions {
   // cumulative neighbor num on all lower level
   uint16 cum_nn_per_level[MAX_HNSW_LEVEL + 1];
   float4 assign_probas[MAX_HNSW_LEVEL];
+  int32 quantizer;  // vector storage: 0 float, 1 sq8
+  int32 rerank;     // candidates re-ranked with heap vectors, 0 off
 } HNSWOptions;
 
+// Metapage information cached in rd_amcache, one chunk so that relcache
+// can free it
+typedef struct HNSWCacheData {
+  HNSWOptions opts;
+  float4 params[FLEXIBLE_ARRAY_MEMBER];  // sq8: vmin[dim] and vstep[dim]
+} HNSWCacheData;
+
 typedef struct HNSWBuildState {
   HNSWOptions opts;
   MemoryContext tmpctx;
@@ -80,7 +95,7 @@ typedef struct HNSWDataTuple {
   PaseTuple tag;  // for PaseTupleList
   ItemPointerData heap_ptr;
   uint16 level;
-  float4 vector[FLEXIBLE_ARRAY_MEMBER];
+  float4 vector[FLEXIBLE_ARRAY_MEMBER];  // sq8 codes for quantized storage
 } HNSWDataTuple;
 
 typedef struct HNSWPriorityQueueNode {
@@ -106,6 +121,7 @@ typedef struct HNSWMetaPageData {
   // real data page blkid
   int32 last_data_blkid;
   HNSWOptions opts;
+  // followed by the quantizer parameters of HNSWCacheData
 } HNSWMetaPageData;
 typedef HNSWMetaPageData* HNSWMetaPage;
 
@@ -113,6 +129,7 @@ typedef struct HNSWScanOpaqueData {
     PASE*  scan_pase;
     MemoryContext scan_ctx;
     PriorityQueue* queue;
+    PriorityQueue* rerank_queue;  // candidates with exact distances, popped first
     uint16 data_tup_size;
     bool first_call;
 } HNSWScanOpaqueData;
@@ -225,15 +242,20 @@ int HNSWPriorityQueueCmp(const PriorityQueueNode *a,
     const PriorityQueueNode *b, void *arg);
 // options
 extern HNSWOptions *MakeDefaultHNSWOptions(void);
+extern HNSWCacheData *HNSWGetCache(Relation index);
 // flush cached page when it is full
 extern int HNSWFlushCachedPage(Relation index, HNSWBuildState *buildState);
-extern void HNSWInitMetapage(Relation index);
+extern void HNSWInitMetapage(Relation index, const float4 *quantizerParams);
 extern void InitHNSWBuildState(HNSWBuildState *state, Relation index);
 // data page function
+extern Size HNSWDataTupleSize(HNSWOptions *opts);
 extern bool HNSWDataPageAddItem(HNSWBuildState *state, Page page,
     HNSWDataTuple *tuple);
-extern HNSWDataTuple *HNSWFormDataTuple(HNSWOptions* opts,
+extern int HNSWGetVector(HNSWOptions *opts, Datum value, float4 *vector);
+extern HNSWDataTuple *HNSWFormDataTuple(Relation index, HNSWOptions* opts,
     ItemPointer iptr, Datum *values, bool *isnull);
+extern const float4 *HNSWDataTupleGetVector(Relation index, HNSWOptions *opts,
+    HNSWDataTuple *tup, float4 *buf);
 extern void FindItDataByOffset(Relation index, uint16 dataTupSize,
   HNSWGlobalId gid, ItemPointerData* itData); 
 extern float Distance(Relation index, HNSWOptions *opts,
@@ -245,13 +267,13 @@ extern void HNSWBuildLink(Relation index, HNSWBuildState *state);
 extern int GreedyUpdateNearest(Relation index, HNSWOptions *opts,
     int32 maxLevel, int level, HNSWGlobalId *nearest, float *dNearest, const float4* vector);
 extern void AddLinkFromHighToLow(Relation index, HNSWBuildState *state,
-    HNSWGlobalId nearest, float dNearest, int level, HNSWDataTuple* tup,
+    HNSWGlobalId nearest, float dNearest, int level, const float4* vector,
     HNSWGlobalId gid, HNSWVtable *vtable);
 extern void ShrinkNbList(Relation index, HNSWBuildState *state, int level,
     PriorityQueue **linkTargets);
 extern void SearchNbToAdd(Relation index, HNSWOptions* opts, int level,
     HNSWGlobalId nearest,float dNearest, PriorityQueue *results,
-    HNSWVtable *vtable, HNSWDataTuple* dttup);
+    HNSWVtable *vtable, const float4* vector);
 extern void FillNeighborPages(Relation index, PasePageList *pageList,
     PriorityQueue *resultQueue, int32 begin, int32 end);
 extern void AddLink(Relation index, HNSWBuildState *state,
@@ -269,5 +291,8 @@ hnsw_bulkdelete(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 #define HNSW_MAGICK_NUMBER (0xDBAC0EEE)
 
 #define HNSWPageGetMeta(_page)  ((HNSWMetaPageData *) PageGetContents(_page))
+#define HNSWMetaPageGetQuantizer(_meta) \
+  ((float4 *)((Pointer)(_meta) + MAXALIGN(sizeof(HNSWMetaPageData))))
+#define HNSWDataTupleGetCode(_tup) ((uint8 *)(_tup)->vector)
 
 #endif  // PASE_HNSW_HNSW_H_
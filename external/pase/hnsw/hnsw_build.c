@@ -28,6 +28,62 @@
 
 #include "pase.h"
 
+// per dimension range of the indexed vectors, for sq8 storage
+typedef struct HNSWTrainState {
+  HNSWOptions *opts;
+  float4 *vector;
+  float4 *vmin;
+  float4 *vmax;
+  double count;
+} HNSWTrainState;
+
+static void
+HNSWTrainCallback(Relation index, ItemPointer tid, Datum *values,
+  bool *isnull, bool tupleIsAlive, void *state) {
+  HNSWTrainState *trainState = (HNSWTrainState *) state;
+  int dim = trainState->opts->dim;
+  int i;
+
+  if (isnull[0] ||
+      HNSWGetVector(trainState->opts, values[0], trainState->vector) != dim) {
+    return;
+  }
+  for (i = 0; i < dim; ++i) {
+    if (trainState->count == 0 || trainState->vector[i] < trainState->vmin[i]) {
+      trainState->vmin[i] = trainState->vector[i];
+    }
+    if (trainState->count == 0 || trainState->vector[i] > trainState->vmax[i]) {
+      trainState->vmax[i] = trainState->vector[i];
+    }
+  }
+  trainState->count += 1;
+}
+
+// scan the heap for sq8 vmin[dim] and vstep[dim], zeros for an empty table
+static float4 *
+HNSWTrainQuantizer(Relation heap, Relation index, IndexInfo *indexInfo,
+  HNSWOptions *opts) {
+  HNSWTrainState trainState;
+  float4 *params;
+  int i;
+
+  params = palloc0(2 * sizeof(float4) * opts->dim);
+  trainState.opts = opts;
+  trainState.vector = palloc(sizeof(float4) * opts->dim);
+  trainState.vmin = params;
+  trainState.vmax = palloc0(sizeof(float4) * opts->dim);
+  trainState.count = 0;
+  table_index_build_scan(heap, index, indexInfo, true, false,
+    HNSWTrainCallback, (void *) &trainState, NULL);
+  for (i = 0; i < opts->dim; ++i) {
+    params[opts->dim + i] = (trainState.vmax[i] - trainState.vmin[i]) / 255.0f;
+  }
+  elog(DEBUG1, "sq8 trained with %.0f vectors", trainState.count);
+  pfree(trainState.vector);
+  pfree(trainState.vmax);
+  return params;
+}
+
 static void
 HNSWBuildCallback(Relation index, ItemPointer tid, Datum *values,
   bool *isnull, bool tupleIsAlive, void *state) {
@@ -38,7 +94,7 @@ HNSWBuildCallback(Relation index, ItemPointer tid, Datum *values,
 
   buildState = (HNSWBuildState *) state;
   oldCtx = MemoryContextSwitchTo(buildState->tmpctx);
-  tup = HNSWFormDataTuple(&(buildState->opts), tid, values, isnull);
+  tup = HNSWFormDataTuple(index, &(buildState->opts), tid, values, isnull);
   if (!tup) {
     MemoryContextSwitchTo(oldCtx);
     MemoryContextReset(buildState->tmpctx);
@@ -71,6 +127,8 @@ hnsw_build(Relation heap, Relation index, IndexInfo *indexInfo) {
   HNSWBuildState buildState;
   HNSWBuildState *state;
   IndexBuildResult *result;
+  HNSWOptions *opts;
+  float4 *quantizerParams = NULL;
 
   srand((unsigned int)time(NULL));
 
@@ -79,7 +137,16 @@ hnsw_build(Relation heap, Relation index, IndexInfo *indexInfo) {
       RelationGetRelationName(index));
   }
 
-  HNSWInitMetapage(index);
+  // drop any metapage information cached for a previous build
+  if (index->rd_amcache) {
+    pfree(index->rd_amcache);
+    index->rd_amcache = NULL;
+  }
+  opts = (HNSWOptions *) index->rd_options;
+  if (opts && opts->quantizer == HNSW_QUANTIZER_SQ8) {
+    quantizerParams = HNSWTrainQuantizer(heap, index, indexInfo, opts);
+  }
+  HNSWInitMetapage(index, quantizerParams);
   memset(&buildState, 0, sizeof(buildState));
   InitHNSWBuildState(&buildState, index);
   buildState.tmpctx = AllocSetContextCreate(CurrentMemoryContext,
@@ -93,9 +160,10 @@ hnsw_build(Relation heap, Relation index, IndexInfo *indexInfo) {
   elog(DEBUG1, "final build blkid is %d", blkid);
 
   elog(DEBUG1, "build options, dim=[%d], base_nb_num=[%d], ef_build=[%d], "
-    "ef_search=[%d], base64_encoded=[%d]", buildState.opts.dim,
-    buildState.opts.base_nb_num, buildState.opts.ef_build,
-    buildState.opts.ef_search, buildState.opts.base64_encoded);
+    "ef_search=[%d], base64_encoded=[%d], quantizer=[%d], rerank=[%d]",
+    buildState.opts.dim, buildState.opts.base_nb_num, buildState.opts.ef_build,
+    buildState.opts.ef_search, buildState.opts.base64_encoded,
+    buildState.opts.quantizer, buildState.opts.rerank);
   if (buildState.indtuples < 0) {
     elog(ERROR, "no data to build!");
   } else if (buildState.indtuples > 0) {
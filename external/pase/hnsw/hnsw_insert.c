@@ -46,6 +46,8 @@ hnsw_insert(Relation index, Datum *values, bool *isnull,
   int32 dataPageBlkid = -1;
   int32 offsetInDataPage;
 
+  // sq8 parameters are read before the metapage is locked
+  HNSWGetCache(index);
   metaBuffer = ReadBuffer(index, HNSW_METAPAGE_BLKNO);
   LockBuffer(metaBuffer, BUFFER_LOCK_SHARE);
   meta = HNSWPageGetMeta(BufferGetPage(metaBuffer));
@@ -54,7 +56,7 @@ hnsw_insert(Relation index, Datum *values, bool *isnull,
 
 
   // add data
-  tup = HNSWFormDataTuple(&(state.opts), htCtid, values, isnull);
+  tup = HNSWFormDataTuple(index, &(state.opts), htCtid, values, isnull);
   if (!tup) {
     return false;
   }
@@ -105,6 +107,8 @@ HNSWBuildLink4Insert(Relation index, HNSWBuildState *state,
   float dNearest;
   PasePageList *list;
   HNSWVtable vtable;
+  const float4 *vector;
+  float4 vecbuf[HNSW_MAX_DIM];
   
   HVTInit(index->rd_indexcxt, &vtable);
   nbNum = opts->cum_nn_per_level[tup->level + 1];
@@ -124,12 +128,13 @@ HNSWBuildLink4Insert(Relation index, HNSWBuildState *state,
   }
 
   nearest = state->entry_gid;
-  dNearest = Distance(index, opts, tup->vector, nearest);
+  vector = HNSWDataTupleGetVector(index, opts, tup, vecbuf);
+  dNearest = Distance(index, opts, vector, nearest);
 
   level = GreedyUpdateNearest(index, opts, state->cur_max_level, tup->level,
-    &nearest, &dNearest, tup->vector);
+    &nearest, &dNearest, vector);
 
-  AddLinkFromHighToLow(index, state, nearest, dNearest, level, tup,
+  AddLinkFromHighToLow(index, state, nearest, dNearest, level, vector,
     gid, &vtable);
   if (tup->level > state->cur_max_level) {
     state->entry_gid = gid;
@@ -16,6 +16,8 @@
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "access/tableam.h"
+#include "executor/tuptable.h"
 #include "pgstat.h"
 #include "miscadmin.h"
 #include "storage/bufmgr.h"
@@ -25,6 +27,7 @@
 
 #include "pase.h"
 #include "utils/priority_queue.h"
+#include "utils/vector_util.h"
 
 static void HNSWSearch(Relation index, HNSWScanOpaque so, HNSWMetaPage meta,
   uint16 topk, float4 *queryVec); 
@@ -33,6 +36,11 @@ static void HNSWDoSearch(Relation index, HNSWOptions *opts, int ef,
   float *queryVec, HNSWGlobalId nearest, float dNearest, int level,
   PriorityQueue *result, HNSWVtable *vtable);
 
+static void RerankCandidates(IndexScanDesc scan, HNSWScanOpaque so,
+  HNSWOptions *opts);
+
+static HNSWPriorityQueueNode *PopSearchNode(HNSWScanOpaque so);
+
 IndexScanDesc
 hnsw_beginscan(Relation r, int nkeys, int norderbys) {
   IndexScanDesc scan;
@@ -47,6 +55,7 @@ hnsw_beginscan(Relation r, int nkeys, int norderbys) {
   so->scan_ctx = scanCtx;
   so->scan_pase = NULL;
   so->queue = NULL;
+  so->rerank_queue = NULL;
   so->first_call = true;
 
   if (scan->numberOfOrderBys > 0) {
@@ -73,10 +82,15 @@ hnsw_rescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
     PriorityQueueFree(so->queue); 
     so->queue = NULL;
   }
+  if (NULL != so->rerank_queue) {
+    PriorityQueueFree(so->rerank_queue);
+    so->rerank_queue = NULL;
+  }
 
   type = false; // nearest --> farthest
   so->scan_pase = NULL;
   so->queue = PriorityQueueAllocate(HNSWPriorityQueueCmp, &type);
+  so->rerank_queue = PriorityQueueAllocate(HNSWPriorityQueueCmp, &type);
   so->first_call = true;
 
   if (scankey && scan->numberOfKeys > 0) {
@@ -99,6 +113,7 @@ hnsw_gettuple(IndexScanDesc scan, ScanDirection dir) {
   Buffer metaBuffer;
   HNSWPriorityQueueNode* node;
   int extra;
+  uint16 topk;
 
   if (dir != ForwardScanDirection) {
     elog(ERROR, "hnsw only support forward scan direction");
@@ -116,6 +131,8 @@ hnsw_gettuple(IndexScanDesc scan, ScanDirection dir) {
   scan->xs_recheckorderby = false;
   if (so->first_call) {
     so->scan_pase = DatumGetPASE(scan->orderByData->sk_argument);
+    // sq8 parameters are read before the metapage is locked
+    HNSWGetCache(scan->indexRelation);
     metaBuffer = ReadBuffer(scan->indexRelation, HNSW_METAPAGE_BLKNO);
     LockBuffer(metaBuffer, BUFFER_LOCK_SHARE);
     meta = HNSWPageGetMeta(BufferGetPage(metaBuffer));
@@ -129,9 +146,16 @@ hnsw_gettuple(IndexScanDesc scan, ScanDirection dir) {
       meta->opts.ef_search = extra;
     }
     // try get all neighbors from index and return one result
-    HNSWSearch(scan->indexRelation, so, meta, meta->opts.ef_search, so->scan_pase->x);
-    if (!PriorityQueueIsEmpty(so->queue)) {
-      node = (HNSWPriorityQueueNode *)PriorityQueuePop(so->queue);
+    topk = meta->opts.ef_search;
+    if (meta->opts.quantizer && meta->opts.rerank > topk) {
+      topk = meta->opts.rerank;
+    }
+    HNSWSearch(scan->indexRelation, so, meta, topk, so->scan_pase->x);
+    if (meta->opts.quantizer && meta->opts.rerank > 0) {
+      RerankCandidates(scan, so, &meta->opts);
+    }
+    node = PopSearchNode(so);
+    if (node) {
       FindItDataByOffset(scan->indexRelation, so->data_tup_size,
         node->gid, &itData);
       scan->xs_heaptid = itData;
@@ -145,8 +169,8 @@ hnsw_gettuple(IndexScanDesc scan, ScanDirection dir) {
     UnlockReleaseBuffer(metaBuffer);
   } else {
     // return one reslut from existed results
-    if (!PriorityQueueIsEmpty(so->queue)) {
-      node = (HNSWPriorityQueueNode *)PriorityQueuePop(so->queue);
+    node = PopSearchNode(so);
+    if (node) {
       FindItDataByOffset(scan->indexRelation, so->data_tup_size,
         node->gid, &itData);
       scan->xs_heaptid = itData;
@@ -169,6 +193,9 @@ hnsw_endscan(IndexScanDesc scan) {
 
   if (NULL != so) {
     PriorityQueueFree(so->queue);
+    if (NULL != so->rerank_queue) {
+      PriorityQueueFree(so->rerank_queue);
+    }
     if (so->scan_ctx) {
       MemoryContextDelete(so->scan_ctx);
     }
@@ -279,3 +306,76 @@ HNSWDoSearch(Relation index, HNSWOptions *opts, int ef, float *queryVec,
   }
   PriorityQueueFree(candidates);
 }
+
+// Re-rank the nearest candidates by the exact vectors of their heap tuples,
+// quantized distances only pick the candidates.
+static void
+RerankCandidates(IndexScanDesc scan, HNSWScanOpaque so, HNSWOptions *opts) {
+  Relation              heap;
+  AttrNumber            attno;
+  IndexFetchTableData   *fetch;
+  TupleTableSlot        *slot;
+  MemoryContext         tmpCtx, oldCtx;
+  HNSWPriorityQueueNode *node;
+  float4                *vector;
+  int                   i;
+
+  heap = scan->heapRelation;
+  attno = scan->indexRelation->rd_index->indkey.values[0];
+  // expression index has no heap column to read the vector from
+  if (heap == NULL || attno == InvalidAttrNumber) {
+    return;
+  }
+
+  vector = (float4 *) palloc(sizeof(float4) * opts->dim);
+  fetch = table_index_fetch_begin(heap);
+  slot = table_slot_create(heap, NULL);
+  tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+      "hnsw rerank temporary context",
+      ALLOCSET_DEFAULT_SIZES);
+
+  for (i = 0; i < opts->rerank; ++i) {
+    ItemPointerData tid;
+    bool            callAgain = false;
+    bool            allDead = false;
+
+    if (PriorityQueueIsEmpty(so->queue)) {
+      break;
+    }
+    node = (HNSWPriorityQueueNode *) PriorityQueuePop(so->queue);
+    FindItDataByOffset(scan->indexRelation, so->data_tup_size, node->gid,
+        &tid);
+
+    // invisible tuple keeps its quantized distance, executor skips it
+    oldCtx = MemoryContextSwitchTo(tmpCtx);
+    if (table_index_fetch_tuple(fetch, &tid, scan->xs_snapshot, slot,
+          &callAgain, &allDead)) {
+      bool  isnull;
+      Datum value = slot_getattr(slot, attno, &isnull);
+
+      if (!isnull && HNSWGetVector(opts, value, vector) == opts->dim) {
+        node->distance = fvec_L2sqr(so->scan_pase->x, vector, opts->dim);
+      }
+    }
+    MemoryContextSwitchTo(oldCtx);
+    MemoryContextReset(tmpCtx);
+    PriorityQueueAdd(so->rerank_queue, (PriorityQueueNode *) node);
+  }
+
+  ExecDropSingleTupleTableSlot(slot);
+  table_index_fetch_end(fetch);
+  MemoryContextDelete(tmpCtx);
+  pfree(vector);
+}
+
+// Pop the nearest candidate, re-ranked ones go first
+static HNSWPriorityQueueNode *
+PopSearchNode(HNSWScanOpaque so) {
+  if (!PriorityQueueIsEmpty(so->rerank_queue)) {
+    return (HNSWPriorityQueueNode *) PriorityQueuePop(so->rerank_queue);
+  }
+  if (!PriorityQueueIsEmpty(so->queue)) {
+    return (HNSWPriorityQueueNode *) PriorityQueuePop(so->queue);
+  }
+  return NULL;
+}
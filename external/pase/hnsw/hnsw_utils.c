@@ -55,9 +55,61 @@ MakeDefaultHNSWOptions() {
   opts->ef_build = 40;
   opts->ef_search = 50;
   opts->base64_encoded = 0;
+  opts->quantizer = HNSW_QUANTIZER_NONE;
+  opts->rerank = 0;
   return opts;
 }
 
+Size
+HNSWDataTupleSize(HNSWOptions *opts) {
+  if (opts->quantizer == HNSW_QUANTIZER_SQ8) {
+    return HNSWDATATUPLEHDRSZ + TYPEALIGN(sizeof(float4), opts->dim);
+  }
+  return HNSWDATATUPLEHDRSZ + sizeof(float4) * opts->dim;
+}
+
+static HNSWCacheData *
+HNSWLoadCache(Relation index, HNSWMetaPageData *meta) {
+  HNSWCacheData *cache;
+  int nparams = 0;
+
+  if (meta->opts.quantizer == HNSW_QUANTIZER_SQ8) {
+    nparams = 2 * meta->opts.dim;
+  }
+  cache = MemoryContextAlloc(index->rd_indexcxt,
+    offsetof(HNSWCacheData, params) + sizeof(float4) * nparams);
+  cache->opts = meta->opts;
+  cache->opts.nb_tup_size = sizeof(HNSWNeighborTuple);
+  cache->opts.data_tup_size = HNSWDataTupleSize(&cache->opts);
+  if (nparams > 0) {
+    memcpy(cache->params, HNSWMetaPageGetQuantizer(meta),
+      sizeof(float4) * nparams);
+  }
+  index->rd_amcache = (void *)cache;
+  return cache;
+}
+
+// metapage information of index, read once and kept in relcache
+HNSWCacheData *
+HNSWGetCache(Relation index) {
+  Buffer buffer;
+  HNSWMetaPageData *meta;
+  HNSWCacheData *cache;
+
+  if (index->rd_amcache) {
+    return (HNSWCacheData *) index->rd_amcache;
+  }
+  buffer = ReadBuffer(index, HNSW_METAPAGE_BLKNO);
+  LockBuffer(buffer, BUFFER_LOCK_SHARE);
+  meta = HNSWPageGetMeta(BufferGetPage(buffer));
+  if (meta->magick_num != HNSW_MAGICK_NUMBER) {
+    elog(ERROR, "Relation is not a hnsw index");
+  }
+  cache = HNSWLoadCache(index, meta);
+  UnlockReleaseBuffer(buffer);
+  return cache;
+}
+
 int
 HNSWFlushCachedPage(Relation index, HNSWBuildState *buildState) {
   Page page;
@@ -74,9 +126,10 @@ HNSWFlushCachedPage(Relation index, HNSWBuildState *buildState) {
   return blkid;
 }
 
-// it must be called by build at first time
+// it must be called by build at first time, quantizerParams holds the sq8
+// vmin and vstep of every dimension
 void
-HNSWInitMetapage(Relation index) {
+HNSWInitMetapage(Relation index, const float4 *quantizerParams) {
   Buffer metaBuffer;
   Page metaPage;
   GenericXLogState *state;
@@ -104,6 +157,12 @@ HNSWInitMetapage(Relation index) {
   metadata->last_data_blkid = -1;
   metadata->opts = *opts;
   ((PageHeader) metaPage)->pd_lower += sizeof(HNSWMetaPageData);
+  if (opts->quantizer == HNSW_QUANTIZER_SQ8) {
+    memcpy(HNSWMetaPageGetQuantizer(metadata), quantizerParams,
+      2 * sizeof(float4) * opts->dim);
+    ((PageHeader) metaPage)->pd_lower =
+      (Pointer) (HNSWMetaPageGetQuantizer(metadata) + 2 * opts->dim) - metaPage;
+  }
   Assert(((PageHeader) metaPage)->pd_lower <= ((PageHeader) metaPage)->pd_upper);
 
   GenericXLogFinish(state);
@@ -141,21 +200,16 @@ void
 InitHNSWBuildState(HNSWBuildState *state, Relation index) {
   Buffer buffer;
   HNSWMetaPageData *meta;
-  HNSWOptions *opts;
 
   memset(state, 0, sizeof(HNSWBuildState));
   if (!index->rd_amcache) {
-    opts = MemoryContextAlloc(index->rd_indexcxt, sizeof(HNSWOptions));
     buffer = ReadBuffer(index, HNSW_METAPAGE_BLKNO);
     LockBuffer(buffer, BUFFER_LOCK_SHARE);
     meta = HNSWPageGetMeta(BufferGetPage(buffer));
     if (meta->magick_num != HNSW_MAGICK_NUMBER) {
       elog(ERROR, "Relation is not a hnsw index");
     }
-    *opts = meta->opts;
-    opts->nb_tup_size = sizeof(HNSWNeighborTuple);
-    opts->data_tup_size = HNSWDATATUPLEHDRSZ + sizeof(float4) * opts->dim;
-    index->rd_amcache = (void *)opts;
+    HNSWLoadCache(index, meta);
     state->entry_gid = meta->entry_gid;
     UnlockReleaseBuffer(buffer);
   }
@@ -199,9 +253,12 @@ HNSWBuildLink(Relation index, HNSWBuildState *state) {
   MemoryContext oldctx;
   HNSWVtable vtable;
   PasePageList *dtlist;
+  const float4 *vector;
+  float4 *vecbuf;
 
   t0 = elapsed();
   HVTInit(index->rd_indexcxt, &vtable);
+  vecbuf = palloc(sizeof(float4) * state->opts.dim);
 
   dtlist = InitPasePageListByNo(index,
     state->data_entry_blkid, state->opts.data_tup_size,
@@ -229,12 +286,12 @@ HNSWBuildLink(Relation index, HNSWBuildState *state) {
       continue;
     }
     nearest = state->entry_gid;
-    dNearest = Distance(index, &(state->opts), tup->vector,
-      nearest);
+    vector = HNSWDataTupleGetVector(index, &(state->opts), tup, vecbuf);
+    dNearest = Distance(index, &(state->opts), vector, nearest);
     level = GreedyUpdateNearest(index, &state->opts, state->cur_max_level,
-      tup->level, &nearest, &dNearest, tup->vector);
+      tup->level, &nearest, &dNearest, vector);
     AddLinkFromHighToLow(index, state, nearest, dNearest, level,
-      tup, gid, &vtable);
+      vector, gid, &vtable);
     if (tup->level > state->cur_max_level) {
       state->entry_gid = gid;
       state->cur_max_level = tup->level;
@@ -248,62 +305,105 @@ HNSWBuildLink(Relation index, HNSWBuildState *state) {
     MemoryContextReset(state->tmpctx);
   }
   pfree(dtlist);
+  pfree(vecbuf);
   HVTFree(&vtable);
   elog(NOTICE, "build count: %d, total use time: [%f], distance fun calls %d",
     count, elapsed() - t0, scount);
 }
 
-HNSWDataTuple *
-HNSWFormDataTuple(HNSWOptions *opts,
-  ItemPointer iptr, Datum *values, bool *isnull) {
+// parse the vector of an index column value, return its dimension; it is
+// copied into vector only when the dimension matches
+int
+HNSWGetVector(HNSWOptions *opts, Datum value, float4 *vector) {
   ArrayType *arr;
   text *rawText;
-  int dim, i, len;
-  float4 *data;
+  int dim, len;
   char *rawData;
   char dest[1024 * 1024];
-  HNSWDataTuple *res = (HNSWDataTuple *) palloc(opts->data_tup_size);
 
-  res->heap_ptr = *iptr;
-  if (isnull[0]) {
-    pfree(res);
-    return NULL;
-  }
-  
   if (opts->base64_encoded) {
-    rawText = DatumGetTextPP(values[0]);
+    rawText = DatumGetTextPP(value);
     rawData = VARDATA_ANY(rawText);
     len = VARSIZE_ANY_EXHDR(rawText);
 
     memset(dest, 0, sizeof(dest));
     dim = pg_b64_decode(rawData, len, dest, pg_b64_dec_len(strlen(rawData))) / sizeof(float4);
-    if (dim != opts->dim) {
-      elog(WARNING, "data dimension[%d] not equal to configure dimension[%d]",
-        dim, opts->dim);
-      pfree(res);
-      return NULL;
-    }
-    for (i = 0; i < dim; ++i) {
-      res->vector[i] = ((float4*)dest)[i];
+    if (dim == opts->dim) {
+      memcpy(vector, dest, sizeof(float4) * dim);
     }
   } else {
-    arr = DatumGetArrayTypeP(values[0]);
+    arr = DatumGetArrayTypeP(value);
     dim = PASE_ARRNELEMS(arr);
-    if (dim != opts->dim) {
-      elog(WARNING, "data dimension[%d] not equal to configure dimension[%d]",
-        dim, opts->dim);
-      pfree(res);
-      return NULL;
+    if (dim == opts->dim) {
+      memcpy(vector, PASE_ARRPTR(arr), sizeof(float4) * dim);
     }
-    data = PASE_ARRPTR(arr);
+  }
+  return dim;
+}
+
+HNSWDataTuple *
+HNSWFormDataTuple(Relation index, HNSWOptions *opts,
+  ItemPointer iptr, Datum *values, bool *isnull) {
+  int dim, i;
+  float4 *vector;
+  const float4 *vmin, *vstep;
+  uint8 *code;
+  float4 v;
+  HNSWDataTuple *res = (HNSWDataTuple *) palloc0(opts->data_tup_size);
+
+  res->heap_ptr = *iptr;
+  if (isnull[0]) {
+    pfree(res);
+    return NULL;
+  }
+
+  vector = opts->quantizer == HNSW_QUANTIZER_SQ8 ?
+    palloc(sizeof(float4) * opts->dim) : res->vector;
+  dim = HNSWGetVector(opts, values[0], vector);
+  if (dim != opts->dim) {
+    elog(WARNING, "data dimension[%d] not equal to configure dimension[%d]",
+      dim, opts->dim);
+    pfree(res);
+    return NULL;
+  }
+  if (opts->quantizer == HNSW_QUANTIZER_SQ8) {
+    vmin = HNSWGetCache(index)->params;
+    vstep = vmin + opts->dim;
+    code = HNSWDataTupleGetCode(res);
     for (i = 0; i < opts->dim; ++i) {
-      res->vector[i] = data[i];
+      if (vstep[i] <= 0) {
+        code[i] = 0;
+        continue;
+      }
+      v = rint((vector[i] - vmin[i]) / vstep[i]);
+      code[i] = v < 0 ? 0 : (v > 255 ? 255 : (uint8) v);
     }
+    pfree(vector);
   }
   res->level = RandomLevel(opts);
   return res;
 }
 
+// vector of a data tuple, sq8 codes are decoded into buf
+const float4 *
+HNSWDataTupleGetVector(Relation index, HNSWOptions *opts, HNSWDataTuple *tup,
+  float4 *buf) {
+  const float4 *vmin, *vstep;
+  const uint8 *code;
+  int i;
+
+  if (opts->quantizer != HNSW_QUANTIZER_SQ8) {
+    return tup->vector;
+  }
+  vmin = HNSWGetCache(index)->params;
+  vstep = vmin + opts->dim;
+  code = HNSWDataTupleGetCode(tup);
+  for (i = 0; i < opts->dim; ++i) {
+    buf[i] = vmin[i] + code[i] * vstep[i];
+  }
+  return buf;
+}
+
 bool
 HNSWDataPageAddItem(HNSWBuildState *state, Page page, HNSWDataTuple *tuple) {
   HNSWDataTuple *tup;
@@ -368,7 +468,7 @@ GreedyUpdateNearest(Relation index, HNSWOptions *opts, int32 maxLevel, int level
 void
 SearchNbToAdd(Relation index, HNSWOptions *opts, int level, HNSWGlobalId nearest,
   float dNearest, PriorityQueue *results, HNSWVtable *vtable,
-  HNSWDataTuple *dtTup) {
+  const float4 *vector) {
   // top is nearest candidate
   bool type = false; // nearest --> farthest
   PriorityQueue *candidates = PriorityQueueAllocate(HNSWPriorityQueueCmp, &type);
@@ -411,7 +511,7 @@ SearchNbToAdd(Relation index, HNSWOptions *opts, int level, HNSWGlobalId nearest
         continue;
       }
       HVTSet(vtable, tup->gid);
-      dis = Distance(index, opts, dtTup->vector, tup->gid);
+      dis = Distance(index, opts, vector, tup->gid);
       if (PriorityQueueSize(results) < opts->ef_build || node1->distance > dis) {
         ADD_HNSW_PQ_NODE(candidates, tup->gid, dis);
         ADD_HNSW_PQ_NODE(results, tup->gid, dis);
@@ -484,7 +584,7 @@ ShrinkNbList(Relation index, HNSWBuildState *state, int level,
 
 void
 AddLinkFromHighToLow(Relation index, HNSWBuildState *state, HNSWGlobalId nearest,
-  float dNearest, int level, HNSWDataTuple *tup, HNSWGlobalId sourceid,
+  float dNearest, int level, const float4 *vector, HNSWGlobalId sourceid,
   HNSWVtable *vtable) {
   float qdis;
   int cur;
@@ -497,7 +597,7 @@ AddLinkFromHighToLow(Relation index, HNSWBuildState *state, HNSWGlobalId nearest
     linkTargets = PriorityQueueAllocate(HNSWPriorityQueueCmp, &type);
 
     SearchNbToAdd(index, &(state->opts), cur, nearest, dNearest, linkTargets,
-      vtable, tup);
+      vtable, vector);
     ShrinkNbList(index, state, cur, &linkTargets);
 
     while (!PriorityQueueIsEmpty(linkTargets)) {
@@ -658,6 +758,7 @@ Distance(Relation index, HNSWOptions *opts,
   Page page;
   int maxOffset, offset;
   HNSWDataTuple *tup; 
+  const float4 *params;
 
   scount++;
   buffer = ReadBuffer(index, gid.dblkid);
@@ -670,7 +771,13 @@ Distance(Relation index, HNSWOptions *opts,
       offset, maxOffset);
   }
   tup = HNSWDataPageGetTuple(opts->data_tup_size, page, offset);
-  distance = fvec_L2sqr(vector, tup->vector, opts->dim);
+  if (opts->quantizer == HNSW_QUANTIZER_SQ8) {
+    params = HNSWGetCache(index)->params;
+    distance = fvec_L2sqr_sq8(vector, HNSWDataTupleGetCode(tup), params,
+      params + opts->dim, opts->dim);
+  } else {
+    distance = fvec_L2sqr(vector, tup->vector, opts->dim);
+  }
   UnlockReleaseBuffer(buffer);
   return distance;
 }
@@ -681,9 +788,8 @@ Distance2(Relation index, HNSWOptions *opts, HNSWGlobalId gid1, HNSWGlobalId gid
   Buffer buffer;
   Page page;
   int maxOffset, offset;
-  HNSWDataTuple *tup1, *tup2; 
-
-  scount++;
+  HNSWDataTuple *tup1;
+  float4 vector[HNSW_MAX_DIM];
 
   buffer = ReadBuffer(index, gid1.dblkid);
   LockBuffer(buffer, BUFFER_LOCK_SHARE);
@@ -694,21 +800,16 @@ Distance2(Relation index, HNSWOptions *opts, HNSWGlobalId gid1, HNSWGlobalId gid
     elog(ERROR, "Distance2:invalid entry offset 1 offset[%d] maxOffset[%d]",
       offset, maxOffset);
   }
-  UnlockReleaseBuffer(buffer);
+  // copy the first vector out before its buffer is released
   tup1 = HNSWDataPageGetTuple(opts->data_tup_size, page, offset);
-
-  buffer = ReadBuffer(index, gid2.dblkid);
-  LockBuffer(buffer, BUFFER_LOCK_SHARE);
-  page = BufferGetPage(buffer);
-  maxOffset = HNSWDataPageGetMaxOffset(page);
-  offset = gid2.doffset;
-  if (offset > maxOffset) {
-    elog(ERROR, "Distance2:invalid entry offset 2 offset[%d] maxOffset[%d]",
-      offset, maxOffset);
+  if (opts->quantizer == HNSW_QUANTIZER_SQ8) {
+    HNSWDataTupleGetVector(index, opts, tup1, vector);
+  } else {
+    memcpy(vector, tup1->vector, sizeof(float4) * opts->dim);
   }
-  tup2 = HNSWDataPageGetTuple(opts->data_tup_size, page, offset);
-  distance = fvec_L2sqr(tup1->vector, tup2->vector, opts->dim);
   UnlockReleaseBuffer(buffer);
+
+  distance = Distance(index, opts, vector, gid2);
   return distance;
 }
 
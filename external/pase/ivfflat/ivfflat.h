@@ -49,6 +49,9 @@ typedef struct IvfflatOptions {
   int    omp_thread_num;            // omp thread number
   int    base64_encoded;            // data whether base64 encoded
   int	   clustering_params_offset;  // clustering parameters offset
+  int    quantizer;                 // vector storage: 0 float, 1 sq8, 2 pq
+  int    pq_m;                      // pq sub-vector count, 0 picks dimension / 4
+  int    rerank;                    // candidates re-ranked with heap vectors, 0 off
 } IvfflatOptions;
 
 // Metadata of ivfflat index
@@ -59,15 +62,38 @@ typedef struct IvfflatMetaPageData
   BlockNumber centroid_head_blkno;
   BlockNumber centroid_page_count;
   IvfflatOptions opts;
+  BlockNumber quantizer_head_blkno;
+  BlockNumber quantizer_page_count;
 } IvfflatMetaPageData;
 
+// Trained quantizer of the inverted list vectors
+typedef struct IvfflatQuantizer {
+  int    type;                      // IVFFLAT_QUANTIZER_SQ8 or IVFFLAT_QUANTIZER_PQ
+  int    dim;                       // vector dimension
+  int    m;                         // pq sub-vector count
+  int    dsub;                      // pq sub-vector dimension
+  int    nparams;                   // number of floats in params
+  float4 *params;                   // sq8: vmin[dim] and vstep[dim],
+                                    // pq: m * IVFFLAT_PQ_KSUB centroids of dsub
+} IvfflatQuantizer;
+
 typedef struct IvfflatState {
   IvfflatOptions opts;			// copy of options on index's metapage
   int32          nColumns;
   Size           size_of_centroid_tuple;
-  Size           size_of_invertedlist_tuple;
+  Size           size_of_invertedlist_tuple;  // tuple on inverted list pages
+  Size           size_of_float_tuple;         // tuple before it is quantized
+  IvfflatQuantizer *quantizer;                // NULL for float storage
 } IvfflatState;
 
+// Metapage information cached in rd_amcache, one chunk so that relcache
+// can free it
+typedef struct IvfflatCacheData {
+  IvfflatOptions   opts;
+  IvfflatQuantizer quantizer;
+  float4           params[FLEXIBLE_ARRAY_MEMBER];
+} IvfflatCacheData;
+
 // Tuple for centroid
 typedef struct CentroidTuple {
   BlockNumber     head_ivl_blkno;
@@ -110,6 +136,7 @@ typedef struct IvfflatScanOpaqueData {
   PASE *scan_pase;
   MemoryContext scan_ctx;
   pairingheap *queue;
+  pairingheap *rerank_queue;  // candidates with exact distances, popped first
   IvfflatState state; 
   bool first_call;
 } IvfflatScanOpaqueData;
@@ -128,6 +155,25 @@ typedef IvfflatScanOpaqueData *IvfflatScanOpaque;
 #define DEFAULT_SCAN_RATIO          20
 #define MAX_SCAN_RATION             1000
 #define MAX_CLUSTERING_SAMPLE_RATIO 1000
+// tuples whose centroids are searched together during build
+#define IVFFLAT_BUILD_BATCH_SIZE    8192
+
+// build phases reported in pg_stat_progress_create_index,
+// 1 is PROGRESS_CREATEIDX_SUBPHASE_INITIALIZE
+#define PROGRESS_IVFFLAT_PHASE_KMEANS 2
+#define PROGRESS_IVFFLAT_PHASE_ASSIGN 3
+#define PROGRESS_IVFFLAT_PHASE_WRITE  4
+
+// vector storage of inverted lists
+#define IVFFLAT_QUANTIZER_NONE 0
+#define IVFFLAT_QUANTIZER_SQ8  1
+#define IVFFLAT_QUANTIZER_PQ   2
+// centroids of each pq sub-vector, codes are one byte
+#define IVFFLAT_PQ_KSUB            256
+// sample vectors used to train the pq codebooks
+#define IVFFLAT_PQ_MAX_TRAIN_COUNT (IVFFLAT_PQ_KSUB * 256)
+#define IVFFLAT_MAX_DIMENSION      1024
+#define IVFFLAT_MAX_RERANK         100000
 
 // Macros for accessing ivfflat page structures
 #define IvfflatPageGetOpaque(_page) ((IvfflatPageOpaque) PageGetSpecialPointer(_page))
@@ -155,7 +201,9 @@ typedef IvfflatScanOpaqueData *IvfflatScanOpaque;
     + (_state)->size_of_invertedlist_tuple * ((_offset) - 1)))
 #define InvertedListPageGetNextTuple(_state, _tuple) \
   ((InvertedListTuple *)((Pointer)(_tuple) + (_state)->size_of_invertedlist_tuple))
+#define InvertedListTupleGetCode(_tuple) ((uint8 *)(_tuple)->vector)
 #define IvfflatPageGetMeta(_page) ((IvfflatMetaPageData *) PageGetContents(_page))
+#define QuantizerPageGetData(_page) ((float4 *)PageGetContents(_page))
 
 // Preserved page numbers
 #define IVFFLAT_METAPAGE_BLKNO	(0)
@@ -177,6 +225,10 @@ typedef IvfflatScanOpaqueData *IvfflatScanOpaque;
    - IvfflatPageGetMaxOffset(_page) * (_state)->size_of_invertedlist_tuple \
    - MAXALIGN(sizeof(IvfflatPageOpaqueData)))
 
+#define QUANTIZER_PAGE_FLOATS \
+  ((BLCKSZ - MAXALIGN(SizeOfPageHeaderData) \
+    - MAXALIGN(sizeof(IvfflatPageOpaqueData))) / sizeof(float4))
+
 #define CENTROIDTUPLEHDRSZ offsetof(CentroidTuple, vector)
 #define INVERTEDLISTTUPLEHDRSZ offsetof(InvertedListTuple, vector)
 
@@ -192,6 +244,8 @@ extern bool IvfflatPageAddItem(IvfflatState *state, Page page,
     InvertedListTuple *tuple);
 extern void FlushBufferPage(Relation index, Buffer buffer, bool needUnLock);
 extern bytea *ivfflat_options(Datum reloptions, bool validate);
+extern int IvfflatBuildThreadNum(IvfflatOptions *opts);
+extern char *ivfflat_buildphasename(int64 phasenum);
 extern float SearchNNFromCentroids(IvfflatState *state, InvertedListTuple *tuple,
     Centroids centroids, int *minPos);
 extern int PairingHeapCentroidCompare(const pairingheap_node *a,
@@ -201,7 +255,27 @@ extern void SearchKNNInvertedListFromCentroidPages(
     IvfflatMetaPageData *meta, float4 *tuple_vector,
     int count, bool reverse, CentroidSearchItem *items, bool isScan);
 
+// ivfflat_quantizer.c
+extern int IvfflatQuantizerSubvectors(IvfflatOptions *opts);
+extern Size IvfflatQuantizerCodeSize(IvfflatOptions *opts);
+extern int IvfflatQuantizerParamCount(IvfflatOptions *opts);
+extern void IvfflatTrainQuantizer(IvfflatQuantizer *quantizer,
+    IvfflatOptions *opts, float4 *samples, int count, int nthreads);
+extern void IvfflatQuantizerEncode(IvfflatQuantizer *quantizer,
+    const float4 *vector, uint8 *code);
+extern void IvfflatEncodeTuple(IvfflatState *state, InvertedListTuple *tuple);
+extern float4 *IvfflatQuantizerTable(IvfflatQuantizer *quantizer,
+    const float4 *query);
+extern float IvfflatQuantizerDistance(IvfflatQuantizer *quantizer,
+    const float4 *query, const float4 *table, const uint8 *code);
+extern void IvfflatWriteQuantizerPages(Relation index,
+    IvfflatQuantizer *quantizer);
+extern void IvfflatReadQuantizerPages(Relation index,
+    IvfflatMetaPageData *meta, IvfflatQuantizer *quantizer);
+
 // ivfflat_build.c
+extern bool GetVectorFromDatum(IvfflatState *state, Datum value,
+    float4 *vector);
 extern IndexBuildResult *ivfflat_build(Relation heap, Relation index, IndexInfo *indexInfo);
 extern bool ivfflat_insert(Relation index, Datum *values, bool *isnull,
     ItemPointer ht_ctid, Relation heapRel,
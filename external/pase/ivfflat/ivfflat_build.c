@@ -29,7 +29,9 @@
 #include "utils/varlena.h"
 #include "access/stratnum.h"
 #include "access/tableam.h"
+#include "commands/progress.h"
 #include "common/base64.h"
+#include "pgstat.h"
 
 #include "utils/string_util.h"
 #include "ivfflat.h"
@@ -59,8 +61,17 @@ typedef struct {
   int    clustering_sample_ratio;    // clustering_sample_ratio: sample ratio for clustering, just for clustering type 1
   int            k;                  // k: cluster count
   Clustering     clustering;         // clustering data for clustering
+  int            nthreads;           // omp threads for the numeric work
+  char           *batch;             // tuples waiting for their inverted lists
+  int            *batch_pos;         // nearest centroid of the batched tuples
+  int            batch_count;        // number of batched tuples
+  IvfflatQuantizer quantizer;        // trained quantizer of quantized storage
 } IvfflatBuildState;
 
+#define BuildBatchGetTuple(_buildState, _offset) \
+  ((InvertedListTuple *)((_buildState)->batch + \
+    (_offset) * (_buildState)->ivf_state.size_of_float_tuple))
+
 //Initialize centroids data 
 static bool
 InitCentroids(IvfflatBuildState *buildState) {
@@ -230,16 +241,12 @@ InvertedListPageAddItem(IvfflatState *state, Page page,
 
 static bool
 AddTupleToInvertedList(Relation index, IvfflatBuildState *buildState,
-    InvertedListTuple *tuple) {
-  int     minPos;
+    InvertedListTuple *tuple, int minPos) {
   Page    page;
   Buffer  buffer, newBuffer;
 
   newBuffer = 0;
-  minPos = 0;
 
-  SearchNNFromCentroids(&(buildState->ivf_state), tuple,
-      &(buildState->centroids), &minPos);
   if (minPos >= buildState->centroids.count) {
     elog(WARNING, "min pos[%d] error", minPos);
     return false;
@@ -298,6 +305,7 @@ AddTupleToInvertedListForInsert(Relation index, IvfflatState *state,
     elog(WARNING, "insert item failed");
     return false;
   }
+  IvfflatEncodeTuple(state, tuple);
   if (items[0].head_ivl_blkno == 0) {
     // first item in invertedlist
     page = CreateNewInvertedListPage(index, tuple, &buffer, true);
@@ -320,7 +328,7 @@ AddTupleToInvertedListForInsert(Relation index, IvfflatState *state,
 
 #undef CENTROID_HEAD_BLKNO_UPDATE
 
-static bool
+bool
 GetVectorFromDatum(IvfflatState *state, Datum value,
     float4 *vector) {
   ArrayType *arr;
@@ -367,7 +375,7 @@ InvertedListFormTuple(IvfflatState *state, ItemPointer iptr,
     Datum *values, bool *isnull) {
   InvertedListTuple *res;
 
-  res = (InvertedListTuple *) palloc0(state->size_of_invertedlist_tuple);
+  res = (InvertedListTuple *) palloc0(state->size_of_float_tuple);
   res->heap_ptr = *iptr;
   if (isnull[0]) {
     elog(WARNING, "vector colum is null");
@@ -485,6 +493,41 @@ IvfflatCentroidsBuildCallback(Relation index, ItemPointer tid, Datum *values,
   buildState->clustering->count ++;
 }
 
+// Add the batched tuples to their inverted lists.  Searching the nearest
+// centroid and quantizing is pure numeric work and is split between omp
+// threads, pages are only touched by this backend.
+static void
+FlushBuildBatch(Relation index, IvfflatBuildState *buildState) {
+  int i;
+
+#pragma omp parallel for if (buildState->nthreads > 1) num_threads(buildState->nthreads) schedule(static)
+  for (i = 0; i < buildState->batch_count; ++i) {
+    SearchNNFromCentroids(&(buildState->ivf_state),
+        BuildBatchGetTuple(buildState, i), &(buildState->centroids),
+        &buildState->batch_pos[i]);
+    IvfflatEncodeTuple(&(buildState->ivf_state),
+        BuildBatchGetTuple(buildState, i));
+  }
+
+  for (i = 0; i < buildState->batch_count; ++i) {
+    if (!AddTupleToInvertedList(index, buildState,
+          BuildBatchGetTuple(buildState, i), buildState->batch_pos[i])) {
+      elog(WARNING, "add tuple to inverted list failed");
+      continue;
+    }
+
+    // Update total tuple count
+    buildState->ind_tuples += 1;
+    if (buildState->ind_tuples % 100000 == 0) {
+      elog(NOTICE, "build tuple count[%ld]", buildState->ind_tuples);
+    }
+  }
+
+  buildState->batch_count = 0;
+  pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_DONE,
+      buildState->ind_tuples);
+}
+
 // Per-tuple callback from IndexBuildHeapScan.
 static void
 IvfflatBuildCallback(Relation index, ItemPointer tid, Datum *values,
@@ -506,20 +549,14 @@ IvfflatBuildCallback(Relation index, ItemPointer tid, Datum *values,
     return;
   }
 
-  if (!AddTupleToInvertedList(index, buildState, itup)) {
-    elog(WARNING, "add tuple to inverted list failed");
-    MemoryContextSwitchTo(oldCtx);
-    MemoryContextReset(buildState->tmp_ctx);
-    return;
-  }
-
-  // Update total tuple count
-  buildState->ind_tuples += 1;
-  if (buildState->ind_tuples % 100000 == 0) {
-    elog(NOTICE, "build tuple count[%ld]", buildState->ind_tuples);
-  }
+  memcpy(BuildBatchGetTuple(buildState, buildState->batch_count), itup,
+      buildState->ivf_state.size_of_float_tuple);
+  buildState->batch_count ++;
   MemoryContextSwitchTo(oldCtx);
   MemoryContextReset(buildState->tmp_ctx);
+
+  if (buildState->batch_count >= IVFFLAT_BUILD_BATCH_SIZE)
+    FlushBuildBatch(index, buildState);
 }
 
 // parse parameters from clustering options
@@ -574,6 +611,7 @@ ivfflat_build(Relation heap, Relation index, IndexInfo *indexInfo) {
   IvfflatBuildState    buildState;
   IvfflatOptions       *opts;
   int                  i, maxCount;
+  bool                 sampling;
   MemoryContext        oldCtx;
   double               beginTime, centroidDoneTime, indexDoneTime;
 
@@ -603,8 +641,22 @@ ivfflat_build(Relation heap, Relation index, IndexInfo *indexInfo) {
     elog(ERROR, "ivfflat index must be created with necessary parameters");
   }
 
+  if (opts->quantizer == IVFFLAT_QUANTIZER_PQ &&
+      opts->dimension % IvfflatQuantizerSubvectors(opts) != 0) {
+    elog(ERROR, "pq_m[%d] should divide dimension[%d]",
+        opts->pq_m, opts->dimension);
+  }
+
+  buildState.nthreads = IvfflatBuildThreadNum(opts);
+
+  // inner clustering and quantizers are trained from sampled vectors
+  sampling = opts->clustering_type == 1 ||
+    opts->quantizer != IVFFLAT_QUANTIZER_NONE;
+
   beginTime = elapsed();
-  if (opts->clustering_type == 1) {
+  if (sampling) {
+    pgstat_progress_update_param(PROGRESS_CREATEIDX_SUBPHASE,
+        PROGRESS_IVFFLAT_PHASE_KMEANS);
     maxCount = MAX_CLUSTERING_SAMPLE_COUNT;
     if (MAX_CLUSTERING_SAMPLE_COUNT * opts->dimension * sizeof(float4) >
         MAX_CLUSTERING_MEM) {
@@ -612,8 +664,11 @@ ivfflat_build(Relation heap, Relation index, IndexInfo *indexInfo) {
           (int)(MAX_CLUSTERING_MEM / (opts->dimension * sizeof(float4))));
       maxCount = MAX_CLUSTERING_MEM / (opts->dimension * sizeof(float4));
     }
-    // Do the heap scan for training centroids
-    ParseClusteringParams(opts, &buildState);
+    // Do the heap scan for training centroids and quantizer
+    if (opts->clustering_type == 1)
+      ParseClusteringParams(opts, &buildState);
+    else
+      buildState.clustering_sample_ratio = MAX_CLUSTERING_SAMPLE_RATIO;
     buildState.clustering = (Clustering) palloc(sizeof(ClusteringData));
     buildState.clustering->max_count = maxCount;
     buildState.clustering->values = (float4 *) palloc0(
@@ -624,22 +679,33 @@ ivfflat_build(Relation heap, Relation index, IndexInfo *indexInfo) {
     reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
         IvfflatCentroidsBuildCallback, (void *) &buildState, NULL);
     oldCtx = MemoryContextSwitchTo(buildState.init_ctx);
-    buildState.clustering->k_pos = (int *) palloc0(
-        buildState.clustering->count * sizeof(int));
-    elog(NOTICE, "begin inner kmeans clustering");
-    buildState.clustering->mean = kmeans_impl(opts->dimension,
-        buildState.k, buildState.clustering->count,
-        buildState.clustering->values, false, (float4*)NULL,
-        buildState.clustering->k_pos);
-    if (!InitCentroids(&buildState))
-      elog(ERROR, "index \"%s\" InitCentroids failed",
-          RelationGetRelationName(index));
+    if (opts->quantizer != IVFFLAT_QUANTIZER_NONE) {
+      elog(NOTICE, "begin training quantizer");
+      IvfflatTrainQuantizer(&buildState.quantizer, opts,
+          buildState.clustering->values, buildState.clustering->count,
+          buildState.nthreads);
+      buildState.ivf_state.quantizer = &buildState.quantizer;
+    }
+    if (opts->clustering_type == 1) {
+      buildState.clustering->k_pos = (int *) palloc0(
+          buildState.clustering->count * sizeof(int));
+      elog(NOTICE, "begin inner kmeans clustering");
+      buildState.clustering->mean = kmeans_impl(opts->dimension,
+          buildState.k, buildState.clustering->count,
+          buildState.clustering->values, false, (float4*)NULL,
+          buildState.clustering->k_pos, buildState.nthreads);
+      if (!InitCentroids(&buildState))
+        elog(ERROR, "index \"%s\" InitCentroids failed",
+            RelationGetRelationName(index));
+      pfree(buildState.clustering->k_pos);
+      pfree(buildState.clustering->mean);
+    }
     pfree(buildState.clustering->values);
-    pfree(buildState.clustering->k_pos);
-    pfree(buildState.clustering->mean);
     pfree(buildState.clustering);
     MemoryContextSwitchTo(oldCtx);
-  } else {
+  }
+  if (opts->clustering_type == 0) {
+    MemoryContextSwitchTo(buildState.init_ctx);
     buildState.centroid_path = (char *) opts +
       opts->clustering_params_offset;
     if (!InitCentroids(&buildState))
@@ -652,8 +718,22 @@ ivfflat_build(Relation heap, Relation index, IndexInfo *indexInfo) {
 
   // Do the heap scan
   elog(NOTICE, "begin, ivfflat index building");
+  pgstat_progress_update_param(PROGRESS_CREATEIDX_SUBPHASE,
+      PROGRESS_IVFFLAT_PHASE_ASSIGN);
+  if (sampling)
+    pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_TOTAL,
+        (int64) reltuples);
+  buildState.batch = palloc(IVFFLAT_BUILD_BATCH_SIZE *
+      buildState.ivf_state.size_of_float_tuple);
+  buildState.batch_pos = (int *) palloc(IVFFLAT_BUILD_BATCH_SIZE * sizeof(int));
   reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
       IvfflatBuildCallback, (void *) &buildState, NULL);
+  FlushBuildBatch(index, &buildState);
+  pfree(buildState.batch);
+  pfree(buildState.batch_pos);
+
+  pgstat_progress_update_param(PROGRESS_CREATEIDX_SUBPHASE,
+      PROGRESS_IVFFLAT_PHASE_WRITE);
 
   // Flush last page if needed in inverted list
   for (i = 0; i < buildState.centroids.count; ++i) {
@@ -671,6 +751,14 @@ ivfflat_build(Relation heap, Relation index, IndexInfo *indexInfo) {
   // build centroid page
   BuildCentroidPages(index, &buildState);
 
+  if (buildState.ivf_state.quantizer) {
+    IvfflatWriteQuantizerPages(index, buildState.ivf_state.quantizer);
+    // the cached metapage was read before the quantizer was written
+    if (index->rd_amcache)
+      pfree(index->rd_amcache);
+    index->rd_amcache = NULL;
+  }
+
   indexDoneTime = elapsed();
 
   MemoryContextDelete(buildState.tmp_ctx);
@@ -0,0 +1,323 @@
+// Copyright (C) 2019 Alibaba Group Holding Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ===========================================================================
+//
+// Quantized storage of inverted list vectors.
+//
+// sq8 keeps one byte per dimension, scaled between the minimum and maximum
+// of the dimension in the training sample.  pq splits the vector into m
+// sub-vectors and keeps the id of the nearest of IVFFLAT_PQ_KSUB centroids
+// trained by kmeans for each of them.  The trained parameters are stored in
+// a chain of pages after the centroid pages.
+
+#include "postgres.h"
+
+#include <float.h>
+#include <math.h>
+#include "access/generic_xlog.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "utils/rel.h"
+
+#include "utils/vector_util.h"
+#include "ivfflat.h"
+#include "kmeans.h"
+
+// Number of pq sub-vectors, pq_m or the largest divisor of dimension
+// not above dimension / 4
+int
+IvfflatQuantizerSubvectors(IvfflatOptions *opts) {
+  int m;
+
+  if (opts->pq_m > 0)
+    return opts->pq_m;
+  m = Max(opts->dimension / 4, 1);
+  while (opts->dimension % m != 0)
+    m--;
+  return m;
+}
+
+// Bytes of a vector on inverted list pages
+Size
+IvfflatQuantizerCodeSize(IvfflatOptions *opts) {
+  switch (opts->quantizer) {
+    case IVFFLAT_QUANTIZER_SQ8:
+      return opts->dimension;
+    case IVFFLAT_QUANTIZER_PQ:
+      return IvfflatQuantizerSubvectors(opts);
+    default:
+      return sizeof(float4) * opts->dimension;
+  }
+}
+
+// Number of floats of the trained quantizer
+int
+IvfflatQuantizerParamCount(IvfflatOptions *opts) {
+  switch (opts->quantizer) {
+    case IVFFLAT_QUANTIZER_SQ8:
+      return 2 * opts->dimension;
+    case IVFFLAT_QUANTIZER_PQ:
+      return IVFFLAT_PQ_KSUB * opts->dimension;
+    default:
+      return 0;
+  }
+}
+
+static void
+InitQuantizer(IvfflatQuantizer *quantizer, IvfflatOptions *opts) {
+  quantizer->type = opts->quantizer;
+  quantizer->dim = opts->dimension;
+  quantizer->m = IvfflatQuantizerSubvectors(opts);
+  quantizer->dsub = opts->dimension / quantizer->m;
+  quantizer->nparams = IvfflatQuantizerParamCount(opts);
+}
+
+static void
+TrainSQ8(IvfflatQuantizer *quantizer, float4 *samples, int count) {
+  float4 *vmin, *vstep;
+  int    dim, i, j;
+
+  dim = quantizer->dim;
+  vmin = quantizer->params;
+  vstep = quantizer->params + dim;
+  for (j = 0; j < dim; ++j) {
+    float4 lo = FLT_MAX, hi = -FLT_MAX;
+
+    for (i = 0; i < count; ++i) {
+      lo = Min(lo, samples[i * dim + j]);
+      hi = Max(hi, samples[i * dim + j]);
+    }
+    vmin[j] = lo;
+    vstep[j] = (hi - lo) / 255.0f;
+  }
+}
+
+static void
+TrainPQ(IvfflatQuantizer *quantizer, float4 *samples, int count,
+    int nthreads) {
+  float4 *sub, *mean;
+  int    *pos;
+  int    dim, dsub, n, i, j;
+
+  if (count < IVFFLAT_PQ_KSUB) {
+    elog(ERROR, "pq quantizer needs at least %d sample vectors, got %d",
+        IVFFLAT_PQ_KSUB, count);
+  }
+
+  dim = quantizer->dim;
+  dsub = quantizer->dsub;
+  n = Min(count, IVFFLAT_PQ_MAX_TRAIN_COUNT);
+  sub = (float4 *) palloc(sizeof(float4) * n * dsub);
+  pos = (int *) palloc0(sizeof(int) * n);
+  for (j = 0; j < quantizer->m; ++j) {
+    for (i = 0; i < n; ++i) {
+      memcpy(sub + i * dsub, samples + i * dim + j * dsub,
+          sizeof(float4) * dsub);
+    }
+    mean = kmeans_impl(dsub, IVFFLAT_PQ_KSUB, n, sub, false, (float4*)NULL,
+        pos, nthreads);
+    memcpy(quantizer->params + j * IVFFLAT_PQ_KSUB * dsub, mean,
+        sizeof(float4) * IVFFLAT_PQ_KSUB * dsub);
+    pfree(mean);
+  }
+  pfree(sub);
+  pfree(pos);
+}
+
+// Train the quantizer of opts from count sample vectors
+void
+IvfflatTrainQuantizer(IvfflatQuantizer *quantizer, IvfflatOptions *opts,
+    float4 *samples, int count, int nthreads) {
+  InitQuantizer(quantizer, opts);
+  quantizer->params = (float4 *) palloc0(
+      sizeof(float4) * quantizer->nparams);
+
+  if (count <= 0) {
+    elog(ERROR, "no sample vectors to train the quantizer");
+  }
+
+  if (quantizer->type == IVFFLAT_QUANTIZER_SQ8)
+    TrainSQ8(quantizer, samples, count);
+  else
+    TrainPQ(quantizer, samples, count, nthreads);
+}
+
+void
+IvfflatQuantizerEncode(IvfflatQuantizer *quantizer, const float4 *vector,
+    uint8 *code) {
+  // build encodes tuples in omp threads, so no palloc or elog here
+  int i, j;
+
+  if (quantizer->type == IVFFLAT_QUANTIZER_SQ8) {
+    const float4 *vmin = quantizer->params;
+    const float4 *vstep = quantizer->params + quantizer->dim;
+
+    for (i = 0; i < quantizer->dim; ++i) {
+      float4 v;
+
+      if (vstep[i] <= 0) {
+        code[i] = 0;
+        continue;
+      }
+      v = rintf((vector[i] - vmin[i]) / vstep[i]);
+      code[i] = (uint8) Min(Max(v, 0.0f), 255.0f);
+    }
+  } else {
+    float4 dis[IVFFLAT_PQ_KSUB];
+
+    for (j = 0; j < quantizer->m; ++j) {
+      int minPos = 0;
+
+      fvec_L2sqr_ny_ref(dis, vector + j * quantizer->dsub,
+          quantizer->params + j * IVFFLAT_PQ_KSUB * quantizer->dsub,
+          quantizer->dsub, IVFFLAT_PQ_KSUB);
+      for (i = 1; i < IVFFLAT_PQ_KSUB; ++i) {
+        if (dis[i] < dis[minPos])
+          minPos = i;
+      }
+      code[j] = (uint8) minPos;
+    }
+  }
+}
+
+// Replace the float vector of an inverted list tuple by its code, in place.
+// The tuple is then size_of_invertedlist_tuple long.
+void
+IvfflatEncodeTuple(IvfflatState *state, InvertedListTuple *tuple) {
+  uint8 code[IVFFLAT_MAX_DIMENSION];
+
+  if (state->opts.quantizer == IVFFLAT_QUANTIZER_NONE)
+    return;
+  if (!state->quantizer)
+    elog(ERROR, "quantizer of ivfflat index is not trained");
+
+  IvfflatQuantizerEncode(state->quantizer, tuple->vector, code);
+  memset(tuple->vector, 0,
+      state->size_of_invertedlist_tuple - INVERTEDLISTTUPLEHDRSZ);
+  memcpy(InvertedListTupleGetCode(tuple), code,
+      IvfflatQuantizerCodeSize(&state->opts));
+}
+
+// Distances between the query sub-vectors and the pq centroids, NULL for
+// sq8 which needs no table
+float4 *
+IvfflatQuantizerTable(IvfflatQuantizer *quantizer, const float4 *query) {
+  float4 *table;
+  int    j;
+
+  if (quantizer->type != IVFFLAT_QUANTIZER_PQ)
+    return NULL;
+
+  table = (float4 *) palloc(sizeof(float4) * quantizer->m * IVFFLAT_PQ_KSUB);
+  for (j = 0; j < quantizer->m; ++j) {
+    fvec_L2sqr_ny_ref(table + j * IVFFLAT_PQ_KSUB,
+        query + j * quantizer->dsub,
+        quantizer->params + j * IVFFLAT_PQ_KSUB * quantizer->dsub,
+        quantizer->dsub, IVFFLAT_PQ_KSUB);
+  }
+  return table;
+}
+
+float
+IvfflatQuantizerDistance(IvfflatQuantizer *quantizer, const float4 *query,
+    const float4 *table, const uint8 *code) {
+  if (quantizer->type == IVFFLAT_QUANTIZER_SQ8) {
+    return fvec_L2sqr_sq8(query, code, quantizer->params,
+        quantizer->params + quantizer->dim, quantizer->dim);
+  }
+  return fvec_L2sqr_pq(table, code, quantizer->m, IVFFLAT_PQ_KSUB);
+}
+
+// Write the trained quantizer to a chain of new pages, maxoff of each page
+// is the number of floats on it.
+void
+IvfflatWriteQuantizerPages(Relation index, IvfflatQuantizer *quantizer) {
+  Buffer              metaBuffer, buffer, newBuffer;
+  Page                metaPage, page, newPage;
+  GenericXLogState    *state;
+  IvfflatMetaPageData *meta;
+  int                 offset, count;
+
+  state = GenericXLogStart(index);
+  metaBuffer = ReadBuffer(index, IVFFLAT_METAPAGE_BLKNO);
+  LockBuffer(metaBuffer, BUFFER_LOCK_EXCLUSIVE);
+  metaPage = GenericXLogRegisterBuffer(state, metaBuffer, 0);
+  meta = IvfflatPageGetMeta(metaPage);
+
+  buffer = IvfflatNewBuffer(index, true);
+  page = BufferGetPage(buffer);
+  IvfflatInitPage(page, 0);
+  meta->quantizer_head_blkno = BufferGetBlockNumber(buffer);
+  meta->quantizer_page_count = 0;
+
+  for (offset = 0; offset < quantizer->nparams; offset += count) {
+    count = Min(quantizer->nparams - offset, QUANTIZER_PAGE_FLOATS);
+    if (offset > 0) {
+      newBuffer = IvfflatNewBuffer(index, true);
+      newPage = BufferGetPage(newBuffer);
+      IvfflatInitPage(newPage, 0);
+      IvfflatPageGetOpaque(page)->next = BufferGetBlockNumber(newBuffer);
+      FlushBufferPage(index, buffer, true);
+      buffer = newBuffer;
+      page = newPage;
+    }
+    memcpy(QuantizerPageGetData(page), quantizer->params + offset,
+        sizeof(float4) * count);
+    IvfflatPageGetOpaque(page)->maxoff = count;
+    ((PageHeader) page)->pd_lower =
+      (Pointer) (QuantizerPageGetData(page) + count) - page;
+    meta->quantizer_page_count++;
+  }
+
+  FlushBufferPage(index, buffer, true);
+  GenericXLogFinish(state);
+  UnlockReleaseBuffer(metaBuffer);
+}
+
+// Read the quantizer of the index into quantizer->params, which has room
+// for IvfflatQuantizerParamCount() floats.
+void
+IvfflatReadQuantizerPages(Relation index, IvfflatMetaPageData *meta,
+    IvfflatQuantizer *quantizer) {
+  BlockNumber blkno;
+  Buffer      buffer;
+  Page        page;
+  int         offset, count;
+  uint32      i;
+
+  InitQuantizer(quantizer, &meta->opts);
+  blkno = meta->quantizer_head_blkno;
+  offset = 0;
+  for (i = 0; i < meta->quantizer_page_count; ++i) {
+    buffer = ReadBuffer(index, blkno);
+    LockBuffer(buffer, BUFFER_LOCK_SHARE);
+    page = BufferGetPage(buffer);
+    count = IvfflatPageGetMaxOffset(page);
+    if (offset + count > quantizer->nparams) {
+      UnlockReleaseBuffer(buffer);
+      elog(ERROR, "quantizer pages of index \"%s\" are corrupted",
+          RelationGetRelationName(index));
+    }
+    memcpy(quantizer->params + offset, QuantizerPageGetData(page),
+        sizeof(float4) * count);
+    offset += count;
+    blkno = IvfflatPageGetOpaque(page)->next;
+    UnlockReleaseBuffer(buffer);
+  }
+
+  if (offset != quantizer->nparams) {
+    elog(ERROR, "quantizer pages of index \"%s\" are corrupted",
+        RelationGetRelationName(index));
+  }
+}
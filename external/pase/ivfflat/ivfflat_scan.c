@@ -18,6 +18,8 @@
 #include <pthread.h>
 #include <omp.h>
 #include "access/relscan.h"
+#include "access/tableam.h"
+#include "executor/tuptable.h"
 #include "pgstat.h"
 #include "miscadmin.h"
 #include "storage/bufmgr.h"
@@ -73,6 +75,8 @@ ivfflat_beginscan(Relation r, int nkeys, int norderbys) {
   so->first_call = true;
   so->scan_ctx = scanCxt;
   so->queue = pairingheap_allocate(PairingHeapItemCompare, (void*)&item_reverse);
+  so->rerank_queue = pairingheap_allocate(PairingHeapItemCompare,
+      (void*)&item_reverse);
 
   scan->opaque = so;
 
@@ -105,8 +109,13 @@ ivfflat_rescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
     pairingheap_free(so->queue);
     so->queue = NULL;
   }
+  if (so->rerank_queue != NULL) {
+    pairingheap_free(so->rerank_queue);
+  }
   so->scan_pase = NULL;
   so->queue = pairingheap_allocate(PairingHeapItemCompare, (void*)&item_reverse);
+  so->rerank_queue = pairingheap_allocate(PairingHeapItemCompare,
+      (void*)&item_reverse);
   so->first_call = true;
 
   if (scankey && scan->numberOfKeys > 0) {
@@ -130,7 +139,8 @@ ivfflat_endscan(IndexScanDesc scan) {
 static void
 ScanInvertedListAndCalDistance(Relation index, IvfflatMetaPageData *meta,
     IvfflatState *state, BlockNumber headBlkno,
-    float4 *queryVec, pairingheap *queue, pthread_mutex_t *mutex) {
+    float4 *queryVec, float4 *table, pairingheap *queue,
+    pthread_mutex_t *mutex) {
   BlockNumber            blkno;
   Buffer                 buffer;
   Page                   page;
@@ -154,7 +164,12 @@ ScanInvertedListAndCalDistance(Relation index, IvfflatMetaPageData *meta,
 
     for (i = 0; i < opaque->maxoff; ++i) {
       itup = InvertedListPageGetTuple(state, page, i + 1); 
-      dis = fvec_L2sqr(queryVec, itup->vector, meta->opts.dimension); 
+      if (state->quantizer) {
+        dis = IvfflatQuantizerDistance(state->quantizer, queryVec, table,
+            InvertedListTupleGetCode(itup));
+      } else {
+        dis = fvec_L2sqr(queryVec, itup->vector, meta->opts.dimension);
+      }
       if (mutex) {
         pthread_mutex_lock(mutex);
       }
@@ -172,6 +187,80 @@ ScanInvertedListAndCalDistance(Relation index, IvfflatMetaPageData *meta,
   }
 }
 
+// Re-rank the nearest candidates by the exact vectors of their heap tuples,
+// quantized distances only pick the candidates.
+static void
+RerankCandidates(IndexScanDesc scan, IvfflatScanOpaque so) {
+  Relation               heap;
+  AttrNumber             attno;
+  IndexFetchTableData    *fetch;
+  TupleTableSlot         *slot;
+  MemoryContext          tmpCtx, oldCtx;
+  InvertedListSearchItem *item;
+  float4                 *vector;
+  int                    i;
+
+  heap = scan->heapRelation;
+  attno = scan->indexRelation->rd_index->indkey.values[0];
+  // expression index has no heap column to read the vector from
+  if (heap == NULL || attno == InvalidAttrNumber) {
+    return;
+  }
+
+  vector = (float4 *) palloc(sizeof(float4) * so->state.opts.dimension);
+  fetch = table_index_fetch_begin(heap);
+  slot = table_slot_create(heap, NULL);
+  tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+      "ivfflat rerank temporary context",
+      ALLOCSET_DEFAULT_SIZES);
+
+  for (i = 0; i < so->state.opts.rerank; ++i) {
+    ItemPointerData tid;
+    bool            callAgain = false;
+    bool            allDead = false;
+
+    if (pairingheap_is_empty(so->queue)) {
+      break;
+    }
+    item = (InvertedListSearchItem *) pairingheap_remove_first(so->queue);
+    tid = item->heap_ptr;
+
+    // invisible tuple keeps its quantized distance, executor skips it
+    oldCtx = MemoryContextSwitchTo(tmpCtx);
+    if (table_index_fetch_tuple(fetch, &tid, scan->xs_snapshot, slot,
+          &callAgain, &allDead)) {
+      bool  isnull;
+      Datum value = slot_getattr(slot, attno, &isnull);
+
+      if (!isnull && GetVectorFromDatum(&so->state, value, vector)) {
+        item->distance = fvec_L2sqr(so->scan_pase->x, vector,
+            so->state.opts.dimension);
+      }
+    }
+    MemoryContextSwitchTo(oldCtx);
+    MemoryContextReset(tmpCtx);
+    pairingheap_add(so->rerank_queue, &item->ph_node);
+  }
+
+  ExecDropSingleTupleTableSlot(slot);
+  table_index_fetch_end(fetch);
+  MemoryContextDelete(tmpCtx);
+  pfree(vector);
+}
+
+// Pop the nearest candidate, re-ranked ones go first
+static InvertedListSearchItem *
+PopSearchItem(IvfflatScanOpaque so) {
+  if (!pairingheap_is_empty(so->rerank_queue)) {
+    return (InvertedListSearchItem*) pairingheap_remove_first(
+        so->rerank_queue);
+  }
+  if (!pairingheap_is_empty(so->queue)) {
+    return (InvertedListSearchItem*) pairingheap_remove_first(so->queue);
+  }
+  return NULL;
+}
+
 // ivfflat_gettuple() -- Get the next tuple in the scan
 bool
 ivfflat_gettuple(IndexScanDesc scan, ScanDirection dir) {
@@ -184,6 +273,7 @@ ivfflat_gettuple(IndexScanDesc scan, ScanDirection dir) {
   uint32                 scanCentroidNum;
   InvertedListSearchItem *item;
   CentroidSearchItem     *citems;
+  float4                 *table;
   int                    i;
 
   if (dir != ForwardScanDirection) {
@@ -248,6 +338,8 @@ ivfflat_gettuple(IndexScanDesc scan, ScanDirection dir) {
     SearchKNNInvertedListFromCentroidPages(scan->indexRelation,
         &so->state, meta, so->scan_pase->x, scanCentroidNum,
         reverse, citems, true);
+    table = so->state.quantizer ?
+      IvfflatQuantizerTable(so->state.quantizer, so->scan_pase->x) : NULL;
     if (meta->opts.open_omp) {
       pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
       omp_set_num_threads(meta->opts.omp_thread_num);
@@ -262,7 +354,7 @@ ivfflat_gettuple(IndexScanDesc scan, ScanDirection dir) {
         }
         ScanInvertedListAndCalDistance(scan->indexRelation, meta,
             &so->state, citems[i].head_ivl_blkno,
-            so->scan_pase->x, so->queue, &mutex);
+            so->scan_pase->x, table, so->queue, &mutex);
       }
       pthread_mutex_destroy(&mutex);
     } else {
@@ -276,12 +368,14 @@ ivfflat_gettuple(IndexScanDesc scan, ScanDirection dir) {
         }
         ScanInvertedListAndCalDistance(scan->indexRelation, meta,
             &so->state, citems[i].head_ivl_blkno,
-            so->scan_pase->x, so->queue, (pthread_mutex_t *)NULL);
+            so->scan_pase->x, table, so->queue, (pthread_mutex_t *)NULL);
       }
     }
-    if (!pairingheap_is_empty(so->queue)) {
-      item = (InvertedListSearchItem*) pairingheap_remove_first(
-          so->queue);
+    if (so->state.quantizer && so->state.opts.rerank > 0) {
+      RerankCandidates(scan, so);
+    }
+    item = PopSearchItem(so);
+    if (item) {
       scan->xs_heaptid = item->heap_ptr;
       if (scan->numberOfOrderBys > 0) {
         scan->xs_orderbyvals[0] = Float4GetDatum(item->distance);
@@ -291,12 +385,14 @@ ivfflat_gettuple(IndexScanDesc scan, ScanDirection dir) {
     }
     so->first_call = false;
     pfree(citems);
+    if (table) {
+      pfree(table);
+    }
     UnlockReleaseBuffer(metaBuffer);
   }
   else {
-    if (!pairingheap_is_empty(so->queue)) {
-      item = (InvertedListSearchItem*) pairingheap_remove_first(
-          so->queue);
+    item = PopSearchItem(so);
+    if (item) {
       scan->xs_heaptid = item->heap_ptr;
       if (scan->numberOfOrderBys > 0) {
         scan->xs_orderbyvals[0] = Float4GetDatum(item->distance);
@@ -27,6 +27,7 @@
 #include "storage/indexfsm.h"
 #include "utils/memutils.h"
 #include "access/reloptions.h"
+#include "commands/progress.h"
 #include "storage/freespace.h"
 #include "storage/indexfsm.h"
 #include "lib/pairingheap.h"
@@ -52,15 +53,14 @@ void
 InitIvfflatState(IvfflatState *state, Relation index) {
   state->nColumns = index->rd_att->natts;
 
-  // Initialize amcache if needed with options from metapage
+  // Initialize amcache if needed with options and quantizer from metapage
   if (!index->rd_amcache)
   {
     Buffer		buffer;
     Page		page;
     IvfflatMetaPageData *meta;
-    IvfflatOptions *opts;
-
-    opts = MemoryContextAlloc(index->rd_indexcxt, sizeof(IvfflatOptions));
+    IvfflatCacheData *cache;
+    int         nparams;
 
     buffer = ReadBuffer(index, IVFFLAT_METAPAGE_BLKNO);
     LockBuffer(buffer, BUFFER_LOCK_SHARE);
@@ -74,22 +74,36 @@ InitIvfflatState(IvfflatState *state, Relation index) {
     if (meta->magick_number != IVFFLAT_MAGICK_NUMBER)
       elog(ERROR, "Relation is not a pase ivfflat index");
 
-    *opts = meta->opts;
+    // the quantizer is written at the end of build
+    nparams = meta->quantizer_page_count > 0 ?
+      IvfflatQuantizerParamCount(&meta->opts) : 0;
+    cache = MemoryContextAllocZero(index->rd_indexcxt,
+        offsetof(IvfflatCacheData, params) + sizeof(float4) * nparams);
+    cache->opts = meta->opts;
+    if (nparams > 0) {
+      cache->quantizer.params = cache->params;
+      IvfflatReadQuantizerPages(index, meta, &cache->quantizer);
+    }
     UnlockReleaseBuffer(buffer);
-    index->rd_amcache = (void *) opts;
+    index->rd_amcache = (void *) cache;
   }
 
-  memcpy(&state->opts, index->rd_amcache, sizeof(state->opts));
+  memcpy(&state->opts, &((IvfflatCacheData *) index->rd_amcache)->opts,
+      sizeof(state->opts));
+  state->quantizer = ((IvfflatCacheData *) index->rd_amcache)->quantizer.nparams > 0 ?
+    &((IvfflatCacheData *) index->rd_amcache)->quantizer : NULL;
   state->size_of_centroid_tuple = CENTROIDTUPLEHDRSZ +
     sizeof(float4) * state->opts.dimension;
-  state->size_of_invertedlist_tuple = INVERTEDLISTTUPLEHDRSZ +
+  state->size_of_float_tuple = INVERTEDLISTTUPLEHDRSZ +
     sizeof(float4) * state->opts.dimension;
+  state->size_of_invertedlist_tuple = TYPEALIGN(sizeof(float4),
+      INVERTEDLISTTUPLEHDRSZ + IvfflatQuantizerCodeSize(&state->opts));
 }
 
 float
 SearchNNFromCentroids(IvfflatState *state, InvertedListTuple *tuple,
     Centroids centroids, int *minPos) {
-  // TODO(yangwen.yw): omp for
+  // Called from omp threads during build, keep it free of palloc and elog
   float minDistance;
   CentroidTuple *ctup;
   int i;
@@ -211,6 +225,34 @@ void FlushBufferPage(Relation index, Buffer buffer, bool needUnLock) {
   UnlockReleaseBuffer(buffer);
 }
 
+// Number of omp threads for the numeric work of index build, open_omp
+// turns them on and omp_thread_num limits them.
+int
+IvfflatBuildThreadNum(IvfflatOptions *opts) {
+  if (!opts->open_omp)
+    return 1;
+  if (opts->omp_thread_num > 0)
+    return opts->omp_thread_num;
+  return omp_get_num_procs();
+}
+
+// Name of the build phases in pg_stat_progress_create_index
+char *
+ivfflat_buildphasename(int64 phasenum) {
+  switch (phasenum) {
+    case PROGRESS_CREATEIDX_SUBPHASE_INITIALIZE:
+      return "initializing";
+    case PROGRESS_IVFFLAT_PHASE_KMEANS:
+      return "performing k-means";
+    case PROGRESS_IVFFLAT_PHASE_ASSIGN:
+      return "assigning tuples";
+    case PROGRESS_IVFFLAT_PHASE_WRITE:
+      return "writing centroids";
+    default:
+      return NULL;
+  }
+}
+
 // Allocate a new page (either by recycling, or by extending the index file)
 // The returned buffer is already pinned and exclusive-locked when used in
 // inserting, but not exclusive-locked in building
@@ -334,7 +376,10 @@ ivfflat_options(Datum reloptions, bool validate) {
     {"open_omp", RELOPT_TYPE_INT, offsetof(IvfflatOptions, open_omp)},
     {"omp_thread_num", RELOPT_TYPE_INT, offsetof(IvfflatOptions, omp_thread_num)},
     {"base64_encoded", RELOPT_TYPE_INT, offsetof(IvfflatOptions, base64_encoded)},
-    {"clustering_params", RELOPT_TYPE_STRING, offsetof(IvfflatOptions, clustering_params_offset)}
+    {"clustering_params", RELOPT_TYPE_STRING, offsetof(IvfflatOptions, clustering_params_offset)},
+    {"quantizer", RELOPT_TYPE_INT, offsetof(IvfflatOptions, quantizer)},
+    {"pq_m", RELOPT_TYPE_INT, offsetof(IvfflatOptions, pq_m)},
+    {"rerank", RELOPT_TYPE_INT, offsetof(IvfflatOptions, rerank)}
   };
 #if PG_VERSION_NUM < 130000
 
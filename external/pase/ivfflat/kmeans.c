@@ -27,6 +27,9 @@
 
 #define SIZEOF_V(dim) (sizeof(float4) * dim)
 
+// dimensions summed up by one thread at a time in update_mean
+#define KMEANS_DIM_BLOCK 16
+
 #define KMEANS_CHECK_V(v, dim, isnull) do{ \
   if ((isnull) || \
       ARR_NDIM(v) != 1 || \
@@ -46,14 +49,18 @@ typedef struct {
 } kmeans_context;
 
 // update classification (assignment) by calculated mean vectors.
+// Each vector is classified on its own, so they are split between threads.
   static void
-update_r(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
-  int			i, klass;
+update_r(myvector inputs, int dim, int N, int k, myvector mean, int *r,
+    int nthreads) {
+  int			i;
 
+#pragma omp parallel for if (nthreads > 1) num_threads(nthreads) schedule(static)
   for (i = 0; i < N; i++) {
     float4		dist;
     float4		curr_dist;
     int			curr_klass;
+    int			klass;
 
     curr_dist = fvec_L2sqr(&inputs[i * dim], &mean[0], dim);
     curr_klass = 0;
@@ -74,19 +81,30 @@ update_r(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
 }
 
 // update mean vectors by all vectors classified in each class.
+// Threads sum up disjoint ranges of dimensions, so they never write the same
+// element of mean_sum and the sums do not depend on the thread number.
 static void
-update_mean(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
+update_mean(myvector inputs, int dim, int N, int k, myvector mean, int *r,
+    int nthreads) {
   myvector	mean_sum = (myvector) palloc0(SIZEOF_V(dim) * k);
   int		   *mean_count = (int *) palloc0(sizeof(int) * k);
-  int			i, a, klass;
+  int			i, a, klass, block;
 
-  for (i = 0; i < N; i++) {
-    klass = r[i];
+  for (i = 0; i < N; i++)
+    mean_count[r[i]]++;
 
-    for (a = 0; a < dim; a++) {
-      mean_sum[klass * dim + a] += inputs[i * dim + a];
+#pragma omp parallel for if (nthreads > 1) num_threads(nthreads) schedule(static)
+  for (block = 0; block < dim; block += KMEANS_DIM_BLOCK) {
+    int			end = Min(block + KMEANS_DIM_BLOCK, dim);
+    int			j, b;
+
+    for (j = 0; j < N; j++) {
+      float4	   *sum = &mean_sum[r[j] * dim];
+      float4	   *input = &inputs[j * dim];
+
+      for (b = block; b < end; b++)
+        sum[b] += input[b];
     }
-    mean_count[klass]++;
   }
 
   for (klass = 0; klass < k; klass++) {
@@ -100,14 +118,21 @@ update_mean(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
 }
 
 // Evaluation function. kmeans tries to minimize value of this function.
+// Distances are computed by threads but summed up in order, calc_kmeans
+// stops when the value does not change, so it must be reproducible.
 static float4
-J(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
+J(myvector inputs, int dim, int N, int k, myvector mean, int *r,
+    float4 *dists, int nthreads) {
   int		i;
   float4	sum = 0.0;
 
+#pragma omp parallel for if (nthreads > 1) num_threads(nthreads) schedule(static)
+  for (i = 0; i < N; i++)
+    dists[i] = fvec_L2sqr(&inputs[i * dim], &mean[r[i] * dim], dim);
+
   for (i = 0; i < N; i++)
   {
-    sum += fvec_L2sqr(&inputs[i * dim], &mean[r[i] * dim], dim);
+    sum += dists[i];
   }
   return sum;
 }
@@ -116,12 +141,13 @@ J(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
 // determine initial mean vectors (centroids) when they aren't specified.
 // The way to initialize is hard; it decides the result quality.
 static void
-initialize_mean(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
+initialize_mean(myvector inputs, int dim, int N, int k, myvector mean, int *r,
+    int nthreads) {
   myvector	minvec = (myvector) palloc0(SIZEOF_V(dim));
   myvector	maxvec = (myvector) palloc0(SIZEOF_V(dim));
   myvector	midvec = (myvector) palloc0(SIZEOF_V(dim));
-  int			i, j, a, klass, sidx;
-  int		   *seen;
+  int			i, a, klass;
+  bool	   *seen;
 
   // First, scan all input vectors and find min/max values
   // for each dimension (i.e. take largest space)
@@ -141,12 +167,11 @@ initialize_mean(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
     }
   }
 
-  // array to store vectors which were chosen until
+  // flags of vectors which were chosen until
   // the iteration. We try to avoid duplicated assignment.
-  seen = (int *) palloc0(sizeof(int) * N);
-  sidx = 0;
+  seen = (bool *) palloc0(sizeof(bool) * N);
   for (klass = 0; klass < k; klass++) {
-    float4	curr_dist, dist;
+    float4	curr_dist = 0.0;
     int		curr_idx = 0;
 
     // split vector space linearly. Then find nearest point
@@ -155,26 +180,44 @@ initialize_mean(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
       midvec[a] = (maxvec[a] - minvec[a]) *
         ((float4) (klass + 1) / (float4) (k + 1)) + minvec[a];
     }
-    for (i = 0; i < N; i++) {
-      bool	found = false;
-
-      // If this element is taken by another centroid,
-      // then take another for this loop as far as possible.
-      for (j = 0; j < sidx; j++) {
-        if (seen[j] == i)
-          found = true;
+
+    // Each thread finds the nearest point in its range, the first one
+    // wins a tie.  Like the serial search, the first vector is never
+    // taken unless it is the only choice.
+#pragma omp parallel if (nthreads > 1) num_threads(nthreads)
+    {
+      float4	local_dist = 0.0;
+      int		local_idx = 0;
+      int		j;
+
+#pragma omp for schedule(static) nowait
+      for (j = 1; j < N; j++) {
+        float4	dist;
+
+        // If this element is taken by another centroid,
+        // then take another for this loop as far as possible.
+        if (seen[j])
+          continue;
+        dist = fvec_L2sqr(midvec, &inputs[j * dim], dim);
+        if (local_idx == 0 || dist < local_dist) {
+          // the input vector seems nearer
+          local_dist = dist;
+          local_idx = j;
+        }
       }
-      if (found)
-        continue;
-      dist = fvec_L2sqr(midvec, &inputs[i * dim], dim);
-      if (curr_idx == 0 || dist < curr_dist) {
-        // the input vector seems nearer
-        curr_dist = dist;
-        curr_idx = i;
+
+#pragma omp critical
+      {
+        if (local_idx != 0 &&
+            (curr_idx == 0 || local_dist < curr_dist ||
+             (local_dist == curr_dist && local_idx < curr_idx))) {
+          curr_dist = local_dist;
+          curr_idx = local_idx;
+        }
       }
     }
     memcpy(&mean[klass * dim], &inputs[curr_idx * dim], SIZEOF_V(dim));
-    seen[sidx++] = curr_idx;
+    seen[curr_idx] = true;
   }
   pfree(minvec);
   pfree(maxvec);
@@ -209,21 +252,24 @@ kmeans_debug(myvector mean, int dim, int k) {
 // k		: the number to cluster
 // mean		: initial mean vectors (centroids)
 // r		: (out) an array to put answer cluster ids
+// nthreads	: the number of omp threads for the numeric work
 static int *
-calc_kmeans(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
+calc_kmeans(myvector inputs, int dim, int N, int k, myvector mean, int *r,
+    int nthreads) {
   float4	target, new_target;
+  float4   *dists = (float4 *) palloc(sizeof(float4) * N);
 
   
   // initialize purpose value. At this time, r doesn't mean anything
   // but it's ok; just fill target by some value.
-  target = J(inputs, dim, N, k, mean, r);
+  target = J(inputs, dim, N, k, mean, r, dists, nthreads);
   for (;;) {
 
     // it's good to check here, for avoid infinite loop
     CHECK_FOR_INTERRUPTS();
-    update_r(inputs, dim, N, k, mean, r);
-    update_mean(inputs, dim, N, k, mean, r);
-    new_target = J(inputs, dim, N, k, mean, r);
+    update_r(inputs, dim, N, k, mean, r, nthreads);
+    update_mean(inputs, dim, N, k, mean, r, nthreads);
+    new_target = J(inputs, dim, N, k, mean, r, dists, nthreads);
     kmeans_debug(mean, dim, k);
     // if all the classification stay, diff must be 0.0,
     // which means we can go out!
@@ -232,12 +278,14 @@ calc_kmeans(myvector inputs, int dim, int N, int k, myvector mean, int *r) {
     target = new_target;
   }
 
+  pfree(dists);
   return  r;
 }
 
 myvector
 kmeans_impl(int dim, int k, int N, myvector inputs,
-    bool initial_mean_supplied, myvector initial_mean, int *r) {
+    bool initial_mean_supplied, myvector initial_mean, int *r,
+    int nthreads) {
   myvector	mean;
 
    // initial mean vectors. need improve how to define them.
@@ -245,11 +293,11 @@ kmeans_impl(int dim, int k, int N, myvector inputs,
   if (initial_mean_supplied) {
     memcpy(mean, initial_mean, SIZEOF_V(dim) * k);
   } else {
-    initialize_mean(inputs, dim, N, k, mean, r);
+    initialize_mean(inputs, dim, N, k, mean, r, nthreads);
     kmeans_debug(mean, dim, k);
   }
   // run it!
-  calc_kmeans(inputs, dim, N, k, mean, r);
+  calc_kmeans(inputs, dim, N, k, mean, r, nthreads);
   return mean;
 }
 
@@ -21,6 +21,7 @@
 typedef float4 *myvector;
 extern myvector
 kmeans_impl(int dim, int k, int N, myvector inputs,
-        bool initial_mean_supplied, myvector initial_mean, int *r);
+        bool initial_mean_supplied, myvector initial_mean, int *r,
+        int nthreads);
 
 #endif  // PASE_IVFFLAT_KMEANS_H_
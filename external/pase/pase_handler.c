@@ -43,7 +43,7 @@ _PG_init(void) {
     hnsw_relopt_kind = add_reloption_kind();
     add_int_reloption(hnsw_relopt_kind, "dim",
                       "vector dimension",
-                      256, 8, 512, AccessExclusiveLock);
+                      256, 8, HNSW_MAX_DIM, AccessExclusiveLock);
     add_int_reloption(hnsw_relopt_kind, "base_nb_num",
                       "hnsw base_nb_num",
                       16, 5, 64, AccessExclusiveLock);
@@ -56,6 +56,12 @@ _PG_init(void) {
     add_int_reloption(hnsw_relopt_kind, "base64_encoded",
                       "whether data base64 encoded",
                       0, 0, 1, AccessExclusiveLock);
+    add_int_reloption(hnsw_relopt_kind, "quantizer",
+                      "vector storage: 0 float, 1 sq8",
+                      0, 0, 1, AccessExclusiveLock);
+    add_int_reloption(hnsw_relopt_kind, "rerank",
+                      "candidates re-ranked with the heap vectors",
+                      0, 0, HNSW_MAX_RERANK, AccessExclusiveLock);
     // ivfflat options
     ivfflat_relopt_kind = add_reloption_kind();
     add_int_reloption(ivfflat_relopt_kind, "clustering_type",
@@ -78,6 +84,15 @@ _PG_init(void) {
                       0, 0, 1, AccessExclusiveLock);
     add_string_reloption(ivfflat_relopt_kind, "clustering_params",
                       "clustering parameters", "", NULL, AccessExclusiveLock);
+    add_int_reloption(ivfflat_relopt_kind, "quantizer",
+                      "vector storage: 0 float, 1 sq8, 2 pq",
+                      0, 0, 2, AccessExclusiveLock);
+    add_int_reloption(ivfflat_relopt_kind, "pq_m",
+                      "pq sub-vector count, 0 picks dimension / 4",
+                      0, 0, IVFFLAT_MAX_DIMENSION, AccessExclusiveLock);
+    add_int_reloption(ivfflat_relopt_kind, "rerank",
+                      "candidates re-ranked with the heap vectors",
+                      0, 0, IVFFLAT_MAX_RERANK, AccessExclusiveLock);
 
 }
 
@@ -95,7 +110,9 @@ hnsw_options(Datum reloptions, bool validate) {
       {"base_nb_num", RELOPT_TYPE_INT, offsetof(HNSWOptions, base_nb_num)},
       {"ef_build", RELOPT_TYPE_INT, offsetof(HNSWOptions, ef_build)},
       {"ef_search", RELOPT_TYPE_INT, offsetof(HNSWOptions, ef_search)},
-      {"base64_encoded", RELOPT_TYPE_INT, offsetof(HNSWOptions, base64_encoded)}
+      {"base64_encoded", RELOPT_TYPE_INT, offsetof(HNSWOptions, base64_encoded)},
+      {"quantizer", RELOPT_TYPE_INT, offsetof(HNSWOptions, quantizer)},
+      {"rerank", RELOPT_TYPE_INT, offsetof(HNSWOptions, rerank)}
   };
 #if PG_VERSION_NUM < 130000
   options = parseRelOptions(reloptions, validate, hnsw_relopt_kind, &numOptions);
@@ -136,6 +153,7 @@ pase_ivfflat(PG_FUNCTION_ARGS) {
   amroutine->amkeytype = InvalidOid;
 
   amroutine->ambuild = ivfflat_build;
+  amroutine->ambuildphasename = ivfflat_buildphasename;
   amroutine->ambuildempty = ivfflat_buildempty;
   amroutine->aminsert = ivfflat_insert;
   amroutine->ambulkdelete = ivfflat_bulkdelete;
@@ -0,0 +1,63 @@
+---------------------------------------------------------------------------
+--
+-- ivfflat_omp.sql-
+--    An ivfflat index built with openmp threads must be the same as
+--    the one built serially, so queries get the same results from them.
+--
+---------------------------------------------------------------------------
+
+SET client_min_messages TO 'WARNING';
+CREATE EXTENSION IF NOT EXISTS pase;
+
+-- more rows than a build batch, so several batches are assigned by threads
+CREATE TABLE vectors_ivfflat_omp (
+      id int,
+        vector float4[]
+    );
+
+INSERT INTO vectors_ivfflat_omp SELECT id,
+  ARRAY(SELECT (sin(id * (0.1 + j * 0.037) + j) * 100)::float4 FROM generate_series(1, 16) j)
+FROM generate_series(1, 20000) id;
+
+-- sample every row, then k-means gets the same input in both builds
+CREATE INDEX v_ivfflat_omp_idx ON vectors_ivfflat_omp
+USING
+  pase_ivfflat(vector)
+WITH
+  (clustering_type = 1, distance_type = 0, dimension = 16, clustering_params = "1000,64", open_omp = 0);
+
+SET enable_seqscan=off;
+SET enable_indexscan=on;
+CREATE TABLE ivfflat_serial_result AS
+SELECT q.id AS qid,
+  ARRAY(SELECT n.id FROM (SELECT t.id FROM vectors_ivfflat_omp t
+    ORDER BY t.vector <#> pase(q.vector, 100, 0) LIMIT 10) n ORDER BY n.id) AS ids
+FROM vectors_ivfflat_omp q WHERE q.id % 400 = 0;
+DROP INDEX v_ivfflat_omp_idx;
+
+CREATE INDEX v_ivfflat_omp_idx ON vectors_ivfflat_omp
+USING
+  pase_ivfflat(vector)
+WITH
+  (clustering_type = 1, distance_type = 0, dimension = 16, clustering_params = "1000,64", open_omp = 1, omp_thread_num = 4);
+
+CREATE TABLE ivfflat_omp_result AS
+SELECT q.id AS qid,
+  ARRAY(SELECT n.id FROM (SELECT t.id FROM vectors_ivfflat_omp t
+    ORDER BY t.vector <#> pase(q.vector, 100, 0) LIMIT 10) n ORDER BY n.id) AS ids
+FROM vectors_ivfflat_omp q WHERE q.id % 400 = 0;
+
+-- every query finds its own row and the same neighbors from both indexes
+SELECT count(*) AS queries,
+  count(*) FILTER (WHERE s.qid = ANY(s.ids)) AS found_self,
+  count(*) FILTER (WHERE s.ids = o.ids) AS same_results
+FROM ivfflat_serial_result s JOIN ivfflat_omp_result o USING (qid);
+
+---- clean up
+RESET enable_seqscan;
+RESET enable_indexscan;
+DROP TABLE ivfflat_serial_result;
+DROP TABLE ivfflat_omp_result;
+DROP INDEX v_ivfflat_omp_idx;
+DROP TABLE vectors_ivfflat_omp;
+RESET client_min_messages;
@@ -280,3 +280,254 @@ float fvec_norm_L2sqr (const float *x, size_t d) {
 }
 
 #endif
+
+float fvec_L2sqr_sq8_ref (const float * x,
+                          const uint8_t * code,
+                          const float * vmin,
+                          const float * vstep,
+                          size_t d) {
+    size_t i;
+    float res;
+    res = 0;
+    for (i = 0; i < d; i++) {
+        const float tmp = x[i] - (vmin[i] + code[i] * vstep[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+float fvec_L2sqr_pq_ref (const float * table,
+                         const uint8_t * code,
+                         size_t m, size_t ksub) {
+    size_t j;
+    float res;
+    res = 0;
+    for (j = 0; j < m; j++) {
+        res += table[code[j]];
+        table += ksub;
+    }
+    return res;
+}
+
+// The AVX2 kernels are compiled with a target attribute, pase itself is
+// built for SSE4 only, so they are picked by cpuid on the first call.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define USE_AVX2_DISPATCH
+#include <cpuid.h>
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+// CPUID.1:ECX
+#define CPU_FEATURE_OSXSAVE (1 << 27)
+#define CPU_FEATURE_AVX     (1 << 28)
+// CPUID.(EAX=7,ECX=0):EBX
+#define CPU_FEATURE_AVX2    (1 << 5)
+// XCR0: SSE and AVX state
+#define XSTATE_AVX          0x06
+#endif
+
+#ifdef __SSE4_1__
+
+// decodes 4 sq8 codes as __m128
+static inline __m128 sq8_decode_4 (const uint8_t *code, const float *vmin,
+                                   const float *vstep) {
+    int32_t c;
+    __m128 mc;
+
+    memcpy(&c, code, sizeof(c));
+    mc = _mm_cvtepi32_ps (_mm_cvtepu8_epi32 (_mm_cvtsi32_si128 (c)));
+    return _mm_add_ps (_mm_loadu_ps (vmin),
+                       _mm_mul_ps (mc, _mm_loadu_ps (vstep)));
+}
+
+static float fvec_L2sqr_sq8_default (const float * x,
+                                     const uint8_t * code,
+                                     const float * vmin,
+                                     const float * vstep,
+                                     size_t d) {
+    __m128 msum1;
+    float res;
+
+    msum1 = _mm_setzero_ps();
+
+    while (d >= 4) {
+        __m128 my = sq8_decode_4 (code, vmin, vstep);
+        const __m128 a_m_b1 = _mm_sub_ps (_mm_loadu_ps (x), my);
+        msum1 = _mm_add_ps (msum1, _mm_mul_ps (a_m_b1, a_m_b1));
+        x += 4; code += 4; vmin += 4; vstep += 4;
+        d -= 4;
+    }
+
+    msum1 = _mm_hadd_ps (msum1, msum1);
+    msum1 = _mm_hadd_ps (msum1, msum1);
+    res = _mm_cvtss_f32 (msum1);
+
+    // add the last 1, 2 or 3 values
+    return res + fvec_L2sqr_sq8_ref (x, code, vmin, vstep, d);
+}
+
+#else
+
+static float fvec_L2sqr_sq8_default (const float * x,
+                                     const uint8_t * code,
+                                     const float * vmin,
+                                     const float * vstep,
+                                     size_t d) {
+    return fvec_L2sqr_sq8_ref (x, code, vmin, vstep, d);
+}
+
+#endif
+
+// table lookups do not vectorize without gather, keep 4 independent sums
+// so that the loads overlap
+static float fvec_L2sqr_pq_default (const float * table,
+                                    const uint8_t * code,
+                                    size_t m, size_t ksub) {
+    float res0 = 0, res1 = 0, res2 = 0, res3 = 0;
+
+    while (m >= 4) {
+        res0 += table[code[0]];
+        res1 += table[ksub + code[1]];
+        res2 += table[2 * ksub + code[2]];
+        res3 += table[3 * ksub + code[3]];
+        table += 4 * ksub; code += 4;
+        m -= 4;
+    }
+
+    return (res0 + res1) + (res2 + res3) +
+        fvec_L2sqr_pq_ref (table, code, m, ksub);
+}
+
+#ifdef USE_AVX2_DISPATCH
+
+TARGET_AVX2 static float fvec_L2sqr_sq8_avx2 (const float * x,
+                                              const uint8_t * code,
+                                              const float * vmin,
+                                              const float * vstep,
+                                              size_t d) {
+    __m256 msum8 = _mm256_setzero_ps();
+    __m128 msum1;
+    float res;
+
+    while (d >= 8) {
+        __m256 mc = _mm256_cvtepi32_ps (_mm256_cvtepu8_epi32 (
+            _mm_loadl_epi64 ((const __m128i *) code)));
+        __m256 my = _mm256_add_ps (_mm256_loadu_ps (vmin),
+            _mm256_mul_ps (mc, _mm256_loadu_ps (vstep)));
+        const __m256 a_m_b1 = _mm256_sub_ps (_mm256_loadu_ps (x), my);
+        msum8 = _mm256_add_ps (msum8, _mm256_mul_ps (a_m_b1, a_m_b1));
+        x += 8; code += 8; vmin += 8; vstep += 8;
+        d -= 8;
+    }
+
+    msum1 = _mm_add_ps (_mm256_extractf128_ps (msum8, 1),
+                        _mm256_castps256_ps128 (msum8));
+    msum1 = _mm_hadd_ps (msum1, msum1);
+    msum1 = _mm_hadd_ps (msum1, msum1);
+    res = _mm_cvtss_f32 (msum1);
+
+    // add the last 7 values at most
+    return res + fvec_L2sqr_sq8_default (x, code, vmin, vstep, d);
+}
+
+// gathers 8 table entries at a time, one from each sub-vector table
+TARGET_AVX2 static float fvec_L2sqr_pq_avx2 (const float * table,
+                                             const uint8_t * code,
+                                             size_t m, size_t ksub) {
+    const __m256i offsets = _mm256_mullo_epi32 (
+        _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7),
+        _mm256_set1_epi32 ((int) ksub));
+    __m256 msum8 = _mm256_setzero_ps();
+    __m128 msum1;
+    float res;
+
+    while (m >= 8) {
+        __m256i idx = _mm256_add_epi32 (offsets, _mm256_cvtepu8_epi32 (
+            _mm_loadl_epi64 ((const __m128i *) code)));
+        msum8 = _mm256_add_ps (msum8, _mm256_i32gather_ps (table, idx, 4));
+        table += 8 * ksub; code += 8;
+        m -= 8;
+    }
+
+    msum1 = _mm_add_ps (_mm256_extractf128_ps (msum8, 1),
+                        _mm256_castps256_ps128 (msum8));
+    msum1 = _mm_hadd_ps (msum1, msum1);
+    msum1 = _mm_hadd_ps (msum1, msum1);
+    res = _mm_cvtss_f32 (msum1);
+
+    return res + fvec_L2sqr_pq_ref (table, code, m, ksub);
+}
+
+// the CPU has AVX2, and the OS saves the ymm registers on context switches
+static int cpu_supports_avx2 (void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    if ((ecx & (CPU_FEATURE_OSXSAVE | CPU_FEATURE_AVX)) !=
+        (CPU_FEATURE_OSXSAVE | CPU_FEATURE_AVX))
+        return 0;
+
+    // xgetbv with ECX = 0 reads XCR0
+    __asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    if ((eax & XSTATE_AVX) != XSTATE_AVX)
+        return 0;
+
+    if (__get_cpuid_max (0, NULL) < 7)
+        return 0;
+    __cpuid_count (7, 0, eax, ebx, ecx, edx);
+    return (ebx & CPU_FEATURE_AVX2) != 0;
+}
+
+#endif
+
+static float fvec_L2sqr_sq8_choose (const float * x, const uint8_t * code,
+    const float * vmin, const float * vstep, size_t d);
+static float fvec_L2sqr_pq_choose (const float * table, const uint8_t * code,
+    size_t m, size_t ksub);
+
+static float (*fvec_L2sqr_sq8_impl) (const float * x, const uint8_t * code,
+    const float * vmin, const float * vstep, size_t d) = fvec_L2sqr_sq8_choose;
+static float (*fvec_L2sqr_pq_impl) (const float * table, const uint8_t * code,
+    size_t m, size_t ksub) = fvec_L2sqr_pq_choose;
+
+// sets the kernels on the first call, every caller picks the same ones so
+// concurrent first calls from build threads are harmless
+static void fvec_choose_kernels (void) {
+#ifdef USE_AVX2_DISPATCH
+    if (cpu_supports_avx2 ()) {
+        fvec_L2sqr_sq8_impl = fvec_L2sqr_sq8_avx2;
+        fvec_L2sqr_pq_impl = fvec_L2sqr_pq_avx2;
+        return;
+    }
+#endif
+    fvec_L2sqr_sq8_impl = fvec_L2sqr_sq8_default;
+    fvec_L2sqr_pq_impl = fvec_L2sqr_pq_default;
+}
+
+static float fvec_L2sqr_sq8_choose (const float * x, const uint8_t * code,
+                                    const float * vmin, const float * vstep,
+                                    size_t d) {
+    fvec_choose_kernels ();
+    return fvec_L2sqr_sq8_impl (x, code, vmin, vstep, d);
+}
+
+static float fvec_L2sqr_pq_choose (const float * table, const uint8_t * code,
+                                   size_t m, size_t ksub) {
+    fvec_choose_kernels ();
+    return fvec_L2sqr_pq_impl (table, code, m, ksub);
+}
+
+float fvec_L2sqr_sq8 (const float * x,
+                      const uint8_t * code,
+                      const float * vmin,
+                      const float * vstep,
+                      size_t d) {
+    return fvec_L2sqr_sq8_impl (x, code, vmin, vstep, d);
+}
+
+float fvec_L2sqr_pq (const float * table,
+                     const uint8_t * code,
+                     size_t m, size_t ksub) {
+    return fvec_L2sqr_pq_impl (table, code, m, ksub);
+}
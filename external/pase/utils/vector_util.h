@@ -24,6 +24,7 @@
 #else
 #include <stddef.h>
 #endif
+#include <stdint.h>
 
 float fvec_L2sqr_ref(const float * x, const float * y, size_t d);
 float fvec_inner_product_ref(const float * x, const float * y, size_t d);
@@ -33,4 +34,17 @@ float fvec_norm_L2sqr(const float *  x, size_t d);
 float fvec_inner_product(const float * x, const float * y, size_t d);
 float fvec_L2sqr (const float * x, const float * y, size_t d);
 
+// asymmetric distances between a float query and quantized codes
+// sq8: y[i] = vmin[i] + code[i] * vstep[i]
+float fvec_L2sqr_sq8_ref(const float * x, const uint8_t * code,
+    const float * vmin, const float * vstep, size_t d);
+float fvec_L2sqr_sq8(const float * x, const uint8_t * code,
+    const float * vmin, const float * vstep, size_t d);
+// pq: sum of table[j * ksub + code[j]], table holds the distances between
+// the query sub-vectors and the centroids
+float fvec_L2sqr_pq_ref(const float * table, const uint8_t * code,
+    size_t m, size_t ksub);
+float fvec_L2sqr_pq(const float * table, const uint8_t * code,
+    size_t m, size_t ksub);
+
 #endif  // PASE_UTILS_VECTOR_UTIL_H_
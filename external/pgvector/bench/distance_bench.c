@@ -0,0 +1,201 @@
+/*
+ * Benchmark of the distance kernels
+ *
+ * Reports millions of distances per second for each kernel the CPU supports,
+ * by dimension, and checks the kernels agree with the default ones.
+ *
+ * Usage: distance_bench [dim ...]
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "portability/instr_time.h"
+#include "vectorutils.h"
+
+#define BENCH_VECTORS 4096
+#define BENCH_MIN_SECONDS 0.2
+#define BENCH_TOLERANCE 1e-3
+
+typedef enum BenchOp
+{
+	BENCH_L2_SQUARED,
+	BENCH_INNER_PRODUCT,
+	BENCH_COSINE,
+	BENCH_L1,
+	BENCH_L2_SQUARED_BATCH,
+	BENCH_INNER_PRODUCT_BATCH,
+	BENCH_OPS
+}			BenchOp;
+
+static const char *const opNames[BENCH_OPS] = {
+	"l2sq", "ip", "cosine", "l1", "l2sq_batch", "ip_batch"
+};
+
+static const int defaultDims[] = {3, 16, 64, 100, 128, 256, 384, 512, 768, 1024, 1536, 2000, 4096};
+
+static float *query;
+static float *vectors[BENCH_VECTORS];
+static volatile double sink;
+
+/*
+ * Get the distances from the query to all vectors
+ */
+static void
+RunOp(BenchOp op, int dim, double *result)
+{
+	float		batch[VECTOR_BATCH_SIZE];
+
+	for (int j = 0; j < BENCH_VECTORS; j++)
+	{
+		switch (op)
+		{
+			case BENCH_L2_SQUARED:
+				result[j] = VectorL2SquaredDistance(dim, query, vectors[j]);
+				break;
+			case BENCH_INNER_PRODUCT:
+				result[j] = VectorInnerProduct(dim, query, vectors[j]);
+				break;
+			case BENCH_COSINE:
+				result[j] = VectorCosineSimilarity(dim, query, vectors[j]);
+				break;
+			case BENCH_L1:
+				result[j] = VectorL1Distance(dim, query, vectors[j]);
+				break;
+			case BENCH_L2_SQUARED_BATCH:
+			case BENCH_INNER_PRODUCT_BATCH:
+				if (op == BENCH_L2_SQUARED_BATCH)
+					VectorL2SquaredDistanceBatch(dim, query, vectors + j, VECTOR_BATCH_SIZE, batch);
+				else
+					VectorInnerProductBatch(dim, query, vectors + j, VECTOR_BATCH_SIZE, batch);
+
+				for (int k = 0; k < VECTOR_BATCH_SIZE; k++)
+					result[j + k] = batch[k];
+				j += VECTOR_BATCH_SIZE - 1;
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+/*
+ * Return millions of distances per second
+ */
+static double
+BenchOpRate(BenchOp op, int dim, double *result)
+{
+	instr_time	start,
+				duration;
+	long		rounds = 0;
+	double		seconds;
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	do
+	{
+		RunOp(op, dim, result);
+		sink += result[0];
+		rounds++;
+
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+		seconds = INSTR_TIME_GET_DOUBLE(duration);
+	} while (seconds < BENCH_MIN_SECONDS);
+
+	return (double) rounds * BENCH_VECTORS / seconds / 1e6;
+}
+
+static bool
+SameResults(double *expected, double *result)
+{
+	for (int j = 0; j < BENCH_VECTORS; j++)
+	{
+		double		scale = Max(fabs(expected[j]), 1.0);
+
+		if (fabs(expected[j] - result[j]) > BENCH_TOLERANCE * scale)
+			return false;
+	}
+
+	return true;
+}
+
+int
+main(int argc, char **argv)
+{
+	int			ndims = argc > 1 ? argc - 1 : lengthof(defaultDims);
+	VectorKernels allKernels[] = {VECTOR_KERNELS_DEFAULT, VECTOR_KERNELS_AVX2, VECTOR_KERNELS_AVX512};
+	double	   *expected = malloc(sizeof(double) * BENCH_VECTORS);
+	double	   *result = malloc(sizeof(double) * BENCH_VECTORS);
+	bool		ok = true;
+
+	StaticAssertStmt(BENCH_VECTORS % VECTOR_BATCH_SIZE == 0,
+					 "batches must cover all vectors");
+
+	srandom(42);
+
+	printf("%-8s %-8s", "dim", "kernels");
+	for (int op = 0; op < BENCH_OPS; op++)
+		printf(" %12s", opNames[op]);
+	printf("   (million distances/sec)\n");
+
+	for (int d = 0; d < ndims; d++)
+	{
+		int			dim = argc > 1 ? atoi(argv[d + 1]) : defaultDims[d];
+
+		if (dim <= 0)
+		{
+			fprintf(stderr, "invalid dimension: %s\n", argv[d + 1]);
+			return 1;
+		}
+
+		query = malloc(sizeof(float) * dim);
+		for (int i = 0; i < dim; i++)
+			query[i] = (float) random() / RAND_MAX - 0.5f;
+
+		for (int j = 0; j < BENCH_VECTORS; j++)
+		{
+			vectors[j] = malloc(sizeof(float) * dim);
+			for (int i = 0; i < dim; i++)
+				vectors[j][i] = (float) random() / RAND_MAX - 0.5f;
+		}
+
+		for (int k = 0; k < lengthof(allKernels); k++)
+		{
+			if (!VectorSetKernels(allKernels[k]))
+				continue;
+
+			printf("%-8d %-8s", dim, VectorKernelsName(allKernels[k]));
+
+			for (int op = 0; op < BENCH_OPS; op++)
+			{
+				double		rate = BenchOpRate(op, dim, result);
+
+				/* Compare with the default kernels */
+				VectorSetKernels(VECTOR_KERNELS_DEFAULT);
+				RunOp(op, dim, expected);
+				VectorSetKernels(allKernels[k]);
+
+				if (!SameResults(expected, result))
+				{
+					fprintf(stderr, "%s kernel %s differs from default with dim %d\n",
+							VectorKernelsName(allKernels[k]), opNames[op], dim);
+					ok = false;
+				}
+
+				printf(" %12.2f", rate);
+			}
+
+			printf("\n");
+		}
+
+		for (int j = 0; j < BENCH_VECTORS; j++)
+			free(vectors[j]);
+		free(query);
+	}
+
+	free(expected);
+	free(result);
+
+	return ok ? 0 : 1;
+}
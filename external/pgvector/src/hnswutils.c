@@ -592,6 +592,25 @@ GetCandidateDistance(char *base, HnswCandidate * hc, Datum q, FmgrInfo *procinfo
 	return DatumGetFloat8(FunctionCall2Coll(procinfo, collation, q, value));
 }
 
+/*
+ * Get the distances for candidates, in one batch when possible
+ */
+static void
+GetCandidateDistances(char *base, HnswCandidate * *candidates, int n, Datum q, FmgrInfo *procinfo, Oid collation, VectorBatchDistance batchDistance, Datum *values, double *distances)
+{
+	if (batchDistance == NULL)
+	{
+		for (int i = 0; i < n; i++)
+			distances[i] = GetCandidateDistance(base, candidates[i], q, procinfo, collation);
+		return;
+	}
+
+	for (int i = 0; i < n; i++)
+		values[i] = HnswGetValue(base, HnswPtrAccess(base, candidates[i]->element));
+
+	batchDistance(q, values, n, distances);
+}
+
 /*
  * Create a candidate for the entry point
  */
@@ -732,14 +751,24 @@ HnswSearchLayer(char *base, Datum q, List *ep, int ef, int lc, Relation index, F
 	ListCell   *lc2;
 	HnswNeighborArray *neighborhoodData = NULL;
 	Size		neighborhoodSize;
+	int			lm = HnswGetLayerM(m, lc);
+	HnswCandidate **unvisited = palloc(sizeof(HnswCandidate *) * lm);
+	VectorBatchDistance batchDistance = NULL;
+	Datum	   *values = NULL;
+	double	   *distances = NULL;
 
 	InitVisited(base, &v, index, ef, m);
 
 	/* Create local memory for neighborhood if needed */
 	if (index == NULL)
 	{
-		neighborhoodSize = HNSW_NEIGHBOR_ARRAY_SIZE(HnswGetLayerM(m, lc));
+		neighborhoodSize = HNSW_NEIGHBOR_ARRAY_SIZE(lm);
 		neighborhoodData = palloc(neighborhoodSize);
+
+		/* Values are in memory, so get distances of neighbors in a batch */
+		batchDistance = VectorGetBatchDistance(procinfo);
+		values = palloc(sizeof(Datum) * lm);
+		distances = palloc(sizeof(double) * lm);
 	}
 
 	/* Add entry points to v, C, and W */
@@ -768,6 +797,7 @@ HnswSearchLayer(char *base, Datum q, List *ep, int ef, int lc, Relation index, F
 		HnswCandidate *c = ((HnswPairingHeapNode *) pairingheap_remove_first(C))->inner;
 		HnswCandidate *f = ((HnswPairingHeapNode *) pairingheap_first(W))->inner;
 		HnswElement cElement;
+		int			nunvisited;
 
 		if (c->distance > f->distance)
 			break;
@@ -789,6 +819,7 @@ HnswSearchLayer(char *base, Datum q, List *ep, int ef, int lc, Relation index, F
 			neighborhood = neighborhoodData;
 		}
 
+		nunvisited = 0;
 		for (int i = 0; i < neighborhood->length; i++)
 		{
 			HnswCandidate *e = &neighborhood->items[i];
@@ -797,47 +828,54 @@ HnswSearchLayer(char *base, Datum q, List *ep, int ef, int lc, Relation index, F
 			AddToVisited(base, &v, e, index, &visited);
 
 			if (!visited)
-			{
-				float		eDistance;
-				HnswElement eElement = HnswPtrAccess(base, e->element);
+				unvisited[nunvisited++] = e;
+		}
 
-				f = ((HnswPairingHeapNode *) pairingheap_first(W))->inner;
+		if (index == NULL)
+			GetCandidateDistances(base, unvisited, nunvisited, q, procinfo, collation, batchDistance, values, distances);
 
-				if (index == NULL)
-					eDistance = GetCandidateDistance(base, e, q, procinfo, collation);
-				else
-					HnswLoadElement(eElement, &eDistance, &q, index, procinfo, collation, inserting);
+		for (int i = 0; i < nunvisited; i++)
+		{
+			HnswCandidate *e = unvisited[i];
+			float		eDistance;
+			HnswElement eElement = HnswPtrAccess(base, e->element);
 
-				Assert(!eElement->deleted);
+			f = ((HnswPairingHeapNode *) pairingheap_first(W))->inner;
 
-				/* Make robust to issues */
-				if (eElement->level < lc)
-					continue;
+			if (index == NULL)
+				eDistance = distances[i];
+			else
+				HnswLoadElement(eElement, &eDistance, &q, index, procinfo, collation, inserting);
 
-				if (eDistance < f->distance || wlen < ef)
+			Assert(!eElement->deleted);
+
+			/* Make robust to issues */
+			if (eElement->level < lc)
+				continue;
+
+			if (eDistance < f->distance || wlen < ef)
+			{
+				/* Copy e */
+				HnswCandidate *ec = palloc(sizeof(HnswCandidate));
+
+				HnswPtrStore(base, ec->element, eElement);
+				ec->distance = eDistance;
+
+				pairingheap_add(C, &(CreatePairingHeapNode(ec)->ph_node));
+				pairingheap_add(W, &(CreatePairingHeapNode(ec)->ph_node));
+
+				/*
+				 * Do not count elements being deleted towards ef when
+				 * vacuuming. It would be ideal to do this for inserts as
+				 * well, but this could affect insert performance.
+				 */
+				if (CountElement(base, skipElement, e))
 				{
-					/* Copy e */
-					HnswCandidate *ec = palloc(sizeof(HnswCandidate));
-
-					HnswPtrStore(base, ec->element, eElement);
-					ec->distance = eDistance;
-
-					pairingheap_add(C, &(CreatePairingHeapNode(ec)->ph_node));
-					pairingheap_add(W, &(CreatePairingHeapNode(ec)->ph_node));
-
-					/*
-					 * Do not count elements being deleted towards ef when
-					 * vacuuming. It would be ideal to do this for inserts as
-					 * well, but this could affect insert performance.
-					 */
-					if (CountElement(base, skipElement, e))
-					{
-						wlen++;
-
-						/* No need to decrement wlen */
-						if (wlen > ef)
-							pairingheap_remove_first(W);
-					}
+					wlen++;
+
+					/* No need to decrement wlen */
+					if (wlen > ef)
+						pairingheap_remove_first(W);
 				}
 			}
 		}
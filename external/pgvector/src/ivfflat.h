@@ -248,6 +248,7 @@ typedef struct IvfflatScanOpaqueData
 	FmgrInfo   *procinfo;
 	FmgrInfo   *normprocinfo;
 	Oid			collation;
+	VectorBatchDistance batchDistance;
 
 	/* Lists */
 	pairingheap *listQueue;
@@ -36,6 +36,8 @@ GetScanLists(IndexScanDesc scan, Datum value)
 	BlockNumber nextblkno = IVFFLAT_HEAD_BLKNO;
 	int			listCount = 0;
 	double		maxDistance = DBL_MAX;
+	Datum	   *values = palloc(sizeof(Datum) * MaxOffsetNumber);
+	double	   *distances = palloc(sizeof(double) * MaxOffsetNumber);
 
 	/* Search all list pages */
 	while (BlockNumberIsValid(nextblkno))
@@ -50,13 +52,29 @@ GetScanLists(IndexScanDesc scan, Datum value)
 
 		maxoffno = PageGetMaxOffsetNumber(cpage);
 
+		/* Compare the query with all centers on the page at once */
+		if (so->batchDistance != NULL)
+		{
+			for (OffsetNumber offno = FirstOffsetNumber; offno <= maxoffno; offno = OffsetNumberNext(offno))
+			{
+				IvfflatList list = (IvfflatList) PageGetItem(cpage, PageGetItemId(cpage, offno));
+
+				values[offno - FirstOffsetNumber] = PointerGetDatum(&list->center);
+			}
+
+			so->batchDistance(value, values, maxoffno, distances);
+		}
+
 		for (OffsetNumber offno = FirstOffsetNumber; offno <= maxoffno; offno = OffsetNumberNext(offno))
 		{
 			IvfflatList list = (IvfflatList) PageGetItem(cpage, PageGetItemId(cpage, offno));
 			double		distance;
 
 			/* Use procinfo from the index instead of scan key for performance */
-			distance = DatumGetFloat8(FunctionCall2Coll(so->procinfo, so->collation, PointerGetDatum(&list->center), value));
+			if (so->batchDistance != NULL)
+				distance = distances[offno - FirstOffsetNumber];
+			else
+				distance = DatumGetFloat8(FunctionCall2Coll(so->procinfo, so->collation, PointerGetDatum(&list->center), value));
 
 			if (listCount < so->probes)
 			{
@@ -95,6 +113,9 @@ GetScanLists(IndexScanDesc scan, Datum value)
 
 		UnlockReleaseBuffer(cbuf);
 	}
+
+	pfree(values);
+	pfree(distances);
 }
 
 /*
@@ -107,6 +128,8 @@ GetScanItems(IndexScanDesc scan, Datum value)
 	TupleDesc	tupdesc = RelationGetDescr(scan->indexRelation);
 	double		tuples = 0;
 	TupleTableSlot *slot = MakeSingleTupleTableSlot(so->tupdesc, &TTSOpsVirtual);
+	Datum	   *values = palloc(sizeof(Datum) * MaxIndexTuplesPerPage);
+	double	   *distances = palloc(sizeof(double) * MaxIndexTuplesPerPage);
 
 	/*
 	 * Reuse same set of shared buffers for scan
@@ -132,6 +155,21 @@ GetScanItems(IndexScanDesc scan, Datum value)
 			page = BufferGetPage(buf);
 			maxoffno = PageGetMaxOffsetNumber(page);
 
+			/* Compare the query with all vectors on the page at once */
+			if (so->batchDistance != NULL)
+			{
+				for (OffsetNumber offno = FirstOffsetNumber; offno <= maxoffno; offno = OffsetNumberNext(offno))
+				{
+					IndexTuple	itup;
+					bool		isnull;
+
+					itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offno));
+					values[offno - FirstOffsetNumber] = index_getattr(itup, 1, tupdesc, &isnull);
+				}
+
+				so->batchDistance(value, values, maxoffno, distances);
+			}
+
 			for (OffsetNumber offno = FirstOffsetNumber; offno <= maxoffno; offno = OffsetNumberNext(offno))
 			{
 				IndexTuple	itup;
@@ -140,7 +178,6 @@ GetScanItems(IndexScanDesc scan, Datum value)
 				ItemId		itemid = PageGetItemId(page, offno);
 
 				itup = (IndexTuple) PageGetItem(page, itemid);
-				datum = index_getattr(itup, 1, tupdesc, &isnull);
 
 				/*
 				 * Add virtual tuple
@@ -149,7 +186,13 @@ GetScanItems(IndexScanDesc scan, Datum value)
 				 * performance
 				 */
 				ExecClearTuple(slot);
-				slot->tts_values[0] = FunctionCall2Coll(so->procinfo, so->collation, datum, value);
+				if (so->batchDistance != NULL)
+					slot->tts_values[0] = Float8GetDatum(distances[offno - FirstOffsetNumber]);
+				else
+				{
+					datum = index_getattr(itup, 1, tupdesc, &isnull);
+					slot->tts_values[0] = FunctionCall2Coll(so->procinfo, so->collation, datum, value);
+				}
 				slot->tts_isnull[0] = false;
 				slot->tts_values[1] = PointerGetDatum(&itup->t_tid);
 				slot->tts_isnull[1] = false;
@@ -167,6 +210,8 @@ GetScanItems(IndexScanDesc scan, Datum value)
 	}
 
 	FreeAccessStrategy(bas);
+	pfree(values);
+	pfree(distances);
 
 	if (tuples < 100)
 		ereport(DEBUG1,
@@ -210,6 +255,7 @@ ivfflatbeginscan(Relation index, int nkeys, int norderbys)
 	so->procinfo = index_getprocinfo(index, 1, IVFFLAT_DISTANCE_PROC);
 	so->normprocinfo = IvfflatOptionalProcInfo(index, IVFFLAT_NORM_PROC);
 	so->collation = index->rd_indcollation[0];
+	so->batchDistance = VectorGetBatchDistance(so->procinfo);
 
 	/* Create tuple description for sorting */
 	so->tupdesc = CreateTemplateTupleDesc(2);
@@ -16,6 +16,7 @@
 #include "utils/lsyscache.h"
 #include "utils/numeric.h"
 #include "vector.h"
+#include "vectorutils.h"
 
 #if PG_VERSION_NUM >= 160000
 #include "varatt.h"
@@ -38,6 +39,7 @@ PGDLLEXPORT void _PG_init(void);
 void
 _PG_init(void)
 {
+	VectorInit();
 	HnswInit();
 	IvfflatInit();
 }
@@ -541,21 +543,10 @@ l2_distance(PG_FUNCTION_ARGS)
 {
 	Vector	   *a = PG_GETARG_VECTOR_P(0);
 	Vector	   *b = PG_GETARG_VECTOR_P(1);
-	float	   *ax = a->x;
-	float	   *bx = b->x;
-	float		distance = 0.0;
-	float		diff;
 
 	CheckDims(a, b);
 
-	/* Auto-vectorized */
-	for (int i = 0; i < a->dim; i++)
-	{
-		diff = ax[i] - bx[i];
-		distance += diff * diff;
-	}
-
-	PG_RETURN_FLOAT8(sqrt((double) distance));
+	PG_RETURN_FLOAT8(sqrt((double) VectorL2SquaredDistance(a->dim, a->x, b->x)));
 }
 
 /*
@@ -568,21 +559,10 @@ vector_l2_squared_distance(PG_FUNCTION_ARGS)
 {
 	Vector	   *a = PG_GETARG_VECTOR_P(0);
 	Vector	   *b = PG_GETARG_VECTOR_P(1);
-	float	   *ax = a->x;
-	float	   *bx = b->x;
-	float		distance = 0.0;
-	float		diff;
 
 	CheckDims(a, b);
 
-	/* Auto-vectorized */
-	for (int i = 0; i < a->dim; i++)
-	{
-		diff = ax[i] - bx[i];
-		distance += diff * diff;
-	}
-
-	PG_RETURN_FLOAT8((double) distance);
+	PG_RETURN_FLOAT8((double) VectorL2SquaredDistance(a->dim, a->x, b->x));
 }
 
 /*
@@ -594,17 +574,10 @@ inner_product(PG_FUNCTION_ARGS)
 {
 	Vector	   *a = PG_GETARG_VECTOR_P(0);
 	Vector	   *b = PG_GETARG_VECTOR_P(1);
-	float	   *ax = a->x;
-	float	   *bx = b->x;
-	float		distance = 0.0;
 
 	CheckDims(a, b);
 
-	/* Auto-vectorized */
-	for (int i = 0; i < a->dim; i++)
-		distance += ax[i] * bx[i];
-
-	PG_RETURN_FLOAT8((double) distance);
+	PG_RETURN_FLOAT8((double) VectorInnerProduct(a->dim, a->x, b->x));
 }
 
 /*
@@ -616,17 +589,10 @@ vector_negative_inner_product(PG_FUNCTION_ARGS)
 {
 	Vector	   *a = PG_GETARG_VECTOR_P(0);
 	Vector	   *b = PG_GETARG_VECTOR_P(1);
-	float	   *ax = a->x;
-	float	   *bx = b->x;
-	float		distance = 0.0;
 
 	CheckDims(a, b);
 
-	/* Auto-vectorized */
-	for (int i = 0; i < a->dim; i++)
-		distance += ax[i] * bx[i];
-
-	PG_RETURN_FLOAT8((double) distance * -1);
+	PG_RETURN_FLOAT8((double) VectorInnerProduct(a->dim, a->x, b->x) * -1);
 }
 
 /*
@@ -638,25 +604,11 @@ cosine_distance(PG_FUNCTION_ARGS)
 {
 	Vector	   *a = PG_GETARG_VECTOR_P(0);
 	Vector	   *b = PG_GETARG_VECTOR_P(1);
-	float	   *ax = a->x;
-	float	   *bx = b->x;
-	float		distance = 0.0;
-	float		norma = 0.0;
-	float		normb = 0.0;
 	double		similarity;
 
 	CheckDims(a, b);
 
-	/* Auto-vectorized */
-	for (int i = 0; i < a->dim; i++)
-	{
-		distance += ax[i] * bx[i];
-		norma += ax[i] * ax[i];
-		normb += bx[i] * bx[i];
-	}
-
-	/* Use sqrt(a * b) over sqrt(a) * sqrt(b) */
-	similarity = (double) distance / sqrt((double) norma * (double) normb);
+	similarity = VectorCosineSimilarity(a->dim, a->x, b->x);
 
 #ifdef _MSC_VER
 	/* /fp:fast may not propagate NaN */
@@ -684,18 +636,11 @@ vector_spherical_distance(PG_FUNCTION_ARGS)
 {
 	Vector	   *a = PG_GETARG_VECTOR_P(0);
 	Vector	   *b = PG_GETARG_VECTOR_P(1);
-	float	   *ax = a->x;
-	float	   *bx = b->x;
-	float		dp = 0.0;
 	double		distance;
 
 	CheckDims(a, b);
 
-	/* Auto-vectorized */
-	for (int i = 0; i < a->dim; i++)
-		dp += ax[i] * bx[i];
-
-	distance = (double) dp;
+	distance = (double) VectorInnerProduct(a->dim, a->x, b->x);
 
 	/* Prevent NaN with acos with loss of precision */
 	if (distance > 1)
@@ -715,17 +660,85 @@ l1_distance(PG_FUNCTION_ARGS)
 {
 	Vector	   *a = PG_GETARG_VECTOR_P(0);
 	Vector	   *b = PG_GETARG_VECTOR_P(1);
-	float	   *ax = a->x;
-	float	   *bx = b->x;
-	float		distance = 0.0;
 
 	CheckDims(a, b);
 
-	/* Auto-vectorized */
-	for (int i = 0; i < a->dim; i++)
-		distance += fabsf(ax[i] - bx[i]);
+	PG_RETURN_FLOAT8((double) VectorL1Distance(a->dim, a->x, b->x));
+}
+
+/*
+ * Get the L2 squared distances from q to a batch of vectors
+ */
+static void
+vector_l2_squared_distance_batch(Datum q, Datum *values, int n, double *distances)
+{
+	Vector	   *a = DatumGetVector(q);
+	float	   *x[VECTOR_BATCH_SIZE];
+	float		batch[VECTOR_BATCH_SIZE];
+
+	for (int start = 0; start < n; start += VECTOR_BATCH_SIZE)
+	{
+		int			count = Min(n - start, VECTOR_BATCH_SIZE);
+
+		for (int j = 0; j < count; j++)
+		{
+			Vector	   *b = DatumGetVector(values[start + j]);
+
+			CheckDims(a, b);
+			x[j] = b->x;
+		}
+
+		VectorL2SquaredDistanceBatch(a->dim, a->x, x, count, batch);
+
+		for (int j = 0; j < count; j++)
+			distances[start + j] = (double) batch[j];
+	}
+}
+
+/*
+ * Get the negative inner products of q and a batch of vectors
+ */
+static void
+vector_negative_inner_product_batch(Datum q, Datum *values, int n, double *distances)
+{
+	Vector	   *a = DatumGetVector(q);
+	float	   *x[VECTOR_BATCH_SIZE];
+	float		batch[VECTOR_BATCH_SIZE];
+
+	for (int start = 0; start < n; start += VECTOR_BATCH_SIZE)
+	{
+		int			count = Min(n - start, VECTOR_BATCH_SIZE);
+
+		for (int j = 0; j < count; j++)
+		{
+			Vector	   *b = DatumGetVector(values[start + j]);
+
+			CheckDims(a, b);
+			x[j] = b->x;
+		}
+
+		VectorInnerProductBatch(a->dim, a->x, x, count, batch);
+
+		for (int j = 0; j < count; j++)
+			distances[start + j] = (double) batch[j] * -1;
+	}
+}
+
+/*
+ * Get the batched form of an index distance function, so index scans can
+ * compare the query with many vectors in one call.  Returns NULL if the
+ * function has none, and callers fall back to calling it one by one.
+ */
+VectorBatchDistance
+VectorGetBatchDistance(FmgrInfo *procinfo)
+{
+	if (procinfo->fn_addr == vector_l2_squared_distance)
+		return vector_l2_squared_distance_batch;
+
+	if (procinfo->fn_addr == vector_negative_inner_product)
+		return vector_negative_inner_product_batch;
 
-	PG_RETURN_FLOAT8((double) distance);
+	return NULL;
 }
 
 /*
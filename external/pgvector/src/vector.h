@@ -1,6 +1,8 @@
 #ifndef VECTOR_H
 #define VECTOR_H
 
+#include "fmgr.h"
+
 #define VECTOR_MAX_DIM 16000
 
 #define VECTOR_SIZE(_dim)		(offsetof(Vector, x) + sizeof(float)*(_dim))
@@ -16,8 +18,12 @@ typedef struct Vector
 	float		x[FLEXIBLE_ARRAY_MEMBER];
 }			Vector;
 
+/* Distances from q to n vectors, see VectorGetBatchDistance() */
+typedef void (*VectorBatchDistance) (Datum q, Datum *values, int n, double *distances);
+
 Vector	   *InitVector(int dim);
 void		PrintVector(char *msg, Vector * vector);
 int			vector_cmp_internal(Vector * a, Vector * b);
+VectorBatchDistance VectorGetBatchDistance(FmgrInfo *procinfo);
 
 #endif
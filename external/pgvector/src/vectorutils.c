@@ -0,0 +1,683 @@
+#include "postgres.h"
+
+#include <math.h>
+
+#include "vectorutils.h"
+
+/*
+ * Kernels for AVX2 and AVX-512 are compiled with target attributes, so the
+ * extension still runs on any x86-64 CPU and picks them at load time.
+ */
+#if defined(__x86_64__) && defined(HAVE__GET_CPUID) && defined(__GNUC__)
+#define VECTOR_DISPATCH
+#endif
+
+#ifdef VECTOR_DISPATCH
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+
+/* CPUID.1:ECX */
+#define CPU_FEATURE_FMA		(1 << 12)
+#define CPU_FEATURE_OSXSAVE	(1 << 27)
+#define CPU_FEATURE_AVX		(1 << 28)
+
+/* CPUID.(EAX=7,ECX=0):EBX */
+#define CPU_FEATURE_AVX2	(1 << 5)
+#define CPU_FEATURE_AVX512F	(1 << 16)
+
+/* XCR0: SSE and AVX state, plus opmask and ZMM state for AVX-512 */
+#define XSTATE_AVX			0x06
+#define XSTATE_AVX512		0xE6
+#endif
+
+static float
+VectorL2SquaredDistanceDefault(int dim, float *ax, float *bx)
+{
+	float		distance = 0.0;
+
+	/* Auto-vectorized */
+	for (int i = 0; i < dim; i++)
+	{
+		float		diff = ax[i] - bx[i];
+
+		distance += diff * diff;
+	}
+
+	return distance;
+}
+
+static float
+VectorInnerProductDefault(int dim, float *ax, float *bx)
+{
+	float		distance = 0.0;
+
+	/* Auto-vectorized */
+	for (int i = 0; i < dim; i++)
+		distance += ax[i] * bx[i];
+
+	return distance;
+}
+
+static double
+VectorCosineSimilarityDefault(int dim, float *ax, float *bx)
+{
+	float		similarity = 0.0;
+	float		norma = 0.0;
+	float		normb = 0.0;
+
+	/* Auto-vectorized */
+	for (int i = 0; i < dim; i++)
+	{
+		similarity += ax[i] * bx[i];
+		norma += ax[i] * ax[i];
+		normb += bx[i] * bx[i];
+	}
+
+	/* Use sqrt(a * b) over sqrt(a) * sqrt(b) */
+	return (double) similarity / sqrt((double) norma * (double) normb);
+}
+
+static float
+VectorL1DistanceDefault(int dim, float *ax, float *bx)
+{
+	float		distance = 0.0;
+
+	/* Auto-vectorized */
+	for (int i = 0; i < dim; i++)
+		distance += fabsf(ax[i] - bx[i]);
+
+	return distance;
+}
+
+static void
+VectorL2SquaredDistanceBatchDefault(int dim, float *q, float **x, int n, float *distances)
+{
+	for (int j = 0; j < n; j++)
+		distances[j] = VectorL2SquaredDistanceDefault(dim, q, x[j]);
+}
+
+static void
+VectorInnerProductBatchDefault(int dim, float *q, float **x, int n, float *distances)
+{
+	for (int j = 0; j < n; j++)
+		distances[j] = VectorInnerProductDefault(dim, q, x[j]);
+}
+
+/* Usable before VectorInit() picks the kernels for this CPU */
+float		(*VectorL2SquaredDistance) (int dim, float *ax, float *bx) = VectorL2SquaredDistanceDefault;
+float		(*VectorInnerProduct) (int dim, float *ax, float *bx) = VectorInnerProductDefault;
+double		(*VectorCosineSimilarity) (int dim, float *ax, float *bx) = VectorCosineSimilarityDefault;
+float		(*VectorL1Distance) (int dim, float *ax, float *bx) = VectorL1DistanceDefault;
+void		(*VectorL2SquaredDistanceBatch) (int dim, float *q, float **x, int n, float *distances) = VectorL2SquaredDistanceBatchDefault;
+void		(*VectorInnerProductBatch) (int dim, float *q, float **x, int n, float *distances) = VectorInnerProductBatchDefault;
+
+#ifdef VECTOR_DISPATCH
+TARGET_AVX2 static inline float
+HorizontalSumAvx2(__m256 v)
+{
+	__m128		sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+
+	sum = _mm_hadd_ps(sum, sum);
+	sum = _mm_hadd_ps(sum, sum);
+
+	return _mm_cvtss_f32(sum);
+}
+
+TARGET_AVX2 static float
+VectorL2SquaredDistanceAvx2(int dim, float *ax, float *bx)
+{
+	__m256		dist0 = _mm256_setzero_ps();
+	__m256		dist1 = _mm256_setzero_ps();
+	float		distance;
+	int			i = 0;
+
+	/* Two accumulators to hide the latency of FMA */
+	for (; i + 16 <= dim; i += 16)
+	{
+		__m256		diff0 = _mm256_sub_ps(_mm256_loadu_ps(ax + i), _mm256_loadu_ps(bx + i));
+		__m256		diff1 = _mm256_sub_ps(_mm256_loadu_ps(ax + i + 8), _mm256_loadu_ps(bx + i + 8));
+
+		dist0 = _mm256_fmadd_ps(diff0, diff0, dist0);
+		dist1 = _mm256_fmadd_ps(diff1, diff1, dist1);
+	}
+
+	for (; i + 8 <= dim; i += 8)
+	{
+		__m256		diff = _mm256_sub_ps(_mm256_loadu_ps(ax + i), _mm256_loadu_ps(bx + i));
+
+		dist0 = _mm256_fmadd_ps(diff, diff, dist0);
+	}
+
+	distance = HorizontalSumAvx2(_mm256_add_ps(dist0, dist1));
+
+	for (; i < dim; i++)
+	{
+		float		diff = ax[i] - bx[i];
+
+		distance += diff * diff;
+	}
+
+	return distance;
+}
+
+TARGET_AVX2 static float
+VectorInnerProductAvx2(int dim, float *ax, float *bx)
+{
+	__m256		dist0 = _mm256_setzero_ps();
+	__m256		dist1 = _mm256_setzero_ps();
+	float		distance;
+	int			i = 0;
+
+	for (; i + 16 <= dim; i += 16)
+	{
+		dist0 = _mm256_fmadd_ps(_mm256_loadu_ps(ax + i), _mm256_loadu_ps(bx + i), dist0);
+		dist1 = _mm256_fmadd_ps(_mm256_loadu_ps(ax + i + 8), _mm256_loadu_ps(bx + i + 8), dist1);
+	}
+
+	for (; i + 8 <= dim; i += 8)
+		dist0 = _mm256_fmadd_ps(_mm256_loadu_ps(ax + i), _mm256_loadu_ps(bx + i), dist0);
+
+	distance = HorizontalSumAvx2(_mm256_add_ps(dist0, dist1));
+
+	for (; i < dim; i++)
+		distance += ax[i] * bx[i];
+
+	return distance;
+}
+
+TARGET_AVX2 static double
+VectorCosineSimilarityAvx2(int dim, float *ax, float *bx)
+{
+	__m256		simv = _mm256_setzero_ps();
+	__m256		normav = _mm256_setzero_ps();
+	__m256		normbv = _mm256_setzero_ps();
+	float		similarity;
+	float		norma;
+	float		normb;
+	int			i = 0;
+
+	for (; i + 8 <= dim; i += 8)
+	{
+		__m256		a = _mm256_loadu_ps(ax + i);
+		__m256		b = _mm256_loadu_ps(bx + i);
+
+		simv = _mm256_fmadd_ps(a, b, simv);
+		normav = _mm256_fmadd_ps(a, a, normav);
+		normbv = _mm256_fmadd_ps(b, b, normbv);
+	}
+
+	similarity = HorizontalSumAvx2(simv);
+	norma = HorizontalSumAvx2(normav);
+	normb = HorizontalSumAvx2(normbv);
+
+	for (; i < dim; i++)
+	{
+		similarity += ax[i] * bx[i];
+		norma += ax[i] * ax[i];
+		normb += bx[i] * bx[i];
+	}
+
+	/* Use sqrt(a * b) over sqrt(a) * sqrt(b) */
+	return (double) similarity / sqrt((double) norma * (double) normb);
+}
+
+TARGET_AVX2 static float
+VectorL1DistanceAvx2(int dim, float *ax, float *bx)
+{
+	__m256		signmask = _mm256_set1_ps(-0.0f);
+	__m256		dist0 = _mm256_setzero_ps();
+	__m256		dist1 = _mm256_setzero_ps();
+	float		distance;
+	int			i = 0;
+
+	for (; i + 16 <= dim; i += 16)
+	{
+		__m256		diff0 = _mm256_sub_ps(_mm256_loadu_ps(ax + i), _mm256_loadu_ps(bx + i));
+		__m256		diff1 = _mm256_sub_ps(_mm256_loadu_ps(ax + i + 8), _mm256_loadu_ps(bx + i + 8));
+
+		dist0 = _mm256_add_ps(dist0, _mm256_andnot_ps(signmask, diff0));
+		dist1 = _mm256_add_ps(dist1, _mm256_andnot_ps(signmask, diff1));
+	}
+
+	for (; i + 8 <= dim; i += 8)
+	{
+		__m256		diff = _mm256_sub_ps(_mm256_loadu_ps(ax + i), _mm256_loadu_ps(bx + i));
+
+		dist0 = _mm256_add_ps(dist0, _mm256_andnot_ps(signmask, diff));
+	}
+
+	distance = HorizontalSumAvx2(_mm256_add_ps(dist0, dist1));
+
+	for (; i < dim; i++)
+		distance += fabsf(ax[i] - bx[i]);
+
+	return distance;
+}
+
+/*
+ * Compare the query with four vectors at a time, so each chunk of the query
+ * is loaded once for all of them
+ */
+TARGET_AVX2 static void
+VectorL2SquaredDistanceBatchAvx2(int dim, float *q, float **x, int n, float *distances)
+{
+	int			j = 0;
+
+	for (; j + 4 <= n; j += 4)
+	{
+		float	   *x0 = x[j];
+		float	   *x1 = x[j + 1];
+		float	   *x2 = x[j + 2];
+		float	   *x3 = x[j + 3];
+		__m256		dist0 = _mm256_setzero_ps();
+		__m256		dist1 = _mm256_setzero_ps();
+		__m256		dist2 = _mm256_setzero_ps();
+		__m256		dist3 = _mm256_setzero_ps();
+		int			i = 0;
+
+		for (; i + 8 <= dim; i += 8)
+		{
+			__m256		qv = _mm256_loadu_ps(q + i);
+			__m256		diff0 = _mm256_sub_ps(qv, _mm256_loadu_ps(x0 + i));
+			__m256		diff1 = _mm256_sub_ps(qv, _mm256_loadu_ps(x1 + i));
+			__m256		diff2 = _mm256_sub_ps(qv, _mm256_loadu_ps(x2 + i));
+			__m256		diff3 = _mm256_sub_ps(qv, _mm256_loadu_ps(x3 + i));
+
+			dist0 = _mm256_fmadd_ps(diff0, diff0, dist0);
+			dist1 = _mm256_fmadd_ps(diff1, diff1, dist1);
+			dist2 = _mm256_fmadd_ps(diff2, diff2, dist2);
+			dist3 = _mm256_fmadd_ps(diff3, diff3, dist3);
+		}
+
+		distances[j] = HorizontalSumAvx2(dist0);
+		distances[j + 1] = HorizontalSumAvx2(dist1);
+		distances[j + 2] = HorizontalSumAvx2(dist2);
+		distances[j + 3] = HorizontalSumAvx2(dist3);
+
+		for (; i < dim; i++)
+		{
+			float		diff0 = q[i] - x0[i];
+			float		diff1 = q[i] - x1[i];
+			float		diff2 = q[i] - x2[i];
+			float		diff3 = q[i] - x3[i];
+
+			distances[j] += diff0 * diff0;
+			distances[j + 1] += diff1 * diff1;
+			distances[j + 2] += diff2 * diff2;
+			distances[j + 3] += diff3 * diff3;
+		}
+	}
+
+	for (; j < n; j++)
+		distances[j] = VectorL2SquaredDistanceAvx2(dim, q, x[j]);
+}
+
+TARGET_AVX2 static void
+VectorInnerProductBatchAvx2(int dim, float *q, float **x, int n, float *distances)
+{
+	int			j = 0;
+
+	for (; j + 4 <= n; j += 4)
+	{
+		float	   *x0 = x[j];
+		float	   *x1 = x[j + 1];
+		float	   *x2 = x[j + 2];
+		float	   *x3 = x[j + 3];
+		__m256		dist0 = _mm256_setzero_ps();
+		__m256		dist1 = _mm256_setzero_ps();
+		__m256		dist2 = _mm256_setzero_ps();
+		__m256		dist3 = _mm256_setzero_ps();
+		int			i = 0;
+
+		for (; i + 8 <= dim; i += 8)
+		{
+			__m256		qv = _mm256_loadu_ps(q + i);
+
+			dist0 = _mm256_fmadd_ps(qv, _mm256_loadu_ps(x0 + i), dist0);
+			dist1 = _mm256_fmadd_ps(qv, _mm256_loadu_ps(x1 + i), dist1);
+			dist2 = _mm256_fmadd_ps(qv, _mm256_loadu_ps(x2 + i), dist2);
+			dist3 = _mm256_fmadd_ps(qv, _mm256_loadu_ps(x3 + i), dist3);
+		}
+
+		distances[j] = HorizontalSumAvx2(dist0);
+		distances[j + 1] = HorizontalSumAvx2(dist1);
+		distances[j + 2] = HorizontalSumAvx2(dist2);
+		distances[j + 3] = HorizontalSumAvx2(dist3);
+
+		for (; i < dim; i++)
+		{
+			distances[j] += q[i] * x0[i];
+			distances[j + 1] += q[i] * x1[i];
+			distances[j + 2] += q[i] * x2[i];
+			distances[j + 3] += q[i] * x3[i];
+		}
+	}
+
+	for (; j < n; j++)
+		distances[j] = VectorInnerProductAvx2(dim, q, x[j]);
+}
+
+/* Mask of the first n lanes, n is less than 16 */
+#define TAIL_MASK(n) ((__mmask16) ((1U << (n)) - 1))
+
+TARGET_AVX512 static float
+VectorL2SquaredDistanceAvx512(int dim, float *ax, float *bx)
+{
+	__m512		dist0 = _mm512_setzero_ps();
+	__m512		dist1 = _mm512_setzero_ps();
+	int			i = 0;
+
+	for (; i + 32 <= dim; i += 32)
+	{
+		__m512		diff0 = _mm512_sub_ps(_mm512_loadu_ps(ax + i), _mm512_loadu_ps(bx + i));
+		__m512		diff1 = _mm512_sub_ps(_mm512_loadu_ps(ax + i + 16), _mm512_loadu_ps(bx + i + 16));
+
+		dist0 = _mm512_fmadd_ps(diff0, diff0, dist0);
+		dist1 = _mm512_fmadd_ps(diff1, diff1, dist1);
+	}
+
+	for (; i + 16 <= dim; i += 16)
+	{
+		__m512		diff = _mm512_sub_ps(_mm512_loadu_ps(ax + i), _mm512_loadu_ps(bx + i));
+
+		dist0 = _mm512_fmadd_ps(diff, diff, dist0);
+	}
+
+	/* Masked loads read nothing past the end */
+	if (i < dim)
+	{
+		__mmask16	mask = TAIL_MASK(dim - i);
+		__m512		diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, ax + i), _mm512_maskz_loadu_ps(mask, bx + i));
+
+		dist1 = _mm512_fmadd_ps(diff, diff, dist1);
+	}
+
+	return _mm512_reduce_add_ps(_mm512_add_ps(dist0, dist1));
+}
+
+TARGET_AVX512 static float
+VectorInnerProductAvx512(int dim, float *ax, float *bx)
+{
+	__m512		dist0 = _mm512_setzero_ps();
+	__m512		dist1 = _mm512_setzero_ps();
+	int			i = 0;
+
+	for (; i + 32 <= dim; i += 32)
+	{
+		dist0 = _mm512_fmadd_ps(_mm512_loadu_ps(ax + i), _mm512_loadu_ps(bx + i), dist0);
+		dist1 = _mm512_fmadd_ps(_mm512_loadu_ps(ax + i + 16), _mm512_loadu_ps(bx + i + 16), dist1);
+	}
+
+	for (; i + 16 <= dim; i += 16)
+		dist0 = _mm512_fmadd_ps(_mm512_loadu_ps(ax + i), _mm512_loadu_ps(bx + i), dist0);
+
+	if (i < dim)
+	{
+		__mmask16	mask = TAIL_MASK(dim - i);
+
+		dist1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, ax + i), _mm512_maskz_loadu_ps(mask, bx + i), dist1);
+	}
+
+	return _mm512_reduce_add_ps(_mm512_add_ps(dist0, dist1));
+}
+
+TARGET_AVX512 static double
+VectorCosineSimilarityAvx512(int dim, float *ax, float *bx)
+{
+	__m512		simv = _mm512_setzero_ps();
+	__m512		normav = _mm512_setzero_ps();
+	__m512		normbv = _mm512_setzero_ps();
+	float		similarity;
+	float		norma;
+	float		normb;
+	int			i = 0;
+
+	for (; i < dim; i += 16)
+	{
+		__mmask16	mask = dim - i >= 16 ? (__mmask16) 0xFFFF : TAIL_MASK(dim - i);
+		__m512		a = _mm512_maskz_loadu_ps(mask, ax + i);
+		__m512		b = _mm512_maskz_loadu_ps(mask, bx + i);
+
+		simv = _mm512_fmadd_ps(a, b, simv);
+		normav = _mm512_fmadd_ps(a, a, normav);
+		normbv = _mm512_fmadd_ps(b, b, normbv);
+	}
+
+	similarity = _mm512_reduce_add_ps(simv);
+	norma = _mm512_reduce_add_ps(normav);
+	normb = _mm512_reduce_add_ps(normbv);
+
+	/* Use sqrt(a * b) over sqrt(a) * sqrt(b) */
+	return (double) similarity / sqrt((double) norma * (double) normb);
+}
+
+TARGET_AVX512 static float
+VectorL1DistanceAvx512(int dim, float *ax, float *bx)
+{
+	__m512		dist0 = _mm512_setzero_ps();
+	__m512		dist1 = _mm512_setzero_ps();
+	int			i = 0;
+
+	for (; i + 32 <= dim; i += 32)
+	{
+		__m512		diff0 = _mm512_sub_ps(_mm512_loadu_ps(ax + i), _mm512_loadu_ps(bx + i));
+		__m512		diff1 = _mm512_sub_ps(_mm512_loadu_ps(ax + i + 16), _mm512_loadu_ps(bx + i + 16));
+
+		dist0 = _mm512_add_ps(dist0, _mm512_abs_ps(diff0));
+		dist1 = _mm512_add_ps(dist1, _mm512_abs_ps(diff1));
+	}
+
+	for (; i < dim; i += 16)
+	{
+		__mmask16	mask = dim - i >= 16 ? (__mmask16) 0xFFFF : TAIL_MASK(dim - i);
+		__m512		diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, ax + i), _mm512_maskz_loadu_ps(mask, bx + i));
+
+		dist0 = _mm512_add_ps(dist0, _mm512_abs_ps(diff));
+	}
+
+	return _mm512_reduce_add_ps(_mm512_add_ps(dist0, dist1));
+}
+
+TARGET_AVX512 static void
+VectorL2SquaredDistanceBatchAvx512(int dim, float *q, float **x, int n, float *distances)
+{
+	int			j = 0;
+
+	for (; j + 4 <= n; j += 4)
+	{
+		float	   *x0 = x[j];
+		float	   *x1 = x[j + 1];
+		float	   *x2 = x[j + 2];
+		float	   *x3 = x[j + 3];
+		__m512		dist0 = _mm512_setzero_ps();
+		__m512		dist1 = _mm512_setzero_ps();
+		__m512		dist2 = _mm512_setzero_ps();
+		__m512		dist3 = _mm512_setzero_ps();
+
+		for (int i = 0; i < dim; i += 16)
+		{
+			__mmask16	mask = dim - i >= 16 ? (__mmask16) 0xFFFF : TAIL_MASK(dim - i);
+			__m512		qv = _mm512_maskz_loadu_ps(mask, q + i);
+			__m512		diff0 = _mm512_sub_ps(qv, _mm512_maskz_loadu_ps(mask, x0 + i));
+			__m512		diff1 = _mm512_sub_ps(qv, _mm512_maskz_loadu_ps(mask, x1 + i));
+			__m512		diff2 = _mm512_sub_ps(qv, _mm512_maskz_loadu_ps(mask, x2 + i));
+			__m512		diff3 = _mm512_sub_ps(qv, _mm512_maskz_loadu_ps(mask, x3 + i));
+
+			dist0 = _mm512_fmadd_ps(diff0, diff0, dist0);
+			dist1 = _mm512_fmadd_ps(diff1, diff1, dist1);
+			dist2 = _mm512_fmadd_ps(diff2, diff2, dist2);
+			dist3 = _mm512_fmadd_ps(diff3, diff3, dist3);
+		}
+
+		distances[j] = _mm512_reduce_add_ps(dist0);
+		distances[j + 1] = _mm512_reduce_add_ps(dist1);
+		distances[j + 2] = _mm512_reduce_add_ps(dist2);
+		distances[j + 3] = _mm512_reduce_add_ps(dist3);
+	}
+
+	for (; j < n; j++)
+		distances[j] = VectorL2SquaredDistanceAvx512(dim, q, x[j]);
+}
+
+TARGET_AVX512 static void
+VectorInnerProductBatchAvx512(int dim, float *q, float **x, int n, float *distances)
+{
+	int			j = 0;
+
+	for (; j + 4 <= n; j += 4)
+	{
+		float	   *x0 = x[j];
+		float	   *x1 = x[j + 1];
+		float	   *x2 = x[j + 2];
+		float	   *x3 = x[j + 3];
+		__m512		dist0 = _mm512_setzero_ps();
+		__m512		dist1 = _mm512_setzero_ps();
+		__m512		dist2 = _mm512_setzero_ps();
+		__m512		dist3 = _mm512_setzero_ps();
+
+		for (int i = 0; i < dim; i += 16)
+		{
+			__mmask16	mask = dim - i >= 16 ? (__mmask16) 0xFFFF : TAIL_MASK(dim - i);
+			__m512		qv = _mm512_maskz_loadu_ps(mask, q + i);
+
+			dist0 = _mm512_fmadd_ps(qv, _mm512_maskz_loadu_ps(mask, x0 + i), dist0);
+			dist1 = _mm512_fmadd_ps(qv, _mm512_maskz_loadu_ps(mask, x1 + i), dist1);
+			dist2 = _mm512_fmadd_ps(qv, _mm512_maskz_loadu_ps(mask, x2 + i), dist2);
+			dist3 = _mm512_fmadd_ps(qv, _mm512_maskz_loadu_ps(mask, x3 + i), dist3);
+		}
+
+		distances[j] = _mm512_reduce_add_ps(dist0);
+		distances[j + 1] = _mm512_reduce_add_ps(dist1);
+		distances[j + 2] = _mm512_reduce_add_ps(dist2);
+		distances[j + 3] = _mm512_reduce_add_ps(dist3);
+	}
+
+	for (; j < n; j++)
+		distances[j] = VectorInnerProductAvx512(dim, q, x[j]);
+}
+
+static unsigned int
+GetXState(void)
+{
+	unsigned int eax;
+	unsigned int edx;
+
+	/* xgetbv with ECX = 0 reads XCR0 */
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+
+	return eax;
+}
+
+/*
+ * Check the CPU supports the kernels, and the OS saves the registers they
+ * use on context switches
+ */
+static bool
+SupportsKernels(VectorKernels kernels)
+{
+	unsigned int eax,
+				ebx,
+				ecx,
+				edx;
+	unsigned int xstate;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+
+	if ((ecx & (CPU_FEATURE_FMA | CPU_FEATURE_OSXSAVE | CPU_FEATURE_AVX)) !=
+		(CPU_FEATURE_FMA | CPU_FEATURE_OSXSAVE | CPU_FEATURE_AVX))
+		return false;
+
+	if (__get_cpuid_max(0, NULL) < 7)
+		return false;
+
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	xstate = GetXState();
+
+	if (kernels == VECTOR_KERNELS_AVX2)
+		return (ebx & CPU_FEATURE_AVX2) && (xstate & XSTATE_AVX) == XSTATE_AVX;
+
+	return (ebx & CPU_FEATURE_AVX2) && (ebx & CPU_FEATURE_AVX512F) &&
+		(xstate & XSTATE_AVX512) == XSTATE_AVX512;
+}
+#endif
+
+/*
+ * Use the given kernels, return false if the CPU does not support them
+ */
+bool
+VectorSetKernels(VectorKernels kernels)
+{
+	switch (kernels)
+	{
+		case VECTOR_KERNELS_DEFAULT:
+			VectorL2SquaredDistance = VectorL2SquaredDistanceDefault;
+			VectorInnerProduct = VectorInnerProductDefault;
+			VectorCosineSimilarity = VectorCosineSimilarityDefault;
+			VectorL1Distance = VectorL1DistanceDefault;
+			VectorL2SquaredDistanceBatch = VectorL2SquaredDistanceBatchDefault;
+			VectorInnerProductBatch = VectorInnerProductBatchDefault;
+			return true;
+
+#ifdef VECTOR_DISPATCH
+		case VECTOR_KERNELS_AVX2:
+			if (!SupportsKernels(kernels))
+				return false;
+
+			VectorL2SquaredDistance = VectorL2SquaredDistanceAvx2;
+			VectorInnerProduct = VectorInnerProductAvx2;
+			VectorCosineSimilarity = VectorCosineSimilarityAvx2;
+			VectorL1Distance = VectorL1DistanceAvx2;
+			VectorL2SquaredDistanceBatch = VectorL2SquaredDistanceBatchAvx2;
+			VectorInnerProductBatch = VectorInnerProductBatchAvx2;
+			return true;
+
+		case VECTOR_KERNELS_AVX512:
+			if (!SupportsKernels(kernels))
+				return false;
+
+			VectorL2SquaredDistance = VectorL2SquaredDistanceAvx512;
+			VectorInnerProduct = VectorInnerProductAvx512;
+			VectorCosineSimilarity = VectorCosineSimilarityAvx512;
+			VectorL1Distance = VectorL1DistanceAvx512;
+			VectorL2SquaredDistanceBatch = VectorL2SquaredDistanceBatchAvx512;
+			VectorInnerProductBatch = VectorInnerProductBatchAvx512;
+			return true;
+#endif
+
+		default:
+			return false;
+	}
+}
+
+const char *
+VectorKernelsName(VectorKernels kernels)
+{
+	switch (kernels)
+	{
+		case VECTOR_KERNELS_AVX2:
+			return "avx2";
+		case VECTOR_KERNELS_AVX512:
+			return "avx512";
+		default:
+			return "default";
+	}
+}
+
+/*
+ * Pick the widest kernels the CPU supports
+ */
+void
+VectorInit(void)
+{
+	if (VectorSetKernels(VECTOR_KERNELS_AVX512))
+		return;
+
+	if (VectorSetKernels(VECTOR_KERNELS_AVX2))
+		return;
+
+	VectorSetKernels(VECTOR_KERNELS_DEFAULT);
+}
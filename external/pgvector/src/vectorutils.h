@@ -0,0 +1,27 @@
+#ifndef VECTORUTILS_H
+#define VECTORUTILS_H
+
+/* Number of vectors batched kernels compare with the query at once */
+#define VECTOR_BATCH_SIZE 64
+
+typedef enum VectorKernels
+{
+	VECTOR_KERNELS_DEFAULT,
+	VECTOR_KERNELS_AVX2,
+	VECTOR_KERNELS_AVX512
+}			VectorKernels;
+
+extern float (*VectorL2SquaredDistance) (int dim, float *ax, float *bx);
+extern float (*VectorInnerProduct) (int dim, float *ax, float *bx);
+extern double (*VectorCosineSimilarity) (int dim, float *ax, float *bx);
+extern float (*VectorL1Distance) (int dim, float *ax, float *bx);
+
+/* One query against n vectors, n is at most VECTOR_BATCH_SIZE */
+extern void (*VectorL2SquaredDistanceBatch) (int dim, float *q, float **x, int n, float *distances);
+extern void (*VectorInnerProductBatch) (int dim, float *q, float **x, int n, float *distances);
+
+void		VectorInit(void);
+bool		VectorSetKernels(VectorKernels kernels);
+const char *VectorKernelsName(VectorKernels kernels);
+
+#endif
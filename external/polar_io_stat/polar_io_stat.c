@@ -69,15 +69,18 @@ static inline int vfs_data_type(const char *path);
 static inline void vfs_timer_end(instr_time *time);
 static void polar_stat_io_open_info(int vfdkind, int vfdtype);
 static void polar_stat_io_close_info(int vfdkind, int vfdtype);
-static void polar_stat_io_read_info(int vfdkind, int vfdtype, ssize_t size);
-static void polar_stat_io_write_info(int vfdkind, int vfdtype, ssize_t size);
+static void polar_stat_io_read_info(int vfdkind, int vfdtype, ssize_t size, int hist_op);
+static void polar_stat_io_write_info(int vfdkind, int vfdtype, ssize_t size, int hist_op);
 static void polar_stat_io_seek_info(int vfdkind, int vfdtype);
 static void polar_stat_io_creat_info(int vfdkind, int vfdtype);
 static void polar_stat_io_falloc_info(int vfdkind, int vfdtype);
 static void polar_stat_io_fsync_info(int vfdkind, int vfdtype);
+static void polar_stat_io_hist_only_info(int vfdtype, int hist_op);
 static inline void polar_set_distribution_interval(instr_time *intervaltime, int loc, int kind);
+static inline void polar_set_latency_histogram(instr_time *intervaltime, int vfdtype, int hist_op);
 static inline void polar_vfs_timer_begin_iostat(void);
-static inline void polar_vfs_timer_end_iostat(instr_time *time, int loc, int kind);
+static inline bool polar_vfs_timer_elapsed_iostat(void);
+static inline void polar_vfs_timer_end_iostat(instr_time *time, int loc, int kind, int vfdtype, int hist_op);
 static void pgis_shmem_request(void);
 
 /* POLAR end */
@@ -141,6 +144,7 @@ pgis_shmem_request(void)
 	if (prev_shmem_request_hook)
 		prev_shmem_request_hook();
 	RequestAddinShmemSpace(mul_size(sizeof(POLAR_PROC_IO), PolarNumProcIOStatSlots));
+	RequestAddinShmemSpace(sizeof(POLAR_IO_HIST));
 }
 
 /*
@@ -182,6 +186,28 @@ polar_io_stat_shmem_startup(void)
 		polario_location_register(POLAR_VFS_LOCAL_DIO, POLARIO_SHARED);
 	}
 
+	PolarIOHistArray = ShmemInitStruct("PolarIOHistArray",
+									   sizeof(POLAR_IO_HIST), &found);
+
+	if (!found)
+	{
+		int			i,
+					j,
+					k,
+					b;
+
+		for (i = 0; i < POLARIO_HIST_BACKEND_TYPES; i++)
+			for (j = 0; j < POLARIO_HIST_OP_SIZE; j++)
+				for (k = 0; k < POLARIO_TYPE_SIZE; k++)
+				{
+					PolarIOHist *hist = &PolarIOHistArray->hist[i][j][k];
+
+					pg_atomic_init_u64(&hist->total_count, 0);
+					for (b = 0; b < POLARIO_HIST_BUCKETS; b++)
+						pg_atomic_init_u64(&hist->count[b], 0);
+				}
+	}
+
 	LWLockRelease(AddinShmemInitLock);
 }
 
@@ -486,6 +512,8 @@ vfs_data_type(const char *path)
 		return POLARIO_CLOG;
 	else if (strstr(path, "global"))
 		return POLARIO_GLOBAL;
+	else if (strstr(path, "polar_fullpage"))
+		return POLARIO_FULLPAGE;
 	else if (strstr(path, "logindex"))
 		return POLARIO_LOGINDEX;
 	else if (strstr(path, "multixact"))
@@ -524,11 +552,15 @@ vfs_timer_end(instr_time *time)
 		INSTR_TIME_ADD(*time, tmp_io_time);
 }
 
-static inline void
-polar_vfs_timer_end_iostat(instr_time *time, int loc, int kind)
+/*
+ * Set tmp_io_time to the time elapsed since polar_vfs_timer_begin_iostat,
+ * return false if it is not timed or should not be counted.
+ */
+static inline bool
+polar_vfs_timer_elapsed_iostat(void)
 {
 	if (!polar_enable_track_io_timing)
-		return;
+		return false;
 
 	INSTR_TIME_SET_CURRENT(tmp_io_time);
 	INSTR_TIME_SUBTRACT(tmp_io_time, tmp_io_start);
@@ -537,10 +569,20 @@ polar_vfs_timer_end_iostat(instr_time *time, int loc, int kind)
 	{
 		elog(WARNING, "This io time took %lf seconds, which is abnormal and we will not count."
 			 ,INSTR_TIME_GET_DOUBLE(tmp_io_time));
-		return;
+		return false;
 	}
 
+	return true;
+}
+
+static inline void
+polar_vfs_timer_end_iostat(instr_time *time, int loc, int kind, int vfdtype, int hist_op)
+{
+	if (!polar_vfs_timer_elapsed_iostat())
+		return;
+
 	polar_set_distribution_interval(&tmp_io_time, loc, kind);
+	polar_set_latency_histogram(&tmp_io_time, vfdtype, hist_op);
 	if (time)
 		INSTR_TIME_ADD(*time, tmp_io_time);
 }
@@ -564,7 +606,8 @@ polar_stat_io_open_info(int vfdkind, int vfdtype)
 			elog(WARNING, "polar io stat does not recognize that: kind = %d, loc = %d", vfdkind, loc);
 			return;
 		}
-		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_open_time, loc, LATENCY_open);
+		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_open_time,
+								   loc, LATENCY_open, vfdtype, POLARIO_HIST_OPEN);
 		PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_open_num++;
 		PolarIOStatArray[index].pid = MyProcPid;
 	}
@@ -592,7 +635,7 @@ polar_stat_io_close_info(int vfdkind, int vfdtype)
 
 /* As easy as understanding its function name */
 static void
-polar_stat_io_read_info(int vfdkind, int vfdtype, ssize_t size)
+polar_stat_io_read_info(int vfdkind, int vfdtype, ssize_t size, int hist_op)
 {
 	if (PolarIOStatArray != NULL &&
 		UsedShmemSegAddr != NULL)
@@ -606,7 +649,8 @@ polar_stat_io_read_info(int vfdkind, int vfdtype, ssize_t size)
 		loc = polario_kind_to_location(vfdkind);
 		if (loc < 0 || loc >= POLARIO_LOC_SIZE)
 			return;
-		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_latency_read, loc, LATENCY_read);
+		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_latency_read,
+								   loc, LATENCY_read, vfdtype, hist_op);
 		PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_number_read++;
 		PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_throughtput_read += size;
 	}
@@ -614,7 +658,7 @@ polar_stat_io_read_info(int vfdkind, int vfdtype, ssize_t size)
 
 /* As easy as understanding its function name */
 static void
-polar_stat_io_write_info(int vfdkind, int vfdtype, ssize_t size)
+polar_stat_io_write_info(int vfdkind, int vfdtype, ssize_t size, int hist_op)
 {
 	if (PolarIOStatArray != NULL &&
 		UsedShmemSegAddr != NULL)
@@ -628,7 +672,8 @@ polar_stat_io_write_info(int vfdkind, int vfdtype, ssize_t size)
 		loc = polario_kind_to_location(vfdkind);
 		if (loc < 0 || loc >= POLARIO_LOC_SIZE)
 			return;
-		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_latency_write, loc, LATENCY_write);
+		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_latency_write,
+								   loc, LATENCY_write, vfdtype, hist_op);
 		PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_number_write++;
 		PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_throughtput_write += size;
 	}
@@ -649,7 +694,8 @@ polar_stat_io_seek_info(int vfdkind, int vfdtype)
 		loc = polario_kind_to_location(vfdkind);
 		if (loc < 0 || loc >= POLARIO_LOC_SIZE)
 			return;
-		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_seek_time, loc, LATENCY_seek);
+		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_seek_time,
+								   loc, LATENCY_seek, vfdtype, POLARIO_HIST_LSEEK);
 		PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_seek_count++;
 	}
 }
@@ -669,7 +715,8 @@ polar_stat_io_creat_info(int vfdkind, int vfdtype)
 		loc = polario_kind_to_location(vfdkind);
 		if (loc < 0 || loc >= POLARIO_LOC_SIZE)
 			return;
-		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_creat_time, loc, LATENCY_creat);
+		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_creat_time,
+								   loc, LATENCY_creat, vfdtype, POLARIO_HIST_CREAT);
 		PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_creat_count++;
 	}
 }
@@ -689,7 +736,8 @@ polar_stat_io_falloc_info(int vfdkind, int vfdtype)
 		loc = polario_kind_to_location(vfdkind);
 		if (loc < 0 || loc >= POLARIO_LOC_SIZE)
 			return;
-		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_falloc_time, loc, LATENCY_falloc);
+		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_falloc_time,
+								   loc, LATENCY_falloc, vfdtype, POLARIO_HIST_FALLOCATE);
 		PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_falloc_count++;
 	}
 }
@@ -709,11 +757,25 @@ polar_stat_io_fsync_info(int vfdkind, int vfdtype)
 		loc = polario_kind_to_location(vfdkind);
 		if (loc < 0 || loc >= POLARIO_LOC_SIZE)
 			return;
-		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_fsync_time, loc, LATENCY_fsync);
+		polar_vfs_timer_end_iostat(&PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_fsync_time,
+								   loc, LATENCY_fsync, vfdtype, POLARIO_HIST_FSYNC);
 		PolarIOStatArray[index].polar_proc_io_stat_dist[vfdtype][loc].io_fsync_count++;
 	}
 }
 
+/*
+ * Only the latency histogram is kept for operations which have no counters
+ * in POLAR_PROC_IO, like ftruncate and stat.
+ */
+static void
+polar_stat_io_hist_only_info(int vfdtype, int hist_op)
+{
+	if (PolarIOHistArray != NULL &&
+		UsedShmemSegAddr != NULL &&
+		polar_vfs_timer_elapsed_iostat())
+		polar_set_latency_histogram(&tmp_io_time, vfdtype, hist_op);
+}
+
 static inline void
 polar_set_distribution_interval(instr_time *intervaltime, int loc, int kind)
 {
@@ -744,6 +806,32 @@ polar_set_distribution_interval(instr_time *intervaltime, int loc, int kind)
 		PolarIOStatArray[index].num_latency_dist[loc][kind][interval]++;
 }
 
+/*
+ * Count the latency into the histogram of current backend type. The
+ * histograms are shared by processes, but a counter is only touched by
+ * one atomic add, which is cheap compared with the io itself.
+ */
+static inline void
+polar_set_latency_histogram(instr_time *intervaltime, int vfdtype, int hist_op)
+{
+	PolarIOHist *hist;
+	uint64		us;
+
+	if (PolarIOHistArray == NULL || UsedShmemSegAddr == NULL)
+		return;
+
+	if (MyBackendType < 0 || MyBackendType >= POLARIO_HIST_BACKEND_TYPES ||
+		vfdtype < 0 || vfdtype >= POLARIO_TYPE_SIZE ||
+		hist_op < 0 || hist_op >= POLARIO_HIST_OP_SIZE)
+		return;
+
+	us = INSTR_TIME_GET_MICROSEC(*intervaltime);
+	hist = &PolarIOHistArray->hist[MyBackendType][hist_op][vfdtype];
+
+	pg_atomic_fetch_add_u64(&hist->count[polar_io_hist_bucket(us)], 1);
+	pg_atomic_fetch_add_u64(&hist->total_count, 1);
+}
+
 static void
 polar_stat_env_init_hook(polar_vfs_ops ops)
 {
@@ -785,6 +873,11 @@ polar_stat_file_before_hook(const char *path, vfs_vfd *vfdp, polar_vfs_ops ops)
 			if (ops == VFS_OPEN)
 				pgstat_report_wait_start(WAIT_EVENT_DATA_VFS_FILE_OPEN);
 			break;
+		case VFS_STAT:
+		case VFS_LSTAT:
+			vfdp->type = vfs_data_type(path);
+			polar_vfs_timer_begin_iostat();
+			break;
 		default:
 			break;
 	}
@@ -815,6 +908,10 @@ polar_stat_file_after_hook(const char *path, vfs_vfd *vfdp, polar_vfs_ops ops)
 		case VFS_CLOSE:
 			polar_stat_io_close_info(vfdp->kind, vfdp->type);
 			break;
+		case VFS_STAT:
+		case VFS_LSTAT:
+			polar_stat_io_hist_only_info(vfdp->type, POLARIO_HIST_STAT);
+			break;
 		default:
 			break;
 	}
@@ -831,12 +928,14 @@ polar_stat_io_before_hook(vfs_vfd *vfdp, ssize_t ret, polar_vfs_ops ops)
 	{
 		case VFS_WRITE:
 		case VFS_PWRITE:
+		case VFS_PWRITEV:
 			/* begin stat info for io, wait_time, wait_object */
 			polar_vfs_timer_begin_iostat();
 			polar_stat_wait_obj_and_time_set(vfdp->fd, &tmp_io_start, PGPROC_WAIT_FD);
 			break;
 		case VFS_READ:
 		case VFS_PREAD:
+		case VFS_PREADV:
 			/* begin stat info for io, wait_time, wait_object */
 			polar_vfs_timer_begin_iostat();
 			polar_stat_wait_obj_and_time_set(vfdp->fd, &tmp_io_start, PGPROC_WAIT_FD);
@@ -853,6 +952,8 @@ polar_stat_io_before_hook(vfs_vfd *vfdp, ssize_t ret, polar_vfs_ops ops)
 			polar_stat_wait_obj_and_time_set(vfdp->fd, &tmp_io_start, PGPROC_WAIT_FD);
 			break;
 		case VFS_FALLOCATE:
+		case VFS_FTRUNCATE:
+		case VFS_FSTAT:
 			/* begin stat info for io, wait_time, wait_object */
 			polar_vfs_timer_begin_iostat();
 			break;
@@ -871,14 +972,28 @@ polar_stat_io_after_hook(vfs_vfd *vfdp, ssize_t ret, polar_vfs_ops ops)
 	switch (ops)
 	{
 		case VFS_WRITE:
-		case VFS_PWRITE:
 			/* end stat info for io, wait_time, wait_object */
-			polar_stat_io_write_info(vfdp->kind, vfdp->type, ret);
+			polar_stat_io_write_info(vfdp->kind, vfdp->type, ret, POLARIO_HIST_WRITE);
+			polar_stat_wait_obj_and_time_clear();
+			break;
+		case VFS_PWRITE:
+			polar_stat_io_write_info(vfdp->kind, vfdp->type, ret, POLARIO_HIST_PWRITE);
+			polar_stat_wait_obj_and_time_clear();
+			break;
+		case VFS_PWRITEV:
+			polar_stat_io_write_info(vfdp->kind, vfdp->type, ret, POLARIO_HIST_PWRITEV);
 			polar_stat_wait_obj_and_time_clear();
 			break;
 		case VFS_READ:
+			polar_stat_io_read_info(vfdp->kind, vfdp->type, ret, POLARIO_HIST_READ);
+			polar_stat_wait_obj_and_time_clear();
+			break;
 		case VFS_PREAD:
-			polar_stat_io_read_info(vfdp->kind, vfdp->type, ret);
+			polar_stat_io_read_info(vfdp->kind, vfdp->type, ret, POLARIO_HIST_PREAD);
+			polar_stat_wait_obj_and_time_clear();
+			break;
+		case VFS_PREADV:
+			polar_stat_io_read_info(vfdp->kind, vfdp->type, ret, POLARIO_HIST_PREADV);
 			polar_stat_wait_obj_and_time_clear();
 			break;
 		case VFS_LSEEK:
@@ -895,6 +1010,12 @@ polar_stat_io_after_hook(vfs_vfd *vfdp, ssize_t ret, polar_vfs_ops ops)
 		case VFS_FALLOCATE:
 			polar_stat_io_falloc_info(vfdp->kind, vfdp->type);
 			break;
+		case VFS_FTRUNCATE:
+			polar_stat_io_hist_only_info(vfdp->type, POLARIO_HIST_FTRUNCATE);
+			break;
+		case VFS_FSTAT:
+			polar_stat_io_hist_only_info(vfdp->type, POLARIO_HIST_STAT);
+			break;
 		default:
 			break;
 	}
@@ -106,12 +106,30 @@ RETURNS record
 AS 'MODULE_PATHNAME', 'polar_cbuf'
 LANGUAGE C PARALLEL SAFE;
 
+CREATE FUNCTION polar_cbuf_alloc(OUT active int4,
+                                 OUT reserved int4,
+                                 OUT alloc int8,
+                                 OUT alloc_fail int8,
+                                 OUT alloc_time_ns int8,
+                                 OUT grow int8,
+                                 OUT shrink int8)
+RETURNS record
+AS 'MODULE_PATHNAME', 'polar_cbuf_alloc'
+LANGUAGE C PARALLEL SAFE;
+
 /* Create backend flush buffer count func */
 CREATE FUNCTION polar_backend_flush()
 RETURNS int8
 AS 'MODULE_PATHNAME', 'polar_backend_flush'
 LANGUAGE C PARALLEL SAFE;
 
+/* Create bgwriter write size histogram func */
+CREATE FUNCTION polar_bgwriter_write_combine(OUT blocks int4,
+                                             OUT writes int8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'polar_bgwriter_write_combine'
+LANGUAGE C PARALLEL SAFE;
+
 /* Create lru flush info func */
 CREATE FUNCTION polar_lru_flush_info(OUT lru_complete_passes int4,
                                      OUT lru_buffer_id int4,
@@ -365,6 +383,79 @@ CREATE VIEW polar_stat_activity_rt AS
         , v_local_write_latency AS local_write_latency
     FROM polar_delta(NULL::polar_stat_activity_rt_mid);
 
+-- Create io latency histogram func
+CREATE FUNCTION polar_io_latency_histogram(
+            OUT backend_type text,
+            OUT io_op text,
+            OUT file_type text,
+            OUT bucket int4,
+            OUT lower_us int8,
+            OUT upper_us int8,
+            OUT count int8
+)
+RETURNS SETOF RECORD
+AS 'MODULE_PATHNAME', 'polar_io_latency_histogram'
+LANGUAGE C PARALLEL SAFE;
+
+/*
+ * POLAR: snapshot of io latency histograms, use
+ * "select * from polar_delta(NULL::polar_stat_io_latency_histogram)" to get
+ * the histograms of the io done between two calls.
+ */
+CREATE VIEW polar_stat_io_latency_histogram AS
+    SELECT backend_type AS d_backend_type
+        , io_op AS d_io_op
+        , file_type AS d_file_type
+        , bucket AS d_bucket
+        , lower_us
+        , upper_us
+        , count AS v_count
+    FROM polar_io_latency_histogram();
+
+/*
+ * POLAR: percentiles of io latency computed from histograms, a percentile
+ * is reported as the upper bound of the bucket it falls in.
+ */
+CREATE FUNCTION polar_io_latency_percentile(
+            IN hist polar_stat_io_latency_histogram[],
+            OUT backend_type text,
+            OUT io_op text,
+            OUT file_type text,
+            OUT count int8,
+            OUT p50_us int8,
+            OUT p90_us int8,
+            OUT p99_us int8,
+            OUT p999_us int8,
+            OUT max_us int8
+)
+RETURNS SETOF RECORD
+AS $$
+    SELECT d_backend_type, d_io_op, d_file_type, max(total)::int8,
+        min(upper_us) FILTER (WHERE cum >= total * 0.5),
+        min(upper_us) FILTER (WHERE cum >= total * 0.9),
+        min(upper_us) FILTER (WHERE cum >= total * 0.99),
+        min(upper_us) FILTER (WHERE cum >= total * 0.999),
+        max(upper_us) FILTER (WHERE v_count > 0)
+    FROM (SELECT h.*,
+            sum(v_count) OVER (PARTITION BY d_backend_type, d_io_op, d_file_type
+                               ORDER BY d_bucket) AS cum,
+            sum(v_count) OVER (PARTITION BY d_backend_type, d_io_op, d_file_type) AS total
+          FROM unnest(hist) h) s
+    WHERE total > 0
+    GROUP BY d_backend_type, d_io_op, d_file_type
+    ORDER BY d_backend_type, d_io_op, d_file_type
+$$ LANGUAGE SQL PARALLEL SAFE;
+
+-- io latency percentiles since startup
+CREATE VIEW polar_stat_io_latency_percentile AS
+    SELECT * FROM polar_io_latency_percentile(
+        ARRAY(SELECT h FROM polar_stat_io_latency_histogram h));
+
+-- io latency percentiles of the io done since last query of this view
+CREATE VIEW polar_stat_io_latency_percentile_rt AS
+    SELECT * FROM polar_io_latency_percentile(
+        ARRAY(SELECT h FROM polar_delta(NULL::polar_stat_io_latency_histogram) h));
+
 
 CREATE FUNCTION polar_set_available(available bool)
 RETURNS VOID
@@ -418,6 +509,83 @@ RETURNS record
 AS 'MODULE_PATHNAME', 'polar_xlog_queue_stat_detail'
 LANGUAGE C PARALLEL SAFE;
 
+CREATE FUNCTION polar_logindex_page_lsn_cache_stat(
+	OUT cache_size int4,
+	OUT hits int8,
+	OUT misses int8,
+	OUT generation int8)
+RETURNS record
+AS 'MODULE_PATHNAME', 'polar_logindex_page_lsn_cache_stat'
+LANGUAGE C PARALLEL SAFE;
+
+CREATE FUNCTION polar_logindex_load_stat(
+	OUT name text,
+	OUT workers int4,
+	OUT tables int8,
+	OUT read_us int8,
+	OUT validate_us int8,
+	OUT bloom_us int8,
+	OUT total_us int8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'polar_logindex_load_stat'
+LANGUAGE C PARALLEL SAFE;
+
+CREATE FUNCTION polar_procpool_stat(
+	OUT name text,
+	OUT sub_id int4,
+	OUT pid int4,
+	OUT queue_depth int4,
+	OUT queued_tasks int4,
+	OUT handled_tasks int8,
+	OUT stolen_tasks int8,
+	OUT lost_tasks int8,
+	OUT busy_us int8,
+	OUT idle_us int8,
+	OUT utilization float8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'polar_procpool_stat'
+LANGUAGE C PARALLEL SAFE;
+
+CREATE VIEW polar_stat_procpool AS
+	SELECT * FROM polar_procpool_stat();
+
+CREATE FUNCTION polar_logindex_parse_stat(
+	OUT decoded_ahead_records int8,
+	OUT decode_ahead_us int8,
+	OUT decoded_ahead_lsn pg_lsn,
+	OUT decoded_ahead_used int8,
+	OUT decoded_records int8,
+	OUT decode_us int8,
+	OUT decoded_lsn pg_lsn,
+	OUT parsed_records int8,
+	OUT parse_us int8,
+	OUT parsed_lsn pg_lsn,
+	OUT received_lsn pg_lsn,
+	OUT decode_ahead_bytes int8,
+	OUT decode_lag_bytes int8,
+	OUT parse_lag_bytes int8)
+RETURNS record
+AS 'MODULE_PATHNAME', 'polar_logindex_parse_stat'
+LANGUAGE C PARALLEL SAFE;
+
+CREATE VIEW polar_stat_logindex_parse AS
+	SELECT * FROM polar_logindex_parse_stat();
+
+CREATE FUNCTION polar_logindex_prefetch_stat(
+	OUT hits int8,
+	OUT issued int8,
+	OUT skipped int8,
+	OUT hit_ratio float8,
+	OUT prefetched_lsn pg_lsn,
+	OUT bg_replayed_lsn pg_lsn,
+	OUT ahead_bytes int8)
+RETURNS record
+AS 'MODULE_PATHNAME', 'polar_logindex_prefetch_stat'
+LANGUAGE C PARALLEL SAFE;
+
+CREATE VIEW polar_stat_logindex_prefetch AS
+	SELECT * FROM polar_logindex_prefetch_stat();
+
 CREATE FUNCTION polar_get_xlog_queue_ref_info_func(
 	OUT ref_name text,
 	OUT ref_pread int8,
@@ -658,14 +826,35 @@ CREATE OR REPLACE FUNCTION polar_xlog_buffer_stat_info(
 					OUT hit_count int8,
                     OUT io_count int8,
                     OUT others_append_count int8,
-                    OUT startup_append_count int8)
+                    OUT startup_append_count int8,
+                    OUT evict_count int8,
+                    OUT collision_count int8)
 RETURNS record
 AS 'MODULE_PATHNAME', 'polar_xlog_buffer_stat_info'
 LANGUAGE C PARALLEL SAFE;
 
 REVOKE ALL ON FUNCTION polar_xlog_buffer_stat_info(OUT hit_count int8,
     OUT io_count int8, OUT others_append_count int8,
-    OUT startup_append_count int8) FROM PUBLIC;
+    OUT startup_append_count int8, OUT evict_count int8,
+    OUT collision_count int8) FROM PUBLIC;
+
+/*
+ * POLAR: hit, eviction and collision rates of xlog buffer. A collision means
+ * a lookup or append raced with another process writing the same slot.
+ */
+CREATE VIEW polar_stat_xlog_buffer AS
+    SELECT hit_count AS hits
+        , io_count AS misses
+        , startup_append_count AS startup_appends
+        , others_append_count AS other_appends
+        , evict_count AS evictions
+        , collision_count AS collisions
+        , round(hit_count::numeric / nullif(hit_count + io_count, 0), 4) AS hit_ratio
+        , round(evict_count::numeric / nullif(startup_append_count + others_append_count, 0), 4) AS eviction_ratio
+        , round(collision_count::numeric / nullif(hit_count + io_count + startup_append_count + others_append_count, 0), 4) AS collision_ratio
+    FROM polar_xlog_buffer_stat_info();
+
+REVOKE ALL ON polar_stat_xlog_buffer FROM PUBLIC;
 
 CREATE FUNCTION polar_xlog_buffer_stat_reset()
 RETURNS VOID
@@ -674,6 +863,31 @@ LANGUAGE C PARALLEL SAFE;
 
 REVOKE ALL ON FUNCTION polar_xlog_buffer_stat_reset() FROM PUBLIC;
 
+-- Create WAL group commit histogram func
+CREATE FUNCTION polar_wal_group_commit_histogram(
+            OUT hist text,
+            OUT bucket int4,
+            OUT lower int8,
+            OUT upper int8,
+            OUT count int8
+)
+RETURNS SETOF RECORD
+AS 'MODULE_PATHNAME', 'polar_wal_group_commit_histogram'
+LANGUAGE C PARALLEL SAFE;
+
+/*
+ * POLAR: sizes of WAL flush groups and the time their members waited, use
+ * "select * from polar_delta(NULL::polar_stat_wal_group_commit)" to get the
+ * histograms between two calls.
+ */
+CREATE VIEW polar_stat_wal_group_commit AS
+    SELECT hist AS d_hist
+        , bucket AS d_bucket
+        , lower
+        , upper
+        , count AS v_count
+    FROM polar_wal_group_commit_histogram();
+
 /* Per Index */
 CREATE FUNCTION polar_pg_stat_get_bulk_create_index_extend_times(
     IN oid,
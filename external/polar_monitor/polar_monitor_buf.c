@@ -361,10 +361,10 @@ polar_get_copy_buffercache_pages(PG_FUNCTION_ARGS)
 		/* Allocate NBuffers worth of CopyBufferCachePagesRec records. */
 		fctx->record = (CopyBufferCachePagesRec *)
 			MemoryContextAllocHuge(CurrentMemoryContext,
-								   sizeof(CopyBufferCachePagesRec) * polar_copy_buffers);
+								   sizeof(CopyBufferCachePagesRec) * polar_copy_buffers_reserved());
 
 		/* Set max calls and remember the user function context. */
-		funcctx->max_calls = polar_copy_buffers;
+		funcctx->max_calls = polar_copy_buffers_reserved();
 		funcctx->user_fctx = fctx;
 
 		/* Return to original context when allocating transient memory */
@@ -378,7 +378,7 @@ polar_get_copy_buffercache_pages(PG_FUNCTION_ARGS)
 		 * snapshot across all buffers, but we do grab the buffer header
 		 * locks, so the information of each buffer is self-consistent.
 		 */
-		for (i = 0; i < polar_copy_buffers; i++)
+		for (i = 0; i < polar_copy_buffers_reserved(); i++)
 		{
 			CopyBufferDesc *cbufHdr = polar_get_copy_buffer_descriptor(i);
 
@@ -520,6 +520,48 @@ polar_cbuf(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
 }
 
+/*
+ * Size of the copy buffer pool and its allocation latency, the active size
+ * changes between polar_copy_buffers and polar_copy_buffers_max if the pool
+ * is elastic.
+ */
+PG_FUNCTION_INFO_V1(polar_cbuf_alloc);
+
+Datum
+polar_cbuf_alloc(PG_FUNCTION_ARGS)
+{
+#define CBUF_ALLOC_COLUMN_SIZE 7
+
+	TupleDesc	tupdesc;
+	Datum		values[CBUF_ALLOC_COLUMN_SIZE];
+	bool		nulls[CBUF_ALLOC_COLUMN_SIZE];
+
+	if (!polar_copy_buffer_enabled())
+		PG_RETURN_NULL();
+
+	tupdesc = CreateTemplateTupleDesc(CBUF_ALLOC_COLUMN_SIZE);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "active", INT4OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "reserved", INT4OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 3, "alloc", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "alloc_fail", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "alloc_time_ns", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "grow", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 7, "shrink", INT8OID, -1, 0);
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	MemSet(nulls, 0, sizeof(nulls));
+
+	values[0] = Int32GetDatum(pg_atomic_read_u32(&polar_copy_buffer_ctl->active_buffers));
+	values[1] = Int32GetDatum(polar_copy_buffers_reserved());
+	values[2] = UInt64GetDatum(pg_atomic_read_u64(&polar_copy_buffer_ctl->alloc_count));
+	values[3] = UInt64GetDatum(pg_atomic_read_u64(&polar_copy_buffer_ctl->full_count));
+	values[4] = UInt64GetDatum(pg_atomic_read_u64(&polar_copy_buffer_ctl->alloc_time));
+	values[5] = UInt64GetDatum(pg_atomic_read_u64(&polar_copy_buffer_ctl->grow_count));
+	values[6] = UInt64GetDatum(pg_atomic_read_u64(&polar_copy_buffer_ctl->shrink_count));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 PG_FUNCTION_INFO_V1(polar_backend_flush);
 Datum
 polar_backend_flush(PG_FUNCTION_ARGS)
@@ -530,6 +572,38 @@ polar_backend_flush(PG_FUNCTION_ARGS)
 	PG_RETURN_UINT64(pg_atomic_read_u64(&polar_flush_ctl->backend_flush));
 }
 
+/*
+ * Histogram of the sizes of writes that bgwriter issued for buffers got from
+ * flush list, one row per bucket of up to "blocks" blocks.
+ */
+PG_FUNCTION_INFO_V1(polar_bgwriter_write_combine);
+Datum
+polar_bgwriter_write_combine(PG_FUNCTION_ARGS)
+{
+#define WRITE_COMBINE_COLUMN_SIZE 2
+
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Datum		values[WRITE_COMBINE_COLUMN_SIZE];
+	bool		nulls[WRITE_COMBINE_COLUMN_SIZE];
+	int			i;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	if (!polar_flush_list_enabled())
+		PG_RETURN_VOID();
+
+	MemSet(nulls, 0, sizeof(nulls));
+
+	for (i = 0; i < POLAR_WRITE_COMBINE_HIST_SIZE; i++)
+	{
+		values[0] = Int32GetDatum(1 << i);
+		values[1] = UInt64GetDatum(pg_atomic_read_u64(&polar_flush_ctl->write_combine_hist[i]));
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	PG_RETURN_VOID();
+}
+
 PG_FUNCTION_INFO_V1(polar_lru_flush_info);
 
 Datum
@@ -48,13 +48,18 @@ static char *polar_latency_infos[] =
 static char *polar_dir_type_names[] =
 {
 	"WAL", "DATA", "CLOG", "global", "logindex", "multixact",
-	"twophase", "replslot", "snapshots", "subtrans", "others"
+	"twophase", "replslot", "snapshots", "subtrans", "fullpage", "others"
 };
 static char *polar_io_kind_names[] =
 {
 	"read", "write", "open", "seek", "creat",
 	"fsync", "falloc"
 };
+static char *polar_io_hist_op_names[] =
+{
+	"open", "creat", "read", "pread", "preadv", "write", "pwrite",
+	"pwritev", "lseek", "fsync", "fallocate", "ftruncate", "stat"
+};
 
 StaticAssertDecl(lengthof(polar_io_loc_names) == POLARIO_LOC_SIZE,
 				 "io location names array length mismatch");
@@ -64,6 +69,8 @@ StaticAssertDecl(lengthof(polar_dir_type_names) == POLARIO_TYPE_SIZE,
 				 "dir type name array length mismatch");
 StaticAssertDecl(lengthof(polar_io_kind_names) == LATENCY_KIND_LEN,
 				 "io kind name array length mismatch");
+StaticAssertDecl(lengthof(polar_io_hist_op_names) == POLARIO_HIST_OP_SIZE,
+				 "io histogram op name array length mismatch");
 
 
 
@@ -660,3 +667,91 @@ polar_io_latency_info(PG_FUNCTION_ARGS)
 
 	return (Datum) 0;
 }
+
+/*
+ * return the latency histogram of every backend type, vfs operation and
+ * file type. All buckets of a histogram are returned once it is not empty,
+ * so that two snapshots can be joined by bucket to get the delta.
+ */
+PG_FUNCTION_INFO_V1(polar_io_latency_histogram);
+Datum
+polar_io_latency_histogram(PG_FUNCTION_ARGS)
+{
+	int			btype;
+	int			op;
+	int			type;
+	int			bucket;
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (!PolarIOHistArray)
+	{
+		tuplestore_donestoring(tupstore);
+		elog(ERROR, "Io statistics is unavailable!");
+	}
+
+	for (btype = 0; btype < POLARIO_HIST_BACKEND_TYPES; btype++)
+	{
+		for (op = 0; op < POLARIO_HIST_OP_SIZE; op++)
+		{
+			for (type = 0; type < POLARIO_TYPE_SIZE; type++)
+			{
+				PolarIOHist *hist = &PolarIOHistArray->hist[btype][op][type];
+				const char *btype_name;
+
+				if (pg_atomic_read_u64(&hist->total_count) == 0)
+					continue;
+
+				btype_name = btype == B_INVALID ? "postmaster" : GetBackendTypeDesc(btype);
+
+				for (bucket = 0; bucket < POLARIO_HIST_BUCKETS; bucket++)
+				{
+					Datum		values[7];
+					bool		nulls[7];
+
+					MemSet(nulls, 0, sizeof(nulls));
+					values[0] = CStringGetTextDatum(btype_name);
+					values[1] = CStringGetTextDatum(polar_io_hist_op_names[op]);
+					values[2] = CStringGetTextDatum(polar_dir_type_names[type]);
+					values[3] = Int32GetDatum(bucket);
+					values[4] = Int64GetDatum(polar_io_hist_bucket_lower(bucket));
+					values[5] = Int64GetDatum(polar_io_hist_bucket_upper(bucket));
+					values[6] = Int64GetDatum(pg_atomic_read_u64(&hist->count[bucket]));
+
+					tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+				}
+			}
+		}
+	}
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -31,6 +31,7 @@
 #include "access/polar_logindex_redo.h"
 #include "access/polar_ringbuf.h"
 #include "funcapi.h"
+#include "replication/walreceiver.h"
 #include "storage/pg_shmem.h"
 #include "storage/procarray.h"
 #include "storage/shmem.h"
@@ -43,6 +44,11 @@
 #define XLOG_QUEUE_INFO_COLUMN_SIZE 3
 #define XLOG_QUEUE_STAT_DETIAL_COL_SIZE 10
 #define XLOG_QUEUE_SLOTS_INFO_COLUMN_SIZE 5
+#define PAGE_LSN_CACHE_STAT_COLUMN_SIZE 4
+#define LOGINDEX_LOAD_STAT_COLUMN_SIZE 7
+#define PROCPOOL_STAT_COLUMN_SIZE 11
+#define LOGINDEX_PARSE_STAT_COLUMN_SIZE 14
+#define LOGINDEX_PREFETCH_STAT_COLUMN_SIZE 7
 static polar_ringbuf_slot_t *slots_info = NULL;
 static uint64 rbuf_occupied;
 
@@ -98,6 +104,223 @@ polar_replica_bg_replay_lsn(PG_FUNCTION_ARGS)
 	PG_RETURN_LSN(bg_lsn);
 }
 
+/* Get hit and miss count of logindex page lsn cache and logindex generation */
+PG_FUNCTION_INFO_V1(polar_logindex_page_lsn_cache_stat);
+Datum
+polar_logindex_page_lsn_cache_stat(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[PAGE_LSN_CACHE_STAT_COLUMN_SIZE];
+	bool		nulls[PAGE_LSN_CACHE_STAT_COLUMN_SIZE];
+	polar_page_lsn_cache_t cache;
+
+	if (!polar_logindex_redo_instance || !polar_logindex_redo_instance->page_lsn_cache)
+		PG_RETURN_NULL();
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	cache = polar_logindex_redo_instance->page_lsn_cache;
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int32GetDatum(cache->size);
+	values[1] = Int64GetDatum((int64) pg_atomic_read_u64(&cache->hits));
+	values[2] = Int64GetDatum((int64) pg_atomic_read_u64(&cache->misses));
+	values[3] = Int64GetDatum((int64) polar_logindex_generation(polar_logindex_redo_instance->wal_logindex_snapshot));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/* Get time spent to load logindex tables when startup */
+PG_FUNCTION_INFO_V1(polar_logindex_load_stat);
+Datum
+polar_logindex_load_stat(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	logindex_snapshot_t snapshots[2];
+	int			i;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	if (!polar_logindex_redo_instance)
+		PG_RETURN_VOID();
+
+	snapshots[0] = polar_logindex_redo_instance->wal_logindex_snapshot;
+	snapshots[1] = polar_logindex_redo_instance->fullpage_logindex_snapshot;
+
+	for (i = 0; i < lengthof(snapshots); i++)
+	{
+		Datum		values[LOGINDEX_LOAD_STAT_COLUMN_SIZE];
+		bool		nulls[LOGINDEX_LOAD_STAT_COLUMN_SIZE];
+		polar_logindex_load_stat_t stat;
+
+		if (!snapshots[i])
+			continue;
+
+		polar_logindex_get_load_stat(snapshots[i], &stat);
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = CStringGetTextDatum(polar_get_logindex_snapshot_dir(snapshots[i]));
+		values[1] = Int32GetDatum(stat.workers);
+		values[2] = Int64GetDatum((int64) stat.tables);
+		values[3] = Int64GetDatum((int64) stat.read_us);
+		values[4] = Int64GetDatum((int64) stat.validate_us);
+		values[5] = Int64GetDatum((int64) stat.bloom_us);
+		values[6] = Int64GetDatum((int64) stat.total_us);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	PG_RETURN_VOID();
+}
+
+/* Get utilization and work stealing of parallel replay processes */
+PG_FUNCTION_INFO_V1(polar_procpool_stat);
+Datum
+polar_procpool_stat(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	polar_task_sched_t *sched;
+	int			i;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	if (!polar_logindex_redo_instance || !polar_logindex_redo_instance->parallel_sched)
+		PG_RETURN_VOID();
+
+	sched = polar_logindex_redo_instance->parallel_sched;
+
+	for (i = 0; i < sched->total_proc; i++)
+	{
+		Datum		values[PROCPOOL_STAT_COLUMN_SIZE];
+		bool		nulls[PROCPOOL_STAT_COLUMN_SIZE];
+		polar_sub_proc_stat_t *stat = POLAR_SCHED_PROC_STAT(sched, i);
+		uint32		pid = pg_atomic_read_u32(&stat->pid);
+		uint64		busy_us = pg_atomic_read_u64(&stat->busy_us);
+		uint64		idle_us = pg_atomic_read_u64(&stat->idle_us);
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = CStringGetTextDatum(sched->name);
+		values[1] = Int32GetDatum(i);
+		values[2] = Int32GetDatum((int32) pid);
+		nulls[2] = (pid == 0);
+		values[3] = Int32GetDatum((int32) pg_atomic_read_u32(&stat->depth_limit));
+		values[4] = Int32GetDatum((int32) pg_atomic_read_u32(&stat->queued_tasks));
+		values[5] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->handled_tasks));
+		values[6] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->stolen_tasks));
+		values[7] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->lost_tasks));
+		values[8] = Int64GetDatum((int64) busy_us);
+		values[9] = Int64GetDatum((int64) idle_us);
+		values[10] = Float8GetDatum(busy_us + idle_us > 0 ? (double) busy_us / (busy_us + idle_us) : 0);
+		nulls[10] = (busy_us + idle_us == 0);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Get throughput of decode ahead, decode and parse stages which turn WAL into
+ * logindex, and how far each stage falls behind the one before it
+ */
+PG_FUNCTION_INFO_V1(polar_logindex_parse_stat);
+Datum
+polar_logindex_parse_stat(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[LOGINDEX_PARSE_STAT_COLUMN_SIZE];
+	bool		nulls[LOGINDEX_PARSE_STAT_COLUMN_SIZE];
+	polar_logindex_parse_stat_t *stat;
+	XLogRecPtr	received_lsn;
+	XLogRecPtr	decoded_ahead_lsn;
+	XLogRecPtr	decoded_lsn;
+	XLogRecPtr	parsed_lsn;
+
+	if (!polar_logindex_redo_instance)
+		PG_RETURN_NULL();
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	stat = &polar_logindex_redo_instance->parse_stat;
+	received_lsn = GetWalRcvFlushRecPtr(NULL, NULL);
+	decoded_ahead_lsn = pg_atomic_read_u64(&stat->decoded_ahead_lsn);
+	decoded_lsn = pg_atomic_read_u64(&stat->decoded_lsn);
+	parsed_lsn = pg_atomic_read_u64(&stat->parsed_lsn);
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->decoded_ahead_records));
+	values[1] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->decode_ahead_us));
+	values[2] = LSNGetDatum(decoded_ahead_lsn);
+	nulls[2] = XLogRecPtrIsInvalid(decoded_ahead_lsn);
+	values[3] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->decoded_ahead_used));
+	values[4] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->decoded_records));
+	values[5] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->decode_us));
+	values[6] = LSNGetDatum(decoded_lsn);
+	nulls[6] = XLogRecPtrIsInvalid(decoded_lsn);
+	values[7] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->parsed_records));
+	values[8] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->parse_us));
+	values[9] = LSNGetDatum(parsed_lsn);
+	nulls[9] = XLogRecPtrIsInvalid(parsed_lsn);
+	values[10] = LSNGetDatum(received_lsn);
+	nulls[10] = XLogRecPtrIsInvalid(received_lsn);
+	values[11] = Int64GetDatum(decoded_ahead_lsn > decoded_lsn ? (int64) (decoded_ahead_lsn - decoded_lsn) : 0);
+	nulls[11] = nulls[2] || nulls[6];
+	values[12] = Int64GetDatum(received_lsn > decoded_lsn ? (int64) (received_lsn - decoded_lsn) : 0);
+	nulls[12] = nulls[6] || nulls[10];
+	values[13] = Int64GetDatum(decoded_lsn > parsed_lsn ? (int64) (decoded_lsn - parsed_lsn) : 0);
+	nulls[13] = nulls[6] || nulls[9];
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * Get blocks prefetched ahead of parallel replay, the ratio of them which are
+ * already in shared buffers, and how far prefetch is ahead of replay
+ */
+PG_FUNCTION_INFO_V1(polar_logindex_prefetch_stat);
+Datum
+polar_logindex_prefetch_stat(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[LOGINDEX_PREFETCH_STAT_COLUMN_SIZE];
+	bool		nulls[LOGINDEX_PREFETCH_STAT_COLUMN_SIZE];
+	polar_logindex_prefetch_stat_t *stat;
+	uint64		hits;
+	uint64		issued;
+	XLogRecPtr	prefetched_lsn;
+	XLogRecPtr	replayed_lsn;
+
+	if (!polar_logindex_redo_instance)
+		PG_RETURN_NULL();
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	stat = &polar_logindex_redo_instance->prefetch_stat;
+	hits = pg_atomic_read_u64(&stat->hits);
+	issued = pg_atomic_read_u64(&stat->issued);
+	prefetched_lsn = pg_atomic_read_u64(&stat->prefetched_lsn);
+	replayed_lsn = polar_bg_redo_get_replayed_lsn(polar_logindex_redo_instance);
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum((int64) hits);
+	values[1] = Int64GetDatum((int64) issued);
+	values[2] = Int64GetDatum((int64) pg_atomic_read_u64(&stat->skipped));
+	values[3] = Float8GetDatum(hits + issued > 0 ? (double) hits / (hits + issued) : 0);
+	nulls[3] = (hits + issued == 0);
+	values[4] = LSNGetDatum(prefetched_lsn);
+	nulls[4] = XLogRecPtrIsInvalid(prefetched_lsn);
+	values[5] = LSNGetDatum(replayed_lsn);
+	nulls[5] = XLogRecPtrIsInvalid(replayed_lsn);
+	values[6] = Int64GetDatum(prefetched_lsn > replayed_lsn ? (int64) (prefetched_lsn - replayed_lsn) : 0);
+	nulls[6] = nulls[4] || nulls[5];
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+
 /*
  * Used in replica and calculate min LSN used by replica
  * backends or background process
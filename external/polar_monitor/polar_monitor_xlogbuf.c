@@ -28,7 +28,9 @@
 #include <stdlib.h>
 
 #include "access/htup_details.h"
+#include "access/xlog.h"
 #include "funcapi.h"
+#include "miscadmin.h"
 #include "storage/pg_shmem.h"
 #include "storage/polar_xlogbuf.h"
 #include "storage/procarray.h"
@@ -45,7 +47,7 @@ PG_FUNCTION_INFO_V1(polar_xlog_buffer_stat_info);
 Datum
 polar_xlog_buffer_stat_info(PG_FUNCTION_ARGS)
 {
-#define XLOG_BUFFER_STAT_INFO_COL_SIZE 4
+#define XLOG_BUFFER_STAT_INFO_COL_SIZE 6
 	TupleDesc	tupdesc;
 	Datum		values[XLOG_BUFFER_STAT_INFO_COL_SIZE];
 	bool		nulls[XLOG_BUFFER_STAT_INFO_COL_SIZE];
@@ -56,6 +58,8 @@ polar_xlog_buffer_stat_info(PG_FUNCTION_ARGS)
 	int64		io_count = 0;
 	int64		others_append_count = 0;
 	int64		startup_append_count = 0;
+	int64		evict_count = 0;
+	int64		collision_count = 0;
 
 	if (!polar_xlog_buffer_ins)
 		PG_RETURN_NULL();
@@ -65,6 +69,8 @@ polar_xlog_buffer_stat_info(PG_FUNCTION_ARGS)
 	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "io_count", INT8OID, -1, 0);
 	TupleDescInitEntry(tupdesc, (AttrNumber) 3, "others_append_count", INT8OID, -1, 0);
 	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "startup_append_count", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "evict_count", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "collision_count", INT8OID, -1, 0);
 	tupdesc = BlessTupleDesc(tupdesc);
 
 	MemSet(nulls, 0, sizeof(nulls));
@@ -73,11 +79,15 @@ polar_xlog_buffer_stat_info(PG_FUNCTION_ARGS)
 	io_count = pg_atomic_read_u64(&polar_xlog_buffer_ins->io_count);
 	others_append_count = pg_atomic_read_u64(&polar_xlog_buffer_ins->others_append_count);
 	startup_append_count = pg_atomic_read_u64(&polar_xlog_buffer_ins->startup_append_count);
+	evict_count = pg_atomic_read_u64(&polar_xlog_buffer_ins->evict_count);
+	collision_count = pg_atomic_read_u64(&polar_xlog_buffer_ins->collision_count);
 
 	values[0] = Int64GetDatum(hit_count);
 	values[1] = Int64GetDatum(io_count);
 	values[2] = Int64GetDatum(others_append_count);
 	values[3] = Int64GetDatum(startup_append_count);
+	values[4] = Int64GetDatum(evict_count);
+	values[5] = Int64GetDatum(collision_count);
 
 	tuple = heap_form_tuple(tupdesc, values, nulls);
 	result = HeapTupleGetDatum(tuple);
@@ -101,6 +111,80 @@ polar_xlog_buffer_stat_reset(PG_FUNCTION_ARGS)
 	pg_atomic_write_u64(&polar_xlog_buffer_ins->io_count, 0);
 	pg_atomic_write_u64(&polar_xlog_buffer_ins->others_append_count, 0);
 	pg_atomic_write_u64(&polar_xlog_buffer_ins->startup_append_count, 0);
+	pg_atomic_write_u64(&polar_xlog_buffer_ins->evict_count, 0);
+	pg_atomic_write_u64(&polar_xlog_buffer_ins->collision_count, 0);
 
 	PG_RETURN_VOID();
 }
+
+/*
+ * polar_wal_group_commit_histogram
+ *
+ * Return the histograms of WAL group flushes, one row per bucket. A bucket
+ * covers [lower, upper), the last one has no upper bound.
+ */
+PG_FUNCTION_INFO_V1(polar_wal_group_commit_histogram);
+Datum
+polar_wal_group_commit_histogram(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	uint64		size_hist[POLAR_WAL_GROUP_SIZE_BUCKETS];
+	uint64		wait_hist[POLAR_WAL_GROUP_WAIT_BUCKETS];
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	polar_get_wal_group_commit_stats(size_hist, wait_hist);
+
+	for (i = 0; i < POLAR_WAL_GROUP_SIZE_BUCKETS + POLAR_WAL_GROUP_WAIT_BUCKETS; i++)
+	{
+		bool		is_size = i < POLAR_WAL_GROUP_SIZE_BUCKETS;
+		int			bucket = is_size ? i : i - POLAR_WAL_GROUP_SIZE_BUCKETS;
+		int			nbuckets = is_size ? POLAR_WAL_GROUP_SIZE_BUCKETS : POLAR_WAL_GROUP_WAIT_BUCKETS;
+		Datum		values[5];
+		bool		nulls[5];
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = CStringGetTextDatum(is_size ? "group_size" : "wait_us");
+		values[1] = Int32GetDatum(bucket);
+		values[2] = Int64GetDatum(bucket == 0 ? 0 : INT64CONST(1) << bucket);
+		if (bucket == nbuckets - 1)
+			nulls[3] = true;
+		else
+			values[3] = Int64GetDatum(INT64CONST(1) << (bucket + 1));
+		values[4] = Int64GetDatum(is_size ? size_hist[bucket] : wait_hist[bucket]);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -8,8 +8,12 @@ select COUNT(*) >= 0 AS result from polar_normal_buffercache;
 select COUNT(*) >= 0 AS result from polar_copy_buffercache;
 select COUNT(polar_flushlist()) >= 0 As result;
 select COUNT(polar_cbuf()) >= 0 As result;
+select COUNT(polar_cbuf_alloc()) >= 0 As result;
 select COUNT(polar_backend_flush()) >= 0 As result;
+select COUNT(*) >= 0 As result from polar_bgwriter_write_combine();
 select COUNT(polar_lru_flush_info()) >= 0 As result;
+select COUNT(*) >= 0 As result from polar_stat_procpool;
+select COUNT(*) >= 0 As result from polar_stat_logindex_prefetch;
 
 -- polar_stat_activity
 select a = b is_equal from (select
@@ -20,6 +24,11 @@ select a = b is_equal from (select
 select count(*)>6 from polar_stat_io_info;
 -- polar_stat_io_latency
 select count(*) from polar_stat_io_latency;
+-- polar_stat_io_latency_histogram
+select count(*) > 0 as nonempty, count(*) % 96 = 0 as all_buckets from polar_stat_io_latency_histogram;
+select bool_and(p50_us <= p99_us and p99_us <= p999_us and p999_us <= max_us) as ordered from polar_stat_io_latency_percentile;
+-- polar_stat_wal_group_commit
+select d_hist, count(*) from polar_stat_wal_group_commit group by d_hist order by d_hist;
 
 -- check polar_stat_io_info and polar_stat_activity are vaild
 DO $$
@@ -413,6 +413,11 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 			polar_max_block_count = Min(polar_get_buffer_access_strategy_ring_size(scan->rs_strategy),
 										polar_max_block_count);
 		}
+		/* The read-ahead lives as long as the scan */
+		if (scan->polar_read_ahead == NULL)
+			scan->polar_read_ahead = polar_bulk_read_ahead_begin(GetMemoryChunkContext(scan));
+		polar_bulk_read_ahead(scan->polar_read_ahead, scan->rs_base.rs_rd, MAIN_FORKNUM, page,
+							  scan->rs_nblocks, scan->rs_strategy);
 		scan->rs_cbuf = polar_bulk_read_buffer_extended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
 														RBM_NORMAL, scan->rs_strategy,
 														polar_max_block_count);
@@ -1196,6 +1201,7 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 	scan->rs_base.rs_flags = flags;
 	scan->rs_base.rs_parallel = parallel_scan;
 	scan->rs_strategy = NULL;	/* set in initscan */
+	scan->polar_read_ahead = NULL;	/* POLAR: set in heapgetpage */
 
 	/*
 	 * Disable page-at-a-time mode if it's not a MVCC-safe snapshot.
@@ -1284,6 +1290,10 @@ heap_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
 
+	/* POLAR: release the read-ahead of the scan */
+	if (scan->polar_read_ahead)
+		polar_bulk_read_ahead_end(scan->polar_read_ahead);
+
 	/*
 	 * reinitialize scan descriptor
 	 */
@@ -1303,6 +1313,10 @@ heap_endscan(TableScanDesc sscan)
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
 
+	/* POLAR: release the read-ahead of the scan */
+	if (scan->polar_read_ahead)
+		polar_bulk_read_ahead_end(scan->polar_read_ahead);
+
 	/*
 	 * decrement relation reference count and free scan descriptor storage
 	 */
@@ -163,6 +163,8 @@ typedef struct LVRelState
 	/* Buffer access strategy and parallel vacuum state */
 	BufferAccessStrategy bstrategy;
 	ParallelVacuumState *pvs;
+	/* POLAR: read-ahead of bulk read of the heap scan */
+	polar_read_ahead_state *polar_read_ahead;
 
 	/* rel's initial relfrozenxid and relminmxid */
 	TransactionId relfrozenxid;
@@ -866,6 +868,9 @@ lazy_scan_heap(LVRelState *vacrel)
 	initprog_val[2] = dead_items->max_items;
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
+	/* POLAR: read-ahead of bulk read, released when the scan is done */
+	vacrel->polar_read_ahead = polar_bulk_read_ahead_begin(CurrentMemoryContext);
+
 	/* Set up an initial range of skippable blocks using the visibility map */
 	next_unskippable_block = lazy_scan_skip(vacrel, &vmbuffer, 0,
 											&next_unskippable_allvis,
@@ -1006,12 +1011,17 @@ lazy_scan_heap(LVRelState *vacrel)
 			Assert(rel_pages > blkno);
 			maxBlockCount = rel_pages - blkno;
 
+			polar_bulk_read_ahead(vacrel->polar_read_ahead, vacrel->rel, MAIN_FORKNUM,
+								  blkno, rel_pages, vacrel->bstrategy);
 			buf = polar_bulk_read_buffer_extended(vacrel->rel, MAIN_FORKNUM, blkno,
 												  RBM_NORMAL, vacrel->bstrategy,
 												  maxBlockCount);
 		}						/* POLAR end */
 		else
 		{
+			/* POLAR: we need the only pin of the block for cleanup lock */
+			polar_bulk_read_ahead_release(vacrel->polar_read_ahead, blkno);
+
 			/* Finished preparatory checks.  Actually scan the page. */
 			buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno,
 									 RBM_NORMAL, vacrel->bstrategy);
@@ -1280,6 +1290,7 @@ lazy_scan_heap(LVRelState *vacrel)
 	vacrel->blkno = InvalidBlockNumber;
 	if (BufferIsValid(vmbuffer))
 		ReleaseBuffer(vmbuffer);
+	polar_bulk_read_ahead_end(vacrel->polar_read_ahead);
 
 	/* report that everything is now scanned */
 	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
@@ -25,6 +25,12 @@
 
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 #include "miscadmin.h"
 
 #include "access/polar_logindex_redo.h"
@@ -33,6 +39,7 @@
 #include "access/xlog_internal.h"
 #include "access/xloginsert.h"
 #include "catalog/pg_control.h"
+#include "common/pg_lzcompress.h"
 #include "pgstat.h"
 #include "replication/walreceiver.h"
 #include "storage/buf_internals.h"
@@ -50,6 +57,21 @@ int			polar_fullpage_max_segment_size = 16;
 int			polar_fullpage_snapshot_oldest_lsn_delay_threshold = 0;
 int			polar_fullpage_snapshot_replay_delay_threshold = 0;
 int			polar_fullpage_snapshot_min_modified_count = 0;
+int			polar_fullpage_compression = WAL_COMPRESSION_NONE;
+
+/* Buffer size required to store a compressed fullpage image */
+#ifdef USE_LZ4
+#define FULLPAGE_LZ4_MAX_BLCKSZ		LZ4_COMPRESSBOUND(BLCKSZ)
+#else
+#define FULLPAGE_LZ4_MAX_BLCKSZ		0
+#endif
+#ifdef USE_ZSTD
+#define FULLPAGE_ZSTD_MAX_BLCKSZ	ZSTD_COMPRESSBOUND(BLCKSZ)
+#else
+#define FULLPAGE_ZSTD_MAX_BLCKSZ	0
+#endif
+#define FULLPAGE_COMPRESS_BUFSIZE \
+	Max(Max(PGLZ_MAX_OUTPUT(BLCKSZ), FULLPAGE_LZ4_MAX_BLCKSZ), FULLPAGE_ZSTD_MAX_BLCKSZ)
 
 static bool polar_fullpage_online_promote = false;
 
@@ -57,7 +79,8 @@ static int	open_fullpage_file = -1;
 static uint64 open_fullpage_file_seg_no = -1;
 
 static void remove_old_fullpage_files(polar_fullpage_ctl_t ctl);
-static uint64 polar_xlog_read_fullpage_no(logindex_snapshot_t logindex_snapshot, XLogRecPtr lsn);
+static void polar_xlog_read_fullpage_slot(logindex_snapshot_t logindex_snapshot, XLogRecPtr lsn,
+										  polar_fullpage_slot_t *slot);
 
 /*
  * Initialization of shared memory for fullpage control
@@ -121,7 +144,7 @@ void
 polar_logindex_calc_max_fullpage_no(polar_fullpage_ctl_t ctl)
 {
 	char		path[MAXPGPATH] = {0};
-	uint64		fullpage_no = 0;
+	polar_fullpage_slot_t slot;
 	struct stat statbuf;
 	XLogSegNo	xlog_seg_no = 0;
 	XLogRecPtr	lsn = InvalidXLogRecPtr;
@@ -154,8 +177,8 @@ polar_logindex_calc_max_fullpage_no(polar_fullpage_ctl_t ctl)
 	}
 	else
 	{
-		fullpage_no = polar_xlog_read_fullpage_no(ctl->logindex_snapshot, lsn);
-		pg_atomic_write_u64(&ctl->max_fullpage_no, fullpage_no);
+		polar_xlog_read_fullpage_slot(ctl->logindex_snapshot, lsn, &slot);
+		polar_update_max_fullpage_no(ctl, &slot);
 	}
 
 	elog(LOG, "redo done at max_fullpage_no = %ld", pg_atomic_read_u64(&ctl->max_fullpage_no));
@@ -163,12 +186,35 @@ polar_logindex_calc_max_fullpage_no(polar_fullpage_ctl_t ctl)
 
 /*
  * POLAR: we update max_fullpage_no when replay wal, we guarantee that fullpage_no
- * keep the same order with wal lsn, so last fullpage_no must be max_fullpage_no
+ * keep the same order with wal lsn, so last fullpage_no must be max_fullpage_no.
+ * The next image is written after the slot of the last one.
  */
 void
-polar_update_max_fullpage_no(polar_fullpage_ctl_t ctl, uint64 fullpage_no)
+polar_update_max_fullpage_no(polar_fullpage_ctl_t ctl, const polar_fullpage_slot_t *slot)
 {
-	pg_atomic_write_u64(&ctl->max_fullpage_no, fullpage_no);
+	pg_atomic_write_u64(&ctl->max_fullpage_no, slot->fullpage_no);
+	ctl->write_seg_no = FULLPAGE_FILE_SEG_NO(slot->fullpage_no);
+	ctl->write_offset = slot->offset + FULLPAGE_IMAGE_ALIGNED_LEN(slot->length);
+}
+
+/*
+ * Get the location of fullpage image from a fullpage snapshot wal record.
+ */
+void
+polar_fullpage_get_slot(XLogReaderState *record, polar_fullpage_slot_t *slot)
+{
+	char	   *data = XLogRecGetData(record) + sizeof(PolarWalType);
+
+	if (XLogRecGetDataLen(record) >= sizeof(PolarWalType) + sizeof(polar_fullpage_slot_t))
+		memcpy(slot, data, sizeof(polar_fullpage_slot_t));
+	else
+	{
+		/* Written by old versions, an uncompressed image of fixed slot */
+		memcpy(&slot->fullpage_no, data, sizeof(uint64));
+		slot->offset = FULLPAGE_FILE_OFFSET(slot->fullpage_no);
+		slot->length = BLCKSZ;
+		slot->method = WAL_COMPRESSION_NONE;
+	}
 }
 
 /*
@@ -313,7 +359,7 @@ polar_fullpage_file_init(polar_fullpage_ctl_t ctl, uint64 fullpage_no)
 	 * pre-creating an extra log segment.  That seems OK, and better than
 	 * holding the lock throughout this lengthy process.
 	 */
-	elog(LOG, "creating and filling new FULLPAGE file");
+	elog(LOG, "creating new FULLPAGE file");
 
 	snprintf(polar_tmppath, MAXPGPATH, "%s/fullpagetemp.%d", ctl->name, (int) getpid());
 	polar_make_file_path_level2(tmppath, polar_tmppath);
@@ -327,11 +373,26 @@ polar_fullpage_file_init(polar_fullpage_ctl_t ctl, uint64 fullpage_no)
 				(errcode_for_file_access(),
 				 errmsg("could not create file \"%s\": %m", tmppath)));
 
-	/* POLAR: File allocate, juse change file metadata once */
+	/*
+	 * POLAR: File allocate, juse change file metadata once. Only the written
+	 * slots of the segment are read, so it's not filled with zero unless the
+	 * allocation fails.
+	 */
 	if (polar_fallocate(fd, 0, FULLPAGE_SEGMENT_SIZE) != 0)
-		elog(ERROR, "polar_posix_fallocate fail in polar_fullpage_file_init");
+	{
+		elog(LOG, "could not allocate file \"%s\", fill it with zero: %m", tmppath);
+		fill_fullpage_file_zero_pages(fd, tmppath);
+	}
+	else if (polar_fsync(fd) != 0)
+	{
+		int			save_errno = errno;
 
-	fill_fullpage_file_zero_pages(fd, tmppath);
+		polar_close(fd);
+		errno = save_errno;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", tmppath)));
+	}
 
 	if (polar_close(fd))
 		ereport(ERROR,
@@ -368,7 +429,7 @@ polar_fullpage_file_init(polar_fullpage_ctl_t ctl, uint64 fullpage_no)
 				(errcode_for_file_access(),
 				 errmsg("could not open file \"%s\": %m", path)));
 
-	elog(LOG, "done creating and filling new FULLPAGE file %s", path);
+	elog(LOG, "done creating new FULLPAGE file %s", path);
 
 	return fd;
 }
@@ -399,15 +460,59 @@ fullpage_file_open(polar_fullpage_ctl_t ctl, uint64 fullpage_no)
 	return polar_fullpage_file_init(ctl, fullpage_no);
 }
 
+/*
+ * Allocate nimages consecutive fullpage_no and size bytes in their segment,
+ * and hold the file lock until polar_log_fullpage_end.
+ *
+ * Images of a batch are written in one io, so they never cross segments.
+ * The segment has room for FULLPAGE_NUM_PER_FILE uncompressed images, it's
+ * only full when the images before were written by old versions.
+ *
+ * The file lock is released before the images are written, so each batch
+ * starts at FULLPAGE_BATCH_ALIGN and size must be a multiple of it. Then no
+ * two batches share a direct io block, which polar_directio would otherwise
+ * write by read-modify-write without any lock.
+ */
 static uint64
-polar_log_fullpage_begin(polar_fullpage_ctl_t ctl)
+polar_log_fullpage_begin(polar_fullpage_ctl_t ctl, int nimages, Size size, uint32 *offset)
 {
+	uint64		fullpage_no;
+	uint64		seg_no;
+
+	Assert(nimages <= FULLPAGE_NUM_PER_FILE && size <= FULLPAGE_SEGMENT_SIZE);
+	Assert(size % FULLPAGE_BATCH_ALIGN == 0);
+
 	/*
 	 * fullpage_no must keep the same order with lsn.
 	 */
 	LWLockAcquire(LOG_INDEX_FULLPAGE_FILE_LOCK(ctl), LW_EXCLUSIVE);
 
-	return pg_atomic_fetch_add_u64(&ctl->max_fullpage_no, 1);
+	fullpage_no = pg_atomic_read_u64(&ctl->max_fullpage_no);
+	seg_no = FULLPAGE_FILE_SEG_NO(fullpage_no);
+
+	if (seg_no != ctl->write_seg_no)
+	{
+		ctl->write_seg_no = seg_no;
+		ctl->write_offset = 0;
+	}
+
+	/* The last batch replayed may end in the middle of a direct io block */
+	ctl->write_offset = TYPEALIGN(FULLPAGE_BATCH_ALIGN, ctl->write_offset);
+
+	if (FULLPAGE_FILE_SEG_NO(fullpage_no + nimages - 1) != seg_no ||
+		ctl->write_offset + size > FULLPAGE_SEGMENT_SIZE)
+	{
+		/* Switch to the next segment */
+		fullpage_no = (seg_no + 1) * FULLPAGE_NUM_PER_FILE;
+		ctl->write_seg_no = seg_no + 1;
+		ctl->write_offset = 0;
+	}
+
+	*offset = (uint32) ctl->write_offset;
+	ctl->write_offset += size;
+	pg_atomic_write_u64(&ctl->max_fullpage_no, fullpage_no + nimages);
+
+	return fullpage_no;
 }
 
 static void
@@ -416,11 +521,8 @@ polar_log_fullpage_end(polar_fullpage_ctl_t ctl)
 	LWLockRelease(LOG_INDEX_FULLPAGE_FILE_LOCK(ctl));
 }
 
-/*
- * POLAR: write old version page to fullpage file
- */
 static void
-polar_write_fullpage(polar_fullpage_ctl_t ctl, Page page, uint64 fullpage_no)
+fullpage_file_switch(polar_fullpage_ctl_t ctl, uint64 fullpage_no)
 {
 	if (open_fullpage_file < 0)
 	{
@@ -433,29 +535,143 @@ polar_write_fullpage(polar_fullpage_ctl_t ctl, Page page, uint64 fullpage_no)
 		open_fullpage_file = fullpage_file_open(ctl, fullpage_no);
 		open_fullpage_file_seg_no = FULLPAGE_FILE_SEG_NO(fullpage_no);
 	}
+}
+
+/*
+ * Compress page into dest by polar_fullpage_compression, returns the length
+ * of the compressed image, or -1 if it's not smaller than the page.
+ */
+static int
+fullpage_compress(const char *page, char *dest)
+{
+	int32		len = -1;
+
+	switch ((WalCompression) polar_fullpage_compression)
+	{
+		case WAL_COMPRESSION_PGLZ:
+			len = pglz_compress(page, BLCKSZ, dest, PGLZ_strategy_default);
+			break;
+
+		case WAL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_compress_default(page, dest, BLCKSZ,
+									   FULLPAGE_COMPRESS_BUFSIZE);
+			if (len <= 0)
+				len = -1;		/* failure */
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case WAL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			len = ZSTD_compress(dest, FULLPAGE_COMPRESS_BUFSIZE, page, BLCKSZ,
+								ZSTD_CLEVEL_DEFAULT);
+			if (ZSTD_isError(len))
+				len = -1;		/* failure */
+#else
+			elog(ERROR, "zstd is not supported by this build");
+#endif
+			break;
+
+		case WAL_COMPRESSION_NONE:
+			break;
+	}
+
+	/* Only keep the compressed image if it saves an aligned unit at least */
+	if (len >= 0 && FULLPAGE_IMAGE_ALIGNED_LEN(len) < BLCKSZ)
+		return len;
+
+	return -1;
+}
+
+static void
+fullpage_decompress(const polar_fullpage_slot_t *slot, const char *image, Page page)
+{
+	int32		len = -1;
+
+	switch ((WalCompression) slot->method)
+	{
+		case WAL_COMPRESSION_PGLZ:
+			len = pglz_decompress(image, slot->length, (char *) page, BLCKSZ, true);
+			break;
+
+		case WAL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_decompress_safe(image, (char *) page, slot->length, BLCKSZ);
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case WAL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			len = ZSTD_decompress((char *) page, BLCKSZ, image, slot->length);
+			if (ZSTD_isError(len))
+				len = -1;
+#else
+			elog(ERROR, "zstd is not supported by this build");
+#endif
+			break;
+
+		default:
+			break;
+	}
 
-	polar_pwrite(open_fullpage_file, (void *) page, BLCKSZ, FULLPAGE_FILE_OFFSET(fullpage_no));
+	if (len != BLCKSZ)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("could not decompress fullpage image %lu at offset %u, length %u, method %d",
+						slot->fullpage_no, slot->offset, slot->length, slot->method)));
 }
 
 /*
- * POLAR: read old version page from fullpage file
+ * POLAR: write old version pages to fullpage file in one io
  */
-void
-polar_read_fullpage(polar_fullpage_ctl_t ctl, Page page, uint64 fullpage_no)
+static void
+polar_write_fullpages(polar_fullpage_ctl_t ctl, char *data, Size size, uint64 fullpage_no, uint32 offset)
 {
-	if (open_fullpage_file < 0)
+	ssize_t		rc;
+
+	fullpage_file_switch(ctl, fullpage_no);
+
+	errno = 0;
+	rc = polar_pwrite(open_fullpage_file, data, size, offset);
+
+	if (rc != size)
 	{
-		open_fullpage_file = fullpage_file_open(ctl, fullpage_no);
-		open_fullpage_file_seg_no = FULLPAGE_FILE_SEG_NO(fullpage_no);
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write fullpage %lu at offset %u, length %lu: %m",
+						fullpage_no, offset, size)));
 	}
-	else if (open_fullpage_file_seg_no != FULLPAGE_FILE_SEG_NO(fullpage_no))
+}
+
+/*
+ * POLAR: read old version page from fullpage file
+ */
+void
+polar_read_fullpage(polar_fullpage_ctl_t ctl, Page page, const polar_fullpage_slot_t *slot)
+{
+	static char *image = NULL;
+
+	fullpage_file_switch(ctl, slot->fullpage_no);
+
+	if (slot->method == WAL_COMPRESSION_NONE)
 	{
-		polar_close(open_fullpage_file);
-		open_fullpage_file = fullpage_file_open(ctl, fullpage_no);
-		open_fullpage_file_seg_no = FULLPAGE_FILE_SEG_NO(fullpage_no);
+		Assert(slot->length == BLCKSZ);
+		polar_pread(open_fullpage_file, (void *) page, BLCKSZ, slot->offset);
+		return;
 	}
 
-	polar_pread(open_fullpage_file, (void *) page, BLCKSZ, FULLPAGE_FILE_OFFSET(fullpage_no));
+	if (image == NULL)
+		image = MemoryContextAllocIOAligned(TopMemoryContext, BLCKSZ, 0);
+
+	polar_pread(open_fullpage_file, image, slot->length, slot->offset);
+	fullpage_decompress(slot, image, page);
 }
 
 /*
@@ -538,13 +754,13 @@ polar_remove_old_fullpage_files(polar_fullpage_ctl_t ctl, XLogRecPtr min_lsn)
 	remove_old_fullpage_files(ctl);
 }
 
-static uint64
-polar_xlog_read_fullpage_no(logindex_snapshot_t logindex_snapshot, XLogRecPtr lsn)
+static void
+polar_xlog_read_fullpage_slot(logindex_snapshot_t logindex_snapshot, XLogRecPtr lsn,
+							  polar_fullpage_slot_t *slot)
 {
 	XLogRecord *record;
 	XLogReaderState *xlogreader;
 	char	   *errormsg;
-	uint64		fullpage_no = 0;
 
 	xlogreader = XLogReaderAllocate(wal_segment_size, NULL,
 									XL_ROUTINE(.page_read = &read_local_xlog_page,
@@ -575,10 +791,9 @@ polar_xlog_read_fullpage_no(logindex_snapshot_t logindex_snapshot, XLogRecPtr ls
 				 errmsg("expected fullpage wal state data is not present in WAL at %X/%X",
 						LSN_FORMAT_ARGS(lsn))));
 
-	/* get fullpage_no from record */
-	memcpy(&fullpage_no, XLogRecGetData(xlogreader) + sizeof(PolarWalType), sizeof(uint64));
+	/* get fullpage slot from record */
+	polar_fullpage_get_slot(xlogreader, slot);
 	XLogReaderFree(xlogreader);
-	return fullpage_no;
 }
 
 /*
@@ -589,7 +804,7 @@ remove_old_fullpage_files(polar_fullpage_ctl_t ctl)
 {
 	char		path[MAXPGPATH] = {0};
 	uint64		min_fullpage_seg_no = 0;
-	uint64		fullpage_no = 0;
+	polar_fullpage_slot_t slot;
 	struct stat statbuf;
 	XLogSegNo	xlog_seg_no = 0;
 	XLogRecPtr	min_lsn = InvalidXLogRecPtr;
@@ -607,8 +822,8 @@ remove_old_fullpage_files(polar_fullpage_ctl_t ctl)
 	if (polar_lstat(path, &statbuf) < 0)
 		return;
 
-	fullpage_no = polar_xlog_read_fullpage_no(ctl->logindex_snapshot, min_lsn);
-	min_fullpage_seg_no = FULLPAGE_FILE_SEG_NO(fullpage_no);
+	polar_xlog_read_fullpage_slot(ctl->logindex_snapshot, min_lsn, &slot);
+	min_fullpage_seg_no = FULLPAGE_FILE_SEG_NO(slot.fullpage_no);
 
 	while (min_fullpage_seg_no > 0)
 	{
@@ -627,6 +842,51 @@ remove_old_fullpage_files(polar_fullpage_ctl_t ctl)
 	}
 }
 
+/*
+ * POLAR: get the old version of page to write fullpage snapshot. It's the copy
+ * buffer if it can be flushed, otherwise the page on storage, which is read
+ * into page if read is true, or has been read by caller.
+ */
+void
+polar_fullpage_get_old_image(Buffer buffer, XLogRecPtr oldest_apply_lsn, char *page, bool read)
+{
+	BufferDesc *buf_hdr = GetBufferDescriptor(buffer - 1);
+	SMgrRelation smgr;
+	RelFileNode rnode;
+	ForkNumber	forkNum;
+	BlockNumber blkno;
+
+	BufferGetTag(buffer, &rnode, &forkNum, &blkno);
+
+	/*
+	 * If we have copy buffer, and copy buffer can be flushed, just treat copy
+	 * buffer as fullpage, so we can avoid reading older page from storage
+	 */
+	if (buf_hdr->copy_buffer &&
+		polar_copy_buffer_get_lsn(buf_hdr->copy_buffer) <= oldest_apply_lsn)
+	{
+		memcpy(page, (char *) CopyBufHdrGetBlock(buf_hdr->copy_buffer), BLCKSZ);
+		return;
+	}
+
+	/* Find smgr relation for buffer */
+	smgr = smgropen(rnode, InvalidBackendId);
+
+	if (read)
+		smgrread(smgr, forkNum, blkno, page);
+
+	/* check for garbage data, decrypt page if it has beed encrypted */
+	if (!PageIsVerified((Page) page, blkno))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid page in block %u of relation %u/%u/%u_%d",
+						blkno,
+						smgr->smgr_rnode.node.spcNode,
+						smgr->smgr_rnode.node.dbNode,
+						smgr->smgr_rnode.node.relNode,
+						forkNum)));
+}
+
 /*
  * POLAR: write a WAL record containing a full snapshot image of a page. Caller is
  * responsible for writing the page to disk after calling this routine.
@@ -634,18 +894,9 @@ remove_old_fullpage_files(polar_fullpage_ctl_t ctl)
 XLogRecPtr
 polar_log_fullpage_snapshot_image(polar_fullpage_ctl_t ctl, Buffer buffer, XLogRecPtr oldest_apply_lsn)
 {
-	SMgrRelation smgr = NULL;
-	int			flags;
-	RelFileNode rnode;
-	ForkNumber	forkNum;
-	BlockNumber blkno;
-	XLogRecPtr	recptr;
-	BufferDesc *buf_hdr = GetBufferDescriptor(buffer - 1);
-	uint64		fullpage_no = 0;
 	static char *fullpage = NULL;
-	char	   *rel_path;
 
-	PolarWalType wtype = PWT_FPSI;
+	Assert(polar_is_primary());
 
 	/*
 	 * We allocate the old page space once and use it over on each subsequent
@@ -654,62 +905,110 @@ polar_log_fullpage_snapshot_image(polar_fullpage_ctl_t ctl, Buffer buffer, XLogR
 	if (fullpage == NULL)
 		fullpage = MemoryContextAllocIOAligned(TopMemoryContext, BLCKSZ, 0);
 
-	Assert(polar_is_primary());
+	polar_fullpage_get_old_image(buffer, oldest_apply_lsn, fullpage, true);
 
-	flags = REGBUF_NO_IMAGE;
-	BufferGetTag(buffer, &rnode, &forkNum, &blkno);
+	return polar_log_fullpage_snapshot_images(ctl, &buffer, &fullpage, 1);
+}
 
-	/*
-	 * If we have copy buffer, and copy buffer can be flushed, just treat copy
-	 * buffer as fullpage, so we can avoid reading older page from storage
-	 */
-	if (buf_hdr->copy_buffer &&
-		polar_copy_buffer_get_lsn(buf_hdr->copy_buffer) <= oldest_apply_lsn)
-		memcpy(fullpage, (char *) CopyBufHdrGetBlock(buf_hdr->copy_buffer), BLCKSZ);
-	else
+/*
+ * POLAR: write a fullpage snapshot WAL record for each of buffers, whose old
+ * pages are in pages, and write the images to fullpage file in one io. Returns
+ * the lsn of the last record. Caller is responsible for writing the buffers to
+ * disk after calling this routine.
+ */
+XLogRecPtr
+polar_log_fullpage_snapshot_images(polar_fullpage_ctl_t ctl, Buffer *buffers, char **pages, int nbuffers)
+{
+	static char *data = NULL;
+	static int	data_size = 0;
+	static char *compressed = NULL;
+	polar_fullpage_slot_t slot;
+	XLogRecPtr	recptr = InvalidXLogRecPtr;
+	PolarWalType wtype = PWT_FPSI;
+	uint16		lengths[POLAR_MAX_BULK_IO_SIZE];
+	uint8		methods[POLAR_MAX_BULK_IO_SIZE];
+	uint64		fullpage_no;
+	uint32		offset;
+	Size		size = 0;
+	int			i;
+
+	Assert(polar_is_primary());
+	Assert(nbuffers > 0 && nbuffers <= POLAR_MAX_BULK_IO_SIZE);
+	StaticAssertStmt(BLCKSZ % FULLPAGE_BATCH_ALIGN == 0,
+					 "padded batch must fit in nbuffers * BLCKSZ");
+
+	if (data_size < nbuffers)
 	{
-		/* Find smgr relation for buffer */
-		smgr = smgropen(rnode, InvalidBackendId);
+		if (data)
+			pfree(data);
+		data = MemoryContextAllocIOAligned(TopMemoryContext, nbuffers * BLCKSZ, 0);
+		data_size = nbuffers;
+	}
 
-		smgrread(smgr, forkNum, blkno, (char *) fullpage);
+	if (compressed == NULL)
+		compressed = MemoryContextAlloc(TopMemoryContext, FULLPAGE_COMPRESS_BUFSIZE);
 
-		/* check for garbage data, decrypt page if it has beed encrypted */
-		rel_path = relpath(smgr->smgr_rnode, forkNum);
-		if (!PageIsVerified((Page) fullpage, blkno))
+	/* Pack the images one after another before taking the file lock */
+	for (i = 0; i < nbuffers; i++)
+	{
+		int			len = fullpage_compress(pages[i], compressed);
+		Size		aligned_len;
+
+		if (len < 0)
 		{
-			pfree(rel_path);
-			ereport(ERROR,
-					(errcode(ERRCODE_DATA_CORRUPTED),
-					 errmsg("invalid page in block %u of relation %u/%u/%u_%d",
-							blkno,
-							smgr->smgr_rnode.node.spcNode,
-							smgr->smgr_rnode.node.dbNode,
-							smgr->smgr_rnode.node.relNode,
-							forkNum)));
+			lengths[i] = BLCKSZ;
+			methods[i] = WAL_COMPRESSION_NONE;
+			memcpy(data + size, pages[i], BLCKSZ);
 		}
-		pfree(rel_path);
+		else
+		{
+			lengths[i] = (uint16) len;
+			methods[i] = (uint8) polar_fullpage_compression;
+			memcpy(data + size, compressed, len);
+		}
+
+		aligned_len = FULLPAGE_IMAGE_ALIGNED_LEN(lengths[i]);
+		MemSet(data + size + lengths[i], 0, aligned_len - lengths[i]);
+		size += aligned_len;
 	}
 
+	/* Pad the batch to whole direct io blocks, see polar_log_fullpage_begin */
+	MemSet(data + size, 0, FULLPAGE_BATCH_ALIGNED_LEN(size) - size);
+	size = FULLPAGE_BATCH_ALIGNED_LEN(size);
+
 	/*
 	 * POLAR: get fullpage write lock, only one process can write fullpage wal
 	 * record at the same time, we expected that fullpage_no keep the same
 	 * order with lsn, it's used for easily cleaning fullpage file NOTE: we
 	 * assume that XLogInsert is more faster then smgrread and
-	 * polar_write_fullpage
+	 * polar_write_fullpages
 	 */
-	fullpage_no = polar_log_fullpage_begin(ctl);
+	fullpage_no = polar_log_fullpage_begin(ctl, nbuffers, size, &offset);
+
+	MemSet(&slot, 0, sizeof(slot));
+	slot.offset = offset;
 
-	XLogBeginInsert();
-	XLogRegisterBuffer(0, buffer, flags);
-	XLogRegisterData((char *) (&wtype), sizeof(PolarWalType));
-	XLogRegisterData((char *) (&fullpage_no), sizeof(uint64));
+	for (i = 0; i < nbuffers; i++)
+	{
+		slot.fullpage_no = fullpage_no + i;
+		slot.length = lengths[i];
+		slot.method = methods[i];
+
+		XLogBeginInsert();
+		XLogRegisterBuffer(0, buffers[i], REGBUF_NO_IMAGE);
+		XLogRegisterData((char *) (&wtype), sizeof(PolarWalType));
+		XLogRegisterData((char *) (&slot), sizeof(polar_fullpage_slot_t));
 
-	recptr = XLogInsert(RM_XLOG_ID, POLAR_WAL);
+		recptr = XLogInsert(RM_XLOG_ID, POLAR_WAL);
+
+		slot.offset += FULLPAGE_IMAGE_ALIGNED_LEN(lengths[i]);
+	}
 
 	/* POLAR: release fullpage write lock */
 	polar_log_fullpage_end(ctl);
 
-	polar_write_fullpage(ctl, fullpage, fullpage_no);
+	polar_write_fullpages(ctl, data, size, fullpage_no, offset);
+
 	return recptr;
 }
 
@@ -40,20 +40,81 @@
 #include "pgstat.h"
 #include "port/atomics.h"
 #include "port/pg_crc32c.h"
+#include "portability/instr_time.h"
 #include "postmaster/startup.h"
 #include "storage/fd.h"
+#include "storage/polar_procpool.h"
 #include "utils/faultinjector.h"
 #include "utils/memutils.h"
 
 int			polar_logindex_table_batch_size = 1;
 int			polar_max_logindex_files;
 int			polar_trace_logindex_messages = LOG;
+int			polar_logindex_table_compression = LOG_INDEX_TABLE_COMPRESSION_PACKED;
+int			polar_logindex_load_workers = 4;
+bool		polar_logindex_adaptive_table = true;
 
 static log_index_io_err_t logindex_io_err = 0;
 static int	logindex_errno = 0;
 
+/*
+ * Offsets of the tables which are already located in one segment file.
+ * Tables are appended to the segment file in tid order, and the offset of a
+ * table never changes once it's saved, so we don't have to walk the file from
+ * the beginning again to locate the next table.
+ */
+typedef struct log_index_table_offsets_t
+{
+	char		dir[NAMEDATALEN];
+	uint64		segno;
+	int			num;
+	off_t		offset[LOG_INDEX_TABLE_NUM_PER_FILE];
+}			log_index_table_offsets_t;
+
+static log_index_table_offsets_t table_offsets;
+
+/*
+ * Tables whose blooms are saved in the same bloom page are loaded together,
+ * by startup itself or by one of the load workers.
+ */
+typedef struct log_index_load_unit_t
+{
+	log_idx_table_id_t min_tid;
+	log_idx_table_id_t max_tid;
+	XLogRecPtr	start_lsn;		/* Stop loading when the table has start_lsn */
+	bool		rebuild_bloom;
+	/* The following are set when the unit is loaded */
+	log_idx_table_id_t failed_tid;
+	log_idx_table_id_t stop_tid;
+	uint64		tables;
+	uint64		read_us;
+	uint64		validate_us;
+	uint64		bloom_us;
+}			log_index_load_unit_t;
+
+typedef struct log_index_load_task_node_t
+{
+	polar_task_node_t task;
+	log_index_snapshot_t *logindex_snapshot;
+	log_index_load_unit_t unit;
+}			log_index_load_task_node_t;
+
+typedef struct log_index_load_state_t
+{
+	log_index_snapshot_t *logindex_snapshot;
+	log_idx_table_id_t stop_tid;	/* Max table which has start_lsn */
+	log_idx_table_id_t min_dispatched_tid;
+	polar_logindex_load_stat_t stat;
+}			log_index_load_state_t;
+
+#define LOG_INDEX_LOAD_TASK_QUEUE_DEPTH (4)
+
+#define LOG_INDEX_TBL_BLOOM_PAGE_FIRST_TID(tid) \
+	((tid) - LOG_INDEX_TBL_BLOOM_PAGE_OFFSET(tid) / LOG_INDEX_FILE_TBL_BLOOM_SIZE)
+
 static void log_index_insert_new_item(log_index_lsn_t * lsn_info, log_mem_table_t * table, uint32 key, log_seg_id_t new_item_id);
 static void log_index_insert_new_seg(log_mem_table_t * table, log_seg_id_t head, log_seg_id_t seg_id, log_index_lsn_t * lsn_info);
+static void log_index_reset_table_geometry(log_index_snapshot_t * logindex_snapshot);
 
 bool
 polar_logindex_check_state(log_index_snapshot_t * logindex_snapshot, uint32 state)
@@ -466,6 +527,22 @@ log_index_init_lwlock(log_index_snapshot_t * logindex_snapshot, int offset, int
 		LWLockInitialize(&(logindex_snapshot->lwlock_array[i].lock), tranche_id);
 }
 
+/*
+ * Tell the users who remember what they found in logindex, like the page
+ * lsn cache, that it's no longer what it was.
+ */
+static void
+log_index_bump_generation(log_index_snapshot_t * logindex_snapshot)
+{
+	pg_atomic_fetch_add_u32(&logindex_snapshot->generation, 1);
+}
+
+uint32
+polar_logindex_generation(logindex_snapshot_t logindex_snapshot)
+{
+	return pg_atomic_read_u32(&logindex_snapshot->generation);
+}
+
 static void
 polar_logindex_snapshot_remove_data(logindex_snapshot_t logindex_snapshot)
 {
@@ -519,6 +596,9 @@ polar_logindex_snapshot_base_init(log_index_snapshot_t * logindex_snapshot, XLog
 
 	POLAR_LOG_LOGINDEX_META_INFO(meta);
 
+	/* Logindex may be reset above, and the memory tables are reset below */
+	log_index_bump_generation(logindex_snapshot);
+
 	logindex_snapshot_init_promoted_info(logindex_snapshot);
 	logindex_snapshot->max_idx_table_id = meta->max_idx_table_id;
 	LOG_INDEX_MEM_TBL_ACTIVE_ID = meta->max_idx_table_id % logindex_snapshot->mem_tbl_size;
@@ -526,6 +606,7 @@ polar_logindex_snapshot_base_init(log_index_snapshot_t * logindex_snapshot, XLog
 	logindex_snapshot->max_lsn = meta->max_lsn;
 	MemSet(logindex_snapshot->mem_table, 0,
 		   sizeof(log_mem_table_t) * logindex_snapshot->mem_tbl_size);
+	log_index_reset_table_geometry(logindex_snapshot);
 
 	/*
 	 * If meta->start_lsn is invalid, we will not parse xlog and save it to
@@ -642,6 +723,11 @@ polar_logindex_snapshot_shmem_init(const char *name, uint64 logindex_mem_tbl_siz
 	StaticAssertStmt(sizeof(log_item_seg_t) == LOG_INDEX_TBL_SEG_SIZE,
 					 "log_item_seg_t size is not same as LOG_INDEX_MEM_TBL_SEG_SIZE");
 
+	StaticAssertStmt(LOG_INDEX_TBL_AREA_SIZE % LOG_INDEX_TBL_SEG_SIZE == 0,
+					 "LOG_INDEX_TBL_AREA_SIZE is not multiple of LOG_INDEX_TBL_SEG_SIZE");
+	StaticAssertStmt((LOG_INDEX_TBL_MAX_SEG_NUM - 1) * LOG_INDEX_ITEM_SEG_LSN_NUM + LOG_INDEX_ITEM_SEG_LSN_NUM <= PG_UINT16_MAX,
+					 "LOG_INDEX_TBL_MAX_SEG_NUM is too large to be saved in idx_order");
+
 	StaticAssertStmt(LOG_INDEX_FILE_TBL_BLOOM_SIZE > sizeof(log_file_table_bloom_t),
 					 "LOG_INDEX_FILE_TBL_BLOOM_SIZE is not enough for log_file_table_bloom_t");
 
@@ -664,6 +750,7 @@ polar_logindex_snapshot_shmem_init(const char *name, uint64 logindex_mem_tbl_siz
 		logindex_snapshot->mem_tbl_size = logindex_mem_tbl_size;
 
 		pg_atomic_init_u32(&logindex_snapshot->state, 0);
+		pg_atomic_init_u32(&logindex_snapshot->generation, 0);
 
 		log_index_init_lwlock_array(logindex_snapshot, tranche_id_begin, tranche_id_end);
 
@@ -675,6 +762,9 @@ polar_logindex_snapshot_shmem_init(const char *name, uint64 logindex_mem_tbl_siz
 
 		strlcpy(logindex_snapshot->dir, name, NAMEDATALEN);
 		logindex_snapshot->segment_cache = NULL;
+		logindex_snapshot->load_sched = NULL;
+		MemSet(&logindex_snapshot->load_stat, 0, sizeof(polar_logindex_load_stat_t));
+		log_index_reset_table_geometry(logindex_snapshot);
 	}
 	else
 		POLAR_ASSERT_PANIC(found_snapshot && found_locks);
@@ -694,29 +784,15 @@ polar_logindex_snapshot_shmem_init(const char *name, uint64 logindex_mem_tbl_siz
 	return logindex_snapshot;
 }
 
-static bool
-log_index_handle_update_v1_to_v2(log_index_meta_t * meta)
-{
-	if (polar_is_standby())
-		return false;
-
-	return true;
-}
-
+/*
+ * Since version 4 segments, hash slots and idx_order of a table share one
+ * area, so tables saved by older versions can't be read any more. The caller
+ * resets logindex and rebuilds it from the checkpoint when it's incompatible.
+ */
 static bool
 log_index_data_compatible(log_index_meta_t * meta)
 {
-	switch (meta->version)
-	{
-		case 1:
-			return log_index_handle_update_v1_to_v2(meta);
-
-		case LOG_INDEX_VERSION:
-			return true;
-
-		default:
-			return false;
-	}
+	return meta->version == LOG_INDEX_VERSION;
 }
 
 bool
@@ -974,7 +1050,7 @@ log_index_mem_tbl_exists_page(BufferTag *tag,
 	item = log_index_item_head(table, exists);
 
 	while (item != NULL &&
-		   !BUFFERTAGS_EQUAL(item->tag, *tag))
+		   !log_index_tag_equal(&item->tag, tag))
 	{
 		exists = item->next_item;
 		item = log_index_item_head(table, exists);
@@ -1018,7 +1094,6 @@ log_index_insert_new_item(log_index_lsn_t * lsn_info,
 	log_item_head_t *new_item = log_index_item_head(&table->data, new_item_id);
 	log_seg_id_t *slot;
 
-	POLAR_ASSERT_PANIC(key < LOG_INDEX_MEM_TBL_HASH_NUM);
 	slot = LOG_INDEX_TBL_SLOT(&table->data, key);
 
 	new_item->head_seg = new_item_id;
@@ -1103,6 +1178,96 @@ log_index_append_lsn(log_mem_table_t * table, log_seg_id_t head, log_index_lsn_t
 	return idx;
 }
 
+static void
+log_index_reset_table_geometry(log_index_snapshot_t * logindex_snapshot)
+{
+	logindex_snapshot->table_seg_num = LOG_INDEX_MEM_TBL_SEG_NUM;
+	logindex_snapshot->table_hash_num = LOG_INDEX_MEM_TBL_HASH_NUM;
+}
+
+static uint32
+log_index_table_seg_num(uint32 hash_num, uint32 used_segs, uint32 used_orders)
+{
+	/*
+	 * Keep the same number of orders per segment as the observed table, so
+	 * segments and orders run out at the same time.
+	 */
+	return (uint32) ((uint64) (LOG_INDEX_TBL_AREA_SIZE - hash_num * sizeof(log_seg_id_t)) * used_segs /
+					 ((uint64) used_segs * LOG_INDEX_TBL_SEG_SIZE + (uint64) used_orders * sizeof(uint16)));
+}
+
+/*
+ * POLAR: Choose the geometry of the next active table from the table which is
+ * just switched out.  When pages are touched only once or twice in a table,
+ * most segments are item heads which are not full, and the table runs out of
+ * segments while most orders are unused.  So we move the area from orders to
+ * segments, and size the hash slots from the number of pages.  The geometry
+ * is only changed if it's different enough, so it doesn't flap.
+ */
+static void
+log_index_adapt_table_geometry(log_index_snapshot_t * logindex_snapshot, log_mem_table_t * table)
+{
+	log_idx_table_data_t *data = &table->data;
+	uint32		used_segs = LOG_INDEX_MEM_TBL_FREE_HEAD(table) - 1;
+	uint32		used_orders = data->last_order;
+	uint32		items = 0;
+	uint32		seg_num;
+	uint32		hash_num;
+	int			i;
+
+	if (!polar_logindex_adaptive_table)
+	{
+		log_index_reset_table_geometry(logindex_snapshot);
+		return;
+	}
+
+	/* Table which is switched because of lsn prefix may be almost empty */
+	if (used_segs < data->seg_num / 2 || used_orders < used_segs)
+		return;
+
+	for (i = 0; i < data->hash_num; i++)
+	{
+		log_item_head_t *item = log_index_item_head(data, LOG_INDEX_TBL_SLOT_VALUE(data, i));
+
+		while (item != NULL)
+		{
+			items++;
+			item = log_index_item_head(data, item->next_item);
+		}
+	}
+
+	/* Expect two pages per hash slot at most, like the default geometry */
+	seg_num = log_index_table_seg_num(logindex_snapshot->table_hash_num, used_segs, used_orders);
+	items = (uint64) items * seg_num / used_segs;
+	hash_num = LOG_INDEX_TBL_MIN_HASH_NUM;
+	while (hash_num < LOG_INDEX_TBL_MAX_HASH_NUM && hash_num * 2 < items)
+		hash_num *= 2;
+
+	seg_num = log_index_table_seg_num(hash_num, used_segs, used_orders);
+	seg_num = Max(seg_num, LOG_INDEX_TBL_MIN_SEG_NUM);
+	seg_num = Min(seg_num, LOG_INDEX_TBL_MAX_SEG_NUM);
+
+	if (Abs((int) seg_num - (int) logindex_snapshot->table_seg_num) <
+		logindex_snapshot->table_seg_num / 16)
+		seg_num = logindex_snapshot->table_seg_num;
+
+	/* The kept segments must still fit in the area with the new hash slots */
+	if (seg_num * LOG_INDEX_TBL_SEG_SIZE + hash_num * sizeof(log_seg_id_t) +
+		seg_num * sizeof(uint16) > LOG_INDEX_TBL_AREA_SIZE)
+		seg_num = log_index_table_seg_num(hash_num, used_segs, used_orders);
+
+	if (seg_num != logindex_snapshot->table_seg_num ||
+		hash_num != logindex_snapshot->table_hash_num)
+		elog(polar_trace_logindex(DEBUG1),
+			 "%s logindex table geometry changes from segs=%u hash=%u to segs=%u hash=%u, used_segs=%u used_orders=%u items=%u",
+			 logindex_snapshot->dir, logindex_snapshot->table_seg_num,
+			 logindex_snapshot->table_hash_num, seg_num, hash_num,
+			 used_segs, used_orders, items);
+
+	logindex_snapshot->table_seg_num = seg_num;
+	logindex_snapshot->table_hash_num = hash_num;
+}
+
 static log_seg_id_t
 log_index_next_free_seg(log_index_snapshot_t * logindex_snapshot, XLogRecPtr lsn, log_mem_table_t * *active_table)
 {
@@ -1133,6 +1298,7 @@ log_index_next_free_seg(log_index_snapshot_t * logindex_snapshot, XLogRecPtr lsn
 					 !LOG_INDEX_SAME_TABLE_LSN_PREFIX(&active->data, lsn))
 			{
 				LOG_INDEX_MEM_TBL_SET_STATE(active, LOG_INDEX_MEM_TBL_STATE_INACTIVE);
+				log_index_adapt_table_geometry(logindex_snapshot, active);
 				next_mem_id = LOG_INDEX_MEM_TBL_NEXT_ID(LOG_INDEX_MEM_TBL_ACTIVE_ID);
 			}
 			else
@@ -1210,7 +1376,7 @@ log_index_calc_bloom(log_idx_table_data_t * table_data, log_file_table_bloom_t *
 	filter = polar_bloom_init_struct(bloom->bloom_bytes, bloom->buf_size,
 									 LOG_INDEX_BLOOM_ELEMS_NUM, 0);
 
-	for (i = 0; i < LOG_INDEX_MEM_TBL_HASH_NUM; i++)
+	for (i = 0; i < table_data->hash_num; i++)
 	{
 		log_seg_id_t id = LOG_INDEX_TBL_SLOT_VALUE(table_data, i);
 
@@ -1232,13 +1398,108 @@ log_index_calc_bloom(log_idx_table_data_t * table_data, log_file_table_bloom_t *
 	}
 }
 
+/*
+ * Locate table tid in its segment file, return its offset and record size.
+ * Walk the record headers from the last located table of this segment.
+ */
+static bool
+log_index_locate_table(log_index_snapshot_t * logindex_snapshot, File fd, log_idx_table_id_t tid,
+					   off_t *offset, Size *size)
+{
+	uint64		segno = LOG_INDEX_FILE_TABLE_SEGMENT_NO(tid);
+	log_idx_table_id_t first_tid = segno * LOG_INDEX_TABLE_NUM_PER_FILE + 1;
+	int			idx = tid - first_tid;
+	log_idx_table_packed_t hdr;
+	bool		from_cache;
+	off_t		off;
+	int			i;
+	int			bytes;
+	Size		record_size;
+
+	if (table_offsets.segno != segno || strcmp(table_offsets.dir, logindex_snapshot->dir) != 0)
+	{
+		strlcpy(table_offsets.dir, logindex_snapshot->dir, NAMEDATALEN);
+		table_offsets.segno = segno;
+		table_offsets.num = 0;
+	}
+
+retry:
+	from_cache = (table_offsets.num > 0);
+	i = Min(idx, table_offsets.num - 1);
+	i = Max(i, 0);
+	off = from_cache ? table_offsets.offset[i] : 0;
+
+	while (true)
+	{
+		bytes = FileRead(fd, (char *) &hdr, LOG_INDEX_TABLE_PACKED_HDR_SIZE, off,
+						 WAIT_EVENT_LOGINDEX_TBL_READ);
+
+		if (bytes != LOG_INDEX_TABLE_PACKED_HDR_SIZE)
+			record_size = 0;
+		else
+			record_size = log_index_table_record_size((char *) &hdr, first_tid + i);
+
+		if (record_size == 0)
+		{
+			/* The cached offsets may be stale, walk from the beginning */
+			if (from_cache)
+			{
+				table_offsets.num = 0;
+				goto retry;
+			}
+
+			logindex_errno = errno;
+			return false;
+		}
+
+		if (i == table_offsets.num)
+		{
+			table_offsets.offset[i] = off;
+			table_offsets.num++;
+		}
+
+		if (i == idx)
+			break;
+
+		off += record_size;
+		i++;
+	}
+
+	*offset = off;
+	*size = record_size;
+
+	return true;
+}
+
+/*
+ * Get the offset to save table tid, which is the end of the previous table
+ * in the same segment file.
+ */
+static off_t
+log_index_table_save_offset(log_index_snapshot_t * logindex_snapshot, File fd, log_idx_table_id_t tid)
+{
+	off_t		offset;
+	Size		size;
+
+	if (LOG_INDEX_FILE_TABLE_SEGMENT_OFFSET(tid) == 0)
+		return 0;
+
+	if (!log_index_locate_table(logindex_snapshot, fd, tid - 1, &offset, &size))
+		return -1;
+
+	return offset + size;
+}
+
 static bool
 log_index_save_table(log_index_snapshot_t * logindex_snapshot, log_idx_table_data_t * table, File fd, log_file_table_bloom_t * bloom)
 {
 	int			ret = -1;
 	uint64		segno = LOG_INDEX_FILE_TABLE_SEGMENT_NO(table->idx_table_id);
-	off_t		offset = LOG_INDEX_FILE_TABLE_SEGMENT_OFFSET(table->idx_table_id);
+	off_t		offset;
 	char		path[MAXPGPATH];
+	char	   *record = (char *) table;
+	Size		size = sizeof(log_idx_table_data_t);
+	log_idx_table_packed_t *packed = NULL;
 
 	table->min_lsn = bloom->min_lsn;
 	table->max_lsn = bloom->max_lsn;
@@ -1246,9 +1507,40 @@ log_index_save_table(log_index_snapshot_t * logindex_snapshot, log_idx_table_dat
 	table->crc = 0;
 	table->crc = log_index_calc_crc((unsigned char *) table, sizeof(log_idx_table_data_t));
 
-	ret = FileWrite(fd, (char *) table, sizeof(*table), offset, WAIT_EVENT_LOGINDEX_TBL_WRITE);
+	offset = log_index_table_save_offset(logindex_snapshot, fd, table->idx_table_id);
+
+	if (offset < 0)
+	{
+		logindex_io_err = LOG_INDEX_READ_FAILED;
+
+		LOG_INDEX_FILE_TABLE_NAME(path, segno);
+		ereport(LOG,
+				(errmsg("Could not locate table %ld in file \"%s\", errno %d",
+						table->idx_table_id - 1, path, logindex_errno)));
+		return false;
+	}
+
+	/* Save the raw table if it can't be packed smaller */
+	if (polar_logindex_table_compression != LOG_INDEX_TABLE_COMPRESSION_NONE)
+	{
+		Size		packed_size;
+
+		packed = palloc(sizeof(log_idx_table_data_t));
+		packed_size = log_index_pack_table(table, polar_logindex_table_compression, packed);
+
+		if (packed_size > 0)
+		{
+			record = (char *) packed;
+			size = packed_size;
+		}
+	}
+
+	ret = FileWrite(fd, record, size, offset, WAIT_EVENT_LOGINDEX_TBL_WRITE);
+
+	if (packed != NULL)
+		pfree(packed);
 
-	if (ret != sizeof(*table))
+	if (ret != size)
 	{
 		logindex_errno = errno;
 		logindex_io_err = LOG_INDEX_WRITE_FAILED;
@@ -1349,14 +1641,17 @@ log_index_open_table_file(log_index_snapshot_t * logindex_snapshot, log_idx_tabl
 	return fd;
 }
 
-bool
-log_index_read_table_data(log_index_snapshot_t * logindex_snapshot, log_idx_table_data_t * table, log_idx_table_id_t tid, int elevel)
+/*
+ * Read the record of table tid from its segment file.  Raw record is read
+ * into table directly, packed record is read into a palloc'd *record.
+ */
+static bool
+log_index_read_table_record_data(log_index_snapshot_t * logindex_snapshot, log_idx_table_data_t * table,
+								 log_idx_table_id_t tid, char **record, off_t *offset, Size *size, int elevel)
 {
 	File		fd;
-	pg_crc32	crc;
 	int			bytes;
 	uint64		segno = LOG_INDEX_FILE_TABLE_SEGMENT_NO(tid);
-	off_t		offset = LOG_INDEX_FILE_TABLE_SEGMENT_OFFSET(tid);
 	static char path[MAXPGPATH];
 
 	fd = log_index_open_table_file(logindex_snapshot, tid, true, elevel);
@@ -1364,22 +1659,78 @@ log_index_read_table_data(log_index_snapshot_t * logindex_snapshot, log_idx_tabl
 	if (fd < 0)
 		return false;
 
-	bytes = FileRead(fd, (char *) table, sizeof(log_idx_table_data_t), offset, WAIT_EVENT_LOGINDEX_TBL_READ);
+	if (!log_index_locate_table(logindex_snapshot, fd, tid, offset, size))
+	{
+		logindex_io_err = LOG_INDEX_READ_FAILED;
+		FileClose(fd);
+
+		LOG_INDEX_FILE_TABLE_NAME(path, segno);
+		ereport(elevel,
+				(errmsg("Could not locate table %ld in file \"%s\", errno %d",
+						tid, path, logindex_errno)));
+		return false;
+	}
+
+	/* Packed record is always smaller than the raw table */
+	if (*size == sizeof(log_idx_table_data_t))
+		*record = (char *) table;
+	else
+		*record = palloc(*size);
+
+	bytes = FileRead(fd, *record, *size, *offset, WAIT_EVENT_LOGINDEX_TBL_READ);
 
-	if (bytes != sizeof(log_idx_table_data_t))
+	if (bytes != *size)
 	{
 		logindex_io_err = LOG_INDEX_READ_FAILED;
 		logindex_errno = errno;
 		FileClose(fd);
 
+		if (*record != (char *) table)
+			pfree(*record);
+
 		LOG_INDEX_FILE_TABLE_NAME(path, segno);
 		ereport(elevel,
 				(errmsg("Could not read whole table from file \"%s\" at offset %lu, read size %d, errno %d",
-						path, offset, bytes, logindex_errno)));
+						path, *offset, bytes, logindex_errno)));
 		return false;
 	}
 
 	FileClose(fd);
+
+	return true;
+}
+
+/*
+ * Unpack the record read by log_index_read_table_record_data into table if
+ * it's packed, and check the crc of table.  The record is freed here.
+ */
+static bool
+log_index_check_table_record_data(log_index_snapshot_t * logindex_snapshot, log_idx_table_data_t * table,
+								  log_idx_table_id_t tid, char *record, off_t offset, Size size, int elevel)
+{
+	pg_crc32	crc;
+	uint64		segno = LOG_INDEX_FILE_TABLE_SEGMENT_NO(tid);
+	static char path[MAXPGPATH];
+
+	if (record != (char *) table)
+	{
+		bool		unpacked = log_index_unpack_table((log_idx_table_packed_t *) record, table);
+
+		pfree(record);
+
+		if (!unpacked)
+		{
+			logindex_io_err = LOG_INDEX_CRC_FAILED;
+			table_offsets.num = 0;
+
+			LOG_INDEX_FILE_TABLE_NAME(path, segno);
+			ereport(elevel,
+					(errmsg("Could not unpack table %ld from file \"%s\" at offset %lu, size %lu",
+							tid, path, offset, size)));
+			return false;
+		}
+	}
+
 	crc = table->crc;
 	table->crc = 0;
 	table->crc = log_index_calc_crc((unsigned char *) table, sizeof(log_idx_table_data_t));
@@ -1387,6 +1738,7 @@ log_index_read_table_data(log_index_snapshot_t * logindex_snapshot, log_idx_tabl
 	if (crc != table->crc)
 	{
 		logindex_io_err = LOG_INDEX_CRC_FAILED;
+		table_offsets.num = 0;
 
 		LOG_INDEX_FILE_TABLE_NAME(path, segno);
 		ereport(elevel,
@@ -1395,9 +1747,34 @@ log_index_read_table_data(log_index_snapshot_t * logindex_snapshot, log_idx_tabl
 		return false;
 	}
 
+	if (!LOG_INDEX_TBL_GEOMETRY_VALID(table))
+	{
+		logindex_io_err = LOG_INDEX_CRC_FAILED;
+		table_offsets.num = 0;
+
+		LOG_INDEX_FILE_TABLE_NAME(path, segno);
+		ereport(elevel,
+				(errmsg("Invalid geometry of table %ld in file \"%s\" at offset %lu, segs %u, hash %u, last_order %u",
+						tid, path, offset, table->seg_num, table->hash_num, table->last_order)));
+		return false;
+	}
+
 	return true;
 }
 
+bool
+log_index_read_table_data(log_index_snapshot_t * logindex_snapshot, log_idx_table_data_t * table, log_idx_table_id_t tid, int elevel)
+{
+	char	   *record;
+	off_t		offset;
+	Size		size;
+
+	if (!log_index_read_table_record_data(logindex_snapshot, table, tid, &record, &offset, &size, elevel))
+		return false;
+
+	return log_index_check_table_record_data(logindex_snapshot, table, tid, record, offset, size, elevel);
+}
+
 static bool
 log_index_write_table_data(log_index_snapshot_t * logindex_snapshot, log_mem_table_t * table)
 {
@@ -1516,38 +1893,153 @@ log_index_report_io_error(log_index_snapshot_t * logindex_snapshot, log_idx_tabl
 	}
 }
 
+/*
+ * Unpack the tables read from segment file to their slots in cache, the
+ * first bytes of cache->data are read from the file.  Return the number of
+ * tables in the segment file.
+ */
+static int
+log_index_unpack_seg_tables(log_table_cache_t * cache, int bytes, log_idx_table_id_t max_tid)
+{
+	static Size record_offset[LOG_INDEX_TABLE_NUM_PER_FILE];
+	log_idx_table_id_t tid = cache->min_idx_table_id;
+	Size		offset = 0;
+	Size		record_size;
+	char	   *records;
+	int			n = 0;
+	int			i;
+
+	/*
+	 * Find out the tables saved in order.  If this segment file is renamed
+	 * from previous segment file, maybe there're old tables in the end of
+	 * the file, and they don't follow the order of table id.
+	 */
+	while (n < LOG_INDEX_TABLE_NUM_PER_FILE && tid <= max_tid &&
+		   offset + LOG_INDEX_TABLE_PACKED_HDR_SIZE <= bytes)
+	{
+		record_size = log_index_table_record_size(cache->data + offset, tid);
+
+		if (record_size == 0 || offset + record_size > bytes)
+			break;
+
+		record_offset[n++] = offset;
+		offset += record_size;
+		tid++;
+	}
+
+	/* All raw tables, they are already in their slots */
+	if (offset == n * sizeof(log_idx_table_data_t))
+		return n;
+
+	/*
+	 * Move the records to the end of cache, then unpack them from the first
+	 * one.  Every record is not larger than the raw table, so the slot to
+	 * unpack never overwrites the records not unpacked yet.
+	 */
+	records = cache->data + LOG_INDEX_TABLE_CACHE_SIZE - offset;
+	memmove(records, cache->data, offset);
+
+	for (i = 0; i < n; i++)
+	{
+		log_idx_table_data_t *table = (log_idx_table_data_t *) (cache->data + sizeof(log_idx_table_data_t) * i);
+		char	   *record = records + record_offset[i];
+
+		if (!LOG_INDEX_TABLE_IS_PACKED(record))
+			memmove(table, record, sizeof(log_idx_table_data_t));
+		else if (!log_index_unpack_table((log_idx_table_packed_t *) record, table))
+		{
+			elog(WARNING, "Failed to unpack logindex table, tid=%ld",
+				 cache->min_idx_table_id + i);
+			return i;
+		}
+	}
+
+	return n;
+}
+
+/*
+ * Read the tables of a full segment file from local cache one by one, the
+ * size of the file is unknown.  Return the number of tables read.
+ */
+static int
+log_index_read_cached_seg_tables(log_index_snapshot_t * logindex_snapshot, log_table_cache_t * cache,
+								 uint64 segno, log_idx_table_id_t max_tid)
+{
+	polar_cache_io_error io_error;
+	log_idx_table_id_t tid = cache->min_idx_table_id;
+	log_idx_table_packed_t hdr;
+	/* Read packed record to the last slot, it's always unpacked to itself */
+	char	   *packed = cache->data + LOG_INDEX_TABLE_CACHE_SIZE - sizeof(log_idx_table_data_t);
+	uint32		offset = 0;
+	Size		record_size;
+	bool		io_failed = false;
+	int			n;
+
+	for (n = 0; n < LOG_INDEX_TABLE_NUM_PER_FILE && tid <= max_tid; n++, tid++)
+	{
+		char	   *table = cache->data + sizeof(log_idx_table_data_t) * n;
+
+		if (!polar_local_cache_read(logindex_snapshot->segment_cache, segno, offset,
+									(char *) &hdr, LOG_INDEX_TABLE_PACKED_HDR_SIZE, &io_error))
+		{
+			io_failed = true;
+			break;
+		}
+
+		record_size = log_index_table_record_size((char *) &hdr, tid);
+
+		if (record_size == 0)
+			break;
+
+		if (!polar_local_cache_read(logindex_snapshot->segment_cache, segno, offset,
+									LOG_INDEX_TABLE_IS_PACKED(&hdr) ? packed : table,
+									record_size, &io_error))
+		{
+			io_failed = true;
+			break;
+		}
+
+		if (LOG_INDEX_TABLE_IS_PACKED(&hdr) &&
+			!log_index_unpack_table((log_idx_table_packed_t *) packed, (log_idx_table_data_t *) table))
+		{
+			elog(WARNING, "Failed to unpack logindex table, tid=%ld", tid);
+			return n;
+		}
+
+		offset += record_size;
+	}
+
+	if (n == 0 && io_failed)
+	{
+		logindex_io_err = LOG_INDEX_READ_FAILED;
+		logindex_errno = io_error.save_errno;
+		polar_local_cache_report_error(logindex_snapshot->segment_cache, &io_error, LOG);
+	}
+
+	return n;
+}
+
 static bool
 log_index_read_seg_file(log_index_snapshot_t * logindex_snapshot, log_table_cache_t * cache, uint64 segno)
 {
 	int			bytes;
-	int			i;
+	int			n;
 	log_index_meta_t meta;
 	uint64_t	delta_table;
 
-	log_idx_table_data_t *table_data;
-
 	LOG_INDEX_COPY_META(&meta);
 	cache->min_idx_table_id = LOG_INDEX_TABLE_INVALID_ID;
 	cache->max_idx_table_id = LOG_INDEX_TABLE_INVALID_ID;
 
+	/* segno start from 0, while log_index_table_id_t start from 1 */
+	cache->min_idx_table_id = segno * LOG_INDEX_TABLE_NUM_PER_FILE + 1;
+
 	delta_table = (meta.max_idx_table_id >= (segno * LOG_INDEX_TABLE_NUM_PER_FILE)) ?
 		meta.max_idx_table_id - (segno * LOG_INDEX_TABLE_NUM_PER_FILE) : 0;
 
 	if (logindex_snapshot->segment_cache && delta_table >= LOG_INDEX_TABLE_NUM_PER_FILE)
 	{
-		polar_cache_io_error io_error;
-
-		if (!polar_local_cache_read(
-									logindex_snapshot->segment_cache, segno, 0,
-									cache->data, LOG_INDEX_TABLE_CACHE_SIZE, &io_error))
-		{
-			logindex_io_err = LOG_INDEX_READ_FAILED;
-			logindex_errno = io_error.save_errno;
-			polar_local_cache_report_error(logindex_snapshot->segment_cache, &io_error, LOG);
-			return false;
-		}
-
-		bytes = LOG_INDEX_TABLE_CACHE_SIZE;
+		n = log_index_read_cached_seg_tables(logindex_snapshot, cache, segno, meta.max_idx_table_id);
 	}
 	else
 	{
@@ -1561,6 +2053,7 @@ log_index_read_seg_file(log_index_snapshot_t * logindex_snapshot, log_table_cach
 		{
 			logindex_io_err = LOG_INDEX_OPEN_FAILED;
 			logindex_errno = errno;
+			cache->min_idx_table_id = LOG_INDEX_TABLE_INVALID_ID;
 
 			ereport(LOG, (errmsg("Could not open file \"%s\", errno %d", path, logindex_errno)));
 			return false;
@@ -1568,11 +2061,12 @@ log_index_read_seg_file(log_index_snapshot_t * logindex_snapshot, log_table_cach
 
 		bytes = FileRead(fd, cache->data, LOG_INDEX_TABLE_CACHE_SIZE, 0x0, WAIT_EVENT_LOGINDEX_TBL_READ);
 
-		if (bytes < sizeof(log_idx_table_data_t))
+		if (bytes < (int) LOG_INDEX_TABLE_PACKED_HDR_SIZE)
 		{
 			logindex_io_err = LOG_INDEX_READ_FAILED;
 			logindex_errno = errno;
 			FileClose(fd);
+			cache->min_idx_table_id = LOG_INDEX_TABLE_INVALID_ID;
 
 			ereport(LOG, (errmsg("Could not read whole table from file \"%s\" at offset 0, read size %d, errno %d",
 								 path, bytes, logindex_errno)));
@@ -1580,40 +2074,19 @@ log_index_read_seg_file(log_index_snapshot_t * logindex_snapshot, log_table_cach
 		}
 
 		FileClose(fd);
-	}
 
-	/* segno start from 0, while log_index_table_id_t start from 1 */
-	cache->min_idx_table_id = segno * LOG_INDEX_TABLE_NUM_PER_FILE + 1;
-	table_data = (log_idx_table_data_t *) cache->data;
+		n = log_index_unpack_seg_tables(cache, bytes, meta.max_idx_table_id);
+	}
 
-	if (table_data->idx_table_id != cache->min_idx_table_id || cache->min_idx_table_id > meta.max_idx_table_id)
+	if (n == 0)
 	{
-		elog(WARNING, "Read unexpected logindex segment=%ld file, min_id=%ld, max_id=%ld, tid=%ld",
-			 segno, cache->min_idx_table_id, meta.max_idx_table_id, table_data->idx_table_id);
+		elog(WARNING, "Read unexpected logindex segment=%ld file, min_id=%ld, max_id=%ld",
+			 segno, cache->min_idx_table_id, meta.max_idx_table_id);
 		cache->min_idx_table_id = LOG_INDEX_TABLE_INVALID_ID;
 		return false;
 	}
 
-	i = (bytes / sizeof(log_idx_table_data_t)) - 1;
-
-	/*
-	 * If this segment file is renamed from previous segment file, maybe
-	 * there're old tables in the end of the file. So we have to compare to
-	 * get max table id, and compare with meta to check it's already full
-	 * flushed to the storage.
-	 */
-	while (i >= 0)
-	{
-		table_data = (log_idx_table_data_t *) (cache->data + sizeof(log_idx_table_data_t) * i);
-
-		if (table_data->idx_table_id >= cache->min_idx_table_id && table_data->idx_table_id <= meta.max_idx_table_id)
-		{
-			cache->max_idx_table_id = table_data->idx_table_id;
-			break;
-		}
-
-		i--;
-	}
+	cache->max_idx_table_id = cache->min_idx_table_id + n - 1;
 
 	return true;
 }
@@ -1904,6 +2377,7 @@ polar_logindex_truncate(log_index_snapshot_t * logindex_snapshot, XLogRecPtr lsn
 		MemoryContext oldcontext = MemoryContextSwitchTo(polar_logindex_memory_context());
 
 		log_index_truncate(logindex_snapshot, lsn);
+		log_index_bump_generation(logindex_snapshot);
 
 		MemoryContextSwitchTo(oldcontext);
 
@@ -1968,7 +2442,13 @@ log_index_insert_lsn(log_index_snapshot_t * logindex_snapshot, log_index_lsn_t *
 
 	new_item = (head == LOG_INDEX_TBL_INVALID_SEG);
 
-	if (!new_item && !log_index_mem_seg_full(active, head))
+	/*
+	 * Appending lsn to the tail segment needs no new segment, but it needs a
+	 * free order.  If the table runs out of orders, it's full and the lsn is
+	 * inserted to the next table.
+	 */
+	if (!new_item && !log_index_mem_seg_full(active, head) &&
+		active->data.last_order < LOG_INDEX_TBL_ORDER_NUM(&active->data))
 	{
 		uint8		idx;
 		log_item_head_t *item;
@@ -2087,7 +2567,7 @@ polar_logindex_add_lsn(log_index_snapshot_t * logindex_snapshot, BufferTag *tag,
 							 lsn,
 							 active->data.idx_table_id,
 							 last_order,
-							 active->data.idx_order[last_order - 1],
+							 LOG_INDEX_TBL_ORDER(&active->data)[last_order - 1],
 							 active->free_head,
 							 pg_atomic_read_u32(&active->state),
 							 POLAR_LOG_BUFFER_TAG(tag)),
@@ -2119,6 +2599,368 @@ polar_get_logindex_snapshot_max_lsn(log_index_snapshot_t * logindex_snapshot)
 	return max_lsn;
 }
 
+/*
+ * POLAR: Rebuild the bloom page of the tables from first_tid, which are all
+ * loaded to memory tables, and put it into bloom cache.  Blooms are saved
+ * before their tables, so the rebuilt page is the same as the one in storage
+ * and we don't have to read it later.
+ */
+static void
+log_index_rebuild_bloom_page(log_index_snapshot_t * logindex_snapshot, log_idx_table_id_t first_tid)
+{
+	SlruShared	shared = logindex_snapshot->bloom_ctl.shared;
+	char	   *page = palloc0(BLCKSZ);
+	int			latest_page_number;
+	int			slot;
+	int			i;
+
+	for (i = 0; i < LOG_INDEX_BLOOM_NUM_PER_BLOCK; i++)
+	{
+		log_idx_table_id_t tid = first_tid + i;
+		log_mem_table_t *mem_tbl = LOG_INDEX_MEM_TBL((tid - 1) % logindex_snapshot->mem_tbl_size);
+
+		log_index_get_bloom_data(&mem_tbl->data, tid, LOG_INDEX_MEM_TBL_STATE(mem_tbl),
+								 (log_file_table_bloom_t *) (page + LOG_INDEX_TBL_BLOOM_PAGE_OFFSET(tid)));
+	}
+
+	LWLockAcquire(LOG_INDEX_BLOOM_LRU_LOCK, LW_EXCLUSIVE);
+
+	/* We are not extending the bloom file, keep its latest page */
+	latest_page_number = shared->latest_page_number;
+	slot = SimpleLruZeroPage(&logindex_snapshot->bloom_ctl, LOG_INDEX_TBL_BLOOM_PAGE_NO(first_tid));
+	shared->latest_page_number = latest_page_number;
+
+	memcpy(shared->page_buffer[slot], page, BLCKSZ);
+	shared->page_dirty[slot] = false;
+
+	LWLockRelease(LOG_INDEX_BLOOM_LRU_LOCK);
+
+	pfree(page);
+}
+
+static void
+log_index_init_load_unit(log_index_load_unit_t * unit, log_idx_table_id_t min_tid, log_idx_table_id_t max_tid,
+						 XLogRecPtr start_lsn, bool rebuild_bloom)
+{
+	log_idx_table_id_t first_tid = LOG_INDEX_TBL_BLOOM_PAGE_FIRST_TID(max_tid);
+
+	MemSet(unit, 0, sizeof(log_index_load_unit_t));
+	unit->min_tid = Max(first_tid, min_tid);
+	unit->max_tid = max_tid;
+	unit->start_lsn = start_lsn;
+
+	/* Tables after max_tid are not flushed, so their blooms are not saved */
+	unit->rebuild_bloom = rebuild_bloom && unit->min_tid == first_tid &&
+		max_tid - first_tid + 1 == LOG_INDEX_BLOOM_NUM_PER_BLOCK;
+}
+
+/*
+ * POLAR: Load tables of unit from storage to memory tables from big to small,
+ * until the table which has unit->start_lsn.  Different units never share
+ * memory tables, so units can be loaded by different processes at the same
+ * time.
+ */
+static void
+log_index_load_unit(log_index_snapshot_t * logindex_snapshot, log_index_load_unit_t * unit)
+{
+	log_idx_table_id_t tid;
+	instr_time	start,
+				duration;
+
+	for (tid = unit->max_tid; tid >= unit->min_tid; tid--)
+	{
+		log_mem_table_t *mem_tbl = LOG_INDEX_MEM_TBL((tid - 1) % logindex_snapshot->mem_tbl_size);
+		char	   *record;
+		off_t		offset;
+		Size		size;
+		bool		valid;
+
+		/* POLAR: mark current memory table FLUSHED */
+		LWLockAcquire(LOG_INDEX_MEM_TBL_LOCK(mem_tbl), LW_EXCLUSIVE);
+
+		INSTR_TIME_SET_CURRENT(start);
+		valid = log_index_read_table_record_data(logindex_snapshot, &mem_tbl->data, tid,
+												 &record, &offset, &size, LOG);
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+		unit->read_us += INSTR_TIME_GET_MICROSEC(duration);
+
+		if (valid)
+		{
+			INSTR_TIME_SET_CURRENT(start);
+			valid = log_index_check_table_record_data(logindex_snapshot, &mem_tbl->data, tid,
+													  record, offset, size, LOG);
+			INSTR_TIME_SET_CURRENT(duration);
+			INSTR_TIME_SUBTRACT(duration, start);
+			unit->validate_us += INSTR_TIME_GET_MICROSEC(duration);
+		}
+
+		if (!valid)
+		{
+			LWLockRelease(LOG_INDEX_MEM_TBL_LOCK(mem_tbl));
+			unit->failed_tid = tid;
+			return;
+		}
+
+		LOG_INDEX_MEM_TBL_SET_STATE(mem_tbl, LOG_INDEX_MEM_TBL_STATE_FLUSHED);
+		LOG_INDEX_MEM_TBL_FREE_HEAD(mem_tbl) = mem_tbl->data.seg_num;
+		LWLockRelease(LOG_INDEX_MEM_TBL_LOCK(mem_tbl));
+
+		POLAR_ASSERT_PANIC(mem_tbl->data.idx_table_id == tid);
+		unit->tables++;
+
+		if (!XLogRecPtrIsInvalid(unit->start_lsn) &&
+			unit->start_lsn >= mem_tbl->data.min_lsn)
+		{
+			unit->stop_tid = tid;
+			break;
+		}
+	}
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	/* Bloom page can be rebuilt only if all of its tables are loaded */
+	if (unit->rebuild_bloom && (unit->stop_tid == LOG_INDEX_TABLE_INVALID_ID ||
+								unit->stop_tid == unit->min_tid))
+		log_index_rebuild_bloom_page(logindex_snapshot, unit->min_tid);
+	else
+		polar_logindex_invalid_bloom_cache(logindex_snapshot, unit->max_tid);
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	unit->bloom_us += INSTR_TIME_GET_MICROSEC(duration);
+}
+
+static void
+log_index_load_unit_finished(log_index_load_state_t * state, log_index_load_unit_t * unit)
+{
+	if (unit->failed_tid != LOG_INDEX_TABLE_INVALID_ID)
+	{
+		POLAR_LOG_LOGINDEX_META_INFO(&state->logindex_snapshot->meta);
+		ereport(PANIC,
+				(errmsg("Failed to read log index which tid=%ld when load logindex", unit->failed_tid)));
+	}
+
+	state->stop_tid = Max(state->stop_tid, unit->stop_tid);
+	state->stat.tables += unit->tables;
+	state->stat.read_us += unit->read_us;
+	state->stat.validate_us += unit->validate_us;
+	state->stat.bloom_us += unit->bloom_us;
+}
+
+static bool
+log_index_load_task_handler(polar_task_sched_t *sched, polar_task_node_t *task)
+{
+	log_index_load_task_node_t *node = (log_index_load_task_node_t *) task;
+
+	log_index_load_unit(node->logindex_snapshot, &node->unit);
+
+	return true;
+}
+
+static void *
+log_index_load_task_tag(polar_task_node_t *task)
+{
+	return &((log_index_load_task_node_t *) task)->unit.max_tid;
+}
+
+static void
+log_index_load_task_finished(polar_task_node_t *task, void *arg)
+{
+	log_index_load_unit_finished((log_index_load_state_t *) arg,
+								 &((log_index_load_task_node_t *) task)->unit);
+}
+
+Size
+polar_logindex_load_sched_shmem_size(int workers)
+{
+	return polar_calc_task_sched_shmem_size(workers, sizeof(log_index_load_task_node_t),
+											LOG_INDEX_LOAD_TASK_QUEUE_DEPTH);
+}
+
+polar_task_sched_t *
+polar_logindex_create_load_sched(const char *sched_name, int workers)
+{
+	return polar_create_proc_task_sched(sched_name, workers, sizeof(log_index_load_task_node_t),
+										LOG_INDEX_LOAD_TASK_QUEUE_DEPTH, NULL);
+}
+
+void
+polar_logindex_set_load_sched(logindex_snapshot_t logindex_snapshot, polar_task_sched_t *sched)
+{
+	logindex_snapshot->load_sched = sched;
+}
+
+void
+polar_logindex_get_load_stat(logindex_snapshot_t logindex_snapshot, polar_logindex_load_stat_t * stat)
+{
+	SpinLockAcquire(LOG_INDEX_SNAPSHOT_LOCK);
+	*stat = logindex_snapshot->load_stat;
+	SpinLockRelease(LOG_INDEX_SNAPSHOT_LOCK);
+}
+
+/*
+ * POLAR: Find the table which has start_lsn from the saved blooms, so tables
+ * below it are not dispatched to the load workers, as loading them one by
+ * one stops there.  Bloom's min_lsn is not less than the table's, so the
+ * table found is never below the one which has start_lsn.  Returns min_tid if
+ * it's not found.
+ */
+static log_idx_table_id_t
+log_index_load_min_tid(log_index_snapshot_t * logindex_snapshot, log_idx_table_id_t min_tid,
+					   log_idx_table_id_t max_tid, XLogRecPtr start_lsn)
+{
+	log_idx_table_id_t tid;
+
+	if (XLogRecPtrIsInvalid(start_lsn))
+		return min_tid;
+
+	for (tid = max_tid; tid > min_tid; tid--)
+	{
+		log_file_table_bloom_t *bloom;
+		log_idx_table_id_t bloom_tid;
+		XLogRecPtr	bloom_min_lsn;
+
+		/* We will acquire LOG_INDEX_BLOOM_LRU_LOCK in log_index_get_tbl_bloom */
+		bloom = log_index_get_tbl_bloom(logindex_snapshot, tid);
+		bloom_tid = bloom->idx_table_id;
+		bloom_min_lsn = bloom->min_lsn;
+		LWLockRelease(LOG_INDEX_BLOOM_LRU_LOCK);
+
+		if (bloom_tid != tid)
+			return min_tid;
+
+		if (start_lsn >= bloom_min_lsn)
+			return tid;
+	}
+
+	return min_tid;
+}
+
+/*
+ * POLAR: Load tables from max_tid to min_tid by the load workers.  Tables are
+ * dispatched from big to small, and we stop dispatching at the table which
+ * has start_lsn, or once a worker finds it.
+ */
+static void
+log_index_load_tables_parallel(log_index_snapshot_t * logindex_snapshot, log_idx_table_id_t min_tid,
+							   log_idx_table_id_t max_tid, XLogRecPtr start_lsn, log_index_load_state_t * state)
+{
+	polar_task_sched_t *sched = logindex_snapshot->load_sched;
+	polar_task_sched_ctl_t *ctl;
+	log_index_load_task_node_t node;
+	log_idx_table_id_t tid = max_tid;
+
+	polar_sched_reg_handler(sched, NULL, log_index_load_task_handler, NULL, log_index_load_task_tag);
+	ctl = polar_create_task_sched_ctl(sched, sizeof(log_idx_table_id_t), NULL, NULL);
+	polar_sched_ctl_reg_handler(ctl, log_index_load_task_finished, state);
+	polar_start_proc_pool(ctl);
+
+	min_tid = log_index_load_min_tid(logindex_snapshot, min_tid, max_tid, start_lsn);
+
+	MemSet(&node, 0, sizeof(log_index_load_task_node_t));
+	node.logindex_snapshot = logindex_snapshot;
+
+	while (true)
+	{
+		while (tid >= min_tid && state->stop_tid == LOG_INDEX_TABLE_INVALID_ID)
+		{
+			log_index_init_load_unit(&node.unit, min_tid, tid, start_lsn, true);
+
+			/* The task queues are full, wait for the workers */
+			if (polar_sched_add_task(ctl, &node.task) == NULL)
+				break;
+
+			state->min_dispatched_tid = node.unit.min_tid;
+			tid = node.unit.min_tid - 1;
+		}
+
+		if (!polar_sched_empty_running_task(ctl))
+			polar_sched_remove_finished_task(ctl);
+
+		if ((tid < min_tid || state->stop_tid != LOG_INDEX_TABLE_INVALID_ID) &&
+			polar_sched_empty_running_task(ctl))
+			break;
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 10, WAIT_EVENT_LOGINDEX_WAIT_LOAD);
+		ResetLatch(MyLatch);
+		HandleStartupProcInterrupts();
+	}
+
+	polar_release_task_sched_ctl(ctl);
+
+	/*
+	 * Tables after the one which has start_lsn may be loaded by the workers,
+	 * drop them to keep the same memory tables as loading them one by one.
+	 */
+	for (tid = state->min_dispatched_tid; tid < state->stop_tid; tid++)
+	{
+		log_mem_table_t *mem_tbl = LOG_INDEX_MEM_TBL((tid - 1) % logindex_snapshot->mem_tbl_size);
+
+		LWLockAcquire(LOG_INDEX_MEM_TBL_LOCK(mem_tbl), LW_EXCLUSIVE);
+		MemSet(mem_tbl, 0, sizeof(log_mem_table_t));
+		LWLockRelease(LOG_INDEX_MEM_TBL_LOCK(mem_tbl));
+	}
+}
+
+/*
+ * POLAR: Load tables from max_tid to min_tid, from big to small, until the
+ * table which has start_lsn.  When the snapshot is being initialized by
+ * startup, the tables are loaded by the load workers if there're enough
+ * tables, and the bloom pages are rebuilt from the loaded tables.
+ */
+static void
+log_index_load_tables(log_index_snapshot_t * logindex_snapshot, log_idx_table_id_t min_tid,
+					  log_idx_table_id_t max_tid, XLogRecPtr start_lsn, bool initializing)
+{
+	log_index_load_state_t state;
+	log_index_load_unit_t unit;
+	log_idx_table_id_t tid;
+	instr_time	start,
+				duration;
+
+	MemSet(&state, 0, sizeof(log_index_load_state_t));
+	state.logindex_snapshot = logindex_snapshot;
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	if (initializing && logindex_snapshot->load_sched != NULL &&
+		IsUnderPostmaster && AmStartupProcess() &&
+		max_tid - min_tid + 1 > LOG_INDEX_BLOOM_NUM_PER_BLOCK)
+	{
+		state.stat.workers = logindex_snapshot->load_sched->total_proc;
+		log_index_load_tables_parallel(logindex_snapshot, min_tid, max_tid, start_lsn, &state);
+	}
+	else
+	{
+		for (tid = max_tid; tid >= min_tid && state.stop_tid == LOG_INDEX_TABLE_INVALID_ID;
+			 tid = unit.min_tid - 1)
+		{
+			log_index_init_load_unit(&unit, min_tid, tid, start_lsn, initializing);
+			log_index_load_unit(logindex_snapshot, &unit);
+			log_index_load_unit_finished(&state, &unit);
+		}
+	}
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	state.stat.total_us = INSTR_TIME_GET_MICROSEC(duration);
+
+	if (!initializing)
+		return;
+
+	SpinLockAcquire(LOG_INDEX_SNAPSHOT_LOCK);
+	logindex_snapshot->load_stat = state.stat;
+	SpinLockRelease(LOG_INDEX_SNAPSHOT_LOCK);
+
+	ereport(LOG,
+			(errmsg("Load " UINT64_FORMAT " tables of %s with %d workers in %.3f ms, read %.3f ms, validate %.3f ms, rebuild bloom %.3f ms",
+					state.stat.tables, logindex_snapshot->dir, state.stat.workers,
+					state.stat.total_us / 1000.0, state.stat.read_us / 1000.0,
+					state.stat.validate_us / 1000.0, state.stat.bloom_us / 1000.0)));
+}
+
 /*
  * POLAR: load flushed/active tables from storages
  */
@@ -2128,11 +2970,8 @@ polar_load_logindex_snapshot_from_storage(log_index_snapshot_t * logindex_snapsh
 	log_index_meta_t *meta = &logindex_snapshot->meta;
 	log_idx_table_id_t new_max_idx_table_id = LOG_INDEX_TABLE_INVALID_ID;
 	log_mem_table_t *active = LOG_INDEX_MEM_TBL_ACTIVE();
-	log_mem_table_t *mem_tbl = NULL;
 	static log_idx_table_data_t table;
-	int			mid = 0;
-	log_idx_table_id_t tid = 0,
-				min_tid = 0;
+	log_idx_table_id_t min_tid = 0;
 	uint32		state = pg_atomic_read_u32(&logindex_snapshot->state);
 
 	/*
@@ -2197,35 +3036,8 @@ polar_load_logindex_snapshot_from_storage(log_index_snapshot_t * logindex_snapsh
 	/* If we have more flushed tables to loaded */
 	if (new_max_idx_table_id >= min_tid)
 	{
-		/* tid from big to small */
-		tid = new_max_idx_table_id;
-
-		while (tid >= min_tid)
-		{
-			mid = (tid - 1) % logindex_snapshot->mem_tbl_size;
-			mem_tbl = LOG_INDEX_MEM_TBL(mid);
-
-			/* POLAR: mark current memory table FLUSHED */
-			LWLockAcquire(LOG_INDEX_MEM_TBL_LOCK(mem_tbl), LW_EXCLUSIVE);
-			if (!log_index_read_table_data(logindex_snapshot, &table, tid, LOG))
-			{
-				POLAR_LOG_LOGINDEX_META_INFO(meta);
-				ereport(PANIC,
-						(errmsg("Failed to read log index which tid=%ld when load logindex", tid)));
-			}
-			memcpy(&mem_tbl->data, &table, sizeof(log_idx_table_data_t));
-			LOG_INDEX_MEM_TBL_SET_STATE(mem_tbl, LOG_INDEX_MEM_TBL_STATE_FLUSHED);
-			LOG_INDEX_MEM_TBL_FREE_HEAD(mem_tbl) = LOG_INDEX_MEM_TBL_SEG_NUM;
-			polar_logindex_invalid_bloom_cache(logindex_snapshot, tid);
-			LWLockRelease(LOG_INDEX_MEM_TBL_LOCK(mem_tbl));
-
-			POLAR_ASSERT_PANIC(table.idx_table_id == tid);
-			tid--;
-
-			if (!XLogRecPtrIsInvalid(start_lsn) &&
-				start_lsn >= table.min_lsn)
-				break;
-		}
+		log_index_load_tables(logindex_snapshot, min_tid, new_max_idx_table_id, start_lsn,
+							  !(state & POLAR_LOGINDEX_STATE_INITIALIZED));
 
 		SpinLockAcquire(LOG_INDEX_SNAPSHOT_LOCK);
 		/* Switch to the old active table */
@@ -2386,6 +3198,7 @@ polar_logindex_online_promote(logindex_snapshot_t logindex_snapshot, bool missin
 
 	shared->polar_replica_promoting = true;
 	pg_atomic_fetch_or_u32(&logindex_snapshot->state, POLAR_LOGINDEX_STATE_WRITABLE);
+	log_index_bump_generation(logindex_snapshot);
 	LWLockRelease(LOG_INDEX_IO_LOCK);
 
 	/* Force to update logindex table which is inactive to be flushed */
@@ -219,6 +219,15 @@ log_index_page_iterate_push_lsn(log_index_page_iter_t iter,
 	else
 		size = seg->number;
 
+	/*
+	 * The lsn larger than iter_max_lsn are never pushed, so skip them at once
+	 * unless we still need to find iter_prev_lsn among them.
+	 */
+	if (*prev_correct)
+		size = log_index_table_lsn_count_le(table,
+											(head != NULL) ? head->suffix_lsn : seg->suffix_lsn,
+											size, iter->iter_max_lsn);
+
 	for (i = size; i > 0; i--)
 	{
 		idx = i - 1;
@@ -241,6 +250,10 @@ log_index_page_iterate_push_lsn(log_index_page_iter_t iter,
 				break;
 			}
 
+			/* The lsn are pushed from the newest one to the oldest one */
+			if (iter->newest_lsn == InvalidXLogRecPtr)
+				iter->newest_lsn = l;
+
 			stack_item = log_index_tbl_stack_next_item(stack, &stack_idx);
 			stack_item->prev_lsn = log_index_get_seg_prev_lsn(table, seg_id, idx);
 
@@ -570,8 +583,13 @@ log_index_check_bloom_not_exists(log_index_snapshot_t * logindex_snapshot, log_i
 		filter = polar_bloom_init_struct(bloom_data->bloom_bytes, bloom_data->buf_size,
 										 LOG_INDEX_BLOOM_ELEMS_NUM, 0);
 
-		not_exists = bloom_lacks_element(filter, (unsigned char *) &(iter->tag),
-										 sizeof(BufferTag));
+		/*
+		 * All bloom filters have the same shape, so the tag is hashed only
+		 * once for one page iterator
+		 */
+		polar_bloom_prepare_probe(filter, &iter->bloom_probe,
+								  (unsigned char *) &(iter->tag), sizeof(BufferTag));
+		not_exists = polar_bloom_probe_lacks_element(filter, &iter->bloom_probe);
 	}
 
 	pfree(bloom_data);
@@ -781,6 +799,7 @@ XLogRecPtr
 log_index_get_order_lsn(log_idx_table_data_t * table, uint32 order, log_index_lsn_t * lsn_info)
 {
 	log_seg_id_t seg_id;
+	uint16		idx_order;
 	uint8		idx;
 	log_item_seg_t *seg;
 	log_item_head_t *head;
@@ -799,8 +818,9 @@ log_index_get_order_lsn(log_idx_table_data_t * table, uint32 order, log_index_ls
 	/*
 	 * The valid order value start from 1 and the array index start from 0
 	 */
-	seg_id = LOG_INDEX_SEG_ORDER(table->idx_order[order]);
-	idx = LOG_INDEX_ID_ORDER(table->idx_order[order]);
+	idx_order = LOG_INDEX_TBL_ORDER(table)[order];
+	seg_id = LOG_INDEX_SEG_ORDER(idx_order);
+	idx = LOG_INDEX_ID_ORDER(idx_order);
 	seg = log_index_item_seg(table, seg_id);
 
 	POLAR_ASSERT_PANIC(seg != NULL);
@@ -1171,6 +1191,16 @@ polar_logindex_page_iterator_max_lsn(log_index_page_iter_t iter)
 	return iter->max_lsn;
 }
 
+/*
+ * Return the newest lsn found by this iterator, or InvalidXLogRecPtr if
+ * there's no lsn of this page in [min_lsn, max_lsn]
+ */
+XLogRecPtr
+polar_logindex_page_iterator_newest_lsn(log_index_page_iter_t iter)
+{
+	return iter->newest_lsn;
+}
+
 XLogRecPtr
 polar_logindex_page_iterator_min_lsn(log_index_page_iter_t iter)
 {
@@ -0,0 +1,729 @@
+/*-------------------------------------------------------------------------
+ *
+ * polar_logindex_packed.c
+ *	  Pack logindex table to the compact format saved to storage.
+ *
+ * The segments of a logindex table are fixed 48 bytes, and most of them
+ * repeat the same relation and lsn prefix.  The packed format saves the
+ * table as a stream of varints:
+ *
+ *	- number of segments and hash slots of the table is saved first.
+ *	- idx_order is saved as delta of the previous one.
+ *	- hash slots are saved as they are, most of them are small.
+ *	- RelFileNode of item heads are saved once in a dictionary, and each
+ *	  item head refers to its relation by the index in the dictionary.
+ *	- suffix lsn is saved as delta of the table min lsn for the first one,
+ *	  and delta of the previous one for the others.
+ *	- trailing unused segments are not saved.
+ *
+ * The stream may then be compressed by pglz, lz4 or zstd.
+ *
+ * This file is also built into polar_tools, so don't use elog or palloc.
+ *
+ * Copyright (c) 2024, Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/logindex/polar_logindex_packed.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "access/polar_logindex.h"
+#include "access/polar_logindex_internal.h"
+#include "common/hashfn.h"
+#include "common/pg_lzcompress.h"
+
+#define LOG_INDEX_PACKED_SEG_ZERO		0
+#define LOG_INDEX_PACKED_SEG_HEAD		1
+#define LOG_INDEX_PACKED_SEG_ITEM		2
+#define LOG_INDEX_PACKED_SEG_RAW		3
+#define LOG_INDEX_PACKED_SEG_UNKNOWN	0xFF
+
+#define LOG_INDEX_PACKED_DATA_SIZE \
+	(sizeof(log_idx_table_data_t) - LOG_INDEX_TABLE_PACKED_HDR_SIZE)
+/* Leave room for the worst case of pglz */
+#define LOG_INDEX_PACKED_STREAM_SIZE	(LOG_INDEX_PACKED_DATA_SIZE - 8)
+
+#define LOG_INDEX_PACKED_REL_HASH_SIZE	(LOG_INDEX_TBL_MAX_SEG_NUM * 2)
+
+#define LOG_INDEX_PACKED_ZSTD_LEVEL		1
+
+typedef struct log_index_pack_writer_t
+{
+	char	   *data;
+	uint32		len;
+	uint32		cap;
+	bool		overflow;
+}			log_index_pack_writer_t;
+
+typedef struct log_index_pack_reader_t
+{
+	const char *data;
+	uint32		len;
+	uint32		pos;
+	bool		error;
+}			log_index_pack_reader_t;
+
+/* The varint stream before compressed, or after decompressed */
+static char pack_stream[LOG_INDEX_PACKED_STREAM_SIZE];
+/* The table unpacked to verify the packed one */
+static log_idx_table_data_t pack_verify_table;
+static uint8 pack_seg_type[LOG_INDEX_TBL_MAX_SEG_NUM];
+static RelFileNode pack_rels[LOG_INDEX_TBL_MAX_SEG_NUM];
+static uint16 pack_rel_index[LOG_INDEX_TBL_MAX_SEG_NUM];
+static uint16 pack_rel_hash[LOG_INDEX_PACKED_REL_HASH_SIZE];
+static const log_tbl_seg_t pack_zero_seg;
+
+static inline uint64
+pack_zigzag(int64 v)
+{
+	return ((uint64) v << 1) ^ (uint64) (v >> 63);
+}
+
+static inline int64
+pack_unzigzag(uint64 v)
+{
+	return (int64) (v >> 1) ^ -(int64) (v & 1);
+}
+
+static inline void
+pack_put_byte(log_index_pack_writer_t * w, uint8 v)
+{
+	if (unlikely(w->len >= w->cap))
+	{
+		w->overflow = true;
+		return;
+	}
+
+	w->data[w->len++] = (char) v;
+}
+
+static void
+pack_put_varint(log_index_pack_writer_t * w, uint64 v)
+{
+	while (v >= 0x80)
+	{
+		pack_put_byte(w, (uint8) (v | 0x80));
+		v >>= 7;
+	}
+
+	pack_put_byte(w, (uint8) v);
+}
+
+static void
+pack_put_bytes(log_index_pack_writer_t * w, const void *v, uint32 size)
+{
+	if (unlikely(w->len + size > w->cap))
+	{
+		w->overflow = true;
+		return;
+	}
+
+	memcpy(w->data + w->len, v, size);
+	w->len += size;
+}
+
+static inline uint8
+pack_get_byte(log_index_pack_reader_t * r)
+{
+	if (unlikely(r->pos >= r->len))
+	{
+		r->error = true;
+		return 0;
+	}
+
+	return (uint8) r->data[r->pos++];
+}
+
+static uint64
+pack_get_varint(log_index_pack_reader_t * r)
+{
+	uint64		v = 0;
+	int			shift;
+
+	for (shift = 0; shift < 64; shift += 7)
+	{
+		uint8		b = pack_get_byte(r);
+
+		v |= (uint64) (b & 0x7F) << shift;
+
+		if ((b & 0x80) == 0)
+			return v;
+	}
+
+	r->error = true;
+	return 0;
+}
+
+static void
+pack_get_bytes(log_index_pack_reader_t * r, void *v, uint32 size)
+{
+	if (unlikely(r->pos + size > r->len))
+	{
+		r->error = true;
+		return;
+	}
+
+	memcpy(v, r->data + r->pos, size);
+	r->pos += size;
+}
+
+static void
+pack_put_suffix(log_index_pack_writer_t * w, uint32 base, const uint32 *suffix_lsn, int n)
+{
+	int			i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (i == 0)
+			pack_put_varint(w, pack_zigzag((int64) suffix_lsn[0] - (int64) base));
+		else
+			pack_put_varint(w, (uint32) (suffix_lsn[i] - suffix_lsn[i - 1]));
+	}
+}
+
+static void
+pack_get_suffix(log_index_pack_reader_t * r, uint32 base, uint32 *suffix_lsn, int n)
+{
+	int			i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (i == 0)
+			suffix_lsn[0] = (uint32) ((int64) base + pack_unzigzag(pack_get_varint(r)));
+		else
+			suffix_lsn[i] = suffix_lsn[i - 1] + (uint32) pack_get_varint(r);
+	}
+}
+
+/*
+ * Add the relation of an item head to the dictionary, return its index.
+ */
+static uint16
+pack_add_rel(const RelFileNode *rnode, int *nrels)
+{
+	uint32		h = hash_bytes((const unsigned char *) rnode, sizeof(RelFileNode)) %
+		LOG_INDEX_PACKED_REL_HASH_SIZE;
+
+	/* The hash table is twice the size of dictionary, it's never full */
+	while (pack_rel_hash[h] != 0)
+	{
+		uint16		idx = pack_rel_hash[h] - 1;
+
+		if (RelFileNodeEquals(pack_rels[idx], *rnode))
+			return idx;
+
+		h = (h + 1) % LOG_INDEX_PACKED_REL_HASH_SIZE;
+	}
+
+	pack_rels[*nrels] = *rnode;
+	pack_rel_hash[h] = ++(*nrels);
+
+	return *nrels - 1;
+}
+
+/*
+ * Find out which segments are item heads and which ones are item segments by
+ * walking the hash chains, build the relation dictionary at the same time.
+ */
+static int
+pack_classify_segments(log_idx_table_data_t * table, int nsegs)
+{
+	int			nrels = 0;
+	int			i;
+
+	memset(pack_seg_type, LOG_INDEX_PACKED_SEG_UNKNOWN, sizeof(pack_seg_type));
+	memset(pack_rel_hash, 0, sizeof(pack_rel_hash));
+
+	for (i = 0; i < table->hash_num; i++)
+	{
+		log_seg_id_t head = LOG_INDEX_TBL_SLOT_VALUE(table, i);
+
+		while (head != LOG_INDEX_TBL_INVALID_SEG && head <= nsegs &&
+			   pack_seg_type[head - 1] == LOG_INDEX_PACKED_SEG_UNKNOWN)
+		{
+			log_item_head_t *item = LOG_INDEX_ITEM_HEAD(table, head);
+			log_seg_id_t seg = item->next_seg;
+
+			pack_seg_type[head - 1] = LOG_INDEX_PACKED_SEG_HEAD;
+			pack_rel_index[head - 1] = pack_add_rel(&item->tag.rnode, &nrels);
+
+			while (seg != LOG_INDEX_TBL_INVALID_SEG && seg <= nsegs &&
+				   pack_seg_type[seg - 1] == LOG_INDEX_PACKED_SEG_UNKNOWN)
+			{
+				pack_seg_type[seg - 1] = LOG_INDEX_PACKED_SEG_ITEM;
+				seg = LOG_INDEX_ITEM_SEG(table, seg)->next_seg;
+			}
+
+			head = item->next_item;
+		}
+	}
+
+	/* Save the segments which are not linked as they are */
+	for (i = 0; i < nsegs; i++)
+	{
+		if (pack_seg_type[i] != LOG_INDEX_PACKED_SEG_UNKNOWN)
+			continue;
+
+		if (memcmp(&table->segment[i], &pack_zero_seg, sizeof(log_tbl_seg_t)) == 0)
+			pack_seg_type[i] = LOG_INDEX_PACKED_SEG_ZERO;
+		else
+			pack_seg_type[i] = LOG_INDEX_PACKED_SEG_RAW;
+	}
+
+	return nrels;
+}
+
+static bool
+pack_encode_table(log_idx_table_data_t * table, log_index_pack_writer_t * w)
+{
+	uint32		base = (uint32) table->min_lsn;
+	int32		prev_order = 0;
+	int			nsegs = table->seg_num;
+	uint16	   *idx_order;
+	int			nrels;
+	int			i;
+
+	if (!LOG_INDEX_TBL_GEOMETRY_VALID(table))
+		return false;
+
+	while (nsegs > 0 &&
+		   memcmp(&table->segment[nsegs - 1], &pack_zero_seg, sizeof(log_tbl_seg_t)) == 0)
+		nsegs--;
+
+	nrels = pack_classify_segments(table, nsegs);
+
+	pack_put_varint(w, table->prefix_lsn);
+	pack_put_bytes(w, &table->crc, sizeof(pg_crc32));
+	pack_put_varint(w, table->seg_num);
+	pack_put_varint(w, table->hash_num);
+	pack_put_varint(w, table->last_order);
+
+	idx_order = LOG_INDEX_TBL_ORDER(table);
+	for (i = 0; i < table->last_order; i++)
+	{
+		pack_put_varint(w, pack_zigzag((int32) idx_order[i] - prev_order));
+		prev_order = idx_order[i];
+	}
+
+	for (i = 0; i < table->hash_num; i++)
+		pack_put_varint(w, LOG_INDEX_TBL_SLOT_VALUE(table, i));
+
+	pack_put_varint(w, nrels);
+
+	for (i = 0; i < nrels; i++)
+	{
+		pack_put_varint(w, pack_rels[i].spcNode);
+		pack_put_varint(w, pack_rels[i].dbNode);
+		pack_put_varint(w, pack_rels[i].relNode);
+	}
+
+	pack_put_varint(w, nsegs);
+
+	for (i = 0; i < nsegs && !w->overflow; i++)
+	{
+		log_seg_id_t id = i + 1;
+
+		pack_put_byte(w, pack_seg_type[i]);
+
+		switch (pack_seg_type[i])
+		{
+			case LOG_INDEX_PACKED_SEG_HEAD:
+				{
+					log_item_head_t *item = LOG_INDEX_ITEM_HEAD(table, id);
+
+					pack_put_varint(w, pack_zigzag((int32) item->head_seg - id));
+					pack_put_varint(w, item->next_item);
+					pack_put_varint(w, item->next_seg);
+					pack_put_varint(w, item->tail_seg);
+					pack_put_varint(w, pack_rel_index[i]);
+					pack_put_varint(w, pack_zigzag(item->tag.forkNum));
+					pack_put_varint(w, item->tag.blockNum);
+					pack_put_byte(w, item->number);
+
+					if (XLogRecPtrIsInvalid(item->prev_page_lsn))
+						pack_put_varint(w, 0);
+					else
+						pack_put_varint(w, pack_zigzag(table->min_lsn - item->prev_page_lsn) + 1);
+
+					pack_put_suffix(w, base, item->suffix_lsn,
+									Min(item->number, LOG_INDEX_ITEM_HEAD_LSN_NUM));
+					break;
+				}
+
+			case LOG_INDEX_PACKED_SEG_ITEM:
+				{
+					log_item_seg_t *seg = LOG_INDEX_ITEM_SEG(table, id);
+
+					pack_put_varint(w, seg->head_seg);
+					pack_put_varint(w, seg->next_seg);
+					pack_put_varint(w, seg->prev_seg);
+					pack_put_byte(w, seg->number);
+					pack_put_suffix(w, base, seg->suffix_lsn,
+									Min(seg->number, LOG_INDEX_ITEM_SEG_LSN_NUM));
+					break;
+				}
+
+			case LOG_INDEX_PACKED_SEG_RAW:
+				pack_put_bytes(w, &table->segment[i], sizeof(log_tbl_seg_t));
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return !w->overflow;
+}
+
+static bool
+pack_decode_table(log_index_pack_reader_t * r, log_idx_table_data_t * table)
+{
+	uint32		base = (uint32) table->min_lsn;
+	int32		prev_order = 0;
+	uint64		nrels;
+	uint64		nsegs;
+	uint16	   *idx_order;
+	int			i;
+
+	table->prefix_lsn = (uint32) pack_get_varint(r);
+	pack_get_bytes(r, &table->crc, sizeof(pg_crc32));
+	table->seg_num = (uint16) pack_get_varint(r);
+	table->hash_num = (uint16) pack_get_varint(r);
+	table->last_order = (uint32) pack_get_varint(r);
+
+	if (r->error || !LOG_INDEX_TBL_GEOMETRY_VALID(table))
+		return false;
+
+	idx_order = LOG_INDEX_TBL_ORDER(table);
+	for (i = 0; i < table->last_order; i++)
+	{
+		prev_order += (int32) pack_unzigzag(pack_get_varint(r));
+		idx_order[i] = (uint16) prev_order;
+	}
+
+	for (i = 0; i < table->hash_num; i++)
+		LOG_INDEX_TBL_SLOT_VALUE(table, i) = (log_seg_id_t) pack_get_varint(r);
+
+	nrels = pack_get_varint(r);
+
+	if (r->error || nrels > table->seg_num)
+		return false;
+
+	for (i = 0; i < nrels; i++)
+	{
+		pack_rels[i].spcNode = (Oid) pack_get_varint(r);
+		pack_rels[i].dbNode = (Oid) pack_get_varint(r);
+		pack_rels[i].relNode = (Oid) pack_get_varint(r);
+	}
+
+	nsegs = pack_get_varint(r);
+
+	if (r->error || nsegs > table->seg_num)
+		return false;
+
+	for (i = 0; i < nsegs && !r->error; i++)
+	{
+		log_seg_id_t id = i + 1;
+
+		switch (pack_get_byte(r))
+		{
+			case LOG_INDEX_PACKED_SEG_ZERO:
+				break;
+
+			case LOG_INDEX_PACKED_SEG_HEAD:
+				{
+					log_item_head_t *item = LOG_INDEX_ITEM_HEAD(table, id);
+					uint64		rel;
+					uint64		prev_page_lsn;
+
+					item->head_seg = (log_seg_id_t) (id + pack_unzigzag(pack_get_varint(r)));
+					item->next_item = (log_seg_id_t) pack_get_varint(r);
+					item->next_seg = (log_seg_id_t) pack_get_varint(r);
+					item->tail_seg = (log_seg_id_t) pack_get_varint(r);
+
+					rel = pack_get_varint(r);
+					if (rel >= nrels)
+						return false;
+
+					item->tag.rnode = pack_rels[rel];
+					item->tag.forkNum = (ForkNumber) pack_unzigzag(pack_get_varint(r));
+					item->tag.blockNum = (BlockNumber) pack_get_varint(r);
+					item->number = pack_get_byte(r);
+
+					prev_page_lsn = pack_get_varint(r);
+					if (prev_page_lsn != 0)
+						item->prev_page_lsn = table->min_lsn - pack_unzigzag(prev_page_lsn - 1);
+
+					pack_get_suffix(r, base, item->suffix_lsn,
+									Min(item->number, LOG_INDEX_ITEM_HEAD_LSN_NUM));
+					break;
+				}
+
+			case LOG_INDEX_PACKED_SEG_ITEM:
+				{
+					log_item_seg_t *seg = LOG_INDEX_ITEM_SEG(table, id);
+
+					seg->head_seg = (log_seg_id_t) pack_get_varint(r);
+					seg->next_seg = (log_seg_id_t) pack_get_varint(r);
+					seg->prev_seg = (log_seg_id_t) pack_get_varint(r);
+					seg->number = pack_get_byte(r);
+					pack_get_suffix(r, base, seg->suffix_lsn,
+									Min(seg->number, LOG_INDEX_ITEM_SEG_LSN_NUM));
+					break;
+				}
+
+			case LOG_INDEX_PACKED_SEG_RAW:
+				pack_get_bytes(r, &table->segment[i], sizeof(log_tbl_seg_t));
+				break;
+
+			default:
+				return false;
+		}
+	}
+
+	return !r->error && r->pos == r->len;
+}
+
+/*
+ * Pack table whose crc is already calculated.  Return the size of packed
+ * record, which is MAXALIGNed and always smaller than the raw table.  Return 0
+ * if the table can't be packed or it's not smaller after packed, then the raw
+ * table should be saved.
+ */
+Size
+log_index_pack_table(log_idx_table_data_t * table, int compression, log_idx_table_packed_t * packed)
+{
+	log_index_pack_writer_t w;
+	int32		packed_size = -1;
+	Size		size;
+
+	w.data = pack_stream;
+	w.len = 0;
+	w.cap = LOG_INDEX_PACKED_STREAM_SIZE;
+	w.overflow = false;
+
+	if (!pack_encode_table(table, &w))
+		return 0;
+
+	switch (compression)
+	{
+		case LOG_INDEX_TABLE_COMPRESSION_PGLZ:
+			packed_size = pglz_compress(w.data, w.len, packed->data, PGLZ_strategy_always);
+			break;
+
+#ifdef USE_LZ4
+		case LOG_INDEX_TABLE_COMPRESSION_LZ4:
+			packed_size = LZ4_compress_default(w.data, packed->data, w.len,
+											   LOG_INDEX_PACKED_DATA_SIZE);
+			if (packed_size <= 0)
+				packed_size = -1;
+			break;
+#endif
+
+#ifdef USE_ZSTD
+		case LOG_INDEX_TABLE_COMPRESSION_ZSTD:
+			{
+				size_t		zstd_size = ZSTD_compress(packed->data, LOG_INDEX_PACKED_DATA_SIZE,
+													  w.data, w.len, LOG_INDEX_PACKED_ZSTD_LEVEL);
+
+				if (!ZSTD_isError(zstd_size))
+					packed_size = (int32) zstd_size;
+				break;
+			}
+#endif
+
+		default:
+			break;
+	}
+
+	/* Save the stream as it is if it's not compressed or not smaller */
+	if (packed_size < 0 || packed_size >= w.len)
+	{
+		compression = LOG_INDEX_TABLE_COMPRESSION_PACKED;
+		packed_size = w.len;
+		memcpy(packed->data, w.data, w.len);
+	}
+
+	size = MAXALIGN(LOG_INDEX_TABLE_PACKED_HDR_SIZE + packed_size);
+
+	if (size >= sizeof(log_idx_table_data_t))
+		return 0;
+
+	/* Keep the alignment padding clean */
+	memset(packed->data + packed_size, 0,
+		   size - LOG_INDEX_TABLE_PACKED_HDR_SIZE - packed_size);
+
+	packed->magic = LOG_INDEX_TABLE_PACKED_MAGIC;
+	packed->compression = compression;
+	memset(packed->reserved, 0, sizeof(packed->reserved));
+	packed->idx_table_id = table->idx_table_id;
+	packed->min_lsn = table->min_lsn;
+	packed->max_lsn = table->max_lsn;
+	packed->encoded_size = w.len;
+	packed->packed_size = packed_size;
+	packed->crc = 0;
+	packed->crc = log_index_calc_crc((unsigned char *) packed,
+									 LOG_INDEX_TABLE_PACKED_HDR_SIZE + packed_size);
+
+	/* Never save a table which can't be unpacked to exactly the same one */
+	if (!log_index_unpack_table(packed, &pack_verify_table) ||
+		memcmp(&pack_verify_table, table, sizeof(log_idx_table_data_t)) != 0)
+		return 0;
+
+	return size;
+}
+
+/*
+ * Unpack the packed record to table.  Return false if the record is corrupted.
+ * The packed record is copied before table is written, so they may overlap.
+ */
+bool
+log_index_unpack_table(const log_idx_table_packed_t * packed, log_idx_table_data_t * table)
+{
+	log_idx_table_packed_t hdr;
+	log_index_pack_reader_t r;
+	pg_crc32	crc;
+	int			size = -1;
+
+	memcpy(&hdr, packed, LOG_INDEX_TABLE_PACKED_HDR_SIZE);
+
+	if (hdr.magic != LOG_INDEX_TABLE_PACKED_MAGIC ||
+		hdr.packed_size > LOG_INDEX_PACKED_DATA_SIZE ||
+		hdr.encoded_size > LOG_INDEX_PACKED_STREAM_SIZE)
+		return false;
+
+	hdr.crc = 0;
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, &hdr, LOG_INDEX_TABLE_PACKED_HDR_SIZE);
+	COMP_CRC32C(crc, packed->data, hdr.packed_size);
+	FIN_CRC32C(crc);
+
+	if (crc != packed->crc)
+		return false;
+
+	switch (hdr.compression)
+	{
+		case LOG_INDEX_TABLE_COMPRESSION_PACKED:
+			if (hdr.packed_size == hdr.encoded_size)
+			{
+				memcpy(pack_stream, packed->data, hdr.packed_size);
+				size = hdr.packed_size;
+			}
+			break;
+
+		case LOG_INDEX_TABLE_COMPRESSION_PGLZ:
+			size = pglz_decompress(packed->data, hdr.packed_size, pack_stream,
+								   hdr.encoded_size, true);
+			break;
+
+#ifdef USE_LZ4
+		case LOG_INDEX_TABLE_COMPRESSION_LZ4:
+			size = LZ4_decompress_safe(packed->data, pack_stream, hdr.packed_size,
+									   hdr.encoded_size);
+			break;
+#endif
+
+#ifdef USE_ZSTD
+		case LOG_INDEX_TABLE_COMPRESSION_ZSTD:
+			{
+				size_t		zstd_size = ZSTD_decompress(pack_stream, hdr.encoded_size,
+														packed->data, hdr.packed_size);
+
+				if (!ZSTD_isError(zstd_size))
+					size = (int) zstd_size;
+				break;
+			}
+#endif
+
+		default:
+			break;
+	}
+
+	if (size != hdr.encoded_size)
+		return false;
+
+	MemSet(table, 0, sizeof(log_idx_table_data_t));
+	table->idx_table_id = hdr.idx_table_id;
+	table->min_lsn = hdr.min_lsn;
+	table->max_lsn = hdr.max_lsn;
+
+	r.data = pack_stream;
+	r.len = hdr.encoded_size;
+	r.pos = 0;
+	r.error = false;
+
+	return pack_decode_table(&r, table);
+}
+
+/*
+ * Return the size of the table record which starts at record if it saves
+ * table tid, otherwise return 0.  At least LOG_INDEX_TABLE_PACKED_HDR_SIZE
+ * bytes must be readable from record.
+ */
+Size
+log_index_table_record_size(const char *record, log_idx_table_id_t tid)
+{
+	if (LOG_INDEX_TABLE_IS_PACKED(record))
+	{
+		const log_idx_table_packed_t *packed = (const log_idx_table_packed_t *) record;
+
+		if (packed->idx_table_id != tid || packed->packed_size > LOG_INDEX_PACKED_DATA_SIZE)
+			return 0;
+
+		return MAXALIGN(LOG_INDEX_TABLE_PACKED_HDR_SIZE + packed->packed_size);
+	}
+
+	if (((const log_idx_table_data_t *) record)->idx_table_id == tid)
+		return sizeof(log_idx_table_data_t);
+
+	return 0;
+}
+
+/*
+ * Read the table record which starts at record and has at most len bytes,
+ * whatever its table id is.  Return the size of the record, or 0 if it's not
+ * a complete record.
+ */
+Size
+log_index_read_table_record(const char *record, Size len, log_idx_table_data_t * table)
+{
+	if (len >= LOG_INDEX_TABLE_PACKED_HDR_SIZE && LOG_INDEX_TABLE_IS_PACKED(record))
+	{
+		const log_idx_table_packed_t *packed = (const log_idx_table_packed_t *) record;
+
+		if (packed->packed_size > LOG_INDEX_PACKED_DATA_SIZE ||
+			LOG_INDEX_TABLE_PACKED_HDR_SIZE + packed->packed_size > len ||
+			!log_index_unpack_table(packed, table))
+			return 0;
+
+		return Min(MAXALIGN(LOG_INDEX_TABLE_PACKED_HDR_SIZE + packed->packed_size), len);
+	}
+
+	if (len < sizeof(log_idx_table_data_t))
+		return 0;
+
+	memmove(table, record, sizeof(log_idx_table_data_t));
+
+	return sizeof(log_idx_table_data_t);
+}
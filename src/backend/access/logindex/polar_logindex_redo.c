@@ -46,6 +46,7 @@
 #include "replication/walreceiver.h"
 #include "storage/buf_internals.h"
 #include "storage/ipc.h"
+#include "storage/polar_bufmgr.h"
 #include "storage/polar_fd.h"
 #include "storage/procarray.h"
 #include "utils/faultinjector.h"
@@ -59,6 +60,7 @@
 
 bool		polar_enable_replica_prewarm = false;
 bool		polar_enable_parallel_replay_standby_mode = false;
+bool		polar_enable_parallel_replay_primary_recovery = false;
 int			polar_parallel_replay_task_queue_depth = 0;
 int			polar_parallel_replay_proc_num = 0;
 int			polar_logindex_max_local_cache_segments = 0;
@@ -75,6 +77,9 @@ int			polar_rel_size_cache_blocks = 0;
 int			polar_xlog_queue_buffers = 0;
 bool		polar_force_change_checkpoint = false;
 bool		polar_enable_standby_instant_recovery = false;
+int			polar_logindex_prefetch_distance = 64;
+bool		polar_logindex_track_parse_timing = false;
+int			polar_logindex_decode_queue_buffers = 16;
 
 polar_logindex_redo_ctl_t polar_logindex_redo_instance = NULL;
 
@@ -418,7 +423,7 @@ polar_logindex_outdate_parse(polar_logindex_redo_ctl_t instance, XLogReaderState
 		 * the buffer won't be queried if its block is not extended in the
 		 * storage.
 		 */
-		if (POLAR_IN_PARALLEL_REPLAY_STANDBY_MODE(polar_logindex_redo_instance) || polar_should_launch_standby_instant_recovery())
+		if (POLAR_IN_PARALLEL_REPLAY_MODE(polar_logindex_redo_instance) || polar_should_launch_standby_instant_recovery())
 			polar_extend_block_if_not_exist(tag);
 
 		POLAR_LOGINDEX_MINI_TRANS_ADD_LSN(instance->wal_logindex_snapshot,
@@ -571,7 +576,8 @@ polar_enable_logindex_parse(void)
 	/*
 	 * If it's replica mode and logindex is enabled, we parse XLOG and save it
 	 * to logindex. If it's standby parallel replay mode and logindex is
-	 * enabled, we also parse XLOG and save it to logindex.
+	 * enabled, we also parse XLOG and save it to logindex. So does the
+	 * primary node when it runs crash recovery in parallel replay mode.
 	 *
 	 * During recovery we read XLOG from checkpoint, primary node can drop or
 	 * truncate table after this checkpoint. We can't read these removed data
@@ -580,7 +586,7 @@ polar_enable_logindex_parse(void)
 	 * do this in replica mode.
 	 */
 	return (polar_is_replica() && polar_logindex_redo_instance) ||
-		POLAR_IN_PARALLEL_REPLAY_STANDBY_MODE(polar_logindex_redo_instance);
+		POLAR_IN_PARALLEL_REPLAY_MODE(polar_logindex_redo_instance);
 }
 
 XLogRecPtr
@@ -598,6 +604,8 @@ polar_logindex_parse_xlog(polar_logindex_redo_ctl_t instance, RmgrId rmid, XLogR
 {
 	bool		redo = false;
 	static bool parse_valid = false;
+	instr_time	start;
+	instr_time	duration;
 
 	if (unlikely(!parse_valid))
 	{
@@ -615,12 +623,17 @@ polar_logindex_parse_xlog(polar_logindex_redo_ctl_t instance, RmgrId rmid, XLogR
 	POLAR_ASSERT_PANIC(mini_trans_lsn != NULL);
 	*mini_trans_lsn = InvalidXLogRecPtr;
 
+	if (polar_logindex_track_parse_timing)
+		INSTR_TIME_SET_CURRENT(start);
+
 	/*
 	 * POLAR: In standby mode, parallel replay can be triggered only when
-	 * consistency reached, temporarily!
+	 * consistency reached, temporarily! In primary parallel recovery mode,
+	 * the records before redo start lsn are only saved to logindex.
 	 */
 	if (polar_is_replica() ||
-		(polar_is_standby() && polar_should_standby_launch_async_parse()))
+		(polar_is_standby() && polar_should_standby_launch_async_parse()) ||
+		(POLAR_IN_PARALLEL_REPLAY_PRIMARY_RECOVERY(instance) && state->ReadRecPtr >= redo_start_lsn))
 	{
 		/* Make sure there's room for us to pin buffer */
 		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
@@ -660,6 +673,15 @@ polar_logindex_parse_xlog(polar_logindex_redo_ctl_t instance, RmgrId rmid, XLogR
 	if (state->ReadRecPtr < redo_start_lsn)
 		redo = true;
 
+	if (polar_logindex_track_parse_timing)
+	{
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+		pg_atomic_fetch_add_u64(&instance->parse_stat.parse_us, INSTR_TIME_GET_MICROSEC(duration));
+	}
+	pg_atomic_fetch_add_u64(&instance->parse_stat.parsed_records, 1);
+	pg_atomic_write_u64(&instance->parse_stat.parsed_lsn, state->EndRecPtr);
+
 	return redo;
 }
 
@@ -671,6 +693,9 @@ polar_logindex_apply_page(polar_logindex_redo_ctl_t instance, XLogRecPtr start_l
 						  BufferTag *tag, Buffer *buffer)
 {
 	Page		page;
+	XLogRecPtr	min_lsn;
+	XLogRecPtr	empty_from = InvalidXLogRecPtr;
+	uint32		generation = 0;
 
 	POLAR_ASSERT_PANIC(BufferIsValid(*buffer));
 	page = BufferGetPage(*buffer);
@@ -714,13 +739,50 @@ polar_logindex_apply_page(polar_logindex_redo_ctl_t instance, XLogRecPtr start_l
 
 	POLAR_ASSERT_PANIC(wal_page_iter == NULL);
 
+	min_lsn = start_lsn;
+
+	/*
+	 * Other backends may already resolve the logindex of this page, and find
+	 * no record in part or all of [start_lsn, end_lsn - 1]. Then we only
+	 * search the lsn after that part.
+	 */
+	if (instance->page_lsn_cache != NULL)
+	{
+		XLogRecPtr	cache_from,
+					cache_to;
+		bool		hit = false;
+
+		/* Before resolving anything, see polar_page_lsn_cache_update() */
+		generation = polar_logindex_generation(instance->wal_logindex_snapshot);
+
+		if (polar_page_lsn_cache_lookup(instance->page_lsn_cache, tag, generation,
+										&cache_from, &cache_to) &&
+			cache_from < start_lsn && start_lsn <= cache_to)
+		{
+			if (end_lsn - 1 <= cache_to)
+			{
+				polar_page_lsn_cache_count(instance->page_lsn_cache, true);
+				return end_lsn;
+			}
+
+			if (cache_to + 1 < end_lsn - 1)
+			{
+				min_lsn = cache_to + 1;
+				empty_from = cache_from;
+				hit = true;
+			}
+		}
+
+		polar_page_lsn_cache_count(instance->page_lsn_cache, hit);
+	}
+
 	/*
 	 * Logindex record the start position of XLOG and we search LSN between
 	 * [start_lsn, end_lsn]. And end_lsn points to the end position of the
 	 * last xlog, so we should subtract 1 here .
 	 */
 	wal_page_iter = polar_logindex_create_page_iterator(instance->wal_logindex_snapshot,
-														tag, start_lsn, end_lsn - 1, polar_get_bg_redo_state(instance) == POLAR_BG_ONLINE_PROMOTE);
+														tag, min_lsn, end_lsn - 1, polar_get_bg_redo_state(instance) == POLAR_BG_ONLINE_PROMOTE);
 
 	if (unlikely(polar_logindex_page_iterator_state(wal_page_iter) != ITERATE_STATE_FINISHED))
 	{
@@ -730,6 +792,24 @@ polar_logindex_apply_page(polar_logindex_redo_ctl_t instance, XLogRecPtr start_l
 			 LSN_FORMAT_ARGS(end_lsn));
 	}
 
+	/*
+	 * Remember that there's no record of this page after the newest one we
+	 * found, up to end_lsn - 1
+	 */
+	if (instance->page_lsn_cache != NULL)
+	{
+		XLogRecPtr	newest_lsn = polar_logindex_page_iterator_newest_lsn(wal_page_iter);
+
+		if (!XLogRecPtrIsInvalid(newest_lsn))
+			empty_from = newest_lsn;
+		else if (XLogRecPtrIsInvalid(empty_from) && !XLogRecPtrIsInvalid(min_lsn))
+			empty_from = min_lsn - 1;
+
+		if (!XLogRecPtrIsInvalid(empty_from) && empty_from < end_lsn - 1)
+			polar_page_lsn_cache_update(instance->page_lsn_cache, tag, generation,
+										empty_from, end_lsn - 1);
+	}
+
 	polar_logindex_apply_one_page(instance, tag, buffer, wal_page_iter);
 
 	polar_logindex_release_page_iterator(wal_page_iter);
@@ -985,6 +1065,7 @@ polar_create_bg_redo_ctl(polar_logindex_redo_ctl_t instance, bool enable_process
 
 	ctl->state = polar_allocate_xlog_reader();
 	ctl->replay_batch_size = polar_bg_replay_batch_size;
+	ctl->prefetch_read_ahead = polar_bulk_read_ahead_begin(CurrentMemoryContext);
 
 	if (enable_processes_pool)
 	{
@@ -1004,7 +1085,10 @@ polar_release_bg_redo_ctl(polar_logindex_bg_redo_ctl_t *ctl)
 		polar_release_task_sched_ctl(ctl->sched_ctl);
 
 	polar_logindex_release_lsn_iterator(ctl->lsn_iter);
+	if (ctl->prefetch_iter)
+		polar_logindex_release_lsn_iterator(ctl->prefetch_iter);
 	XLogReaderFree(ctl->state);
+	polar_bulk_read_ahead_end(ctl->prefetch_read_ahead);
 
 	pfree(ctl);
 }
@@ -1535,9 +1619,15 @@ polar_logindex_redo_shmem_size(void)
 	if (polar_rel_size_cache_blocks > 0)
 		size = add_size(size, polar_rel_size_shmem_size(polar_rel_size_cache_blocks));
 
+	if (polar_logindex_page_lsn_cache_size > 0)
+		size = add_size(size, polar_page_lsn_cache_shmem_size(polar_logindex_page_lsn_cache_size));
+
 	if (polar_xlog_queue_buffers > 0)
 		size = add_size(size, polar_xlog_queue_size(polar_xlog_queue_buffers));
 
+	if (polar_xlog_queue_buffers > 0 && polar_logindex_decode_queue_buffers > 0)
+		size = add_size(size, polar_xlog_queue_size(polar_logindex_decode_queue_buffers));
+
 	if (polar_logindex_max_local_cache_segments > 0)
 		size = add_size(size, polar_local_cache_shmem_size(polar_logindex_max_local_cache_segments));
 
@@ -1556,6 +1646,9 @@ polar_logindex_redo_shmem_size(void)
 															   sizeof(parallel_replay_task_node_t), polar_parallel_replay_task_queue_depth));
 	}
 
+	if (polar_logindex_load_workers > 0)
+		size = add_size(size, polar_logindex_load_sched_shmem_size(polar_logindex_load_workers));
+
 	return size;
 }
 
@@ -1572,6 +1665,21 @@ polar_logindex_redo_ctl_init(const char *name)
 		POLAR_ASSERT_PANIC(!found);
 		MemSet(ctl, 0, sizeof(polar_logindex_redo_ctl_data_t));
 
+		pg_atomic_init_u64(&ctl->parse_stat.decoded_ahead_records, 0);
+		pg_atomic_init_u64(&ctl->parse_stat.decode_ahead_us, 0);
+		pg_atomic_init_u64(&ctl->parse_stat.decoded_ahead_lsn, InvalidXLogRecPtr);
+		pg_atomic_init_u64(&ctl->parse_stat.decoded_ahead_used, 0);
+		pg_atomic_init_u64(&ctl->parse_stat.decoded_records, 0);
+		pg_atomic_init_u64(&ctl->parse_stat.decode_us, 0);
+		pg_atomic_init_u64(&ctl->parse_stat.decoded_lsn, InvalidXLogRecPtr);
+		pg_atomic_init_u64(&ctl->parse_stat.parsed_records, 0);
+		pg_atomic_init_u64(&ctl->parse_stat.parse_us, 0);
+		pg_atomic_init_u64(&ctl->parse_stat.parsed_lsn, InvalidXLogRecPtr);
+		pg_atomic_init_u64(&ctl->prefetch_stat.hits, 0);
+		pg_atomic_init_u64(&ctl->prefetch_stat.issued, 0);
+		pg_atomic_init_u64(&ctl->prefetch_stat.skipped, 0);
+		pg_atomic_init_u64(&ctl->prefetch_stat.prefetched_lsn, InvalidXLogRecPtr);
+
 		/* Init logindex memory context which is static variable */
 		polar_logindex_memory_context();
 		/* Init logindex redo memory context which is static variable */
@@ -1612,6 +1720,10 @@ polar_logindex_redo_shmem_init(void)
 		elog(FATAL, "%s: PolarDB relation size cache use wrong block size %d",
 			 PG_FUNCNAME_MACRO, polar_rel_size_cache_blocks);
 
+	if (polar_logindex_page_lsn_cache_size > 0)
+		instance->page_lsn_cache = polar_page_lsn_cache_shmem_init("polar_page_lsn_cache",
+																   polar_logindex_page_lsn_cache_size);
+
 	if (polar_xlog_queue_buffers > 0)
 		instance->xlog_queue = polar_xlog_queue_init("polar_xlog_queue", LWTRANCHE_POLAR_XLOG_QUEUE,
 													 polar_xlog_queue_buffers);
@@ -1619,6 +1731,11 @@ polar_logindex_redo_shmem_init(void)
 		elog(FATAL, "%s: PolarDB xlog queue use wrong buffer size %d",
 			 PG_FUNCNAME_MACRO, polar_xlog_queue_buffers);
 
+	if (polar_logindex_decode_queue_buffers > 0)
+		instance->decode_queue = polar_xlog_decode_queue_init("polar_xlog_decode_queue",
+															  LWTRANCHE_POLAR_XLOG_QUEUE,
+															  polar_logindex_decode_queue_buffers);
+
 	if (polar_logindex_max_local_cache_segments > 0)
 		polar_logindex_create_local_cache(instance->wal_logindex_snapshot, "wal_logindex",
 										  polar_logindex_max_local_cache_segments);
@@ -1645,6 +1762,16 @@ polar_logindex_redo_shmem_init(void)
 																polar_parallel_replay_task_queue_depth, instance);
 	}
 
+	/* Both logindex snapshots are loaded by startup, so they share the workers */
+	if (polar_logindex_load_workers > 0)
+	{
+		polar_task_sched_t *load_sched = polar_logindex_create_load_sched("polar_logindex_load_sched",
+																		  polar_logindex_load_workers);
+
+		polar_logindex_set_load_sched(instance->wal_logindex_snapshot, load_sched);
+		polar_logindex_set_load_sched(instance->fullpage_logindex_snapshot, load_sched);
+	}
+
 	polar_logindex_redo_instance = instance;
 }
 
@@ -1755,6 +1882,252 @@ polar_logindex_redo_bg_flush_data(polar_logindex_redo_ctl_t instance)
 	return write_done;
 }
 
+/*
+ * POLAR: Order blocks to prefetch by relation fork and block number.
+ */
+static int
+polar_logindex_prefetch_tag_cmp(const void *a, const void *b)
+{
+	const BufferTag *ta = (const BufferTag *) a;
+	const BufferTag *tb = (const BufferTag *) b;
+	int			ret;
+
+	ret = memcmp(&ta->rnode, &tb->rnode, sizeof(RelFileNode));
+	if (ret != 0)
+		return ret;
+
+	if (ta->forkNum != tb->forkNum)
+		return ta->forkNum < tb->forkNum ? -1 : 1;
+
+	if (ta->blockNum != tb->blockNum)
+		return ta->blockNum < tb->blockNum ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * POLAR: Start reading the pending blocks into shared buffers with
+ * asynchronous io.
+ *
+ * Fadvise is a no-op with direct io, so blocks are read into shared buffers
+ * instead. They are sorted, and the requests for blocks of the same segment
+ * are submitted as one batch. The dispatcher doesn't wait for them, the
+ * blocks are put into shared buffers by the next prefetch. A parallel replay
+ * process which needs one of the blocks meanwhile just reads it itself.
+ */
+static void
+polar_logindex_bg_prefetch_read(polar_read_ahead_state *read_ahead, BufferTag *tags, int ntags,
+								uint64 *hits, uint64 *skipped)
+{
+	BlockNumber *blocknums;
+	int			i;
+
+	if (ntags == 0)
+		return;
+
+	qsort(tags, ntags, sizeof(BufferTag), polar_logindex_prefetch_tag_cmp);
+	blocknums = palloc(ntags * sizeof(BlockNumber));
+
+	for (i = 0; i < ntags;)
+	{
+		BufferTag  *first = &tags[i];
+		SMgrRelation reln;
+		int			nblocks = 0;
+		int			nfound;
+		int			nstarted;
+
+		for (; i < ntags; i++)
+		{
+			if (!RelFileNodeEquals(tags[i].rnode, first->rnode) ||
+				tags[i].forkNum != first->forkNum ||
+				tags[i].blockNum / RELSEG_SIZE != first->blockNum / RELSEG_SIZE)
+				break;
+
+			if (nblocks > 0 && tags[i].blockNum == blocknums[nblocks - 1])
+			{
+				(*skipped)++;
+				continue;
+			}
+
+			blocknums[nblocks++] = tags[i].blockNum;
+		}
+
+		reln = smgropen(first->rnode, InvalidBackendId);
+		nstarted = polar_bulk_read_ahead_blocks(read_ahead, reln, RELPERSISTENCE_PERMANENT,
+												first->forkNum, blocknums, nblocks, NULL,
+												&nfound);
+
+		/* The blocks started are counted as issued once they are read */
+		*hits += nfound;
+		*skipped += nblocks - nfound - nstarted;
+	}
+
+	pfree(blocknums);
+}
+
+/*
+ * POLAR: Prefetch blocks which will be dispatched to parallel replay soon.
+ *
+ * prefetch_iter goes through the same logindex items as lsn_iter, and stays
+ * at most polar_logindex_prefetch_distance items ahead of it. For each item,
+ * the block is read ahead if it's not in shared buffers, so the storage reads
+ * it while parallel replay processes are busy with earlier records. With
+ * buffered io, an asynchronous read is issued by fadvise. With direct io, the
+ * blocks are collected and their reads into shared buffers are started
+ * together, and counted as issued when they are done. Reading into shared
+ * buffers is only done in parallel replay mode, where parallel replay
+ * processes replay the blocks; otherwise the dispatcher would have to replay
+ * them itself. Like dispatch, it does not go beyond max_lsn, which is the end
+ * of records read by startup process.
+ */
+static void
+polar_logindex_bg_prefetch(polar_logindex_bg_redo_ctl_t *ctl, XLogRecPtr max_lsn)
+{
+	logindex_snapshot_t snapshot = ctl->instance->wal_logindex_snapshot;
+	polar_logindex_prefetch_stat_t *stat = &ctl->instance->prefetch_stat;
+	XLogRecPtr	prefetched_lsn = InvalidXLogRecPtr;
+	uint64		hits = 0,
+				issued = 0,
+				skipped = 0;
+	BufferTag  *pending = NULL;
+	int			npending = 0;
+
+	/* Finish the reads started by the last prefetch which are done */
+	polar_bulk_read_ahead_complete(ctl->prefetch_read_ahead, polar_logindex_prefetch_distance <= 0);
+
+	if (ctl->prefetch_read_ahead->nread != ctl->prefetch_nread)
+	{
+		pg_atomic_fetch_add_u64(&stat->issued, ctl->prefetch_read_ahead->nread - ctl->prefetch_nread);
+		ctl->prefetch_nread = ctl->prefetch_read_ahead->nread;
+	}
+
+	if (polar_logindex_prefetch_distance <= 0)
+	{
+		if (ctl->prefetch_iter)
+		{
+			polar_logindex_release_lsn_iterator(ctl->prefetch_iter);
+			ctl->prefetch_iter = NULL;
+			ctl->prefetch_page = NULL;
+		}
+
+		return;
+	}
+
+	if (ctl->prefetch_iter == NULL)
+	{
+		XLogRecPtr	start_lsn;
+
+		/* Start from the first item which is not dispatched yet */
+		if (ctl->replay_page)
+			start_lsn = ctl->replay_page->lsn;
+		else
+			start_lsn = Max(polar_bg_redo_get_replayed_lsn(ctl->instance), ctl->max_dispatched_lsn);
+
+		ctl->prefetch_iter = polar_logindex_create_lsn_iterator(snapshot, start_lsn);
+		ctl->prefetch_page = NULL;
+		ctl->prefetch_ahead = 0;
+		CLEAR_BUFFERTAG(ctl->prefetch_tag);
+		ctl->prefetch_nblocks = InvalidBlockNumber;
+	}
+
+	while (ctl->prefetch_ahead < polar_logindex_prefetch_distance)
+	{
+		BufferTag  *tag;
+		XLogRecPtr	lsn;
+		SMgrRelation reln;
+		PrefetchBufferResult result;
+
+		if (ctl->prefetch_page == NULL)
+			ctl->prefetch_page = polar_logindex_lsn_iterator_next(snapshot, ctl->prefetch_iter);
+
+		if (ctl->prefetch_page == NULL || ctl->prefetch_page->lsn > max_lsn)
+			break;
+
+		tag = ctl->prefetch_page->tag;
+		lsn = ctl->prefetch_page->lsn;
+		ctl->prefetch_page = NULL;
+
+		/* Skip the items which are already dispatched */
+		if (ctl->prefetch_ahead++ < 0)
+			continue;
+
+		prefetched_lsn = lsn;
+
+		/* Records usually modify the same block one after another */
+		if (BUFFERTAGS_EQUAL(*tag, ctl->prefetch_tag))
+		{
+			skipped++;
+			continue;
+		}
+
+		if (!RelFileNodeEquals(tag->rnode, ctl->prefetch_tag.rnode) ||
+			tag->forkNum != ctl->prefetch_tag.forkNum)
+			ctl->prefetch_nblocks = InvalidBlockNumber;
+
+		ctl->prefetch_tag = *tag;
+		reln = smgropen(tag->rnode, InvalidBackendId);
+
+		/*
+		 * The relation may be created or extended by records which are not
+		 * replayed yet, so don't prefetch beyond the end of it.
+		 */
+		if (ctl->prefetch_nblocks == InvalidBlockNumber ||
+			tag->blockNum >= ctl->prefetch_nblocks)
+			ctl->prefetch_nblocks = smgrexists(reln, tag->forkNum) ?
+				smgrnblocks(reln, tag->forkNum) : 0;
+
+		if (tag->blockNum >= ctl->prefetch_nblocks)
+		{
+			skipped++;
+			continue;
+		}
+
+		if (polar_vfs_is_dio_mode)
+		{
+			if (!POLAR_IN_PARALLEL_REPLAY_MODE(ctl->instance))
+			{
+				skipped++;
+				continue;
+			}
+
+			if (pending == NULL)
+				pending = palloc(polar_logindex_prefetch_distance * sizeof(BufferTag));
+
+			pending[npending++] = *tag;
+			continue;
+		}
+
+		result = PrefetchSharedBuffer(reln, tag->forkNum, tag->blockNum);
+
+		if (BufferIsValid(result.recent_buffer))
+			hits++;
+		else if (result.initiated_io)
+			issued++;
+		else
+			skipped++;
+	}
+
+	if (pending)
+	{
+		polar_logindex_bg_prefetch_read(ctl->prefetch_read_ahead, pending, npending,
+										&hits, &skipped);
+		pfree(pending);
+	}
+	else
+	{
+		/* Don't keep the buffers pinned while the dispatcher may go idle */
+		polar_bulk_read_ahead_complete(ctl->prefetch_read_ahead, true);
+	}
+
+	if (XLogRecPtrIsInvalid(prefetched_lsn))
+		return;
+
+	pg_atomic_fetch_add_u64(&stat->hits, hits);
+	pg_atomic_fetch_add_u64(&stat->issued, issued);
+	pg_atomic_fetch_add_u64(&stat->skipped, skipped);
+	pg_atomic_write_u64(&stat->prefetched_lsn, prefetched_lsn);
+}
+
 static bool
 polar_logindex_bg_dispatch(polar_logindex_bg_redo_ctl_t *ctl, bool *can_hold)
 {
@@ -1830,6 +2203,9 @@ polar_logindex_bg_dispatch(polar_logindex_bg_redo_ctl_t *ctl, bool *can_hold)
 			ctl->max_dispatched_lsn = node.lsn;
 			ctl->replay_page = NULL;
 
+			if (ctl->prefetch_iter)
+				ctl->prefetch_ahead--;
+
 			ereport(polar_trace_logindex(DEBUG2), (errmsg("Dispatch lsn=%lX, " POLAR_LOG_BUFFER_TAG_FORMAT " to proc=%d",
 														  dst_node->lsn, POLAR_LOG_BUFFER_TAG(&dst_node->tag),
 														  sched_ctl->sub_proc[proc].proc->pid),
@@ -1849,6 +2225,8 @@ polar_logindex_bg_dispatch(polar_logindex_bg_redo_ctl_t *ctl, bool *can_hold)
 	}
 	while (true);
 
+	polar_logindex_bg_prefetch(ctl, polar_get_last_replayed_read_ptr());
+
 	/*
 	 * Set dispatch_done to be true when there's no running task and no new
 	 * WAL to dispatch.
@@ -2212,7 +2590,8 @@ polar_logindex_require_backend_redo(polar_logindex_redo_ctl_t instance, ForkNumb
 	/*
 	 * POLAR: There are three ways to make backends replaying with logindex.
 	 * (1) When backends are running in replica node. (2) When backends are
-	 * running in standby node with enabled parallel replaying. (3) When
+	 * running in standby node with enabled parallel replaying, or in primary
+	 * node doing crash recovery with parallel replaying. (3) When
 	 * backends are running in new promoted primary node without finishing
 	 * online promote work from old replica node.
 	 */
@@ -2234,13 +2613,13 @@ polar_logindex_require_backend_redo(polar_logindex_redo_ctl_t instance, ForkNumb
 		POLAR_ASSERT_PANIC(!XLogRecPtrIsInvalid(redo_lsn));
 		POLAR_SET_BACKEND_READ_MIN_LSN(redo_lsn);
 	}
-	else if (POLAR_IN_PARALLEL_REPLAY_STANDBY_MODE(instance))
+	else if (POLAR_IN_PARALLEL_REPLAY_MODE(instance))
 	{
 		XLogRecPtr	redo_lsn = GetRedoRecPtr();
 
 		/*
 		 * POLAR: The replay_from should be set to bg_replayed_lsn in parallel
-		 * replaying mode for standby.
+		 * replaying mode for standby and primary crash recovery.
 		 */
 		SpinLockAcquire(&instance->info_lck);
 		if (XLogRecPtrIsInvalid(instance->bg_replayed_lsn))
@@ -2726,6 +3105,77 @@ polar_wait_logindex_bg_stop_replay(polar_logindex_redo_ctl_t instance, Latch *la
 	elog(LOG, "background process handled online promote signal");
 }
 
+/*
+ * POLAR: Start parallel replay for crash recovery of the primary node.
+ *
+ * The startup process parses WAL once and saves page records to logindex,
+ * only non-page records are applied by itself. The logindex background worker
+ * iterates logindex from redo_start_lsn and dispatches replay tasks keyed by
+ * BufferTag to the parallel replay process pool, so records of the same page
+ * are always replayed in order by one process.
+ */
+void
+polar_logindex_start_parallel_recovery(polar_logindex_redo_ctl_t instance, XLogRecPtr redo_start_lsn)
+{
+	if (!POLAR_ENABLE_PARALLEL_REPLAY_PRIMARY_RECOVERY())
+		return;
+
+	POLAR_ASSERT_PANIC(instance != NULL && !XLogRecPtrIsInvalid(redo_start_lsn));
+
+	SpinLockAcquire(&instance->info_lck);
+	instance->bg_replayed_lsn = redo_start_lsn;
+	SpinLockRelease(&instance->info_lck);
+	instance->replayed_oldest_lsn = redo_start_lsn;
+
+	pg_write_barrier();
+	polar_set_bg_redo_state(instance, POLAR_BG_PARALLEL_REPLAYING);
+
+	NOTIFY_LOGINDEX_BG_WORKER(instance->bg_worker_latch);
+
+	ereport(LOG, (errmsg("start parallel crash recovery from %X/%X with %d replay processes",
+						 LSN_FORMAT_ARGS(redo_start_lsn), polar_parallel_replay_proc_num)));
+}
+
+/*
+ * POLAR: Wait parallel replay processes to apply all the page records which
+ * startup process parsed, and then stop parallel replay. It must be called
+ * before the end of recovery checkpoint.
+ */
+void
+polar_logindex_finish_parallel_recovery(polar_logindex_redo_ctl_t instance, Latch *latch)
+{
+	XLogRecPtr	end_lsn;
+	instr_time	start_time,
+				wait_time;
+
+	if (!POLAR_IN_PARALLEL_REPLAY_PRIMARY_RECOVERY(instance))
+		return;
+
+	end_lsn = GetXLogReplayRecPtr(NULL);
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	while (polar_bg_redo_get_replayed_lsn(instance) < end_lsn)
+	{
+		NOTIFY_LOGINDEX_BG_WORKER(instance->bg_worker_latch);
+		HandleStartupProcInterrupts();
+		WaitLatch(latch,
+				  WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+				  10, WAIT_EVENT_RECOVERY_APPLY_DELAY);
+
+		ResetLatch(latch);
+	}
+
+	/* Background worker will release its process pool */
+	polar_set_bg_redo_state(instance, POLAR_BG_REDO_NOT_START);
+	NOTIFY_LOGINDEX_BG_WORKER(instance->bg_worker_latch);
+
+	INSTR_TIME_SET_CURRENT(wait_time);
+	INSTR_TIME_SUBTRACT(wait_time, start_time);
+
+	ereport(LOG, (errmsg("parallel crash recovery finished at %X/%X, waited %.3f s for replay processes",
+						 LSN_FORMAT_ARGS(end_lsn), INSTR_TIME_GET_DOUBLE(wait_time))));
+}
+
 static void
 logindex_replay_specific_pages(polar_logindex_redo_ctl_t instance, XLogRecPtr start_lsn,
 							   log_index_lsn_t_cmp cmp, log_index_lsn_t * target_info)
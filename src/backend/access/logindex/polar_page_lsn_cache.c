@@ -0,0 +1,172 @@
+/*-------------------------------------------------------------------------
+ *
+ * polar_page_lsn_cache.c
+ *	  Lock-free cache of the lsn ranges resolved from logindex for pages.
+ *
+ * Copyright (c) 2024, Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/logindex/polar_page_lsn_cache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/polar_page_lsn_cache.h"
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "storage/shmem.h"
+
+int			polar_logindex_page_lsn_cache_size = 0;
+
+#define PAGE_LSN_CACHE_ENTRY(cache, tag) \
+	(&(cache)->entries[tag_hash((tag), sizeof(BufferTag)) % (cache)->size])
+
+Size
+polar_page_lsn_cache_shmem_size(int size)
+{
+	Size		shmem_size = 0;
+
+	if (size <= 0)
+		return shmem_size;
+
+	shmem_size = offsetof(polar_page_lsn_cache_data_t, entries);
+	shmem_size = add_size(shmem_size, mul_size(sizeof(polar_page_lsn_cache_entry_t), size));
+
+	return CACHELINEALIGN(shmem_size);
+}
+
+polar_page_lsn_cache_t
+polar_page_lsn_cache_shmem_init(const char *name, int size)
+{
+	bool		found;
+	polar_page_lsn_cache_t cache;
+	int			i;
+
+	if (size <= 0)
+		return NULL;
+
+	cache = (polar_page_lsn_cache_t) ShmemInitStruct(name,
+													 polar_page_lsn_cache_shmem_size(size), &found);
+
+	if (!IsUnderPostmaster)
+	{
+		Assert(!found);
+
+		MemSet(cache, 0, polar_page_lsn_cache_shmem_size(size));
+		cache->size = size;
+		pg_atomic_init_u64(&cache->hits, 0);
+		pg_atomic_init_u64(&cache->misses, 0);
+
+		for (i = 0; i < size; i++)
+			pg_atomic_init_u32(&cache->entries[i].version, 0);
+	}
+	else
+		Assert(found);
+
+	return cache;
+}
+
+/*
+ * Search the lsn range resolved for tag from the given generation of
+ * logindex.  Return false if tag is not cached, its entry is resolved from
+ * another generation, or it's being changed right now.
+ */
+bool
+polar_page_lsn_cache_lookup(polar_page_lsn_cache_t cache, BufferTag *tag,
+							uint32 generation, XLogRecPtr *empty_from,
+							XLogRecPtr *empty_to)
+{
+	polar_page_lsn_cache_entry_t *entry = PAGE_LSN_CACHE_ENTRY(cache, tag);
+	uint32		version;
+	uint32		entry_generation;
+	BufferTag	entry_tag;
+
+	version = pg_atomic_read_u32(&entry->version);
+
+	/* Empty entry or a writer is changing it */
+	if (version == 0 || (version & 1))
+		return false;
+
+	pg_read_barrier();
+
+	entry_generation = entry->generation;
+	entry_tag = entry->tag;
+	*empty_from = entry->empty_from;
+	*empty_to = entry->empty_to;
+
+	pg_read_barrier();
+
+	if (pg_atomic_read_u32(&entry->version) != version)
+		return false;
+
+	return entry_generation == generation && BUFFERTAGS_EQUAL(entry_tag, *tag);
+}
+
+/*
+ * Remember there's no logindex record of tag in (empty_from, empty_to], as
+ * resolved from the given generation of logindex.  The caller gets the
+ * generation before it resolves the range, so a range resolved while
+ * logindex is changed is never taken for the new generation.
+ *
+ * A page which is resolved to a larger lsn is not replaced by the same page
+ * resolved to a smaller lsn, and an entry of a newer generation is not
+ * replaced by an older one.  Give up if someone else is changing the entry,
+ * the cache is only a hint.
+ */
+void
+polar_page_lsn_cache_update(polar_page_lsn_cache_t cache, BufferTag *tag,
+							uint32 generation, XLogRecPtr empty_from,
+							XLogRecPtr empty_to)
+{
+	polar_page_lsn_cache_entry_t *entry = PAGE_LSN_CACHE_ENTRY(cache, tag);
+	uint32		version;
+
+	Assert(empty_from < empty_to);
+
+	version = pg_atomic_read_u32(&entry->version);
+
+	if (version & 1)
+		return;
+
+	/* Full barrier, so nobody can see our changes before the version is odd */
+	if (!pg_atomic_compare_exchange_u32(&entry->version, &version, version + 1))
+		return;
+
+	if (version != 0 && (int32) (generation - entry->generation) < 0)
+	{
+		/* Keep the entry resolved from a newer generation */
+	}
+	else if (version == 0 || entry->generation != generation ||
+			 !BUFFERTAGS_EQUAL(entry->tag, *tag) || entry->empty_to < empty_to)
+	{
+		entry->generation = generation;
+		entry->tag = *tag;
+		entry->empty_from = empty_from;
+		entry->empty_to = empty_to;
+	}
+
+	pg_write_barrier();
+	pg_atomic_write_u32(&entry->version, version + 2);
+}
+
+void
+polar_page_lsn_cache_count(polar_page_lsn_cache_t cache, bool hit)
+{
+	if (hit)
+		pg_atomic_fetch_add_u64(&cache->hits, 1);
+	else
+		pg_atomic_fetch_add_u64(&cache->misses, 1);
+}
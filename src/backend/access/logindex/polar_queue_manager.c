@@ -32,6 +32,10 @@
  * 2. In replica mode there exists one recv queue.
  *  2.1 WAL receiver save received xlog meta to receive queue.
  *  2.2 Startup process parse xlog meta from the queue and save to logindex table.
+ *  2.3 Logindex decode worker decodes xlog meta in the queue ahead of startup
+ *      process and pushes decoded records to decode queue. Startup process
+ *      takes the decoded record from decode queue when it's the one it pops,
+ *      and decodes the record itself otherwise.
  */
 #include "postgres.h"
 
@@ -49,15 +53,21 @@
 #include "access/xloginsert.h"
 #include "catalog/pg_control.h"
 #include "miscadmin.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
 #include "postmaster/startup.h"
 #include "replication/origin.h"
 #include "replication/walreceiver.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/procsignal.h"
 #include "storage/shmem.h"
 #include "utils/faultinjector.h"
 #include "utils/faultinjector_lists.h"
 #include "utils/guc.h"
 #include "utils/ps_status.h"
 #include "utils/polar_log.h"
+#include "utils/wait_event.h"
 
 typedef uint32 main_data_len_t;
 typedef uint8 block_id_t;
@@ -65,6 +75,33 @@ typedef uint8 block_id_t;
 
 static bool xlog_queue_catch_up = false;
 
+/*
+ * Head of a decode queue packet, the decoded record follows it. The record
+ * is copied as it is, and its pointers are moved from base to where it's
+ * copied to.
+ */
+typedef struct polar_xlog_decoded_hdr_t
+{
+	XLogRecPtr	lsn;			/* start of the record */
+	XLogRecPtr	end_lsn;		/* end of the record */
+	uint32		record_meta_len;	/* length of the record in xlog queue */
+	char	   *base;			/* where decode worker decoded the record */
+} polar_xlog_decoded_hdr_t;
+
+#define POLAR_XLOG_DECODED_PKT_SIZE(record_meta_len) \
+	POLAR_RINGBUF_PKT_SIZE(sizeof(polar_xlog_decoded_hdr_t) + \
+						   DecodeXLogRecordRequiredSpace(record_meta_len))
+
+/* Records decoded by the worker before it releases xlog queue for a while */
+#define POLAR_XLOG_DECODE_AHEAD_BATCH	64
+
+/* Reference of startup process to decode queue, and the worker it launched */
+static polar_ringbuf_ref_t decode_queue_ref =
+{
+	.slot = -1
+};
+static BackgroundWorkerHandle *decode_worker_handle = NULL;
+
 Size
 polar_xlog_queue_size(int size_MB)
 {
@@ -312,6 +349,29 @@ polar_xlog_queue_init(const char *name, int tranche_id, int size_MB)
 	return queue;
 }
 
+polar_ringbuf_t
+polar_xlog_decode_queue_init(const char *name, int tranche_id, int size_MB)
+{
+	bool		found;
+	uint8	   *data;
+	Size		size;
+	polar_ringbuf_t queue = NULL;
+
+	size = polar_xlog_queue_size(size_MB);
+	data = (uint8 *) ShmemInitStruct(name, size, &found);
+
+	if (!IsUnderPostmaster)
+	{
+		POLAR_ASSERT_PANIC(!found);
+		MemSet(data, 0, size);
+		queue = polar_ringbuf_init(data, size, tranche_id);
+	}
+	else
+		POLAR_ASSERT_PANIC(found);
+
+	return queue;
+}
+
 #define POLAR_WRITE_MAIN_DATA(queue, dlen, rbuf_pos, offset) \
 	do { \
 		uint8 block_id = XLR_BLOCK_ID_POLAR_EXTRA; \
@@ -849,6 +909,9 @@ polar_xlog_queue_remove_outdate(polar_ringbuf_ref_t *ref, XLogReaderState *state
 	return read_rec_ptr;
 }
 
+static DecodedXLogRecord *polar_xlog_queue_enqueue_decoded(XLogReaderState *state,
+														   DecodedXLogRecord *decoded);
+
 static DecodedXLogRecord *
 polar_xlog_queue_decode_record(polar_ringbuf_ref_t *ref, ssize_t offset, uint32 pktlen,
 							   XLogRecPtr read_rec_ptr, XLogRecPtr end_rec_ptr,
@@ -876,6 +939,16 @@ polar_xlog_queue_decode_record(polar_ringbuf_ref_t *ref, ssize_t offset, uint32
 	/* Record the location of the next record. */
 	decoded->next_lsn = state->NextRecPtr;
 
+	return polar_xlog_queue_enqueue_decoded(state, decoded);
+}
+
+/*
+ * Occupy the decode buffer space of the decoded record and insert it into the
+ * queue of decoded records of state.
+ */
+static DecodedXLogRecord *
+polar_xlog_queue_enqueue_decoded(XLogReaderState *state, DecodedXLogRecord *decoded)
+{
 	/*
 	 * If it's in the decode buffer, mark the decode buffer space as occupied.
 	 */
@@ -900,6 +973,108 @@ polar_xlog_queue_decode_record(polar_ringbuf_ref_t *ref, ssize_t offset, uint32
 	return decoded;
 }
 
+#define POLAR_XLOG_DECODED_RELOCATE(_ptr, _decoded, _base, _size) \
+	do { \
+		if ((_ptr) >= (_base) && (_ptr) < (_base) + (_size)) \
+			(_ptr) = (char *) (_decoded) + ((_ptr) - (_base)); \
+	} while (0)
+
+/*
+ * Take the record starting at read_rec_ptr from decode queue if decode worker
+ * decoded it ahead. The packets before read_rec_ptr are dropped, they are
+ * decoded by startup process already. Return NULL if it's not decoded ahead
+ * or the decoded one is not what's in xlog queue, then the caller decodes it.
+ */
+static DecodedXLogRecord *
+polar_xlog_decode_queue_pop(polar_ringbuf_ref_t *ref, ssize_t offset, uint32 pktlen,
+							XLogRecPtr read_rec_ptr, XLogRecPtr end_rec_ptr,
+							XLogReaderState *state)
+{
+	polar_ringbuf_ref_t *decode_ref = &decode_queue_ref;
+	uint32		record_meta_len = pktlen - POLAR_XLOG_HEAD_SIZE;
+	polar_xlog_decoded_hdr_t hdr;
+	XLogRecord	record;
+	XLogRecord	decoded_record;
+	DecodedXLogRecord *decoded;
+	uint32		decoded_pktlen;
+	ssize_t		decoded_offset;
+	Size		size;
+	bool		oversized;
+	int			block_id;
+
+	for (;;)
+	{
+		if (polar_ringbuf_avail(decode_ref) <= 0 ||
+			polar_ringbuf_next_ready_pkt(decode_ref, &decoded_pktlen) != POLAR_RINGBUF_PKT_WAL_DECODED)
+			return NULL;
+
+		decoded_offset = 0;
+		POLAR_COPY_QUEUE_CONTENT(decode_ref, decoded_offset, &hdr, sizeof(hdr));
+
+		if (hdr.lsn >= read_rec_ptr)
+			break;
+
+		polar_ringbuf_update_ref(decode_ref);
+	}
+
+	if (hdr.lsn > read_rec_ptr)
+		return NULL;
+
+	size = decoded_pktlen - sizeof(hdr);
+	POLAR_COPY_QUEUE_CONTENT(ref, offset, &record, SizeOfXLogRecord);
+	decoded_offset = sizeof(hdr) + offsetof(DecodedXLogRecord, header);
+	POLAR_COPY_QUEUE_CONTENT(decode_ref, decoded_offset, &decoded_record, sizeof(XLogRecord));
+
+	/*
+	 * WAL may be streamed again from another timeline, so make sure it's the
+	 * same record.
+	 */
+	if (hdr.end_lsn != end_rec_ptr || hdr.record_meta_len != record_meta_len ||
+		size > DecodeXLogRecordRequiredSpace(record_meta_len) ||
+		record.xl_tot_len != decoded_record.xl_tot_len ||
+		record.xl_xid != decoded_record.xl_xid ||
+		record.xl_prev != decoded_record.xl_prev ||
+		record.xl_info != decoded_record.xl_info ||
+		record.xl_rmid != decoded_record.xl_rmid ||
+		record.xl_crc != decoded_record.xl_crc)
+	{
+		polar_ringbuf_update_ref(decode_ref);
+		return NULL;
+	}
+
+	polar_xlog_queue_update_reader(state, read_rec_ptr, end_rec_ptr);
+	decoded = XLogReadRecordAlloc(state, record_meta_len, true);
+	POLAR_ASSERT_PANIC(decoded != NULL);
+	oversized = decoded->oversized;
+
+	decoded_offset = sizeof(hdr);
+	POLAR_COPY_QUEUE_CONTENT(decode_ref, decoded_offset, decoded, size);
+	polar_ringbuf_update_ref(decode_ref);
+
+	decoded->oversized = oversized;
+	decoded->next = NULL;
+	POLAR_XLOG_DECODED_RELOCATE(decoded->main_data, decoded, hdr.base, size);
+	POLAR_XLOG_DECODED_RELOCATE(decoded->polar_xlog_meta, decoded, hdr.base, size);
+	POLAR_ASSERT_PANIC(decoded->max_block_id <= XLR_MAX_BLOCK_ID);
+	for (block_id = 0; block_id <= decoded->max_block_id; block_id++)
+	{
+		DecodedBkpBlock *blk = &decoded->blocks[block_id];
+
+		if (!blk->in_use)
+			continue;
+
+		POLAR_XLOG_DECODED_RELOCATE(blk->bkp_image, decoded, hdr.base, size);
+		POLAR_XLOG_DECODED_RELOCATE(blk->data, decoded, hdr.base, size);
+	}
+
+	/* Record the location of the next record. */
+	decoded->next_lsn = state->NextRecPtr;
+
+	pg_atomic_fetch_add_u64(&polar_logindex_redo_instance->parse_stat.decoded_ahead_used, 1);
+
+	return polar_xlog_queue_enqueue_decoded(state, decoded);
+}
+
 static DecodedXLogRecord *
 polar_xlog_queue_pop_record(polar_ringbuf_ref_t *ref, uint32 pktlen, XLogReaderState *state, bool decode_payload)
 {
@@ -922,9 +1097,18 @@ polar_xlog_queue_pop_record(polar_ringbuf_ref_t *ref, uint32 pktlen, XLogReaderS
 		 * words, state->currRecPtr may be lower than read_rec_ptr.
 		 */
 		if (likely(read_rec_ptr >= state->currRecPtr))
-			decode_record = polar_xlog_queue_decode_record(ref, offset, pktlen,
-														   read_rec_ptr, end_rec_ptr,
-														   state, decode_payload);
+		{
+			/* POLAR: take the record from decode queue if it's decoded ahead */
+			if (decode_queue_ref.slot != -1)
+				decode_record = polar_xlog_decode_queue_pop(ref, offset, pktlen,
+															read_rec_ptr, end_rec_ptr,
+															state);
+
+			if (decode_record == NULL)
+				decode_record = polar_xlog_queue_decode_record(ref, offset, pktlen,
+															   read_rec_ptr, end_rec_ptr,
+															   state, decode_payload);
+		}
 		polar_ringbuf_update_ref(ref);
 	}
 	while (decode_record == NULL && polar_ringbuf_avail(ref) > 0 &&
@@ -1375,6 +1559,7 @@ polar_xlog_recv_queue_push(polar_ringbuf_t queue, char *buf, size_t len, polar_i
 {
 	size_t		idx;
 	ssize_t		copy_len = 0;
+	Latch	   *decode_worker_latch;
 
 	do
 	{
@@ -1431,6 +1616,11 @@ polar_xlog_recv_queue_push(polar_ringbuf_t queue, char *buf, size_t len, polar_i
 							   idx, queue->size, len, copy_len)));
 	}
 
+	/* POLAR: wake up decode worker to decode them ahead */
+	decode_worker_latch = polar_logindex_redo_instance->decode_worker_latch;
+	if (decode_worker_latch != NULL)
+		SetLatch(decode_worker_latch);
+
 	return true;
 }
 
@@ -1462,6 +1652,15 @@ polar_xlog_recv_queue_pop_ahead(polar_ringbuf_t queue, XLogReaderState *state)
 		.slot = -1
 	};
 	XLogRecPtr	RecPtr = state->NextRecPtr;
+	polar_logindex_parse_stat_t *stat = &polar_logindex_redo_instance->parse_stat;
+	instr_time	start;
+	instr_time	wait_start;
+	instr_time	wait_time;
+	instr_time	duration;
+
+	if (polar_logindex_track_parse_timing)
+		INSTR_TIME_SET_CURRENT(start);
+	INSTR_TIME_SET_ZERO(wait_time);
 
 	if (unlikely(ref.slot == -1))
 	{
@@ -1524,6 +1723,7 @@ polar_xlog_recv_queue_pop_ahead(polar_ringbuf_t queue, XLogReaderState *state)
 
 				polar_ringbuf_release_ref(&ref);
 				ref.slot = -1;
+				polar_xlog_decode_terminate_worker();
 				break;
 			}
 			else if (!WalRcvStreaming())
@@ -1551,7 +1751,14 @@ polar_xlog_recv_queue_pop_ahead(polar_ringbuf_t queue, XLogReaderState *state)
 					 POLAR_XLOG_READER_STATE_ARGS(state), xlog_queue_catch_up, state->errormsg_buf);
 			}
 
+			if (polar_logindex_track_parse_timing)
+				INSTR_TIME_SET_CURRENT(wait_start);
 			polar_wait_primary_xlog_message(state);
+			if (polar_logindex_track_parse_timing)
+			{
+				INSTR_TIME_SET_CURRENT(duration);
+				INSTR_TIME_ACCUM_DIFF(wait_time, duration, wait_start);
+			}
 		}
 	}
 
@@ -1563,6 +1770,16 @@ polar_xlog_recv_queue_pop_ahead(polar_ringbuf_t queue, XLogReaderState *state)
 				 POLAR_XLOG_READER_STATE_ARGS(state));
 		}
 
+		if (polar_logindex_track_parse_timing)
+		{
+			INSTR_TIME_SET_CURRENT(duration);
+			INSTR_TIME_SUBTRACT(duration, start);
+			INSTR_TIME_SUBTRACT(duration, wait_time);
+			pg_atomic_fetch_add_u64(&stat->decode_us, INSTR_TIME_GET_MICROSEC(duration));
+		}
+		pg_atomic_fetch_add_u64(&stat->decoded_records, 1);
+		pg_atomic_write_u64(&stat->decoded_lsn, state->NextRecPtr);
+
 		polar_update_receipt_time();
 
 		/*
@@ -1628,3 +1845,286 @@ polar_xlog_recv_queue_pop_record(XLogReaderState *state, char **errormsg)
 
 	return NULL;
 }
+
+/* Reference of decode worker to xlog queue, and where it decoded to */
+static polar_ringbuf_ref_t decode_worker_ref =
+{
+	.slot = -1
+};
+static XLogRecPtr decode_worker_next_lsn = InvalidXLogRecPtr;
+static DecodedXLogRecord *decode_worker_buf = NULL;
+static Size decode_worker_buf_size = 0;
+
+/*
+ * Decode a batch of records in xlog queue and push them to decode queue.
+ * Decode worker holds a weak reference to xlog queue, so wal receiver never
+ * waits for it but evicts it. Return the number of packets it's done with.
+ */
+static int
+polar_xlog_decode_ahead(XLogReaderState *state)
+{
+	polar_ringbuf_ref_t *ref = &decode_worker_ref;
+	polar_ringbuf_t decode_queue = polar_logindex_redo_instance->decode_queue;
+	polar_logindex_parse_stat_t *stat = &polar_logindex_redo_instance->parse_stat;
+	XLogRecPtr	skip_lsn;
+	int			done = 0;
+	uint64		decoded_records = 0;
+	instr_time	start;
+	instr_time	duration;
+
+	if (ref->slot == -1 || !polar_ringbuf_get_ref(ref))
+	{
+		if (!polar_ringbuf_new_ref(polar_logindex_redo_instance->xlog_queue, false,
+								   ref, "decode_worker_ref"))
+			return 0;
+
+		polar_ringbuf_auto_release_ref(ref);
+
+		if (!polar_ringbuf_get_ref(ref))
+			return 0;
+	}
+
+	if (polar_logindex_track_parse_timing)
+		INSTR_TIME_SET_CURRENT(start);
+
+	/* Records decoded by startup process are of no use */
+	skip_lsn = Max(decode_worker_next_lsn, pg_atomic_read_u64(&stat->decoded_lsn));
+
+	while (done < POLAR_XLOG_DECODE_AHEAD_BATCH && polar_ringbuf_avail(ref) > 0)
+	{
+		uint32		pktlen;
+		uint8		pkt_type = polar_ringbuf_next_ready_pkt(ref, &pktlen);
+		ssize_t		offset = 0;
+		XLogRecPtr	read_rec_ptr,
+					end_rec_ptr;
+		uint32		xlog_len;
+		uint32		record_meta_len;
+		Size		required;
+		Size		decoded_pktlen;
+		size_t		idx;
+		polar_xlog_decoded_hdr_t hdr;
+
+		if (pkt_type == POLAR_RINGBUF_PKT_INVALID_TYPE)
+			break;
+
+		if (pkt_type != POLAR_RINGBUF_PKT_WAL_META)
+		{
+			polar_ringbuf_update_ref(ref);
+			done++;
+			continue;
+		}
+
+		POLAR_COPY_QUEUE_CONTENT(ref, offset, &end_rec_ptr, sizeof(XLogRecPtr));
+		POLAR_COPY_QUEUE_CONTENT(ref, offset, &xlog_len, sizeof(uint32));
+		read_rec_ptr = end_rec_ptr - xlog_len;
+		record_meta_len = pktlen - POLAR_XLOG_HEAD_SIZE;
+		required = DecodeXLogRecordRequiredSpace(record_meta_len);
+		decoded_pktlen = POLAR_XLOG_DECODED_PKT_SIZE(record_meta_len);
+
+		if (read_rec_ptr < skip_lsn || decoded_pktlen >= decode_queue->size / 2)
+		{
+			polar_ringbuf_update_ref(ref);
+			done++;
+			continue;
+		}
+
+		if (polar_ringbuf_free_size(decode_queue) < decoded_pktlen)
+		{
+			polar_ringbuf_update_keep_data(decode_queue);
+
+			/* Startup process is behind, decode it next time */
+			if (polar_ringbuf_free_size(decode_queue) < decoded_pktlen)
+				break;
+		}
+
+		if (record_meta_len > state->readRecordBufSize)
+			allocate_recordbuf(state, record_meta_len);
+		POLAR_COPY_QUEUE_CONTENT(ref, offset, state->readRecordBuf, record_meta_len);
+
+		if (required > decode_worker_buf_size)
+		{
+			if (decode_worker_buf != NULL)
+				pfree(decode_worker_buf);
+			decode_worker_buf = palloc(required);
+			decode_worker_buf_size = required;
+		}
+
+		polar_xlog_queue_update_reader(state, read_rec_ptr, end_rec_ptr);
+		decode_worker_buf->size = required;
+		decode_worker_buf->oversized = false;
+
+		/* Leave it to startup process if it fails to decode */
+		if (polar_xlog_queue_decode(state, decode_worker_buf,
+									(XLogRecord *) state->readRecordBuf,
+									record_meta_len, true) &&
+			decode_worker_buf->size > 0 && decode_worker_buf->size <= required)
+		{
+			hdr.lsn = read_rec_ptr;
+			hdr.end_lsn = end_rec_ptr;
+			hdr.record_meta_len = record_meta_len;
+			hdr.base = (char *) decode_worker_buf;
+
+			idx = polar_ringbuf_pkt_reserve(decode_queue,
+											POLAR_RINGBUF_PKT_SIZE(sizeof(hdr) + decode_worker_buf->size));
+			polar_ringbuf_set_pkt_length(decode_queue, idx, sizeof(hdr) + decode_worker_buf->size);
+			polar_ringbuf_pkt_write(decode_queue, idx, 0, (uint8 *) &hdr, sizeof(hdr));
+			polar_ringbuf_pkt_write(decode_queue, idx, sizeof(hdr),
+									(uint8 *) decode_worker_buf, decode_worker_buf->size);
+			polar_ringbuf_set_pkt_flag(decode_queue, idx,
+									   POLAR_RINGBUF_PKT_WAL_DECODED | POLAR_RINGBUF_PKT_READY);
+			decoded_records++;
+		}
+
+		decode_worker_next_lsn = end_rec_ptr;
+		polar_ringbuf_update_ref(ref);
+		done++;
+	}
+
+	polar_ringbuf_clear_ref(ref);
+
+	if (decoded_records > 0)
+	{
+		if (polar_logindex_track_parse_timing)
+		{
+			INSTR_TIME_SET_CURRENT(duration);
+			INSTR_TIME_SUBTRACT(duration, start);
+			pg_atomic_fetch_add_u64(&stat->decode_ahead_us, INSTR_TIME_GET_MICROSEC(duration));
+		}
+		pg_atomic_fetch_add_u64(&stat->decoded_ahead_records, decoded_records);
+		pg_atomic_write_u64(&stat->decoded_ahead_lsn, decode_worker_next_lsn);
+	}
+
+	return done;
+}
+
+static void
+polar_xlog_decode_worker_shmem_exit(int code, Datum arg)
+{
+	polar_logindex_redo_instance->decode_worker_latch = NULL;
+}
+
+/*
+ * Main entry of logindex decode worker, it's launched by startup process of
+ * replica and decodes records in xlog queue ahead of startup process.
+ */
+void
+polar_xlog_decode_worker_main(Datum main_arg)
+{
+	XLogReaderState *state;
+
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGINT, SIG_IGN);
+	pqsignal(SIGTERM, SignalHandlerForShutdownRequest);
+	pqsignal(SIGUSR1, procsignal_sigusr1_handler);
+
+	BackgroundWorkerUnblockSignals();
+
+	POLAR_ASSERT_PANIC(polar_logindex_redo_instance &&
+					   polar_logindex_redo_instance->xlog_queue &&
+					   polar_logindex_redo_instance->decode_queue);
+
+	state = XLogReaderAllocate(wal_segment_size, NULL,
+							   XL_ROUTINE(.page_read = NULL,
+										  .segment_open = NULL,
+										  .segment_close = NULL),
+							   NULL);
+	if (state == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	before_shmem_exit(polar_xlog_decode_worker_shmem_exit, (Datum) 0);
+	polar_logindex_redo_instance->decode_worker_latch = MyLatch;
+
+	elog(LOG, "Start polar logindex decode worker");
+
+	for (;;)
+	{
+		ResetLatch(MyLatch);
+
+		HandleMainLoopInterrupts();
+
+		if (polar_xlog_decode_ahead(state) > 0)
+			continue;
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 10 /* ms */ ,
+						 WAIT_EVENT_LOGINDEX_DECODE_MAIN);
+	}
+}
+
+/*
+ * Startup process of replica launches decode worker when it begins to redo.
+ * Startup process decodes all records itself if it fails to launch it.
+ */
+void
+polar_xlog_decode_launch_worker(void)
+{
+	BackgroundWorker worker;
+	BgwHandleStatus status;
+	pid_t		pid;
+
+	if (polar_logindex_redo_instance == NULL ||
+		polar_logindex_redo_instance->decode_queue == NULL ||
+		!polar_is_replica())
+		return;
+
+	/* Decode worker begins to push packets from here */
+	POLAR_XLOG_QUEUE_NEW_REF(&decode_queue_ref, polar_logindex_redo_instance->decode_queue,
+							 true, "decode_queue_ref");
+
+	memset(&worker, 0, sizeof(BackgroundWorker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_notify_pid = MyProcPid;
+	sprintf(worker.bgw_library_name, "postgres");
+	sprintf(worker.bgw_function_name, "polar_xlog_decode_worker_main");
+	snprintf(worker.bgw_name, BGW_MAXLEN, POLAR_XLOG_DECODE_WORKER_NAME);
+	snprintf(worker.bgw_type, BGW_MAXLEN, POLAR_XLOG_DECODE_WORKER_NAME);
+
+	if (!RegisterDynamicBackgroundWorker(&worker, &decode_worker_handle))
+	{
+		ereport(LOG,
+				(errmsg("could not register logindex decode worker"),
+				 errhint("You may need to increase max_worker_processes.")));
+		polar_xlog_decode_terminate_worker();
+		return;
+	}
+
+	status = WaitForBackgroundWorkerStartup(decode_worker_handle, &pid);
+	if (status != BGWH_STARTED)
+	{
+		ereport(LOG,
+				(errmsg("could not start logindex decode worker")));
+		polar_xlog_decode_terminate_worker();
+		return;
+	}
+
+	elog(LOG, "Launch logindex decode worker, pid=%d", pid);
+}
+
+/*
+ * Stop decode worker and stop taking records from decode queue. It must be
+ * done before promoting, which resets xlog queue after all references are
+ * released.
+ */
+void
+polar_xlog_decode_terminate_worker(void)
+{
+	if (decode_worker_handle != NULL)
+	{
+		TerminateBackgroundWorker(decode_worker_handle);
+		(void) WaitForBackgroundWorkerShutdown(decode_worker_handle);
+		pfree(decode_worker_handle);
+		decode_worker_handle = NULL;
+	}
+
+	if (decode_queue_ref.slot != -1)
+	{
+		polar_ringbuf_release_ref(&decode_queue_ref);
+		decode_queue_ref.slot = -1;
+	}
+}
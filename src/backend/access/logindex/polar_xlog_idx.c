@@ -75,17 +75,17 @@ xlog_idx_fpsi_redo(polar_logindex_redo_ctl_t instance, XLogReaderState *record,
 	XLogRedoAction action = BLK_NOTFOUND;
 	BufferTag	tag0;
 	Page		page;
-	uint64		fullpage_no = 0;
+	polar_fullpage_slot_t slot;
 
 	POLAR_GET_LOG_TAG(record, tag0, 0);
 
 	if (BUFFERTAGS_EQUAL(*tag, tag0))
 	{
 		page = BufferGetPage(*buffer);
-		/* get fullpage_no from record */
-		memcpy(&fullpage_no, XLogRecGetData(record) + sizeof(PolarWalType), sizeof(uint64));
+		/* get fullpage slot from record */
+		polar_fullpage_get_slot(record, &slot);
 		/* read fullpage from file */
-		polar_read_fullpage(instance->fullpage_ctl, page, fullpage_no);
+		polar_read_fullpage(instance->fullpage_ctl, page, &slot);
 		action = BLK_RESTORED;
 	}
 
@@ -150,12 +150,12 @@ polar_xlog_idx_parse(polar_logindex_redo_ctl_t instance, XLogReaderState *record
 	}
 	else if (info == POLAR_WAL && *((PolarWalType *) XLogRecGetData(record)) == PWT_FPSI)
 	{
-		uint64		fullpage_no = 0;
+		polar_fullpage_slot_t slot;
 
-		/* get fullpage_no from record */
-		memcpy(&fullpage_no, XLogRecGetData(record) + sizeof(PolarWalType), sizeof(uint64));
+		/* get fullpage slot from record */
+		polar_fullpage_get_slot(record, &slot);
 		/* Update logindex max_fullpage_no */
-		polar_update_max_fullpage_no(instance->fullpage_ctl, fullpage_no);
+		polar_update_max_fullpage_no(instance->fullpage_ctl, &slot);
 		return true;
 	}
 
@@ -946,6 +946,9 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 												  "_bt_pagedel",
 												  ALLOCSET_DEFAULT_SIZES);
 
+	/* POLAR: read-ahead of bulk read, released when the scan is done */
+	vstate.read_ahead = polar_bulk_read_ahead_begin(CurrentMemoryContext);
+
 	/* Initialize vstate fields used by _bt_pendingfsm_finalize */
 	vstate.bufsize = 0;
 	vstate.maxbufsize = 0;
@@ -1008,6 +1011,7 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 	/* Set statistics num_pages field to final size of index */
 	stats->num_pages = num_pages;
 
+	polar_bulk_read_ahead_end(vstate.read_ahead);
 	MemoryContextDelete(vstate.pagedelcontext);
 
 	/*
@@ -1069,12 +1073,16 @@ backtrack:
 	{
 		int			maxBlockCount = nblocks - blkno;
 
+		polar_bulk_read_ahead(vstate->read_ahead, rel, MAIN_FORKNUM, blkno, nblocks,
+							  info->strategy);
 		buf = polar_bulk_read_buffer_extended(rel, MAIN_FORKNUM, blkno,
 											  RBM_NORMAL, info->strategy,
 											  maxBlockCount);
 	}
 	else
 	{
+		/* POLAR: we need the only pin of the page for cleanup lock */
+		polar_bulk_read_ahead_release(vstate->read_ahead, blkno);
 		buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
 								 info->strategy);
 	}
@@ -74,6 +74,7 @@
 #include "pg_trace.h"
 #include "pgstat.h"
 #include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/startup.h"
@@ -159,8 +160,16 @@ int			polar_wal_init_set_size = POLAR_DEFAULT_XLOG_FILL_ZERO_SIZE;
  * Number of WAL insertion locks to use. A higher value allows more insertions
  * to happen concurrently, but adds some CPU overhead to flushing the WAL,
  * which needs to iterate all the locks.
+ *
+ * POLAR: the number is decided by polar_xlog_insert_locks at startup, -1
+ * means it scales with the number of online CPUs.
  */
-#define NUM_XLOGINSERT_LOCKS  8
+int			polar_xlog_insert_locks = -1;
+
+/* POLAR: flush WAL for a group of committers by one leader */
+bool		polar_enable_wal_group_commit = false;
+
+#define NUM_XLOGINSERT_LOCKS  polar_xlog_insert_locks
 
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
@@ -405,6 +414,30 @@ typedef union WALInsertLockPadded
 	char		pad[PG_CACHE_LINE_SIZE];
 } WALInsertLockPadded;
 
+/*
+ * POLAR: a prev-link handed from one reserved record to the next one.
+ *
+ * Every inserter publishes the start of its record keyed by the end of it,
+ * and takes the entry keyed by its own start to learn the start of the
+ * previous record. endpos is 0 while the slot is free; startpos is stored
+ * plus one, so that 0 means it is not published yet. An entry lives only
+ * from the reservation of one record to the reservation of the next, so
+ * at most NUM_XLOGINSERT_LOCKS + 1 slots are in use at any time.
+ *
+ * When the logindex xlog queue is enabled, an inserter publishes its entry
+ * only after it has taken the previous one and reserved its queue packet, so
+ * the entries also hand the turn to reserve queue packets from one record to
+ * the next in byte position order.
+ */
+typedef struct XLogPrevLink
+{
+	pg_atomic_uint64 endpos;
+	pg_atomic_uint64 startpos;
+} XLogPrevLink;
+
+/* POLAR: spins before waiting for a prev-link sleeps between checks */
+#define POLAR_XLOG_PREV_LINK_SPINS	1000
+
 /*
  * Session status of running backup, used for sanity checks in SQL-callable
  * functions to start and stop backups.
@@ -416,24 +449,24 @@ static SessionBackupState sessionBackupState = SESSION_BACKUP_NONE;
  */
 typedef struct XLogCtlInsert
 {
-	slock_t		insertpos_lck;	/* protects CurrBytePos and PrevBytePos */
-
 	/*
 	 * CurrBytePos is the end of reserved WAL. The next record will be
-	 * inserted at that position. PrevBytePos is the start position of the
-	 * previously inserted (or rather, reserved) record - it is copied to the
-	 * prev-link of the next record. These are stored as "usable byte
-	 * positions" rather than XLogRecPtrs (see XLogBytePosToRecPtr()).
+	 * inserted at that position. It is stored as "usable byte position"
+	 * rather than XLogRecPtr (see XLogBytePosToRecPtr()).
+	 *
+	 * POLAR: CurrBytePos is advanced with an atomic fetch-add. The start
+	 * position of the previously reserved record, which is copied to the
+	 * prev-link of the next record, is handed over through PrevLinks instead
+	 * of being kept next to CurrBytePos.
 	 */
-	uint64		CurrBytePos;
-	uint64		PrevBytePos;
+	pg_atomic_uint64 CurrBytePos;
 
 	/*
-	 * Make sure the above heavily-contended spinlock and byte positions are
-	 * on their own cache line. In particular, the RedoRecPtr and full page
-	 * write variables below should be on a different cache line. They are
-	 * read on every WAL insertion, but updated rarely, and we don't want
-	 * those reads to steal the cache line containing Curr/PrevBytePos.
+	 * Make sure the above heavily-contended byte position is on its own
+	 * cache line. In particular, the RedoRecPtr and full page write
+	 * variables below should be on a different cache line. They are read on
+	 * every WAL insertion, but updated rarely, and we don't want those reads
+	 * to steal the cache line containing CurrBytePos.
 	 */
 	char		pad[PG_CACHE_LINE_SIZE];
 
@@ -465,6 +498,10 @@ typedef struct XLogCtlInsert
 	 * WAL insertion locks.
 	 */
 	WALInsertLockPadded *WALInsertLocks;
+
+	/* POLAR: prev-links of reserved records, see XLogPrevLink */
+	XLogPrevLink *PrevLinks;
+	uint32		PrevLinksMask;
 } XLogCtlInsert;
 
 /*
@@ -593,6 +630,15 @@ typedef struct XLogCtlData
 	 * to storage.
 	 */
 	XLogRecPtr	consistent_lsn;
+
+	/*
+	 * POLAR: histograms of WAL group flushes. polar_group_flush_size counts
+	 * groups by the number of members, polar_group_flush_wait counts members
+	 * by the microseconds they waited for the flush. Bucket i covers
+	 * [2^i, 2^(i+1)), the first one includes 0 and the last one is open.
+	 */
+	pg_atomic_uint64 polar_group_flush_size[POLAR_WAL_GROUP_SIZE_BUCKETS];
+	pg_atomic_uint64 polar_group_flush_wait[POLAR_WAL_GROUP_WAIT_BUCKETS];
 } XLogCtlData;
 
 static XLogCtlData *XLogCtl = NULL;
@@ -821,8 +867,8 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * record to the shared WAL buffer cache is a two-step process:
 	 *
 	 * 1. Reserve the right amount of space from the WAL. The current head of
-	 *	  reserved space is kept in Insert->CurrBytePos, and is protected by
-	 *	  insertpos_lck.
+	 *	  reserved space is kept in Insert->CurrBytePos, and is advanced
+	 *	  atomically.
 	 *
 	 * 2. Copy the record to the reserved WAL space. This involves finding the
 	 *	  correct WAL buffer containing the reserved space, and copying the
@@ -1100,6 +1146,113 @@ XLogInsertRecord(XLogRecData *rdata,
 	return EndPos;
 }
 
+/*
+ * POLAR: slot of the prev-link keyed by the given byte position.
+ */
+static inline uint32
+polar_xlog_prev_link_slot(uint64 bytepos)
+{
+	return (uint32) ((bytepos * UINT64CONST(0x9E3779B97F4A7C15)) >> 32) &
+		XLogCtl->Insert.PrevLinksMask;
+}
+
+/*
+ * POLAR: publish the start of the record reserved up to endbytepos, for the
+ * record that will be reserved right after it.
+ */
+static void
+polar_xlog_publish_prev_link(uint64 startbytepos, uint64 endbytepos)
+{
+	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	uint32		slot = polar_xlog_prev_link_slot(endbytepos);
+
+	Assert(endbytepos > startbytepos);
+
+	/* There are always free slots, see XLogPrevLink */
+	for (;;)
+	{
+		XLogPrevLink *link = &Insert->PrevLinks[slot];
+		uint64		expected = 0;
+
+		if (pg_atomic_read_u64(&link->endpos) == 0 &&
+			pg_atomic_compare_exchange_u64(&link->endpos, &expected, endbytepos))
+		{
+			pg_atomic_write_u64(&link->startpos, startbytepos + 1);
+			return;
+		}
+		slot = (slot + 1) & Insert->PrevLinksMask;
+	}
+}
+
+/*
+ * POLAR: wait a little for the previous record to be published. Its inserter
+ * may be waiting for space in the logindex xlog queue, which can take longer
+ * than a spinlock is allowed to be held, so we sleep rather than report a
+ * stuck spinlock.
+ */
+static inline void
+polar_xlog_prev_link_delay(int *spins)
+{
+	if (++(*spins) < POLAR_XLOG_PREV_LINK_SPINS)
+		pg_spin_delay();
+	else
+		pg_usleep(10);
+}
+
+/*
+ * POLAR: take the start of the record reserved up to startbytepos, waiting
+ * for its inserter to publish it.
+ */
+static uint64
+polar_xlog_take_prev_link(uint64 startbytepos)
+{
+	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	uint32		first = polar_xlog_prev_link_slot(startbytepos);
+	uint32		slot = first;
+	int			spins = 0;
+
+	for (;;)
+	{
+		XLogPrevLink *link = &Insert->PrevLinks[slot];
+
+		if (pg_atomic_read_u64(&link->endpos) == startbytepos)
+		{
+			uint64		prevbytepos;
+
+			pg_read_barrier();
+			while ((prevbytepos = pg_atomic_read_u64(&link->startpos)) == 0)
+				polar_xlog_prev_link_delay(&spins);
+
+			/* Free the slot, startpos must be cleared before it is reused */
+			pg_atomic_write_u64(&link->startpos, 0);
+			pg_write_barrier();
+			pg_atomic_write_u64(&link->endpos, 0);
+
+			return prevbytepos - 1;
+		}
+
+		slot = (slot + 1) & Insert->PrevLinksMask;
+		if (slot == first)
+			polar_xlog_prev_link_delay(&spins);
+	}
+}
+
+/*
+ * POLAR: reserve the logindex xlog queue packet of a record. The caller must
+ * have taken the prev-link of the record and not yet published its own, so
+ * that packets are reserved one at a time in byte position order.
+ */
+static size_t
+polar_xlog_queue_reserve_in_turn(uint32 polar_rbuf_len)
+{
+	polar_ringbuf_t queue = polar_logindex_redo_instance->xlog_queue;
+
+	while (!POLAR_XLOG_QUEUE_FREE_SIZE(queue, polar_rbuf_len))
+		POLAR_XLOG_QUEUE_FREE_UP(queue, polar_rbuf_len);
+
+	return POLAR_XLOG_QUEUE_RESERVE(queue, polar_rbuf_len);
+}
+
 /*
  * Reserves the right amount of space for a record of given size from the WAL.
  * *StartPos is set to the beginning of the reserved section, *EndPos to
@@ -1107,9 +1260,14 @@ XLogInsertRecord(XLogRecData *rdata,
  * used to set the xl_prev of this record.
  *
  * This is the performance critical part of XLogInsert that must be serialized
- * across backends. The rest can happen mostly in parallel. Try to keep this
- * section as short as possible, insertpos_lck can be heavily contended on a
- * busy system.
+ * across backends. The rest can happen mostly in parallel.
+ *
+ * POLAR: the reservation itself is a single atomic fetch-add on CurrBytePos,
+ * and the prev-link is handed over from the previous record through
+ * PrevLinks. When the logindex xlog queue is enabled, the queue must be
+ * filled in LSN order, so the inserter also waits for the previous record to
+ * reserve its queue packet before reserving its own, and only then hands the
+ * turn to the next record.
  *
  * NB: The space calculation here must match the code in CopyXLogRecordToWAL,
  * where we actually copy the record to the reserved space.
@@ -1129,43 +1287,32 @@ ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 	Assert(size > SizeOfXLogRecord);
 
 	/*
-	 * The duration the spinlock needs to be held is minimized by minimizing
-	 * the calculations that have to be done while holding the lock. The
-	 * current tip of reserved WAL is kept in CurrBytePos, as a byte position
-	 * that only counts "usable" bytes in WAL, that is, it excludes all WAL
-	 * page headers. The mapping between "usable" byte positions and physical
-	 * positions (XLogRecPtrs) can be done outside the locked region, and
-	 * because the usable byte position doesn't include any headers, reserving
-	 * X bytes from WAL is almost as simple as "CurrBytePos += X".
+	 * The current tip of reserved WAL is kept in CurrBytePos, as a byte
+	 * position that only counts "usable" bytes in WAL, that is, it excludes
+	 * all WAL page headers. The mapping between "usable" byte positions and
+	 * physical positions (XLogRecPtrs) can be done outside the reservation,
+	 * and because the usable byte position doesn't include any headers,
+	 * reserving X bytes from WAL is as simple as "CurrBytePos += X".
 	 */
-	for (;;)
-	{
-		SpinLockAcquire(&Insert->insertpos_lck);
-
-		if (likely(polar_logindex_redo_instance))
-		{
-			if (!POLAR_XLOG_QUEUE_FREE_SIZE(polar_logindex_redo_instance->xlog_queue, polar_rbuf_len))
-			{
-				SpinLockRelease(&Insert->insertpos_lck);
-				POLAR_XLOG_QUEUE_FREE_UP(polar_logindex_redo_instance->xlog_queue, polar_rbuf_len);;
-				continue;
-			}
-			*polar_rbuf_pos = POLAR_XLOG_QUEUE_RESERVE(polar_logindex_redo_instance->xlog_queue, polar_rbuf_len);
-		}
-
-		startbytepos = Insert->CurrBytePos;
-		endbytepos = startbytepos + size;
-		prevbytepos = Insert->PrevBytePos;
-		Insert->CurrBytePos = endbytepos;
-		Insert->PrevBytePos = startbytepos;
-
-		SpinLockRelease(&Insert->insertpos_lck);
-		break;
-	}
+	startbytepos = pg_atomic_fetch_add_u64(&Insert->CurrBytePos, size);
+	endbytepos = startbytepos + size;
 
 	if (likely(polar_logindex_redo_instance))
+	{
+		/* Our turn to reserve the queue packet comes with the prev-link */
+		prevbytepos = polar_xlog_take_prev_link(startbytepos);
+		*polar_rbuf_pos = polar_xlog_queue_reserve_in_turn(polar_rbuf_len);
+		polar_xlog_publish_prev_link(startbytepos, endbytepos);
+
 		POLAR_XLOG_QUEUE_SET_PKT_LEN(polar_logindex_redo_instance->xlog_queue,
 									 *polar_rbuf_pos, polar_rbuf_len);
+	}
+	else
+	{
+		/* Publish ours first, our successor may already be waiting for it */
+		polar_xlog_publish_prev_link(startbytepos, endbytepos);
+		prevbytepos = polar_xlog_take_prev_link(startbytepos);
+	}
 
 	*StartPos = XLogBytePosToRecPtr(startbytepos);
 	*EndPos = XLogBytePosToEndRecPtr(endbytepos);
@@ -1202,59 +1349,47 @@ ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos, XLogRecPtr *PrevPtr,
 	uint32		segleft;
 
 	/*
-	 * These calculations are a bit heavy-weight to be done while holding a
-	 * spinlock, but since we're holding all the WAL insertion locks, there
-	 * are no other inserters competing for it. GetXLogInsertRecPtr() does
-	 * compete for it, but that's not called very frequently.
+	 * Since we're holding all the WAL insertion locks, there are no other
+	 * inserters competing for CurrBytePos, so it can be read and advanced
+	 * without an atomic read-modify-write. The previous record has reserved
+	 * its xlog queue packet and published its prev-link before its inserter
+	 * released the insertion lock, so it's our turn to reserve ours.
 	 */
-	for (;;)
-	{
-		SpinLockAcquire(&Insert->insertpos_lck);
+	Assert(holdingAllLocks);
 
-		startbytepos = Insert->CurrBytePos;
+	startbytepos = pg_atomic_read_u64(&Insert->CurrBytePos);
 
-		ptr = XLogBytePosToEndRecPtr(startbytepos);
-		if (XLogSegmentOffset(ptr, wal_segment_size) == 0)
-		{
-			SpinLockRelease(&Insert->insertpos_lck);
-			*EndPos = *StartPos = ptr;
-			return false;
-		}
-
-		if (likely(polar_logindex_redo_instance))
-		{
-			if (!POLAR_XLOG_QUEUE_FREE_SIZE(polar_logindex_redo_instance->xlog_queue, polar_rbuf_len))
-			{
-				SpinLockRelease(&Insert->insertpos_lck);
-				POLAR_XLOG_QUEUE_FREE_UP(polar_logindex_redo_instance->xlog_queue, polar_rbuf_len);
-				continue;
-			}
-			*polar_rbuf_pos = POLAR_XLOG_QUEUE_RESERVE(polar_logindex_redo_instance->xlog_queue, polar_rbuf_len);
-		}
-
-		endbytepos = startbytepos + size;
-		prevbytepos = Insert->PrevBytePos;
+	ptr = XLogBytePosToEndRecPtr(startbytepos);
+	if (XLogSegmentOffset(ptr, wal_segment_size) == 0)
+	{
+		*EndPos = *StartPos = ptr;
+		return false;
+	}
 
-		*StartPos = XLogBytePosToRecPtr(startbytepos);
-		*EndPos = XLogBytePosToEndRecPtr(endbytepos);
+	endbytepos = startbytepos + size;
 
-		segleft = wal_segment_size - XLogSegmentOffset(*EndPos, wal_segment_size);
-		if (segleft != wal_segment_size)
-		{
-			/* consume the rest of the segment */
-			*EndPos += segleft;
-			endbytepos = XLogRecPtrToBytePos(*EndPos);
-		}
-		Insert->CurrBytePos = endbytepos;
-		Insert->PrevBytePos = startbytepos;
+	*StartPos = XLogBytePosToRecPtr(startbytepos);
+	*EndPos = XLogBytePosToEndRecPtr(endbytepos);
 
-		SpinLockRelease(&Insert->insertpos_lck);
-		break;
+	segleft = wal_segment_size - XLogSegmentOffset(*EndPos, wal_segment_size);
+	if (segleft != wal_segment_size)
+	{
+		/* consume the rest of the segment */
+		*EndPos += segleft;
+		endbytepos = XLogRecPtrToBytePos(*EndPos);
 	}
+	pg_atomic_write_u64(&Insert->CurrBytePos, endbytepos);
+
+	prevbytepos = polar_xlog_take_prev_link(startbytepos);
 
 	if (likely(polar_logindex_redo_instance))
+	{
+		*polar_rbuf_pos = polar_xlog_queue_reserve_in_turn(polar_rbuf_len);
 		POLAR_XLOG_QUEUE_SET_PKT_LEN(polar_logindex_redo_instance->xlog_queue,
 									 *polar_rbuf_pos, polar_rbuf_len);
+	}
+
+	polar_xlog_publish_prev_link(startbytepos, endbytepos);
 
 	*PrevPtr = XLogBytePosToRecPtr(prevbytepos);
 
@@ -1560,9 +1695,7 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 		elog(PANIC, "cannot wait without a PGPROC structure");
 
 	/* Read the current insert position */
-	SpinLockAcquire(&Insert->insertpos_lck);
-	bytepos = Insert->CurrBytePos;
-	SpinLockRelease(&Insert->insertpos_lck);
+	bytepos = pg_atomic_read_u64(&Insert->CurrBytePos);
 	reservedUpto = XLogBytePosToEndRecPtr(bytepos);
 
 	/*
@@ -2642,6 +2775,192 @@ UpdateMinRecoveryPoint(XLogRecPtr lsn, bool force)
 	LWLockRelease(ControlFileLock);
 }
 
+/*
+ * POLAR: count a value into a log2 histogram of nbuckets.
+ */
+static inline void
+polar_wal_group_hist_add(pg_atomic_uint64 *hist, int nbuckets, uint64 value)
+{
+	int			bucket = value > 1 ? pg_leftmost_one_pos64(value) : 0;
+
+	pg_atomic_fetch_add_u64(&hist[Min(bucket, nbuckets - 1)], 1);
+}
+
+/*
+ * POLAR: flush WAL up to record together with other committers.
+ *
+ * Every caller pushes itself onto a lock-free list, in the same way as
+ * ProcArrayGroupClearXid(). The one who finds the list empty becomes the
+ * leader; the others sleep on their semaphores. The leader first waits for
+ * the WAL write in progress, if any, so that more followers can join while
+ * it lasts. Then it takes the whole list, waits for the insertions up to the
+ * largest LSN of the group, and writes and flushes them with one XLogWrite()
+ * call before waking the followers.
+ *
+ * The leader does not hold WALWriteLock while waiting for the insertions,
+ * because an inserter might need it to evict a WAL buffer.
+ *
+ * On return, the flush might still be short of record, e.g. if it is past the
+ * end of reserved WAL. The caller checks LogwrtResult again.
+ */
+static void
+polar_xlog_group_flush(XLogRecPtr record, TimeLineID insertTLI)
+{
+	PROC_HDR   *procglobal = ProcGlobal;
+	PGPROC	   *proc = MyProc;
+	uint32		nextidx;
+	uint32		wakeidx;
+	XLogRecPtr	grouprqst = InvalidXLogRecPtr;
+	int			groupsize = 0;
+	instr_time	start;
+	instr_time	duration;
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	/* Add ourselves to the list of processes needing a WAL flush */
+	proc->polarWalFlushGroupMember = true;
+	proc->polarWalFlushGroupLsn = record;
+	nextidx = pg_atomic_read_u32(&procglobal->polarWalFlushGroupFirst);
+	while (true)
+	{
+		pg_atomic_write_u32(&proc->polarWalFlushGroupNext, nextidx);
+
+		if (pg_atomic_compare_exchange_u32(&procglobal->polarWalFlushGroupFirst,
+										   &nextidx,
+										   (uint32) proc->pgprocno))
+			break;
+	}
+
+	/*
+	 * If the list was not empty, the leader will flush our WAL. It is
+	 * impossible to have followers without a leader because the first process
+	 * that has added itself to the list will always have nextidx as
+	 * INVALID_PGPROCNO.
+	 */
+	if (nextidx != INVALID_PGPROCNO)
+	{
+		int			extraWaits = 0;
+
+		/* Sleep until the leader flushes our WAL. */
+		pgstat_report_wait_start(WAIT_EVENT_POLAR_WAL_GROUP_FLUSH);
+		for (;;)
+		{
+			/* acts as a read barrier */
+			PGSemaphoreLock(proc->sem);
+			if (!proc->polarWalFlushGroupMember)
+				break;
+			extraWaits++;
+		}
+		pgstat_report_wait_end();
+
+		Assert(pg_atomic_read_u32(&proc->polarWalFlushGroupNext) == INVALID_PGPROCNO);
+
+		/* Fix semaphore count for any absorbed wakeups */
+		while (extraWaits-- > 0)
+			PGSemaphoreUnlock(proc->sem);
+
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+		polar_wal_group_hist_add(XLogCtl->polar_group_flush_wait,
+								 POLAR_WAL_GROUP_WAIT_BUCKETS,
+								 INSTR_TIME_GET_MICROSEC(duration));
+		return;
+	}
+
+	/* We are the leader. Let followers gather while WAL is being written. */
+	if (LWLockAcquireOrWait(WALWriteLock, LW_EXCLUSIVE))
+		LWLockRelease(WALWriteLock);
+
+	/*
+	 * Now that we've waited, clear the list and take everyone who joined so
+	 * far as the group.
+	 */
+	nextidx = pg_atomic_exchange_u32(&procglobal->polarWalFlushGroupFirst,
+									 INVALID_PGPROCNO);
+
+	/* Remember head of list so we can perform wakeups after flushing. */
+	wakeidx = nextidx;
+
+	while (nextidx != INVALID_PGPROCNO)
+	{
+		PGPROC	   *member = &ProcGlobal->allProcs[nextidx];
+
+		grouprqst = Max(grouprqst, member->polarWalFlushGroupLsn);
+		groupsize++;
+		nextidx = pg_atomic_read_u32(&member->polarWalFlushGroupNext);
+	}
+
+	/* Piggyback any WAL others asked to write, as XLogFlush() does */
+	SpinLockAcquire(&XLogCtl->info_lck);
+	if (grouprqst < XLogCtl->LogwrtRqst.Write)
+		grouprqst = XLogCtl->LogwrtRqst.Write;
+	LogwrtResult = XLogCtl->LogwrtResult;
+	SpinLockRelease(&XLogCtl->info_lck);
+
+	if (grouprqst > LogwrtResult.Flush)
+	{
+		XLogRecPtr	insertpos;
+
+		insertpos = WaitXLogInsertionsToFinish(grouprqst);
+
+		LWLockAcquire(WALWriteLock, LW_EXCLUSIVE);
+		LogwrtResult = XLogCtl->LogwrtResult;
+		if (insertpos > LogwrtResult.Flush)
+		{
+			XLogwrtRqst WriteRqst;
+
+			WriteRqst.Write = insertpos;
+			WriteRqst.Flush = insertpos;
+			XLogWrite(WriteRqst, insertTLI, false);
+		}
+		LWLockRelease(WALWriteLock);
+	}
+
+	polar_wal_group_hist_add(XLogCtl->polar_group_flush_size,
+							 POLAR_WAL_GROUP_SIZE_BUCKETS, groupsize);
+
+	/*
+	 * Now that we've released the lock, go back and wake everybody up.  We
+	 * don't do this under the lock so as to keep lock hold times to a
+	 * minimum.
+	 */
+	while (wakeidx != INVALID_PGPROCNO)
+	{
+		PGPROC	   *member = &ProcGlobal->allProcs[wakeidx];
+
+		wakeidx = pg_atomic_read_u32(&member->polarWalFlushGroupNext);
+		pg_atomic_write_u32(&member->polarWalFlushGroupNext, INVALID_PGPROCNO);
+
+		/* ensure all previous writes are visible before follower continues. */
+		pg_write_barrier();
+
+		member->polarWalFlushGroupMember = false;
+
+		if (member != MyProc)
+			PGSemaphoreUnlock(member->sem);
+	}
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	polar_wal_group_hist_add(XLogCtl->polar_group_flush_wait,
+							 POLAR_WAL_GROUP_WAIT_BUCKETS,
+							 INSTR_TIME_GET_MICROSEC(duration));
+}
+
+/*
+ * POLAR: copy out the histograms of WAL group flushes.
+ */
+void
+polar_get_wal_group_commit_stats(uint64 *size_hist, uint64 *wait_hist)
+{
+	int			i;
+
+	for (i = 0; i < POLAR_WAL_GROUP_SIZE_BUCKETS; i++)
+		size_hist[i] = pg_atomic_read_u64(&XLogCtl->polar_group_flush_size[i]);
+	for (i = 0; i < POLAR_WAL_GROUP_WAIT_BUCKETS; i++)
+		wait_hist[i] = pg_atomic_read_u64(&XLogCtl->polar_group_flush_wait[i]);
+}
+
 /*
  * Ensure that all XLOG data through the given position is flushed to disk.
  *
@@ -2693,6 +3012,14 @@ XLogFlush(XLogRecPtr record)
 	/* initialize to given target; may increase below */
 	WriteRqstPtr = record;
 
+	/*
+	 * POLAR: let one leader flush for the whole group of committers, the
+	 * loop below finds the record flushed then. It needs a semaphore to
+	 * sleep on.
+	 */
+	if (polar_enable_wal_group_commit && MyProc != NULL)
+		polar_xlog_group_flush(record, insertTLI);
+
 	/*
 	 * Now wait until we get the write lock, or someone else does the flush
 	 * for us.
@@ -4514,6 +4841,36 @@ XLOGChooseNumBuffers(void)
 	return xbuffers;
 }
 
+/*
+ * POLAR: auto-tune the number of WAL insertion locks, about one for every two
+ * online CPUs. Concurrent inserters rarely exceed that, and every lock adds
+ * some cost to WaitXLogInsertionsToFinish().
+ */
+static int
+polar_xlog_choose_insert_locks(void)
+{
+	int			nlocks = 8;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	long		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (ncpus > 0)
+		nlocks = Max(nlocks, (int) Min(ncpus / 2, POLAR_XLOG_INSERT_LOCKS_AUTO_MAX));
+#endif
+
+	return nlocks;
+}
+
+/*
+ * POLAR: number of prev-link slots. At most NUM_XLOGINSERT_LOCKS + 1 are in
+ * use, keep the table sparse so that lookups rarely probe more than once.
+ */
+static uint32
+polar_xlog_prev_links(void)
+{
+	return pg_nextpower2_32((NUM_XLOGINSERT_LOCKS + 1) * 4);
+}
+
 /*
  * GUC check_hook for wal_buffers
  */
@@ -4549,6 +4906,25 @@ check_wal_buffers(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+/*
+ * POLAR: GUC check_hook for polar_xlog_insert_locks
+ *
+ * -1 is the auto-tune request handled in XLOGShmemSize, 0 would leave no
+ * insertion lock to pick by MyProc->pgprocno.
+ */
+bool
+check_polar_xlog_insert_locks(int *newval, void **extra, GucSource source)
+{
+	if (*newval == 0)
+	{
+		GUC_check_errdetail("\"polar_xlog_insert_locks\" must be -1 or between 1 and %d.",
+							POLAR_XLOG_INSERT_LOCKS_MAX);
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * Read the control file, set respective GUCs.
  *
@@ -4601,11 +4977,27 @@ XLOGShmemSize(void)
 	}
 	Assert(XLOGbuffers > 0);
 
+	/* POLAR: same for polar_xlog_insert_locks */
+	if (polar_xlog_insert_locks == -1)
+	{
+		char		buf[32];
+
+		snprintf(buf, sizeof(buf), "%d", polar_xlog_choose_insert_locks());
+		SetConfigOption("polar_xlog_insert_locks", buf, PGC_POSTMASTER,
+						PGC_S_DYNAMIC_DEFAULT);
+		if (polar_xlog_insert_locks == -1)	/* failed to apply it? */
+			SetConfigOption("polar_xlog_insert_locks", buf, PGC_POSTMASTER,
+							PGC_S_OVERRIDE);
+	}
+	Assert(NUM_XLOGINSERT_LOCKS > 0);
+
 	/* XLogCtl */
 	size = sizeof(XLogCtlData);
 
 	/* WAL insertion locks, plus alignment */
 	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	/* POLAR: prev-links of reserved records */
+	size = add_size(size, mul_size(sizeof(XLogPrevLink), polar_xlog_prev_links()));
 	/* xlblocks array */
 	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
@@ -4705,6 +5097,16 @@ XLOGShmemInit(void)
 		WALInsertLocks[i].l.lastImportantAt = InvalidXLogRecPtr;
 	}
 
+	/* POLAR: prev-links of reserved records, all free */
+	XLogCtl->Insert.PrevLinks = (XLogPrevLink *) allocptr;
+	XLogCtl->Insert.PrevLinksMask = polar_xlog_prev_links() - 1;
+	for (i = 0; i < polar_xlog_prev_links(); i++)
+	{
+		pg_atomic_init_u64(&XLogCtl->Insert.PrevLinks[i].endpos, 0);
+		pg_atomic_init_u64(&XLogCtl->Insert.PrevLinks[i].startpos, 0);
+	}
+	allocptr += sizeof(XLogPrevLink) * polar_xlog_prev_links();
+
 	/*
 	 * Align the start of the page buffers to a full xlog block size boundary.
 	 * This simplifies some calculations in XLOG insertion. It is also
@@ -4729,7 +5131,11 @@ XLOGShmemInit(void)
 	/* POLAR: Init available state. */
 	XLogCtl->polar_available_state = true;
 
-	SpinLockInit(&XLogCtl->Insert.insertpos_lck);
+	pg_atomic_init_u64(&XLogCtl->Insert.CurrBytePos, 0);
+	for (i = 0; i < POLAR_WAL_GROUP_SIZE_BUCKETS; i++)
+		pg_atomic_init_u64(&XLogCtl->polar_group_flush_size[i], 0);
+	for (i = 0; i < POLAR_WAL_GROUP_WAIT_BUCKETS; i++)
+		pg_atomic_init_u64(&XLogCtl->polar_group_flush_wait[i], 0);
 	SpinLockInit(&XLogCtl->info_lck);
 	SpinLockInit(&XLogCtl->ulsn_lck);
 }
@@ -5734,8 +6140,11 @@ StartupXLOG(void)
 	 * previous incarnation.
 	 */
 	Insert = &XLogCtl->Insert;
-	Insert->PrevBytePos = XLogRecPtrToBytePos(endOfRecoveryInfo->lastRec);
-	Insert->CurrBytePos = XLogRecPtrToBytePos(EndOfLog);
+	pg_atomic_write_u64(&Insert->CurrBytePos, XLogRecPtrToBytePos(EndOfLog));
+
+	/* POLAR: hand the last record over to the first one we insert */
+	polar_xlog_publish_prev_link(XLogRecPtrToBytePos(endOfRecoveryInfo->lastRec),
+								 XLogRecPtrToBytePos(EndOfLog));
 
 	/*
 	 * Tricky point here: lastPage contains the *last* block that the LastRec
@@ -5778,18 +6187,17 @@ StartupXLOG(void)
 	XLogCtl->LogwrtRqst.Flush = EndOfLog;
 
 	/* POLAR: make sure some important LSNs are expected. */
-	if (unlikely(Insert->PrevBytePos < XLogRecPtrToBytePos(endOfRecoveryInfo->lastRec) ||
-				 Insert->CurrBytePos <= XLogRecPtrToBytePos(endOfRecoveryInfo->lastRec) ||
+	if (unlikely(pg_atomic_read_u64(&Insert->CurrBytePos) <= XLogRecPtrToBytePos(endOfRecoveryInfo->lastRec) ||
 				 XLogCtl->LogwrtResult.Flush <= endOfRecoveryInfo->lastRec ||
 				 XLogCtl->LogwrtResult.Write <= endOfRecoveryInfo->lastRec ||
 				 XLogCtl->LogwrtRqst.Flush <= endOfRecoveryInfo->lastRec ||
 				 XLogCtl->LogwrtRqst.Write <= endOfRecoveryInfo->lastRec))
 		elog(PANIC, "Something wrong for these important LSNs: " \
-			 "PrevBytePos is 0x%lX, CurrBytePos is 0x%lX, " \
+			 "CurrBytePos is 0x%lX, " \
 			 "LogwrtResult.Flush is %X/%X, LogwrtResult.Write is %X/%X, " \
 			 "LogwrtRqst.Flush is %X/%X, LogwrtRqst.Write is %X/%X, " \
 			 "LastRec is %X/%X, last usable byte position is 0x%lX",
-			 Insert->PrevBytePos, Insert->CurrBytePos, LSN_FORMAT_ARGS(XLogCtl->LogwrtResult.Flush),
+			 pg_atomic_read_u64(&Insert->CurrBytePos), LSN_FORMAT_ARGS(XLogCtl->LogwrtResult.Flush),
 			 LSN_FORMAT_ARGS(XLogCtl->LogwrtResult.Write), LSN_FORMAT_ARGS(XLogCtl->LogwrtRqst.Flush),
 			 LSN_FORMAT_ARGS(XLogCtl->LogwrtRqst.Write), LSN_FORMAT_ARGS(endOfRecoveryInfo->lastRec),
 			 XLogRecPtrToBytePos(endOfRecoveryInfo->lastRec));
@@ -6774,7 +7182,7 @@ CreateCheckPoint(int flags)
 	 * determine the checkpoint REDO pointer.
 	 */
 	WALInsertLockAcquireExclusive();
-	curInsert = XLogBytePosToRecPtr(Insert->CurrBytePos);
+	curInsert = XLogBytePosToRecPtr(pg_atomic_read_u64(&Insert->CurrBytePos));
 
 	/*
 	 * POLAR: we store the end of last record for shutdown checkpoint. When
@@ -6785,7 +7193,7 @@ CreateCheckPoint(int flags)
 	 * info, that will cause the XLogFlush raise a FATAL, like 'xlog flush
 	 * request ... is not satisfied --- flushed only to ...'.
 	 */
-	polar_last_lsn = XLogBytePosToEndRecPtr(Insert->CurrBytePos);
+	polar_last_lsn = XLogBytePosToEndRecPtr(pg_atomic_read_u64(&Insert->CurrBytePos));
 
 	/* POLAR: use incremental redo lsn as the checkpoint redo. */
 	if (polar_is_inc)
@@ -7440,7 +7848,7 @@ CreateRestartPoint(int flags)
 	 * buffer. If there's no one suitable CheckPoint in checkpoint ring
 	 * buffer, then just return invalid CheckPoint.
 	 */
-	if (POLAR_IN_PARALLEL_REPLAY_STANDBY_MODE(polar_logindex_redo_instance))
+	if (POLAR_IN_PARALLEL_REPLAY_MODE(polar_logindex_redo_instance))
 		polar_checkpoint_ringbuf_check(&lastCheckPointRecPtr, &lastCheckPointEndPtr, &lastCheckPoint);
 
 	/*
@@ -8415,12 +8823,12 @@ xlog_redo(XLogReaderState *record)
 				{
 					if (POLAR_LOGINDEX_ENABLE_FULLPAGE())
 					{
-						uint64		fullpage_no = 0;
+						polar_fullpage_slot_t slot;
 
-						/* get fullpage_no from record */
-						memcpy(&fullpage_no, XLogRecGetData(record) + sizeof(PolarWalType), sizeof(uint64));
+						/* get fullpage slot from record */
+						polar_fullpage_get_slot(record, &slot);
 						/* Update max_fullpage_no */
-						polar_update_max_fullpage_no(polar_logindex_redo_instance->fullpage_ctl, fullpage_no);
+						polar_update_max_fullpage_no(polar_logindex_redo_instance->fullpage_ctl, &slot);
 					}
 					break;
 				}
@@ -9507,9 +9915,7 @@ GetXLogInsertRecPtr(void)
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
 	uint64		current_bytepos;
 
-	SpinLockAcquire(&Insert->insertpos_lck);
-	current_bytepos = Insert->CurrBytePos;
-	SpinLockRelease(&Insert->insertpos_lck);
+	current_bytepos = pg_atomic_read_u64(&Insert->CurrBytePos);
 
 	return XLogBytePosToRecPtr(current_bytepos);
 }
@@ -9518,7 +9924,7 @@ XLogRecPtr
 polar_get_xlog_insert_ptr_nolock(void)
 {
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
-	uint64		current_bytepos = Insert->CurrBytePos;
+	uint64		current_bytepos = pg_atomic_read_u64(&Insert->CurrBytePos);
 
 	return XLogBytePosToRecPtr(current_bytepos);
 }
@@ -9892,9 +10298,7 @@ polar_get_fake_latest_lsn(void)
 	XLogCtlInsert *insert = &XLogCtl->Insert;
 
 	/* Read the current insert position */
-	SpinLockAcquire(&insert->insertpos_lck);
-	bytepos = insert->CurrBytePos;
-	SpinLockRelease(&insert->insertpos_lck);
+	bytepos = pg_atomic_read_u64(&insert->CurrBytePos);
 
 	return XLogBytePosToEndRecPtr(bytepos);
 }
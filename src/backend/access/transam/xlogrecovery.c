@@ -64,6 +64,7 @@
 
 /* POLAR */
 #include "access/polar_logindex_redo.h"
+#include "access/polar_queue_manager.h"
 #include "postmaster/polar_async_lock_replay.h"
 #include "storage/polar_fd.h"
 #include "storage/polar_xlogbuf.h"
@@ -1717,6 +1718,9 @@ PerformWalRecovery(void)
 	/* POLAR */
 	XLogRecPtr	xlog_read_from,
 				redo_start_lsn;
+	uint64		replayed_records = 0;
+	instr_time	redo_start_time,
+				redo_time;
 
 	/* POLAR end */
 
@@ -1834,6 +1838,9 @@ PerformWalRecovery(void)
 		/* POLAR: Launch async lock replay worker if possible */
 		polar_alr_launch_worker();
 
+		/* POLAR: Launch logindex decode worker if possible */
+		polar_xlog_decode_launch_worker();
+
 		InRedo = true;
 
 		RmgrStartup();
@@ -1842,6 +1849,10 @@ PerformWalRecovery(void)
 				(errmsg("redo starts at %X/%X",
 						LSN_FORMAT_ARGS(xlogreader->ReadRecPtr))));
 
+		/* POLAR: dispatch page records to parallel replay processes */
+		polar_logindex_start_parallel_recovery(polar_logindex_redo_instance, redo_start_lsn);
+		INSTR_TIME_SET_CURRENT(redo_start_time);
+
 		/* Prepare to report progress of the redo phase. */
 		if (!StandbyMode)
 			begin_startup_progress_phase();
@@ -1924,6 +1935,7 @@ PerformWalRecovery(void)
 			 * Apply the record
 			 */
 			ApplyWalRecord(xlogreader, record, &replayTLI, redo_start_lsn);
+			replayed_records++;
 
 			/* Exit loop if we reached inclusive recovery target */
 			if (recoveryStopsAfter(xlogreader))
@@ -1945,6 +1957,27 @@ PerformWalRecovery(void)
 		/* POLAR: stop async lock replay worker if possible */
 		polar_alr_terminate_worker();
 
+		/* POLAR: stop logindex decode worker if possible */
+		polar_xlog_decode_terminate_worker();
+
+		/* POLAR: all page records must be replayed before leaving redo */
+		polar_logindex_finish_parallel_recovery(polar_logindex_redo_instance,
+												&XLogRecoveryCtl->recoveryWakeupLatch);
+
+		/* POLAR: report recovery throughput */
+		INSTR_TIME_SET_CURRENT(redo_time);
+		INSTR_TIME_SUBTRACT(redo_time, redo_start_time);
+		if (!StandbyMode && INSTR_TIME_GET_DOUBLE(redo_time) > 0)
+		{
+			double		redo_secs = INSTR_TIME_GET_DOUBLE(redo_time);
+			double		redo_mb = (double) (GetXLogReplayRecPtr(NULL) - redo_start_lsn) / (1024 * 1024);
+
+			ereport(LOG,
+					(errmsg("redo replayed " UINT64_FORMAT " records, %.2f MB in %.3f s, %.0f records/s, %.2f MB/s",
+							replayed_records, redo_mb, redo_secs,
+							replayed_records / redo_secs, redo_mb / redo_secs)));
+		}
+
 		if (reachedRecoveryTarget)
 		{
 			if (!reachedConsistency)
@@ -3320,7 +3320,7 @@ dbase_redo(XLogReaderState *record)
 		 * database before FlushDatabaseBuffers, to ensure all blocks from
 		 * source database are at the latest state.
 		 */
-		if (POLAR_IN_PARALLEL_REPLAY_STANDBY_MODE(polar_logindex_redo_instance))
+		if (POLAR_IN_PARALLEL_REPLAY_MODE(polar_logindex_redo_instance))
 			polar_logindex_replay_db(polar_logindex_redo_instance, xlrec->src_db_id);
 
 		/*
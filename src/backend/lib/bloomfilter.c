@@ -39,7 +39,7 @@
 #include "lib/bloomfilter.h"
 #include "port/pg_bitutils.h"
 
-#define MAX_HASH_FUNCS		10
+#define MAX_HASH_FUNCS		POLAR_BLOOM_MAX_HASH_FUNCS
 
 struct bloom_filter
 {
@@ -324,3 +324,44 @@ polar_bloom_init_struct(uint8 *bloom_buf, size_t bloom_buf_size,
 
 	return filter;
 }
+
+/*
+ * POLAR: Prepare probe for elem so that it matches filter's shape.
+ *
+ * The hash values are only computed again when the probe was prepared for a
+ * filter with different seed, size or number of hash functions.
+ */
+void
+polar_bloom_prepare_probe(bloom_filter *filter, polar_bloom_probe *probe,
+						  unsigned char *elem, size_t len)
+{
+	if (probe->k_hash_funcs == filter->k_hash_funcs &&
+		probe->seed == filter->seed && probe->m == filter->m)
+		return;
+
+	k_hashes(filter, probe->hashes, elem, len);
+	probe->k_hash_funcs = filter->k_hash_funcs;
+	probe->seed = filter->seed;
+	probe->m = filter->m;
+}
+
+/*
+ * POLAR: Same as bloom_lacks_element, but use the hash values saved in probe,
+ * which must be prepared by polar_bloom_prepare_probe for this filter.
+ */
+bool
+polar_bloom_probe_lacks_element(bloom_filter *filter, polar_bloom_probe *probe)
+{
+	int			i;
+
+	Assert(probe->k_hash_funcs == filter->k_hash_funcs &&
+		   probe->seed == filter->seed && probe->m == filter->m);
+
+	for (i = 0; i < probe->k_hash_funcs; i++)
+	{
+		if (!(filter->bitset[probe->hashes[i] >> 3] & (1 << (probe->hashes[i] & 7))))
+			return true;
+	}
+
+	return false;
+}
@@ -38,6 +38,7 @@
 
 /* POLAR */
 #include "access/polar_logindex_redo.h"
+#include "access/polar_queue_manager.h"
 #include "postmaster/polar_async_lock_replay.h"
 #include "postmaster/polar_parallel_bgwriter.h"
 
@@ -141,6 +142,9 @@ static const struct
 	},
 	{
 		"polar_alr_worker_main", polar_alr_worker_main
+	},
+	{
+		"polar_xlog_decode_worker_main", polar_xlog_decode_worker_main
 	}
 	/* POLAR end */
 };
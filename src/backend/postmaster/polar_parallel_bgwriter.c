@@ -403,6 +403,9 @@ polar_parallel_bgwriter_worker_main(Datum main_arg)
 	POLAR_ASSERT_PANIC(slot > -1 && slot < MAX_NUM_OF_PARALLEL_BGWRITER);
 	polar_parallel_bgwriter_info->polar_flush_work_info[slot].latch = MyLatch;
 
+	/* Each worker owns one partition of the flush list */
+	polar_flush_list_set_own_partition(slot);
+
 	/*
 	 * Loop forever
 	 */
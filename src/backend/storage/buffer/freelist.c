@@ -605,6 +605,19 @@ GetAccessStrategy(BufferAccessStrategyType btype)
 	return strategy;
 }
 
+/*
+ * POLAR: GetAccessStrategyBufferCount -- number of buffers in the ring of a
+ * BufferAccessStrategy, 0 without a ring
+ */
+int
+GetAccessStrategyBufferCount(BufferAccessStrategy strategy)
+{
+	if (strategy == NULL)
+		return 0;
+
+	return strategy->ring_size;
+}
+
 /*
  * FreeAccessStrategy -- release a BufferAccessStrategy object
  *
@@ -28,6 +28,7 @@
 #include "access/timeline.h"
 #include "access/xlogrecovery.h"
 #include "access/xlog.h"
+#include "port/pg_bitutils.h"
 #include "postmaster/polar_parallel_bgwriter.h"
 #include "storage/polar_bufmgr.h"
 #include "storage/polar_copybuf.h"
@@ -49,18 +50,67 @@ extern void ResourceOwnerEnlargeBuffers(ResourceOwner owner);
 static int	prev_sync_count = 0;
 static int64 consistent_lsn_delta = 0;
 
-static void polar_sync_buffer_from_copy_buffer(WritebackContext *wb_context, int flags);
+static void polar_sync_buffer_from_copy_buffer(WritebackContext *wb_context, uint64 lag, int flags);
 static int	evaluate_sync_buffer_num(uint64 lag, int bgwriter_flush_batch_size);
 static XLogRecPtr update_consistent_lsn_delta(XLogRecPtr cur_consistent_lsn);
 static uint64 polar_consistent_lsn_lag(XLogRecPtr cur_consistent_lsn);
 static int	polar_get_lru_batch(int *next_flush_buf_id);
 
+/* POLAR: write combining of buffers got from flush list */
+typedef struct polar_write_combine_item
+{
+	BufferTag	tag;
+	int			buf_id;
+} polar_write_combine_item;
+
+static int	polar_write_combine_sync(int *batch_buf, int num,
+									 polar_write_combine_item *items,
+									 WritebackContext *wb_context, int flags);
+static int	polar_write_combine_run(polar_write_combine_item *items, int nitems,
+									WritebackContext *wb_context, int flags);
+static void polar_write_combine_count(int nblocks);
+
 /* POLAR: bulk io */
+static void polar_bulk_io_alloc_state(void);
 static Buffer polar_bulk_read_buffer_common(Relation reln, char relpersistence, ForkNumber forkNum,
 											BlockNumber firstBlockNum, ReadBufferMode mode,
 											BufferAccessStrategy strategy, bool *hit,
 											BlockNumber maxBlockCount);
 
+/*
+ * Buffers with IO_IN_PROGRESS of one bulk io at most, for the buffers claimed
+ * by polar_bulk_read_ahead_blocks() too.
+ */
+#define POLAR_BULK_IO_MAX_IN_PROGRESS	(POLAR_MAX_BULK_IO_SIZE * 16)
+
+/*
+ * A batch of asynchronous read-ahead of a polar_read_ahead_state. Its
+ * buffers are pinned but neither valid nor IO_IN_PROGRESS while the requests
+ * read into the private memory of the batch, so anyone who needs a block
+ * meanwhile just reads it like any other invalid buffer. The pins are kept
+ * by the resource owner like the other pins of the scan.
+ */
+struct polar_read_ahead_batch
+{
+	polar_read_ahead_batch *next;
+	int			nbufs;
+	int			nreqs;
+	int			nsubmitted;
+	int			nreleased;		/* requests whose buffers are released */
+	Buffer	   *buffers;
+	BlockNumber *blocks;
+	int		   *req_start;		/* first buffer of each request, and nbufs */
+	bool	   *released;		/* buffers of the request are released */
+	polar_aio_req *reqs;
+	char	   *data;
+	/* Only used by the batch whose pages are replayed, released right away */
+	SMgrRelation smgr;
+	ForkNumber	forkNum;
+	polar_redo_action redo_action;
+	XLogRecPtr	replay_from;
+	XLogRecPtr	checkpoint_redo_lsn;
+};
+
 /* POLAR end */
 
 /* Reset oldest lsn to invalid and remove it from flush list. */
@@ -134,8 +184,8 @@ polar_bg_buffer_sync(WritebackContext *wb_context, int flags)
 }
 
 /*
- * Calculate current consistent lsn, it is the minimum between first buffer of
- * flush list and all copy buffers. If oldest lsn of all buffers are invalid,
+ * Calculate current consistent lsn, it is the minimum between first buffers of
+ * all flush list partitions and all copy buffers. If oldest lsn of all buffers are invalid,
  * we use polar_max_valid_lsn(), which is: 1) current insert RecPtr when node is
  * not in recovery, because some commands generate wal records but do not set
  * any buffers oldest lsn. 2) current start RecPtr of the record being replayed
@@ -148,37 +198,42 @@ polar_bg_buffer_sync(WritebackContext *wb_context, int flags)
 XLogRecPtr
 polar_cal_cur_consistent_lsn(void)
 {
-	BufferDesc *buf;
 	XLogRecPtr	clsn;
 	XLogRecPtr	lsn;
+	XLogRecPtr	empty_lsn;
 
 	Assert(polar_flush_list_enabled());
 
-	SpinLockAcquire(&polar_flush_ctl->flushlist_lock);
-	if (polar_flush_list_is_empty())
-	{
-		if (unlikely(polar_bg_redo_state_is_parallel(polar_logindex_redo_instance)))
-			lsn = polar_logindex_replayed_oldest_lsn();
-		else if (unlikely(polar_should_launch_standby_instant_recovery()))
-			lsn = polar_bg_redo_get_replayed_lsn(polar_logindex_redo_instance);
-		else
-			lsn = polar_max_valid_lsn();
-		SpinLockRelease(&polar_flush_ctl->flushlist_lock);
+	/*
+	 * The flush list is partitioned, so calculate the lsn used for an empty
+	 * flush list before merging the partitions. Buffers appended while we are
+	 * merging never get an oldest lsn smaller than it, so the result is
+	 * clamped to it below.
+	 */
+	if (unlikely(polar_bg_redo_state_is_parallel(polar_logindex_redo_instance)))
+		empty_lsn = polar_logindex_replayed_oldest_lsn();
+	else if (unlikely(polar_should_launch_standby_instant_recovery()))
+		empty_lsn = polar_bg_redo_get_replayed_lsn(polar_logindex_redo_instance);
+	else
+		empty_lsn = polar_max_valid_lsn();
 
+	lsn = polar_flush_list_get_oldest_lsn(NULL);
+	if (XLogRecPtrIsInvalid(lsn))
+	{
 		if (unlikely(polar_enable_debug))
 			elog(DEBUG1,
 				 "The flush list is empty, so use current insert lsn %X/%X as consistent lsn.",
-				 LSN_FORMAT_ARGS(lsn));
+				 LSN_FORMAT_ARGS(empty_lsn));
 
-		return lsn;
+		return empty_lsn;
 	}
 
-	Assert(polar_flush_ctl->first_flush_buffer >= 0);
-
-	buf = GetBufferDescriptor(polar_flush_ctl->first_flush_buffer);
-	lsn = pg_atomic_read_u64((pg_atomic_uint64 *) &buf->oldest_lsn);
-
-	SpinLockRelease(&polar_flush_ctl->flushlist_lock);
+	/*
+	 * The partitions are merged one by one without lock, so a buffer appended
+	 * to an already-scanned partition is not seen here. Clamp to empty_lsn,
+	 * which is not larger than the oldest lsn of any such buffer.
+	 */
+	lsn = Min(lsn, empty_lsn);
 
 	clsn = polar_copy_buffers_get_oldest_lsn();
 	if (!XLogRecPtrIsInvalid(clsn))
@@ -515,6 +570,7 @@ polar_buffer_sync(WritebackContext *wb_context,
 {
 	static int	batch_buf_size = 0;
 	static int *batch_buf = NULL;
+	static polar_write_combine_item *combine_items = NULL;
 	XLogRecPtr	cur_consistent_lsn;
 	int			num_written = 0;
 	int			num_to_sync;
@@ -527,7 +583,12 @@ polar_buffer_sync(WritebackContext *wb_context,
 		if (batch_buf)
 			free(batch_buf);
 
+		if (combine_items)
+			free(combine_items);
+
 		batch_buf = (int *) malloc(polar_bgwriter_flush_batch_size * sizeof(int));
+		combine_items = (polar_write_combine_item *)
+			malloc(polar_bgwriter_flush_batch_size * sizeof(polar_write_combine_item));
 		batch_buf_size = polar_bgwriter_flush_batch_size;
 	}
 
@@ -554,12 +615,12 @@ polar_buffer_sync(WritebackContext *wb_context,
 	{
 		if (LWLockConditionalAcquire(&polar_flush_ctl->cbuflock, LW_EXCLUSIVE))
 		{
-			polar_sync_buffer_from_copy_buffer(wb_context, flags);
+			polar_sync_buffer_from_copy_buffer(wb_context, lag, flags);
 			LWLockRelease(&polar_flush_ctl->cbuflock);
 		}
 	}
 	else if (is_normal_bgwriter)
-		polar_sync_buffer_from_copy_buffer(wb_context, flags);
+		polar_sync_buffer_from_copy_buffer(wb_context, lag, flags);
 
 	if (unlikely(polar_enable_debug))
 		elog(DEBUG1, "Try to get %d buffers to flush from flush list", num_to_sync);
@@ -577,6 +638,19 @@ polar_buffer_sync(WritebackContext *wb_context,
 		if (num == 0 || batch_buf == NULL)
 			break;
 
+		/*
+		 * POLAR: write adjacent blocks of the batch in one io. The replica
+		 * does not write buffers, leave it to SyncOneBuffer.
+		 */
+		if (polar_bgwriter_write_combine_size > 1 && combine_items != NULL &&
+			!polar_is_replica())
+		{
+			num_written += polar_write_combine_sync(batch_buf, num, combine_items,
+													wb_context, flags);
+			sync_count += num;
+			continue;
+		}
+
 		/* Sync buffers */
 		while (i < num)
 		{
@@ -628,6 +702,328 @@ polar_buffer_sync(WritebackContext *wb_context,
 	return lag < sleep_lag;
 }
 
+#define ST_SORT polar_sort_write_combine_items
+#define ST_ELEMENT_TYPE polar_write_combine_item
+#define ST_COMPARE(a, b) buffertag_comparator(&a->tag, &b->tag)
+#define ST_SCOPE static
+#define ST_DEFINE
+#include <lib/sort_template.h>
+
+/*
+ * polar_write_combine_sync - Sync a batch of buffers got from flush list,
+ * adjacent blocks of one relation fork are written in one io.
+ *
+ * Returns the number of buffers written.
+ */
+static int
+polar_write_combine_sync(int *batch_buf, int num, polar_write_combine_item *items,
+						 WritebackContext *wb_context, int flags)
+{
+	int			num_written = 0;
+	int			nitems = 0;
+	int			i;
+
+	/*
+	 * Collect the dirty buffers, the tags are checked again when the buffers
+	 * are pinned.
+	 */
+	for (i = 0; i < num; i++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(batch_buf[i]);
+		uint32		buf_state;
+
+		buf_state = LockBufHdr(bufHdr);
+		if (!(buf_state & BM_IO_IN_PROGRESS) &&
+			(buf_state & BM_VALID) && (buf_state & BM_DIRTY))
+		{
+			items[nitems].tag = bufHdr->tag;
+			items[nitems].buf_id = batch_buf[i];
+			nitems++;
+		}
+		UnlockBufHdr(bufHdr, buf_state);
+	}
+
+	polar_sort_write_combine_items(items, nitems);
+
+	i = 0;
+	while (i < nitems)
+	{
+		int			nblocks;
+
+		nblocks = polar_write_combine_run(items + i, nitems - i, wb_context, flags);
+
+		/*
+		 * The first buffer can not be written by write combining, it may need
+		 * a copy buffer, or it is already clean.
+		 */
+		if (nblocks == 0)
+		{
+			if (SyncOneBuffer(items[i].buf_id, false, wb_context, flags) & BUF_WRITTEN)
+			{
+				polar_write_combine_count(1);
+				num_written++;
+			}
+			nblocks = 1;
+		}
+		else
+		{
+			polar_write_combine_count(nblocks);
+			num_written += nblocks;
+		}
+
+		i += nblocks;
+	}
+
+	return num_written;
+}
+
+/*
+ * polar_write_combine_run - Write the longest run of adjacent blocks starting
+ * from items[0] in one io.
+ *
+ * Only buffers that SyncOneBuffer would write by FlushBuffer are combined.
+ * The fullpage snapshots of them are written in one io too. The content locks
+ * of the buffers after the first one are acquired conditionally, so the run
+ * stops instead of waiting for a backend that may lock these buffers in
+ * another order.
+ *
+ * Returns the number of buffers written, 0 if items[0] is not written.
+ */
+static int
+polar_write_combine_run(polar_write_combine_item *items, int nitems,
+						WritebackContext *wb_context, int flags)
+{
+	static char *write_buf = NULL;
+	static char *fullpage_buf = NULL;
+	BufferDesc *bufs[POLAR_MAX_BULK_IO_SIZE];
+	bool		need_fullpage[POLAR_MAX_BULK_IO_SIZE];
+	int			nfullpages = 0;
+	BufferTag  *tag = &items[0].tag;
+	XLogRecPtr	oldest_apply_lsn;
+	XLogRecPtr	recptr = InvalidXLogRecPtr;
+	ErrorContextCallback errcallback;
+	instr_time	io_start,
+				io_time;
+	SMgrRelation reln;
+	int			limit;
+	int			count;
+	int			i;
+
+	limit = Min(nitems, polar_bgwriter_write_combine_size);
+	/* Make sure that the io does not cross files */
+	limit = Min(limit, (BlockNumber) RELSEG_SIZE - (tag->blockNum % (BlockNumber) RELSEG_SIZE));
+
+	if (write_buf == NULL)
+		write_buf = MemoryContextAllocIOAligned(TopMemoryContext,
+												POLAR_MAX_BULK_IO_SIZE * BLCKSZ, 0);
+
+	polar_bulk_io_alloc_state();
+
+	oldest_apply_lsn = polar_get_oldest_apply_lsn();
+
+	Assert(!polar_bulk_io_is_in_progress);
+	Assert(polar_bulk_io_in_progress_count == 0);
+	polar_bulk_io_is_in_progress = true;
+
+	for (count = 0; count < limit; count++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(items[count].buf_id);
+		LWLock	   *content_lock = BufferDescriptorGetContentLock(bufHdr);
+		uint32		buf_state;
+
+		if (count > 0 &&
+			(!RelFileNodeEquals(items[count].tag.rnode, tag->rnode) ||
+			 items[count].tag.forkNum != tag->forkNum ||
+			 items[count].tag.blockNum != tag->blockNum + count))
+			break;
+
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+		ReservePrivateRefCountEntry();
+
+		/* The buffer may be replaced or written since it was collected */
+		buf_state = LockBufHdr(bufHdr);
+		if (!BUFFERTAGS_EQUAL(bufHdr->tag, items[count].tag) ||
+			!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY) ||
+			(buf_state & BM_IO_IN_PROGRESS))
+		{
+			UnlockBufHdr(bufHdr, buf_state);
+			break;
+		}
+
+		PinBuffer_Locked(bufHdr);
+
+		if (count == 0)
+			LWLockAcquire(content_lock, LW_SHARED);
+		else if (!LWLockConditionalAcquire(content_lock, LW_SHARED))
+		{
+			UnpinBuffer(bufHdr, true);
+			break;
+		}
+
+		/* Like SyncOneBuffer, the future page can be written with a fullpage */
+		if ((!polar_buffer_can_be_flushed(bufHdr, oldest_apply_lsn, false) &&
+			 ((flags & CHECKPOINT_IS_SHUTDOWN) ||
+			  !polar_buffer_need_fullpage_snapshot(bufHdr, oldest_apply_lsn))) ||
+			!StartBufferIO(bufHdr, false))
+		{
+			LWLockRelease(content_lock);
+			UnpinBuffer(bufHdr, true);
+			break;
+		}
+
+		/* The same condition as FlushBuffer */
+		need_fullpage[count] = POLAR_LOGINDEX_ENABLE_FULLPAGE() &&
+			!PageIsNew(BufHdrGetBlock(bufHdr)) &&
+			!XLogRecPtrIsInvalid(oldest_apply_lsn) &&
+			BufferGetLSN(bufHdr) > oldest_apply_lsn &&
+			bufHdr->tag.forkNum == MAIN_FORKNUM;
+		if (need_fullpage[count])
+			nfullpages++;
+
+		bufs[count] = bufHdr;
+	}
+
+	if (count == 0)
+	{
+		Assert(polar_bulk_io_in_progress_count == 0);
+		polar_bulk_io_is_in_progress = false;
+		return 0;
+	}
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = shared_buffer_write_error_callback;
+	errcallback.arg = (void *) bufs[0];
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	reln = smgropen(tag->rnode, InvalidBackendId);
+
+	for (i = 0; i < count; i++)
+	{
+		uint32		buf_state = LockBufHdr(bufs[i]);
+
+		/*
+		 * Run PageGetLSN while holding header lock, since we don't have the
+		 * buffer locked exclusively.
+		 */
+		if ((buf_state & BM_PERMANENT) && BufferGetLSN(bufs[i]) > recptr)
+			recptr = BufferGetLSN(bufs[i]);
+
+		/* To check if block content changes while flushing. */
+		buf_state &= ~BM_JUST_DIRTIED;
+		UnlockBufHdr(bufs[i], buf_state);
+	}
+
+	/* Force XLOG flush up to the largest LSN of the permanent buffers */
+	if (!XLogRecPtrIsInvalid(recptr))
+		XLogFlush(recptr);
+
+	/*
+	 * POLAR: write fullpage snapshots of the future pages in one io, their
+	 * old versions are read in one io too.
+	 */
+	if (nfullpages > 0)
+	{
+		Buffer		fullpage_buffers[POLAR_MAX_BULK_IO_SIZE];
+		char	   *fullpages[POLAR_MAX_BULK_IO_SIZE];
+		int			n = 0;
+
+		if (fullpage_buf == NULL)
+			fullpage_buf = MemoryContextAllocIOAligned(TopMemoryContext,
+													   POLAR_MAX_BULK_IO_SIZE * BLCKSZ, 0);
+
+		polar_smgrbulkread(reln, tag->forkNum, tag->blockNum, count, fullpage_buf);
+
+		for (i = 0; i < count; i++)
+		{
+			if (!need_fullpage[i])
+				continue;
+
+			fullpage_buffers[n] = BufferDescriptorGetBuffer(bufs[i]);
+			fullpages[n] = fullpage_buf + i * BLCKSZ;
+			polar_fullpage_get_old_image(fullpage_buffers[n], oldest_apply_lsn,
+										 fullpages[n], false);
+			n++;
+		}
+
+		polar_log_fullpage_snapshot_images(polar_logindex_redo_instance->fullpage_ctl,
+										   fullpage_buffers, fullpages, n);
+	}
+
+	/*
+	 * Other processes might be updating hint bits, the pages are copied as
+	 * PageSetChecksumCopy() does. The copy is needed to write them in one io
+	 * anyway.
+	 */
+	for (i = 0; i < count; i++)
+	{
+		char	   *page = write_buf + i * BLCKSZ;
+
+		memcpy(page, BufHdrGetBlock(bufs[i]), BLCKSZ);
+		PageSetChecksumInplace((Page) page, tag->blockNum + i);
+	}
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	polar_smgrbulkwrite(reln, tag->forkNum, tag->blockNum, count, write_buf, false);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+	}
+
+	pgBufferUsage.shared_blks_written += count;
+
+	/* TerminateBufferIO must be called in the reverse order of StartBufferIO */
+	for (i = count - 1; i >= 0; i--)
+	{
+		if (polar_enable_shared_storage_mode)
+		{
+			/* Free copy buffer if exists */
+			polar_free_copy_buffer(bufs[i]);
+			polar_reset_buffer_oldest_lsn(bufs[i]);
+		}
+
+		TerminateBufferIO(bufs[i], true, 0);
+	}
+
+	Assert(polar_bulk_io_in_progress_count == 0);
+	polar_bulk_io_is_in_progress = false;
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	for (i = 0; i < count; i++)
+	{
+		LWLockRelease(BufferDescriptorGetContentLock(bufs[i]));
+		UnpinBuffer(bufs[i], true);
+		ScheduleBufferTagForWriteback(wb_context, &items[i].tag);
+	}
+
+	return count;
+}
+
+/*
+ * polar_write_combine_count - Count a write of nblocks blocks in the
+ * histogram of the flush list control.
+ */
+static void
+polar_write_combine_count(int nblocks)
+{
+	int			bucket = 0;
+
+	Assert(nblocks >= 1 && nblocks <= POLAR_MAX_BULK_IO_SIZE);
+
+	if (nblocks > 1)
+		bucket = pg_leftmost_one_pos32(nblocks - 1) + 1;
+
+	pg_atomic_fetch_add_u64(&polar_flush_ctl->write_combine_hist[Min(bucket, POLAR_WRITE_COMBINE_HIST_SIZE - 1)], 1);
+}
+
 static XLogRecPtr
 update_consistent_lsn_delta(XLogRecPtr cur_consistent_lsn)
 {
@@ -933,7 +1329,7 @@ polar_set_buffer_fake_oldest_lsn(BufferDesc *buf_hdr)
 }
 
 static void
-polar_sync_buffer_from_copy_buffer(WritebackContext *wb_context, int flags)
+polar_sync_buffer_from_copy_buffer(WritebackContext *wb_context, uint64 lag, int flags)
 {
 	int			i;
 	CopyBufferDesc *cbuf;
@@ -942,10 +1338,13 @@ polar_sync_buffer_from_copy_buffer(WritebackContext *wb_context, int flags)
 	if (!polar_copy_buffer_enabled())
 		return;
 
+	/* POLAR: grow or shrink the elastic copy buffer pool */
+	polar_adjust_copy_buffer_pool(lag);
+
 	/* Make sure we can handle the pin inside SyncOneBuffer */
 	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
 
-	for (i = 0; i < polar_copy_buffers; i++)
+	for (i = 0; i < polar_copy_buffers_reserved(); i++)
 	{
 		cbuf = polar_get_copy_buffer_descriptor(i);
 		buf_id = pg_atomic_read_u32((pg_atomic_uint32 *) &cbuf->origin_buffer) - 1;
@@ -1162,6 +1561,590 @@ polar_bulk_read_buffer_extended(Relation reln, ForkNumber forkNum, BlockNumber b
 	return buf;
 }
 
+/*
+ * polar_bulk_read_ahead_begin -- create the read-ahead state of a scan.
+ *
+ * The state and its batches are allocated in mcxt, which should be the
+ * memory context of the scan. Once a request is submitted, the state makes
+ * sure that mcxt isn't reset or deleted before the requests in flight are
+ * done with its memory, even on error.
+ */
+polar_read_ahead_state *
+polar_bulk_read_ahead_begin(MemoryContext mcxt)
+{
+	polar_read_ahead_state *state;
+
+	state = MemoryContextAllocZero(mcxt, sizeof(polar_read_ahead_state));
+	state->forknum = InvalidForkNumber;
+	state->next = InvalidBlockNumber;
+	state->mcxt = mcxt;
+
+	return state;
+}
+
+/*
+ * polar_bulk_read_ahead -- read ahead of the bulk read of blockNum.
+ *
+ * Scans call it before each bulk read to keep the next
+ * polar_bulk_read_ahead_windows bulk reads ahead of the scan. With buffered
+ * io, they are requested by PrefetchBuffer(), so the kernel reads them while
+ * the scan processes the current pages. Direct io and pfsd have no page
+ * cache to prefetch into, so the blocks are read into shared buffers by
+ * polar_bulk_read_ahead_buffers(), all windows in flight together. The reads
+ * stay in flight while the scan goes on, and their blocks are put into
+ * shared buffers here once the scan gets to them, before it reads them
+ * itself. More blocks are read ahead when less than half of the windows are
+ * left ahead, and no more than the ring of strategy holds besides the
+ * current bulk read, otherwise they would be evicted before the scan gets
+ * there.
+ *
+ * A block is requested only once while the same relation fork is scanned
+ * forward. When the scan ends, polar_bulk_read_ahead_end() releases the rest.
+ */
+void
+polar_bulk_read_ahead(polar_read_ahead_state *state, Relation reln, ForkNumber forkNum,
+					  BlockNumber blockNum, BlockNumber nblocks, BufferAccessStrategy strategy)
+{
+	uint64		end;
+	BlockNumber start;
+
+	if (!RelFileNodeEquals(state->rnode, reln->rd_node) || state->forknum != forkNum)
+	{
+		polar_bulk_read_ahead_end(state);
+		state->rnode = reln->rd_node;
+		state->forknum = forkNum;
+	}
+
+	/* The block the scan gets to now must not be pinned by us any more */
+	polar_bulk_read_ahead_release(state, blockNum);
+
+	if (polar_bulk_read_ahead_windows <= 0 || polar_bulk_read_size <= 1 ||
+		RelationUsesLocalBuffers(reln))
+		return;
+
+	start = blockNum + polar_bulk_read_size;
+	end = (uint64) blockNum + (uint64) (polar_bulk_read_ahead_windows + 1) * polar_bulk_read_size;
+
+	if (polar_vfs_is_dio_mode && strategy != NULL)
+		end = Min(end, (uint64) blockNum + GetAccessStrategyBufferCount(strategy));
+	end = Min(end, (uint64) nblocks);
+
+	/* Continue from the block where the last read-ahead of this scan stopped */
+	if (state->next != InvalidBlockNumber &&
+		state->next > start && state->next <= end)
+	{
+		if (polar_vfs_is_dio_mode && state->next - start >= (end - start) / 2)
+			return;
+		start = state->next;
+	}
+
+	if (start >= end)
+		return;
+
+	if (!polar_vfs_is_dio_mode)
+	{
+#ifdef USE_PREFETCH
+		for (; start < end; start++)
+			PrefetchBuffer(reln, forkNum, start);
+#else
+		return;
+#endif
+	}
+	else
+	{
+		/* One segment at a time, the next call goes on with the rest */
+		end = Min(end, (uint64) start + RELSEG_SIZE - start % RELSEG_SIZE);
+		polar_bulk_read_ahead_buffers(state, RelationGetSmgr(reln), reln->rd_rel->relpersistence,
+									  forkNum, start, (int) (end - start), strategy);
+		start = (BlockNumber) end;
+	}
+
+	state->next = start;
+}
+
+/*
+ * polar_bulk_read_ahead_buffers -- start reading blocks of [blockNum,
+ * blockNum + nblocks) into shared buffers with asynchronous io. The blocks
+ * must be in one segment. Returns the number of blocks being read.
+ */
+int
+polar_bulk_read_ahead_buffers(polar_read_ahead_state *state, SMgrRelation smgr,
+							  char relpersistence, ForkNumber forkNum,
+							  BlockNumber blockNum, int nblocks,
+							  BufferAccessStrategy strategy)
+{
+	BlockNumber *blocknums;
+	int			nread;
+	int			i;
+
+	if (SmgrIsTemp(smgr) || nblocks <= 0)
+		return 0;
+
+	nblocks = Min(nblocks, POLAR_BULK_IO_MAX_IN_PROGRESS);
+	nblocks = Min(nblocks, (BlockNumber) RELSEG_SIZE - blockNum % (BlockNumber) RELSEG_SIZE);
+
+	blocknums = palloc(nblocks * sizeof(BlockNumber));
+	for (i = 0; i < nblocks; i++)
+		blocknums[i] = blockNum + i;
+
+	nread = polar_bulk_read_ahead_blocks(state, smgr, relpersistence, forkNum,
+										 blocknums, nblocks, strategy, NULL);
+	pfree(blocknums);
+
+	return nread;
+}
+
+/*
+ * Blocks a scan keeps in flight at most. They stay pinned until their
+ * requests are released, so leave enough unpinned buffers to the others.
+ */
+static int
+polar_bulk_read_ahead_limit(void)
+{
+	int			limit = NBuffers / (MaxBackends + NUM_AUXILIARY_PROCS);
+
+	return Min(Max(limit, POLAR_MAX_BULK_IO_SIZE), POLAR_BULK_IO_MAX_IN_PROGRESS);
+}
+
+static void
+polar_read_ahead_free(polar_read_ahead_batch *batch)
+{
+	pfree(batch->data);
+	pfree(batch->reqs);
+	pfree(batch->released);
+	pfree(batch->req_start);
+	pfree(batch->blocks);
+	pfree(batch->buffers);
+	pfree(batch);
+}
+
+/*
+ * Wait for all submitted requests of a batch. They read into the memory of
+ * the batch, so it can't be freed before.
+ */
+static void
+polar_read_ahead_wait(polar_read_ahead_batch *batch)
+{
+	while (batch->nsubmitted > 0 &&
+		   polar_aio_wait(batch->reqs, batch->nsubmitted, batch->nsubmitted) < batch->nsubmitted)
+		;
+}
+
+/*
+ * Wait for request r of a batch, if it's submitted.
+ */
+static void
+polar_read_ahead_wait_req(polar_read_ahead_batch *batch, int r)
+{
+	polar_aio_req *req = &batch->reqs[r];
+	instr_time	io_start,
+				io_time;
+
+	if (r >= batch->nsubmitted || polar_aio_wait(req, 1, 0) == 1)
+		return;
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_READ);
+	while (polar_aio_wait(req, 1, 1) < 1)
+		;
+	pgstat_report_wait_end();
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+	}
+}
+
+/*
+ * Release the buffers of request r of a batch, which is done or was not
+ * submitted. The blocks read by the request are put into those buffers
+ * which are still invalid; if anyone else has read a block meanwhile, the
+ * buffer is valid and our copy is dropped. Blocks that can't be read or fail
+ * verification are left invalid, the next reader reads them again and
+ * reports the error.
+ */
+static void
+polar_read_ahead_release(polar_read_ahead_state *state, polar_read_ahead_batch *batch, int r)
+{
+	polar_aio_req *req = &batch->reqs[r];
+	bool		done = r < batch->nsubmitted && req->done && req->error == 0;
+	int			index;
+
+	Assert(!batch->released[r]);
+	Assert(!polar_bulk_io_is_in_progress);
+
+	for (index = batch->req_start[r]; index < batch->req_start[r + 1]; index++)
+	{
+		Buffer		buffer = batch->buffers[index];
+		BufferDesc *bufHdr = GetBufferDescriptor(buffer - 1);
+		char	   *page = batch->data + (Size) index * BLCKSZ;
+		Size		end_in_req = (Size) (index - batch->req_start[r] + 1) * BLCKSZ;
+
+		if (done && req->result >= (ssize_t) end_in_req &&
+			PageIsVerifiedExtended((Page) page, batch->blocks[index], 0) &&
+			StartBufferIO(bufHdr, true))
+		{
+			memcpy((char *) BufHdrGetBlock(bufHdr), page, BLCKSZ);
+
+			if (batch->redo_action == POLAR_REDO_REPLAY_XLOG)
+				polar_apply_io_locked_page(bufHdr, batch->replay_from, batch->checkpoint_redo_lsn,
+										   batch->smgr, batch->forkNum, batch->blocks[index]);
+			else if (batch->redo_action == POLAR_REDO_MARK_OUTDATE)
+			{
+				uint32		redo_state = polar_lock_redo_state(bufHdr);
+
+				redo_state |= POLAR_REDO_OUTDATE;
+				polar_unlock_redo_state(bufHdr, redo_state);
+			}
+
+			TerminateBufferIO(bufHdr, false, BM_VALID);
+
+			state->nread++;
+			pgBufferUsage.shared_blks_read++;
+			VacuumPageMiss++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageMiss;
+		}
+
+		ReleaseBuffer(buffer);
+	}
+
+	state->inflight -= batch->req_start[r + 1] - batch->req_start[r];
+	batch->released[r] = true;
+	batch->nreleased++;
+}
+
+/*
+ * Remove a batch whose requests are all released from the state.
+ */
+static void
+polar_read_ahead_remove(polar_read_ahead_state *state, polar_read_ahead_batch *batch,
+						polar_read_ahead_batch *prev)
+{
+	Assert(batch->nreleased == batch->nreqs);
+
+	if (prev)
+		prev->next = batch->next;
+	else
+		state->head = batch->next;
+	if (state->tail == batch)
+		state->tail = prev;
+
+	polar_read_ahead_free(batch);
+}
+
+/*
+ * polar_bulk_read_ahead_release -- put the blocks of the requests which are
+ * done into shared buffers, and wait for those starting at or before
+ * blockNum, which the scan is about to read. The buffer of blockNum must not
+ * be pinned by the read-ahead any more then, a cleanup lock needs the only
+ * pin of this backend.
+ */
+void
+polar_bulk_read_ahead_release(polar_read_ahead_state *state, BlockNumber blockNum)
+{
+	polar_read_ahead_batch *batch;
+	polar_read_ahead_batch *prev = NULL;
+	polar_read_ahead_batch *next;
+	int			r;
+
+	for (batch = state->head; batch != NULL; batch = next)
+	{
+		next = batch->next;
+
+		if (batch->nsubmitted > 0)
+			polar_aio_wait(batch->reqs, batch->nsubmitted, 0);
+
+		for (r = 0; r < batch->nreqs; r++)
+		{
+			if (batch->released[r])
+				continue;
+
+			if (blockNum != InvalidBlockNumber &&
+				batch->blocks[batch->req_start[r]] <= blockNum)
+				polar_read_ahead_wait_req(batch, r);
+			else if (r < batch->nsubmitted && !batch->reqs[r].done)
+				continue;
+
+			polar_read_ahead_release(state, batch, r);
+		}
+
+		if (batch->nreleased == batch->nreqs)
+			polar_read_ahead_remove(state, batch, prev);
+		else
+			prev = batch;
+	}
+}
+
+/*
+ * polar_bulk_read_ahead_complete -- put the blocks of the requests which are
+ * done into shared buffers, or those of all requests if wait is true.
+ */
+void
+polar_bulk_read_ahead_complete(polar_read_ahead_state *state, bool wait)
+{
+	polar_bulk_read_ahead_release(state, wait ? MaxBlockNumber : InvalidBlockNumber);
+}
+
+/*
+ * polar_bulk_read_ahead_end -- release all read-ahead of the state, when its
+ * scan ends or restarts.
+ */
+void
+polar_bulk_read_ahead_end(polar_read_ahead_state *state)
+{
+	polar_bulk_read_ahead_complete(state, true);
+	Assert(state->head == NULL && state->inflight == 0);
+
+	state->next = InvalidBlockNumber;
+}
+
+/*
+ * Reset callback of the memory context of a state. On error, its buffers
+ * were already released by the resource owner, so only wait for the
+ * requests in flight before their memory goes away.
+ */
+static void
+polar_read_ahead_reset_callback(void *arg)
+{
+	polar_read_ahead_state *state = (polar_read_ahead_state *) arg;
+	polar_read_ahead_batch *batch;
+
+	for (batch = state->head; batch != NULL; batch = batch->next)
+		polar_read_ahead_wait(batch);
+
+	state->head = state->tail = NULL;
+	state->inflight = 0;
+}
+
+/*
+ * polar_bulk_read_ahead_blocks -- start reading the given blocks into shared
+ * buffers with asynchronous io.
+ *
+ * blocknums must be ascending, without duplicates and in one segment. Blocks
+ * not in shared buffers get buffers, which are pinned and left invalid while
+ * each run of continuous ones is read by one request of up to
+ * polar_bulk_read_size blocks. All the requests are submitted as one batch,
+ * which stays in flight after return, so the reads overlap with the work of
+ * the caller. The blocks are put into shared buffers by the next call for
+ * the state, polar_bulk_read_ahead_complete() or polar_bulk_read_ahead_end().
+ *
+ * Pages which need replay are replayed from the read min lsn set here, so
+ * their batch is released before return. In parallel replay mode, they are
+ * marked outdated like the pages read by parallel replay processes instead,
+ * whoever locks them replays them.
+ *
+ * It's only a hint. Returns the number of blocks being read, and the number
+ * of blocks already in shared buffers in *nfound if it's not NULL.
+ *
+ * Note: All modifications about replay-page must be applied to
+ * ReadBuffer_common(), polar_bulk_read_buffer_common() and here.
+ */
+int
+polar_bulk_read_ahead_blocks(polar_read_ahead_state *state, SMgrRelation smgr,
+							 char relpersistence, ForkNumber forkNum,
+							 const BlockNumber *blocknums, int nblocks,
+							 BufferAccessStrategy strategy, int *nfound)
+{
+	polar_read_ahead_batch *batch;
+	MemoryContext oldcontext;
+	int			limit;
+	int			nbufs = 0;
+	int			nreqs = 0;
+	bool		prepared = true;
+	int			index;
+	int			i;
+
+	if (nfound)
+		*nfound = 0;
+
+	if (SmgrIsTemp(smgr) || nblocks <= 0)
+		return 0;
+
+	/* Make room for this batch, the oldest ones are likely done */
+	polar_bulk_read_ahead_complete(state, false);
+
+	limit = polar_bulk_read_ahead_limit();
+	nblocks = Min(nblocks, limit);
+	Assert(blocknums[0] / RELSEG_SIZE == blocknums[nblocks - 1] / RELSEG_SIZE);
+
+	while (state->head != NULL && state->inflight + nblocks > limit)
+	{
+		batch = state->head;
+		for (i = 0; i < batch->nreqs; i++)
+		{
+			if (!batch->released[i])
+			{
+				polar_read_ahead_wait_req(batch, i);
+				polar_read_ahead_release(state, batch, i);
+			}
+		}
+		polar_read_ahead_remove(state, batch, NULL);
+	}
+
+	Assert(!polar_bulk_io_is_in_progress);
+	Assert(0 == polar_bulk_io_in_progress_count);
+
+	polar_bulk_io_alloc_state();
+	polar_bulk_io_is_in_progress = true;
+
+	/*
+	 * Claim the buffers in ascending order like bulk read, so that it can't
+	 * deadlock with other bulk reads on io_in_progress_lock. They have
+	 * IO_IN_PROGRESS only until the loop below; on error, AbortBufferIO()
+	 * cleans them up like those of bulk read.
+	 */
+	for (i = 0; i < nblocks; i++)
+	{
+		BufferDesc *bufHdr;
+		bool		found;
+
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		Assert(i == 0 || blocknums[i] > blocknums[i - 1]);
+
+		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blocknums[i],
+							 strategy, &found);
+
+		/* bufHdr == NULL, all buffers are pinned. */
+		if (bufHdr == NULL)
+			break;
+
+		if (found)
+		{
+			ReleaseBuffer(BufferDescriptorGetBuffer(bufHdr));
+			if (nfound)
+				(*nfound)++;
+			continue;
+		}
+
+		Assert(!(pg_atomic_read_u32(&bufHdr->state) & BM_VALID));	/* spinlock not needed */
+		nbufs++;
+		Assert(nbufs == polar_bulk_io_in_progress_count);
+	}
+
+	if (nbufs == 0)
+	{
+		polar_bulk_io_is_in_progress = false;
+		return 0;
+	}
+
+	/*
+	 * The requests read into the memory of the batch. Make sure it's not
+	 * freed before they are done.
+	 */
+	if (!state->callback.func)
+	{
+		state->callback.func = polar_read_ahead_reset_callback;
+		state->callback.arg = state;
+		MemoryContextRegisterResetCallback(state->mcxt, &state->callback);
+	}
+
+	oldcontext = MemoryContextSwitchTo(state->mcxt);
+	batch = palloc0(sizeof(polar_read_ahead_batch));
+	batch->buffers = palloc(nbufs * sizeof(Buffer));
+	batch->blocks = palloc(nbufs * sizeof(BlockNumber));
+	batch->req_start = palloc((nbufs + 1) * sizeof(int));
+	batch->released = palloc0(nbufs * sizeof(bool));
+	batch->reqs = palloc0(nbufs * sizeof(polar_aio_req));
+	batch->data = MemoryContextAllocIOAligned(state->mcxt, (Size) nbufs * BLCKSZ, 0);
+	MemoryContextSwitchTo(oldcontext);
+
+	batch->nbufs = nbufs;
+	batch->smgr = smgr;
+	batch->forkNum = forkNum;
+
+	for (index = 0; index < nbufs; index++)
+	{
+		batch->buffers[index] = BufferDescriptorGetBuffer(polar_bulk_io_in_progress_buf[index]);
+		batch->blocks[index] = polar_bulk_io_in_progress_buf[index]->tag.blockNum;
+	}
+
+	/*
+	 * Leave the buffers invalid for anyone who needs them before the reads
+	 * are done. They stay pinned, so they can't be evicted, and whoever
+	 * writes these blocks must read them into these buffers first.
+	 */
+	for (index = nbufs - 1; index >= 0; index--)
+		TerminateBufferIO(GetBufferDescriptor(batch->buffers[index] - 1), false, 0);
+	polar_bulk_io_is_in_progress = false;
+
+	batch->redo_action = polar_require_backend_redo(false, RBM_NORMAL, forkNum, &batch->replay_from);
+	if (batch->redo_action == POLAR_REDO_REPLAY_XLOG &&
+		POLAR_IN_PARALLEL_REPLAY_MODE(polar_logindex_redo_instance))
+		batch->redo_action = POLAR_REDO_MARK_OUTDATE;
+	if (batch->redo_action != POLAR_REDO_NO_ACTION)
+	{
+		batch->checkpoint_redo_lsn = GetRedoRecPtr();
+		Assert(!XLogRecPtrIsInvalid(batch->checkpoint_redo_lsn));
+	}
+
+	/* One request for each run of continuous blocks */
+	for (index = 0; index < nbufs; index = i)
+	{
+		for (i = index + 1; i < nbufs && i - index < Max(polar_bulk_read_size, 1) &&
+			 batch->blocks[i] == batch->blocks[i - 1] + 1; i++)
+			;
+
+		if (!polar_smgrbulkread_req(smgr, forkNum, batch->blocks[index], i - index,
+									batch->data + (Size) index * BLCKSZ, &batch->reqs[nreqs]))
+			prepared = false;
+
+		batch->req_start[nreqs++] = index;
+	}
+	batch->req_start[nreqs] = nbufs;
+	batch->nreqs = nreqs;
+
+	if (state->tail)
+		state->tail->next = batch;
+	else
+		state->head = batch;
+	state->tail = batch;
+	state->inflight += nbufs;
+
+	/*
+	 * The fds of reqs are only valid until another file is opened. Once
+	 * submitted, closing a file waits for the requests in flight.
+	 */
+	if (prepared)
+		batch->nsubmitted = Max(polar_aio_submit(batch->reqs, nreqs), 0);
+
+	if (batch->redo_action == POLAR_REDO_REPLAY_XLOG)
+	{
+		/* It's no use to start others meanwhile */
+		polar_bulk_read_ahead_complete(state, true);
+		Assert(state->head == NULL);
+	}
+
+	if (batch->redo_action != POLAR_REDO_NO_ACTION)
+		POLAR_RESET_BACKEND_READ_MIN_LSN();
+
+	return nbufs;
+}
+
+/*
+ * Alloc polar_bulk_io_in_progress_buf and polar_bulk_io_is_for_input on
+ * demand. If bulk io is done once, there is a great possibility that it
+ * will be done later, so they are not freed until backend exit.
+ */
+static void
+polar_bulk_io_alloc_state(void)
+{
+	if (NULL == polar_bulk_io_in_progress_buf)
+	{
+		Assert(NULL == polar_bulk_io_is_for_input);
+		polar_bulk_io_in_progress_buf = MemoryContextAlloc(TopMemoryContext,
+														   POLAR_BULK_IO_MAX_IN_PROGRESS * sizeof(polar_bulk_io_in_progress_buf[0]));
+		polar_bulk_io_is_for_input = MemoryContextAlloc(TopMemoryContext,
+														POLAR_BULK_IO_MAX_IN_PROGRESS * sizeof(polar_bulk_io_is_for_input[0]));
+	}
+}
+
 /*
  * polar_bulk_read_buffer_common -- common logic for bulk read multi buffer one time.
  *
@@ -1221,21 +2204,7 @@ polar_bulk_read_buffer_common(Relation reln, char relpersistence, ForkNumber for
 	/* bulk read begin */
 	polar_bulk_io_is_in_progress = true;
 
-	/*
-	 * Alloc buffer for polar_bulk_io_in_progress_buf and
-	 * polar_bulk_io_is_for_input on demand. If bulk read is called once,
-	 * there is a great possibility that bulk read will be called later.
-	 * polar_bulk_io_in_progress_buf and polar_bulk_io_is_for_input will be
-	 * not freed, until backend exit.
-	 */
-	if (NULL == polar_bulk_io_in_progress_buf)
-	{
-		Assert(NULL == polar_bulk_io_is_for_input);
-		polar_bulk_io_in_progress_buf = MemoryContextAlloc(TopMemoryContext,
-														   POLAR_MAX_BULK_IO_SIZE * sizeof(polar_bulk_io_in_progress_buf[0]));
-		polar_bulk_io_is_for_input = MemoryContextAlloc(TopMemoryContext,
-														POLAR_MAX_BULK_IO_SIZE * sizeof(polar_bulk_io_is_for_input[0]));
-	}
+	polar_bulk_io_alloc_state();
 
 	*hit = false;
 
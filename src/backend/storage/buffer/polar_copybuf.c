@@ -26,9 +26,11 @@
 #include "postgres.h"
 
 #include "access/xlog.h"
+#include "portability/instr_time.h"
 #include "storage/polar_copybuf.h"
 #include "storage/polar_bufmgr.h"
 #include "storage/polar_fd.h"
+#include "storage/proc.h"
 #include "utils/guc.h"
 #include "utils/timestamp.h"
 
@@ -38,6 +40,11 @@ char	   *polar_copy_buffer_blocks;
 
 static void init_copy_buffer_ctl(bool init);
 static bool copy_buffer_alloc(BufferDesc *buf, XLogRecPtr oldest_apply_lsn);
+static void copy_buffer_push(CopyBufferDesc *cbuf);
+static bool copy_buffer_park_if_inactive(CopyBufferDesc *cbuf);
+
+/* Statistic of the elastic pool at last adjustment, only used by bgwriter */
+static uint64 last_full_count = 0;
 
 #define start_copy_buffer_io(buf, for_input)	\
 	(polar_start_buffer_io_extend(buf, for_input, true))
@@ -60,13 +67,13 @@ polar_init_copy_buffer_pool(void)
 	/* Align descriptors to a cacheline boundary. */
 	polar_copy_buffer_descriptors = (CopyBufferDescPadded *)
 		ShmemInitStruct("Copy Buffer Descriptors",
-						polar_copy_buffers * sizeof(CopyBufferDescPadded),
+						polar_copy_buffers_reserved() * sizeof(CopyBufferDescPadded),
 						&found_copy_descs);
 
 	polar_copy_buffer_blocks = (char *)
 		TYPEALIGN(POLAR_BUFFER_ALIGN_LEN,
 				  ShmemInitStruct("Copy Buffer Blocks",
-								  ((polar_copy_buffers * (Size) BLCKSZ) + POLAR_BUFFER_ALIGN_LEN),
+								  ((polar_copy_buffers_reserved() * (Size) BLCKSZ) + POLAR_BUFFER_ALIGN_LEN),
 								  &found_copy_bufs));
 
 	if (found_copy_bufs || found_copy_descs)
@@ -78,10 +85,13 @@ polar_init_copy_buffer_pool(void)
 	{
 		int			i;
 
+		/* Initialize control structure */
+		init_copy_buffer_ctl(!found_copy_descs);
+
 		/*
 		 * Initialize all the copy buffer headers.
 		 */
-		for (i = 0; i < polar_copy_buffers; i++)
+		for (i = 0; i < polar_copy_buffers_reserved(); i++)
 		{
 			CopyBufferDesc *cbuf = polar_get_copy_buffer_descriptor(i);
 
@@ -92,18 +102,20 @@ polar_init_copy_buffer_pool(void)
 			pg_atomic_init_u32(&cbuf->pass_count, 0);
 			cbuf->is_flushed = false;
 			cbuf->state = POLAR_COPY_BUFFER_UNUSED;
+			cbuf->free_next = FREENEXT_NOT_IN_LIST;
 
 			/*
-			 * Initially link all the buffers together as unused
+			 * Initially put the active buffers into the freelists, the others
+			 * are parked until the pool grows.
 			 */
-			cbuf->free_next = i + 1;
+			if (i < polar_copy_buffers)
+			{
+				pg_atomic_init_u32(&cbuf->parked, 0);
+				copy_buffer_push(cbuf);
+			}
+			else
+				pg_atomic_init_u32(&cbuf->parked, 1);
 		}
-
-		/* Correct last entry of linked list */
-		polar_get_copy_buffer_descriptor(polar_copy_buffers - 1)->free_next = FREENEXT_END_OF_LIST;
-
-		/* Initialize control structure */
-		init_copy_buffer_ctl(!found_copy_descs);
 	}
 }
 
@@ -111,6 +123,7 @@ static void
 init_copy_buffer_ctl(bool init)
 {
 	bool		found;
+	int			i;
 
 	polar_copy_buffer_ctl = (CopyBufferControl *)
 		ShmemInitStruct("Copy Buffer Status",
@@ -121,16 +134,24 @@ init_copy_buffer_ctl(bool init)
 		/* Only done once, usually in postmaster */
 		Assert(init);
 
-		SpinLockInit(&polar_copy_buffer_ctl->copy_buffer_ctl_lock);
+		polar_copy_buffer_ctl->num_partitions =
+			Min(POLAR_COPY_BUFFER_PARTITIONS, polar_copy_buffers);
+		pg_atomic_init_u32(&polar_copy_buffer_ctl->active_buffers,
+						   polar_copy_buffers);
 
-		polar_copy_buffer_ctl->first_free_buffer = 0;
-		polar_copy_buffer_ctl->last_free_buffer = polar_copy_buffers - 1;
+		for (i = 0; i < POLAR_COPY_BUFFER_PARTITIONS; i++)
+			pg_atomic_init_u64(&polar_copy_buffer_ctl->freelists[i].head,
+							   COPYBUFFER_FREELIST_HEAD(0, FREENEXT_END_OF_LIST));
 
 		pg_atomic_init_u64(&polar_copy_buffer_ctl->flushed_count, 0);
 		pg_atomic_init_u64(&polar_copy_buffer_ctl->release_count, 0);
 		pg_atomic_init_u64(&polar_copy_buffer_ctl->copied_count, 0);
 		pg_atomic_init_u64(&polar_copy_buffer_ctl->unavailable_count, 0);
 		pg_atomic_init_u64(&polar_copy_buffer_ctl->full_count, 0);
+		pg_atomic_init_u64(&polar_copy_buffer_ctl->alloc_count, 0);
+		pg_atomic_init_u64(&polar_copy_buffer_ctl->alloc_time, 0);
+		pg_atomic_init_u64(&polar_copy_buffer_ctl->grow_count, 0);
+		pg_atomic_init_u64(&polar_copy_buffer_ctl->shrink_count, 0);
 	}
 	else
 		Assert(!init);
@@ -151,14 +172,14 @@ polar_copy_buffer_shmem_size(void)
 		return size;
 
 	/* size of copy buffer descriptors, polar_copy_buffers unit is BLOCKS */
-	size = add_size(size, mul_size(polar_copy_buffers, sizeof(CopyBufferDescPadded)));
+	size = add_size(size, mul_size(polar_copy_buffers_reserved(), sizeof(CopyBufferDescPadded)));
 	/* to allow aligning buffer descriptors */
 	size = add_size(size, PG_CACHE_LINE_SIZE);
 
 	/* size of data pages */
 	/* to allow aligning buffer blocks */
 	size = add_size(size, BLCKSZ);
-	size = add_size(size, mul_size(polar_copy_buffers, BLCKSZ));
+	size = add_size(size, mul_size(polar_copy_buffers_reserved(), BLCKSZ));
 
 	/* size of copy buffer control */
 	size = add_size(size, MAXALIGN(sizeof(CopyBufferControl)));
@@ -252,12 +273,132 @@ polar_buffer_copy_is_satisfied(BufferDesc *buf,
 	return false;
 }
 
+/*
+ * Push a copy buffer into the freelist of its partition.
+ */
+static void
+copy_buffer_push(CopyBufferDesc *cbuf)
+{
+	CopyBufferFreeList *freelist;
+	uint64		head;
+
+	Assert(cbuf->free_next == FREENEXT_NOT_IN_LIST);
+
+	freelist = &polar_copy_buffer_ctl->freelists[cbuf->buf_id %
+												 polar_copy_buffer_ctl->num_partitions];
+	head = pg_atomic_read_u64(&freelist->head);
+
+	for (;;)
+	{
+		uint32		counter = COPYBUFFER_FREELIST_HEAD_COUNTER(head) + 1;
+
+		cbuf->free_next = COPYBUFFER_FREELIST_HEAD_BUF_ID(head);
+
+		/* On failure head is updated to the current value */
+		if (pg_atomic_compare_exchange_u64(&freelist->head, &head,
+										   COPYBUFFER_FREELIST_HEAD(counter, cbuf->buf_id)))
+			break;
+	}
+}
+
+/*
+ * Pop a copy buffer from the freelist, NULL if it's empty.
+ *
+ * The counter of head makes the compare-and-exchange fail if the first
+ * buffer was popped and pushed again since we read its free_next.
+ */
+static CopyBufferDesc *
+copy_buffer_pop(CopyBufferFreeList *freelist)
+{
+	CopyBufferDesc *cbuf;
+	uint64		head;
+
+	head = pg_atomic_read_u64(&freelist->head);
+
+	for (;;)
+	{
+		int			buf_id = COPYBUFFER_FREELIST_HEAD_BUF_ID(head);
+		uint32		counter = COPYBUFFER_FREELIST_HEAD_COUNTER(head) + 1;
+
+		if (buf_id == FREENEXT_END_OF_LIST)
+			return NULL;
+
+		cbuf = polar_get_copy_buffer_descriptor(buf_id);
+
+		if (pg_atomic_compare_exchange_u64(&freelist->head, &head,
+										   COPYBUFFER_FREELIST_HEAD(counter,
+																	((volatile CopyBufferDesc *) cbuf)->free_next)))
+			break;
+	}
+
+	cbuf->free_next = FREENEXT_NOT_IN_LIST;
+
+	return cbuf;
+}
+
+/*
+ * Park the copy buffer if it's out of the active part of the pool, so it's
+ * not in any freelist until the pool grows again. Returns true if parked.
+ *
+ * The buffer is parked before the active size is checked again, and the
+ * pool grows before it unparks buffers, so either we or the grower see the
+ * other one and only one of us pushes the buffer.
+ */
+static bool
+copy_buffer_park_if_inactive(CopyBufferDesc *cbuf)
+{
+	uint32		expected = 1;
+
+	if (cbuf->buf_id < pg_atomic_read_u32(&polar_copy_buffer_ctl->active_buffers))
+		return false;
+
+	pg_atomic_write_u32(&cbuf->parked, 1);
+	pg_memory_barrier();
+
+	if (cbuf->buf_id < pg_atomic_read_u32(&polar_copy_buffer_ctl->active_buffers) &&
+		pg_atomic_compare_exchange_u32(&cbuf->parked, &expected, 0))
+		return false;
+
+	return true;
+}
+
+/*
+ * Get a free copy buffer, starting from the partition of this process and
+ * stealing from the others if it's empty. NULL if all are empty.
+ */
+CopyBufferDesc *
+polar_get_free_copy_buffer(void)
+{
+	int			num_partitions = polar_copy_buffer_ctl->num_partitions;
+	int			start = MyProc ? MyProc->pgprocno % num_partitions : 0;
+	int			i;
+
+	for (i = 0; i < num_partitions; i++)
+	{
+		CopyBufferFreeList *freelist;
+		CopyBufferDesc *cbuf;
+
+		freelist = &polar_copy_buffer_ctl->freelists[(start + i) % num_partitions];
+
+		while ((cbuf = copy_buffer_pop(freelist)) != NULL)
+		{
+			/* The pool has shrunk, park the buffer and try the next one */
+			if (!copy_buffer_park_if_inactive(cbuf))
+				return cbuf;
+		}
+	}
+
+	return NULL;
+}
+
 static bool
 copy_buffer_alloc(BufferDesc *buf, XLogRecPtr oldest_apply_lsn)
 {
 	CopyBufferDesc *cbuf;
 	uint32		buf_state;
 	XLogRecPtr	consistent_lsn;
+	instr_time	start,
+				duration;
 
 	/* Before copy, lock the buffer using io_in_progress lock like FlushBuffer */
 	if (!start_copy_buffer_io(buf, true))
@@ -285,47 +426,39 @@ copy_buffer_alloc(BufferDesc *buf, XLogRecPtr oldest_apply_lsn)
 			 LSN_FORMAT_ARGS(consistent_lsn));
 	}
 
-	/* Acquire the spinlock to remove element from the freelist */
-	SpinLockAcquire(&polar_copy_buffer_ctl->copy_buffer_ctl_lock);
+	INSTR_TIME_SET_CURRENT(start);
 
-	if (polar_copy_buffer_ctl->first_free_buffer < 0)
+	cbuf = polar_get_free_copy_buffer();
+
+	if (cbuf == NULL)
 	{
 		static TimestampTz last_log_time = 0;
 
-		SpinLockRelease(&polar_copy_buffer_ctl->copy_buffer_ctl_lock);
 		TerminateBufferIO(buf, false, 0);
 		pg_atomic_fetch_add_u64(&polar_copy_buffer_ctl->full_count, 1);
 
 		/* Do not log frequently, every 1s log one */
 		if (TimestampDifferenceExceeds(last_log_time, GetCurrentTimestamp(), 1000))
 		{
-			elog(WARNING, "Copy buffer pool is full, pool size is %d",
-				 polar_copy_buffers);
+			elog(WARNING, "Copy buffer pool is full, pool size is %u",
+				 pg_atomic_read_u32(&polar_copy_buffer_ctl->active_buffers));
 			last_log_time = GetCurrentTimestamp();
 		}
 
 		return false;
 	}
 
-	cbuf = polar_get_copy_buffer_descriptor(polar_copy_buffer_ctl->first_free_buffer);
-
-	Assert(cbuf->free_next != FREENEXT_NOT_IN_LIST);
-
-	/* Unconditionally remove buffer from freelist */
-	polar_copy_buffer_ctl->first_free_buffer = cbuf->free_next;
-	cbuf->free_next = FREENEXT_NOT_IN_LIST;
-
-	/*
-	 * Release the lock so someone else can access the freelist while we check
-	 * out this buffer.
-	 */
-	SpinLockRelease(&polar_copy_buffer_ctl->copy_buffer_ctl_lock);
-
 	Assert(cbuf->state == POLAR_COPY_BUFFER_UNUSED);
 	Assert(!XLogRecPtrIsInvalid(buf->oldest_lsn));
 
 	memcpy(CopyBufHdrGetBlock(cbuf), BufHdrGetBlock(buf), BLCKSZ);
 
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	pg_atomic_fetch_add_u64(&polar_copy_buffer_ctl->alloc_count, 1);
+	pg_atomic_fetch_add_u64(&polar_copy_buffer_ctl->alloc_time,
+							(uint64) (INSTR_TIME_GET_DOUBLE(duration) * 1000000000.0));
+
 	SET_COPYBUFFERTAG(cbuf->tag, buf->tag);
 	pg_atomic_write_u64((pg_atomic_uint64 *) &cbuf->oldest_lsn,
 						buf->oldest_lsn);
@@ -387,15 +520,18 @@ polar_free_copy_buffer(BufferDesc *buf)
 	cbuf->is_flushed = false;
 
 	/* Then put into the freelist */
-	SpinLockAcquire(&polar_copy_buffer_ctl->copy_buffer_ctl_lock);
-
-	Assert(cbuf->free_next == FREENEXT_NOT_IN_LIST);
+	polar_put_free_copy_buffer(cbuf);
+}
 
-	cbuf->free_next = polar_copy_buffer_ctl->first_free_buffer;
-	if (cbuf->free_next < 0)
-		polar_copy_buffer_ctl->last_free_buffer = cbuf->buf_id;
-	polar_copy_buffer_ctl->first_free_buffer = cbuf->buf_id;
-	SpinLockRelease(&polar_copy_buffer_ctl->copy_buffer_ctl_lock);
+/*
+ * Put a copy buffer got by polar_get_free_copy_buffer() back into the
+ * freelist, unless the pool has shrunk.
+ */
+void
+polar_put_free_copy_buffer(CopyBufferDesc *cbuf)
+{
+	if (!copy_buffer_park_if_inactive(cbuf))
+		copy_buffer_push(cbuf);
 }
 
 /* Like FlushBuffer, flush a copy buffer. */
@@ -519,7 +655,7 @@ polar_copy_buffers_get_oldest_lsn(void)
 	if (!polar_copy_buffer_enabled())
 		return res;
 
-	for (i = 0; i < polar_copy_buffers; i++)
+	for (i = 0; i < polar_copy_buffers_reserved(); i++)
 	{
 		cbuf = polar_get_copy_buffer_descriptor(i);
 
@@ -535,3 +671,105 @@ polar_copy_buffers_get_oldest_lsn(void)
 
 	return res;
 }
+
+/*
+ * polar_adjust_copy_buffer_pool - grow or shrink the elastic copy buffer pool
+ *
+ * The pool grows by a step if allocation failed or it's nearly used up since
+ * last call, and shrinks by a step if consistent lsn lag is low and less than
+ * half of it is used. Shared memory of the whole pool is reserved at startup,
+ * only the active part of it can be allocated.
+ *
+ * Only one process calls it at a time, the normal bgwriter or the parallel
+ * bgwriter holding cbuflock.
+ */
+void
+polar_adjust_copy_buffer_pool(uint64 consistent_lag)
+{
+	uint32		active;
+	uint32		target;
+	uint32		step;
+	uint64		full_count;
+	uint64		used;
+
+	if (!polar_copy_buffer_enabled() ||
+		polar_copy_buffers_max <= polar_copy_buffers)
+		return;
+
+	active = pg_atomic_read_u32(&polar_copy_buffer_ctl->active_buffers);
+	full_count = pg_atomic_read_u64(&polar_copy_buffer_ctl->full_count);
+	used = pg_atomic_read_u64(&polar_copy_buffer_ctl->copied_count) -
+		pg_atomic_read_u64(&polar_copy_buffer_ctl->release_count);
+	step = Max((polar_copy_buffers_max - polar_copy_buffers) / 8, 1);
+	target = active;
+
+	if (full_count != last_full_count || used >= active - active / 8)
+		target = Min(active + step, polar_copy_buffers_max);
+	else if (consistent_lag < polar_buffer_copy_threshold_lag * 1024 * 1024L / 2 &&
+			 used < active / 2)
+		target = Max(active - step, polar_copy_buffers);
+
+	last_full_count = full_count;
+
+	polar_resize_copy_buffer_pool(target);
+}
+
+/*
+ * polar_resize_copy_buffer_pool - set the active size of the elastic copy
+ * buffer pool
+ *
+ * target is clamped to [polar_copy_buffers, polar_copy_buffers_max]. It's
+ * safe to be called by several processes at once: the active size is only
+ * changed from the value we read, so a growing always unparks the buffers
+ * between the last active size and the new one, none is left parked below
+ * the active size.
+ */
+void
+polar_resize_copy_buffer_pool(uint32 target)
+{
+	uint32		active;
+
+	if (!polar_copy_buffer_enabled() ||
+		polar_copy_buffers_max <= polar_copy_buffers)
+		return;
+
+	target = Max(Min(target, polar_copy_buffers_max), polar_copy_buffers);
+	active = pg_atomic_read_u32(&polar_copy_buffer_ctl->active_buffers);
+
+	/*
+	 * Make the new buffers active before unparking them, see
+	 * copy_buffer_park_if_inactive. On failure active is updated to the
+	 * current value.
+	 */
+	while (active != target &&
+		   !pg_atomic_compare_exchange_u32(&polar_copy_buffer_ctl->active_buffers,
+										   &active, target))
+		;
+
+	if (target > active)
+	{
+		uint32		i;
+
+		for (i = active; i < target; i++)
+		{
+			CopyBufferDesc *cbuf = polar_get_copy_buffer_descriptor(i);
+			uint32		expected = 1;
+
+			/* Buffers in use will be pushed when they are freed */
+			if (pg_atomic_compare_exchange_u32(&cbuf->parked, &expected, 0))
+				copy_buffer_push(cbuf);
+		}
+
+		pg_atomic_fetch_add_u64(&polar_copy_buffer_ctl->grow_count, 1);
+		elog(DEBUG1, "Copy buffer pool grows from %u to %u", active, target);
+	}
+	else if (target < active)
+	{
+		/*
+		 * Buffers out of the active part are parked lazily, when they are
+		 * freed or popped from the freelists.
+		 */
+		pg_atomic_fetch_add_u64(&polar_copy_buffer_ctl->shrink_count, 1);
+		elog(DEBUG1, "Copy buffer pool shrinks from %u to %u", active, target);
+	}
+}
@@ -45,13 +45,19 @@
     (buf->flush_prev == POLAR_FLUSHNEXT_NOT_IN_LIST && \
 	 buf->flush_next == POLAR_FLUSHNEXT_NOT_IN_LIST)
 
-#define current_pos_is_unavailable() \
-	(polar_flush_ctl->current_pos == POLAR_FLUSHNEXT_NOT_IN_LIST)
+#define current_pos_is_unavailable(part) \
+	((part)->current_pos == POLAR_FLUSHNEXT_NOT_IN_LIST)
 
 FlushControl *polar_flush_ctl = NULL;
 
-static void remove_one_buffer(BufferDesc *buf);
-static void append_one_buffer(BufferDesc *buf);
+/*
+ * The flush list partition owned by this process, -1 means that it does not
+ * own any partition and always picks the one with the smallest oldest lsn.
+ */
+static int	own_partition_id = -1;
+
+static void remove_one_buffer(polar_flush_list_partition_t *part, BufferDesc *buf);
+static void append_one_buffer(polar_flush_list_partition_t *part, BufferDesc *buf);
 
 /*
  * polar_flush_list_ctl_shmem_size
@@ -66,10 +72,12 @@ polar_flush_list_ctl_shmem_size(void)
 	if (!polar_flush_list_enabled())
 		return size;
 
-	/* Size of the shared flush list control block */
-	size = add_size(size, MAXALIGN(sizeof(FlushControl)));
+	/* Size of the shared flush list control block and its partitions */
+	size = add_size(size, offsetof(FlushControl, partitions));
+	size = add_size(size, mul_size(polar_flush_list_partitions,
+								   sizeof(polar_flush_list_partition_padded)));
 
-	return size;
+	return MAXALIGN(size);
 }
 
 
@@ -80,6 +88,7 @@ void
 polar_init_flush_list_ctl(bool init)
 {
 	bool		found;
+	int			i;
 
 	if (!polar_flush_list_enabled())
 		return;
@@ -87,7 +96,7 @@ polar_init_flush_list_ctl(bool init)
 	/* Get or create the shared memory for flush list control block */
 	polar_flush_ctl = (FlushControl *)
 		ShmemInitStruct("Flush control status",
-						sizeof(FlushControl), &found);
+						polar_flush_list_ctl_shmem_size(), &found);
 
 	if (!found)
 	{
@@ -96,14 +105,21 @@ polar_init_flush_list_ctl(bool init)
 
 		pg_atomic_init_u32(&polar_flush_ctl->count, 0);
 
-		SpinLockInit(&polar_flush_ctl->flushlist_lock);
 		SpinLockInit(&polar_flush_ctl->lru_lock);
 		LWLockInitialize(&polar_flush_ctl->cbuflock, LWTRANCHE_POLAR_COPY_BUFFER);
 
-		polar_flush_ctl->first_flush_buffer = POLAR_FLUSHNEXT_END_OF_LIST;
-		polar_flush_ctl->last_flush_buffer = POLAR_FLUSHNEXT_END_OF_LIST;
-		polar_flush_ctl->current_pos = POLAR_FLUSHNEXT_NOT_IN_LIST;
-		polar_flush_ctl->latest_flush_count = 0;
+		polar_flush_ctl->num_partitions = polar_flush_list_partitions;
+		for (i = 0; i < polar_flush_ctl->num_partitions; i++)
+		{
+			polar_flush_list_partition_t *part = &polar_flush_ctl->partitions[i].part;
+
+			SpinLockInit(&part->flushlist_lock);
+			part->first_flush_buffer = POLAR_FLUSHNEXT_END_OF_LIST;
+			part->last_flush_buffer = POLAR_FLUSHNEXT_END_OF_LIST;
+			part->current_pos = POLAR_FLUSHNEXT_NOT_IN_LIST;
+			part->latest_flush_count = 0;
+			pg_atomic_init_u64(&part->head_lsn, InvalidXLogRecPtr);
+		}
 
 		polar_flush_ctl->lru_buffer_id = 0;
 		polar_flush_ctl->lru_complete_passes = 0;
@@ -119,39 +135,111 @@ polar_init_flush_list_ctl(bool init)
 		pg_atomic_init_u64(&polar_flush_ctl->backend_flush, 0);
 		pg_atomic_init_u64(&polar_flush_ctl->vm_insert, 0);
 		pg_atomic_init_u64(&polar_flush_ctl->vm_remove, 0);
+		for (i = 0; i < POLAR_WRITE_COMBINE_HIST_SIZE; i++)
+			pg_atomic_init_u64(&polar_flush_ctl->write_combine_hist[i], 0);
 	}
 	else
 		Assert(!init);
 }
 
+/*
+ * polar_flush_list_set_own_partition
+ *
+ * Let parallel background writer worker own one partition of the flush list,
+ * it gets buffers from its own partition first.
+ */
+void
+polar_flush_list_set_own_partition(int worker_id)
+{
+	Assert(polar_flush_list_enabled());
+	Assert(worker_id >= 0);
+
+	own_partition_id = worker_id % polar_flush_ctl->num_partitions;
+}
+
+/*
+ * polar_flush_list_get_oldest_lsn
+ *
+ * Merge the heads of all partitions and return the smallest oldest lsn, or
+ * InvalidXLogRecPtr if the whole flush list is empty. If partition_id is not
+ * NULL, it is set to the partition which owns that buffer.
+ *
+ * Every head_lsn is read without lock, so a buffer that is appended after its
+ * partition has been read is missed. Such a buffer gets an oldest lsn that is
+ * not smaller than the current insert lsn, so callers that need a lower bound
+ * of all dirty buffers must clamp the result to an lsn read before calling.
+ */
+XLogRecPtr
+polar_flush_list_get_oldest_lsn(int *partition_id)
+{
+	XLogRecPtr	oldest_lsn = InvalidXLogRecPtr;
+	int			oldest_id = -1;
+	int			i;
+
+	for (i = 0; i < polar_flush_ctl->num_partitions; i++)
+	{
+		XLogRecPtr	lsn = pg_atomic_read_u64(&polar_flush_ctl->partitions[i].part.head_lsn);
+
+		if (XLogRecPtrIsInvalid(lsn))
+			continue;
+
+		if (XLogRecPtrIsInvalid(oldest_lsn) || lsn < oldest_lsn)
+		{
+			oldest_lsn = lsn;
+			oldest_id = i;
+		}
+	}
+
+	if (partition_id)
+		*partition_id = oldest_id;
+
+	return oldest_lsn;
+}
+
 /*
  * polar_get_batch_flush_buffer
  *
  * Get a batch of buffers from flush list and do not remove it, FlushBuffer will
  * remove them from flush list.
+ *
+ * Parallel background writer workers get buffers from their own partition,
+ * others or workers whose partition is empty get buffers from the partition
+ * that has the smallest oldest lsn, so consistent lsn keeps moving forward.
  */
 int
 polar_get_batch_buffer(int *batch_buf, int bgwriter_flush_batch_size)
 {
+	polar_flush_list_partition_t *part = NULL;
 	int			num = 0;
 	int			buffer_id;
 	int			flush_count;
+	int			partition_id = -1;
 
 	Assert(polar_flush_list_enabled());
 
-	SpinLockAcquire(&polar_flush_ctl->flushlist_lock);
-	if (polar_flush_list_is_empty())
+	if (own_partition_id >= 0 &&
+		!XLogRecPtrIsInvalid(pg_atomic_read_u64(&polar_flush_ctl->partitions[own_partition_id].part.head_lsn)))
+		partition_id = own_partition_id;
+	else
+		polar_flush_list_get_oldest_lsn(&partition_id);
+
+	if (partition_id < 0)
+		return num;
+
+	part = &polar_flush_ctl->partitions[partition_id].part;
+
+	SpinLockAcquire(&part->flushlist_lock);
+	if (polar_flush_list_partition_is_empty(part))
 	{
-		SpinLockRelease(&polar_flush_ctl->flushlist_lock);
+		SpinLockRelease(&part->flushlist_lock);
 		return num;
 	}
 
-	flush_count = polar_flush_ctl->latest_flush_count;
-	if (current_pos_is_unavailable())
-		polar_flush_ctl->current_pos =
-			polar_flush_ctl->first_flush_buffer;
+	flush_count = part->latest_flush_count;
+	if (current_pos_is_unavailable(part))
+		part->current_pos = part->first_flush_buffer;
 
-	buffer_id = polar_flush_ctl->current_pos;
+	buffer_id = part->current_pos;
 	for (num = 0; num < bgwriter_flush_batch_size; num++)
 	{
 		Assert(buffer_id != POLAR_FLUSHNEXT_NOT_IN_LIST);
@@ -170,16 +258,16 @@ polar_get_batch_buffer(int *batch_buf, int bgwriter_flush_batch_size)
 	if (buffer_id == POLAR_FLUSHNEXT_END_OF_LIST ||
 		(flush_count + num) > polar_bgwriter_batch_size)
 	{
-		polar_flush_ctl->current_pos = polar_flush_ctl->first_flush_buffer;
-		polar_flush_ctl->latest_flush_count = 0;
+		part->current_pos = part->first_flush_buffer;
+		part->latest_flush_count = 0;
 	}
 	else
 	{
-		polar_flush_ctl->current_pos = buffer_id;
-		polar_flush_ctl->latest_flush_count += num;
+		part->current_pos = buffer_id;
+		part->latest_flush_count += num;
 	}
 
-	SpinLockRelease(&polar_flush_ctl->flushlist_lock);
+	SpinLockRelease(&part->flushlist_lock);
 	pg_atomic_fetch_add_u64(&polar_flush_ctl->batch_read, 1);
 
 	return num;
@@ -193,13 +281,17 @@ polar_get_batch_buffer(int *batch_buf, int bgwriter_flush_batch_size)
 void
 polar_remove_buffer_from_flush_list(BufferDesc *buf)
 {
+	polar_flush_list_partition_t *part;
+
 	if (!polar_flush_list_enabled())
 		return;
 
-	SpinLockAcquire(&polar_flush_ctl->flushlist_lock);
+	part = polar_flush_list_partition_of(buf->buf_id);
+
+	SpinLockAcquire(&part->flushlist_lock);
 	polar_buffer_set_oldest_lsn(buf, InvalidXLogRecPtr);
-	remove_one_buffer(buf);
-	SpinLockRelease(&polar_flush_ctl->flushlist_lock);
+	remove_one_buffer(part, buf);
+	SpinLockRelease(&part->flushlist_lock);
 
 	pg_atomic_fetch_sub_u32(&polar_flush_ctl->count, 1);
 	pg_atomic_fetch_add_u64(&polar_flush_ctl->remove, 1);
@@ -219,7 +311,9 @@ void
 polar_put_buffer_to_flush_list(BufferDesc *buf,
 							   XLogRecPtr lsn)
 {
-	SpinLockAcquire(&polar_flush_ctl->flushlist_lock);
+	polar_flush_list_partition_t *part = polar_flush_list_partition_of(buf->buf_id);
+
+	SpinLockAcquire(&part->flushlist_lock);
 
 	/* The buffer must be not in flush list */
 	Assert(buffer_not_in_flush_list(buf));
@@ -230,8 +324,8 @@ polar_put_buffer_to_flush_list(BufferDesc *buf,
 	else
 		polar_buffer_set_oldest_lsn(buf, lsn);
 
-	append_one_buffer(buf);
-	SpinLockRelease(&polar_flush_ctl->flushlist_lock);
+	append_one_buffer(part, buf);
+	SpinLockRelease(&part->flushlist_lock);
 
 	/* Outside the spin lock to update statistic info. */
 	pg_atomic_fetch_add_u32(&polar_flush_ctl->count, 1);
@@ -250,7 +344,9 @@ polar_put_buffer_to_flush_list(BufferDesc *buf,
 void
 polar_adjust_position_in_flush_list(BufferDesc *buf)
 {
-	SpinLockAcquire(&polar_flush_ctl->flushlist_lock);
+	polar_flush_list_partition_t *part = polar_flush_list_partition_of(buf->buf_id);
+
+	SpinLockAcquire(&part->flushlist_lock);
 
 	/* Buffer must be in flush list */
 	Assert(!buffer_not_in_flush_list(buf));
@@ -265,20 +361,25 @@ polar_adjust_position_in_flush_list(BufferDesc *buf)
 		Assert(buf->flush_next != POLAR_FLUSHNEXT_NOT_IN_LIST);
 
 		/* Not the tail, remove and append it into flush list */
-		remove_one_buffer(buf);
-		append_one_buffer(buf);
+		remove_one_buffer(part, buf);
+		append_one_buffer(part, buf);
+	}
+	else if (buf->flush_prev == POLAR_FLUSHNEXT_END_OF_LIST)
+	{
+		/* The only one in this partition, its new lsn is the head lsn */
+		pg_atomic_write_u64(&part->head_lsn, polar_buffer_get_oldest_lsn(buf));
 	}
 
-	SpinLockRelease(&polar_flush_ctl->flushlist_lock);
+	SpinLockRelease(&part->flushlist_lock);
 	pg_atomic_fetch_add_u64(&polar_flush_ctl->cbuf, 1);
 }
 
 /*
- * Remove one buffer from flush list, caller should already acquired the
- * flush list lock.
+ * Remove one buffer from its flush list partition, caller should already
+ * acquired the lock of that partition.
  */
 static void
-remove_one_buffer(BufferDesc *buf)
+remove_one_buffer(polar_flush_list_partition_t *part, BufferDesc *buf)
 {
 	int			prev_flush_id;
 	int			next_flush_id;
@@ -289,7 +390,7 @@ remove_one_buffer(BufferDesc *buf)
 	Assert(!buffer_not_in_flush_list(buf));
 
 	/* Flushlist must be not empty */
-	Assert(!polar_flush_list_is_empty());
+	Assert(!polar_flush_list_partition_is_empty(part));
 
 	prev_flush_id = buf->flush_prev;
 	next_flush_id = buf->flush_next;
@@ -301,8 +402,9 @@ remove_one_buffer(BufferDesc *buf)
 		next_flush_id == POLAR_FLUSHNEXT_END_OF_LIST)
 	{
 		/* Only this buffer in flush list */
-		polar_flush_ctl->first_flush_buffer = POLAR_FLUSHNEXT_END_OF_LIST;
-		polar_flush_ctl->last_flush_buffer = POLAR_FLUSHNEXT_END_OF_LIST;
+		part->first_flush_buffer = POLAR_FLUSHNEXT_END_OF_LIST;
+		part->last_flush_buffer = POLAR_FLUSHNEXT_END_OF_LIST;
+		pg_atomic_write_u64(&part->head_lsn, InvalidXLogRecPtr);
 	}
 	else if (prev_flush_id == POLAR_FLUSHNEXT_END_OF_LIST &&
 			 next_flush_id != POLAR_FLUSHNEXT_END_OF_LIST)
@@ -310,7 +412,8 @@ remove_one_buffer(BufferDesc *buf)
 		/* First one, and has next buffer */
 		next_buf = GetBufferDescriptor(next_flush_id);
 		next_buf->flush_prev = prev_flush_id;
-		polar_flush_ctl->first_flush_buffer = next_flush_id;
+		part->first_flush_buffer = next_flush_id;
+		pg_atomic_write_u64(&part->head_lsn, polar_buffer_get_oldest_lsn(next_buf));
 	}
 	else if (prev_flush_id != POLAR_FLUSHNEXT_END_OF_LIST &&
 			 next_flush_id == POLAR_FLUSHNEXT_END_OF_LIST)
@@ -318,7 +421,7 @@ remove_one_buffer(BufferDesc *buf)
 		/* Last one, and has prev buffer */
 		prev_buf = GetBufferDescriptor(prev_flush_id);
 		prev_buf->flush_next = next_flush_id;
-		polar_flush_ctl->last_flush_buffer = prev_flush_id;
+		part->last_flush_buffer = prev_flush_id;
 	}
 	else
 	{
@@ -329,12 +432,12 @@ remove_one_buffer(BufferDesc *buf)
 		next_buf->flush_prev = prev_flush_id;
 	}
 
-	if (buf->buf_id == polar_flush_ctl->current_pos)
+	if (buf->buf_id == part->current_pos)
 	{
 		if (next_flush_id == POLAR_FLUSHNEXT_END_OF_LIST)
-			polar_flush_ctl->current_pos = polar_flush_ctl->first_flush_buffer;
+			part->current_pos = part->first_flush_buffer;
 		else
-			polar_flush_ctl->current_pos = next_flush_id;
+			part->current_pos = next_flush_id;
 	}
 
 	/* Remove buffer from flush list */
@@ -343,26 +446,27 @@ remove_one_buffer(BufferDesc *buf)
 }
 
 /*
- * Append one buffer to flush list, caller should already acquired the
- * flush list lock.
+ * Append one buffer to its flush list partition, caller should already
+ * acquired the lock of that partition.
  */
 static void
-append_one_buffer(BufferDesc *buf)
+append_one_buffer(polar_flush_list_partition_t *part, BufferDesc *buf)
 {
 	if (unlikely(polar_enable_debug))
 		POLAR_LOG_BUFFER_DESC_WITH_FLUSHLIST(buf);
 
-	if (unlikely(polar_flush_list_is_empty()))
+	if (unlikely(polar_flush_list_partition_is_empty(part)))
 	{
 		buf->flush_next = POLAR_FLUSHNEXT_END_OF_LIST;
 		buf->flush_prev = POLAR_FLUSHNEXT_END_OF_LIST;
 
-		polar_flush_ctl->first_flush_buffer = buf->buf_id;
-		polar_flush_ctl->last_flush_buffer = buf->buf_id;
+		part->first_flush_buffer = buf->buf_id;
+		part->last_flush_buffer = buf->buf_id;
+		pg_atomic_write_u64(&part->head_lsn, polar_buffer_get_oldest_lsn(buf));
 	}
 	else
 	{
-		BufferDesc *tail = GetBufferDescriptor(polar_flush_ctl->last_flush_buffer);
+		BufferDesc *tail = GetBufferDescriptor(part->last_flush_buffer);
 
 		if (unlikely(tail->oldest_lsn > buf->oldest_lsn))
 			elog(PANIC, "Append buffer with a small oldest lsn than last buffer in flush list.");
@@ -374,6 +478,6 @@ append_one_buffer(BufferDesc *buf)
 		tail->flush_next = buf->buf_id;
 
 		/* Append at the tail */
-		polar_flush_ctl->last_flush_buffer = buf->buf_id;
+		part->last_flush_buffer = buf->buf_id;
 	}
 }
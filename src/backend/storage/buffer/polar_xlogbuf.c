@@ -28,6 +28,7 @@
 #include "miscadmin.h"
 #include "storage/ipc.h"
 #include "storage/polar_xlogbuf.h"
+#include "storage/s_lock.h"
 #include "storage/shmem.h"
 #include "utils/guc.h"
 #include "utils/polar_log.h"
@@ -36,39 +37,15 @@ int			polar_xlog_page_buffers = 0;
 bool		polar_enable_xlog_buffer_test = false;
 polar_xlog_buffer_ctl polar_xlog_buffer_ins = NULL;
 
-static uint64 total_count = 0;
-static uint64 hit_count = 0;
-static uint64 io_count = 0;
-static uint64 others_append_count = 0;
-static uint64 startup_append_count = 0;
-
-#define POLAR_LOG_XLOG_BUFFER_STAT() \
-do \
-{ \
-	ereport(LOG, \
-			errmsg("XLog Buffer Hit Ratio: total_count=%ld, hit_count=%ld(%lf), " \
-				   "io_count=%ld(%lf), others_append_count=%ld(%lf), startup_append_count=%ld(%lf)", \
-				   total_count, hit_count, (double) hit_count / (double) total_count, \
-				   io_count, (double) io_count / (double) total_count, \
-				   others_append_count, (double) others_append_count / (double) total_count, \
-				   startup_append_count, (double) startup_append_count / (double) total_count)); \
-} while (0)
-
-static void
-polar_log_xlog_buffer_at_exit(int code, Datum arg)
-{
-	/* log hit ratio after 0x20000(1GB WAL) pages' lookup */
-	if (total_count > 0x20000)
-		POLAR_LOG_XLOG_BUFFER_STAT();
-}
+/* Times to read a slot again when it's written by others during the read */
+#define XLOG_BUFFER_READ_RETRIES 3
 
 void
 polar_init_xlog_buffer(char *prefix)
 {
 	bool		found,
 				foundDesc,
-				foundBlock,
-				foundLock;
+				foundBlock;
 	Size		block_count;
 	char		name[MAXPGPATH];
 
@@ -96,35 +73,31 @@ polar_init_xlog_buffer(char *prefix)
 						block_count * XLOG_BLCKSZ,
 						&foundBlock);
 
-	sprintf(name, "%s Locks", prefix);
-	polar_xlog_buffer_ins->buffer_lock_array = (polar_lwlock_mini_padded *)
-		ShmemInitStruct(name,
-						block_count * sizeof(polar_lwlock_mini_padded),
-						&foundLock);
-
 	if (!IsUnderPostmaster)
 	{
 		int			i;
 
-		Assert(!found && !foundDesc && !foundBlock && !foundLock);
+		Assert(!found && !foundDesc && !foundBlock);
 
 		for (i = 0; i < block_count; ++i)
 		{
 			polar_xlog_buffer_desc *buf = polar_get_xlog_buffer_desc(i);
 
 			buf->buf_id = i;
-			buf->start_lsn = InvalidXLogRecPtr;
-			buf->end_lsn = InvalidXLogRecPtr;
-			LWLockInitialize(polar_xlog_buffer_desc_get_lock(buf), LWTRANCHE_XLOG_BUFFER_CONTENT);
+			pg_atomic_init_u32(&buf->version, 0);
+			pg_atomic_init_u64(&buf->start_lsn, InvalidXLogRecPtr);
+			pg_atomic_init_u64(&buf->end_lsn, InvalidXLogRecPtr);
 		}
 
 		pg_atomic_init_u64(&polar_xlog_buffer_ins->hit_count, 0);
 		pg_atomic_init_u64(&polar_xlog_buffer_ins->io_count, 0);
 		pg_atomic_init_u64(&polar_xlog_buffer_ins->others_append_count, 0);
 		pg_atomic_init_u64(&polar_xlog_buffer_ins->startup_append_count, 0);
+		pg_atomic_init_u64(&polar_xlog_buffer_ins->evict_count, 0);
+		pg_atomic_init_u64(&polar_xlog_buffer_ins->collision_count, 0);
 	}
 	else
-		Assert(found && foundDesc && foundBlock && foundLock);
+		Assert(found && foundDesc && foundBlock);
 }
 
 Size
@@ -148,82 +121,134 @@ polar_xlog_buffer_shmem_size(void)
 	/* size of xlog buffer blocks */
 	size = add_size(size, mul_size(block_count, XLOG_BLCKSZ));
 
-	/* size of xlog buffer lock */
-	size = add_size(size, mul_size(block_count, sizeof(polar_lwlock_mini_padded)));
-	/* to allow aligning the above */
-	size = add_size(size, PG_CACHE_LINE_SIZE);
-
 	return size;
 }
 
-static void
+static inline void
 xlog_buffer_precheck(XLogRecPtr cur_page_lsn, int len)
 {
-	static bool register_xlog_buffer_hook = false;
+	POLAR_ASSERT_PANIC((cur_page_lsn % XLOG_BLCKSZ) == 0 &&
+					   len > 0 && len <= XLOG_BLCKSZ);
+}
 
-	if (unlikely(!register_xlog_buffer_hook))
+/*
+ * POLAR: Start to write the slot by making its version odd.
+ *
+ * If the slot is being written by others, wait for it when wait is true,
+ * otherwise return false.
+ */
+static bool
+xlog_buffer_begin_write(polar_xlog_buffer_desc *buf, bool wait)
+{
+	SpinDelayStatus delay_status;
+	uint32		version = pg_atomic_read_u32(&buf->version);
+
+	init_local_spin_delay(&delay_status);
+
+	for (;;)
 	{
-		on_proc_exit(polar_log_xlog_buffer_at_exit, 0);
-		register_xlog_buffer_hook = true;
+		if ((version & 1) == 0 &&
+			pg_atomic_compare_exchange_u32(&buf->version, &version, version + 1))
+			break;
+
+		if (!wait)
+			return false;
+
+		perform_spin_delay(&delay_status);
+		version = pg_atomic_read_u32(&buf->version);
 	}
 
-	POLAR_ASSERT_PANIC((cur_page_lsn % XLOG_BLCKSZ) == 0 &&
-					   len > 0 && len <= XLOG_BLCKSZ);
+	finish_spin_delay(&delay_status);
 
-	/* Log hit ratio every 0x200000(16GB WAL) page lookup */
-	if ((total_count & 0x1FFFFFL) == 0 && total_count > 0)
-		POLAR_LOG_XLOG_BUFFER_STAT();
+	return true;
 }
 
 /*
- * POLAR: Lookup the buffer page using lsn.
+ * POLAR: Finish writing the slot by making its version even again.
  *
- * buf_id will be set when buffer matched or current buffer should be evicted.
- * When buffer should be evicted, buf_id will be set the id of evicted buffer,
- * and because requested page is not matched, so return false.
+ * The atomic add is a full barrier, so readers which see the new version
+ * also see the new content of the slot.
+ */
+static inline void
+xlog_buffer_end_write(polar_xlog_buffer_desc *buf)
+{
+	pg_atomic_fetch_add_u32(&buf->version, 1);
+}
+
+/*
+ * POLAR: Copy len bytes of the page at page_lsn from the slot to page.
  *
- * If buffer is matched, return true, otherwise return false.
- * Force to recheck xlog buffer after switch lock from LW_SHARED to LW_EXCLUSIVE,
- * then the buffer may be matched and returned with LW_EXCLUSIVE.
+ * Return true if the slot caches enough data of the page and it's not written
+ * by others during the copy. *collided is set when the read raced with a
+ * writer.
  */
-bool
-polar_xlog_buffer_lookup(XLogRecPtr cur_page_lsn, int len, char *cur_page)
+static bool
+xlog_buffer_read_slot(polar_xlog_buffer_desc *buf, XLogRecPtr page_lsn, int len,
+					  char *page, bool *collided)
 {
-	polar_xlog_buffer_desc *buf;
-	int			buf_id;
-	bool		found = false;
+	int			retry;
 
-	xlog_buffer_precheck(cur_page_lsn, len);
+	for (retry = 0; retry < XLOG_BUFFER_READ_RETRIES; retry++)
+	{
+		uint32		version = pg_atomic_read_u32(&buf->version);
 
-	total_count++;
+		if (version & 1)
+		{
+			*collided = true;
+			SPIN_DELAY();
+			continue;
+		}
 
-	buf_id = polar_get_xlog_buffer_id(cur_page_lsn);
-	Assert(buf_id >= 0);
+		pg_read_barrier();
 
-	buf = polar_get_xlog_buffer_desc(buf_id);
+		if (pg_atomic_read_u64(&buf->start_lsn) != page_lsn ||
+			pg_atomic_read_u64(&buf->end_lsn) < page_lsn + len - 1)
+			return false;
 
-	/* Obtain shared lock to check meta info */
-	LWLockAcquire(polar_xlog_buffer_desc_get_lock(buf), LW_SHARED);
+		if (page)
+			memcpy(page, polar_get_xlog_buffer(buf->buf_id), len);
 
-	if (buf->start_lsn == cur_page_lsn &&
-		buf->end_lsn >= (cur_page_lsn + len - 1))
-	{
-		memcpy(cur_page, polar_get_xlog_buffer(buf_id), len);
-		found = true;
+		pg_read_barrier();
+
+		if (pg_atomic_read_u32(&buf->version) == version)
+			return true;
+
+		*collided = true;
 	}
 
-	LWLockRelease(polar_xlog_buffer_desc_get_lock(buf));
+	return false;
+}
+
+/*
+ * POLAR: Lookup the buffer page using lsn.
+ *
+ * All slots of the set which the page belongs to are searched without any
+ * lock. If one of them caches at least len bytes of the page, copy them to
+ * cur_page and return true, otherwise return false.
+ */
+bool
+polar_xlog_buffer_lookup(XLogRecPtr cur_page_lsn, int len, char *cur_page)
+{
+	int			first_id;
+	int			way;
+	bool		found = false;
+	bool		collided = false;
+
+	xlog_buffer_precheck(cur_page_lsn, len);
+
+	first_id = polar_get_xlog_buffer_set(cur_page_lsn) * POLAR_XLOG_BUFFER_WAYS;
+
+	for (way = 0; way < POLAR_XLOG_BUFFER_WAYS && !found; way++)
+		found = xlog_buffer_read_slot(polar_get_xlog_buffer_desc(first_id + way),
+									  cur_page_lsn, len, cur_page, &collided);
+
+	if (collided)
+		pg_atomic_fetch_add_u64(&polar_xlog_buffer_ins->collision_count, 1);
 
 	if (found)
-	{
-		hit_count++;
 		pg_atomic_fetch_add_u64(&polar_xlog_buffer_ins->hit_count, 1);
-	}
 	else
-	{
-		io_count++;
 		pg_atomic_fetch_add_u64(&polar_xlog_buffer_ins->io_count, 1);
-	}
 
 	return found;
 }
@@ -231,61 +256,85 @@ polar_xlog_buffer_lookup(XLogRecPtr cur_page_lsn, int len, char *cur_page)
 /*
  * POLAR: try to append one new xlog page after read it from disk.
  *
+ * The page replaces the shorter copy of itself if it's in the set already,
+ * otherwise the oldest page of the set. If the oldest page is newer than the
+ * appended one, or the chosen slot is being written by others, give up.
+ *
  * If xlog page is successful to appended, return true, otherwise return false.
  */
 bool
 polar_xlog_buffer_append(XLogRecPtr cur_page_lsn, int len, char *cur_page)
 {
-	polar_xlog_buffer_desc *buf;
-	int			buf_id;
+	polar_xlog_buffer_desc *buf = NULL;
+	XLogRecPtr	start_lsn;
+	XLogRecPtr	end_lsn;
+	XLogRecPtr	victim_end_lsn = PG_UINT64_MAX;
+	int			first_id;
+	int			way;
+	bool		evicted;
 
 	xlog_buffer_precheck(cur_page_lsn, len);
 
-	total_count++;
+	first_id = polar_get_xlog_buffer_set(cur_page_lsn) * POLAR_XLOG_BUFFER_WAYS;
+
+	for (way = 0; way < POLAR_XLOG_BUFFER_WAYS; way++)
+	{
+		polar_xlog_buffer_desc *cur = polar_get_xlog_buffer_desc(first_id + way);
 
-	buf_id = polar_get_xlog_buffer_id(cur_page_lsn);
-	Assert(buf_id >= 0);
-	buf = polar_get_xlog_buffer_desc(buf_id);
+		start_lsn = pg_atomic_read_u64(&cur->start_lsn);
+		end_lsn = pg_atomic_read_u64(&cur->end_lsn);
 
-	/* Obtain shared lock to check meta info */
-	LWLockAcquire(polar_xlog_buffer_desc_get_lock(buf), LW_SHARED);
+		if (start_lsn == cur_page_lsn)
+		{
+			buf = cur;
+			victim_end_lsn = end_lsn;
+			break;
+		}
 
-	if ((buf->start_lsn == cur_page_lsn && buf->end_lsn >= (cur_page_lsn + len - 1)) ||
-		!polar_xlog_buffer_should_evict(buf, cur_page_lsn, len))
+		/* Free slots have the smallest end_lsn, so they are chosen first */
+		if (end_lsn < victim_end_lsn)
+		{
+			buf = cur;
+			victim_end_lsn = end_lsn;
+		}
+	}
+
+	if (!polar_xlog_buffer_should_evict(victim_end_lsn, cur_page_lsn, len))
+		return false;
+
+	if (!xlog_buffer_begin_write(buf, false))
 	{
-		LWLockRelease(polar_xlog_buffer_desc_get_lock(buf));
+		pg_atomic_fetch_add_u64(&polar_xlog_buffer_ins->collision_count, 1);
 		return false;
 	}
 
-	LWLockRelease(polar_xlog_buffer_desc_get_lock(buf));
-	LWLockAcquire(polar_xlog_buffer_desc_get_lock(buf), LW_EXCLUSIVE);
-
 	/*
 	 * check again to prevent xlog buffer from being updated by other
 	 * processes
 	 */
-	if ((buf->start_lsn == cur_page_lsn && buf->end_lsn >= (cur_page_lsn + len - 1)) ||
-		!polar_xlog_buffer_should_evict(buf, cur_page_lsn, len))
+	start_lsn = pg_atomic_read_u64(&buf->start_lsn);
+	end_lsn = pg_atomic_read_u64(&buf->end_lsn);
+
+	if (!polar_xlog_buffer_should_evict(end_lsn, cur_page_lsn, len))
 	{
-		LWLockRelease(polar_xlog_buffer_desc_get_lock(buf));
+		xlog_buffer_end_write(buf);
 		return false;
 	}
 
-	buf->start_lsn = cur_page_lsn;
-	buf->end_lsn = cur_page_lsn + len - 1;
-	memcpy(polar_get_xlog_buffer(buf_id), cur_page, len);
-	LWLockRelease(polar_xlog_buffer_desc_get_lock(buf));
+	evicted = (start_lsn != cur_page_lsn && !XLogRecPtrIsInvalid(end_lsn));
+
+	pg_atomic_write_u64(&buf->start_lsn, cur_page_lsn);
+	pg_atomic_write_u64(&buf->end_lsn, cur_page_lsn + len - 1);
+	memcpy(polar_get_xlog_buffer(buf->buf_id), cur_page, len);
+	xlog_buffer_end_write(buf);
+
+	if (evicted)
+		pg_atomic_fetch_add_u64(&polar_xlog_buffer_ins->evict_count, 1);
 
 	if (AmStartupProcess())
-	{
-		startup_append_count++;
 		pg_atomic_fetch_add_u64(&polar_xlog_buffer_ins->startup_append_count, 1);
-	}
 	else
-	{
-		others_append_count++;
 		pg_atomic_fetch_add_u64(&polar_xlog_buffer_ins->others_append_count, 1);
-	}
 
 	return true;
 }
@@ -299,54 +348,85 @@ void
 polar_xlog_buffer_update(XLogRecPtr lsn)
 {
 	XLogRecPtr	page_off = lsn - (lsn % XLOG_BLCKSZ);
-	int			buf_id = polar_get_xlog_buffer_id(lsn);
-	polar_xlog_buffer_desc *buf = NULL;
-
-	Assert(buf_id >= 0);
-
-	buf = polar_get_xlog_buffer_desc(buf_id);
-	LWLockAcquire(polar_xlog_buffer_desc_get_lock(buf), LW_EXCLUSIVE);
-
-	/*
-	 * Ensure page buffer the expected one. While stream replication broken,
-	 * xlog page may be read by twophase related logic. After startup replay
-	 * all xlog at local storage, it will invalidation xlog buffer data
-	 * related to last record. In some situation, this invalidation operation
-	 * may enlarge xlog buffer size at page without more data filled, so it
-	 * may cause zero data being read by other twophase related operation
-	 * which will print ERROR log when cannot read record. So we add the check
-	 * here to ensure updated lsn not larger than original buffer meta info,
-	 * because this update func is only used while meet invalid xlog record.
-	 */
-	if (buf->start_lsn == page_off && buf->end_lsn > lsn)
-		buf->end_lsn = lsn;
+	int			first_id = polar_get_xlog_buffer_set(lsn) * POLAR_XLOG_BUFFER_WAYS;
+	int			way;
 
-	LWLockRelease(polar_xlog_buffer_desc_get_lock(buf));
+	for (way = 0; way < POLAR_XLOG_BUFFER_WAYS; way++)
+	{
+		polar_xlog_buffer_desc *buf = polar_get_xlog_buffer_desc(first_id + way);
+
+		xlog_buffer_begin_write(buf, true);
+
+		/*
+		 * Ensure page buffer the expected one. While stream replication
+		 * broken, xlog page may be read by twophase related logic. After
+		 * startup replay all xlog at local storage, it will invalidation xlog
+		 * buffer data related to last record. In some situation, this
+		 * invalidation operation may enlarge xlog buffer size at page without
+		 * more data filled, so it may cause zero data being read by other
+		 * twophase related operation which will print ERROR log when cannot
+		 * read record. So we add the check here to ensure updated lsn not
+		 * larger than original buffer meta info, because this update func is
+		 * only used while meet invalid xlog record.
+		 */
+		if (pg_atomic_read_u64(&buf->start_lsn) == page_off &&
+			pg_atomic_read_u64(&buf->end_lsn) > lsn)
+			pg_atomic_write_u64(&buf->end_lsn, lsn);
+
+		xlog_buffer_end_write(buf);
+	}
 }
 
 /*
  * POLAR: Remove page from xlog buffer.
  *
- * If buffer is io-progress, it do nothing.
+ * It waits for the slots which are being written by others, so the page can't
+ * be read from xlog buffer after that.
  */
 void
 polar_xlog_buffer_remove(XLogRecPtr lsn)
 {
 	XLogRecPtr	page_off = lsn - (lsn % XLOG_BLCKSZ);
-	int			buf_id = polar_get_xlog_buffer_id(lsn);
-	polar_xlog_buffer_desc *buf = NULL;
+	int			first_id = polar_get_xlog_buffer_set(lsn) * POLAR_XLOG_BUFFER_WAYS;
+	int			way;
+
+	for (way = 0; way < POLAR_XLOG_BUFFER_WAYS; way++)
+	{
+		polar_xlog_buffer_desc *buf = polar_get_xlog_buffer_desc(first_id + way);
 
-	Assert(buf_id >= 0);
+		xlog_buffer_begin_write(buf, true);
 
-	buf = polar_get_xlog_buffer_desc(buf_id);
-	LWLockAcquire(polar_xlog_buffer_desc_get_lock(buf), LW_EXCLUSIVE);
+		/* Ensure page buffer the expected one */
+		if (pg_atomic_read_u64(&buf->start_lsn) == page_off)
+		{
+			pg_atomic_write_u64(&buf->start_lsn, InvalidXLogRecPtr);
+			pg_atomic_write_u64(&buf->end_lsn, InvalidXLogRecPtr);
+		}
+
+		xlog_buffer_end_write(buf);
+	}
+}
+
+/*
+ * POLAR: Get the end lsn of cached data of the page containing lsn.
+ *
+ * Return InvalidXLogRecPtr if the page is not cached.
+ */
+XLogRecPtr
+polar_xlog_buffer_get_end_lsn(XLogRecPtr lsn)
+{
+	XLogRecPtr	page_off = lsn - (lsn % XLOG_BLCKSZ);
+	int			first_id = polar_get_xlog_buffer_set(lsn) * POLAR_XLOG_BUFFER_WAYS;
+	int			way;
 
-	/* Ensure page buffer the expected one */
-	if (buf->start_lsn == page_off)
+	for (way = 0; way < POLAR_XLOG_BUFFER_WAYS; way++)
 	{
-		buf->start_lsn = InvalidXLogRecPtr;
-		buf->end_lsn = InvalidXLogRecPtr;
+		polar_xlog_buffer_desc *buf = polar_get_xlog_buffer_desc(first_id + way);
+		bool		collided = false;
+
+		if (xlog_buffer_read_slot(buf, page_off, 1, NULL, &collided))
+			return pg_atomic_read_u64(&buf->end_lsn);
 	}
 
-	LWLockRelease(polar_xlog_buffer_desc_get_lock(buf));
+	return InvalidXLogRecPtr;
 }
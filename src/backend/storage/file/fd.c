@@ -2382,6 +2382,25 @@ FileGetRawDesc(File file)
 	return VfdCache[file].fd;
 }
 
+/*
+ * POLAR: reopen the file if it has been closed by LRU, and return its raw
+ * file descriptor for asynchronous io. It's only valid until another file is
+ * opened, so the caller submits and waits for its io before that.
+ */
+int
+polar_file_access_raw_desc(File file)
+{
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	return VfdCache[file].fd;
+}
+
 /*
  * FileGetRawFlags - returns the file flags on open(2)
  */
@@ -41,6 +41,10 @@
 #include "utils/resowner.h"
 #include "utils/timeout.h"
 
+/* POLAR: GUCs */
+bool		polar_procpool_work_stealing = true;
+bool		polar_procpool_adaptive_queue_depth = true;
+
 typedef struct proc_hold_task_t
 {
 	dlist_node	node;
@@ -59,6 +63,7 @@ typedef struct sub_task_ctl_t
 	polar_task_sched_t *sched;
 	Latch	   *dispatcher_latch;
 	int32		sub_proc_id;
+	polar_sub_proc_stat_t *stat;
 	dlist_head	hold_tasks;
 	dlist_head	repeat_tasks;
 
@@ -105,6 +110,10 @@ polar_calc_task_sched_shmem_size(Size parallel_num, Size task_node_size, Size ta
 		size = offsetof(polar_task_sched_t, task_nodes);
 
 		size = add_size(size, mul_size(parallel_num, mul_size(task_node_size, task_queue_depth)));
+
+		/* Statistics of sub processes, see POLAR_SCHED_PROC_STAT */
+		size = MAXALIGN(size);
+		size = add_size(size, mul_size(parallel_num, sizeof(polar_sub_proc_stat_t)));
 	}
 
 	return size;
@@ -146,6 +155,7 @@ polar_create_proc_task_sched(const char *sched_name, Size parallel_num,
 	bool		found;
 	polar_task_sched_t *sched;
 	Size		size;
+	Size		i;
 
 	size = polar_calc_task_sched_shmem_size(parallel_num, task_node_size, task_queue_depth);
 	sched = (polar_task_sched_t *) ShmemInitStruct(sched_name, size, &found);
@@ -163,6 +173,22 @@ polar_create_proc_task_sched(const char *sched_name, Size parallel_num,
 		sched->added_seq = 0;
 		pg_atomic_init_u32(&sched->enable_shutdown, 0);
 		pg_atomic_init_u64(&sched->finished_seq, 0);
+
+		for (i = 0; i < parallel_num; i++)
+		{
+			polar_sub_proc_stat_t *stat = POLAR_SCHED_PROC_STAT(sched, i);
+
+			pg_atomic_init_u32(&stat->pid, 0);
+			pg_atomic_init_u32(&stat->idle, 0);
+			pg_atomic_init_u32(&stat->depth_limit, task_queue_depth);
+			pg_atomic_init_u32(&stat->queued_tasks, 0);
+			pg_atomic_init_u64(&stat->fetched_seq, 0);
+			pg_atomic_init_u64(&stat->handled_tasks, 0);
+			pg_atomic_init_u64(&stat->stolen_tasks, 0);
+			pg_atomic_init_u64(&stat->lost_tasks, 0);
+			pg_atomic_init_u64(&stat->busy_us, 0);
+			pg_atomic_init_u64(&stat->idle_us, 0);
+		}
 	}
 
 	return sched;
@@ -185,6 +211,7 @@ polar_ring_task_nodes_init(polar_task_sched_ctl_t *ctl, int proc_num)
 {
 	polar_task_sched_t *sched = ctl->sched;
 	polar_sub_proc_t *sub_proc = &ctl->sub_proc[proc_num];
+	polar_sub_proc_stat_t *stat;
 	char	   *p = (char *) (sched->task_nodes);
 
 	sub_proc->ring_task_nodes_begin = (polar_task_node_t *) (p + (proc_num * sched->task_node_size * sched->task_queue_depth));
@@ -193,6 +220,15 @@ polar_ring_task_nodes_init(polar_task_sched_ctl_t *ctl, int proc_num)
 	sub_proc->task_head = sub_proc->ring_task_nodes_begin;
 	sub_proc->task_tail = sub_proc->ring_task_nodes_begin;
 	sub_proc->ring_full = false;
+	sub_proc->queued_tasks = 0;
+	sub_proc->depth_limit = sched->task_queue_depth;
+	sub_proc->reset_tasks = 0;
+
+	stat = POLAR_SCHED_PROC_STAT(sched, proc_num);
+	pg_atomic_write_u32(&stat->idle, 0);
+	pg_atomic_write_u32(&stat->depth_limit, sub_proc->depth_limit);
+	pg_atomic_write_u32(&stat->queued_tasks, 0);
+	pg_atomic_write_u64(&stat->fetched_seq, 0);
 }
 
 polar_task_sched_ctl_t *
@@ -257,6 +293,33 @@ sub_task_update_ps_display(int32 sub_id)
 	pfree(new_status);
 }
 
+/*
+ * POLAR: Claim a running task to handle it in this process. Both the owner of
+ * the ring and the stealers claim tasks by this CAS, so one task is handled
+ * only once.
+ */
+static bool
+sub_task_claim(polar_task_node_t *task)
+{
+	uint32		status = pg_atomic_read_u32(&task->task_status);
+
+	if ((status & POLAR_TASK_NODE_STATUS_MASK) != POLAR_TASK_NODE_RUNNING)
+		return false;
+
+	return pg_atomic_compare_exchange_u32(&task->task_status, &status,
+										  (status & POLAR_TASK_NODE_PROC_MASK) | POLAR_TASK_NODE_FETCHED);
+}
+
+static void
+sub_task_advance_fetch_seq(sub_task_ctl_t * task_ctl, polar_task_node_t *task)
+{
+	task_ctl->fetch_task_idx++;
+	task_ctl->max_fetch_seq = task->add_seq;
+
+	/* Dispatcher can reset the tasks which we passed */
+	pg_atomic_write_u64(&task_ctl->stat->fetched_seq, task_ctl->max_fetch_seq);
+}
+
 static polar_task_node_t *
 fetch_waiting_task_from_repeat_list(sub_task_ctl_t * task_ctl)
 {
@@ -281,9 +344,9 @@ fetch_waiting_task_from_repeat_list(sub_task_ctl_t * task_ctl)
 
 		status = POLAR_TASK_NODE_STATUS(repeat_task->task);
 
-		if (unlikely(status != POLAR_TASK_NODE_RUNNING))
+		if (unlikely(status != POLAR_TASK_NODE_FETCHED))
 		{
-			elog(PANIC, "Task status is incorrect in %s, expected POLAR_TASK_NODE_RUNNING, got %x, task_addr %p",
+			elog(PANIC, "Task status is incorrect in %s, expected POLAR_TASK_NODE_FETCHED, got %x, task_addr %p",
 				 PG_FUNCNAME_MACRO, status, repeat_task->task);
 		}
 
@@ -328,15 +391,22 @@ fetch_waiting_task_from_hold_list(sub_task_ctl_t * task_ctl)
 
 		status = POLAR_TASK_NODE_STATUS(hold_task->task);
 
-		POLAR_ASSERT_PANIC(status == POLAR_TASK_NODE_HOLD || status == POLAR_TASK_NODE_RUNNING);
-
-		if (status == POLAR_TASK_NODE_RUNNING)
+		/*
+		 * The hold task may be stolen by other process after it becomes
+		 * running, and its node may even be reused by dispatcher. Remove it
+		 * from the list unless it's still hold.
+		 */
+		if (status != POLAR_TASK_NODE_HOLD)
 		{
-			running_task = hold_task->task;
+			if (status == POLAR_TASK_NODE_RUNNING && sub_task_claim(hold_task->task))
+				running_task = hold_task->task;
+
 			dlist_delete(cur_node);
 			pfree(hold_task);
 			task_ctl->remove_hold_task++;
-			break;
+
+			if (running_task)
+				break;
 		}
 
 		cur_node = next_node;
@@ -361,7 +431,7 @@ proc_add_repeat_task(sub_task_ctl_t * task_ctl, polar_task_node_t *task)
 {
 	proc_repeat_task_t *repeat_task;
 
-	POLAR_ASSERT_PANIC(POLAR_TASK_NODE_RUNNING == POLAR_TASK_NODE_STATUS(task));
+	POLAR_ASSERT_PANIC(POLAR_TASK_NODE_FETCHED == POLAR_TASK_NODE_STATUS(task));
 
 	repeat_task = palloc0(sizeof(proc_repeat_task_t));
 	repeat_task->task = task;
@@ -403,17 +473,31 @@ fetch_waiting_task_from_queue(sub_task_ctl_t * task_ctl)
 
 			if (status == POLAR_TASK_NODE_RUNNING)
 			{
-				task_ctl->fetch_task_idx++;
+				/* Check this task again if it's stolen right now */
+				if (!sub_task_claim(dst_task))
+					continue;
+
+				sub_task_advance_fetch_seq(task_ctl, dst_task);
 				task_ctl->fetch_running_task++;
-				task_ctl->max_fetch_seq = dst_task->add_seq;
 
 				return dst_task;
 			}
 			else if (status == POLAR_TASK_NODE_HOLD)
 			{
 				proc_add_hold_task(task_ctl, dst_task);
-				task_ctl->fetch_task_idx++;
-				task_ctl->max_fetch_seq = dst_task->add_seq;
+				sub_task_advance_fetch_seq(task_ctl, dst_task);
+			}
+			else if (status == POLAR_TASK_NODE_FETCHED ||
+					 status == POLAR_TASK_NODE_FINISHED ||
+					 status == POLAR_TASK_NODE_REMOVED)
+			{
+				/*
+				 * Stolen by other process. Dispatcher won't reset it until we
+				 * pass it, so the order of add_seq in this ring is kept.
+				 */
+				sub_task_advance_fetch_seq(task_ctl, dst_task);
+				pg_atomic_write_u64(&task_ctl->stat->lost_tasks,
+									pg_atomic_read_u64(&task_ctl->stat->lost_tasks) + 1);
 			}
 			else if (status != POLAR_TASK_NODE_IDLE)
 			{
@@ -442,12 +526,72 @@ fetch_waiting_task_node(sub_task_ctl_t * task_ctl)
 	return fetch_waiting_task_from_queue(task_ctl);
 }
 
+/*
+ * POLAR: Steal one task from the ring of other process when this process is
+ * idle. Only running task can be stolen, which means all the previous tasks
+ * with the same tag are finished, so tasks with the same tag are still handled
+ * in order. The oldest one is chosen to advance the running queue head.
+ */
+static polar_task_node_t *
+steal_waiting_task(sub_task_ctl_t * task_ctl)
+{
+	polar_task_sched_t *sched = task_ctl->sched;
+	uint32		i;
+
+	if (!polar_procpool_work_stealing || sched->total_proc < 2)
+		return NULL;
+
+	for (i = 1; i < sched->total_proc; i++)
+	{
+		uint32		victim = (task_ctl->sub_proc_id + i) % sched->total_proc;
+		polar_sub_proc_stat_t *stat = POLAR_SCHED_PROC_STAT(sched, victim);
+		polar_task_node_t *begin,
+				   *oldest = NULL;
+		uint64		oldest_seq = PG_UINT64_MAX;
+		Size		j;
+
+		/* Leave the only queued task to its owner */
+		if (pg_atomic_read_u32(&stat->queued_tasks) < 2)
+			continue;
+
+		begin = POLAR_SCHED_TASK_POINT(sched, sched->task_nodes, victim * sched->task_queue_depth);
+
+		for (j = 0; j < sched->task_queue_depth; j++)
+		{
+			polar_task_node_t *task = POLAR_SCHED_TASK_POINT(sched, begin, j);
+			uint64		seq = task->add_seq;
+
+			pg_read_barrier();
+
+			if (seq != 0 && seq < oldest_seq &&
+				POLAR_TASK_NODE_STATUS(task) == POLAR_TASK_NODE_RUNNING)
+			{
+				oldest = task;
+				oldest_seq = seq;
+			}
+		}
+
+		/*
+		 * The node may be reused after we scanned it, but the claimed one is
+		 * always a running task which no one else handles.
+		 */
+		if (oldest != NULL && sub_task_claim(oldest))
+		{
+			pg_atomic_write_u64(&task_ctl->stat->stolen_tasks,
+								pg_atomic_read_u64(&task_ctl->stat->stolen_tasks) + 1);
+			return oldest;
+		}
+	}
+
+	return NULL;
+}
+
 static bool
 proc_task_queue_is_full(polar_task_sched_ctl_t *ctl, uint32 sub_proc)
 {
 	polar_sub_proc_t *proc = &ctl->sub_proc[sub_proc];
 
-	return proc->ring_full;
+	return proc->ring_full || proc->queued_tasks >= proc->depth_limit;
 }
 
 static PGPROC *
@@ -465,11 +609,17 @@ polar_sched_get_worker_proc(BackgroundWorkerHandle *handle)
 	return NULL;
 }
 
+/*
+ * POLAR: Choose the process which has the least queued tasks, start from
+ * dst_proc to break the tie in round-robin.
+ */
 static int
 polar_sched_get_next_proc(polar_task_sched_ctl_t *ctl)
 {
 	polar_task_sched_t *sched = ctl->sched;
 	int			i;
+	int			dst_proc = -1;
+	uint32		min_queued = PG_UINT32_MAX;
 
 	for (i = 0; i < sched->total_proc; i++)
 	{
@@ -490,11 +640,24 @@ polar_sched_get_next_proc(polar_task_sched_ctl_t *ctl)
 				continue;
 		}
 
-		if (!proc_task_queue_is_full(ctl, proc_num))
-			return proc_num;
+		if (!proc_task_queue_is_full(ctl, proc_num) &&
+			ctl->sub_proc[proc_num].queued_tasks < min_queued)
+		{
+			dst_proc = proc_num;
+			min_queued = ctl->sub_proc[proc_num].queued_tasks;
+
+			if (min_queued == 0)
+				break;
+		}
+	}
+
+	if (dst_proc != -1)
+	{
+		ctl->dst_proc = dst_proc;
+		NEXT_SCHED_PROC(ctl);
 	}
 
-	return -1;
+	return dst_proc;
 }
 
 static int
@@ -546,6 +709,7 @@ polar_sched_proc_advance_ring(polar_task_sched_ctl_t *ctl, polar_sub_proc_t *pro
 
 	POLAR_SCHED_TASK_ADVANCE(sched, proc, proc->task_head);
 	proc->ring_full = (proc->task_head == proc->task_tail);
+	proc->queued_tasks++;
 }
 
 static void
@@ -555,6 +719,8 @@ polar_sched_proc_retreat_ring(polar_task_sched_ctl_t *ctl, polar_sub_proc_t *pro
 
 	proc->ring_full = false;
 	POLAR_SCHED_TASK_ADVANCE(sched, proc, proc->task_tail);
+	proc->queued_tasks--;
+	proc->reset_tasks++;
 }
 
 static void
@@ -667,10 +833,74 @@ polar_sched_proc_add_task(polar_task_sched_ctl_t *ctl, int32 dst_proc_num, polar
 
 	polar_sched_proc_advance_ring(ctl, proc);
 	proc->running_tasks_num++;
+	pg_atomic_write_u32(&POLAR_SCHED_PROC_STAT(sched, dst_proc_num)->queued_tasks, proc->queued_tasks);
 
 	return dst_node;
 }
 
+/*
+ * POLAR: Wake up one idle process to steal tasks when the destination process
+ * has a backlog. Pairs with the barrier after sub process marks itself idle.
+ */
+static void
+polar_sched_wakeup_idle_proc(polar_task_sched_ctl_t *ctl, int32 busy_proc)
+{
+	polar_task_sched_t *sched = ctl->sched;
+	int			i;
+
+	pg_memory_barrier();
+
+	for (i = 0; i < sched->total_proc; i++)
+	{
+		if (i == busy_proc || ctl->sub_proc[i].proc == NULL)
+			continue;
+
+		if (pg_atomic_read_u32(&POLAR_SCHED_PROC_STAT(sched, i)->idle) != 0)
+		{
+			SetLatch(&ctl->sub_proc[i].proc->procLatch);
+			break;
+		}
+	}
+}
+
+/*
+ * POLAR: Adjust queue depth of each process by its throughput in the last
+ * interval, so that fewer tasks wait behind a slow process. If dispatcher failed
+ * to add task in this interval, all the queues are allowed to be deeper.
+ */
+static void
+polar_sched_adapt_queue_depth(polar_task_sched_ctl_t *ctl)
+{
+	polar_task_sched_t *sched = ctl->sched;
+	uint32		min_depth = Max(sched->task_queue_depth / 8, 1);
+	bool		blocked = ctl->fail_add_task_num > ctl->adapt_fail_num;
+	uint64		max_reset = 0;
+	int			i;
+
+	for (i = 0; i < sched->total_proc; i++)
+		max_reset = Max(max_reset, ctl->sub_proc[i].reset_tasks);
+
+	for (i = 0; i < sched->total_proc; i++)
+	{
+		polar_sub_proc_t *proc = &ctl->sub_proc[i];
+		uint32		depth = proc->depth_limit;
+
+		if (!polar_procpool_adaptive_queue_depth)
+			depth = sched->task_queue_depth;
+		else if (blocked)
+			depth = Min(depth * 2, sched->task_queue_depth);
+		else if (max_reset > 0)
+			depth = Max(sched->task_queue_depth * proc->reset_tasks / max_reset, min_depth);
+
+		proc->depth_limit = depth;
+		proc->reset_tasks = 0;
+		pg_atomic_write_u32(&POLAR_SCHED_PROC_STAT(sched, i)->depth_limit, depth);
+	}
+
+	ctl->adapt_added_num = ctl->added_task_num;
+	ctl->adapt_fail_num = ctl->fail_add_task_num;
+}
+
 
 polar_task_node_t *
 polar_sched_add_task(polar_task_sched_ctl_t *ctl, polar_task_node_t *task)
@@ -688,6 +918,12 @@ polar_sched_add_task(polar_task_sched_ctl_t *ctl, polar_task_node_t *task)
 
 	dst_node = polar_sched_proc_add_task(ctl, dst_proc, task);
 
+	if (polar_procpool_work_stealing && ctl->sub_proc[dst_proc].queued_tasks > 1)
+		polar_sched_wakeup_idle_proc(ctl, dst_proc);
+
+	if (ctl->added_task_num - ctl->adapt_added_num >= POLAR_SCHED_ADAPT_DEPTH_INTERVAL)
+		polar_sched_adapt_queue_depth(ctl);
+
 	return dst_node;
 }
 
@@ -824,6 +1060,8 @@ polar_sched_proc_reset_removed_tasks(polar_task_sched_ctl_t *ctl)
 	for (i = 0; i < sched->total_proc; i++)
 	{
 		polar_sub_proc_t *proc = &ctl->sub_proc[i];
+		polar_sub_proc_stat_t *stat = POLAR_SCHED_PROC_STAT(sched, i);
+		uint64		fetched_seq = pg_atomic_read_u64(&stat->fetched_seq);
 
 		while (!TASK_QUEUE_IS_EMPTY(proc))
 		{
@@ -832,11 +1070,20 @@ polar_sched_proc_reset_removed_tasks(polar_task_sched_ctl_t *ctl)
 			if (POLAR_TASK_NODE_STATUS(task) != POLAR_TASK_NODE_REMOVED)
 				break;
 
+			/*
+			 * The task is stolen and finished, but the owner doesn't pass it
+			 * yet. Keep it to make the owner see add_seq in order.
+			 */
+			if (task->add_seq > fetched_seq)
+				break;
+
 			POLAR_RESET_TASK_NODE(task);
 
 			polar_sched_proc_retreat_ring(ctl, proc);
 			removed++;
 		}
+
+		pg_atomic_write_u32(&stat->queued_tasks, proc->queued_tasks);
 	}
 
 	ctl->reset_task_num += removed;
@@ -880,6 +1127,8 @@ polar_sub_task_main(Datum main_arg)
 	POLAR_ASSERT_PANIC(MyProc != NULL && MyLatch == &MyProc->procLatch);
 
 	task_ctl.fetch_task_idx = 0;
+	task_ctl.stat = POLAR_SCHED_PROC_STAT(task_ctl.sched, task_ctl.sub_proc_id);
+	pg_atomic_write_u32(&task_ctl.stat->pid, MyProcPid);
 	dlist_init(&task_ctl.hold_tasks);
 	dlist_init(&task_ctl.repeat_tasks);
 	sub_task_update_ps_display(task_ctl.sub_proc_id);
@@ -913,6 +1162,11 @@ polar_sub_task_main(Datum main_arg)
 	{
 		int			rc = 0;
 		polar_task_node_t *task;
+		polar_task_node_t *next_task = NULL;
+		Latch	   *next_latch = NULL;
+		instr_time	start,
+					duration;
+		bool		handled;
 
 		/*
 		 * Exit this process if we get sigterm signal and parallel schedule
@@ -933,62 +1187,96 @@ polar_sub_task_main(Datum main_arg)
 
 		task = fetch_waiting_task_node(&task_ctl);
 
-		if (task != NULL)
+		if (task == NULL)
+			task = steal_waiting_task(&task_ctl);
+
+		if (task == NULL)
 		{
-			polar_task_node_t *next_task = NULL;
-			Latch	   *next_latch = NULL;
+			int			evt = WL_LATCH_SET | WL_EXIT_ON_PM_DEATH;
+			int			timeout = -1;
 
-			if (!task_ctl.sched->task_handle(task_ctl.sched, task))
+			if (!dlist_is_empty(&task_ctl.repeat_tasks))
 			{
-				proc_add_repeat_task(&task_ctl, task);
-				continue;
+				evt |= WL_TIMEOUT;
+				timeout = 10;	/* ms */
 			}
 
-			task->finished_seq = pg_atomic_fetch_add_u64(&(task_ctl.sched->finished_seq), 1);
+			/*
+			 * Dispatcher wakes up idle process when there's task to steal.
+			 * Check again after we're marked idle, in case the dispatcher
+			 * added tasks before it saw us.
+			 */
+			pg_atomic_write_u32(&task_ctl.stat->idle, 1);
+			pg_memory_barrier();
 
-			SpinLockAcquire(&task->lock);
-			next_latch = task->next_latch;
+			task = steal_waiting_task(&task_ctl);
 
-			if (next_latch)
+			if (task == NULL)
 			{
-				next_task = (polar_task_node_t *) SHMQueueNext(&task->depend_task, &task->depend_task,
-															   offsetof(polar_task_node_t, depend_task));
-			}
+				INSTR_TIME_SET_CURRENT(start);
+				rc = WaitLatch(MyLatch, evt, timeout, WAIT_EVENT_POLAR_SUB_TASK_MAIN);
+				INSTR_TIME_SET_CURRENT(duration);
+				INSTR_TIME_SUBTRACT(duration, start);
 
-			POLAR_UPDATE_TASK_NODE_STATUS(task, POLAR_TASK_NODE_FINISHED);
-			SpinLockRelease(&task->lock);
+				pg_atomic_write_u64(&task_ctl.stat->idle_us,
+									pg_atomic_read_u64(&task_ctl.stat->idle_us) + INSTR_TIME_GET_MICROSEC(duration));
 
-			if (next_latch)
-			{
-				POLAR_ASSERT_PANIC(next_task != NULL);
-				POLAR_ASSERT_PANIC(POLAR_TASK_NODE_STATUS(next_task) == POLAR_TASK_NODE_HOLD);
+				if (rc & WL_LATCH_SET)
+					ResetLatch(MyLatch);
+			}
 
-				POLAR_UPDATE_TASK_NODE_STATUS(next_task, POLAR_TASK_NODE_RUNNING);
+			pg_atomic_write_u32(&task_ctl.stat->idle, 0);
 
-				if (next_latch != MyLatch)
-					SetLatch(next_latch);
-			}
+			if (task == NULL)
+				continue;
+		}
+
+		INSTR_TIME_SET_CURRENT(start);
+		handled = task_ctl.sched->task_handle(task_ctl.sched, task);
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+		pg_atomic_write_u64(&task_ctl.stat->busy_us,
+							pg_atomic_read_u64(&task_ctl.stat->busy_us) + INSTR_TIME_GET_MICROSEC(duration));
 
-			SetLatch(dispatcher_latch);
+		if (!handled)
+		{
+			proc_add_repeat_task(&task_ctl, task);
+			continue;
 		}
-		else
+
+		pg_atomic_write_u64(&task_ctl.stat->handled_tasks,
+							pg_atomic_read_u64(&task_ctl.stat->handled_tasks) + 1);
+
+		task->finished_seq = pg_atomic_fetch_add_u64(&(task_ctl.sched->finished_seq), 1);
+
+		SpinLockAcquire(&task->lock);
+		next_latch = task->next_latch;
+
+		if (next_latch)
 		{
-			int			evt = WL_LATCH_SET | WL_EXIT_ON_PM_DEATH;
-			int			timeout = -1;
+			next_task = (polar_task_node_t *) SHMQueueNext(&task->depend_task, &task->depend_task,
+														   offsetof(polar_task_node_t, depend_task));
+		}
 
-			if (!dlist_is_empty(&task_ctl.repeat_tasks))
-			{
-				evt |= WL_TIMEOUT;
-				timeout = 10;	/* ms */
-			}
+		POLAR_UPDATE_TASK_NODE_STATUS(task, POLAR_TASK_NODE_FINISHED);
+		SpinLockRelease(&task->lock);
 
-			rc = WaitLatch(MyLatch, evt, timeout, WAIT_EVENT_POLAR_SUB_TASK_MAIN);
+		if (next_latch)
+		{
+			POLAR_ASSERT_PANIC(next_task != NULL);
+			POLAR_ASSERT_PANIC(POLAR_TASK_NODE_STATUS(next_task) == POLAR_TASK_NODE_HOLD);
+
+			POLAR_UPDATE_TASK_NODE_STATUS(next_task, POLAR_TASK_NODE_RUNNING);
 
-			if (rc & WL_LATCH_SET)
-				ResetLatch(MyLatch);
+			if (next_latch != MyLatch)
+				SetLatch(next_latch);
 		}
+
+		SetLatch(dispatcher_latch);
 	}
 
+	pg_atomic_write_u32(&task_ctl.stat->pid, 0);
+
 	elog(LOG, "PolarDB proc pool exit subprocess %d for %s, fetch_running_task=%ld, add_hold_task=%ld, remove_hold_task=%ld, add_repeat_task=%ld, remove_repeat_task=%ld",
 		 task_ctl.sub_proc_id, task_ctl.sched->name,
 		 task_ctl.fetch_running_task, task_ctl.add_hold_task, task_ctl.remove_hold_task,
@@ -1048,8 +1336,7 @@ void
 polar_release_task_sched_ctl(polar_task_sched_ctl_t *ctl)
 {
 	int			i;
-	Size		size,
-				task_nodes_size;
+	Size		task_nodes_size;
 	polar_task_sched_t *sched = ctl->sched;
 	char	   *task_nodes_ptr = ((char *) sched) + offsetof(polar_task_sched_t, task_nodes);
 
@@ -1077,8 +1364,8 @@ polar_release_task_sched_ctl(polar_task_sched_ctl_t *ctl)
 
 	hash_destroy(ctl->task_hash);
 
-	size = polar_calc_task_sched_shmem_size(sched->total_proc, sched->task_node_size, sched->task_queue_depth);
-	task_nodes_size = size - offsetof(polar_task_sched_t, task_nodes);
+	/* Keep the statistics of sub processes */
+	task_nodes_size = POLAR_SCHED_TASK_NODES_SIZE(sched->total_proc, sched->task_node_size, sched->task_queue_depth);
 
 	MemSet(task_nodes_ptr, 0, task_nodes_size);
 
@@ -233,8 +233,6 @@ static const char *const BuiltinTrancheNames[] = {
 	"multixact_offset_local_cache",
 	/* LWTRANCHE_POLAR_MULTIXACT_MEMBER_LOCAL_CACHE: */
 	"multixact_member_local_cache",
-	/* LWTRANCHE_XLOG_BUFFER_CONTENT: */
-	"xlog_buffer_content",
 	/* LWTRANCHE_POLAR_RSC_MAPPING_LOCKS: */
 	"PolarRSCMapping",
 	/* LWTRANCHE_POLAR_ASYNC_LOCK_REPLAY: */
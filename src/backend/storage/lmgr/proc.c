@@ -183,6 +183,7 @@ InitProcGlobal(void)
 	ProcGlobal->checkpointerLatch = NULL;
 	pg_atomic_init_u32(&ProcGlobal->procArrayGroupFirst, INVALID_PGPROCNO);
 	pg_atomic_init_u32(&ProcGlobal->clogGroupFirst, INVALID_PGPROCNO);
+	pg_atomic_init_u32(&ProcGlobal->polarWalFlushGroupFirst, INVALID_PGPROCNO);
 
 	/*
 	 * Create and initialize all the PGPROC structures we'll need.  There are
@@ -280,6 +281,7 @@ InitProcGlobal(void)
 		 */
 		pg_atomic_init_u32(&(procs[i].procArrayGroupNext), INVALID_PGPROCNO);
 		pg_atomic_init_u32(&(procs[i].clogGroupNext), INVALID_PGPROCNO);
+		pg_atomic_init_u32(&(procs[i].polarWalFlushGroupNext), INVALID_PGPROCNO);
 		pg_atomic_init_u64(&(procs[i].waitStart), 0);
 	}
 
@@ -427,6 +429,11 @@ InitProcess(void)
 	MyProc->procArrayGroupMemberXid = InvalidTransactionId;
 	Assert(pg_atomic_read_u32(&MyProc->procArrayGroupNext) == INVALID_PGPROCNO);
 
+	/* POLAR: initialize fields for WAL group flush */
+	MyProc->polarWalFlushGroupMember = false;
+	MyProc->polarWalFlushGroupLsn = InvalidXLogRecPtr;
+	Assert(pg_atomic_read_u32(&MyProc->polarWalFlushGroupNext) == INVALID_PGPROCNO);
+
 	/* Check that group locking fields are in a proper initial state. */
 	Assert(MyProc->lockGroupLeader == NULL);
 	Assert(dlist_is_empty(&MyProc->lockGroupMembers));
@@ -607,6 +614,10 @@ InitAuxiliaryProcess(void)
 	MyProc->waitLock = NULL;
 	MyProc->waitProcLock = NULL;
 	pg_atomic_write_u64(&MyProc->waitStart, 0);
+	/* POLAR: initialize fields for WAL group flush */
+	MyProc->polarWalFlushGroupMember = false;
+	MyProc->polarWalFlushGroupLsn = InvalidXLogRecPtr;
+	Assert(pg_atomic_read_u32(&MyProc->polarWalFlushGroupNext) == INVALID_PGPROCNO);
 	/* POLAR: initialize wait event information. */
 	{
 		int			i;
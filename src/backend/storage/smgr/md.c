@@ -1549,6 +1549,109 @@ polar_mdbulkextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		register_dirty_segment(reln, forknum, v);
 }
 
+/*
+ *  POLAR: bulk write
+ *
+ *	polar_mdbulkwrite() -- Write the supplied continuous blocks at the appropriate location.
+ *
+ *  Like mdwrite(), this is to be used only for updating already-existing blocks.
+ *  Caller must ensure that the blocks do not cross a segment boundary.
+ */
+void
+polar_mdbulkwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+				  int blockCount, char *buffer, bool skipFsync)
+{
+	off_t		seekpos;
+	int			nbytes;
+	MdfdVec    *v;
+	int			amount = blockCount * BLCKSZ;
+
+	AssertPointerAlignment(buffer, POLAR_BUFFER_ALIGN_LEN);
+
+	TRACE_POSTGRESQL_SMGR_MD_WRITE_START(forknum, blocknum,
+										 reln->smgr_rnode.node.spcNode,
+										 reln->smgr_rnode.node.dbNode,
+										 reln->smgr_rnode.node.relNode,
+										 reln->smgr_rnode.backend);
+
+	v = _mdfd_getseg(reln, forknum, blocknum, skipFsync,
+					 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+	seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+	Assert(seekpos + (off_t) amount <= (off_t) BLCKSZ * RELSEG_SIZE);
+
+	nbytes = FileWrite(v->mdfd_vfd, buffer, amount, seekpos, WAIT_EVENT_DATA_FILE_WRITE);
+
+	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
+										reln->smgr_rnode.node.spcNode,
+										reln->smgr_rnode.node.dbNode,
+										reln->smgr_rnode.node.relNode,
+										reln->smgr_rnode.backend,
+										nbytes,
+										amount);
+
+	if (nbytes != amount)
+	{
+		if (nbytes < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write block %u in file \"%s\": %m",
+							blocknum, FilePathName(v->mdfd_vfd))));
+		/* short write: complain appropriately */
+		ereport(ERROR,
+				(errcode(ERRCODE_DISK_FULL),
+				 errmsg("could not bulk write block %u in file \"%s\": wrote only %d of %d bytes",
+						blocknum,
+						FilePathName(v->mdfd_vfd),
+						nbytes, amount),
+				 errhint("Check free disk space.")));
+	}
+
+	if (!skipFsync && !SmgrIsTemp(reln))
+		register_dirty_segment(reln, forknum, v);
+}
+
+/*
+ *  POLAR: asynchronous bulk read
+ *
+ *	polar_mdbulkread_req() -- Fill req to read the specified continuous blocks
+ *		by polar_aio_submit(). Returns false if the segment doesn't exist.
+ *
+ *  The fd of req is only valid until another file is opened.
+ */
+bool
+polar_mdbulkread_req(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+					 int blockCount, char *buffer, polar_aio_req *req)
+{
+	off_t		seekpos;
+	MdfdVec    *v;
+	int			fd;
+
+	AssertPointerAlignment(buffer, POLAR_BUFFER_ALIGN_LEN);
+
+	v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_RETURN_NULL);
+	if (v == NULL)
+		return false;
+
+	seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+	Assert(seekpos + (off_t) BLCKSZ * blockCount <= (off_t) BLCKSZ * RELSEG_SIZE);
+
+	fd = polar_file_access_raw_desc(v->mdfd_vfd);
+	if (fd < 0)
+		return false;
+
+	req->op = POLAR_AIO_READ;
+	req->fd = fd;
+	req->buf = buffer;
+	req->len = (size_t) blockCount * BLCKSZ;
+	req->offset = seekpos;
+
+	return true;
+}
+
 /*
  *  POLAR: bulk read
  *
@@ -25,9 +25,11 @@
 
 #include "postgres.h"
 
+#include "port/pg_bitutils.h"
 #include "storage/ipc.h"
 #include "storage/lwlock.h"
 #include "storage/polar_rsc.h"
+#include "storage/proc.h"
 #include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "storage/s_lock.h"
@@ -55,6 +57,22 @@ static polar_rsc_shared_relation_t *rsc_ref_held = NULL;
 static polar_rsc_shared_relation_pool_t *rsc_pool = NULL;
 static HTAB *rsc_mappings = NULL;
 
+/*
+ * Hints of the mapping table for lock-free lookup. The slot of a hash value
+ * keeps the index + 1 of the shared relation mapped latest by a relation of
+ * this hash value, 0 if none. A hint may be stale or overwritten by another
+ * relation, lookup checks the shared relation itself and falls back to the
+ * mapping table.
+ */
+static pg_atomic_uint32 *rsc_hints = NULL;
+static uint32 rsc_hint_mask = 0;
+
+static uint32
+rsc_hint_slots(void)
+{
+	return pg_nextpower2_32(Max(polar_rsc_shared_relations * 2, 2));
+}
+
 size_t
 polar_rsc_shmem_size(void)
 {
@@ -69,6 +87,7 @@ polar_rsc_shmem_size(void)
 	size = add_size(size,
 					hash_estimate_size(polar_rsc_shared_relations,
 									   sizeof(polar_rsc_shared_relation_mapping_t)));
+	size = add_size(size, mul_size(rsc_hint_slots(), sizeof(pg_atomic_uint32)));
 	size = add_size(size, MAXALIGN(sizeof(polar_rsc_stat_t)));
 
 	return size;
@@ -99,7 +118,10 @@ polar_rsc_shmem_init(void)
 							   &found);
 	if (!found)
 	{
-		pg_atomic_init_u32(&rsc_pool->next_sweep, 0);
+		rsc_pool->num_sweep_partitions = Min(POLAR_RSC_SWEEP_PARTITIONS,
+											 polar_rsc_shared_relations);
+		for (i = 0; i < POLAR_RSC_SWEEP_PARTITIONS; i++)
+			pg_atomic_init_u32(&rsc_pool->sweep_partitions[i].next_sweep, 0);
 		for (i = 0; i < polar_rsc_shared_relations; i++)
 		{
 			pg_atomic_init_u32(&rsc_pool->entries[i].flags, 0);
@@ -108,6 +130,16 @@ polar_rsc_shmem_init(void)
 		}
 	}
 
+	rsc_hint_mask = rsc_hint_slots() - 1;
+	rsc_hints = ShmemInitStruct("PolarDB RSC shared relation hints",
+								sizeof(pg_atomic_uint32) * (rsc_hint_mask + 1),
+								&found);
+	if (!found)
+	{
+		for (i = 0; i <= rsc_hint_mask; i++)
+			pg_atomic_init_u32(&rsc_hints[i], 0);
+	}
+
 	polar_rsc_global_stat = ShmemInitStruct("Polar RSC statistics",
 											sizeof(polar_rsc_stat_t), &found);
 	if (!found)
@@ -216,6 +248,69 @@ polar_rsc_search_by_ref(SMgrRelation reln, ForkNumber forknum)
 	return InvalidBlockNumber;
 }
 
+static inline void
+rsc_set_hint(uint32 hash, polar_rsc_shared_relation_t *sr)
+{
+	pg_atomic_write_u32(&rsc_hints[hash & rsc_hint_mask],
+						(sr - rsc_pool->entries) + 1);
+}
+
+/*
+ * Search the shared relation of the hint without any lock.
+ *
+ * Shared relations are only repurposed with RSC_LOCKED set, and a mapping
+ * change always bumps the generation: invalidation bumps it before clearing
+ * RSC_VALID, and a new mapping bumps it after rnode and nblocks are set but
+ * before RSC_VALID is set. So if the shared relation is valid and unlocked
+ * before and after reading it, and the generation is not changed, the rnode
+ * and nblocks read are of one mapping.
+ */
+static BlockNumber
+rsc_search_by_hint(SMgrRelation reln, ForkNumber forknum, uint32 hash)
+{
+	polar_rsc_shared_relation_t *sr;
+	uint32		index;
+	uint32		flags;
+	uint64		generation;
+	bool		match;
+	BlockNumber result;
+
+	index = pg_atomic_read_u32(&rsc_hints[hash & rsc_hint_mask]);
+	if (index == 0)
+		return InvalidBlockNumber;
+
+	sr = &rsc_pool->entries[index - 1];
+
+	flags = pg_atomic_read_u32(&sr->flags);
+	if ((flags & (RSC_LOCKED | RSC_VALID)) != RSC_VALID)
+		return InvalidBlockNumber;
+
+	generation = pg_atomic_read_u64(&sr->generation);
+	pg_read_barrier();
+
+	match = RelFileNodeEquals(sr->rnode, reln->smgr_rnode.node);
+	result = sr->nblocks[forknum];
+
+	pg_read_barrier();
+	flags = pg_atomic_read_u32(&sr->flags);
+	if (!match || (flags & (RSC_LOCKED | RSC_VALID)) != RSC_VALID ||
+		pg_atomic_read_u64(&sr->generation) != generation)
+		return InvalidBlockNumber;
+
+	if (result != InvalidBlockNumber)
+	{
+		/* no necessary to use a atomic operation, usecount can be imprecisely */
+		if (sr->usecount < polar_rsc_pool_sweep_times)
+			sr->usecount++;
+
+		/* We can take the fast path until this SR is eventually evicted. */
+		reln->rsc_ref = sr;
+		reln->rsc_generation = generation;
+	}
+
+	return result;
+}
+
 BlockNumber
 polar_rsc_search_by_mapping(SMgrRelation reln, ForkNumber forknum)
 {
@@ -226,6 +321,11 @@ polar_rsc_search_by_mapping(SMgrRelation reln, ForkNumber forknum)
 	BlockNumber result = InvalidBlockNumber;
 
 	hash = get_hash_value(rsc_mappings, &reln->smgr_rnode.node);
+
+	result = rsc_search_by_hint(reln, forknum, hash);
+	if (result != InvalidBlockNumber)
+		return result;
+
 	mapping_lock = RSC_PARTITION_LOCK_BY_HASH(hash);
 
 	LWLockAcquire(mapping_lock, LW_SHARED);
@@ -246,6 +346,9 @@ polar_rsc_search_by_mapping(SMgrRelation reln, ForkNumber forknum)
 		/* We can take the fast path until this SR is eventually evicted. */
 		reln->rsc_ref = sr;
 		reln->rsc_generation = pg_atomic_read_u64(&sr->generation);
+
+		/* The hint may have been taken by another relation */
+		rsc_set_hint(hash, sr);
 	}
 	LWLockRelease(mapping_lock);
 
@@ -256,14 +359,32 @@ static polar_rsc_shared_relation_t *
 rsc_lru_pool_sweep(void)
 {
 	polar_rsc_shared_relation_t *sr;
+	polar_rsc_sweep_partition_t *part;
+	uint32		part_id;
+	uint32		part_start;
+	uint32		part_size;
 	uint32		index;
 	uint32		flags;
 	int			sr_used_count = 0;
 
+	/*
+	 * Sweep the partition of this backend, so that backends evicting entries
+	 * concurrently don't contend for one clock hand and the same entries.
+	 */
+	if (MyProc != NULL)
+		part_id = MyProc->pgprocno % rsc_pool->num_sweep_partitions;
+	else
+		part_id = random() % rsc_pool->num_sweep_partitions;
+	part = &rsc_pool->sweep_partitions[part_id];
+	part_start = (uint64) polar_rsc_shared_relations * part_id /
+		rsc_pool->num_sweep_partitions;
+	part_size = (uint64) polar_rsc_shared_relations * (part_id + 1) /
+		rsc_pool->num_sweep_partitions - part_start;
+
 	for (;;)
 	{
 		/* Lock the next one in clock-hand order. */
-		index = pg_atomic_fetch_add_u32(&rsc_pool->next_sweep, 1) % polar_rsc_shared_relations;
+		index = part_start + pg_atomic_fetch_add_u32(&part->next_sweep, 1) % part_size;
 		sr = &rsc_pool->entries[index];
 
 		flags = polar_rsc_lock_entry(sr);
@@ -507,10 +628,16 @@ rsc_evict:
 		mapping->index = sr - rsc_pool->entries;
 		sr->usecount = 1;
 		sr->rnode = reln->smgr_rnode.node;
-		pg_atomic_add_fetch_u64(&sr->generation, 1);
 		for (i = 0; i <= MAX_FORKNUM; i++)
 			sr->nblocks[i] = InvalidBlockNumber;
+
+		/*
+		 * Bump the generation after the shared relation is set, lock-free
+		 * lookup relies on this order.
+		 */
+		pg_atomic_add_fetch_u64(&sr->generation, 1);
 		polar_rsc_unlock_entry(sr, RSC_VALID);
+		rsc_set_hint(hash, sr);
 		LWLockRelease(mapping_lock);
 
 		pg_atomic_add_fetch_u64(&polar_rsc_global_stat->mapping_update_evict, 1);
@@ -71,6 +71,10 @@ typedef struct f_smgr
 										  BlockNumber blocknum, int blockCount, char *buffer, bool skipFsync);
 	void		(*polar_smgr_bulkread) (SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 										int blockCount, char *buffer);
+	bool		(*polar_smgr_bulkread_req) (SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+											int blockCount, char *buffer, struct polar_aio_req *req);
+	void		(*polar_smgr_bulkwrite) (SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+										 int blockCount, char *buffer, bool skipFsync);
 	/* POLAR end */
 } f_smgr;
 
@@ -95,6 +99,8 @@ static const f_smgr smgrsw[] = {
 		/* POLAR: extend io */
 		.polar_smgr_bulkextend = polar_mdbulkextend,
 		.polar_smgr_bulkread = polar_mdbulkread,
+		.polar_smgr_bulkread_req = polar_mdbulkread_req,
+		.polar_smgr_bulkwrite = polar_mdbulkwrite,
 		/* POLAR end */
 	}
 };
@@ -617,6 +623,42 @@ polar_smgrbulkread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	smgrsw[reln->smgr_which].polar_smgr_bulkread(reln, forknum, blocknum, blockCount, buffer);
 }
 
+/*
+ *  POLAR: asynchronous bulk read
+ *
+ *	polar_smgrbulkread_req() -- fill an asynchronous io request to read multi
+ *		particular blocks into the supplied buffer.
+ *
+ *		The request is submitted by polar_aio_submit(), and it must be waited
+ *		for before any other file is opened. Returns false if the blocks
+ *		don't exist.
+ */
+bool
+polar_smgrbulkread_req(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+					   int blockCount, char *buffer, struct polar_aio_req *req)
+{
+	return smgrsw[reln->smgr_which].polar_smgr_bulkread_req(reln, forknum, blocknum,
+															blockCount, buffer, req);
+}
+
+/*
+ *  POLAR: bulk write
+ *
+ *	polar_smgrbulkwrite() -- Write multi continuous blocks of a relation from
+ *					  the supplied buffer.
+ *
+ *		Like smgrwrite(), this is not to be used to extend a relation.  The
+ *		blocks must not cross a segment boundary of the storage manager.
+ */
+void
+polar_smgrbulkwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+					int blockCount, char *buffer, bool skipFsync)
+{
+	Assert(blockCount >= 1);
+
+	smgrsw[reln->smgr_which].polar_smgr_bulkwrite(reln, forknum, blocknum, blockCount, buffer, skipFsync);
+}
+
 /*
  *	smgrprefetch() -- Initiate asynchronous read of the specified block of a relation.
  *
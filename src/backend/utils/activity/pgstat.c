@@ -111,6 +111,7 @@
 #include "storage/polar_io_stat.h"
 #include "tcop/tcopprot.h"
 POLAR_PROC_IO *PolarIOStatArray = NULL;
+POLAR_IO_HIST *PolarIOHistArray = NULL;
 
 /* ----------
  * Timer definitions.
@@ -259,6 +259,9 @@ pgstat_get_wait_activity(WaitEventActivity w)
 		case WAIT_EVENT_ASYNC_LOCK_REPLAY_MAIN:
 			event_name = "AsyncLockReplayMain";
 			break;
+		case WAIT_EVENT_LOGINDEX_DECODE_MAIN:
+			event_name = "LogIndexDecodeMain";
+			break;
 			/* POLAR end */
 			/* no default case, so that compiler will warn */
 	}
@@ -475,6 +478,11 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_XACT_GROUP_UPDATE:
 			event_name = "XactGroupUpdate";
 			break;
+			/* POLAR */
+		case WAIT_EVENT_POLAR_WAL_GROUP_FLUSH:
+			event_name = "PolarWalGroupFlush";
+			break;
+			/* POLAR end */
 			/* no default case, so that compiler will warn */
 	}
 
@@ -795,6 +803,9 @@ pgstat_get_wait_io(WaitEventIO w)
 		case WAIT_EVENT_LOGINDEX_WAIT_FULLPAGE:
 			event_name = "LogIndexWaitFullpage";
 			break;
+		case WAIT_EVENT_LOGINDEX_WAIT_LOAD:
+			event_name = "LogIndexWaitLoad";
+			break;
 		case WAIT_EVENT_FULLPAGE_FILE_INIT_WRITE:
 			event_name = "FullpageFileInitWrite";
 			break;
@@ -125,6 +125,7 @@
 #include "commands/tablecmds.h"
 #include "common/username.h"
 #include "storage/polar_fd.h"
+#include "storage/polar_flush.h"
 #include "storage/polar_rsc.h"
 #include "storage/polar_xlogbuf.h"
 #include "utils/polar_local_cache.h"
@@ -191,11 +192,13 @@ bool		polar_enable_early_launch_parallel_bgwriter;
 bool		polar_enable_lru_log;
 double		polar_lru_works_threshold;
 int			polar_parallel_flush_workers;
+int			polar_flush_list_partitions;
 int			polar_parallel_bgwriter_check_interval;
 int			polar_new_bgwriter_flush_factor;
 int			polar_parallel_new_bgwriter_threshold_lag;
 int			polar_parallel_new_bgwriter_threshold_time;
 int			polar_bgwriter_flush_batch_size;
+int			polar_bgwriter_write_combine_size;
 int			polar_bgwriter_batch_size;
 int			polar_lru_bgwriter_max_pages;
 int			polar_lru_batch_pages;
@@ -204,6 +207,7 @@ int			polar_bgwriter_sleep_lsn_lag;
 int			polar_bgwriter_sleep_lru_lap;
 
 int			polar_copy_buffers;
+int			polar_copy_buffers_max;
 int			polar_buffer_copy_min_modified_count;
 int			polar_buffer_copy_threshold_lag;
 
@@ -702,6 +706,19 @@ static const struct config_enum_entry wal_compression_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry polar_logindex_table_compression_options[] = {
+	{"none", LOG_INDEX_TABLE_COMPRESSION_NONE, false},
+	{"packed", LOG_INDEX_TABLE_COMPRESSION_PACKED, false},
+	{"pglz", LOG_INDEX_TABLE_COMPRESSION_PGLZ, false},
+#ifdef USE_LZ4
+	{"lz4", LOG_INDEX_TABLE_COMPRESSION_LZ4, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", LOG_INDEX_TABLE_COMPRESSION_ZSTD, false},
+#endif
+	{NULL, 0, false}
+};
+
  /* Polar end */
 
 /*
@@ -868,6 +885,7 @@ int			polar_min_bulk_extend_table_size = 0;
 bool		polar_enable_primary_recovery_bulk_extend = false;
 int			polar_bulk_extend_size = 0;
 int			polar_bulk_read_size = 0;
+int			polar_bulk_read_ahead_windows = 0;
 int			polar_index_bulk_extend_size = 0;
 int			polar_index_create_bulk_extend_size = 0;
 
@@ -1316,6 +1334,51 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+
+	{
+		{"polar_enable_parallel_replay_primary_recovery", PGC_POSTMASTER, UNGROUPED,
+			gettext_noop("Enable WAL parallel replay during crash recovery of a primary node."),
+			gettext_noop("Page records are replayed by parallel replay processes using logindex. "
+						 "This has no effect on non-primary nodes."),
+			GUC_NO_SHOW_ALL | GUC_NO_RESET_ALL | POLAR_GUC_IS_CHANGABLE | POLAR_GUC_IS_INVISIBLE
+		},
+		&polar_enable_parallel_replay_primary_recovery,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"polar_procpool_work_stealing", PGC_SIGHUP, UNGROUPED,
+			gettext_noop("Allow idle processes of process pool to steal tasks from other processes."),
+			NULL,
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_procpool_work_stealing,
+		true,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"polar_procpool_adaptive_queue_depth", PGC_SIGHUP, UNGROUPED,
+			gettext_noop("Adjust task queue depth of each process of process pool by its throughput."),
+			NULL,
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_procpool_adaptive_queue_depth,
+		true,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"polar_logindex_adaptive_table", PGC_SIGHUP, UNGROUPED,
+			gettext_noop("Size segments and hash slots of logindex table from the pages touched by previous table."),
+			gettext_noop("If disabled, every logindex table uses the default geometry."),
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_logindex_adaptive_table,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"polar_enable_replica_copydata_optimization", PGC_POSTMASTER, UNGROUPED,
 			gettext_noop("Enable copydata optimization when replica satrts."),
@@ -1346,6 +1409,16 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"polar_logindex_track_parse_timing", PGC_SIGHUP, UNGROUPED,
+			gettext_noop("Collects timing statistics for decoding and parsing WAL records into logindex."),
+			NULL,
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_logindex_track_parse_timing,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"polar_enable_resolve_conflict", PGC_SIGHUP, UNGROUPED,
 			gettext_noop("A switch to control conflict resolving in RO node."),
@@ -2989,6 +3062,16 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"polar_enable_wal_group_commit", PGC_SIGHUP, WAL_SETTINGS,
+			gettext_noop("Flushes WAL for a group of committers by one leader."),
+			NULL,
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_enable_wal_group_commit,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"polar_enable_fullpage_snapshot", PGC_SIGHUP, UNGROUPED,
 			gettext_noop("Enable fullpage snapshot feature."),
@@ -3227,6 +3310,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"polar_flush_list_partitions", PGC_POSTMASTER, RESOURCES_BGWRITER,
+			gettext_noop("Sets the number of flush list partitions, each one is protected by its own lock."),
+			NULL,
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_flush_list_partitions,
+		1, 1, POLAR_MAX_FLUSH_LIST_PARTITIONS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"polar_parallel_bgwriter_check_interval", PGC_SIGHUP, RESOURCES_BGWRITER,
 			gettext_noop("The interval to check whether the server has enough parallel background writers."),
@@ -3287,6 +3381,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"polar_bgwriter_write_combine_size", PGC_SIGHUP, RESOURCES_BGWRITER,
+			gettext_noop("Sets the max number of adjacent blocks bgwriter writes in one io."),
+			gettext_noop("1 means flushing buffers from flush list one by one."),
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_bgwriter_write_combine_size,
+		16, 1, POLAR_MAX_BULK_IO_SIZE,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"polar_bgwriter_batch_size", PGC_SIGHUP, RESOURCES_BGWRITER,
 			gettext_noop("Sets the batch size when bgwriter flush buffer in one round."),
@@ -3364,6 +3469,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"polar_copy_buffers_max", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Set the max size of copy buffer that the pool can grow to."),
+			gettext_noop("The copy buffer pool is not elastic if it is not greater than polar_copy_buffers."),
+			GUC_UNIT_BLOCKS | POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_copy_buffers_max,
+		0, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
 	{
 
 		{"polar_buffer_copy_min_modified_count", PGC_SIGHUP, POLAR_BUFFER_MANAGEMENT,
@@ -3429,6 +3545,16 @@ static struct config_int ConfigureNamesInt[] =
 		512, 0, INT_MAX / 2,
 		NULL, NULL, NULL
 	},
+	{
+		{"polar_logindex_decode_queue_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of queue buffer used to keep xlog records decoded ahead by logindex decode worker. 0 means disabled."),
+			NULL,
+			GUC_UNIT_MB | POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_logindex_decode_queue_buffers,
+		16, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
 	{
 		{"polar_rel_size_cache_blocks", PGC_POSTMASTER, UNGROUPED,
 			gettext_noop("Set the number of blocks to record relation size cache."),
@@ -3439,6 +3565,16 @@ static struct config_int ConfigureNamesInt[] =
 		2, 0, INT_MAX / 2,
 		NULL, NULL, NULL
 	},
+	{
+		{"polar_logindex_page_lsn_cache_size", PGC_POSTMASTER, UNGROUPED,
+			gettext_noop("Set the number of pages whose resolved logindex lsn range is cached."),
+			gettext_noop("0 disables the cache."),
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_logindex_page_lsn_cache_size,
+		65536, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
 	{
 		{"polar_logindex_mem_size", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Set the size for logindex memory table."),
@@ -3461,6 +3597,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"polar_logindex_prefetch_distance", PGC_SIGHUP, UNGROUPED,
+			gettext_noop("Sets the number of logindex items whose blocks are prefetched ahead of parallel replay."),
+			gettext_noop("0 disables prefetching."),
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_logindex_prefetch_distance,
+		64, 0, 4096,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"polar_logindex_replay_delay_threshold", PGC_SIGHUP, UNGROUPED,
 			gettext_noop("Diff lsn(MB) between logindex parse lsn and bg_replayed_lsn, "
@@ -3507,6 +3654,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"polar_logindex_load_workers", PGC_POSTMASTER, UNGROUPED,
+			gettext_noop("Set the number of processes to load logindex tables when startup."),
+			gettext_noop("0 makes startup load the tables by itself."),
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_logindex_load_workers,
+		4, 0, 64,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"polar_write_logindex_active_table_delay", PGC_SIGHUP, UNGROUPED,
 			gettext_noop("Time between walwriter write active logindex table."),
@@ -3750,6 +3908,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"polar_bulk_read_ahead_windows", PGC_USERSET, POLAR_BULK_READ_EXTEND,
+			gettext_noop("Sets the number of bulk reads to read ahead during sequential scans, 0 (turning this feature off)."),
+			NULL,
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_bulk_read_ahead_windows,
+		0, 0, 64,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"polar_xlog_page_buffers", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Sets the size of xlog buffer used by multi processes."),
@@ -5415,6 +5584,16 @@ static struct config_int ConfigureNamesInt[] =
 		30000, 0, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"polar_xlog_insert_locks", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of WAL insertion locks."),
+			gettext_noop("-1 sets the number based on the number of online CPUs."),
+			POLAR_GUC_IS_VISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_xlog_insert_locks,
+		-1, -1, POLAR_XLOG_INSERT_LOCKS_MAX,
+		check_polar_xlog_insert_locks, NULL, NULL
+	},
 	{
 		{"polar_wal_init_set_size", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Set the size of each data block written when initializing the zero wal file."),
@@ -6765,6 +6944,19 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"polar_logindex_table_compression", PGC_SIGHUP, WAL_SETTINGS,
+			gettext_noop("Sets the format of logindex tables saved to storage."),
+			gettext_noop("\"none\" saves the raw tables, \"packed\" saves the tables "
+						 "encoded with delta lsn and relation dictionary, others "
+						 "compress the packed tables with the specified method."),
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_logindex_table_compression,
+		LOG_INDEX_TABLE_COMPRESSION_PACKED, polar_logindex_table_compression_options,
+		NULL, NULL, NULL
+	},
+
 	/* POLAR enum GUCs end */
 
 	{
@@ -7011,6 +7203,17 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"polar_fullpage_compression", PGC_SIGHUP, WAL_SETTINGS,
+			gettext_noop("Compresses fullpage snapshot images written in fullpage file with specified method."),
+			NULL,
+			POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE
+		},
+		&polar_fullpage_compression,
+		WAL_COMPRESSION_NONE, wal_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_level", PGC_POSTMASTER, WAL_SETTINGS,
 			gettext_noop("Sets the level of information written to the WAL."),
@@ -94,7 +94,8 @@ logindex_meta_main(int argc, char **argv)
 		fprintf(stderr, "The magic number of meta file is incorrect, got %d, expect %d",
 				meta.magic, LOG_INDEX_MAGIC);
 
-	if (meta.version != LOG_INDEX_VERSION)
+	/* Version 2 only saves raw tables, which are still readable */
+	if (meta.version != LOG_INDEX_VERSION && meta.version != 2)
 		fprintf(stderr, "The version is incorrect, got %d, expect %d", meta.version, LOG_INDEX_VERSION);
 
 	meta.crc = 0;
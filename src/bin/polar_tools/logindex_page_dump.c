@@ -51,6 +51,7 @@ usage(void)
 }
 
 static char data[LOG_INDEX_TABLE_CACHE_SIZE];
+static log_idx_table_data_t table;
 
 
 static log_item_head_t *
@@ -75,12 +76,21 @@ logindex_mem_tbl_exists_page(BufferTag *tag,
 static void
 logindex_search_table(BufferTag *tag, log_idx_table_data_t * table, uint32 key)
 {
-	log_item_head_t *item_head = logindex_mem_tbl_exists_page(tag, table, key);
+	log_item_head_t *item_head;
 	log_seg_id_t item_id;
 	log_item_seg_t *item;
 	size_t		i;
 	XLogRecPtr	lsn;
 
+	if (!LOG_INDEX_TBL_GEOMETRY_VALID(table))
+	{
+		fprintf(stderr, "Invalid geometry of table %ld, seg_num=%u hash_num=%u last_order=%u\n",
+				table->idx_table_id, table->seg_num, table->hash_num, table->last_order);
+		return;
+	}
+
+	item_head = logindex_mem_tbl_exists_page(tag, table, key);
+
 	if (item_head == NULL)
 		return;
 
@@ -121,8 +131,8 @@ logindex_page_main(int argc, char **argv)
 	bool		succeed = false;
 	FILE	   *fp = NULL;
 	size_t		size;
-	char	   *table;
-	int			offset = 0;
+	size_t		offset = 0;
+	size_t		record_size;
 	uint32		key;
 
 	if (argc <= 1)
@@ -167,13 +177,13 @@ logindex_page_main(int argc, char **argv)
 
 	size = fread(data, 1, LOG_INDEX_TABLE_CACHE_SIZE, fp);
 
-	key = hash_any((const unsigned char *) &tag, sizeof(BufferTag)) % LOG_INDEX_MEM_TBL_HASH_NUM;
+	key = hash_any((const unsigned char *) &tag, sizeof(BufferTag));
 
-	while (offset < size)
+	/* Tables are saved one after another, either raw or packed */
+	while ((record_size = log_index_read_table_record(data + offset, size - offset, &table)) > 0)
 	{
-		table = (data + offset);
-		logindex_search_table(&tag, (log_idx_table_data_t *) table, key);
-		offset += sizeof(log_idx_table_data_t);
+		logindex_search_table(&tag, &table, key);
+		offset += record_size;
 	}
 
 end:
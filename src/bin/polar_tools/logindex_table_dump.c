@@ -48,8 +48,11 @@ logindex_table_main(int argc, char **argv)
 	FILE	   *fp = NULL;
 	bool		succeed = false;
 	log_idx_table_data_t *table = NULL;
+	char	   *data = NULL;
 	pg_crc32	crc;
-	int			ret;
+	size_t		size;
+	size_t		offset = 0;
+	size_t		record_size;
 
 	if (argc <= 1)
 	{
@@ -75,7 +78,8 @@ logindex_table_main(int argc, char **argv)
 	}
 
 	table = malloc(sizeof(log_idx_table_data_t));
-	if (!table)
+	data = malloc(LOG_INDEX_TABLE_CACHE_SIZE);
+	if (!table || !data)
 		goto end;
 
 	if (file_path == NULL)
@@ -88,8 +92,19 @@ logindex_table_main(int argc, char **argv)
 		goto end;
 	}
 
-	while ((ret = fread(table, 1, sizeof(log_idx_table_data_t), fp)) == sizeof(log_idx_table_data_t))
+	size = fread(data, 1, LOG_INDEX_TABLE_CACHE_SIZE, fp);
+
+	if (ferror(fp))
 	{
+		fprintf(stderr, "Failed to read logindex table, errno=%d\n", errno);
+		goto end;
+	}
+
+	/* Tables are saved one after another, either raw or packed */
+	while ((record_size = log_index_read_table_record(data + offset, size - offset, table)) > 0)
+	{
+		bool		packed = LOG_INDEX_TABLE_IS_PACKED(data + offset);
+
 		crc = table->crc;
 		table->crc = 0;
 		table->crc = log_index_calc_crc((unsigned char *) table, sizeof(log_idx_table_data_t));
@@ -97,17 +112,18 @@ logindex_table_main(int argc, char **argv)
 		if (crc != table->crc)
 			fprintf(stderr, "The table crc is incorrect, got %u, expect %u\n", table->crc, crc);
 
-		printf("idx_table_id=%ld min_lsn=%lX max_lsn=%lX prefix_lsn=%X crc=%u last_order=%u\n",
+		printf("idx_table_id=%ld min_lsn=%lX max_lsn=%lX prefix_lsn=%X crc=%u last_order=%u seg_num=%u hash_num=%u offset=%zu size=%zu packed=%d\n",
 			   table->idx_table_id, table->min_lsn, table->max_lsn, table->prefix_lsn,
-			   table->crc, table->last_order);
-	}
+			   table->crc, table->last_order, table->seg_num, table->hash_num,
+			   offset, record_size, packed);
 
-	if ((ret > 0 && ret != sizeof(log_idx_table_data_t)) || errno != 0)
-	{
-		fprintf(stderr, "Failed to read logindex table, errno=%d\n", errno);
-		goto end;
+		offset += record_size;
 	}
 
+	if (offset < size)
+		fprintf(stderr, "Stop at offset %zu of %zu, the rest is not a valid logindex table\n",
+				offset, size);
+
 	succeed = true;
 
 end:
@@ -120,5 +136,8 @@ end:
 	if (table)
 		free(table);
 
+	if (data)
+		free(data);
+
 	return succeed ? 0 : -1;
 }
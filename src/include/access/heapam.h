@@ -78,6 +78,9 @@ typedef struct HeapScanDescData
 
 	/* POLAR: scan direction value, for bulk read use */
 	ScanDirection polar_scan_direction;
+
+	/* POLAR: read-ahead of bulk read, NULL until it's used */
+	struct polar_read_ahead_state *polar_read_ahead;
 }			HeapScanDescData;
 typedef struct HeapScanDescData *HeapScanDesc;
 
@@ -337,6 +337,7 @@ typedef struct BTVacState
 	void	   *callback_state;
 	BTCycleId	cycleid;
 	MemoryContext pagedelcontext;
+	struct polar_read_ahead_state *read_ahead; /* POLAR: of bulk read */
 
 	/*
 	 * _bt_pendingfsm_finalize() state
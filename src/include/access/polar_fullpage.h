@@ -31,6 +31,7 @@
 #include "access/xlogdefs.h"
 #include "storage/buf_internals.h"
 #include "storage/lwlock.h"
+#include "storage/polar_fd.h"
 #include "storage/relfilenode.h"
 #include "utils/guc.h"
 #include "utils/polar_log.h"
@@ -45,6 +46,13 @@ typedef struct polar_fullpage_ctl_data_t
 	logindex_snapshot_t logindex_snapshot;
 	polar_ringbuf_t queue;
 	pg_atomic_uint32 procno;
+
+	/*
+	 * Where the next fullpage image is written, protected by file lock. Images
+	 * are packed one after another in the segment of their fullpage_no.
+	 */
+	uint64		write_seg_no;
+	uint64		write_offset;
 }			polar_fullpage_ctl_data_t;
 
 typedef polar_fullpage_ctl_data_t * polar_fullpage_ctl_t;
@@ -55,6 +63,34 @@ typedef polar_fullpage_ctl_data_t * polar_fullpage_ctl_t;
 #define FULLPAGE_FILE_SEG_NO(fullpage_no) (fullpage_no / FULLPAGE_NUM_PER_FILE)
 #define FULLPAGE_FILE_OFFSET(fullpage_no) ((fullpage_no * BLCKSZ) % FULLPAGE_SEGMENT_SIZE)
 
+/*
+ * Fullpage images are stored in variable-length slots aligned to
+ * FULLPAGE_IMAGE_ALIGN, they may be compressed.
+ */
+#define FULLPAGE_IMAGE_ALIGN			(512)
+#define FULLPAGE_IMAGE_ALIGNED_LEN(len) TYPEALIGN(FULLPAGE_IMAGE_ALIGN, (len))
+
+/*
+ * Images logged together are written in one io, the batch is aligned to
+ * direct io blocks so that concurrent batches never share a block.
+ */
+#define FULLPAGE_BATCH_ALIGN			POLAR_BUFFER_ALIGN_LEN
+#define FULLPAGE_BATCH_ALIGNED_LEN(len) TYPEALIGN(FULLPAGE_BATCH_ALIGN, (len))
+
+/*
+ * Location of a fullpage image, which follows PolarWalType in the data of
+ * fullpage snapshot wal record. Records written by old versions only have
+ * fullpage_no, their images are uncompressed BLCKSZ slots at
+ * FULLPAGE_FILE_OFFSET(fullpage_no).
+ */
+typedef struct polar_fullpage_slot_t
+{
+	uint64		fullpage_no;
+	uint32		offset;			/* offset in the segment file */
+	uint16		length;			/* length of the stored image */
+	uint8		method;			/* WalCompression of the image */
+}			polar_fullpage_slot_t;
+
 #define FULLPAGE_FILE_NAME(ctl, path, fullpage_no) \
 	snprintf((path), MAXPGPATH, "%s/%s/%08lX.fp", POLAR_DATA_DIR(), polar_get_logindex_snapshot_dir((ctl)->logindex_snapshot), \
 			 FULLPAGE_FILE_SEG_NO(fullpage_no));
@@ -69,18 +105,22 @@ extern int	polar_fullpage_max_segment_size;
 extern int	polar_fullpage_snapshot_oldest_lsn_delay_threshold;
 extern int	polar_fullpage_snapshot_replay_delay_threshold;
 extern int	polar_fullpage_snapshot_min_modified_count;
+extern int	polar_fullpage_compression;
 
 extern Size polar_fullpage_shmem_size(void);
 extern polar_fullpage_ctl_t polar_fullpage_shmem_init(const char *name, polar_ringbuf_t queue, logindex_snapshot_t logindex_snapshot);
 
-extern void polar_read_fullpage(polar_fullpage_ctl_t ctl, Page page, uint64 fullpage_no);
+extern void polar_read_fullpage(polar_fullpage_ctl_t ctl, Page page, const polar_fullpage_slot_t *slot);
+extern void polar_fullpage_get_slot(XLogReaderState *record, polar_fullpage_slot_t *slot);
 extern int	polar_fullpage_file_init(polar_fullpage_ctl_t ctl, uint64 fullpage_no);
-extern void polar_update_max_fullpage_no(polar_fullpage_ctl_t ctl, uint64 fullpage_no);
+extern void polar_update_max_fullpage_no(polar_fullpage_ctl_t ctl, const polar_fullpage_slot_t *slot);
 extern void polar_prealloc_fullpage_files(polar_fullpage_ctl_t ctl);
 extern void polar_remove_old_fullpage_files(polar_fullpage_ctl_t ctl, XLogRecPtr min_lsn);
 extern void polar_remove_old_fullpage_file(polar_fullpage_ctl_t ctl, const char *segname, uint64 min_fullpage_seg_no);
 extern void polar_logindex_calc_max_fullpage_no(polar_fullpage_ctl_t ctl);
 extern XLogRecPtr polar_log_fullpage_snapshot_image(polar_fullpage_ctl_t ctl, Buffer buffer, XLogRecPtr oldest_apply_lsn);
+extern void polar_fullpage_get_old_image(Buffer buffer, XLogRecPtr oldest_apply_lsn, char *page, bool read);
+extern XLogRecPtr polar_log_fullpage_snapshot_images(polar_fullpage_ctl_t ctl, Buffer *buffers, char **pages, int nbuffers);
 extern void polar_fullpage_set_online_promote(bool online_promote);
 extern bool polar_fullpage_get_online_promote(void);
 extern void polar_bgworker_fullpage_snapshot_replay(polar_fullpage_ctl_t ctl);
@@ -47,6 +47,7 @@ typedef uint64 log_range_id_t;
 
 struct log_mem_table_t;
 struct log_index_iter_data_t;
+struct polar_task_sched_t;
 typedef struct log_index_snapshot_t *logindex_snapshot_t;
 typedef struct log_index_page_iter_data_t *log_index_page_iter_t;
 typedef struct log_index_lsn_iter_data_t *log_index_lsn_iter_t;
@@ -71,9 +72,33 @@ typedef enum
 	ITERATE_STATE_CORRUPTED
 }			log_index_iter_state_t;
 
+/* Format of the logindex tables saved to storage */
+typedef enum
+{
+	LOG_INDEX_TABLE_COMPRESSION_NONE,	/* raw log_idx_table_data_t */
+	LOG_INDEX_TABLE_COMPRESSION_PACKED, /* delta and dictionary encoded */
+	LOG_INDEX_TABLE_COMPRESSION_PGLZ,	/* packed and compressed by pglz */
+	LOG_INDEX_TABLE_COMPRESSION_LZ4,	/* packed and compressed by lz4 */
+	LOG_INDEX_TABLE_COMPRESSION_ZSTD	/* packed and compressed by zstd */
+}			log_index_table_compression_t;
+
+/* Time spent to load flushed tables when the logindex snapshot is initialized */
+typedef struct polar_logindex_load_stat_t
+{
+	int			workers;		/* 0 means tables are loaded by startup itself */
+	uint64		tables;			/* number of loaded tables */
+	uint64		read_us;		/* time to read table records */
+	uint64		validate_us;	/* time to unpack tables and check crc */
+	uint64		bloom_us;		/* time to rebuild bloom pages */
+	uint64		total_us;		/* elapsed time of the whole loading */
+}			polar_logindex_load_stat_t;
+
 extern int	polar_logindex_table_batch_size;
 extern int	polar_max_logindex_files;
 extern int	polar_trace_logindex_messages;
+extern int	polar_logindex_table_compression;
+extern int	polar_logindex_load_workers;
+extern bool polar_logindex_adaptive_table;
 
 extern Size polar_logindex_shmem_size(uint64 logindex_mem_tbl_size, int bloom_blocks);
 
@@ -82,6 +107,10 @@ extern logindex_snapshot_t polar_logindex_snapshot_shmem_init(const char *name,
 
 extern uint64 polar_logindex_convert_mem_tbl_size(uint64 mem_size);
 extern void polar_logindex_create_local_cache(logindex_snapshot_t logindex_snapshot, const char *cache_name, uint32 max_segments);
+extern Size polar_logindex_load_sched_shmem_size(int workers);
+extern struct polar_task_sched_t *polar_logindex_create_load_sched(const char *sched_name, int workers);
+extern void polar_logindex_set_load_sched(logindex_snapshot_t logindex_snapshot, struct polar_task_sched_t *sched);
+extern void polar_logindex_get_load_stat(logindex_snapshot_t logindex_snapshot, polar_logindex_load_stat_t * stat);
 
 extern MemoryContext polar_logindex_memory_context(void);
 extern uint64 polar_logindex_mem_tbl_size(logindex_snapshot_t logindex_snapshot);
@@ -100,6 +129,7 @@ extern log_index_lsn_t * polar_logindex_page_iterator_next(log_index_page_iter_t
 extern bool polar_logindex_page_iterator_end(log_index_page_iter_t iter);
 extern log_index_iter_state_t polar_logindex_page_iterator_state(log_index_page_iter_t iter);
 extern XLogRecPtr polar_logindex_page_iterator_max_lsn(log_index_page_iter_t iter);
+extern XLogRecPtr polar_logindex_page_iterator_newest_lsn(log_index_page_iter_t iter);
 extern XLogRecPtr polar_logindex_page_iterator_min_lsn(log_index_page_iter_t iter);
 extern BufferTag *polar_logindex_page_iterator_buf_tag(log_index_page_iter_t iter);
 
@@ -109,6 +139,7 @@ extern log_index_lsn_t * polar_logindex_lsn_iterator_next(logindex_snapshot_t lo
 
 extern void polar_logindex_truncate(logindex_snapshot_t logindex_snapshot, XLogRecPtr lsn);
 extern bool polar_logindex_check_state(logindex_snapshot_t logindex_snapshot, uint32 state);
+extern uint32 polar_logindex_generation(logindex_snapshot_t logindex_snapshot);
 
 /*
  * POLAR: Return the newest byte position which all logindex info could be flushed before it.
@@ -29,6 +29,8 @@
 #include "access/xlogrecord.h"
 #include "common/hashfn.h"
 #include "lib/bloomfilter.h"
+#include "port/pg_bitutils.h"
+#include "port/simd.h"
 #include "storage/buf_internals.h"
 #include "storage/latch.h"
 #include "storage/lwlock.h"
@@ -42,7 +44,7 @@
 #include "utils/polar_local_cache.h"
 
 #define LOG_INDEX_MAGIC                 (0xFDFE)
-#define LOG_INDEX_VERSION               (0x0002)
+#define LOG_INDEX_VERSION               (0x0004)
 
 
 #define LOG_INDEX_FILE_TABLE_NAME(path, seg) \
@@ -58,8 +60,12 @@
 #define LOG_INDEX_MEM_TBL_SEG_NUM           4096
 #define LOG_INDEX_MEM_TBL_HASH_NUM          (LOG_INDEX_MEM_TBL_SEG_NUM/2)
 #define LOG_INDEX_MEM_TBL_HASH_LOCK_NUM     (LOG_INDEX_MEM_TBL_HASH_NUM/64)
+/*
+ * POLAR: The key of page is the whole hash value, each table maps it to its
+ * own hash slots by LOG_INDEX_TBL_SLOT.
+ */
 #define LOG_INDEX_MEM_TBL_HASH_PAGE(tag) \
-	(tag_hash(tag, sizeof(BufferTag)) % LOG_INDEX_MEM_TBL_HASH_NUM)
+	(tag_hash(tag, sizeof(BufferTag)))
 
 #define LOG_INDEX_TABLE_INVALID_ID          0
 #define LOG_INDEX_TBL_INVALID_SEG           0
@@ -69,6 +75,24 @@
 #define LOG_INDEX_TBL_SEG_SIZE              48
 #define LOG_INDEX_MAX_ORDER_NUM             (LOG_INDEX_MEM_TBL_SEG_NUM * LOG_INDEX_ITEM_SEG_LSN_NUM)
 
+/*
+ * POLAR: Since LOG_INDEX_VERSION 4 the segments, hash slots and idx_order of
+ * a table share one area, and each table has its own number of segments and
+ * hash slots.  The area is as large as the default geometry, which is
+ * LOG_INDEX_MEM_TBL_SEG_NUM segments, LOG_INDEX_MEM_TBL_HASH_NUM hash slots and
+ * LOG_INDEX_MAX_ORDER_NUM orders.  The rest of the area after segments and
+ * hash slots is used by idx_order.
+ */
+#define LOG_INDEX_TBL_AREA_SIZE \
+	(LOG_INDEX_MEM_TBL_SEG_NUM * LOG_INDEX_TBL_SEG_SIZE + \
+	 LOG_INDEX_MEM_TBL_HASH_NUM * sizeof(log_seg_id_t) + \
+	 LOG_INDEX_MAX_ORDER_NUM * sizeof(uint16))
+#define LOG_INDEX_TBL_AREA_SEG_NUM          (LOG_INDEX_TBL_AREA_SIZE / LOG_INDEX_TBL_SEG_SIZE)
+#define LOG_INDEX_TBL_MIN_SEG_NUM           (LOG_INDEX_MEM_TBL_SEG_NUM / 2)
+#define LOG_INDEX_TBL_MAX_SEG_NUM           5440
+#define LOG_INDEX_TBL_MIN_HASH_NUM          (LOG_INDEX_MEM_TBL_HASH_NUM / 2)
+#define LOG_INDEX_TBL_MAX_HASH_NUM          (LOG_INDEX_MEM_TBL_HASH_NUM * 2)
+
 #define LOG_INDEX_FILE_TBL_BLOOM_SIZE       (4096)
 #define LOG_INDEX_FILE_TBL_TOTAL_NUM \
 	(SLRU_PAGES_PER_SEGMENT*BLCKSZ/LOG_INDEX_FILE_TBL_BLOOM_SIZE)
@@ -99,12 +123,30 @@
 	(((seg) == LOG_INDEX_TBL_INVALID_SEG) ? NULL : \
 	 &((t)->segment[(seg)-1].item_seg))
 
+/* Define macro to get the hash slots and idx_order in the table area */
+#define LOG_INDEX_TBL_HASH(t) \
+	((log_seg_id_t *) &(t)->segment[(t)->seg_num])
+
+#define LOG_INDEX_TBL_ORDER(t) \
+	((uint16 *) (LOG_INDEX_TBL_HASH(t) + (t)->hash_num))
+
+#define LOG_INDEX_TBL_ORDER_NUM(t) \
+	((uint32) ((LOG_INDEX_TBL_AREA_SIZE - (t)->seg_num * LOG_INDEX_TBL_SEG_SIZE - \
+				(t)->hash_num * sizeof(log_seg_id_t)) / sizeof(uint16)))
+
+#define LOG_INDEX_TBL_GEOMETRY_VALID(t) \
+	((t)->seg_num >= LOG_INDEX_TBL_MIN_SEG_NUM && \
+	 (t)->seg_num <= LOG_INDEX_TBL_MAX_SEG_NUM && \
+	 (t)->hash_num >= LOG_INDEX_TBL_MIN_HASH_NUM && \
+	 (t)->hash_num <= LOG_INDEX_TBL_MAX_HASH_NUM && \
+	 (t)->last_order <= LOG_INDEX_TBL_ORDER_NUM(t))
+
 /* Define macro to get and set hash slot */
 #define LOG_INDEX_TBL_SLOT(t, key) \
-	(&(t)->hash[(key)])
+	(&LOG_INDEX_TBL_HASH(t)[(key) % (t)->hash_num])
 
 #define LOG_INDEX_TBL_SLOT_VALUE(t, key) \
-	((t)->hash[(key)])
+	(LOG_INDEX_TBL_HASH(t)[(key) % (t)->hash_num])
 
 #define LOG_INDEX_COMBINE_LSN(table, suffix) \
 	((((XLogRecPtr)((table)->prefix_lsn)) << 32) | (suffix))
@@ -149,26 +191,33 @@
 		(active)->data.max_lsn = InvalidXLogRecPtr; \
 		(active)->data.min_lsn = UINT64_MAX; \
 		(active)->data.prefix_lsn = ((lsn) >> 32) ; \
+		(active)->data.seg_num = logindex_snapshot->table_seg_num; \
+		(active)->data.hash_num = logindex_snapshot->table_hash_num; \
 		(active)->free_head = 1; \
 		LOG_INDEX_MEM_TBL_SET_STATE((active), LOG_INDEX_MEM_TBL_STATE_ACTIVE); \
 	}
 
+/* Table is full when it runs out of either segments or orders */
 #define LOG_INDEX_MEM_TBL_FULL(t)  \
-	(LOG_INDEX_MEM_TBL_FREE_HEAD(t) == LOG_INDEX_MEM_TBL_SEG_NUM)
+	(LOG_INDEX_MEM_TBL_FREE_HEAD(t) >= (t)->data.seg_num || \
+	 (t)->data.last_order >= LOG_INDEX_TBL_ORDER_NUM(&(t)->data))
 
-#define LOG_INDEX_ORDER_SEG_MASK            0x0FFF
-#define LOG_INDEX_ORDER_IDX_MASK            0xF000
-#define LOG_INDEX_ORDER_IDX_SHIFT           12
-#define LOG_INDEX_SEG_ORDER(idx_order)      ((idx_order) & LOG_INDEX_ORDER_SEG_MASK)
-#define LOG_INDEX_ID_ORDER(idx_order)       (((idx_order) & LOG_INDEX_ORDER_IDX_MASK) >> LOG_INDEX_ORDER_IDX_SHIFT)
+/*
+ * POLAR: The order saves the segment id and the lsn index in that segment as
+ * (seg_id - 1) * LOG_INDEX_ITEM_SEG_LSN_NUM + idx, which fits in uint16 for
+ * at most LOG_INDEX_TBL_MAX_SEG_NUM segments.
+ */
+#define LOG_INDEX_SEG_ORDER(idx_order)      ((log_seg_id_t) ((idx_order) / LOG_INDEX_ITEM_SEG_LSN_NUM + 1))
+#define LOG_INDEX_ID_ORDER(idx_order)       ((idx_order) % LOG_INDEX_ITEM_SEG_LSN_NUM)
 
 #define LOG_INDEX_MEM_TBL_ADD_ORDER(t, seg_id, idx) \
 	do \
 	{  \
-		POLAR_ASSERT_PANIC(seg_id < LOG_INDEX_MEM_TBL_SEG_NUM); \
-		POLAR_ASSERT_PANIC(idx < (LOG_INDEX_ORDER_IDX_MASK >> LOG_INDEX_ORDER_IDX_SHIFT)); \
-		(t)->idx_order[(t)->last_order] = ((seg_id) & LOG_INDEX_ORDER_SEG_MASK) | \
-										  (((idx) << LOG_INDEX_ORDER_IDX_SHIFT) & LOG_INDEX_ORDER_IDX_MASK); \
+		POLAR_ASSERT_PANIC(seg_id > LOG_INDEX_TBL_INVALID_SEG && seg_id <= (t)->seg_num); \
+		POLAR_ASSERT_PANIC(idx < LOG_INDEX_ITEM_SEG_LSN_NUM); \
+		POLAR_ASSERT_PANIC((t)->last_order < LOG_INDEX_TBL_ORDER_NUM(t)); \
+		LOG_INDEX_TBL_ORDER(t)[(t)->last_order] = \
+			(uint16) (((seg_id) - 1) * LOG_INDEX_ITEM_SEG_LSN_NUM + (idx)); \
 		pg_write_barrier();\
 		(t)->last_order++; \
 	} \
@@ -313,11 +362,44 @@ typedef struct log_idx_table_data_t
 	uint32		prefix_lsn;
 	pg_crc32	crc;
 	uint32		last_order;
-	uint16		idx_order[LOG_INDEX_MAX_ORDER_NUM];
-	log_seg_id_t hash[LOG_INDEX_MEM_TBL_HASH_NUM];
-	log_tbl_seg_t segment[LOG_INDEX_MEM_TBL_SEG_NUM];
+	uint16		seg_num;		/* number of segments */
+	uint16		hash_num;		/* number of hash slots */
+
+	/*
+	 * seg_num segments, then hash_num hash slots, then idx_order which uses
+	 * the rest of the area.
+	 */
+	log_tbl_seg_t segment[LOG_INDEX_TBL_AREA_SEG_NUM];
 }			log_idx_table_data_t;
 
+/*
+ * POLAR: A logindex table saved in packed format.  Since LOG_INDEX_VERSION 3
+ * tables are appended to the segment file one after another, and each one is
+ * saved either as raw log_idx_table_data_t or as this packed record.  The
+ * packed data is the table encoded with delta lsn and per relation dictionary,
+ * then optionally compressed by pglz, lz4 or zstd.  Unpacking it gets exactly
+ * the same bytes as the raw table, including the table crc.
+ */
+#define LOG_INDEX_TABLE_PACKED_MAGIC        (0x504C5842)
+
+typedef struct log_idx_table_packed_t
+{
+	uint32		magic;
+	uint8		compression;	/* log_index_table_compression_t */
+	uint8		reserved[3];
+	log_idx_table_id_t idx_table_id;
+	XLogRecPtr	min_lsn;
+	XLogRecPtr	max_lsn;
+	uint32		encoded_size;	/* size of data before compressed */
+	uint32		packed_size;	/* size of data */
+	pg_crc32	crc;			/* crc of header and data */
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+}			log_idx_table_packed_t;
+
+#define LOG_INDEX_TABLE_PACKED_HDR_SIZE     offsetof(log_idx_table_packed_t, data)
+#define LOG_INDEX_TABLE_IS_PACKED(record) \
+	(((const log_idx_table_packed_t *) (record))->magic == LOG_INDEX_TABLE_PACKED_MAGIC)
+
 typedef struct log_mem_table_t
 {
 	log_seg_id_t free_head;
@@ -380,14 +462,20 @@ typedef struct log_index_snapshot_t
 	XLogRecPtr	max_parsed_lsn; /* Max end+1 parsed lsn, now just is used by
 								 * flashback logindex */
 	pg_atomic_uint32 state;
+	pg_atomic_uint32 generation;	/* bumped when logindex is reset,
+									 * promoted or truncated */
 	uint32		active_table;
 	bool		flush_active_table;
 	log_idx_table_id_t max_idx_table_id;
+	uint16		table_seg_num;	/* Number of segments of next active table */
+	uint16		table_hash_num; /* Number of hash slots of next active table */
 	log_index_promoted_info_t promoted_info;
 	log_index_meta_t meta;
 	uint64		max_allocated_seg_no;
 	polar_local_cache segment_cache;
 	struct Latch *bg_worker_latch;
+	struct polar_task_sched_t *load_sched;	/* Workers to load flushed tables */
+	polar_logindex_load_stat_t load_stat;
 	log_mem_table_t mem_table[FLEXIBLE_ARRAY_MEMBER];
 }			log_index_snapshot_t;
 
@@ -429,11 +517,13 @@ typedef struct log_index_page_iter_data_t
 	XLogRecPtr	max_lsn;
 	XLogRecPtr	iter_prev_lsn;
 	XLogRecPtr	iter_max_lsn;
+	XLogRecPtr	newest_lsn;		/* the newest lsn pushed to lsn_stack */
 	log_idx_table_id_t max_idx_table_id;
 	log_index_page_stack_lsn_t lsn_stack;
 	uint32		key;
 	log_index_iter_state_t state;
 	log_index_lsn_t lsn_info;
+	polar_bloom_probe bloom_probe;	/* hash values of tag for bloom filter */
 }			log_index_page_iter_data_t;
 
 typedef enum
@@ -459,6 +549,96 @@ typedef struct log_index_lsn_iter_data_t
 }			log_index_lsn_iter_data_t;
 
 
+/*
+ * Compare the BufferTag saved in logindex item with the searched one.
+ *
+ * The first 16 bytes of the tag are compared in one vector instruction, and
+ * the block number is compared at last.  Items in the same hash chain mostly
+ * belong to the same relation, so block number is the field which decides.
+ */
+StaticAssertDecl(sizeof(BufferTag) == 16 + sizeof(BlockNumber),
+				 "BufferTag layout is changed");
+
+static inline bool
+log_index_tag_equal(const BufferTag *a, const BufferTag *b)
+{
+#if defined(USE_SSE2)
+	__m128i		va = _mm_loadu_si128((const __m128i *) a);
+	__m128i		vb = _mm_loadu_si128((const __m128i *) b);
+
+	return a->blockNum == b->blockNum &&
+		_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xFFFF;
+#elif defined(USE_NEON)
+	uint8x16_t	va = vld1q_u8((const uint8 *) a);
+	uint8x16_t	vb = vld1q_u8((const uint8 *) b);
+
+	return a->blockNum == b->blockNum &&
+		vminvq_u8(vceqq_u8(va, vb)) == 0xFF;
+#else
+	return BUFFERTAGS_EQUAL(*a, *b);
+#endif
+}
+
+/*
+ * Count how many suffix lsn in the ascending array are not larger than
+ * suffix.  This is also the position after the last one which is not larger
+ * than suffix.  Four suffix lsn are compared in one vector instruction.
+ */
+static inline int
+log_index_suffix_lsn_count_le(const uint32 *suffix_lsn, int n, uint32 suffix)
+{
+	int			count = 0;
+	int			i = 0;
+
+#if defined(USE_SSE2)
+	/* SSE2 has no unsigned compare, so flip the sign bit of both sides */
+	const __m128i sign = _mm_set1_epi32((int) 0x80000000);
+	const __m128i key = _mm_xor_si128(_mm_set1_epi32((int) suffix), sign);
+
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i		val = _mm_loadu_si128((const __m128i *) &suffix_lsn[i]);
+		int			gt;
+
+		val = _mm_xor_si128(val, sign);
+		gt = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(val, key)));
+		count += 4 - pg_number_of_ones[gt];
+	}
+#elif defined(USE_NEON)
+	const uint32x4_t key = vdupq_n_u32(suffix);
+
+	for (; i + 4 <= n; i += 4)
+	{
+		uint32x4_t	le = vcleq_u32(vld1q_u32(&suffix_lsn[i]), key);
+
+		count += vaddvq_u32(vshrq_n_u32(le, 31));
+	}
+#endif
+
+	for (; i < n; i++)
+		count += (suffix_lsn[i] <= suffix);
+
+	return count;
+}
+
+/*
+ * Count how many lsn saved in the ascending suffix array of table are not
+ * larger than lsn.
+ */
+static inline int
+log_index_table_lsn_count_le(log_idx_table_data_t * table, const uint32 *suffix_lsn,
+							 int n, XLogRecPtr lsn)
+{
+	uint32		prefix = (uint32) (lsn >> 32);
+
+	if (prefix > table->prefix_lsn)
+		return n;
+	else if (prefix < table->prefix_lsn)
+		return 0;
+
+	return log_index_suffix_lsn_count_le(suffix_lsn, n, (uint32) lsn);
+}
+
 static inline pg_crc32
 log_index_calc_crc(unsigned char *data, size_t size)
 {
@@ -486,12 +666,17 @@ extern bool log_index_get_meta(logindex_snapshot_t logindex_snapshot, log_index_
 extern void log_index_force_save_table(logindex_snapshot_t logindex_snapshot, log_mem_table_t * table);
 extern bool log_index_read_table_data(logindex_snapshot_t logindex_snapshot, log_idx_table_data_t * table, log_idx_table_id_t tid, int elevel);
 
+extern Size log_index_pack_table(log_idx_table_data_t * table, int compression, log_idx_table_packed_t * packed);
+extern bool log_index_unpack_table(const log_idx_table_packed_t * packed, log_idx_table_data_t * table);
+extern Size log_index_table_record_size(const char *record, log_idx_table_id_t tid);
+extern Size log_index_read_table_record(const char *record, Size len, log_idx_table_data_t * table);
+
 extern XLogRecPtr log_index_get_order_lsn(log_idx_table_data_t * table, uint32 order, log_index_lsn_t * lsn_info);
 
 static inline log_item_head_t *
 log_index_item_head(log_idx_table_data_t * table, log_seg_id_t head)
 {
-	if (unlikely(head > LOG_INDEX_MEM_TBL_SEG_NUM))
+	if (unlikely(head > table->seg_num))
 	{
 		POLAR_LOG_LOGINDEX_TABLE_INFO(table);
 		elog(PANIC, "Incorrect head=%u to get logindex item head", head);
@@ -504,7 +689,7 @@ log_index_item_head(log_idx_table_data_t * table, log_seg_id_t head)
 static inline log_item_seg_t *
 log_index_item_seg(log_idx_table_data_t * table, log_seg_id_t seg)
 {
-	if (unlikely(seg > LOG_INDEX_MEM_TBL_SEG_NUM))
+	if (unlikely(seg > table->seg_num))
 	{
 		POLAR_LOG_LOGINDEX_TABLE_INFO(table);
 		elog(PANIC, "Incorrect seg=%u to get logindex segment", seg);
@@ -27,6 +27,7 @@
 #include "access/polar_fullpage.h"
 #include "access/polar_logindex.h"
 #include "access/polar_mini_transaction.h"
+#include "access/polar_page_lsn_cache.h"
 #include "access/polar_queue_manager.h"
 #include "access/polar_rel_size_cache.h"
 #include "access/xlogreader.h"
@@ -36,6 +37,7 @@
 
 extern int	polar_logindex_mem_size;
 extern bool polar_enable_parallel_replay_standby_mode;
+extern bool polar_enable_parallel_replay_primary_recovery;
 extern bool polar_enable_replica_prewarm;
 extern int	polar_parallel_replay_task_queue_depth;
 extern int	polar_parallel_replay_proc_num;
@@ -51,6 +53,9 @@ extern bool polar_enable_fullpage_snapshot;
 extern int	polar_startup_replay_delay_size;
 extern int	polar_logindex_replay_delay_threshold;
 extern bool polar_enable_standby_instant_recovery;
+extern int	polar_logindex_prefetch_distance;
+extern bool polar_logindex_track_parse_timing;
+extern int	polar_logindex_decode_queue_buffers;
 
 typedef void (*polar_logindex_replay_end_callback) (Buffer, void *arg);
 
@@ -69,6 +74,47 @@ typedef struct polar_logindex_promote_replay_t
 	XLogRecPtr	mark_replayed_lsn;
 } polar_logindex_promote_replay_t;
 
+/*
+ * POLAR: throughput of the stages which turn WAL into logindex. The decode
+ * ahead stage runs in logindex decode worker, it decodes WAL records in xlog
+ * queue ahead of startup process and pushes them to decode queue. The decode
+ * stage pops WAL records from xlog queue, and takes the decoded one from
+ * decode queue or decodes it itself. The parse stage parses decoded records
+ * and inserts them into logindex. Decode and parse stages run in startup
+ * process and are only updated by it, decode ahead stage is only updated by
+ * the decode worker except decoded_ahead_used.
+ */
+typedef struct polar_logindex_parse_stat_t
+{
+	pg_atomic_uint64 decoded_ahead_records;
+	pg_atomic_uint64 decode_ahead_us;	/* only with
+										 * polar_logindex_track_parse_timing */
+	pg_atomic_uint64 decoded_ahead_lsn; /* end of the last record decoded
+										 * ahead */
+	pg_atomic_uint64 decoded_ahead_used;	/* taken by startup process */
+	pg_atomic_uint64 decoded_records;
+	pg_atomic_uint64 decode_us;	/* only with polar_logindex_track_parse_timing */
+	pg_atomic_uint64 decoded_lsn;	/* end of the last decoded record */
+	pg_atomic_uint64 parsed_records;
+	pg_atomic_uint64 parse_us;	/* only with polar_logindex_track_parse_timing */
+	pg_atomic_uint64 parsed_lsn;	/* end of the last parsed record */
+} polar_logindex_parse_stat_t;
+
+/*
+ * POLAR: blocks prefetched by logindex background dispatcher before they are
+ * dispatched to parallel replay processes. They are only updated by the
+ * dispatcher.
+ */
+typedef struct polar_logindex_prefetch_stat_t
+{
+	pg_atomic_uint64 hits;		/* block was already in shared buffers */
+	pg_atomic_uint64 issued;	/* block was read ahead by fadvise, or read
+								 * into shared buffers by a completed read */
+	pg_atomic_uint64 skipped;	/* block does not exist yet or was just
+								 * prefetched */
+	pg_atomic_uint64 prefetched_lsn;	/* lsn of the last prefetched record */
+} polar_logindex_prefetch_stat_t;
+
 typedef struct polar_logindex_redo_ctl_data_t
 {
 	mini_trans_t mini_trans;
@@ -76,7 +122,9 @@ typedef struct polar_logindex_redo_ctl_data_t
 	logindex_snapshot_t wal_logindex_snapshot;
 	logindex_snapshot_t fullpage_logindex_snapshot;
 	polar_ringbuf_t xlog_queue;
+	polar_ringbuf_t decode_queue;	/* xlog queue records decoded ahead */
 	polar_rel_size_cache_t rel_size_cache;
+	polar_page_lsn_cache_t page_lsn_cache;
 
 	XLogRecPtr	xlog_replay_from;	/* Record the start lsn we replayed from. */
 
@@ -97,8 +145,12 @@ typedef struct polar_logindex_redo_ctl_data_t
 
 	struct Latch *bg_worker_latch;
 	struct Latch *logindex_saver_latch;
+	struct Latch *decode_worker_latch;
 
 	polar_task_sched_t *parallel_sched;
+
+	polar_logindex_parse_stat_t parse_stat;
+	polar_logindex_prefetch_stat_t prefetch_stat;
 } polar_logindex_redo_ctl_data_t;
 
 typedef polar_logindex_redo_ctl_data_t *polar_logindex_redo_ctl_t;
@@ -134,6 +186,20 @@ typedef struct polar_logindex_bg_redo_ctl_t
 	XLogRecPtr	max_dispatched_lsn; /* The max lsn value which dispatched to
 									 * replay */
 	polar_task_sched_ctl_t *sched_ctl;
+	log_index_lsn_iter_t prefetch_iter;	/* the iterator for prefetch, which
+										 * runs ahead of lsn_iter */
+	log_index_lsn_t *prefetch_page;	/* current iterator page need to
+									 * prefetch */
+	int			prefetch_ahead; /* The number of pages prefetch_iter is
+								 * ahead of lsn_iter */
+	BufferTag	prefetch_tag;	/* the last prefetched block */
+	BlockNumber prefetch_nblocks;	/* size of the last prefetched relation
+									 * fork */
+	struct polar_read_ahead_state *prefetch_read_ahead; /* reads of blocks
+														 * prefetched with
+														 * direct io */
+	uint64		prefetch_nread; /* nread of prefetch_read_ahead counted as
+								 * issued */
 } polar_logindex_bg_redo_ctl_t;
 
 extern polar_logindex_redo_ctl_t polar_logindex_redo_instance;
@@ -175,6 +241,14 @@ extern polar_logindex_bg_proc_t polar_bg_replaying_process;
 #define POLAR_IN_PARALLEL_REPLAY_STANDBY_MODE(ins) (polar_is_standby() && ins && \
 	polar_get_bg_redo_state(ins) == POLAR_BG_PARALLEL_REPLAYING)
 
+/* POLAR: Parallel replay during crash recovery of the primary node. */
+#define POLAR_ENABLE_PARALLEL_REPLAY_PRIMARY_RECOVERY() (polar_is_primary() && polar_logindex_redo_instance && \
+	polar_logindex_redo_instance->parallel_sched && polar_enable_parallel_replay_primary_recovery)
+#define POLAR_IN_PARALLEL_REPLAY_PRIMARY_RECOVERY(ins) (polar_is_primary() && ins && \
+	polar_get_bg_redo_state(ins) == POLAR_BG_PARALLEL_REPLAYING)
+#define POLAR_IN_PARALLEL_REPLAY_MODE(ins) (POLAR_IN_PARALLEL_REPLAY_STANDBY_MODE(ins) || \
+	POLAR_IN_PARALLEL_REPLAY_PRIMARY_RECOVERY(ins))
+
 #define POLAR_LOGINDEX_FULLPAGE_CTL_EXIST() (polar_logindex_redo_instance && polar_logindex_redo_instance->fullpage_ctl)
 #define POLAR_LOGINDEX_ENABLE_FULLPAGE() (polar_enable_fullpage_snapshot && POLAR_LOGINDEX_FULLPAGE_CTL_EXIST())
 #define POLAR_LOGINDEX_ENABLE_ONLINE_PROMOTE() (polar_enable_shared_storage_mode && polar_logindex_redo_instance && polar_is_replica())
@@ -298,6 +372,8 @@ extern void polar_logindex_promote_xlog_queue(polar_logindex_redo_ctl_t instance
 extern void polar_online_promote_data(polar_logindex_redo_ctl_t instance);
 extern void polar_standby_promote_data(polar_logindex_redo_ctl_t instance);
 extern void polar_wait_logindex_bg_stop_replay(polar_logindex_redo_ctl_t instance, Latch *latch);
+extern void polar_logindex_start_parallel_recovery(polar_logindex_redo_ctl_t instance, XLogRecPtr redo_start_lsn);
+extern void polar_logindex_finish_parallel_recovery(polar_logindex_redo_ctl_t instance, Latch *latch);
 extern void polar_logindex_replay_db(polar_logindex_redo_ctl_t instance, Oid dbnode);
 
 extern void polar_checkpoint_ringbuf_init(polar_checkpoint_ringbuf checkpoint_rbuf, int size);
@@ -0,0 +1,75 @@
+/*-------------------------------------------------------------------------
+ *
+ * polar_page_lsn_cache.h
+ *
+ * Copyright (c) 2024, Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * IDENTIFICATION
+ *	  src/include/access/polar_page_lsn_cache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef POLAR_PAGE_LSN_CACHE_H
+#define POLAR_PAGE_LSN_CACHE_H
+
+#include "access/xlogdefs.h"
+#include "port/atomics.h"
+#include "storage/buf_internals.h"
+
+/*
+ * Each entry remembers one lsn range which is already resolved from logindex
+ * for a page: there is no logindex record of this page whose lsn is in
+ * (empty_from, empty_to].  Logindex records are appended in lsn order, so
+ * the range stays valid once it is resolved, until logindex is reset,
+ * promoted or truncated.  Then the generation of logindex is bumped, and the
+ * entries resolved from an older generation are ignored.
+ *
+ * The entry is protected by a seqlock.  version is odd while a writer is
+ * changing the entry.  Readers never wait, they treat a changing entry as
+ * a miss.  Writers never wait either, they give up if the entry is being
+ * changed by someone else.
+ */
+typedef struct polar_page_lsn_cache_entry_t
+{
+	pg_atomic_uint32 version;
+	uint32		generation;		/* of logindex the range is resolved from */
+	BufferTag	tag;
+	XLogRecPtr	empty_from;
+	XLogRecPtr	empty_to;
+} polar_page_lsn_cache_entry_t;
+
+typedef struct polar_page_lsn_cache_data_t
+{
+	uint32		size;
+	pg_atomic_uint64 hits;
+	pg_atomic_uint64 misses;
+	polar_page_lsn_cache_entry_t entries[FLEXIBLE_ARRAY_MEMBER];
+} polar_page_lsn_cache_data_t;
+
+typedef polar_page_lsn_cache_data_t *polar_page_lsn_cache_t;
+
+extern int	polar_logindex_page_lsn_cache_size;
+
+extern Size polar_page_lsn_cache_shmem_size(int size);
+extern polar_page_lsn_cache_t polar_page_lsn_cache_shmem_init(const char *name, int size);
+extern bool polar_page_lsn_cache_lookup(polar_page_lsn_cache_t cache, BufferTag *tag,
+										uint32 generation, XLogRecPtr *empty_from,
+										XLogRecPtr *empty_to);
+extern void polar_page_lsn_cache_update(polar_page_lsn_cache_t cache, BufferTag *tag,
+										uint32 generation, XLogRecPtr empty_from,
+										XLogRecPtr empty_to);
+extern void polar_page_lsn_cache_count(polar_page_lsn_cache_t cache, bool hit);
+
+#endif
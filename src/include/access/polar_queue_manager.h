@@ -56,6 +56,8 @@ extern int	polar_xlog_queue_buffers;
 
 #define POLAR_XLOG_QUEUE_DATA_KEEP_RATIO (0.6)
 
+#define POLAR_XLOG_DECODE_WORKER_NAME "logindex decode worker"
+
 #define POLAR_COPY_QUEUE_CONTENT(ref, offset, _dst, _size) \
 	do {\
 		ssize_t len = polar_ringbuf_read_next_pkt((ref), (offset), \
@@ -70,6 +72,7 @@ extern int	polar_xlog_queue_buffers;
 
 extern Size polar_xlog_queue_size(int size_MB);
 extern polar_ringbuf_t polar_xlog_queue_init(const char *name, int tranche_id, int size_MB);
+extern polar_ringbuf_t polar_xlog_decode_queue_init(const char *name, int tranche_id, int size_MB);
 extern bool polar_xlog_send_queue_push(polar_ringbuf_t queue, size_t rbuf_pos, struct XLogRecData *rdata, int copy_len,
 									   XLogRecPtr end_lsn, uint32 xlog_len);
 extern void polar_standby_xlog_send_queue_push(polar_ringbuf_t queue, XLogReaderState *xlogreader);
@@ -93,4 +96,8 @@ extern bool polar_xlog_remove_payload(XLogRecord *record);
 extern bool polar_xlog_queue_decode(XLogReaderState *state, DecodedXLogRecord *decoded, XLogRecord *record,
 									uint32_t record_meta_len, bool decode_payload);
 extern void polar_xlog_queue_update_reader(XLogReaderState *state, XLogRecPtr read_rec_ptr, XLogRecPtr end_rec_ptr);
+
+extern void polar_xlog_decode_launch_worker(void);
+extern void polar_xlog_decode_terminate_worker(void);
+extern void polar_xlog_decode_worker_main(Datum main_arg);
 #endif
@@ -159,6 +159,8 @@ typedef struct polar_ringbuf_data_t
 #define POLAR_RINGBUF_PKT_WAL_STORAGE_END       (0x30)	/* Indicate we will read
 														 * from queue after this
 														 * position */
+#define POLAR_RINGBUF_PKT_WAL_DECODED           (0x40)	/* The packet content is
+														 * decoded xlog record */
 #define POLAR_RINGBUF_PKT_TYPE_MASK             (0xF0)	/* The packet type mask */
 
 /* Get the packet data size and idx is the start position of the packet */
@@ -65,6 +65,18 @@ extern int	polar_wal_init_set_size;
 #define POLAR_MIN_XLOG_FILL_ZERO_SIZE XLOG_BLCKSZ
 #define POLAR_MAX_XLOG_FILL_ZERO_SIZE 4 * 1024 * 1024
 
+/* POLAR: number of WAL insertion locks, -1 means auto-tune */
+extern int	polar_xlog_insert_locks;
+
+#define POLAR_XLOG_INSERT_LOCKS_AUTO_MAX 64
+#define POLAR_XLOG_INSERT_LOCKS_MAX 128
+
+/* POLAR: WAL group commit */
+extern bool polar_enable_wal_group_commit;
+
+#define POLAR_WAL_GROUP_SIZE_BUCKETS 10
+#define POLAR_WAL_GROUP_WAIT_BUCKETS 21
+
 /* Archive modes */
 typedef enum ArchiveMode
 {
@@ -294,6 +306,7 @@ extern void polar_checkpointer_do_reload(void);
 extern void polar_set_available_state(bool state);
 extern bool polar_get_available_state(void);
 extern XLogRecPtr polar_get_xlog_insert_ptr_nolock(void);
+extern void polar_get_wal_group_commit_stats(uint64 *size_hist, uint64 *wait_hist);
 
 /*
  * Routines used by xlogrecovery.c to call back into xlog.c during recovery.
@@ -15,6 +15,23 @@
 
 typedef struct bloom_filter bloom_filter;
 
+/* POLAR: max number of hash functions used by a bloom filter */
+#define POLAR_BLOOM_MAX_HASH_FUNCS	10
+
+/*
+ * POLAR: Precomputed bit positions of one element.  They only depend on the
+ * element and on the filter's seed, size and number of hash functions, so a
+ * probe can be tested against many filters of the same shape without hashing
+ * the element again.
+ */
+typedef struct polar_bloom_probe
+{
+	int			k_hash_funcs;	/* 0 means not prepared yet */
+	uint64		seed;
+	uint64		m;
+	uint32		hashes[POLAR_BLOOM_MAX_HASH_FUNCS];
+} polar_bloom_probe;
+
 extern bloom_filter *bloom_create(int64 total_elems, int bloom_work_mem,
 								  uint64 seed);
 extern void bloom_free(bloom_filter *filter);
@@ -26,5 +43,9 @@ extern double bloom_prop_bits_set(bloom_filter *filter);
 
 extern bloom_filter *polar_bloom_init_struct(uint8 *bloom_buf, size_t bloom_buf_size,
 											 int64 total_elems, uint64 seed);
+extern void polar_bloom_prepare_probe(bloom_filter *filter, polar_bloom_probe *probe,
+									  unsigned char *elem, size_t len);
+extern bool polar_bloom_probe_lacks_element(bloom_filter *filter,
+											polar_bloom_probe *probe);
 
 #endif							/* BLOOMFILTER_H */
@@ -0,0 +1,56 @@
+/*-------------------------------------------------------------------------
+ *
+ * polar_aio.h
+ *	  Asynchronous I/O engines of polar vfs.
+ *
+ * Copyright (c) 2024, Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * IDENTIFICATION
+ *    src/include/polar_vfs/polar_aio.h
+ *
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef POLAR_AIO_H
+#define POLAR_AIO_H
+
+#include "postgres.h"
+
+#include "storage/polar_fd.h"
+
+#ifdef HAVE_LINUX_IO_URING_H
+#define POLAR_AIO_USE_URING
+#endif
+
+#define POLAR_AIO_URING_DEPTH			128
+#define POLAR_AIO_DEFAULT_THREADS		4
+#define POLAR_AIO_MAX_THREADS			64
+
+extern int	polar_aio_threads;
+extern bool polar_aio_use_uring;
+
+/* io_uring of local file system, the thread pool if it is unavailable */
+extern int	polar_aio_uring_submit(polar_aio_req *reqs, int nreqs);
+extern int	polar_aio_uring_wait(polar_aio_req *reqs, int nreqs, int min_done);
+
+/* Threads doing the synchronous I/O of req->mgr */
+extern int	polar_aio_pool_submit(polar_aio_req *reqs, int nreqs);
+extern int	polar_aio_pool_wait(polar_aio_req *reqs, int nreqs, int min_done);
+
+/* Requests of this process not done yet, and waiting for all of them */
+extern int	polar_aio_inflight(void);
+extern void polar_aio_drain(void);
+
+#endif							/* POLAR_AIO_H */
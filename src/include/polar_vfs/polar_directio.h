@@ -41,8 +41,18 @@
 #define POLAR_DIRECTIO_DEFAULT_IOSIZE   (1 * 1024 * 1024)
 #define POLAR_DIRECTIO_MAX_IOSIZE       (128 * 1024 * 1024)
 
+/* Number of fd slots caching the last written tail block */
+#define POLAR_DIRECTIO_TAIL_CACHE_SIZE  64
+/* Number of shared write generations of files */
+#define POLAR_DIRECTIO_WRITE_GEN_SLOTS  4096
+
 extern int	polar_max_direct_io_size;
 extern char *polar_directio_buffer;
+extern bool polar_directio_tail_cache;
+
+/* Blocks read and not read by read-modify-write of this process */
+extern uint64 polar_directio_rmw_reads;
+extern uint64 polar_directio_rmw_reads_avoided;
 extern const vfs_mgr polar_vfs_dio;
 
 #define POLAR_ACCESS_MODE_MASK      0x3
@@ -52,6 +62,10 @@ extern const vfs_mgr polar_vfs_dio;
 #define POLAR_DIECRTIO_IS_ALIGNED(LEN)  !((uintptr_t)(LEN) & (uintptr_t)(POLAR_DIRECTIO_ALIGN_LEN - 1))
 
 extern int	polar_directio_open(const char *path, int flags, mode_t mode);
+extern int	polar_directio_close(int fd);
+extern int	polar_directio_ftruncate(int fd, off_t len);
+extern int	polar_directio_truncate(const char *path, off_t len);
+extern void polar_directio_forget_tail_block(int fd);
 extern ssize_t polar_directio_read(int fd, void *buf, size_t len);
 extern ssize_t polar_directio_pread(int fd, void *buffer, size_t len, off_t offset);
 extern ssize_t polar_directio_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
@@ -59,4 +73,9 @@ extern ssize_t polar_directio_write(int fd, const void *buf, size_t len);
 extern ssize_t polar_directio_pwrite(int fd, const void *buffer, size_t len, off_t offset);
 extern ssize_t polar_directio_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
 
+#ifndef FRONTEND
+extern Size polar_directio_shmem_size(void);
+extern void polar_directio_shmem_init(void);
+#endif
+
 #endif							/* POLAR_DIRECTIO_H */
@@ -41,6 +41,7 @@
 
 #include "access/xlog.h"
 #include "miscadmin.h"
+#include "polar_vfs/polar_aio.h"
 #include "polar_vfs/polar_bufferio.h"
 #include "polar_vfs/polar_directio.h"
 #include "polar_vfs/polar_pfsd.h"
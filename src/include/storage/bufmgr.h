@@ -267,6 +267,7 @@ extern void TestForOldSnapshot_impl(Snapshot snapshot, Relation relation);
 /* in freelist.c */
 extern BufferAccessStrategy GetAccessStrategy(BufferAccessStrategyType btype);
 extern void FreeAccessStrategy(BufferAccessStrategy strategy);
+extern int	GetAccessStrategyBufferCount(BufferAccessStrategy strategy);
 
 /* POLAR */
 extern void PolarMarkBufferDirty(Buffer buffer, XLogRecPtr oldest_lsn);
@@ -269,10 +269,6 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_POLAR_COMMIT_TS_LOCAL_CACHE,
 	LWTRANCHE_POLAR_MULTIXACT_OFFSET_LOCAL_CACHE,
 	LWTRANCHE_POLAR_MULTIXACT_MEMBER_LOCAL_CACHE,
-	/* POLAR xlog buffer */
-	LWTRANCHE_XLOG_BUFFER_CONTENT,
-	/* POLAR end */
-
 	/* POLAR RSC */
 	LWTRANCHE_POLAR_RSC_MAPPING_LOCKS,
 	/* POLAR end */
@@ -54,4 +54,8 @@ extern void polar_mdbulkextend(SMgrRelation reln, ForkNumber forknum, BlockNumbe
 							   int blockCount, char *buffer, bool skipFsync);
 extern void polar_mdbulkread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 							 int blockCount, char *buffer);
+extern bool polar_mdbulkread_req(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+								 int blockCount, char *buffer, struct polar_aio_req *req);
+extern void polar_mdbulkwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+							  int blockCount, char *buffer, bool skipFsync);
 #endif							/* MD_H */
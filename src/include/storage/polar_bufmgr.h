@@ -27,10 +27,31 @@
 
 #include "storage/buf.h"
 #include "storage/bufpage.h"
+#include "storage/smgr.h"
 
 typedef struct BufferDesc BufferDesc;
 typedef struct WritebackContext WritebackContext;
 
+/*
+ * POLAR: asynchronous read-ahead of a scan into shared buffers, see
+ * polar_bulk_read_ahead(). It's kept by the scan from
+ * polar_bulk_read_ahead_begin() to polar_bulk_read_ahead_end().
+ */
+typedef struct polar_read_ahead_batch polar_read_ahead_batch;
+
+typedef struct polar_read_ahead_state
+{
+	RelFileNode rnode;			/* relation fork read ahead */
+	ForkNumber	forknum;
+	BlockNumber next;			/* first block not read ahead yet */
+	int			inflight;		/* blocks pinned by the batches */
+	uint64		nread;			/* blocks put into shared buffers */
+	polar_read_ahead_batch *head;	/* batches in flight, oldest first */
+	polar_read_ahead_batch *tail;
+	MemoryContext mcxt;			/* where the batches are allocated */
+	MemoryContextCallback callback; /* waits for the requests in flight */
+} polar_read_ahead_state;
+
 #define polar_buffer_get_oldest_lsn(buf_hdr) \
 	(pg_atomic_read_u64((pg_atomic_uint64 *) &buf_hdr->oldest_lsn))
 
@@ -64,6 +85,21 @@ extern Buffer polar_bulk_read_buffer(Relation reln, BlockNumber blockNum, BlockN
 extern Buffer polar_bulk_read_buffer_extended(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
 											  ReadBufferMode mode, BufferAccessStrategy strategy,
 											  BlockNumber maxBlockCount);
+extern polar_read_ahead_state *polar_bulk_read_ahead_begin(MemoryContext mcxt);
+extern void polar_bulk_read_ahead(polar_read_ahead_state *state, Relation reln, ForkNumber forkNum,
+								  BlockNumber blockNum, BlockNumber nblocks,
+								  BufferAccessStrategy strategy);
+extern int	polar_bulk_read_ahead_buffers(polar_read_ahead_state *state, SMgrRelation smgr,
+										  char relpersistence, ForkNumber forkNum,
+										  BlockNumber blockNum, int nblocks,
+										  BufferAccessStrategy strategy);
+extern int	polar_bulk_read_ahead_blocks(polar_read_ahead_state *state, SMgrRelation smgr,
+										 char relpersistence, ForkNumber forkNum,
+										 const BlockNumber *blocknums, int nblocks,
+										 BufferAccessStrategy strategy, int *nfound);
+extern void polar_bulk_read_ahead_release(polar_read_ahead_state *state, BlockNumber blockNum);
+extern void polar_bulk_read_ahead_complete(polar_read_ahead_state *state, bool wait);
+extern void polar_bulk_read_ahead_end(polar_read_ahead_state *state);
 extern bool polar_is_future_page(BufferDesc *buf_hdr);
 extern bool polar_buffer_need_fullpage_snapshot(BufferDesc *buf_hdr, XLogRecPtr oldest_apply_lsn);
 #endif							/* POLAR_BUFMGR_H */
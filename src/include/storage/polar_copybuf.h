@@ -62,6 +62,12 @@ typedef struct CopyBufferDesc
 	 */
 	pg_atomic_uint32 pass_count;
 	bool		is_flushed;
+
+	/*
+	 * 1 if the copy buffer is out of the active part of an elastic pool and
+	 * is in no freelist.
+	 */
+	pg_atomic_uint32 parked;
 } CopyBufferDesc;
 
 #define COPYBUFFERDESC_PAD_TO_SIZE	(SIZEOF_VOID_P == 8 ? 64 : 1)
@@ -89,14 +95,40 @@ typedef union CopyBufferDescPadded
 #define polar_copy_buffer_enabled() \
 	(polar_enable_shared_storage_mode && polar_copy_buffers)
 
+/*
+ * The number of copy buffers reserved in shared memory. The pool is elastic
+ * if polar_copy_buffers_max is greater than polar_copy_buffers, its active
+ * size is adjusted between them by bgwriter.
+ */
+#define polar_copy_buffers_reserved() \
+	(Max(polar_copy_buffers, polar_copy_buffers_max))
+
+#define POLAR_COPY_BUFFER_PARTITIONS 16
+
+/*
+ * The freelist of a partition, a lock-free stack. The high 32 bits of head
+ * is bumped by every change against ABA, the low 32 bits is buf_id + 1 of
+ * the first free copy buffer, 0 if the freelist is empty.
+ */
+typedef union CopyBufferFreeList
+{
+	pg_atomic_uint64 head;
+	char		pad[PG_CACHE_LINE_SIZE];
+} CopyBufferFreeList;
+
+/* Pack the ABA counter and the copy buffer of a freelist head */
+#define COPYBUFFER_FREELIST_HEAD(counter, buf_id) \
+	(((uint64) (counter) << 32) | (uint32) ((buf_id) + 1))
+#define COPYBUFFER_FREELIST_HEAD_COUNTER(head) ((uint32) ((head) >> 32))
+#define COPYBUFFER_FREELIST_HEAD_BUF_ID(head) ((int) ((uint32) (head)) - 1)
+
 /* The copy buffer freelist control information. */
 typedef struct CopyBufferControl
 {
-	/* Spinlock: protects the values below */
-	slock_t		copy_buffer_ctl_lock;
+	int			num_partitions;
 
-	int			first_free_buffer;	/* Head of list of unused copy buffers */
-	int			last_free_buffer;	/* Tail of list of unused copy buffers */
+	/* Copy buffers with buf_id below it can be allocated */
+	pg_atomic_uint32 active_buffers;
 
 	/* Statistic info */
 	pg_atomic_uint64 flushed_count;
@@ -104,6 +136,12 @@ typedef struct CopyBufferControl
 	pg_atomic_uint64 copied_count;
 	pg_atomic_uint64 unavailable_count;
 	pg_atomic_uint64 full_count;
+	pg_atomic_uint64 alloc_count;
+	pg_atomic_uint64 alloc_time;	/* in nanoseconds */
+	pg_atomic_uint64 grow_count;
+	pg_atomic_uint64 shrink_count;
+
+	CopyBufferFreeList freelists[POLAR_COPY_BUFFER_PARTITIONS];
 } CopyBufferControl;
 
 extern CopyBufferControl *polar_copy_buffer_ctl;
@@ -117,5 +155,9 @@ extern void polar_flush_copy_buffer(BufferDesc *buf, SMgrRelation reln);
 extern void polar_buffer_copy_if_needed(BufferDesc *buf, XLogRecPtr oldest_apply_lsn);
 extern bool polar_buffer_copy_is_satisfied(BufferDesc *buf, XLogRecPtr oldest_apply_lsn, bool check_io);
 extern XLogRecPtr polar_copy_buffers_get_oldest_lsn(void);
+extern void polar_adjust_copy_buffer_pool(uint64 consistent_lag);
+extern void polar_resize_copy_buffer_pool(uint32 target);
+extern CopyBufferDesc *polar_get_free_copy_buffer(void);
+extern void polar_put_free_copy_buffer(CopyBufferDesc *cbuf);
 
 #endif							/* POLAR_COPYBUF_H */
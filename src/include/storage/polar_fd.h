@@ -133,6 +133,37 @@ extern bool polar_vfs_is_dio_mode;
 
 typedef int (*vfs_open_type) (const char *path, int flags, mode_t mode);
 
+struct vfs_mgr;
+
+#define POLAR_AIO_READ		0
+#define POLAR_AIO_WRITE		1
+
+/*
+ * One asynchronous read or write of polar_aio_submit(). The caller fills the
+ * first part and keeps the request in place until it is done; result and
+ * error are like the return value and errno of pread/pwrite.
+ */
+typedef struct polar_aio_req
+{
+	int			op;				/* POLAR_AIO_READ or POLAR_AIO_WRITE */
+	int			fd;
+	void	   *buf;
+	size_t		len;
+	off_t		offset;
+	void	   *private_data;	/* for the caller */
+
+	/* Set by vfs */
+	bool		done;
+	ssize_t		result;
+	int			error;
+	int			real_fd;		/* fd of the storage under vfs interface */
+	const struct vfs_mgr *mgr;	/* vfs_mgr of real_fd */
+	void	   *write_gen;		/* bumped when the write is done, see
+								 * polar_directio.c */
+	struct iovec iov;			/* for io_uring */
+	struct polar_aio_req *next; /* for the thread pool queue */
+} polar_aio_req;
+
 typedef struct vfs_mgr
 {
 	int			(*vfs_env_init) (void);
@@ -170,6 +201,14 @@ typedef struct vfs_mgr
 	int			(*vfs_sync_file_range) (int fd, off_t offset, off_t nbytes, unsigned int flags);
 	int			(*vfs_posix_fadvise) (int fd, off_t offset, off_t len, int advice);
 	int			(*vfs_umount) (char *ftype, const char *pbdname);
+
+	/*
+	 * Start nreqs requests, return how many are started or -1. Wait until
+	 * min_done of reqs are done or no started request is left, return how
+	 * many of reqs are done; min_done 0 only polls.
+	 */
+	int			(*vfs_aio_submit) (polar_aio_req *reqs, int nreqs);
+	int			(*vfs_aio_wait) (polar_aio_req *reqs, int nreqs, int min_done);
 } vfs_mgr;
 
 extern vfs_mgr polar_vfs[];
@@ -475,6 +514,78 @@ polar_posix_fadvise(int fd, off_t offset, off_t len, int advice)
 	return rc;
 }
 
+/*
+ * Do one request synchronously by mgr, for storage without asynchronous I/O.
+ */
+static inline void
+polar_aio_do_sync(const vfs_mgr *mgr, polar_aio_req *req)
+{
+	if (req->op == POLAR_AIO_READ)
+		req->result = mgr->vfs_pread(req->real_fd, req->buf, req->len, req->offset);
+	else
+		req->result = mgr->vfs_pwrite(req->real_fd, req->buf, req->len, req->offset);
+
+	req->error = req->result < 0 ? errno : 0;
+	req->done = true;
+}
+
+static inline int
+polar_aio_count_done(polar_aio_req *reqs, int nreqs)
+{
+	int			i;
+	int			ndone = 0;
+
+	for (i = 0; i < nreqs; i++)
+	{
+		if (reqs[i].done)
+			ndone++;
+	}
+
+	return ndone;
+}
+
+/*
+ * Submit a batch of reads and writes. Storage without asynchronous I/O does
+ * them right now, so polar_aio_wait() always finds them done.
+ */
+static inline int
+polar_aio_submit(polar_aio_req *reqs, int nreqs)
+{
+	const vfs_mgr *mgr = &polar_vfs[polar_vfs_switch];
+	int			i;
+
+	for (i = 0; i < nreqs; i++)
+	{
+		reqs[i].done = false;
+		reqs[i].result = -1;
+		reqs[i].error = 0;
+		reqs[i].real_fd = reqs[i].fd;
+		reqs[i].mgr = mgr;
+		reqs[i].write_gen = NULL;
+	}
+
+	if (mgr->vfs_aio_submit)
+		return mgr->vfs_aio_submit(reqs, nreqs);
+
+	for (i = 0; i < nreqs; i++)
+		polar_aio_do_sync(mgr, &reqs[i]);
+
+	return nreqs;
+}
+
+/*
+ * Wait until at least min_done of reqs are done, return how many are done.
+ * With min_done 0, just poll.
+ */
+static inline int
+polar_aio_wait(polar_aio_req *reqs, int nreqs, int min_done)
+{
+	if (polar_vfs[polar_vfs_switch].vfs_aio_wait)
+		return polar_vfs[polar_vfs_switch].vfs_aio_wait(reqs, nreqs, min_done);
+
+	return polar_aio_count_done(reqs, nreqs);
+}
+
 static inline int
 polar_umount(char *ftype, const char *pbdname)
 {
@@ -33,9 +33,16 @@
 
 #define FLUSH_LIST_LEN (pg_atomic_read_u32(&polar_flush_ctl->count))
 
-#define polar_flush_list_is_empty() \
-    (polar_flush_ctl->first_flush_buffer == POLAR_FLUSHNEXT_END_OF_LIST && \
-    polar_flush_ctl->last_flush_buffer == POLAR_FLUSHNEXT_END_OF_LIST)
+/* The upper limit of polar_flush_list_partitions */
+#define POLAR_MAX_FLUSH_LIST_PARTITIONS 128
+
+/* Each buffer always lives in the same partition, keyed by its buffer id */
+#define polar_flush_list_partition_of(buf_id) \
+	(&polar_flush_ctl->partitions[(buf_id) % polar_flush_ctl->num_partitions].part)
+
+#define polar_flush_list_partition_is_empty(part) \
+    ((part)->first_flush_buffer == POLAR_FLUSHNEXT_END_OF_LIST && \
+    (part)->last_flush_buffer == POLAR_FLUSHNEXT_END_OF_LIST)
 
 #define polar_flush_list_enabled() \
 	(polar_enable_shared_storage_mode && polar_enable_flushlist)
@@ -50,6 +57,12 @@
 #define POLAR_FLUSHNEXT_END_OF_LIST	(-1)
 #define POLAR_FLUSHNEXT_NOT_IN_LIST	(-2)
 
+/*
+ * Buckets of the sizes of bgwriter writes, bucket i counts the writes of
+ * (2^(i-1), 2^i] blocks, up to POLAR_MAX_BULK_IO_SIZE blocks.
+ */
+#define POLAR_WRITE_COMBINE_HIST_SIZE 7
+
 typedef struct polar_sync_buffer_io
 {
 	/* flush woker flush buffer count */
@@ -65,12 +78,13 @@ typedef struct polar_sync_buffer_io
 } polar_sync_buffer_io;
 
 
-/* The shared flush list control information. */
-typedef struct FlushControl
+/*
+ * One partition of the flush list. Buffers are spread over partitions by
+ * buffer id, every partition is ordered by oldest lsn on its own, and the
+ * global order is the merge of all partitions by their head_lsn.
+ */
+typedef struct polar_flush_list_partition_t
 {
-	/* The number of buffers in flush list */
-	pg_atomic_uint32 count;
-
 	/* Spinlock: protects flushlist values below */
 	slock_t		flushlist_lock;
 
@@ -81,6 +95,26 @@ typedef struct FlushControl
 	int			latest_flush_count; /* The number of buffers all parallel
 									 * bgwriters flushed latest */
 
+	/*
+	 * Oldest lsn of the first buffer, InvalidXLogRecPtr if the partition is
+	 * empty. Written with flushlist_lock held, can be read without lock.
+	 */
+	pg_atomic_uint64 head_lsn;
+} polar_flush_list_partition_t;
+
+/* Pad partitions to cache lines to avoid false sharing between locks */
+typedef union polar_flush_list_partition_padded
+{
+	polar_flush_list_partition_t part;
+	char		pad[PG_CACHE_LINE_SIZE];
+} polar_flush_list_partition_padded;
+
+/* The shared flush list control information. */
+typedef struct FlushControl
+{
+	/* The number of buffers in flush list */
+	pg_atomic_uint32 count;
+
 	/* LWlock: flush copy buffer */
 	LWLock		cbuflock;
 
@@ -101,10 +135,17 @@ typedef struct FlushControl
 	pg_atomic_uint64 backend_flush;
 	pg_atomic_uint64 vm_insert;
 	pg_atomic_uint64 vm_remove;
+	pg_atomic_uint64 write_combine_hist[POLAR_WRITE_COMBINE_HIST_SIZE];
+
+	/* The number of flush list partitions, fixed at startup */
+	int			num_partitions;
+	polar_flush_list_partition_padded partitions[FLEXIBLE_ARRAY_MEMBER];
 } FlushControl;
 
 extern FlushControl *polar_flush_ctl;
 
+extern void polar_flush_list_set_own_partition(int worker_id);
+extern XLogRecPtr polar_flush_list_get_oldest_lsn(int *partition_id);
 extern int	polar_get_batch_buffer(int *batch_buf, int bgwriter_flush_batch_size);
 extern void polar_remove_buffer_from_flush_list(BufferDesc *buf);
 extern void polar_put_buffer_to_flush_list(BufferDesc *buf, XLogRecPtr lsn);
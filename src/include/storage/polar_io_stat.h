@@ -27,6 +27,9 @@
 
 #include "postgres.h"
 
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "portability/instr_time.h"
 
 /*
@@ -98,9 +101,10 @@ enum PLOARIOType
 	POLARIO_REPLSOT = 7,
 	POLARIO_SNAPSHOTS = 8,
 	POLARIO_SUBTRANS = 9,
-	POLARIO_OTHER = 10,
+	POLARIO_FULLPAGE = 10,
+	POLARIO_OTHER = 11,
 	/* NB: Define the size here for future maintenance */
-	POLARIO_TYPE_SIZE = 11
+	POLARIO_TYPE_SIZE = 12
 };
 
 /*
@@ -133,6 +137,108 @@ typedef struct POLAR_PROC_IO
 
 extern POLAR_PROC_IO *PolarIOStatArray;
 
+/*
+ * POLAR: vfs operations which have their own latency histogram.
+ */
+enum PolarIOHistOp
+{
+	POLARIO_HIST_OPEN = 0,
+	POLARIO_HIST_CREAT = 1,
+	POLARIO_HIST_READ = 2,
+	POLARIO_HIST_PREAD = 3,
+	POLARIO_HIST_PREADV = 4,
+	POLARIO_HIST_WRITE = 5,
+	POLARIO_HIST_PWRITE = 6,
+	POLARIO_HIST_PWRITEV = 7,
+	POLARIO_HIST_LSEEK = 8,
+	POLARIO_HIST_FSYNC = 9,
+	POLARIO_HIST_FALLOCATE = 10,
+	POLARIO_HIST_FTRUNCATE = 11,
+	POLARIO_HIST_STAT = 12,
+	/* NB: Define the size here for future maintenance */
+	POLARIO_HIST_OP_SIZE = 13
+};
+
+/*
+ * POLAR: log-bucketed latency histogram in HDR style, the unit is us.
+ * Latency below POLARIO_HIST_SUB_BUCKETS us has a bucket for each value,
+ * every larger power of two is split into POLARIO_HIST_SUB_BUCKETS linear
+ * sub buckets, so a bucket is at most 1/POLARIO_HIST_SUB_BUCKETS of its
+ * lower bound wide. Latency of 2^(POLARIO_HIST_MAX_MSB + 1) us or more is
+ * counted in the last bucket.
+ */
+#define POLARIO_HIST_SUB_BITS		2
+#define POLARIO_HIST_SUB_BUCKETS	(1 << POLARIO_HIST_SUB_BITS)
+#define POLARIO_HIST_MAX_MSB		24
+#define POLARIO_HIST_BUCKETS \
+	((POLARIO_HIST_MAX_MSB - POLARIO_HIST_SUB_BITS + 2) * POLARIO_HIST_SUB_BUCKETS)
+
+/* The backend type dimension is indexed by BackendType */
+#define POLARIO_HIST_BACKEND_TYPES	(B_BG_LOGINDEX + 1)
+
+typedef struct PolarIOHist
+{
+	pg_atomic_uint64 total_count;
+	pg_atomic_uint64 count[POLARIO_HIST_BUCKETS];
+} PolarIOHist;
+
+/*
+ * POLAR: latency histograms of vfs operations in three dimensions, that are
+ * backend type, vfs operation and file type. Unlike POLAR_PROC_IO they are
+ * shared by all processes of the same backend type and never reset, so they
+ * are updated by atomic operations and survive process exit.
+ */
+typedef struct POLAR_IO_HIST
+{
+	PolarIOHist hist[POLARIO_HIST_BACKEND_TYPES][POLARIO_HIST_OP_SIZE][POLARIO_TYPE_SIZE];
+} POLAR_IO_HIST;
+
+extern POLAR_IO_HIST *PolarIOHistArray;
+
+/* Map latency in us to its histogram bucket */
+static inline int
+polar_io_hist_bucket(uint64 us)
+{
+	int			msb;
+
+	if (us < POLARIO_HIST_SUB_BUCKETS)
+		return (int) us;
+
+	msb = pg_leftmost_one_pos64(us);
+	if (msb > POLARIO_HIST_MAX_MSB)
+		return POLARIO_HIST_BUCKETS - 1;
+
+	return (msb - POLARIO_HIST_SUB_BITS + 1) * POLARIO_HIST_SUB_BUCKETS +
+		(int) ((us >> (msb - POLARIO_HIST_SUB_BITS)) & (POLARIO_HIST_SUB_BUCKETS - 1));
+}
+
+/* The inclusive lower bound in us of a histogram bucket */
+static inline uint64
+polar_io_hist_bucket_lower(int bucket)
+{
+	int			msb;
+	uint64		sub;
+
+	if (bucket < POLARIO_HIST_SUB_BUCKETS)
+		return (uint64) bucket;
+
+	msb = bucket / POLARIO_HIST_SUB_BUCKETS + POLARIO_HIST_SUB_BITS - 1;
+	sub = bucket % POLARIO_HIST_SUB_BUCKETS;
+
+	return (POLARIO_HIST_SUB_BUCKETS + sub) << (msb - POLARIO_HIST_SUB_BITS);
+}
+
+/* The exclusive upper bound in us of a histogram bucket */
+static inline uint64
+polar_io_hist_bucket_upper(int bucket)
+{
+	if (bucket < POLARIO_HIST_SUB_BUCKETS)
+		return (uint64) bucket + 1;
+
+	return polar_io_hist_bucket_lower(bucket) +
+		(UINT64CONST(1) << (bucket / POLARIO_HIST_SUB_BUCKETS - 1));
+}
+
 /*
  * POLAR: use this struct to collect io read throughtput using for crash recovery
  * rto optimizer.
@@ -44,6 +44,7 @@ typedef enum
 	POLAR_TASK_NODE_IDLE = 0,
 	POLAR_TASK_NODE_RUNNING,
 	POLAR_TASK_NODE_HOLD,
+	POLAR_TASK_NODE_FETCHED,	/* Claimed by one sub process to handle */
 	POLAR_TASK_NODE_FINISHED,
 	POLAR_TASK_NODE_REMOVED
 } polar_task_stat_t;
@@ -61,6 +62,12 @@ typedef enum
 
 #define POLAR_TASK_NAME_MAX_LEN         (128)
 
+/* Adjust the queue depth of sub processes every this number of added tasks */
+#define POLAR_SCHED_ADAPT_DEPTH_INTERVAL	(1024)
+
+extern bool polar_procpool_work_stealing;
+extern bool polar_procpool_adaptive_queue_depth;
+
 typedef struct polar_task_node_t
 {
 	SHM_QUEUE	depend_task;	/* Link task which depend on previous task */
@@ -98,6 +105,24 @@ typedef struct polar_task_node_t
 		pg_atomic_write_u32(&(t)->task_status, _status_); \
 	} while (0)
 
+/*
+ * Statistics and scheduling state of one sub process, kept in shared memory
+ * after the task nodes so that they survive restart of the process pool.
+ */
+typedef struct polar_sub_proc_stat_t
+{
+	pg_atomic_uint32 pid;
+	pg_atomic_uint32 idle;		/* Waiting for new task */
+	pg_atomic_uint32 depth_limit;	/* Max queued tasks, set by dispatcher */
+	pg_atomic_uint32 queued_tasks;	/* Queued tasks, set by dispatcher */
+	pg_atomic_uint64 fetched_seq;	/* Max add_seq passed in its own ring */
+	pg_atomic_uint64 handled_tasks; /* Include the stolen tasks */
+	pg_atomic_uint64 stolen_tasks;	/* Tasks stolen from other rings */
+	pg_atomic_uint64 lost_tasks;	/* Tasks in its ring stolen by others */
+	pg_atomic_uint64 busy_us;
+	pg_atomic_uint64 idle_us;
+} polar_sub_proc_stat_t;
+
 typedef struct polar_task_sched_t polar_task_sched_t;
 typedef void (*polar_task_handle_startup) (void *run_arg);
 typedef bool (*polar_task_handler) (polar_task_sched_t *, polar_task_node_t *);
@@ -140,6 +165,9 @@ typedef struct polar_sub_proc_t
 	polar_task_node_t *ring_task_nodes_end; /* The end address of the ring */
 	uint64		running_tasks_num;	/* The number of tasks dispatched to this
 									 * process */
+	uint32		queued_tasks;	/* The number of tasks in this ring */
+	uint32		depth_limit;	/* Adaptive limit of queued_tasks */
+	uint64		reset_tasks;	/* Tasks reset in this ring, for adaptation */
 } polar_sub_proc_t;
 
 typedef struct polar_task_sched_ctl_t
@@ -159,6 +187,8 @@ typedef struct polar_task_sched_ctl_t
 								 * when dispatch */
 	uint64		reset_task_num; /* Total number reset task's status to be idle
 								 * when it's finished */
+	uint64		adapt_added_num;	/* added_task_num when adjust queue depth */
+	uint64		adapt_fail_num; /* fail_add_task_num when adjust queue depth */
 	polar_dispatcher_handle_finished handle_finished;
 	void	   *finished_arg;
 	polar_sub_proc_t sub_proc[FLEXIBLE_ARRAY_MEMBER];
@@ -198,6 +228,15 @@ polar_sched_empty_running_task(polar_task_sched_ctl_t *ctl)
 	return ctl->running_task_head == NULL;
 }
 
+#define POLAR_SCHED_TASK_NODES_SIZE(parallel_num, task_node_size, task_queue_depth) \
+	((parallel_num) * (task_node_size) * (task_queue_depth))
+
+#define POLAR_SCHED_PROC_STAT(sched, i) \
+	(((polar_sub_proc_stat_t *) (((char *) (sched)) + \
+		MAXALIGN(offsetof(polar_task_sched_t, task_nodes) + \
+				 POLAR_SCHED_TASK_NODES_SIZE((sched)->total_proc, (sched)->task_node_size, \
+											 (sched)->task_queue_depth)))) + (i))
+
 #define POLAR_SCHED_TASK_POINT(sched, task_begin, task_index) \
 	((polar_task_node_t *)(((char *)task_begin) + (sched)->task_node_size * (task_index)))
 
@@ -53,9 +53,23 @@ typedef struct polar_rsc_shared_relation_t
 	int64		usecount;		/* used for clock sweep */
 } polar_rsc_shared_relation_t;
 
-typedef struct polar_rsc_shared_relation_pool_t
+/*
+ * The pool is split into partitions for clock sweep, every partition has its
+ * own clock hand, and a backend evicts entries from the partition of its
+ * pgprocno first.
+ */
+#define POLAR_RSC_SWEEP_PARTITIONS	16
+
+typedef union polar_rsc_sweep_partition_t
 {
 	pg_atomic_uint32 next_sweep;
+	char		pad[PG_CACHE_LINE_SIZE];
+} polar_rsc_sweep_partition_t;
+
+typedef struct polar_rsc_shared_relation_pool_t
+{
+	int			num_sweep_partitions;
+	polar_rsc_sweep_partition_t sweep_partitions[POLAR_RSC_SWEEP_PARTITIONS];
 	polar_rsc_shared_relation_t entries[FLEXIBLE_ARRAY_MEMBER];
 } polar_rsc_shared_relation_pool_t;
 
@@ -25,22 +25,31 @@
 
 /*
  * Xlog buffer will reserve recent xlog pages in memory to reduce io overhead.
- * When lookup a xlog page, if buffer matched or current buffer is older than
- * requested page, we will return buffer id and hold content lock of buffer.
- * Caller should release content lock after read or update buffer.
+ *
+ * It's a set-associative cache: a xlog page can be cached by any of the
+ * POLAR_XLOG_BUFFER_WAYS slots of the set chosen by its page number, so pages
+ * which are read at the same time don't evict each other as long as there
+ * are free or older slots in the set.
+ *
+ * Every slot is protected by a seqlock instead of a lock. Writers make the
+ * version odd before they change the slot and even again when they're done.
+ * Readers copy the page without any lock, and only accept it when the version
+ * is even and unchanged after the copy, otherwise they retry or read the page
+ * from storage. Appending gives up if another process is writing the slot,
+ * while update and remove wait for it, because they invalidate xlog.
  *
  * For now, replace strategy is to reserve newer xlog pages than older ones. So
  * in polar_xlog_buffer_should_evict() we will check lsn from buffer meta and
- * requested page, if requested page is newer we will evict current buffer,
- * otherwise requested page should be obtained by io directly.
+ * requested page, if requested page is newer than the oldest page in the set
+ * we will evict it, otherwise requested page should be obtained by io directly.
  */
 
 #ifndef POLAR_XLOGBUF_H
 #define POLAR_XLOGBUF_H
 
 #include "access/xlogdefs.h"
+#include "port/atomics.h"
 #include "storage/buf.h"
-#include "storage/lwlock.h"
 
 /*
  * Enable xlog buffer in the following cases:
@@ -60,35 +69,21 @@
 	 (polar_is_replica() || polar_bg_redo_state_is_parallel(polar_logindex_redo_instance)))
 
 #define POLAR_XLOG_BUFFER_TOTAL_COUNT() (polar_xlog_page_buffers * 1024 / (XLOG_BLCKSZ / 1024))
-#define polar_get_xlog_buffer_id(lsn) (((lsn) / XLOG_BLCKSZ) % POLAR_XLOG_BUFFER_TOTAL_COUNT())
+#define POLAR_XLOG_BUFFER_WAYS 4
+#define POLAR_XLOG_BUFFER_SETS() (POLAR_XLOG_BUFFER_TOTAL_COUNT() / POLAR_XLOG_BUFFER_WAYS)
+#define polar_get_xlog_buffer_set(lsn) (((lsn) / XLOG_BLCKSZ) % POLAR_XLOG_BUFFER_SETS())
 #define polar_get_xlog_buffer_desc(buf_id) (&(polar_xlog_buffer_ins->buffer_descriptors[(buf_id)].desc))
 #define polar_get_xlog_buffer(buf_id) ((char *)(polar_xlog_buffer_ins->buffers + ((Size)(buf_id)) * XLOG_BLCKSZ))
-#define polar_xlog_buffer_desc_get_lock(buf) ((LWLock*)&(polar_xlog_buffer_ins->buffer_lock_array[(buf)->buf_id].lock))
 
 #define XLOGBUFFERDESC_PAD_TO_SIZE	(SIZEOF_VOID_P == 8 ? 64 : 1)
 #define MAX_READ_AHEAD_XLOGS 200
 
-/*
- * Split xlog buffer ops into two modes for polar_xlog_buffer_lookup(...):
- * POLAR_XLOG_BUFFER_SEARCH: try to lookup one xlog page in xlog buffer.
- * Then return true if found and lock it with LW_SHARED, oth return
- * false.
- * POLAR_XLOG_BUFFER_REPLACE: like POLAR_XLOG_BUFFER_SEARCH except for
- * replacing it with xlog page from disk if not found. Then return false
- * if not found and lock it with LW_EXCLUSIVE, or return true is found
- * and lock it with LW_SHARED.
- */
-typedef enum
-{
-	POLAR_XLOG_BUFFER_SEARCH,
-	POLAR_XLOG_BUFFER_REPLACE
-} polar_xlog_buffer_mode;
-
 typedef struct polar_xlog_buffer_desc
 {
+	pg_atomic_uint32 version;	/* odd while the slot is being written */
 	int			buf_id;			/* buffer index */
-	XLogRecPtr	start_lsn;
-	XLogRecPtr	end_lsn;
+	pg_atomic_uint64 start_lsn;
+	pg_atomic_uint64 end_lsn;
 } polar_xlog_buffer_desc;
 
 typedef union polar_xlog_buffer_desc_padded
@@ -101,11 +96,12 @@ typedef struct polar_xlog_buffer_ctl_t
 {
 	polar_xlog_buffer_desc_padded *buffer_descriptors;
 	char	   *buffers;
-	polar_lwlock_mini_padded *buffer_lock_array;
 	pg_atomic_uint64 hit_count;
 	pg_atomic_uint64 io_count;
 	pg_atomic_uint64 others_append_count;
 	pg_atomic_uint64 startup_append_count;
+	pg_atomic_uint64 evict_count;	/* a cached page is replaced by another */
+	pg_atomic_uint64 collision_count;	/* raced with a writer of the slot */
 } polar_xlog_buffer_ctl_t;
 typedef polar_xlog_buffer_ctl_t *polar_xlog_buffer_ctl;
 
@@ -121,25 +117,18 @@ extern bool polar_xlog_buffer_lookup(XLogRecPtr cur_page_lsn, int len, char *cur
 extern bool polar_xlog_buffer_append(XLogRecPtr cur_page_lsn, int len, char *cur_page);
 extern void polar_xlog_buffer_update(XLogRecPtr lsn);
 extern void polar_xlog_buffer_remove(XLogRecPtr lsn);
-
-static inline void
-polar_xlog_buffer_unlock(int buf_id)
-{
-	LWLockRelease(polar_xlog_buffer_desc_get_lock(polar_get_xlog_buffer_desc(buf_id)));
-}
+extern XLogRecPtr polar_xlog_buffer_get_end_lsn(XLogRecPtr lsn);
 
 /*
  * POLAR: Judge whether evict the buffer page from desc or not.
  *
- * Caller should hold the desc lock.
- *
  * For now, if requested page is older than buffed page, it won't evict buffer.
  */
 static inline bool
-polar_xlog_buffer_should_evict(polar_xlog_buffer_desc *buf, XLogRecPtr lsn, int len)
+polar_xlog_buffer_should_evict(XLogRecPtr buf_end_lsn, XLogRecPtr lsn, int len)
 {
 	/* If buffer valid size is smaller than current data, evict it.  */
-	if (buf->end_lsn >= lsn + len - 1)
+	if (buf_end_lsn >= lsn + len - 1)
 		return false;
 
 	return true;
@@ -280,6 +280,14 @@ struct PGPROC
 	 */
 	TransactionId procArrayGroupMemberXid;
 
+	/* POLAR: support for WAL group flush */
+	/* true, if member of WAL flush group waiting for the leader */
+	bool		polarWalFlushGroupMember;
+	/* next WAL flush group member */
+	pg_atomic_uint32 polarWalFlushGroupNext;
+	/* WAL location the member needs to be flushed */
+	XLogRecPtr	polarWalFlushGroupLsn;
+
 	/* POLAR: wait event infomation */
 	uint32		wait_event_info;	/* proc's wait information */
 	int			wait_object[PGPROC_WAIT_STACK_LEN]; /* proc's wait object
@@ -421,6 +429,8 @@ typedef struct PROC_HDR
 	pg_atomic_uint32 procArrayGroupFirst;
 	/* First pgproc waiting for group transaction status update */
 	pg_atomic_uint32 clogGroupFirst;
+	/* POLAR: first pgproc waiting for WAL group flush */
+	pg_atomic_uint32 polarWalFlushGroupFirst;
 	/* WALWriter process's latch */
 	Latch	   *walwriterLatch;
 	/* Checkpointer process's latch */
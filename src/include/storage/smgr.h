@@ -21,6 +21,8 @@
 /* POLAR */
 #include "storage/polar_rsc.h"
 
+struct polar_aio_req;
+
 typedef struct polar_rsc_shared_relation_t polar_rsc_shared_relation_t;
 
 /*
@@ -129,6 +131,10 @@ extern void polar_smgr_init_bulk_extend(SMgrRelation reln, ForkNumber forknum);
 extern void polar_smgr_clear_bulk_extend(SMgrRelation reln, ForkNumber forknum);
 extern void polar_smgrbulkread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 							   int blockCount, char *buffer);
+extern bool polar_smgrbulkread_req(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+								   int blockCount, char *buffer, struct polar_aio_req *req);
+extern void polar_smgrbulkwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+								int blockCount, char *buffer, bool skipFsync);
 
 /* POLAR end */
 
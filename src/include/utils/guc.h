@@ -354,11 +354,13 @@ extern bool polar_enable_early_launch_parallel_bgwriter;
 extern bool polar_enable_lru_log;
 extern double polar_lru_works_threshold;
 extern int	polar_parallel_flush_workers;
+extern int	polar_flush_list_partitions;
 extern int	polar_parallel_bgwriter_check_interval;
 extern int	polar_new_bgwriter_flush_factor;
 extern int	polar_parallel_new_bgwriter_threshold_lag;
 extern int	polar_parallel_new_bgwriter_threshold_time;
 extern int	polar_bgwriter_flush_batch_size;
+extern int	polar_bgwriter_write_combine_size;
 extern int	polar_bgwriter_batch_size;
 extern int	polar_lru_bgwriter_max_pages;
 extern int	polar_lru_batch_pages;
@@ -367,6 +369,7 @@ extern int	polar_bgwriter_sleep_lsn_lag;
 extern int	polar_bgwriter_sleep_lru_lap;
 
 extern int	polar_copy_buffers;
+extern int	polar_copy_buffers_max;
 extern int	polar_buffer_copy_min_modified_count;
 extern int	polar_buffer_copy_threshold_lag;
 
@@ -594,6 +597,7 @@ extern void assign_search_path(const char *newval, void *extra);
 
 /* in access/transam/xlog.c */
 extern bool check_wal_buffers(int *newval, void **extra, GucSource source);
+extern bool check_polar_xlog_insert_locks(int *newval, void **extra, GucSource source);
 extern void assign_xlog_sync_method(int new_sync_method, void *extra);
 
 /* in access/transam/xlogprefetcher.c */
@@ -620,6 +624,7 @@ extern int	polar_min_bulk_extend_table_size;
 extern bool polar_enable_primary_recovery_bulk_extend;
 extern int	polar_bulk_extend_size;
 extern int	polar_bulk_read_size;
+extern int	polar_bulk_read_ahead_windows;
 
 extern int	polar_index_bulk_extend_size;
 
@@ -51,7 +51,8 @@ typedef enum
 	WAIT_EVENT_LOGINDEX_BG_MAIN,
 	WAIT_EVENT_POLAR_SUB_TASK_MAIN,
 	WAIT_EVENT_LOGINDEX_SAVER_MAIN,
-	WAIT_EVENT_ASYNC_LOCK_REPLAY_MAIN
+	WAIT_EVENT_ASYNC_LOCK_REPLAY_MAIN,
+	WAIT_EVENT_LOGINDEX_DECODE_MAIN
 	/* POLAR end */
 } WaitEventActivity;
 
@@ -134,7 +135,10 @@ typedef enum
 	WAIT_EVENT_SYNC_REP,
 	WAIT_EVENT_WAL_RECEIVER_EXIT,
 	WAIT_EVENT_WAL_RECEIVER_WAIT_START,
-	WAIT_EVENT_XACT_GROUP_UPDATE
+	WAIT_EVENT_XACT_GROUP_UPDATE,
+	/* POLAR */
+	WAIT_EVENT_POLAR_WAL_GROUP_FLUSH
+	/* POLAR end */
 } WaitEventIPC;
 
 /* ----------
@@ -251,6 +255,7 @@ typedef enum
 	WAIT_EVENT_LOGINDEX_QUEUE_SPACE,
 	WAIT_EVENT_FULLPAGE_FILE_INIT_WRITE,
 	WAIT_EVENT_LOGINDEX_WAIT_FULLPAGE,
+	WAIT_EVENT_LOGINDEX_WAIT_LOAD,
 	WAIT_EVENT_REL_SIZE_CACHE_WRITE,
 	WAIT_EVENT_REL_SIZE_CACHE_READ,
 	/* POLAR: Wait Events - local cache */
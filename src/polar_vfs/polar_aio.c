@@ -0,0 +1,646 @@
+/*-------------------------------------------------------------------------
+ *
+ * polar_aio.c
+ *	  Asynchronous I/O engines of polar vfs.
+ *
+ * vfs_aio_submit/vfs_aio_wait of the local file system use io_uring, so
+ * that a batch of reads or writes is handed to the kernel by one system
+ * call and keeps the device queue deep. Storage without asynchronous
+ * interface, such as pfsd, and kernels without io_uring use a small pool of
+ * threads doing the synchronous I/O of req->mgr instead.
+ *
+ * Both engines are private to a process, and are set up again in a forked
+ * child. Requests may complete in any order.
+ *
+ * The kernel and the threads keep writing to the requests and their buffers
+ * until they are done, even if the submitter has thrown an ERROR. So a
+ * backend waits for all of its requests when a resource owner is released
+ * on abort and before it detaches from shared memory at exit; the requests
+ * and buffers must stay allocated until then, not on the stack.
+ *
+ * Copyright (c) 2024, Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * IDENTIFICATION
+ *	  src/polar_vfs/polar_aio.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "polar_vfs/polar_aio.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+#ifndef FRONTEND
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "utils/resowner.h"
+#endif
+
+#ifdef POLAR_AIO_USE_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+int			polar_aio_threads = POLAR_AIO_DEFAULT_THREADS;
+bool		polar_aio_use_uring = true;
+
+typedef struct polar_aio_pool_t
+{
+	pid_t		pid;			/* process owning the threads */
+	int			nthreads;
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cv;		/* signaled when requests are queued */
+	pthread_cond_t done_cv;		/* signaled when requests are done */
+	polar_aio_req *head;
+	polar_aio_req *tail;
+	int			inflight;
+} polar_aio_pool_t;
+
+static polar_aio_pool_t aio_pool =
+{
+	.pid = 0,
+	.nthreads = 0,
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.work_cv = PTHREAD_COND_INITIALIZER,
+	.done_cv = PTHREAD_COND_INITIALIZER,
+};
+
+#ifndef FRONTEND
+static pid_t aio_cleanup_pid = 0;
+
+static void
+polar_aio_release_callback(ResourceReleasePhase phase, bool isCommit,
+						   bool isTopLevel, void *arg)
+{
+	/* Buffers and locks of the aborted requests are released after this */
+	if (phase == RESOURCE_RELEASE_BEFORE_LOCKS && !isCommit)
+		polar_aio_drain();
+}
+
+static void
+polar_aio_exit_callback(int code, Datum arg)
+{
+	polar_aio_drain();
+}
+#endif
+
+/*
+ * Wait for the requests in flight on ERROR and exit, once for each process
+ * using an engine.
+ */
+static void
+polar_aio_register_cleanup(void)
+{
+#ifndef FRONTEND
+	if (aio_cleanup_pid == getpid())
+		return;
+
+	aio_cleanup_pid = getpid();
+	RegisterResourceReleaseCallback(polar_aio_release_callback, NULL);
+	before_shmem_exit(polar_aio_exit_callback, 0);
+#endif
+}
+
+/*
+ * Bump the write generation of a file again when its write is done, see
+ * polar_directio_aio_submit.
+ */
+static inline void
+polar_aio_write_done(polar_aio_req *req)
+{
+#ifndef FRONTEND
+	if (req->write_gen != NULL)
+		pg_atomic_fetch_add_u64((pg_atomic_uint64 *) req->write_gen, 1);
+#endif
+}
+
+static void *
+polar_aio_pool_worker(void *arg)
+{
+	polar_aio_pool_t *pool = (polar_aio_pool_t *) arg;
+
+	for (;;)
+	{
+		polar_aio_req *req;
+		ssize_t		result;
+		int			error;
+
+		pthread_mutex_lock(&pool->mutex);
+		while (pool->head == NULL)
+			pthread_cond_wait(&pool->work_cv, &pool->mutex);
+		req = pool->head;
+		pool->head = req->next;
+		if (pool->head == NULL)
+			pool->tail = NULL;
+		pthread_mutex_unlock(&pool->mutex);
+
+		if (req->op == POLAR_AIO_READ)
+			result = req->mgr->vfs_pread(req->real_fd, req->buf, req->len, req->offset);
+		else
+			result = req->mgr->vfs_pwrite(req->real_fd, req->buf, req->len, req->offset);
+		error = result < 0 ? errno : 0;
+		polar_aio_write_done(req);
+
+		/* The submitter reads the results under the mutex */
+		pthread_mutex_lock(&pool->mutex);
+		req->result = result;
+		req->error = error;
+		req->done = true;
+		pool->inflight--;
+		pthread_cond_broadcast(&pool->done_cv);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	return NULL;
+}
+
+/*
+ * Start the threads for this process. The threads block all signals, so
+ * that signal handlers keep running in the main thread only.
+ */
+static void
+polar_aio_pool_start(polar_aio_pool_t *pool)
+{
+	sigset_t	all;
+	sigset_t	old;
+	int			i;
+
+	if (pool->pid == getpid())
+		return;
+
+	polar_aio_register_cleanup();
+
+	/* Forget the threads and requests of the parent */
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->work_cv, NULL);
+	pthread_cond_init(&pool->done_cv, NULL);
+	pool->head = pool->tail = NULL;
+	pool->inflight = 0;
+	pool->nthreads = 0;
+	pool->pid = getpid();
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+
+	for (i = 0; i < Min(Max(polar_aio_threads, 1), POLAR_AIO_MAX_THREADS); i++)
+	{
+		pthread_t	thread;
+
+		if (pthread_create(&thread, NULL, polar_aio_pool_worker, pool) != 0)
+			break;
+		pthread_detach(thread);
+		pool->nthreads++;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+int
+polar_aio_pool_submit(polar_aio_req *reqs, int nreqs)
+{
+	polar_aio_pool_t *pool = &aio_pool;
+	int			i;
+
+	polar_aio_pool_start(pool);
+
+	/* No thread at all, do them here */
+	if (pool->nthreads == 0)
+	{
+		for (i = 0; i < nreqs; i++)
+			polar_aio_do_sync(reqs[i].mgr, &reqs[i]);
+		return nreqs;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	for (i = 0; i < nreqs; i++)
+	{
+		reqs[i].next = NULL;
+		if (pool->tail)
+			pool->tail->next = &reqs[i];
+		else
+			pool->head = &reqs[i];
+		pool->tail = &reqs[i];
+	}
+	pool->inflight += nreqs;
+	pthread_cond_broadcast(&pool->work_cv);
+	pthread_mutex_unlock(&pool->mutex);
+
+	return nreqs;
+}
+
+int
+polar_aio_pool_wait(polar_aio_req *reqs, int nreqs, int min_done)
+{
+	polar_aio_pool_t *pool = &aio_pool;
+	int			ndone;
+
+	if (pool->pid != getpid())
+		return polar_aio_count_done(reqs, nreqs);
+
+	pthread_mutex_lock(&pool->mutex);
+	for (;;)
+	{
+		ndone = polar_aio_count_done(reqs, nreqs);
+		if (ndone >= min_done || pool->inflight == 0)
+			break;
+		pthread_cond_wait(&pool->done_cv, &pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	return ndone;
+}
+
+#ifdef POLAR_AIO_USE_URING
+
+typedef struct polar_aio_uring_t
+{
+	pid_t		pid;			/* process owning the ring */
+	int			fd;				/* -1 if io_uring is unavailable */
+	void	   *sq_ptr;
+	size_t		sq_size;
+	void	   *cq_ptr;
+	size_t		cq_size;
+	struct io_uring_sqe *sqes;
+	size_t		sqes_size;
+	unsigned   *sq_head;
+	unsigned   *sq_tail;
+	unsigned   *sq_mask;
+	unsigned   *sq_array;
+	unsigned	sq_entries;
+	unsigned   *cq_head;
+	unsigned   *cq_tail;
+	unsigned   *cq_mask;
+	struct io_uring_cqe *cqes;
+	unsigned	to_submit;		/* sqes not handed to the kernel yet */
+	int			inflight;		/* sqes without cqe */
+} polar_aio_uring_t;
+
+static polar_aio_uring_t aio_uring =
+{
+	.pid = 0,
+	.fd = -1,
+};
+
+static void
+polar_aio_uring_release(polar_aio_uring_t *ring)
+{
+	if (ring->fd < 0)
+		return;
+
+	if (ring->cq_ptr != ring->sq_ptr)
+		munmap(ring->cq_ptr, ring->cq_size);
+	munmap(ring->sq_ptr, ring->sq_size);
+	munmap(ring->sqes, ring->sqes_size);
+	close(ring->fd);
+	ring->fd = -1;
+}
+
+/*
+ * Set up the ring for this process, return false if io_uring can't be used.
+ */
+static bool
+polar_aio_uring_start(polar_aio_uring_t *ring)
+{
+	struct io_uring_params p;
+	int			fd;
+
+	if (ring->pid == getpid())
+		return ring->fd >= 0;
+
+	/* The ring of the parent is not ours */
+	polar_aio_uring_release(ring);
+	ring->pid = getpid();
+	ring->to_submit = 0;
+	ring->inflight = 0;
+
+	if (!polar_aio_use_uring)
+		return false;
+
+	polar_aio_register_cleanup();
+
+	MemSet(&p, 0, sizeof(p));
+	fd = syscall(__NR_io_uring_setup, POLAR_AIO_URING_DEPTH, &p);
+	if (fd < 0)
+		return false;
+
+	ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		ring->sq_size = ring->cq_size = Max(ring->sq_size, ring->cq_size);
+	ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+						MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ptr == MAP_FAILED)
+	{
+		close(fd);
+		return false;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cq_ptr = ring->sq_ptr;
+	else
+	{
+		ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+							MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (ring->cq_ptr == MAP_FAILED)
+		{
+			munmap(ring->sq_ptr, ring->sq_size);
+			close(fd);
+			return false;
+		}
+	}
+
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+					  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+	{
+		if (ring->cq_ptr != ring->sq_ptr)
+			munmap(ring->cq_ptr, ring->cq_size);
+		munmap(ring->sq_ptr, ring->sq_size);
+		close(fd);
+		return false;
+	}
+
+	ring->sq_head = (unsigned *) ((char *) ring->sq_ptr + p.sq_off.head);
+	ring->sq_tail = (unsigned *) ((char *) ring->sq_ptr + p.sq_off.tail);
+	ring->sq_mask = (unsigned *) ((char *) ring->sq_ptr + p.sq_off.ring_mask);
+	ring->sq_array = (unsigned *) ((char *) ring->sq_ptr + p.sq_off.array);
+	ring->sq_entries = p.sq_entries;
+	ring->cq_head = (unsigned *) ((char *) ring->cq_ptr + p.cq_off.head);
+	ring->cq_tail = (unsigned *) ((char *) ring->cq_ptr + p.cq_off.tail);
+	ring->cq_mask = (unsigned *) ((char *) ring->cq_ptr + p.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *) ((char *) ring->cq_ptr + p.cq_off.cqes);
+	ring->fd = fd;
+
+	return true;
+}
+
+/* Move the cqes to their requests, return the number of cqes moved */
+static int
+polar_aio_uring_reap(polar_aio_uring_t *ring)
+{
+	unsigned	head = *ring->cq_head;
+	unsigned	tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	int			nreaped = 0;
+
+	while (head != tail)
+	{
+		struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+		polar_aio_req *req = (polar_aio_req *) (uintptr_t) cqe->user_data;
+
+		req->result = cqe->res >= 0 ? cqe->res : -1;
+		req->error = cqe->res >= 0 ? 0 : -cqe->res;
+		polar_aio_write_done(req);
+		req->done = true;
+		ring->inflight--;
+		nreaped++;
+		head++;
+	}
+
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+	return nreaped;
+}
+
+/*
+ * The kernel refused new sqes because the completion queue is full or it is
+ * short of resources. Reap what has completed; if nothing has, block until
+ * one sqe the kernel already owns completes, so that the retry doesn't spin.
+ */
+static void
+polar_aio_uring_make_room(polar_aio_uring_t *ring)
+{
+	int			rc;
+
+	if (polar_aio_uring_reap(ring) > 0)
+		return;
+
+	/* Nothing owned by the kernel, back off before retrying */
+	if (ring->inflight <= (int) ring->to_submit)
+	{
+		pg_usleep(1000L);
+		return;
+	}
+
+	do
+	{
+		rc = syscall(__NR_io_uring_enter, ring->fd, 0, 1,
+					 IORING_ENTER_GETEVENTS, NULL, 0);
+	} while (rc < 0 && errno == EINTR);
+
+	polar_aio_uring_reap(ring);
+}
+
+/*
+ * Hand the queued sqes to the kernel, and wait for min_complete cqes.
+ */
+static int
+polar_aio_uring_enter(polar_aio_uring_t *ring, unsigned min_complete)
+{
+	int			rc;
+
+	for (;;)
+	{
+		rc = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, min_complete,
+					 min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if (rc >= 0)
+		{
+			ring->to_submit -= rc;
+			if (ring->to_submit == 0 || min_complete > 0)
+				return 0;
+			continue;
+		}
+
+		if (errno == EINTR)
+			continue;
+
+		/* Completion queue is full, make room and retry */
+		if (errno == EAGAIN || errno == EBUSY)
+		{
+			polar_aio_uring_make_room(ring);
+			if (min_complete > 0)
+				return 0;
+			continue;
+		}
+
+		return -1;
+	}
+}
+
+int
+polar_aio_uring_submit(polar_aio_req *reqs, int nreqs)
+{
+	polar_aio_uring_t *ring = &aio_uring;
+	unsigned	tail;
+	int			i;
+
+	if (!polar_aio_uring_start(ring))
+		return polar_aio_pool_submit(reqs, nreqs);
+
+	tail = *ring->sq_tail;
+
+	for (i = 0; i < nreqs; i++)
+	{
+		polar_aio_req *req = &reqs[i];
+		struct io_uring_sqe *sqe;
+		unsigned	index;
+
+		/* Keep no more requests in flight than the ring holds */
+		if (ring->inflight >= (int) ring->sq_entries)
+		{
+			__atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+			if (polar_aio_uring_enter(ring, 1) < 0)
+				return i > 0 ? i : -1;
+			polar_aio_uring_reap(ring);
+		}
+
+		index = tail & *ring->sq_mask;
+		sqe = &ring->sqes[index];
+		MemSet(sqe, 0, sizeof(*sqe));
+
+		req->iov.iov_base = req->buf;
+		req->iov.iov_len = req->len;
+		sqe->opcode = req->op == POLAR_AIO_READ ? IORING_OP_READV : IORING_OP_WRITEV;
+		sqe->fd = req->real_fd;
+		sqe->addr = (uint64) (uintptr_t) &req->iov;
+		sqe->len = 1;
+		sqe->off = req->offset;
+		sqe->user_data = (uint64) (uintptr_t) req;
+
+		ring->sq_array[index] = index;
+		tail++;
+		ring->to_submit++;
+		ring->inflight++;
+	}
+
+	__atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+	/* The sqes left are handed to the kernel by the next enter */
+	if (polar_aio_uring_enter(ring, 0) < 0)
+		return -1;
+
+	return nreqs;
+}
+
+int
+polar_aio_uring_wait(polar_aio_req *reqs, int nreqs, int min_done)
+{
+	polar_aio_uring_t *ring = &aio_uring;
+	int			ndone;
+
+	if (ring->pid != getpid() || ring->fd < 0)
+		return polar_aio_pool_wait(reqs, nreqs, min_done);
+
+	for (;;)
+	{
+		polar_aio_uring_reap(ring);
+		ndone = polar_aio_count_done(reqs, nreqs);
+		if (ndone >= min_done || ring->inflight == 0)
+			break;
+		if (polar_aio_uring_enter(ring, 1) < 0)
+			break;
+	}
+
+	return ndone;
+}
+
+static int
+polar_aio_uring_inflight(void)
+{
+	polar_aio_uring_t *ring = &aio_uring;
+
+	if (ring->pid != getpid() || ring->fd < 0)
+		return 0;
+
+	return ring->inflight;
+}
+
+static void
+polar_aio_uring_drain(void)
+{
+	polar_aio_uring_t *ring = &aio_uring;
+
+	if (ring->pid != getpid() || ring->fd < 0)
+		return;
+
+	while (ring->inflight > 0)
+	{
+		if (polar_aio_uring_enter(ring, 1) < 0)
+			break;
+		polar_aio_uring_reap(ring);
+	}
+}
+
+#else							/* !POLAR_AIO_USE_URING */
+
+int
+polar_aio_uring_submit(polar_aio_req *reqs, int nreqs)
+{
+	return polar_aio_pool_submit(reqs, nreqs);
+}
+
+int
+polar_aio_uring_wait(polar_aio_req *reqs, int nreqs, int min_done)
+{
+	return polar_aio_pool_wait(reqs, nreqs, min_done);
+}
+
+#define polar_aio_uring_inflight()	0
+#define polar_aio_uring_drain()		((void) 0)
+
+#endif							/* POLAR_AIO_USE_URING */
+
+/*
+ * Number of requests this process has submitted and not seen done.
+ */
+int
+polar_aio_inflight(void)
+{
+	polar_aio_pool_t *pool = &aio_pool;
+	int			inflight = 0;
+
+	if (pool->pid == getpid())
+	{
+		pthread_mutex_lock(&pool->mutex);
+		inflight = pool->inflight;
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	return inflight + polar_aio_uring_inflight();
+}
+
+/*
+ * Wait until all requests of this process are done. The requests of a
+ * submitter which has gone by ERROR are marked done like the others, and
+ * nobody waits for them any more.
+ */
+void
+polar_aio_drain(void)
+{
+	polar_aio_pool_t *pool = &aio_pool;
+
+	if (pool->pid == getpid())
+	{
+		pthread_mutex_lock(&pool->mutex);
+		while (pool->inflight > 0)
+			pthread_cond_wait(&pool->done_cv, &pool->mutex);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	polar_aio_uring_drain();
+}
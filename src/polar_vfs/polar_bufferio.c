@@ -23,6 +23,7 @@
  */
 #include <sys/mman.h>
 
+#include "polar_vfs/polar_aio.h"
 #include "polar_vfs/polar_bufferio.h"
 #include "port/pg_iovec.h"
 /*
@@ -68,4 +69,11 @@ const vfs_mgr polar_vfs_bio =
 	.vfs_mgr_func = NULL,
 	.vfs_chmod = chmod,
 	.vfs_mmap = mmap,
+#if defined(USE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+	.vfs_posix_fadvise = posix_fadvise,
+#else
+	.vfs_posix_fadvise = NULL,
+#endif
+	.vfs_aio_submit = polar_aio_uring_submit,
+	.vfs_aio_wait = polar_aio_uring_wait,
 };
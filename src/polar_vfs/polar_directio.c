@@ -23,13 +23,206 @@
  */
 #include <sys/mman.h>
 
+#include "polar_vfs/polar_aio.h"
 #include "polar_vfs/polar_directio.h"
 #include "port/pg_iovec.h"
+#ifndef FRONTEND
+#include "common/hashfn.h"
+#include "port/atomics.h"
+#include "storage/shmem.h"
+#endif
 
 int			polar_max_direct_io_size = POLAR_DIRECTIO_DEFAULT_IOSIZE;
 char	   *polar_directio_buffer = NULL;
+bool		polar_directio_tail_cache = true;
+uint64		polar_directio_rmw_reads = 0;
+uint64		polar_directio_rmw_reads_avoided = 0;
 extern bool polar_vfs_debug;
 
+/*
+ * Write generations shared by all processes. A file uses the slot of its
+ * device and inode, files sharing a slot only drop the cached blocks of each
+ * other more often.
+ *
+ * Every write of a file through direct io bumps the slot once before it
+ * starts and once after it's done, including the asynchronous ones. So a
+ * writer sees that nobody else wrote the file during its own write when its
+ * two bumps are adjacent, and the slot doesn't move until the next write of
+ * the file by anyone. Writes that don't go through polar_vfs of this server
+ * are not seen, they aren't seen by shared buffers either.
+ *
+ * There are no shared generations in frontend, nothing is cached there.
+ */
+#ifndef FRONTEND
+typedef pg_atomic_uint64 polar_directio_write_gen_t;
+
+static polar_directio_write_gen_t *polar_directio_write_gens = NULL;
+#else
+typedef void polar_directio_write_gen_t;
+#endif
+
+/*
+ * Cache of the last aligned block written by read-modify-write, one entry
+ * for each fd slot. Sequential appends smaller than one block keep writing
+ * the same tail block, the cached copy saves the pread of it.
+ *
+ * The entry is only used while the write generation of the file is still
+ * the one after our write, so any write of the file from another fd or
+ * another process drops it. It is dropped on close and truncate as well.
+ */
+typedef struct polar_directio_tail_block_t
+{
+	int			fd;
+	bool		valid;
+	off_t		off;
+	dev_t		st_dev;			/* the file the fd was opened on */
+	ino_t		st_ino;
+	polar_directio_write_gen_t *write_gen;
+	uint64		gen;			/* write_gen after our write */
+	char		block[POLAR_DIRECTIO_ALIGN_LEN];
+} polar_directio_tail_block_t;
+
+static polar_directio_tail_block_t polar_directio_tail_blocks[POLAR_DIRECTIO_TAIL_CACHE_SIZE];
+
+#define POLAR_DIRECTIO_TAIL_BLOCK(fd) \
+	(&polar_directio_tail_blocks[(fd) % POLAR_DIRECTIO_TAIL_CACHE_SIZE])
+
+#ifndef FRONTEND
+Size
+polar_directio_shmem_size(void)
+{
+	return mul_size(POLAR_DIRECTIO_WRITE_GEN_SLOTS, sizeof(pg_atomic_uint64));
+}
+
+void
+polar_directio_shmem_init(void)
+{
+	bool		found;
+	int			i;
+
+	polar_directio_write_gens = (pg_atomic_uint64 *)
+		ShmemInitStruct("polar_vfs directio write generations",
+						polar_directio_shmem_size(), &found);
+
+	if (!found)
+	{
+		for (i = 0; i < POLAR_DIRECTIO_WRITE_GEN_SLOTS; i++)
+			pg_atomic_init_u64(&polar_directio_write_gens[i], 0);
+	}
+}
+#endif
+
+/* Return the write generation of the file, NULL if there is none */
+static polar_directio_write_gen_t *
+polar_directio_lookup_write_gen(const struct stat *stat_buf)
+{
+#ifndef FRONTEND
+	struct
+	{
+		dev_t		st_dev;
+		ino_t		st_ino;
+	}			key;
+
+	if (polar_directio_write_gens == NULL)
+		return NULL;
+
+	MemSet(&key, 0, sizeof(key));
+	key.st_dev = stat_buf->st_dev;
+	key.st_ino = stat_buf->st_ino;
+
+	return &polar_directio_write_gens[hash_bytes((const unsigned char *) &key, sizeof(key)) %
+									  POLAR_DIRECTIO_WRITE_GEN_SLOTS];
+#else
+	return NULL;
+#endif
+}
+
+static polar_directio_write_gen_t *
+polar_directio_fd_write_gen(int fd)
+{
+	struct stat stat_buf;
+
+	if (fstat(fd, &stat_buf) < 0)
+		return NULL;
+
+	return polar_directio_lookup_write_gen(&stat_buf);
+}
+
+/* Bump the write generation before a write, return its value before */
+static inline uint64
+polar_directio_begin_write(polar_directio_write_gen_t *write_gen)
+{
+#ifndef FRONTEND
+	if (write_gen != NULL)
+		return pg_atomic_fetch_add_u64(write_gen, 1);
+#endif
+	return 0;
+}
+
+/*
+ * Bump the write generation after a write began with begin. Return true and
+ * set *gen to the new value if nobody else wrote the file in between.
+ */
+static inline bool
+polar_directio_end_write(polar_directio_write_gen_t *write_gen, uint64 begin,
+						 uint64 *gen)
+{
+#ifndef FRONTEND
+	uint64		end;
+
+	if (write_gen != NULL)
+	{
+		end = pg_atomic_fetch_add_u64(write_gen, 1);
+		*gen = end + 1;
+		return end == begin + 1;
+	}
+#endif
+	return false;
+}
+
+/* Drop the cached block of fd */
+void
+polar_directio_forget_tail_block(int fd)
+{
+	polar_directio_tail_block_t *tb;
+
+	if (fd < 0)
+		return;
+
+	tb = POLAR_DIRECTIO_TAIL_BLOCK(fd);
+	if (tb->fd == fd)
+		tb->valid = false;
+}
+
+/*
+ * Return the cached block of fd if it's the file in stat_buf and nobody
+ * wrote the file since our last write, begin is the write generation of the
+ * file before this write.
+ */
+static polar_directio_tail_block_t *
+polar_directio_lookup_tail_block(int fd, const struct stat *stat_buf,
+								 polar_directio_write_gen_t *write_gen,
+								 uint64 begin)
+{
+	polar_directio_tail_block_t *tb = POLAR_DIRECTIO_TAIL_BLOCK(fd);
+
+	if (!tb->valid || tb->fd != fd)
+		return NULL;
+
+	if (tb->st_dev != stat_buf->st_dev ||
+		tb->st_ino != stat_buf->st_ino ||
+		tb->write_gen != write_gen ||
+		tb->gen != begin)
+	{
+		tb->valid = false;
+		return NULL;
+	}
+
+	return tb;
+}
+
+static int	polar_directio_aio_submit(polar_aio_req *reqs, int nreqs);
+
 static inline int
 polar_directio_fsync(int fd)
 {
@@ -58,7 +251,7 @@ const vfs_mgr polar_vfs_dio =
 	.vfs_umount = NULL,
 	.vfs_open = (vfs_open_type) polar_directio_open,
 	.vfs_creat = creat,
-	.vfs_close = close,
+	.vfs_close = polar_directio_close,
 	.vfs_read = polar_directio_read,
 	.vfs_write = polar_directio_write,
 	.vfs_pread = polar_directio_pread,
@@ -74,8 +267,8 @@ const vfs_mgr polar_vfs_dio =
 	.vfs_unlink = unlink,
 	.vfs_rename = rename,
 	.vfs_fallocate = posix_fallocate,
-	.vfs_ftruncate = ftruncate,
-	.vfs_truncate = truncate,
+	.vfs_ftruncate = polar_directio_ftruncate,
+	.vfs_truncate = polar_directio_truncate,
 	.vfs_opendir = opendir,
 	.vfs_readdir = readdir,
 	.vfs_closedir = closedir,
@@ -84,6 +277,8 @@ const vfs_mgr polar_vfs_dio =
 	.vfs_mgr_func = NULL,
 	.vfs_chmod = chmod,
 	.vfs_mmap = mmap,
+	.vfs_aio_submit = polar_directio_aio_submit,
+	.vfs_aio_wait = polar_aio_uring_wait,
 };
 
 /*
@@ -116,6 +311,48 @@ polar_directio_open(const char *path, int flags, mode_t mode)
 	return open(path, flags, mode);
 }
 
+int
+polar_directio_close(int fd)
+{
+	polar_directio_forget_tail_block(fd);
+	return close(fd);
+}
+
+int
+polar_directio_ftruncate(int fd, off_t len)
+{
+	polar_directio_write_gen_t *write_gen = polar_directio_fd_write_gen(fd);
+	uint64		begin;
+	uint64		gen;
+	int			res;
+
+	polar_directio_forget_tail_block(fd);
+	begin = polar_directio_begin_write(write_gen);
+	res = ftruncate(fd, len);
+	polar_directio_end_write(write_gen, begin, &gen);
+
+	return res;
+}
+
+int
+polar_directio_truncate(const char *path, off_t len)
+{
+	polar_directio_write_gen_t *write_gen = NULL;
+	struct stat stat_buf;
+	uint64		begin;
+	uint64		gen;
+	int			res;
+
+	if (stat(path, &stat_buf) == 0)
+		write_gen = polar_directio_lookup_write_gen(&stat_buf);
+
+	begin = polar_directio_begin_write(write_gen);
+	res = truncate(path, len);
+	polar_directio_end_write(write_gen, begin, &gen);
+
+	return res;
+}
+
 ssize_t
 polar_directio_write(int fd, const void *buf, size_t len)
 {
@@ -128,7 +365,17 @@ polar_directio_write(int fd, const void *buf, size_t len)
 	if (POLAR_DIECRTIO_IS_ALIGNED(buf) &&
 		POLAR_DIECRTIO_IS_ALIGNED(len) &&
 		POLAR_DIECRTIO_IS_ALIGNED(offset))
-		return write(fd, buf, len);
+	{
+		polar_directio_write_gen_t *write_gen = polar_directio_fd_write_gen(fd);
+		uint64		begin;
+		uint64		gen;
+
+		begin = polar_directio_begin_write(write_gen);
+		res = write(fd, buf, len);
+		polar_directio_end_write(write_gen, begin, &gen);
+
+		return res;
+	}
 
 	res = polar_directio_pwrite(fd, buf, len, offset);
 
@@ -334,6 +581,12 @@ polar_directio_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
  * want that! Because some functions will use file's size in other way, such as
  * twophase transaction's function ReadTwoPhaseFile. So, we truncate file to
  * expected size in this case.
+ *
+ * With polar_directio_tail_cache, the missing content is not read when the
+ * block is beyond the end of file, or when it is the block we wrote last time
+ * through this fd and nobody wrote the file since then, which is told by the
+ * write generation of the file. So sequential appends shorter than one block
+ * don't read the tail block again and again.
  */
 ssize_t
 polar_directio_pwrite(int fd, const void *buffer, size_t len, off_t offset)
@@ -341,15 +594,38 @@ polar_directio_pwrite(int fd, const void *buffer, size_t len, off_t offset)
 #define POLAR_DIRECTIO_PWRITE_SECTION(start, len)               \
 	do                                                          \
 	{                                                           \
-		MemSet(buf, 0x0, POLAR_DIRECTIO_ALIGN_LEN);             \
-		res = pread(fd, buf, POLAR_DIRECTIO_ALIGN_LEN, off);    \
-		if (res < 0)                                            \
-			return res;                                         \
+		if (tb != NULL && tb->off == off)                       \
+		{                                                       \
+			memcpy(buf, tb->block, POLAR_DIRECTIO_ALIGN_LEN);   \
+			polar_directio_rmw_reads_avoided++;                 \
+		}                                                       \
+		else if (use_cache && off >= stat_buf.st_size)          \
+		{                                                       \
+			MemSet(buf, 0x0, POLAR_DIRECTIO_ALIGN_LEN);         \
+			polar_directio_rmw_reads_avoided++;                 \
+		}                                                       \
+		else                                                    \
+		{                                                       \
+			MemSet(buf, 0x0, POLAR_DIRECTIO_ALIGN_LEN);         \
+			res = pread(fd, buf, POLAR_DIRECTIO_ALIGN_LEN, off);\
+			if (res < 0)                                        \
+				goto fail;                                      \
+			polar_directio_rmw_reads++;                         \
+		}                                                       \
 		memcpy(buf + start, from, len);                         \
 		res = pwrite(fd, buf, POLAR_DIRECTIO_ALIGN_LEN, off);   \
 		if (res < 0)                                            \
-			return res;                                         \
+			goto fail;                                          \
 		Assert(res == POLAR_DIRECTIO_ALIGN_LEN);                \
+		if (use_cache)                                          \
+		{                                                       \
+			tb = POLAR_DIRECTIO_TAIL_BLOCK(fd);                 \
+			memcpy(tb->block, buf, POLAR_DIRECTIO_ALIGN_LEN);   \
+			tb->fd = fd;                                        \
+			tb->off = off;                                      \
+			tb->valid = false;                                  \
+			cached = true;                                      \
+		}                                                       \
 		from += len;                                            \
 		count += len;                                           \
 		nleft -= len;                                           \
@@ -367,12 +643,25 @@ polar_directio_pwrite(int fd, const void *buffer, size_t len, off_t offset)
 	off_t		nleft;
 	ssize_t		cplen;
 	bool		need_truncate = false;
+	bool		use_cache;
+	bool		cached = false;
 	struct stat stat_buf;
+	polar_directio_write_gen_t *write_gen;
+	uint64		begin;
+	uint64		gen;
+	polar_directio_tail_block_t *tb = NULL;
 
 	if (POLAR_DIECRTIO_IS_ALIGNED(buffer) &&
 		POLAR_DIECRTIO_IS_ALIGNED(len) &&
 		POLAR_DIECRTIO_IS_ALIGNED(offset))
-		return pwrite(fd, buffer, len, offset);
+	{
+		write_gen = polar_directio_fd_write_gen(fd);
+		begin = polar_directio_begin_write(write_gen);
+		res = pwrite(fd, buffer, len, offset);
+		polar_directio_end_write(write_gen, begin, &gen);
+
+		return res;
+	}
 
 	from = (char *) buffer;
 	head_start = POLAR_DIRECTIO_ALIGN_DOWN(offset);
@@ -387,16 +676,27 @@ polar_directio_pwrite(int fd, const void *buffer, size_t len, off_t offset)
 
 	/*
 	 * Whether we should truncate file to expected size or not. stat_buf
-	 * constains the original file's states including size.
+	 * constains the original file's states including size, and tells the
+	 * write generation of the file.
 	 */
-	if (!POLAR_DIECRTIO_IS_ALIGNED(offset + len))
+	res = fstat(fd, &stat_buf);
+	if (res < 0)
 	{
-		res = fstat(fd, &stat_buf);
-		if (res < 0)
-			return res;
-		if (stat_buf.st_size < tail_end)
-			need_truncate = true;
+		polar_directio_forget_tail_block(fd);
+		return res;
 	}
+	if (!POLAR_DIECRTIO_IS_ALIGNED(offset + len) &&
+		stat_buf.st_size < tail_end)
+		need_truncate = true;
+
+	write_gen = polar_directio_lookup_write_gen(&stat_buf);
+	use_cache = polar_directio_tail_cache && write_gen != NULL;
+	begin = polar_directio_begin_write(write_gen);
+
+	if (use_cache)
+		tb = polar_directio_lookup_tail_block(fd, &stat_buf, write_gen, begin);
+	else
+		polar_directio_forget_tail_block(fd);
 
 	/* write the first section */
 	if (head_start < head_end &&
@@ -420,7 +720,7 @@ polar_directio_pwrite(int fd, const void *buffer, size_t len, off_t offset)
 			res = pwrite(fd, buf, cplen, off);
 
 			if (res < 0)
-				return res;
+				goto fail;
 
 			Assert(res == cplen);
 			from += res;
@@ -447,9 +747,30 @@ polar_directio_pwrite(int fd, const void *buffer, size_t len, off_t offset)
 	{
 		res = ftruncate(fd, Max(offset + len, stat_buf.st_size));
 		if (res < 0)
-			return res;
+			goto fail;
 	}
+
+	/* Keep the block we wrote last only if nobody else wrote the file */
+	if (polar_directio_end_write(write_gen, begin, &gen) && cached)
+	{
+		tb->st_dev = stat_buf.st_dev;
+		tb->st_ino = stat_buf.st_ino;
+		tb->write_gen = write_gen;
+		tb->gen = gen;
+		tb->valid = true;
+	}
+	else
+		polar_directio_forget_tail_block(fd);
+
 	return count;
+
+fail:
+	/* We don't know what is on the disk now */
+	polar_directio_end_write(write_gen, begin, &gen);
+	polar_directio_forget_tail_block(fd);
+	return res;
+
+#undef POLAR_DIRECTIO_PWRITE_SECTION
 }
 
 ssize_t
@@ -472,7 +793,17 @@ polar_directio_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset
 	}
 
 	if (aligned)
-		return pg_pwritev(fd, iov, iovcnt, offset);
+	{
+		polar_directio_write_gen_t *write_gen = polar_directio_fd_write_gen(fd);
+		uint64		begin;
+		uint64		gen;
+
+		begin = polar_directio_begin_write(write_gen);
+		ret = pg_pwritev(fd, iov, iovcnt, offset);
+		polar_directio_end_write(write_gen, begin, &gen);
+
+		return ret;
+	}
 
 	for (i = 0; i < iovcnt; ++i)
 	{
@@ -491,3 +822,57 @@ polar_directio_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset
 	}
 	return ret;
 }
+
+/*
+ * Aligned requests go to io_uring. The others need polar_directio_buffer,
+ * which is not shared with io_uring or threads, so they are done here.
+ *
+ * An aligned write bumps the write generation of its file here, and again
+ * by polar_aio.c when it's done.
+ */
+static int
+polar_directio_aio_submit(polar_aio_req *reqs, int nreqs)
+{
+	int			start = 0;
+	int			nstarted = 0;
+	int			rc;
+	int			i;
+
+	for (i = 0; i <= nreqs; i++)
+	{
+		polar_aio_req *req = &reqs[i];
+
+		if (i < nreqs &&
+			POLAR_DIECRTIO_IS_ALIGNED(req->buf) &&
+			POLAR_DIECRTIO_IS_ALIGNED(req->len) &&
+			POLAR_DIECRTIO_IS_ALIGNED(req->offset))
+		{
+			if (req->op == POLAR_AIO_WRITE)
+			{
+				req->write_gen = polar_directio_fd_write_gen(req->real_fd);
+				polar_directio_begin_write(req->write_gen);
+			}
+			continue;
+		}
+
+		/* Hand over the aligned ones before */
+		if (start < i)
+		{
+			rc = polar_aio_uring_submit(&reqs[start], i - start);
+			if (rc < 0)
+				return nstarted > 0 ? nstarted : -1;
+			nstarted += rc;
+			if (rc < i - start)
+				return nstarted;
+		}
+
+		if (i < nreqs)
+		{
+			polar_aio_do_sync(req->mgr, req);
+			nstarted++;
+		}
+		start = i + 1;
+	}
+
+	return nstarted;
+}
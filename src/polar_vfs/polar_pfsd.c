@@ -21,6 +21,7 @@
  *
  *-------------------------------------------------------------------------
  */
+#include "polar_vfs/polar_aio.h"
 #include "polar_vfs/polar_pfsd.h"
 #ifdef USE_PFSD
 #include "pfsd_sdk.h"
@@ -85,6 +86,8 @@ const vfs_mgr polar_vfs_pfsd =
 	.vfs_mgr_func = NULL,
 	.vfs_chmod = pfsd_chmod,
 	.vfs_mmap = NULL,
+	.vfs_aio_submit = polar_aio_pool_submit,
+	.vfs_aio_wait = polar_aio_pool_wait,
 #else
 	.vfs_env_init = NULL,
 	.vfs_env_destroy = NULL,
@@ -51,9 +51,13 @@ static bool polar_in_replica_mode_or_force_mount(bool *force_mount);
 static void polar_vfs_file_handle_node_type(const char *path, vfs_vfd *vfdp, polar_vfs_ops ops);
 static void polar_vfs_io_handle_node_type(vfs_vfd *vfdp, ssize_t ret, polar_vfs_ops ops);
 static void polar_register_vfs_fun_hooks(void);
+static void polar_vfs_shmem_request(void);
+static void polar_vfs_shmem_startup(void);
 
 static polar_vfs_file_hook_type polar_vfs_file_before_hook_prev = NULL;
 static polar_vfs_io_hook_type polar_vfs_io_before_hook_prev = NULL;
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 
 void
 _PG_init(void)
@@ -112,6 +116,41 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomBoolVariable("polar_vfs.directio_tail_cache",
+							 "cache the last written tail block of unaligned direct io",
+							 NULL,
+							 &polar_directio_tail_cache,
+							 true,
+							 PGC_SIGHUP,
+							 POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_CHANGABLE,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("polar_vfs.aio_threads",
+							"number of threads doing asynchronous io without io_uring",
+							NULL,
+							&polar_aio_threads,
+							POLAR_AIO_DEFAULT_THREADS,
+							1,
+							POLAR_AIO_MAX_THREADS,
+							PGC_POSTMASTER,
+							POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_UNCHANGABLE,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("polar_vfs.aio_use_uring",
+							 "use io_uring for asynchronous io of local file system",
+							 NULL,
+							 &polar_aio_use_uring,
+							 true,
+							 PGC_POSTMASTER,
+							 POLAR_GUC_IS_INVISIBLE | POLAR_GUC_IS_UNCHANGABLE,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable("polar_vfs.debug",
 							 "turn on debug switch or not",
 							 NULL,
@@ -130,6 +169,12 @@ _PG_init(void)
 	polar_init_vfs_function();
 	polar_vfs_init();
 	polar_register_vfs_fun_hooks();
+
+	prev_shmem_request_hook = shmem_request_hook;
+	shmem_request_hook = polar_vfs_shmem_request;
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = polar_vfs_shmem_startup;
+
 	elog(LOG, "polar_vfs init done");
 }
 
@@ -407,3 +452,21 @@ polar_register_vfs_fun_hooks(void)
 	polar_vfs_io_before_hook_prev = polar_vfs_io_before_hook;
 	polar_vfs_io_before_hook = polar_vfs_io_handle_node_type;
 }
+
+static void
+polar_vfs_shmem_request(void)
+{
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
+
+	RequestAddinShmemSpace(polar_directio_shmem_size());
+}
+
+static void
+polar_vfs_shmem_startup(void)
+{
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	polar_directio_shmem_init();
+}
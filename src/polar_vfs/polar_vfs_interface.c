@@ -95,6 +95,7 @@ static int	vfs_fsync(int file);
 static int	vfs_unlink(const char *fname);
 static int	vfs_rename(const char *oldfile, const char *newfile);
 static int	vfs_fallocate(int file, off_t offset, off_t len);
+static int	vfs_posix_fadvise(int file, off_t offset, off_t len, int advice);
 static int	vfs_ftruncate(int file, off_t len);
 static int	vfs_truncate(const char *path, off_t len);
 
@@ -104,6 +105,9 @@ static int	vfs_closedir(DIR *dir);
 static int	vfs_mkdir(const char *path, mode_t mode);
 static int	vfs_rmdir(const char *path);
 
+static int	vfs_aio_submit(polar_aio_req *reqs, int nreqs);
+static int	vfs_aio_wait(polar_aio_req *reqs, int nreqs, int min_done);
+
 static inline void vfs_free_vfd(int file);
 static inline File vfs_allocate_vfd(void);
 static inline bool vfs_allocated_dir(void);
@@ -182,6 +186,9 @@ static const vfs_mgr vfs_interface =
 	.vfs_mgr_func = vfs_get_mgr,
 	.vfs_chmod = vfs_chmod,
 	.vfs_mmap = vfs_mmap,
+	.vfs_posix_fadvise = vfs_posix_fadvise,
+	.vfs_aio_submit = vfs_aio_submit,
+	.vfs_aio_wait = vfs_aio_wait,
 };
 
 bool		localfs_mode = false;
@@ -462,6 +469,10 @@ vfs_close(int file)
 
 	if (vfdP->fd != VFD_CLOSED)
 	{
+		/* The asynchronous requests in flight may still use the fd */
+		if (polar_aio_inflight() > 0)
+			polar_aio_drain();
+
 		rc = vfs[vfdP->kind]->vfs_close(vfdP->fd);
 		save_errno = errno;
 
@@ -595,8 +606,8 @@ vfs_preadv(int file, const struct iovec *iov, int iovcnt, off_t offset)
 	res = vfs[vfdP->kind]->vfs_preadv(vfdP->fd, iov, iovcnt, offset);
 	save_errno = errno;
 
-	if (polar_vfs_io_before_hook)
-		polar_vfs_io_before_hook(vfdP, 0, VFS_PREADV);
+	if (polar_vfs_io_after_hook)
+		polar_vfs_io_after_hook(vfdP, res, VFS_PREADV);
 
 	CHECK_FD_REENTRANT_END();
 	errno = save_errno;
@@ -659,19 +670,117 @@ vfs_pwritev(int file, const struct iovec *iov, int iovcnt, off_t offset)
 
 }
 
+/*
+ * Submit a batch of requests. Each run of requests on the same kind of
+ * storage is handed to its vfs_aio_submit, or done synchronously.
+ */
+static int
+vfs_aio_submit(polar_aio_req *reqs, int nreqs)
+{
+	int			nstarted = 0;
+	int			start;
+	int			i;
+	int			j;
+	int			rc;
+
+	CHECK_FD_REENTRANT_BEGIN();
+
+	for (i = 0; i < nreqs; i++)
+	{
+		vfs_vfd    *vfdP = NULL;
+		int			file = reqs[i].fd;
+
+		POLAR_VFS_FD_MASK_RMOVE(file);
+		vfdP = vfs_find_file(file);
+		reqs[i].real_fd = vfdP->fd;
+		reqs[i].mgr = vfs[vfdP->kind];
+		reqs[i].write_gen = NULL;
+	}
+
+	for (start = 0; start < nreqs; start = i)
+	{
+		const vfs_mgr *mgr = reqs[start].mgr;
+
+		for (i = start + 1; i < nreqs && reqs[i].mgr == mgr; i++)
+			;
+
+		if (mgr->vfs_aio_submit)
+			rc = mgr->vfs_aio_submit(&reqs[start], i - start);
+		else
+		{
+			for (j = start; j < i; j++)
+				polar_aio_do_sync(mgr, &reqs[j]);
+			rc = i - start;
+		}
+
+		if (rc < 0)
+		{
+			nstarted = nstarted > 0 ? nstarted : -1;
+			break;
+		}
+
+		nstarted += rc;
+		if (rc < i - start)
+			break;
+	}
+
+	CHECK_FD_REENTRANT_END();
+	return nstarted;
+}
+
+/*
+ * Wait for the requests on every kind of storage in the batch, until
+ * min_done of them are done or none of them makes progress.
+ */
+static int
+vfs_aio_wait(polar_aio_req *reqs, int nreqs, int min_done)
+{
+	int			ndone = polar_aio_count_done(reqs, nreqs);
+	int			prev;
+	int			i;
+
+	do
+	{
+		prev = ndone;
+		for (i = 0; i < nreqs; i++)
+		{
+			if (reqs[i].done || reqs[i].mgr->vfs_aio_wait == NULL)
+				continue;
+			ndone = reqs[i].mgr->vfs_aio_wait(reqs, nreqs, min_done);
+			if (ndone >= min_done && min_done > 0)
+				break;
+		}
+	} while (ndone < min_done && ndone > prev);
+
+	return ndone;
+}
+
 static int
 vfs_stat(const char *path, struct stat *buf)
 {
 	int			rc = -1;
 	int			kind = -1;
+	int			save_errno;
 	const char *vfs_path;
+	vfs_vfd		vfdP;
 
 	if (path == NULL)
 		return -1;
 
 	vfs_path = polar_vfs_file_type_and_path(path, &kind);
+
+	vfdP.kind = kind;
+	vfdP.fd = -1;
+	if (polar_vfs_file_before_hook)
+		polar_vfs_file_before_hook(path, &vfdP, VFS_STAT);
+
 	rc = vfs[kind]->vfs_stat(vfs_path, buf);
+	save_errno = errno;
+
+	if (polar_vfs_file_after_hook)
+		polar_vfs_file_after_hook(path, &vfdP, VFS_STAT);
 
+	errno = save_errno;
 	return rc;
 }
 
@@ -680,11 +789,21 @@ vfs_fstat(int file, struct stat *buf)
 {
 	vfs_vfd    *vfdP = NULL;
 	int			rc = 0;
+	int			save_errno;
 
 	POLAR_VFS_FD_MASK_RMOVE(file);
 	vfdP = vfs_find_file(file);
+
+	if (polar_vfs_io_before_hook)
+		polar_vfs_io_before_hook(vfdP, 0, VFS_FSTAT);
+
 	rc = vfs[vfdP->kind]->vfs_fstat(vfdP->fd, buf);
+	save_errno = errno;
+
+	if (polar_vfs_io_after_hook)
+		polar_vfs_io_after_hook(vfdP, 0, VFS_FSTAT);
 
+	errno = save_errno;
 	return rc;
 }
 
@@ -693,14 +812,27 @@ vfs_lstat(const char *path, struct stat *buf)
 {
 	int			rc = -1;
 	int			kind = -1;
+	int			save_errno;
 	const char *vfs_path;
+	vfs_vfd		vfdP;
 
 	if (path == NULL)
 		return -1;
 
 	vfs_path = polar_vfs_file_type_and_path(path, &kind);
+
+	vfdP.kind = kind;
+	vfdP.fd = -1;
+	if (polar_vfs_file_before_hook)
+		polar_vfs_file_before_hook(path, &vfdP, VFS_LSTAT);
+
 	rc = vfs[kind]->vfs_lstat(vfs_path, buf);
+	save_errno = errno;
+
+	if (polar_vfs_file_after_hook)
+		polar_vfs_file_after_hook(path, &vfdP, VFS_LSTAT);
 
+	errno = save_errno;
 	return rc;
 }
 
@@ -871,11 +1003,38 @@ vfs_fallocate(int file, off_t offset, off_t len)
 	return rc;
 }
 
+/*
+ * Only a hint, file systems that do not support it simply ignore it, and the
+ * io hooks are not called since nothing is read or written here.
+ */
+static int
+vfs_posix_fadvise(int file, off_t offset, off_t len, int advice)
+{
+	vfs_vfd    *vfdP = NULL;
+	int			rc = 0;
+	int			save_errno = errno;
+
+	CHECK_FD_REENTRANT_BEGIN();
+	POLAR_VFS_FD_MASK_RMOVE(file);
+	vfdP = vfs_find_file(file);
+
+	if (vfs[vfdP->kind]->vfs_posix_fadvise)
+	{
+		rc = vfs[vfdP->kind]->vfs_posix_fadvise(vfdP->fd, offset, len, advice);
+		save_errno = errno;
+	}
+
+	CHECK_FD_REENTRANT_END();
+	errno = save_errno;
+	return rc;
+}
+
 static int
 vfs_ftruncate(int file, off_t len)
 {
 	vfs_vfd    *vfdP = NULL;
 	int			rc = 0;
+	int			save_errno;
 
 	VFS_HOLD_INTERRUPTS();
 
@@ -889,11 +1048,16 @@ vfs_ftruncate(int file, off_t len)
 		polar_vfs_io_before_hook(vfdP, 0, VFS_FTRUNCATE);
 
 	rc = vfs[vfdP->kind]->vfs_ftruncate(vfdP->fd, len);
+	save_errno = errno;
+
+	if (polar_vfs_io_after_hook)
+		polar_vfs_io_after_hook(vfdP, 0, VFS_FTRUNCATE);
 
 	CHECK_FD_REENTRANT_END();
 
 	VFS_RESUME_INTERRUPTS();
 
+	errno = save_errno;
 	return rc;
 }
 
@@ -71,7 +71,7 @@ check_two_buffers(int front, int back)
 }
 
 static void
-check_one_batch_buffer()
+check_one_batch_buffer(polar_flush_list_partition_t *part)
 {
 	int			first,
 				last,
@@ -81,20 +81,25 @@ check_one_batch_buffer()
 	BufferDesc *first_buf = NULL;
 
 	/* Do not hold this lock too long. */
-	SpinLockAcquire(&polar_flush_ctl->flushlist_lock);
-	first = polar_flush_ctl->first_flush_buffer;
-	last = polar_flush_ctl->last_flush_buffer;
+	SpinLockAcquire(&part->flushlist_lock);
+	first = part->first_flush_buffer;
+	last = part->last_flush_buffer;
 
 	/* Flushlist is empty. */
 	if (first == POLAR_FLUSHNEXT_END_OF_LIST)
 	{
 		Assert(last == POLAR_FLUSHNEXT_END_OF_LIST);
-		SpinLockRelease(&polar_flush_ctl->flushlist_lock);
+		Assert(XLogRecPtrIsInvalid(pg_atomic_read_u64(&part->head_lsn)));
+		SpinLockRelease(&part->flushlist_lock);
 		return;
 	}
 
 	Assert(check_two_buffers(first, last));
 
+	/* Head lsn is the oldest lsn of the first buffer. */
+	first_buf = GetBufferDescriptor(first);
+	Assert(pg_atomic_read_u64(&part->head_lsn) == polar_buffer_get_oldest_lsn(first_buf));
+
 	/* Check #CHECK_BUFFER_COUNT buffers in flush list. */
 	mid = first_buf->flush_next;
 	Assert(mid != POLAR_FLUSHNEXT_NOT_IN_LIST);
@@ -109,7 +114,7 @@ check_one_batch_buffer()
 		check++;
 	}
 
-	SpinLockRelease(&polar_flush_ctl->flushlist_lock);
+	SpinLockRelease(&part->flushlist_lock);
 }
 
 static void
@@ -117,27 +122,18 @@ check_consistent_lsn()
 {
 	XLogRecPtr	first_lsn;
 	XLogRecPtr	consistent_lsn;
-	int			first;
 
 	consistent_lsn = polar_get_consistent_lsn();
 
-	/* Do not hold this lock too much time. */
-	SpinLockAcquire(&polar_flush_ctl->flushlist_lock);
-	first = polar_flush_ctl->first_flush_buffer;
+	/* The smallest oldest lsn of all partitions. */
+	first_lsn = polar_flush_list_get_oldest_lsn(NULL);
 
 	/* Flushlist is empty. */
-	if (first == POLAR_FLUSHNEXT_END_OF_LIST)
-	{
-		SpinLockRelease(&polar_flush_ctl->flushlist_lock);
+	if (XLogRecPtrIsInvalid(first_lsn))
 		return;
-	}
-
-	first_lsn = polar_buffer_get_oldest_lsn(GetBufferDescriptor(first));
-	SpinLockRelease(&polar_flush_ctl->flushlist_lock);
 
-	Assert(!XLogRecPtrIsInvalid(first_lsn));
 	/* Check consistent lsn. */
-	if (!XLogRecPtrIsInvalid(consistent_lsn) && !XLogRecPtrIsInvalid(first_lsn))
+	if (!XLogRecPtrIsInvalid(consistent_lsn))
 		Assert(consistent_lsn <= first_lsn);
 }
 
@@ -145,10 +141,12 @@ static void
 check_some_buffers()
 {
 	int			batch = 0;
+	int			i;
 
 	while (batch <= CHECK_BUFFER_BATCH)
 	{
-		check_one_batch_buffer();
+		for (i = 0; i < polar_flush_ctl->num_partitions; i++)
+			check_one_batch_buffer(&polar_flush_ctl->partitions[i].part);
 		batch++;
 	}
 }
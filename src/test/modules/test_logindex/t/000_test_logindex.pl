@@ -67,5 +67,28 @@ $ret =
   $node_primary->safe_psql($regress_db, 'select test_checkpoint_ringbuf();');
 is($ret, '0', 'succ to execute test_checkpoint_ringbuf()!');
 
+$ret = $node_primary->safe_psql($regress_db, 'select test_logindex_search();');
+is($ret, '0', 'succ to execute test_logindex_search()!');
+
+# Replay the WAL of a workload which touches pages both scattered and hot
+my $start_lsn =
+  $node_primary->safe_psql($regress_db, 'select pg_current_wal_insert_lsn();');
+$node_primary->safe_psql(
+	$regress_db, q[
+	create table test_replay(id int primary key, v int);
+	insert into test_replay select i, 0 from generate_series(1, 200000) i;
+	update test_replay set v = v + 1 where id % 97 = 0;
+	update test_replay set v = v + 1 where id < 100;
+	update test_replay set v = v + 1 where id < 100;
+	checkpoint;
+]);
+my $end_lsn =
+  $node_primary->safe_psql($regress_db, 'select pg_current_wal_flush_lsn();');
+$ret = $node_primary->safe_psql($regress_db,
+	"select count(*) = 2 and count(distinct lsns) = 1 and count(distinct lookups) = 1 and min(lookups) > 0 from test_logindex_replay('$start_lsn', '$end_lsn');"
+);
+is($ret, 't',
+	'both table geometries find the same lsns in test_logindex_replay()!');
+
 $node_primary->stop;
 done_testing();
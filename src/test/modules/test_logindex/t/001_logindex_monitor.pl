@@ -62,6 +62,56 @@ $node_replica->safe_psql('postgres', "select * from test_logindex ;");
 
 $node_standby->safe_psql('postgres', "select * from test_logindex ;");
 
+# replica replays outdated buffers through the page lsn cache
+$result = $node_replica->safe_psql('postgres',
+	"select cache_size > 0, hits + misses > 0 from polar_logindex_page_lsn_cache_stat();"
+);
+is($result, qq(t|t), 'check page lsn cache');
+
+# replica loads logindex tables when it's restarted
+$result = $node_replica->safe_psql('postgres',
+	"select count(*) from polar_logindex_load_stat() where tables >= 0 and read_us + validate_us + bloom_us >= 0 and total_us >= 0;"
+);
+is($result, qq(2), 'check logindex load stat');
+
+# replica parses every replayed record into logindex
+$result = $node_replica->safe_psql('postgres',
+	"select parsed_records > 0, (decoded_lsn is null) = (decoded_records = 0), parsed_lsn is not null from polar_logindex_parse_stat();"
+);
+is($result, qq(t|t|t), 'check logindex parse stat');
+
+# timing is not collected unless polar_logindex_track_parse_timing is on
+$result = $node_replica->safe_psql('postgres',
+	"select parsed_records > 0, decode_us = 0 and parse_us = 0 from polar_logindex_parse_stat();"
+);
+is($result, qq(t|t), 'check logindex parse timing is off by default');
+
+# replica decodes records ahead in logindex decode worker, and startup
+# process only takes the ones it decodes next
+ok( $node_replica->poll_query_until(
+		'postgres',
+		"select count(*) = 1 from pg_stat_activity where backend_type = 'logindex decode worker';"
+	),
+	'check logindex decode worker');
+$result = $node_replica->safe_psql('postgres',
+	"select decoded_ahead_used <= decoded_ahead_records, decoded_ahead_used <= decoded_records, decode_ahead_us = 0 from polar_logindex_parse_stat();"
+);
+is($result, qq(t|t|t), 'check logindex decode ahead stat');
+
+# standby decodes records itself
+$result = $node_standby->safe_psql('postgres',
+	"select count(*) from pg_stat_activity where backend_type = 'logindex decode worker';"
+);
+is($result, qq(0), 'check no logindex decode worker in standby');
+
+# standby prefetches blocks ahead of parallel replay
+$node_primary->wait_for_catchup($node_standby);
+ok( $node_standby->poll_query_until(
+		'postgres',
+		"select hits + issued + skipped > 0 and prefetched_lsn is not null from polar_logindex_prefetch_stat();"
+	),
+	'check logindex prefetch stat');
+
 $node_primary->safe_psql('postgres',
 	"insert into test_logindex select generate_series(1,1000000);");
 
@@ -83,6 +133,9 @@ $result = $node_standby->safe_psql('postgres',
 );
 is($result, qq(t|t|t|t|t), 'check 1');
 
+my $generation = $node_replica->safe_psql('postgres',
+	"select generation from polar_logindex_page_lsn_cache_stat();");
+
 $node_primary->teardown_node();
 
 $node_replica->psql(
@@ -92,6 +145,12 @@ $node_replica->psql(
 	on_error_stop => 0);
 $node_replica->polar_wait_for_startup(60);
 
+# page lsn cache entries resolved before promote are not used any more
+$result = $node_replica->safe_psql('postgres',
+	"select generation > $generation from polar_logindex_page_lsn_cache_stat();"
+);
+is($result, qq(t), 'check logindex generation after promote');
+
 $node_replica->safe_psql('postgres',
 	"insert into test_logindex select generate_series(1,1000000);");
 
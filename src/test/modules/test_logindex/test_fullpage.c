@@ -72,6 +72,7 @@ test_fullpage_segment_file(polar_fullpage_ctl_t ctl)
 {
 	char		path[MAXPGPATH] = {0};
 	uint64		min_fullpage_seg_no = 0;
+	polar_fullpage_slot_t slot;
 	struct stat statbuf;
 	int			i = 0;
 
@@ -100,10 +101,20 @@ test_fullpage_segment_file(polar_fullpage_ctl_t ctl)
 	polar_remove_old_fullpage_file(ctl, path, min_fullpage_seg_no);
 	Assert(polar_lstat(path, &statbuf) != 0);
 
-	polar_update_max_fullpage_no(ctl, 500000000);
+	slot.fullpage_no = 500000000;
+	slot.offset = 0;
+	slot.length = 0;
+	slot.method = WAL_COMPRESSION_NONE;
+	polar_update_max_fullpage_no(ctl, &slot);
 
 	for (i = 0; i < 10000; i++)
 		test_write_fullpage(ctl);
+
+	/* Compressed images are read back as the same page */
+	polar_fullpage_compression = WAL_COMPRESSION_PGLZ;
+	for (i = 0; i < 10000; i++)
+		test_write_fullpage(ctl);
+	polar_fullpage_compression = WAL_COMPRESSION_NONE;
 }
 
 static void
@@ -114,7 +125,7 @@ test_write_fullpage(polar_fullpage_ctl_t ctl)
 	XLogRecPtr	start_lsn;
 	XLogRecPtr	end_lsn;
 	static XLogReaderState *state = NULL;
-	uint64		fullpage_no;
+	polar_fullpage_slot_t slot;
 	Page		page;
 
 	/* Open relation and check privileges. */
@@ -158,10 +169,10 @@ test_write_fullpage(polar_fullpage_ctl_t ctl)
 	Assert(*((PolarWalType *) XLogRecGetData(state)) == PWT_FPSI);
 
 	page = palloc0(BLCKSZ);
-	/* get fullpage_no from record */
-	memcpy(&fullpage_no, XLogRecGetData(state) + sizeof(PolarWalType), sizeof(uint64));
+	/* get fullpage slot from record */
+	polar_fullpage_get_slot(state, &slot);
 	/* read fullpage from file */
-	polar_read_fullpage(ctl, page, fullpage_no);
+	polar_read_fullpage(ctl, page, &slot);
 
 	Assert(memcmp((char *) BufferGetPage(buf), (char *) page, BLCKSZ) == 0);
 }
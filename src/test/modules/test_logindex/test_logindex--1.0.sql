@@ -30,3 +30,13 @@ AS 'MODULE_PATHNAME' LANGUAGE C;
 CREATE FUNCTION test_checkpoint_ringbuf()
 RETURNS int4 STRICT
 AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_logindex_search()
+RETURNS int4 STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_logindex_replay(start_lsn pg_lsn, end_lsn pg_lsn,
+    OUT adaptive bool, OUT lsns int8, OUT tables int8, OUT insert_ms float8,
+    OUT lookups int8, OUT lookup_ms float8)
+RETURNS SETOF record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
@@ -778,6 +778,47 @@ test_change_lsn_prefix(log_index_snapshot_t * logindex_snapshot)
 	polar_logindex_release_lsn_iterator(lsn_iter);
 }
 
+/*
+ * A meta saved by version 3 must not be loaded, and logindex is reset
+ * when the snapshot is initialized with it.
+ */
+static void
+test_load_old_version_meta(log_index_snapshot_t * logindex_snapshot)
+{
+	log_index_meta_t meta;
+	char		path[MAXPGPATH];
+	int			fd;
+	bool		found;
+
+	LWLockAcquire(LOG_INDEX_IO_LOCK, LW_EXCLUSIVE);
+	found = log_index_get_meta(logindex_snapshot, &meta);
+	LWLockRelease(LOG_INDEX_IO_LOCK);
+	Assert(found);
+	Assert(meta.max_idx_table_id != LOG_INDEX_TABLE_INVALID_ID);
+
+	meta.version = 3;
+	meta.crc = 0;
+	meta.crc = log_index_calc_crc((unsigned char *) &meta, sizeof(log_index_meta_t));
+
+	snprintf(path, MAXPGPATH, "%s/%s/%s", POLAR_DATA_DIR(), logindex_snapshot->dir, LOG_INDEX_META_FILE);
+	fd = polar_open(path, O_RDWR | PG_BINARY, 0);
+	if (fd < 0)
+		elog(PANIC, "could not open file \"%s\": %m", path);
+	if (polar_pwrite(fd, &meta, sizeof(log_index_meta_t), 0) != sizeof(log_index_meta_t))
+		elog(PANIC, "could not write file \"%s\": %m", path);
+	polar_close(fd);
+
+	LWLockAcquire(LOG_INDEX_IO_LOCK, LW_EXCLUSIVE);
+	found = log_index_get_meta(logindex_snapshot, &meta);
+	LWLockRelease(LOG_INDEX_IO_LOCK);
+	Assert(!found);
+
+	pg_atomic_init_u32(&logindex_snapshot->state, 0);
+	polar_logindex_snapshot_init(logindex_snapshot, LSN_TEST_STEP, 1, false, false);
+	Assert(logindex_snapshot->meta.max_idx_table_id == LOG_INDEX_TABLE_INVALID_ID);
+	Assert(logindex_snapshot->max_idx_table_id == LOG_INDEX_TABLE_INVALID_ID);
+}
+
 static bool
 test_logindex_table_flushable(log_mem_table_t * table, void *data)
 {
@@ -863,6 +904,34 @@ test_force_flush_full_table(logindex_snapshot_t logindex_snapshot, BufferTag *ta
 	LWLockRelease(lock);
 }
 
+static void
+test_pack_table(log_idx_table_data_t * table)
+{
+	log_idx_table_packed_t *packed = palloc(sizeof(log_idx_table_data_t));
+	log_idx_table_data_t *unpacked = palloc(sizeof(log_idx_table_data_t));
+	int			compression;
+
+	for (compression = LOG_INDEX_TABLE_COMPRESSION_PACKED;
+		 compression <= LOG_INDEX_TABLE_COMPRESSION_ZSTD; compression++)
+	{
+		Size		size = log_index_pack_table(table, compression, packed);
+
+		Assert(size > 0 && size < sizeof(log_idx_table_data_t));
+		Assert(log_index_table_record_size((char *) packed, table->idx_table_id) == size);
+		Assert(log_index_table_record_size((char *) packed, table->idx_table_id + 1) == 0);
+
+		Assert(log_index_read_table_record((char *) packed, size, unpacked) == size);
+		Assert(memcmp(table, unpacked, sizeof(log_idx_table_data_t)) == 0);
+
+		/* Corrupted record must not be unpacked */
+		packed->data[0] ^= 0x01;
+		Assert(!log_index_unpack_table(packed, unpacked));
+	}
+
+	pfree(packed);
+	pfree(unpacked);
+}
+
 PG_FUNCTION_INFO_V1(test_logindex);
 /*
  * SQL-callable entry point to perform all tests.
@@ -905,6 +974,7 @@ test_logindex(PG_FUNCTION_ARGS)
 		BufferTag	tag;
 
 		test_force_flush_full_table(logindex_snapshot, &tag);
+		test_pack_table(&LOG_INDEX_MEM_TBL_ACTIVE()->data);
 
 		pg_atomic_init_u32(&logindex_snapshot->state, 0);
 		polar_logindex_snapshot_init(logindex_snapshot, LSN_TEST_STEP, 1, false, false);
@@ -922,6 +992,8 @@ test_logindex(PG_FUNCTION_ARGS)
 
 	test_change_lsn_prefix(logindex_snapshot);
 
+	test_load_old_version_meta(logindex_snapshot);
+
 	kill(bgwriter_pid, SIGTERM);
 	Assert(WaitForBackgroundWorkerShutdown(bgwriter_handle) == BGWH_STOPPED);
 
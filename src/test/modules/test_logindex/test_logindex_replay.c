@@ -0,0 +1,255 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_logindex_replay.c
+ *	  Replay a range of WAL to logindex with the default and the adaptive
+ *	  table geometry, and compare how many tables they use and how long it
+ *	  takes to look up pages.
+ *
+ * Copyright (c) 2024, Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * IDENTIFICATION
+ *	  src/test/modules/test_logindex/test_logindex_replay.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/polar_logindex.h"
+#include "access/polar_logindex_internal.h"
+#include "access/xlog.h"
+#include "access/xlogreader.h"
+#include "access/xlogutils.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "portability/instr_time.h"
+#include "storage/lwlock.h"
+#include "utils/builtins.h"
+#include "utils/pg_lsn.h"
+
+#include "test_module_init.h"
+
+#define TEST_REPLAY_SAMPLE_TAGS		1024
+#define TEST_REPLAY_SAMPLE_STEP		16
+#define TEST_REPLAY_COLUMNS			6
+
+typedef struct test_replay_result_t
+{
+	uint64		lsns;
+	uint64		tables;
+	double		insert_ms;
+	uint64		lookups;
+	double		lookup_ms;
+}			test_replay_result_t;
+
+PG_FUNCTION_INFO_V1(test_logindex_replay);
+
+static bool
+test_replay_table_flushable(struct log_mem_table_t *table, void *data)
+{
+	return true;
+}
+
+static XLogReaderState *
+test_replay_begin_read(XLogRecPtr start_lsn)
+{
+	XLogReaderState *state;
+	XLogRecPtr	first_lsn;
+
+	state = XLogReaderAllocate(wal_segment_size, NULL,
+							   XL_ROUTINE(.page_read = &read_local_xlog_page,
+										  .segment_open = wal_segment_open,
+										  .segment_close = wal_segment_close),
+							   NULL);
+
+	if (!state)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	first_lsn = XLogFindNextRecord(state, start_lsn);
+
+	if (XLogRecPtrIsInvalid(first_lsn))
+		ereport(ERROR,
+				(errmsg("could not find a valid record after %X/%X",
+						LSN_FORMAT_ARGS(start_lsn))));
+
+	XLogBeginRead(state, first_lsn);
+
+	return state;
+}
+
+/*
+ * Add the blocks of WAL in [start_lsn, end_lsn) to an empty logindex, then
+ * iterate the lsn of the sampled pages.
+ */
+static void
+test_replay_once(logindex_snapshot_t logindex_snapshot, XLogRecPtr start_lsn,
+				 XLogRecPtr end_lsn, bool adaptive, test_replay_result_t * result)
+{
+	bool		saved_adaptive = polar_logindex_adaptive_table;
+	BufferTag  *tags = palloc(sizeof(BufferTag) * TEST_REPLAY_SAMPLE_TAGS);
+	int			ntags = 0;
+	uint64		nblocks = 0;
+	char		path[MAXPGPATH];
+	XLogReaderState *state;
+	instr_time	start,
+				duration;
+	int			i;
+
+	MemSet(result, 0, sizeof(test_replay_result_t));
+
+	/* Start from an empty logindex every time */
+	POLAR_FILE_PATH(path, polar_get_logindex_snapshot_dir(logindex_snapshot));
+	rmtree(path, false);
+
+	pg_atomic_init_u32(&logindex_snapshot->state, 0);
+	polar_logindex_snapshot_init(logindex_snapshot, start_lsn, 1, false, false);
+	polar_logindex_set_start_lsn(logindex_snapshot, start_lsn);
+
+	polar_logindex_adaptive_table = adaptive;
+	state = test_replay_begin_read(start_lsn);
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	while (state->EndRecPtr < end_lsn)
+	{
+		char	   *errormsg;
+		int			block_id;
+
+		if (XLogReadRecord(state, &errormsg) == NULL)
+			break;
+
+		for (block_id = 0; block_id <= XLogRecMaxBlockId(state); block_id++)
+		{
+			BufferTag	tag;
+			RelFileNode rnode;
+			ForkNumber	forknum;
+			BlockNumber blkno;
+			bool		dup = false;
+			int			j;
+
+			if (!XLogRecGetBlockTagExtended(state, block_id, &rnode, &forknum, &blkno, NULL))
+				continue;
+
+			/* One record adds each page only once */
+			for (j = 0; j < block_id && !dup; j++)
+			{
+				RelFileNode prev_rnode;
+				ForkNumber	prev_forknum;
+				BlockNumber prev_blkno;
+
+				dup = XLogRecGetBlockTagExtended(state, j, &prev_rnode, &prev_forknum, &prev_blkno, NULL) &&
+					RelFileNodeEquals(rnode, prev_rnode) && forknum == prev_forknum && blkno == prev_blkno;
+			}
+
+			if (dup)
+				continue;
+
+			INIT_BUFFERTAG(tag, rnode, forknum, blkno);
+			polar_logindex_add_lsn(logindex_snapshot, &tag, InvalidXLogRecPtr, state->ReadRecPtr);
+			result->lsns++;
+
+			if (ntags < TEST_REPLAY_SAMPLE_TAGS && nblocks++ % TEST_REPLAY_SAMPLE_STEP == 0)
+				tags[ntags++] = tag;
+		}
+	}
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	result->insert_ms = INSTR_TIME_GET_MILLISEC(duration);
+	result->tables = logindex_snapshot->max_idx_table_id;
+
+	XLogReaderFree(state);
+	polar_logindex_adaptive_table = saved_adaptive;
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (i = 0; i < ntags; i++)
+	{
+		log_index_page_iter_t iter;
+
+		iter = polar_logindex_create_page_iterator(logindex_snapshot, &tags[i],
+												   InvalidXLogRecPtr, end_lsn, false);
+
+		while (polar_logindex_page_iterator_next(iter) != NULL)
+			result->lookups++;
+
+		polar_logindex_release_page_iterator(iter);
+	}
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	result->lookup_ms = INSTR_TIME_GET_MILLISEC(duration);
+
+	elog(LOG, "logindex replay %s geometry: " UINT64_FORMAT " lsns in " UINT64_FORMAT
+		 " tables, insert %.3f ms, lookup " UINT64_FORMAT " lsns of %d pages in %.3f ms",
+		 adaptive ? "adaptive" : "default", result->lsns, result->tables,
+		 result->insert_ms, result->lookups, ntags, result->lookup_ms);
+
+	pfree(tags);
+}
+
+/*
+ * Replay WAL in [start_lsn, end_lsn) to the test logindex snapshot with the
+ * default table geometry and the adaptive one, return one row for each.
+ */
+Datum
+test_logindex_replay(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	XLogRecPtr	start_lsn = PG_GETARG_LSN(0);
+	XLogRecPtr	end_lsn = PG_GETARG_LSN(1);
+	logindex_snapshot_t logindex_snapshot;
+	int			i;
+
+	if (XLogRecPtrIsInvalid(start_lsn) || start_lsn >= end_lsn)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid WAL range %X/%X - %X/%X",
+						LSN_FORMAT_ARGS(start_lsn), LSN_FORMAT_ARGS(end_lsn))));
+
+	if (end_lsn > GetFlushRecPtr(NULL))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("cannot replay WAL beyond the flushed lsn %X/%X",
+						LSN_FORMAT_ARGS(GetFlushRecPtr(NULL)))));
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	logindex_snapshot = polar_logindex_snapshot_shmem_init("test_logindex_snapshot", 3, 8, LWTRANCHE_WAL_LOGINDEX_BEGIN,
+														   LWTRANCHE_WAL_LOGINDEX_END, test_replay_table_flushable, NULL);
+
+	for (i = 0; i < 2; i++)
+	{
+		Datum		values[TEST_REPLAY_COLUMNS];
+		bool		nulls[TEST_REPLAY_COLUMNS];
+		test_replay_result_t result;
+
+		test_replay_once(logindex_snapshot, start_lsn, end_lsn, i == 1, &result);
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = BoolGetDatum(i == 1);
+		values[1] = Int64GetDatum((int64) result.lsns);
+		values[2] = Int64GetDatum((int64) result.tables);
+		values[3] = Float8GetDatum(result.insert_ms);
+		values[4] = Int64GetDatum((int64) result.lookups);
+		values[5] = Float8GetDatum(result.lookup_ms);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	PG_RETURN_VOID();
+}
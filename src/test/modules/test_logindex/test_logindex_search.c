@@ -0,0 +1,232 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_logindex_search.c
+ *
+ * Copyright (c) 2024, Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * IDENTIFICATION
+ *	  src/test/modules/test_logindex/test_logindex_search.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/polar_logindex.h"
+#include "access/polar_logindex_internal.h"
+#include "common/pg_prng.h"
+#include "fmgr.h"
+#include "lib/bloomfilter.h"
+#include "portability/instr_time.h"
+
+#include "test_module_init.h"
+
+#define TEST_SEARCH_TAGS		1024
+#define TEST_SEARCH_LOOPS		1000
+#define TEST_SEARCH_BLOOM_TABLES	64
+
+PG_FUNCTION_INFO_V1(test_logindex_search);
+
+static void
+test_random_tag(pg_prng_state *state, BufferTag *tag)
+{
+	/* Keep the tag fields in a small range to get partial matches */
+	tag->rnode.spcNode = 1663;
+	tag->rnode.dbNode = 5;
+	tag->rnode.relNode = 16384 + pg_prng_uint32(state) % 4;
+	tag->forkNum = pg_prng_uint32(state) % 3;
+	tag->blockNum = pg_prng_uint32(state) % 64;
+}
+
+static void
+test_tag_equal(pg_prng_state *state)
+{
+	BufferTag  *tags = palloc(sizeof(BufferTag) * TEST_SEARCH_TAGS);
+	int			i,
+				j;
+	uint64		matches = 0;
+	instr_time	start,
+				duration;
+
+	for (i = 0; i < TEST_SEARCH_TAGS; i++)
+		test_random_tag(state, &tags[i]);
+
+	for (i = 0; i < TEST_SEARCH_TAGS; i++)
+	{
+		for (j = 0; j < TEST_SEARCH_TAGS; j++)
+			Assert(log_index_tag_equal(&tags[i], &tags[j]) ==
+				   BUFFERTAGS_EQUAL(tags[i], tags[j]));
+	}
+
+	INSTR_TIME_SET_CURRENT(start);
+	for (i = 0; i < TEST_SEARCH_LOOPS; i++)
+	{
+		for (j = 0; j < TEST_SEARCH_TAGS; j++)
+			matches += log_index_tag_equal(&tags[i % TEST_SEARCH_TAGS], &tags[j]);
+	}
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	elog(LOG, "logindex tag compare: %d compares in %.3f ms, " UINT64_FORMAT " matches",
+		 TEST_SEARCH_LOOPS * TEST_SEARCH_TAGS,
+		 INSTR_TIME_GET_MILLISEC(duration), matches);
+
+	pfree(tags);
+}
+
+static int
+test_suffix_count_le_scalar(const uint32 *suffix_lsn, int n, uint32 suffix)
+{
+	int			i;
+
+	for (i = 0; i < n && suffix_lsn[i] <= suffix; i++)
+		;
+
+	return i;
+}
+
+static void
+test_suffix_count_le(pg_prng_state *state)
+{
+	uint32		suffix_lsn[LOG_INDEX_ITEM_SEG_LSN_NUM];
+	log_idx_table_data_t *table = palloc0(sizeof(log_idx_table_data_t));
+	int			n,
+				i,
+				loop;
+
+	for (loop = 0; loop < TEST_SEARCH_LOOPS; loop++)
+	{
+		uint32		lsn = pg_prng_uint32(state) % 1024;
+
+		/* Include values with the highest bit set to check unsigned compare */
+		if (loop % 2 == 0)
+			lsn |= 0x80000000;
+
+		for (i = 0; i < LOG_INDEX_ITEM_SEG_LSN_NUM; i++)
+		{
+			lsn += 1 + pg_prng_uint32(state) % 64;
+			suffix_lsn[i] = lsn;
+		}
+
+		for (n = 0; n <= LOG_INDEX_ITEM_SEG_LSN_NUM; n++)
+		{
+			for (i = 0; i < n; i++)
+			{
+				Assert(log_index_suffix_lsn_count_le(suffix_lsn, n, suffix_lsn[i]) ==
+					   test_suffix_count_le_scalar(suffix_lsn, n, suffix_lsn[i]));
+				Assert(log_index_suffix_lsn_count_le(suffix_lsn, n, suffix_lsn[i] - 1) ==
+					   test_suffix_count_le_scalar(suffix_lsn, n, suffix_lsn[i] - 1));
+			}
+
+			Assert(log_index_suffix_lsn_count_le(suffix_lsn, n, 0) ==
+				   test_suffix_count_le_scalar(suffix_lsn, n, 0));
+			Assert(log_index_suffix_lsn_count_le(suffix_lsn, n, PG_UINT32_MAX) == n);
+		}
+	}
+
+	table->prefix_lsn = 10;
+	suffix_lsn[0] = 100;
+	suffix_lsn[1] = 200;
+	Assert(log_index_table_lsn_count_le(table, suffix_lsn, 2, ((XLogRecPtr) 9 << 32) | 300) == 0);
+	Assert(log_index_table_lsn_count_le(table, suffix_lsn, 2, ((XLogRecPtr) 11 << 32)) == 2);
+	Assert(log_index_table_lsn_count_le(table, suffix_lsn, 2, ((XLogRecPtr) 10 << 32) | 150) == 1);
+
+	pfree(table);
+}
+
+static void
+test_bloom_probe(pg_prng_state *state)
+{
+	uint8	   *bloom_bytes = palloc0(LOG_INDEX_FILE_TBL_BLOOM_SIZE * TEST_SEARCH_BLOOM_TABLES);
+	bloom_filter *filters[TEST_SEARCH_BLOOM_TABLES];
+	BufferTag  *tags = palloc(sizeof(BufferTag) * TEST_SEARCH_TAGS);
+	int			i,
+				j;
+	uint64		lacks = 0;
+	instr_time	start,
+				duration;
+
+	for (i = 0; i < TEST_SEARCH_BLOOM_TABLES; i++)
+		filters[i] = polar_bloom_init_struct(bloom_bytes + i * LOG_INDEX_FILE_TBL_BLOOM_SIZE,
+											 LOG_INDEX_FILE_TBL_BLOOM_SIZE,
+											 LOG_INDEX_BLOOM_ELEMS_NUM, 0);
+
+	for (i = 0; i < TEST_SEARCH_TAGS; i++)
+	{
+		test_random_tag(state, &tags[i]);
+		bloom_add_element(filters[i % TEST_SEARCH_BLOOM_TABLES],
+						  (unsigned char *) &tags[i], sizeof(BufferTag));
+	}
+
+	for (i = 0; i < TEST_SEARCH_TAGS; i++)
+	{
+		polar_bloom_probe probe;
+
+		probe.k_hash_funcs = 0;
+
+		for (j = 0; j < TEST_SEARCH_BLOOM_TABLES; j++)
+		{
+			polar_bloom_prepare_probe(filters[j], &probe,
+									  (unsigned char *) &tags[i], sizeof(BufferTag));
+			Assert(polar_bloom_probe_lacks_element(filters[j], &probe) ==
+				   bloom_lacks_element(filters[j], (unsigned char *) &tags[i],
+									   sizeof(BufferTag)));
+		}
+
+		/* Added element must never be reported as lacking */
+		Assert(!polar_bloom_probe_lacks_element(filters[i % TEST_SEARCH_BLOOM_TABLES], &probe));
+	}
+
+	INSTR_TIME_SET_CURRENT(start);
+	for (i = 0; i < TEST_SEARCH_TAGS; i++)
+	{
+		polar_bloom_probe probe;
+
+		probe.k_hash_funcs = 0;
+
+		for (j = 0; j < TEST_SEARCH_BLOOM_TABLES; j++)
+		{
+			polar_bloom_prepare_probe(filters[j], &probe,
+									  (unsigned char *) &tags[i], sizeof(BufferTag));
+			lacks += polar_bloom_probe_lacks_element(filters[j], &probe);
+		}
+	}
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	elog(LOG, "logindex bloom probe: %d probes in %.3f ms, " UINT64_FORMAT " lacks",
+		 TEST_SEARCH_TAGS * TEST_SEARCH_BLOOM_TABLES,
+		 INSTR_TIME_GET_MILLISEC(duration), lacks);
+
+	pfree(tags);
+	pfree(bloom_bytes);
+}
+
+/*
+ * Check the vectorized search kernels against the scalar implementation,
+ * and log how long they take.
+ */
+Datum
+test_logindex_search(PG_FUNCTION_ARGS)
+{
+	pg_prng_state state;
+
+	pg_prng_seed(&state, 0x5eed);
+
+	test_tag_equal(&state);
+	test_suffix_count_le(&state);
+	test_bloom_probe(&state);
+
+	PG_RETURN_INT32(0);
+}
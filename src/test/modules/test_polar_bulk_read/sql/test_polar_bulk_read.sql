@@ -130,4 +130,16 @@ select relname,
 	   heap_bulk_read_blks_io >= 2 * heap_bulk_read_calls_io
 from polar_pg_statio_user_tables where relname = 'bulk_read_tbl';
 
+---------------------- test bulk read with read-ahead ---------------------------
+SET polar_bulk_read_ahead_windows = 4;
+--- drop buffers of bulk_read_test. 
+SELECT polar_drop_relation_buffers('bulk_read_tbl', 'main', 0);
+select count(*) from bulk_read_tbl where id % 2 = 0;
+
+--- drop buffers of bulk_read_test. 
+SELECT polar_drop_relation_buffers('bulk_read_tbl', 'main', 0);
+vacuum bulk_read_tbl;
+select count(*) from bulk_read_tbl;
+RESET polar_bulk_read_ahead_windows;
+
 DROP TABLE bulk_read_tbl;
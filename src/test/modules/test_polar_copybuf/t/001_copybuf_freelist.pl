@@ -0,0 +1,81 @@
+# 001_copybuf_freelist.pl
+#	  Test case: get and put copy buffers from several backends while the
+#	  elastic copy buffer pool grows and shrinks, then check that no copy
+#	  buffer is lost or handed out twice.
+#
+# Copyright (c) 2024, Alibaba Group Holding Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# IDENTIFICATION
+#	  src/test/modules/test_polar_copybuf/t/001_copybuf_freelist.pl
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('primary');
+$node->polar_init_primary;
+$node->append_conf(
+	'postgresql.conf', q[
+polar_copy_buffers = 16
+polar_copy_buffers_max = 64
+max_connections = 50
+]);
+$node->start;
+
+$node->safe_psql('postgres', 'CREATE EXTENSION test_polar_copybuf;');
+$node->safe_psql('postgres', 'CREATE EXTENSION polar_monitor;');
+
+is($node->safe_psql('postgres', 'select test_copy_buffer_check();'),
+	't', 'freelists are consistent at startup');
+
+my $resize_query = q[select grow, shrink from polar_cbuf_alloc();];
+my ($grow, $shrink) =
+  split(/\|/, $node->safe_psql('postgres', $resize_query));
+
+# Each client holds up to 8 buffers at a time, so the pool is often empty
+# and buffers are often out of the active part when they are put back.
+$node->pgbench(
+	'--no-vacuum --client=8 --jobs=8 --transactions=200',
+	0,
+	[qr{processed: 1600/1600}],
+	[qr{^$}],
+	'get and put copy buffers while the pool is resized',
+	{
+		'001_copybuf_alloc_free@4' =>
+		  q[select test_copy_buffer_alloc_free(20, 8);],
+		'001_copybuf_resize@1' => q[
+\set target random(16, 64)
+select test_copy_buffer_resize(:target);
+]
+	});
+
+is($node->safe_psql('postgres', 'select test_copy_buffer_check();'),
+	't', 'no copy buffer is lost or in freelists twice after resizing');
+
+my ($new_grow, $new_shrink) =
+  split(/\|/, $node->safe_psql('postgres', $resize_query));
+cmp_ok($new_grow, '>', $grow, 'copy buffer pool has grown');
+cmp_ok($new_shrink, '>', $shrink, 'copy buffer pool has shrunk');
+
+# No buffer is left parked in the active part after growing to the max
+$node->safe_psql('postgres', 'select test_copy_buffer_resize(64);');
+is($node->safe_psql('postgres', 'select test_copy_buffer_check();'),
+	't', 'freelists are consistent after growing to the max');
+
+$node->stop;
+
+done_testing();
@@ -0,0 +1,16 @@
+/* src/test/modules/test_polar_copybuf/test_polar_copybuf--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_polar_copybuf" to load this file. \quit
+
+CREATE FUNCTION test_copy_buffer_alloc_free(loops int4, hold int4)
+RETURNS int8
+AS 'MODULE_PATHNAME' LANGUAGE C STRICT;
+
+CREATE FUNCTION test_copy_buffer_resize(target int4)
+RETURNS void
+AS 'MODULE_PATHNAME' LANGUAGE C STRICT;
+
+CREATE FUNCTION test_copy_buffer_check()
+RETURNS bool
+AS 'MODULE_PATHNAME' LANGUAGE C STRICT;
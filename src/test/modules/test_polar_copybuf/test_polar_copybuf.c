@@ -0,0 +1,201 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_polar_copybuf.c
+ *	  Test code for the freelists of the elastic copy buffer pool.
+ *
+ * Copyright (c) 2024, Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * IDENTIFICATION
+ *	  src/test/modules/test_polar_copybuf/test_polar_copybuf.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "storage/polar_copybuf.h"
+
+PG_MODULE_MAGIC;
+
+/* Set in origin_buffer of a copy buffer while this process holds it */
+#define TEST_COPY_BUFFER_MARKER (0x80000000 | (uint32) MyProcPid)
+
+static void
+check_copy_buffer_enabled(void)
+{
+	if (!polar_copy_buffer_enabled())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("copy buffer pool is not enabled")));
+}
+
+/*
+ * Get up to hold copy buffers from the freelists and put them back, loops
+ * times. Every buffer got is marked by this process, so it's an error if
+ * it's got by another process before we put it back. Returns the number of
+ * buffers got.
+ */
+PG_FUNCTION_INFO_V1(test_copy_buffer_alloc_free);
+Datum
+test_copy_buffer_alloc_free(PG_FUNCTION_ARGS)
+{
+	int32		loops = PG_GETARG_INT32(0);
+	int32		hold = PG_GETARG_INT32(1);
+	CopyBufferDesc **cbufs;
+	int64		total = 0;
+	int			i;
+
+	check_copy_buffer_enabled();
+
+	if (hold <= 0)
+		elog(ERROR, "hold must be positive");
+
+	cbufs = palloc(sizeof(CopyBufferDesc *) * hold);
+
+	for (i = 0; i < loops; i++)
+	{
+		int			n;
+		int			j;
+
+		for (n = 0; n < hold; n++)
+		{
+			CopyBufferDesc *cbuf = polar_get_free_copy_buffer();
+			uint32		expected = 0;
+
+			if (cbuf == NULL)
+				break;
+
+			if (cbuf->buf_id >= polar_copy_buffers_reserved() ||
+				cbuf->free_next != FREENEXT_NOT_IN_LIST ||
+				pg_atomic_read_u32(&cbuf->parked) != 0 ||
+				cbuf->state != POLAR_COPY_BUFFER_UNUSED)
+				elog(ERROR, "copy buffer %d got from freelist is not free",
+					 cbuf->buf_id);
+
+			if (!pg_atomic_compare_exchange_u32((pg_atomic_uint32 *) &cbuf->origin_buffer,
+												&expected,
+												TEST_COPY_BUFFER_MARKER))
+				elog(ERROR, "copy buffer %d is handed out twice, it's held by %u",
+					 cbuf->buf_id, expected & ~0x80000000);
+
+			cbufs[n] = cbuf;
+		}
+
+		/* Let the others run into the buffers we hold */
+		pg_usleep(n > 0 ? 10 : 1000);
+
+		for (j = 0; j < n; j++)
+		{
+			uint32		expected = TEST_COPY_BUFFER_MARKER;
+
+			if (!pg_atomic_compare_exchange_u32((pg_atomic_uint32 *) &cbufs[j]->origin_buffer,
+												&expected, 0))
+				elog(ERROR, "copy buffer %d is handed out twice, it's held by %u",
+					 cbufs[j]->buf_id, expected & ~0x80000000);
+
+			polar_put_free_copy_buffer(cbufs[j]);
+		}
+
+		total += n;
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	pfree(cbufs);
+
+	PG_RETURN_INT64(total);
+}
+
+PG_FUNCTION_INFO_V1(test_copy_buffer_resize);
+Datum
+test_copy_buffer_resize(PG_FUNCTION_ARGS)
+{
+	int32		target = PG_GETARG_INT32(0);
+
+	check_copy_buffer_enabled();
+
+	if (target < 0)
+		elog(ERROR, "target must not be negative");
+
+	polar_resize_copy_buffer_pool((uint32) target);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Check the freelists when no copy buffer is got or put: every free buffer
+ * is in exactly one freelist unless it's parked, and no buffer in the active
+ * part of the pool is parked.
+ */
+PG_FUNCTION_INFO_V1(test_copy_buffer_check);
+Datum
+test_copy_buffer_check(PG_FUNCTION_ARGS)
+{
+	int			nbuffers = polar_copy_buffers_reserved();
+	uint32		active;
+	bool	   *listed;
+	int			i;
+
+	check_copy_buffer_enabled();
+
+	active = pg_atomic_read_u32(&polar_copy_buffer_ctl->active_buffers);
+	listed = palloc0(sizeof(bool) * nbuffers);
+
+	for (i = 0; i < polar_copy_buffer_ctl->num_partitions; i++)
+	{
+		uint64		head = pg_atomic_read_u64(&polar_copy_buffer_ctl->freelists[i].head);
+		int			buf_id = COPYBUFFER_FREELIST_HEAD_BUF_ID(head);
+
+		while (buf_id != FREENEXT_END_OF_LIST)
+		{
+			CopyBufferDesc *cbuf;
+
+			if (buf_id < 0 || buf_id >= nbuffers)
+				elog(ERROR, "invalid copy buffer %d in freelist %d", buf_id, i);
+
+			/* It also stops a cycle */
+			if (listed[buf_id])
+				elog(ERROR, "copy buffer %d is in freelists twice", buf_id);
+			listed[buf_id] = true;
+
+			cbuf = polar_get_copy_buffer_descriptor(buf_id);
+
+			if (cbuf->state != POLAR_COPY_BUFFER_UNUSED ||
+				pg_atomic_read_u32(&cbuf->parked) != 0)
+				elog(ERROR, "copy buffer %d in freelist %d is not free",
+					 buf_id, i);
+
+			buf_id = cbuf->free_next;
+		}
+	}
+
+	for (i = 0; i < nbuffers; i++)
+	{
+		CopyBufferDesc *cbuf = polar_get_copy_buffer_descriptor(i);
+		bool		parked = pg_atomic_read_u32(&cbuf->parked) != 0;
+
+		if (parked && i < active)
+			elog(ERROR, "copy buffer %d is parked in the active part of %u buffers",
+				 i, active);
+
+		if (!parked && !listed[i] && cbuf->state == POLAR_COPY_BUFFER_UNUSED)
+			elog(ERROR, "free copy buffer %d is lost", i);
+	}
+
+	pfree(listed);
+
+	PG_RETURN_BOOL(true);
+}
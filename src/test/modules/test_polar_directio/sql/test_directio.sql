@@ -3,4 +3,19 @@ CREATE EXTENSION test_directio;
 -- See README for explanation of arguments:
 SELECT test_directio();
 
+-- Append 1MB by 100 bytes, the tail block cache avoids all the reads
+SELECT tail_cache, writes, reads, reads_avoided
+  FROM test_directio_append(1024 * 1024, 100);
+
+-- The cached tail block is dropped when the file is written through another
+-- fd, truncated or closed
+SELECT * FROM test_directio_tail_cache();
+
+-- Asynchronous writes and reads through io_uring and the thread pool
+SELECT * FROM test_directio_aio(64);
+
+-- Requests in flight are waited for when the transaction is aborted
+SELECT test_directio_aio_error(64);
+SELECT test_directio_aio_inflight();
+
 DROP EXTENSION test_directio;
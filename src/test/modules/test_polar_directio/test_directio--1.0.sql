@@ -6,3 +6,27 @@
 CREATE FUNCTION test_directio()
 RETURNS pg_catalog.void STRICT
 AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_directio_append(total int4, chunk int4,
+    OUT tail_cache bool, OUT writes int8, OUT reads int8,
+    OUT reads_avoided int8, OUT elapsed_ms float8)
+RETURNS SETOF record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_directio_tail_cache(
+    OUT step text, OUT reads int8, OUT reads_avoided int8, OUT ok bool)
+RETURNS SETOF record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_directio_aio(nreqs int4,
+    OUT engine text, OUT requests int4, OUT ok bool)
+RETURNS SETOF record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_directio_aio_error(nreqs int4)
+RETURNS pg_catalog.void STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_directio_aio_inflight()
+RETURNS int4 STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
@@ -32,12 +32,16 @@
 
 #include "access/xlogdefs.h"
 #include "common/file_perm.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "polar_vfs/polar_aio.h"
 #include "polar_vfs/polar_directio.h"
 #include "port/pg_iovec.h"
+#include "portability/instr_time.h"
 #include "storage/fd.h"
 #include "storage/polar_fd.h"
+#include "utils/builtins.h"
 #include "utils/guc.h"
 
 #define TEST_DATA_DIRECTIO "directio.dat"
@@ -47,6 +51,10 @@
 #define SUBAPI_LOOP 50
 #define MAIN_LOOP 50
 #define IOVCNT 3
+#define APPEND_COLUMNS 5
+#define TAIL_CACHE_COLUMNS 4
+#define TAIL_CACHE_CHUNK 100
+#define AIO_COLUMNS 3
 
 static char directio_file[MAXPGPATH + 1];
 static char bufferio_file[MAXPGPATH + 1];
@@ -74,6 +82,11 @@ const		test_func test_func_apis[MAX_TEST_FUNC_APIS] =
 };
 
 PG_FUNCTION_INFO_V1(test_directio);
+PG_FUNCTION_INFO_V1(test_directio_append);
+PG_FUNCTION_INFO_V1(test_directio_tail_cache);
+PG_FUNCTION_INFO_V1(test_directio_aio);
+PG_FUNCTION_INFO_V1(test_directio_aio_error);
+PG_FUNCTION_INFO_V1(test_directio_aio_inflight);
 
 Datum
 test_directio(PG_FUNCTION_ARGS)
@@ -126,7 +139,7 @@ test_directio(PG_FUNCTION_ARGS)
 		test_preadv_work(directio_fd, bufferio_fd);
 		test_checksum(directio_fd, bufferio_fd);
 
-		close(directio_fd);
+		polar_directio_close(directio_fd);
 		close(bufferio_fd);
 
 		Assert(unlink(directio_file) == 0);
@@ -136,6 +149,440 @@ test_directio(PG_FUNCTION_ARGS)
 	PG_RETURN_VOID();
 }
 
+/*
+ * Append total bytes to an empty file in chunk bytes writes, then read them
+ * back and check them.
+ */
+static void
+test_append_once(bool tail_cache, int total, int chunk, Datum *values)
+{
+	bool		saved_tail_cache = polar_directio_tail_cache;
+	uint64		saved_reads = polar_directio_rmw_reads;
+	uint64		saved_reads_avoided = polar_directio_rmw_reads_avoided;
+	char	   *data = palloc(total);
+	char	   *check = palloc(total);
+	int64		writes = 0;
+	instr_time	start,
+				duration;
+	off_t		offset;
+	int			fd;
+	int			i;
+
+	for (i = 0; i < total; i++)
+		data[i] = (char) random();
+
+	unlink(directio_file);
+	fd = polar_directio_open(directio_file, O_CREAT | O_RDWR | PG_O_DIRECT, pg_file_create_mode);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file with PG_O_DIRECT \"%s\": %m", directio_file)));
+
+	polar_directio_tail_cache = tail_cache;
+	polar_directio_rmw_reads = 0;
+	polar_directio_rmw_reads_avoided = 0;
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (offset = 0; offset < total; offset += chunk)
+	{
+		int			len = Min(chunk, total - offset);
+
+		if (polar_directio_pwrite(fd, data + offset, len, offset) != len)
+		{
+			polar_directio_tail_cache = saved_tail_cache;
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write file \"%s\": %m", directio_file)));
+		}
+		writes++;
+	}
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	values[0] = BoolGetDatum(tail_cache);
+	values[1] = Int64GetDatum(writes);
+	values[2] = Int64GetDatum((int64) polar_directio_rmw_reads);
+	values[3] = Int64GetDatum((int64) polar_directio_rmw_reads_avoided);
+	values[4] = Float8GetDatum(INSTR_TIME_GET_MILLISEC(duration));
+
+	polar_directio_tail_cache = saved_tail_cache;
+	polar_directio_rmw_reads += saved_reads;
+	polar_directio_rmw_reads_avoided += saved_reads_avoided;
+
+	if (polar_directio_pread(fd, check, total, 0) != total ||
+		memcmp(data, check, total) != 0)
+		elog(ERROR, "content of appended file \"%s\" is wrong", directio_file);
+
+	polar_directio_close(fd);
+	unlink(directio_file);
+	pfree(data);
+	pfree(check);
+}
+
+/*
+ * Measure appending to a file with small writes, without and with the tail
+ * block cache.
+ */
+Datum
+test_directio_append(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	int			total = PG_GETARG_INT32(0);
+	int			chunk = PG_GETARG_INT32(1);
+	int			i;
+
+	if (total <= 0 || chunk <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("total and chunk must be positive")));
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	snprintf(directio_file, MAXPGPATH, "%s/%s", DataDir, TEST_DATA_DIRECTIO);
+
+	if (polar_directio_buffer == NULL &&
+		posix_memalign((void **) &polar_directio_buffer,
+					   POLAR_DIRECTIO_ALIGN_LEN,
+					   polar_max_direct_io_size) != 0)
+		elog(PANIC, "posix_memalign alloc polar_directio_buffer failed!");
+
+	for (i = 0; i < 2; i++)
+	{
+		Datum		values[APPEND_COLUMNS];
+		bool		nulls[APPEND_COLUMNS];
+
+		MemSet(nulls, 0, sizeof(nulls));
+		test_append_once(i == 1, total, chunk, values);
+
+		elog(LOG, "directio append %d bytes by %d bytes with tail cache %s: "
+			 INT64_FORMAT " reads, " INT64_FORMAT " reads avoided, %.3f ms",
+			 total, chunk, i == 1 ? "on" : "off", DatumGetInt64(values[2]),
+			 DatumGetInt64(values[3]), DatumGetFloat8(values[4]));
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * The content we expect in directio_file, kept in step with what the tail
+ * cache test writes and truncates.
+ */
+static char *tail_cache_image;
+static off_t tail_cache_size;
+
+/* Write the image to offset through fd, then check the file */
+static void
+tail_cache_step(ReturnSetInfo *rsinfo, const char *step, int fd, off_t offset)
+{
+	uint64		saved_reads = polar_directio_rmw_reads;
+	uint64		saved_reads_avoided = polar_directio_rmw_reads_avoided;
+	char	   *check = palloc0(TEST_DATA_MAX_LEN);
+	struct stat stat_buf;
+	Datum		values[TAIL_CACHE_COLUMNS];
+	bool		nulls[TAIL_CACHE_COLUMNS];
+	int			i;
+
+	for (i = 0; i < TAIL_CACHE_CHUNK; i++)
+		tail_cache_image[offset + i] = (char) random();
+
+	if (polar_directio_pwrite(fd, tail_cache_image + offset,
+							  TAIL_CACHE_CHUNK, offset) != TAIL_CACHE_CHUNK)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write file \"%s\": %m", directio_file)));
+
+	tail_cache_size = Max(tail_cache_size, offset + TAIL_CACHE_CHUNK);
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = CStringGetTextDatum(step);
+	values[1] = Int64GetDatum((int64) (polar_directio_rmw_reads - saved_reads));
+	values[2] = Int64GetDatum((int64) (polar_directio_rmw_reads_avoided - saved_reads_avoided));
+	values[3] = BoolGetDatum(fstat(fd, &stat_buf) == 0 &&
+							 stat_buf.st_size == tail_cache_size &&
+							 polar_directio_pread(fd, check, tail_cache_size, 0) == tail_cache_size &&
+							 memcmp(check, tail_cache_image, tail_cache_size) == 0);
+
+	tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	pfree(check);
+}
+
+/* Truncate the image the same way the file is truncated */
+static void
+tail_cache_truncate(off_t len)
+{
+	if (len < tail_cache_size)
+		MemSet(tail_cache_image + len, 0, tail_cache_size - len);
+	tail_cache_size = len;
+}
+
+static int
+tail_cache_open(void)
+{
+	int			fd = polar_directio_open(directio_file, O_CREAT | O_RDWR | PG_O_DIRECT,
+										 pg_file_create_mode);
+
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file with PG_O_DIRECT \"%s\": %m", directio_file)));
+	return fd;
+}
+
+/*
+ * Check that the cached tail block of an fd is dropped when the file is
+ * written through another fd, truncated or closed, and that the file is
+ * right after each step.
+ */
+Datum
+test_directio_tail_cache(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	bool		saved_tail_cache = polar_directio_tail_cache;
+	char	   *aligned;
+	volatile int fd1;
+	int			fd2;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	snprintf(directio_file, MAXPGPATH, "%s/%s", DataDir, TEST_DATA_DIRECTIO);
+
+	if (polar_directio_buffer == NULL &&
+		posix_memalign((void **) &polar_directio_buffer,
+					   POLAR_DIRECTIO_ALIGN_LEN,
+					   polar_max_direct_io_size) != 0)
+		elog(PANIC, "posix_memalign alloc polar_directio_buffer failed!");
+
+	tail_cache_image = palloc0(TEST_DATA_MAX_LEN);
+	tail_cache_size = 0;
+	aligned = (char *) TYPEALIGN(POLAR_DIRECTIO_ALIGN_LEN,
+								 palloc(2 * POLAR_DIRECTIO_ALIGN_LEN));
+
+	unlink(directio_file);
+	fd1 = tail_cache_open();
+	fd2 = tail_cache_open();
+
+	polar_directio_tail_cache = true;
+
+	PG_TRY();
+	{
+		tail_cache_step(rsinfo, "append", fd1, 0);
+		tail_cache_step(rsinfo, "append", fd1, 100);
+		tail_cache_step(rsinfo, "append other fd", fd2, 200);
+		tail_cache_step(rsinfo, "append after other fd", fd1, 300);
+
+		if (polar_directio_ftruncate(fd2, 250) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not truncate file \"%s\": %m", directio_file)));
+		tail_cache_truncate(250);
+		tail_cache_step(rsinfo, "append after ftruncate", fd1, 250);
+
+		if (polar_directio_truncate(directio_file, 120) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not truncate file \"%s\": %m", directio_file)));
+		tail_cache_truncate(120);
+		tail_cache_step(rsinfo, "append after truncate", fd1, 120);
+
+		memcpy(aligned, tail_cache_image, POLAR_DIRECTIO_ALIGN_LEN);
+		MemSet(aligned, 0x5a, 10);
+		if (polar_directio_pwrite(fd2, aligned, POLAR_DIRECTIO_ALIGN_LEN, 0) !=
+			POLAR_DIRECTIO_ALIGN_LEN)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write file \"%s\": %m", directio_file)));
+		memcpy(tail_cache_image, aligned, POLAR_DIRECTIO_ALIGN_LEN);
+		tail_cache_size = Max(tail_cache_size, POLAR_DIRECTIO_ALIGN_LEN);
+		tail_cache_step(rsinfo, "append after aligned write", fd1, 220);
+		tail_cache_step(rsinfo, "append", fd1, 320);
+
+		polar_directio_close(fd1);
+		fd1 = -1;
+		fd1 = tail_cache_open();
+		tail_cache_step(rsinfo, "append after reopen", fd1, 420);
+	}
+	PG_FINALLY();
+	{
+		polar_directio_tail_cache = saved_tail_cache;
+		if (fd1 >= 0)
+			polar_directio_close(fd1);
+		polar_directio_close(fd2);
+		unlink(directio_file);
+	}
+	PG_END_TRY();
+
+	PG_RETURN_VOID();
+}
+
+typedef int (*aio_submit_func) (polar_aio_req *reqs, int nreqs);
+typedef int (*aio_wait_func) (polar_aio_req *reqs, int nreqs, int min_done);
+
+static int
+test_aio_open(void)
+{
+	int			fd;
+
+	snprintf(directio_file, MAXPGPATH, "%s/%s", DataDir, TEST_DATA_DIRECTIO);
+	unlink(directio_file);
+	fd = polar_directio_open(directio_file, O_CREAT | O_RDWR | PG_O_DIRECT, pg_file_create_mode);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file with PG_O_DIRECT \"%s\": %m", directio_file)));
+
+	return fd;
+}
+
+/*
+ * Aligned requests of one block each for fd, whose buffers are palloc'd.
+ */
+static polar_aio_req *
+test_aio_prepare(int fd, int op, int nreqs)
+{
+	polar_aio_req *reqs = palloc0(nreqs * sizeof(polar_aio_req));
+	int			i;
+
+	for (i = 0; i < nreqs; i++)
+	{
+		reqs[i].op = op;
+		reqs[i].fd = fd;
+		reqs[i].buf = palloc_io_aligned(BLCKSZ, 0);
+		reqs[i].len = BLCKSZ;
+		reqs[i].offset = (off_t) i * BLCKSZ;
+		reqs[i].real_fd = fd;
+		reqs[i].mgr = &polar_vfs_dio;
+		reqs[i].done = false;
+		reqs[i].result = -1;
+	}
+
+	return reqs;
+}
+
+/*
+ * Write nreqs blocks through one engine, read them back and check them.
+ */
+static bool
+test_aio_engine(aio_submit_func submit, aio_wait_func wait, int nreqs)
+{
+	polar_aio_req *writes;
+	polar_aio_req *reads;
+	bool		ok = true;
+	int			fd;
+	int			i;
+
+	fd = test_aio_open();
+	writes = test_aio_prepare(fd, POLAR_AIO_WRITE, nreqs);
+	reads = test_aio_prepare(fd, POLAR_AIO_READ, nreqs);
+
+	for (i = 0; i < nreqs; i++)
+		memset(writes[i].buf, 'a' + i % 26, BLCKSZ);
+
+	if (submit(writes, nreqs) != nreqs ||
+		wait(writes, nreqs, nreqs) != nreqs)
+		ok = false;
+
+	for (i = 0; ok && i < nreqs; i++)
+		ok = writes[i].result == BLCKSZ;
+
+	if (ok &&
+		(submit(reads, nreqs) != nreqs ||
+		 wait(reads, nreqs, nreqs) != nreqs))
+		ok = false;
+
+	for (i = 0; ok && i < nreqs; i++)
+		ok = reads[i].result == BLCKSZ &&
+			memcmp(reads[i].buf, writes[i].buf, BLCKSZ) == 0;
+
+	polar_directio_close(fd);
+	unlink(directio_file);
+
+	return ok;
+}
+
+/*
+ * Submit and wait for nreqs writes and reads through io_uring and through the
+ * thread pool. io_uring falls back to the thread pool if the kernel doesn't
+ * support it, and the results are the same.
+ */
+Datum
+test_directio_aio(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	int			nreqs = PG_GETARG_INT32(0);
+	int			i;
+
+	if (nreqs <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of requests must be positive")));
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	for (i = 0; i < 2; i++)
+	{
+		Datum		values[AIO_COLUMNS];
+		bool		nulls[AIO_COLUMNS];
+		bool		ok;
+
+		if (i == 0)
+			ok = test_aio_engine(polar_aio_uring_submit, polar_aio_uring_wait, nreqs);
+		else
+			ok = test_aio_engine(polar_aio_pool_submit, polar_aio_pool_wait, nreqs);
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = CStringGetTextDatum(i == 0 ? "uring" : "pool");
+		values[1] = Int32GetDatum(nreqs);
+		values[2] = BoolGetDatum(ok);
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Submit nreqs reads through both engines and throw an ERROR without waiting
+ * for them. They are waited for when the transaction is aborted.
+ */
+Datum
+test_directio_aio_error(PG_FUNCTION_ARGS)
+{
+	int			nreqs = PG_GETARG_INT32(0);
+	polar_aio_req *reqs;
+	int			fd;
+
+	if (nreqs <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of requests must be positive")));
+
+	fd = test_aio_open();
+	if (ftruncate(fd, (off_t) nreqs * BLCKSZ) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not truncate file \"%s\": %m", directio_file)));
+
+	reqs = test_aio_prepare(fd, POLAR_AIO_READ, nreqs);
+	polar_aio_uring_submit(reqs, nreqs);
+	reqs = test_aio_prepare(fd, POLAR_AIO_READ, nreqs);
+	polar_aio_pool_submit(reqs, nreqs);
+
+	/* The fd is left open until the backend exits */
+	unlink(directio_file);
+	elog(ERROR, "error with %d asynchronous reads submitted", nreqs * 2);
+
+	PG_RETURN_VOID();
+}
+
+Datum
+test_directio_aio_inflight(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT32(polar_aio_inflight());
+}
+
 static void
 prepare_file_with_length(char *path, ssize_t len)
 {
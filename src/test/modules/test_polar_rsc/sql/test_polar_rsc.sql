@@ -54,5 +54,10 @@ SELECT in_cache, main_cache
 SELECT test_polar_rsc_search_by_mapping(relfilenode)
     FROM pg_class WHERE relname = 'test_rsc';
 
+-- smgrnblocks hit by searching ref and mapping
+SELECT test_polar_rsc_bench_nblocks(ARRAY[relfilenode], 10, false) AS by_ref,
+       test_polar_rsc_bench_nblocks(ARRAY[relfilenode], 10, true) AS by_mapping
+    FROM pg_class WHERE relname = 'test_rsc';
+
 DROP TABLE test_rsc;
 DROP EXTENSION test_polar_rsc;
@@ -0,0 +1,98 @@
+# 001_rsc_bench.pl
+#	  Throughput of smgrnblocks with relation size cache under concurrency.
+#
+# Copyright (c) 2024, Alibaba Group Holding Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# IDENTIFICATION
+#	  src/test/modules/test_polar_rsc/t/001_rsc_bench.pl
+#
+# Every pgbench client calls smgrnblocks on a set of partitions in turn,
+# searching the shared relation by the pointer of smgr relation or by the
+# mapping. The number of calls per second is reported for 1 to 128 clients.
+#
+# It takes a while, so it only runs if PG_TEST_EXTRA contains rsc_bench.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+if (!$ENV{PG_TEST_EXTRA} || $ENV{PG_TEST_EXTRA} !~ /\brsc_bench\b/)
+{
+	plan skip_all => 'test rsc_bench not enabled in PG_TEST_EXTRA';
+}
+
+my $partitions = $ENV{RSC_BENCH_PARTITIONS} || 1000;
+my $duration = $ENV{RSC_BENCH_DURATION} || 3;
+my $loops = 100;
+my @clients = (1, 2, 4, 8, 16, 32, 64, 128);
+
+my $node = PostgreSQL::Test::Cluster->new('rsc_bench');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+polar_enable_rel_size_cache = on
+polar_rsc_shared_relations = 4096
+max_connections = 200
+));
+$node->start;
+
+$node->safe_psql(
+	'postgres', qq(
+CREATE EXTENSION test_polar_rsc;
+CREATE TABLE rsc_bench (id int) PARTITION BY HASH (id);
+SELECT format('CREATE TABLE rsc_bench_%s PARTITION OF rsc_bench FOR VALUES WITH (MODULUS $partitions, REMAINDER %s)', i, i)
+	FROM generate_series(0, $partitions - 1) i \\gexec
+CREATE TABLE rsc_bench_relnodes AS
+	SELECT array_agg(relfilenode) AS relnodes FROM pg_class
+	WHERE relname ~ '^rsc_bench_[0-9]+\$' AND relkind = 'r';
+));
+
+my $nrels = $node->safe_psql('postgres',
+	'SELECT array_length(relnodes, 1) FROM rsc_bench_relnodes');
+is($nrels, $partitions, 'partitions are created');
+
+foreach my $by_mapping ('false', 'true')
+{
+	my $script = $node->basedir . "/rsc_bench_$by_mapping.sql";
+	my $search = $by_mapping eq 'true' ? 'mapping' : 'ref';
+
+	PostgreSQL::Test::Utils::append_to_file($script,
+		    "SELECT test_polar_rsc_bench_nblocks(relnodes, $loops, $by_mapping) "
+		  . "FROM rsc_bench_relnodes;\n");
+
+	foreach my $c (@clients)
+	{
+		my ($stdout, $stderr) = $node->run_command(
+			[
+				'pgbench', '--no-vacuum', '--client', $c, '--jobs', $c,
+				'--time', $duration, '--file', $script, 'postgres'
+			]);
+
+		ok($stdout =~ /tps = ([\d.]+)/, "pgbench by $search with $c clients")
+		  or diag($stderr);
+		my $tps = $1 || 0;
+
+		note(
+			sprintf(
+				"search by %-7s clients %3d: %12.0f smgrnblocks/s",
+				$search, $c, $tps * $loops * $nrels));
+	}
+}
+
+$node->stop;
+
+done_testing();
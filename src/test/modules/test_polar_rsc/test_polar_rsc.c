@@ -25,8 +25,11 @@
 
 #include "postgres.h"
 
+#include "catalog/pg_type.h"
 #include "funcapi.h"
+#include "miscadmin.h"
 #include "storage/polar_rsc.h"
+#include "utils/array.h"
 
 PG_MODULE_MAGIC;
 
@@ -107,3 +110,56 @@ test_polar_rsc_update_entry(PG_FUNCTION_ARGS)
 
 	PG_RETURN_UINT32(nblocks);
 }
+
+/*
+ * Call smgrnblocks() on the main fork of the relations in turn for loops
+ * rounds, and return the number of calls. With by_mapping, the pointer to
+ * the shared relation is reset before each call to search the mapping.
+ */
+PG_FUNCTION_INFO_V1(test_polar_rsc_bench_nblocks);
+Datum
+test_polar_rsc_bench_nblocks(PG_FUNCTION_ARGS)
+{
+	ArrayType  *relnodes = PG_GETARG_ARRAYTYPE_P(0);
+	int32		loops = PG_GETARG_INT32(1);
+	bool		by_mapping = PG_GETARG_BOOL(2);
+	Datum	   *elems;
+	int			nrels;
+	SMgrRelation *relns;
+	int64		calls = 0;
+	int			i;
+	int			j;
+
+	deconstruct_array(relnodes, OIDOID, sizeof(Oid), true, TYPALIGN_INT,
+					  &elems, NULL, &nrels);
+
+	relns = (SMgrRelation *) palloc(sizeof(SMgrRelation) * nrels);
+	for (i = 0; i < nrels; i++)
+	{
+		RelFileNode rnode;
+
+		rnode.dbNode = MyDatabaseId;
+		rnode.spcNode = MyDatabaseTableSpace;
+		rnode.relNode = DatumGetObjectId(elems[i]);
+		relns[i] = smgropen(rnode, InvalidBackendId);
+	}
+
+	for (j = 0; j < loops; j++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		for (i = 0; i < nrels; i++)
+		{
+			if (by_mapping)
+				relns[i]->rsc_ref = NULL;
+
+			if (smgrnblocks(relns[i], MAIN_FORKNUM) != InvalidBlockNumber)
+				calls++;
+		}
+	}
+
+	for (i = 0; i < nrels; i++)
+		smgrclose(relns[i]);
+
+	PG_RETURN_INT64(calls);
+}
@@ -200,6 +200,19 @@ test_multi_calc(polar_task_sched_ctl_t *ctl, int max_calc_num)
 	return total;
 }
 
+/* Each task must be handled exactly once, no matter which process steals it */
+static uint64
+test_handled_tasks(polar_task_sched_t *sched)
+{
+	uint64		handled = 0;
+	int			i;
+
+	for (i = 0; i < sched->total_proc; i++)
+		handled += pg_atomic_read_u64(&POLAR_SCHED_PROC_STAT(sched, i)->handled_tasks);
+
+	return handled;
+}
+
 PG_FUNCTION_INFO_V1(test_procpool);
 /*
  * SQL-callable entry point to perform all tests.
@@ -213,8 +226,12 @@ test_procpool(PG_FUNCTION_ARGS)
 {
 	int			max_calc_num = PG_GETARG_INT32(0);
 	uint64		value;
+	uint64		handled;
 
 	polar_task_sched_ctl_t *ctl = test_node_create_task_ctl();
+	polar_task_sched_t *sched = ctl->sched;
+
+	handled = test_handled_tasks(sched);
 
 	polar_start_proc_pool(ctl);
 
@@ -222,6 +239,8 @@ test_procpool(PG_FUNCTION_ARGS)
 
 	polar_release_task_sched_ctl(ctl);
 
+	Assert(test_handled_tasks(sched) - handled == max_calc_num);
+
 	return value;
 }
 
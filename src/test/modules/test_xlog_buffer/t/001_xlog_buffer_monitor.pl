@@ -70,6 +70,11 @@ $result = $node_replica->safe_psql('postgres',
 );
 is($result, qq(t|t|t|t), 'check replica');
 
+$result = $node_replica->safe_psql('postgres',
+	"select hit_ratio > 0 and hit_ratio <= 1, evictions >= 0, collisions >= 0 from polar_stat_xlog_buffer;"
+);
+is($result, qq(t|t|t), 'check replica xlog buffer view');
+
 
 $node_primary->safe_psql('postgres', "update test_xlog_buffer set i = 2");
 $node_primary->wait_for_catchup($node_standby);
@@ -150,6 +150,14 @@ test_xlog_buffer_api(void)
 	}
 	check_xlog_buffer_stat_info();
 
+	/* every older page is evicted once, and nobody raced with us */
+	if (pg_atomic_read_u64(&polar_xlog_buffer_ins->evict_count) != POLAR_XLOG_BUFFER_TOTAL_COUNT() ||
+		pg_atomic_read_u64(&polar_xlog_buffer_ins->collision_count) != 0)
+		ereport(PANIC,
+				errmsg("Unexpected xlog buffer evict and collision count: (%ld, %ld)",
+					   pg_atomic_read_u64(&polar_xlog_buffer_ins->evict_count),
+					   pg_atomic_read_u64(&polar_xlog_buffer_ins->collision_count)));
+
 	/* search all xlog buffer blocks again, but no one will be matched */
 	for (lsn = 0L; lsn < 64 * 1024 * 1024; lsn += XLOG_BLCKSZ)
 	{
@@ -269,7 +277,6 @@ test_xlog_read_record(XLogReaderState *xlogreader, XLogRecPtr flush_lsn, bool wi
 static void
 test_read_record(void)
 {
-	int			buf_id;
 	XLogReaderState *xlogreader;
 	XLogRecPtr	start_lsn = GetFlushRecPtr(NULL);
 	XLogRecPtr	flush_lsn = InvalidXLogRecPtr;
@@ -318,9 +325,7 @@ test_read_record(void)
 	/* the first page of segment file woule be read to varify header */
 	io++;
 	test_xlog_read_record(xlogreader, flush_lsn, false);
-	buf_id = polar_get_xlog_buffer_id(xlogreader->EndRecPtr);
-	Assert(polar_xlog_buffer_ins->buffer_descriptors[buf_id].desc.start_lsn == InvalidXLogRecPtr);
-	Assert(polar_xlog_buffer_ins->buffer_descriptors[buf_id].desc.end_lsn == InvalidXLogRecPtr);
+	Assert(polar_xlog_buffer_get_end_lsn(xlogreader->EndRecPtr) == InvalidXLogRecPtr);
 
 	/* second loop of XLogReadRecord with max bg_replayed_lsn */
 	polar_bg_redo_set_replayed_lsn(polar_logindex_redo_instance, flush_lsn);
@@ -328,9 +333,7 @@ test_read_record(void)
 	io++;
 	append++;
 	test_xlog_read_record(xlogreader, flush_lsn, true);
-	buf_id = polar_get_xlog_buffer_id(xlogreader->EndRecPtr);
-	Assert(polar_xlog_buffer_ins->buffer_descriptors[buf_id].desc.start_lsn == flush_lsn - (flush_lsn % XLOG_BLCKSZ));
-	Assert(polar_xlog_buffer_ins->buffer_descriptors[buf_id].desc.end_lsn == flush_lsn - 1);
+	Assert(polar_xlog_buffer_get_end_lsn(xlogreader->EndRecPtr) == flush_lsn - 1);
 
 	check_xlog_buffer_stat_info();
 
@@ -358,9 +361,7 @@ test_read_record(void)
 	hit++;
 	polar_bg_redo_set_replayed_lsn(polar_logindex_redo_instance, flush_lsn);
 	test_xlog_read_record(xlogreader, flush_lsn, true);
-	buf_id = polar_get_xlog_buffer_id(xlogreader->EndRecPtr);
-	Assert(polar_xlog_buffer_ins->buffer_descriptors[buf_id].desc.start_lsn == flush_lsn - (flush_lsn % XLOG_BLCKSZ));
-	Assert(polar_xlog_buffer_ins->buffer_descriptors[buf_id].desc.end_lsn == flush_lsn - 1);
+	Assert(polar_xlog_buffer_get_end_lsn(xlogreader->EndRecPtr) == flush_lsn - 1);
 
 	check_xlog_buffer_stat_info();
 
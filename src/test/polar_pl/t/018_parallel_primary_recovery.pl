@@ -0,0 +1,76 @@
+# 018_parallel_primary_recovery.pl
+#	  Test case: parallel replay in primary crash recovery.
+#     It will: (1) Insert, update and delete; (2) stop RW immediate;
+#     (3) start RW with parallel replay; (4) check data.
+#
+# Copyright (c) 2024, Alibaba Group Holding Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# IDENTIFICATION
+#	  src/test/polar_pl/t/018_parallel_primary_recovery.pl
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node_primary = PostgreSQL::Test::Cluster->new('primary');
+$node_primary->polar_init_primary;
+$node_primary->append_conf('postgresql.conf', 'checkpoint_timeout=3600');
+$node_primary->append_conf('postgresql.conf',
+	'polar_enable_parallel_replay_primary_recovery=on');
+$node_primary->start;
+
+$node_primary->safe_psql('postgres',
+	q[create table parallel_recovery_tbl(c1 int primary key, c2 int);]);
+$node_primary->safe_psql('postgres', q[checkpoint;]);
+$node_primary->safe_psql('postgres',
+	q[insert into parallel_recovery_tbl select i, i from generate_series(1, 200000) i;]
+);
+$node_primary->safe_psql('postgres',
+	q[update parallel_recovery_tbl set c2 = c2 + 1 where c1 % 3 = 0;]);
+$node_primary->safe_psql('postgres',
+	q[delete from parallel_recovery_tbl where c1 % 5 = 0;]);
+$node_primary->safe_psql('postgres', q[create database parallel_recovery_db;]);
+
+my $expected = $node_primary->safe_psql('postgres',
+	q[select count(*), sum(c2) from parallel_recovery_tbl;]);
+
+$node_primary->stop('immediate');
+my $log_offset = -s $node_primary->logfile;
+$node_primary->start;
+
+ok( $node_primary->log_contains(
+		'start parallel crash recovery from', $log_offset),
+	'crash recovery runs in parallel replay mode');
+ok( $node_primary->log_contains(
+		'parallel crash recovery finished at', $log_offset),
+	'parallel replay finished before end of recovery');
+ok($node_primary->log_contains('redo replayed \d+ records', $log_offset),
+	'recovery throughput is reported');
+
+is( $node_primary->safe_psql(
+		'postgres', q[select count(*), sum(c2) from parallel_recovery_tbl;]),
+	$expected,
+	'data is consistent after parallel crash recovery');
+is( $node_primary->safe_psql(
+		'postgres',
+		q[set enable_seqscan = off; select count(*) from parallel_recovery_tbl where c1 > 0;]
+	),
+	(split /\|/, $expected)[0],
+	'index is consistent after parallel crash recovery');
+
+$node_primary->stop;
+done_testing();
@@ -0,0 +1,86 @@
+# 019_autoprewarm_shared_dump.pl
+#	  Test case: replica prewarms from the block ranges dumped by primary
+#     into shared storage. It will: (1) dump on primary; (2) refuse to dump
+#     on replica; (3) prewarm on replica after restart.
+#
+# Copyright (c) 2024, Alibaba Group Holding Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# IDENTIFICATION
+#	  src/test/polar_pl/t/019_autoprewarm_shared_dump.pl
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $prewarm_conf = q[
+shared_preload_libraries = '$libdir/polar_vfs,$libdir/polar_io_stat,$libdir/polar_worker,pg_prewarm'
+pg_prewarm.polar_shared_dump = on
+];
+
+my $node_primary = PostgreSQL::Test::Cluster->new('primary');
+$node_primary->polar_init_primary;
+$node_primary->append_conf('postgresql.conf', $prewarm_conf);
+# only dump when asked
+$node_primary->append_conf('postgresql.conf',
+	'pg_prewarm.autoprewarm_interval = 0');
+
+my $node_replica = PostgreSQL::Test::Cluster->new('replica');
+$node_replica->polar_init_replica($node_primary);
+$node_replica->append_conf('postgresql.conf', $prewarm_conf);
+$node_replica->append_conf('postgresql.conf',
+	'pg_prewarm.autoprewarm_interval = 1s');
+
+$node_primary->start;
+$node_primary->polar_create_slot($node_replica->name);
+$node_replica->start;
+
+$node_primary->safe_psql('postgres', q[create extension pg_prewarm;]);
+$node_primary->safe_psql('postgres',
+	q[create table prewarm_tbl as select i, repeat('x', 100) as c from generate_series(1, 50000) i;]
+);
+$node_primary->safe_psql('postgres', q[select pg_prewarm('prewarm_tbl');]);
+$node_primary->wait_for_catchup($node_replica, 'replay',
+	$node_primary->lsn('insert'));
+
+ok( $node_primary->safe_psql('postgres', q[select autoprewarm_dump_now() > 0;])
+	  eq 't',
+	'primary dumps blocks into shared storage');
+ok(-f $node_primary->polar_get_datadir . '/autoprewarm.ranges',
+	'dump file is in shared storage');
+ok(!-f $node_primary->data_dir . '/autoprewarm.blocks',
+	'no local dump file is written');
+
+my ($ret, $stdout, $stderr) =
+  $node_replica->psql('postgres', q[select autoprewarm_dump_now();]);
+like(
+	$stderr,
+	qr/could not perform block dump into shared storage during recovery/,
+	'replica does not overwrite the dump of primary');
+
+my $log_offset = -s $node_replica->logfile;
+$node_replica->restart;
+$node_replica->wait_for_log(
+	qr/autoprewarm successfully prewarmed [1-9][0-9]* of [0-9]+ previously-loaded blocks/,
+	$log_offset);
+pass('replica prewarms from the dump of primary');
+
+is( $node_replica->safe_psql('postgres', q[select count(*) from prewarm_tbl;]),
+	'50000', 'data is readable after prewarm');
+
+$node_replica->stop;
+$node_primary->stop;
+done_testing();
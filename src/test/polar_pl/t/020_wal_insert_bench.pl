@@ -0,0 +1,98 @@
+# 020_wal_insert_bench.pl
+#	  Commit throughput with different numbers of WAL insertion locks.
+#
+# Copyright (c) 2024, Alibaba Group Holding Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# IDENTIFICATION
+#	  src/test/polar_pl/t/020_wal_insert_bench.pl
+#
+# Every pgbench client commits a small insert into its own table, so that
+# WAL insertion and flushing is the bottleneck. The number of commits per
+# second is reported for 1 to 128 clients, with the default 8 insertion
+# locks and with polar_xlog_insert_locks auto-tuned by the number of CPUs.
+#
+# It takes a while, so it only runs if PG_TEST_EXTRA contains
+# wal_insert_bench.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+if (!$ENV{PG_TEST_EXTRA} || $ENV{PG_TEST_EXTRA} !~ /\bwal_insert_bench\b/)
+{
+	plan skip_all => 'test wal_insert_bench not enabled in PG_TEST_EXTRA';
+}
+
+my $duration = $ENV{WAL_INSERT_BENCH_DURATION} || 5;
+my @clients = (1, 2, 4, 8, 16, 32, 64, 128);
+
+my $node = PostgreSQL::Test::Cluster->new('wal_insert_bench');
+$node->polar_init_primary;
+$node->append_conf(
+	'postgresql.conf', qq(
+max_connections = 200
+checkpoint_timeout = 3600
+max_wal_size = 16GB
+));
+$node->start;
+
+my $script = $node->basedir . "/wal_insert_bench.sql";
+PostgreSQL::Test::Utils::append_to_file($script,
+	"INSERT INTO wal_insert_bench_:client_id VALUES (:client_id, repeat('x', 100));\n"
+);
+
+$node->safe_psql('postgres',
+	    "SELECT format('CREATE TABLE wal_insert_bench_%s (id int, v text)', i) "
+	  . "FROM generate_series(0, $clients[-1] - 1) i \\gexec");
+
+foreach my $locks ('8', '-1')
+{
+	$node->adjust_conf('postgresql.conf', 'polar_xlog_insert_locks', $locks);
+	$node->restart;
+
+	my $nlocks = $node->safe_psql('postgres', 'SHOW polar_xlog_insert_locks');
+	ok($nlocks > 0, "polar_xlog_insert_locks = $locks resolves to $nlocks");
+
+	foreach my $c (@clients)
+	{
+		my ($stdout, $stderr) = $node->run_command(
+			[
+				'pgbench', '--no-vacuum', '--client', $c, '--jobs', $c,
+				'--time', $duration, '--file', $script, 'postgres'
+			]);
+
+		ok($stdout =~ /tps = ([\d.]+)/, "pgbench with $nlocks locks and $c clients")
+		  or diag($stderr);
+		my $tps = $1 || 0;
+
+		note(sprintf("insert locks %3d clients %3d: %10.0f commits/s",
+				$nlocks, $c, $tps));
+	}
+}
+
+is( $node->safe_psql('postgres', 'SELECT count(*) > 0 FROM wal_insert_bench_0'),
+	't', 'rows are committed');
+
+$node->stop('immediate');
+$node->start;
+
+is( $node->safe_psql('postgres', 'SELECT count(*) > 0 FROM wal_insert_bench_0'),
+	't', 'WAL chain is replayed after crash');
+
+$node->stop;
+
+done_testing();
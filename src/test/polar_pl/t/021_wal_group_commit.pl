@@ -0,0 +1,75 @@
+# 021_wal_group_commit.pl
+#	  Test case: flush WAL for groups of committers by one leader.
+#     It will: (1) commit concurrently with group commit; (2) check the
+#     group flush histograms; (3) stop RW immediate and check data.
+#
+# Copyright (c) 2024, Alibaba Group Holding Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# IDENTIFICATION
+#	  src/test/polar_pl/t/021_wal_group_commit.pl
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node_primary = PostgreSQL::Test::Cluster->new('primary');
+$node_primary->polar_init_primary;
+$node_primary->append_conf('postgresql.conf',
+	'polar_enable_wal_group_commit=on');
+$node_primary->start;
+
+$node_primary->safe_psql('postgres',
+	q[create extension if not exists polar_monitor;]);
+$node_primary->safe_psql('postgres',
+	q[create table group_commit_tbl(id int, v text);]);
+
+$node_primary->pgbench(
+	'--no-vacuum --client=8 --jobs=8 --transactions=200',
+	0,
+	[qr{processed: 1600/1600}],
+	[qr{^$}],
+	'concurrent commits with WAL group commit',
+	{
+		'021_wal_group_commit' =>
+		  q[insert into group_commit_tbl values (:client_id, repeat('x', 100));]
+	},
+	'postgres');
+
+is( $node_primary->safe_psql(
+		'postgres',
+		q[select sum(v_count) > 0 from polar_stat_wal_group_commit where d_hist = 'group_size';]
+	),
+	't',
+	'WAL group flushes are counted');
+is( $node_primary->safe_psql(
+		'postgres',
+		q[select (select sum(v_count) from polar_stat_wal_group_commit where d_hist = 'wait_us') >=
+				 (select sum(v_count) from polar_stat_wal_group_commit where d_hist = 'group_size');]
+	),
+	't',
+	'every group member waits at least once per group');
+
+$node_primary->stop('immediate');
+$node_primary->start;
+
+is( $node_primary->safe_psql('postgres',
+		q[select count(*) from group_commit_tbl;]),
+	'1600',
+	'committed rows survive crash');
+
+$node_primary->stop;
+done_testing();
@@ -0,0 +1,54 @@
+# 022_xlog_insert_locks.pl
+#	  Check the values accepted by polar_xlog_insert_locks.
+#
+# Copyright (c) 2024, Alibaba Group Holding Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# IDENTIFICATION
+#	  src/test/polar_pl/t/022_xlog_insert_locks.pl
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('primary');
+$node->polar_init_primary;
+$node->start;
+
+ok($node->safe_psql('postgres', 'SHOW polar_xlog_insert_locks') > 0,
+	'auto-tuned number of insertion locks');
+
+my ($ret, $stdout, $stderr) = $node->psql('postgres',
+	'ALTER SYSTEM SET polar_xlog_insert_locks = 0');
+isnt($ret, 0, '0 insertion locks is rejected');
+like(
+	$stderr,
+	qr/invalid value for parameter "polar_xlog_insert_locks": 0/,
+	'0 insertion locks reports the invalid value');
+
+$node->safe_psql('postgres', 'ALTER SYSTEM SET polar_xlog_insert_locks = 4');
+$node->restart;
+is($node->safe_psql('postgres', 'SHOW polar_xlog_insert_locks'),
+	'4', 'explicit number of insertion locks');
+
+$node->safe_psql('postgres', 'CREATE TABLE xlog_insert_locks_tbl(id int)');
+$node->safe_psql('postgres',
+	'INSERT INTO xlog_insert_locks_tbl SELECT generate_series(1, 1000)');
+is($node->safe_psql('postgres', 'SELECT count(*) FROM xlog_insert_locks_tbl'),
+	'1000', 'WAL is inserted with 4 insertion locks');
+
+$node->stop;
+done_testing();
@@ -0,0 +1,99 @@
+# 023_bulk_read_ahead.pl
+#	  Test case: read ahead of bulk reads on direct io.
+#     It will: (1) scan and vacuum a table with read-ahead into shared
+#     buffers; (2) check the results against scans without read-ahead;
+#     (3) check that the blocks read ahead are found by the scan.
+#
+# Copyright (c) 2024, Alibaba Group Holding Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# IDENTIFICATION
+#	  src/test/polar_pl/t/023_bulk_read_ahead.pl
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('primary');
+$node->polar_init_primary;
+$node->append_conf(
+	'postgresql.conf', q[
+shared_buffers = 64MB
+polar_bulk_read_size = 16
+]);
+$node->start;
+
+$node->safe_psql('postgres',
+	q[create table read_ahead_tbl(id int, v text) with (fillfactor = 50);]);
+$node->safe_psql('postgres',
+	q[insert into read_ahead_tbl select i, repeat('x', 100) from generate_series(1, 100000) i;]
+);
+$node->safe_psql('postgres', q[checkpoint;]);
+
+my $query =
+  q[select count(*), sum(id), sum(length(v)) from read_ahead_tbl where id % 3 <> 0;];
+
+# Shared buffers are empty after restart, so every scan reads from storage
+$node->restart;
+my $expected = $node->safe_psql('postgres', $query);
+
+foreach my $windows (1, 4, 16)
+{
+	$node->restart;
+	is( $node->safe_psql(
+			'postgres',
+			"set polar_bulk_read_ahead_windows = $windows; $query"),
+		$expected,
+		"scan with $windows windows read ahead");
+}
+
+$node->restart;
+$node->safe_psql('postgres',
+	q[set polar_bulk_read_ahead_windows = 4; vacuum read_ahead_tbl;]);
+is($node->safe_psql('postgres', $query),
+	$expected, 'vacuum with read-ahead');
+
+# Blocks read ahead are hits of the scan
+$node->restart;
+my $plan = $node->safe_psql('postgres',
+	"set polar_bulk_read_ahead_windows = 4; explain (analyze, buffers, costs off, timing off) $query"
+);
+my ($hit) = $plan =~ /shared hit=(\d+)/;
+ok(defined $hit && $hit > 0, 'scan finds blocks read ahead in shared buffers');
+
+# A scan which stops early releases its read-ahead, and the blocks read
+# ahead can be updated meanwhile
+$node->restart;
+my $stderr;
+$node->psql(
+	'postgres', q[
+set polar_bulk_read_ahead_windows = 16;
+begin;
+declare c cursor for select id from read_ahead_tbl;
+move 2000 in c;
+update read_ahead_tbl set v = repeat('y', 100) where id between 2000 and 4000;
+close c;
+commit;
+],
+	stderr => \$stderr);
+is($stderr, '', 'no buffer is left pinned by read-ahead');
+is( $node->safe_psql(
+		'postgres', q[select count(*) from read_ahead_tbl where v like 'y%';]),
+	'2001',
+	'blocks read ahead are updated');
+
+$node->stop;
+done_testing();
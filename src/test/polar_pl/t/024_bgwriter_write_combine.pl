@@ -0,0 +1,105 @@
+# 024_bgwriter_write_combine.pl
+#	  Test case: write combining of bgwriter.
+#     It will: (1) dirty runs of adjacent blocks with gaps between them;
+#     (2) wait until bgwriter writes them with combined writes; (3) restart
+#     and check the rows, the table and index with amcheck, and the data
+#     checksums of the whole cluster with pg_checksums.
+#
+# Copyright (c) 2024, Alibaba Group Holding Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# IDENTIFICATION
+#	  src/test/polar_pl/t/024_bgwriter_write_combine.pl
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('primary');
+$node->polar_init_primary;
+$node->append_conf(
+	'postgresql.conf', q[
+bgwriter_delay = 10ms
+polar_bgwriter_write_combine_size = 16
+]);
+$node->start;
+
+$node->safe_psql('postgres',
+	'CREATE EXTENSION IF NOT EXISTS polar_monitor;');
+$node->safe_psql('postgres', 'CREATE EXTENSION IF NOT EXISTS amcheck;');
+
+# Updated rows stay in their blocks by HOT update
+$node->safe_psql('postgres',
+	q[create table combine_tbl(id int primary key, v text) with (fillfactor = 40);]
+);
+$node->safe_psql('postgres',
+	q[insert into combine_tbl select i, repeat('a', 300) from generate_series(1, 40000) i;]
+);
+$node->safe_psql('postgres', 'checkpoint;');
+
+my $combined_query =
+  q[select coalesce(sum(writes), 0) from polar_bgwriter_write_combine() where blocks > 1];
+my $combined = $node->safe_psql('postgres', $combined_query);
+
+# Dirty runs of 3, 4 and 5 adjacent blocks, with gaps of 1 and 2 blocks.
+# Each updated row tells the block it's in.
+my $blkno = q[(ctid::text::point)[0]::int];
+$node->safe_psql('postgres',
+	"update combine_tbl set v = repeat(chr(ascii('b') + $blkno % 20), 300) where $blkno % 16 not in (3, 4, 9, 15);"
+);
+
+my $rows_query =
+  q[select count(*), sum(id), count(distinct v), sum(length(v)) from combine_tbl;];
+my $expected = $node->safe_psql('postgres', $rows_query);
+
+ok( $node->poll_query_until(
+		'postgres', "select ($combined_query) > $combined;", 't'),
+	'bgwriter writes adjacent blocks together');
+
+# Write the rest, whatever bgwriter has not written yet
+$node->safe_psql('postgres', 'checkpoint;');
+
+$node->restart;
+
+is($node->safe_psql('postgres', $rows_query),
+	$expected, 'rows are the same after restart');
+
+is( $node->safe_psql(
+		'postgres',
+		"select count(*) from combine_tbl where v <> case when $blkno % 16 in (3, 4, 9, 15) then repeat('a', 300) else repeat(chr(ascii('b') + $blkno % 20), 300) end;"
+	),
+	'0',
+	'every block holds its own rows');
+
+is( $node->safe_psql(
+		'postgres',
+		q[select count(*) from verify_heapam('combine_tbl', check_toast := true);]
+	),
+	'0',
+	'heap is not corrupted');
+
+is( $node->safe_psql(
+		'postgres',
+		q[select bt_index_check('combine_tbl_pkey', true);]),
+	'',
+	'index matches heap');
+
+$node->stop;
+
+command_ok([ 'pg_checksums', '--check', '-D', $node->data_dir ],
+	'data checksums are valid after combined writes');
+
+done_testing();